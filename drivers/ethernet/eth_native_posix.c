@@ -219,30 +219,53 @@ static struct net_pkt *prepare_pkt(struct eth_context *ctx,
 	return pkt;
 }
 
-static int read_data(struct eth_context *ctx, int fd)
+static struct net_pkt *read_data(struct eth_context *ctx, int fd)
 {
-	struct net_if *iface = ctx->iface;
 	struct net_pkt *pkt = NULL;
 	int status;
 	int count;
 
 	count = nsi_host_read(fd, ctx->recv, sizeof(ctx->recv));
 	if (count <= 0) {
-		return 0;
+		return NULL;
 	}
 
 	pkt = prepare_pkt(ctx, count, &status);
 	if (!pkt) {
-		return status;
+		return NULL;
 	}
 
-	update_gptp(iface, pkt, false);
+	update_gptp(ctx->iface, pkt, false);
 
-	if (net_recv_data(iface, pkt) < 0) {
-		net_pkt_unref(pkt);
+	return pkt;
+}
+
+/* Read the frames that are already waiting, up to the batch size, and pass
+ * them to the network stack in one go.
+ */
+static void read_batch(struct eth_context *ctx, int fd)
+{
+	struct net_pkt *pkts[CONFIG_ETH_NATIVE_POSIX_RX_BATCH];
+	struct net_pkt *pkt;
+	int count = 0;
+	int i;
+
+	do {
+		pkt = read_data(ctx, fd);
+		if (pkt) {
+			pkts[count++] = pkt;
+		}
+	} while (count < ARRAY_SIZE(pkts) && !eth_wait_data(fd));
+
+	if (count == 0) {
+		return;
 	}
 
-	return 0;
+	if (net_recv_data_batch(ctx->iface, pkts, count) < 0) {
+		for (i = 0; i < count; i++) {
+			net_pkt_unref(pkts[i]);
+		}
+	}
 }
 
 static void eth_rx(void *p1, void *p2, void *p3)
@@ -256,7 +279,7 @@ static void eth_rx(void *p1, void *p2, void *p3)
 	while (1) {
 		if (net_if_is_up(ctx->iface)) {
 			while (!eth_wait_data(ctx->dev_fd)) {
-				read_data(ctx, ctx->dev_fd);
+				read_batch(ctx, ctx->dev_fd);
 				k_yield();
 			}
 		}
@@ -201,7 +201,7 @@ static inline int net_capture_send(const struct device *dev, struct net_if *ifac
  * @param iface Network interface the packet is being sent
  * @param pkt The network packet that is sent
  */
-#if defined(CONFIG_NET_CAPTURE)
+#if defined(CONFIG_NET_CAPTURE) || defined(CONFIG_NET_CAPTURE_RING)
 void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt);
 #else
 static inline void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt)
@@ -248,8 +248,166 @@ static inline void net_capture_foreach(net_capture_cb_t cb, void *user_data)
 }
 #endif
 
+/**
+ * @brief Store the network packet into the capture ring if needed.
+ *
+ * @param iface Network interface the packet is being sent or received
+ * @param pkt The network packet
+ */
+#if defined(CONFIG_NET_CAPTURE_RING)
+void net_capture_ring_pkt(struct net_if *iface, struct net_pkt *pkt);
+#else
+static inline void net_capture_ring_pkt(struct net_if *iface, struct net_pkt *pkt)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(pkt);
+}
+#endif
+
 /** @endcond */
 
+/** Global header of a pcap file, in host byte order */
+struct net_capture_pcap_hdr {
+	/** Magic number, 0xa1b2c3d4 */
+	uint32_t magic;
+	/** Major version of the file format */
+	uint16_t version_major;
+	/** Minor version of the file format */
+	uint16_t version_minor;
+	/** Time zone correction, always 0 */
+	int32_t thiszone;
+	/** Timestamp accuracy, always 0 */
+	uint32_t sigfigs;
+	/** Maximum length of the stored packets */
+	uint32_t snaplen;
+	/** Link layer type of the stored packets */
+	uint32_t linktype;
+};
+
+/** Header of a packet record in a pcap file, in host byte order */
+struct net_capture_pcap_rec_hdr {
+	/** Capture time, seconds since boot */
+	uint32_t ts_sec;
+	/** Capture time, microseconds part */
+	uint32_t ts_usec;
+	/** Number of bytes of the packet stored after this header */
+	uint32_t incl_len;
+	/** Length of the packet */
+	uint32_t orig_len;
+};
+
+/** Capture ring statistics */
+struct net_capture_ring_stats {
+	/** Number of packets stored into the ring */
+	uint32_t captured;
+	/** Number of stored packets that were truncated */
+	uint32_t truncated;
+	/** Number of packets not stored because the ring was full */
+	uint32_t dropped;
+};
+
+/**
+ * @typedef net_capture_ring_cb_t
+ * @brief Callback used while consuming the capture ring
+ *
+ * @param data Captured data, a sequence of pcap records. The data is valid
+ *        only during the callback.
+ * @param len Length of the data
+ * @param user_data A valid pointer to user data or NULL
+ *
+ * @return 0 if the data was consumed, <0 to stop and keep the data in the
+ *         ring
+ */
+typedef int (*net_capture_ring_cb_t)(const uint8_t *data, size_t len,
+				     void *user_data);
+
+#if defined(CONFIG_NET_CAPTURE_RING) || defined(__DOXYGEN__)
+
+/**
+ * @brief Start capturing network packets into the capture ring.
+ *
+ * @details The ring and its statistics are cleared. Packets are
+ *          truncated to CONFIG_NET_CAPTURE_RING_SNAPLEN bytes.
+ *
+ * @param iface Network interface to capture, or NULL to capture all
+ *        the network interfaces
+ *
+ * @return 0 if ok, -EALREADY if the capture is already running
+ */
+int net_capture_ring_enable(struct net_if *iface);
+
+/**
+ * @brief Stop capturing network packets into the capture ring.
+ *
+ * @details The packets already captured are kept in the ring.
+ *
+ * @return 0 if ok, -EALREADY if the capture was not running
+ */
+int net_capture_ring_disable(void);
+
+/**
+ * @brief Is the capture into the ring running.
+ *
+ * @return True if running, False otherwise
+ */
+bool net_capture_ring_is_enabled(void);
+
+/**
+ * @brief Get the capture ring statistics.
+ *
+ * @param stats Statistics, filled by this function
+ */
+void net_capture_ring_stats_get(struct net_capture_ring_stats *stats);
+
+/**
+ * @brief Get the pcap global header matching the captured records.
+ *
+ * @param hdr Header, filled by this function
+ */
+void net_capture_ring_pcap_header(struct net_capture_pcap_hdr *hdr);
+
+/**
+ * @brief Read captured packets from the capture ring.
+ *
+ * @details Only whole records are read, each one is a
+ *          struct net_capture_pcap_rec_hdr followed by the data.
+ *
+ * @param buf Buffer where to copy the records
+ * @param len Length of the buffer
+ *
+ * @return Number of bytes read, 0 if the ring is empty, -EMSGSIZE if the
+ *         next record does not fit into the buffer
+ */
+int net_capture_ring_read(uint8_t *buf, size_t len);
+
+/**
+ * @brief Consume the captured packets in place.
+ *
+ * @details The callback is called with data pointing into the ring,
+ *          without copying it first. The data is a sequence of pcap
+ *          records, a record might be split between two calls.
+ *
+ * @param cb Callback to call for each contiguous part of the ring
+ * @param user_data User supplied data
+ *
+ * @return Number of bytes consumed, or the error returned by the callback
+ */
+int net_capture_ring_consume(net_capture_ring_cb_t cb, void *user_data);
+
+/**
+ * @brief Save the captured packets into a pcap file.
+ *
+ * @details The saved packets are removed from the ring. This needs
+ *          CONFIG_FILE_SYSTEM.
+ *
+ * @param path Path of the file, the file is created or overwritten
+ *
+ * @return 0 if ok, <0 if the file could not be written
+ */
+int net_capture_ring_save(const char *path);
+
+#endif /* CONFIG_NET_CAPTURE_RING */
+
 /**
  * @}
  */
@@ -47,6 +47,27 @@ typedef void (*coap_client_response_cb_t)(int16_t result_code,
 					  size_t offset, const uint8_t *payload, size_t len,
 					  bool last_block, void *user_data);
 
+/**
+ * @typedef coap_client_payload_cb_t
+ * @brief Callback providing the payload of a CoAP request.
+ *
+ * This callback is used instead of a payload buffer to stream a large payload with a blockwise
+ * transfer. It is called once per block with increasing offset, and again with the offset of a
+ * block which has to be retransmitted, so it must be able to provide the same data twice.
+ * Every block but the last one must be full.
+ *
+ * @param offset Payload offset from the beginning of the blockwise transfer.
+ * @param payload Set to the buffer containing the payload, which has to stay valid until the
+ *                callback is called again or the request is finished.
+ * @param len On input the block size, on output the size of the payload.
+ * @param last_block Set to true when this is the last block of the payload.
+ * @param user_data User provided context.
+ *
+ * @return Zero on success, otherwise a negative error code to abort the request.
+ */
+typedef int (*coap_client_payload_cb_t)(size_t offset, const uint8_t **payload, size_t *len,
+					bool *last_block, void *user_data);
+
 /**
  * @brief Representation of a CoAP client request.
  */
@@ -57,6 +78,7 @@ struct coap_client_request {
 	enum coap_content_format fmt;       /**< Content format to be used */
 	uint8_t *payload;	            /**< User allocated buffer for send request */
 	size_t len;		            /**< Length of the payload */
+	coap_client_payload_cb_t payload_cb; /**< Streamed payload, used instead of payload */
 	coap_client_response_cb_t cb;       /**< Callback when response received */
 	struct coap_client_option *options; /**< Extra options to be added to request */
 	uint8_t num_options;                /**< Number of extra options */
@@ -78,6 +100,13 @@ struct coap_client_option {
 };
 
 /** @cond INTERNAL_HIDDEN */
+struct coap_client_block2_slot {
+	struct coap_pending pending;
+	uint32_t block;
+	bool used;
+	bool dropped;
+};
+
 struct coap_client_internal_request {
 	uint8_t request_token[COAP_TOKEN_MAX_LEN];
 	uint32_t offset;
@@ -90,6 +119,11 @@ struct coap_client_internal_request {
 	struct coap_client_request coap_request;
 	struct coap_packet request;
 	uint8_t request_tag[COAP_TOKEN_MAX_LEN];
+#if CONFIG_COAP_CLIENT_BLOCK2_WINDOW > 1
+	struct coap_client_block2_slot block2_slots[CONFIG_COAP_CLIENT_BLOCK2_WINDOW];
+	uint32_t block2_next;
+	bool block2_window;
+#endif
 };
 
 struct coap_client {
@@ -44,6 +44,9 @@ struct coap_service_data {
 	int sock_fd;
 	struct coap_observer observers[CONFIG_COAP_SERVICE_OBSERVERS];
 	struct coap_pending pending[CONFIG_COAP_SERVICE_PENDING_MESSAGES];
+#if defined(CONFIG_COAP_SERVER_RESOURCE_TRIE)
+	uint16_t trie_root;
+#endif
 };
 
 struct coap_service {
@@ -299,6 +302,79 @@ int coap_resource_remove_observer_by_addr(struct coap_resource *resource,
 int coap_resource_remove_observer_by_token(struct coap_resource *resource,
 					   const uint8_t *token, uint8_t token_len);
 
+/**
+ * @brief Callback providing a block of a resource representation.
+ *
+ * @param offset Offset of the block in the representation
+ * @param buf Buffer to fill with the block
+ * @param len Size of the block, less bytes are only allowed for the last block
+ * @param last_block Set to true if this is the last block
+ * @param user_data User provided context
+ * @return Number of bytes written to @p buf or negative in case of error.
+ */
+typedef int (*coap_resource_read_cb_t)(size_t offset, uint8_t *buf, size_t len,
+				       bool *last_block, void *user_data);
+
+/**
+ * @brief Callback consuming a block of a request payload.
+ *
+ * @param offset Offset of the block in the payload
+ * @param buf Block data
+ * @param len Length of the block data
+ * @param last_block True if this is the last block
+ * @param user_data User provided context
+ * @return 0 in case of success, -EINVAL if the block is not expected (the request is
+ *         answered with 4.08 Request Entity Incomplete) or other negative error code.
+ */
+typedef int (*coap_resource_write_cb_t)(size_t offset, const uint8_t *buf, size_t len,
+					bool last_block, void *user_data);
+
+/**
+ * @brief Answer a GET @p request with the block it asks for.
+ *
+ * @note This function is suitable for a @p resource defined with @ref COAP_RESOURCE_DEFINE.
+ *
+ * The block is read through @p cb at the offset of the Block2 option of the request,
+ * using at most CONFIG_COAP_SERVER_BLOCK_SIZE bytes. No state is kept between blocks,
+ * so clients can request several blocks at once.
+ *
+ * @param resource Pointer to CoAP resource
+ * @param request CoAP request to answer
+ * @param addr Peer address
+ * @param addr_len Peer address length
+ * @param fmt Content format of the representation
+ * @param total_size Size of the representation, sent as Size2 option, or 0 if unknown
+ * @param cb Callback providing the block
+ * @param user_data User provided context passed to @p cb
+ * @return 0 in case of success or negative in case of error.
+ */
+int coap_resource_send_block2(const struct coap_resource *resource,
+			      const struct coap_packet *request,
+			      const struct sockaddr *addr, socklen_t addr_len,
+			      enum coap_content_format fmt, size_t total_size,
+			      coap_resource_read_cb_t cb, void *user_data);
+
+/**
+ * @brief Pass the block of a PUT or POST @p request to @p cb and answer it.
+ *
+ * @note This function is suitable for a @p resource defined with @ref COAP_RESOURCE_DEFINE.
+ *
+ * The request is answered with 2.31 Continue until the last block, which is answered with
+ * 2.04 Changed. A request without Block1 option is passed as a single last block.
+ *
+ * @param resource Pointer to CoAP resource
+ * @param request CoAP request to answer
+ * @param addr Peer address
+ * @param addr_len Peer address length
+ * @param cb Callback consuming the block
+ * @param user_data User provided context passed to @p cb
+ * @return 0 in case of success or negative in case of error.
+ */
+int coap_resource_recv_block1(const struct coap_resource *resource,
+			      const struct coap_packet *request,
+			      const struct sockaddr *addr, socklen_t addr_len,
+			      coap_resource_write_cb_t cb, void *user_data);
+
 /**
  * @}
  */
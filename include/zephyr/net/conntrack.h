@@ -0,0 +1,189 @@
+/** @file
+ * @brief Connection tracking and network address and port translation
+ *
+ * Track the IPv4 connections that are forwarded between network
+ * interfaces, and optionally translate the source address and port of the
+ * connections that leave through a given interface (NAPT).
+ */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_INCLUDE_NET_CONNTRACK_H_
+#define ZEPHYR_INCLUDE_NET_CONNTRACK_H_
+
+/**
+ * @brief Connection tracking
+ * @defgroup net_conntrack Connection tracking
+ * @ingroup networking
+ * @{
+ */
+
+#include <errno.h>
+#include <zephyr/types.h>
+#include <zephyr/net/net_ip.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct net_if;
+struct net_pkt;
+
+/** Connection tracking state of a packet */
+enum net_conntrack_state {
+	/** The packet does not belong to any tracked connection */
+	NET_CONNTRACK_NEW = 0,
+	/** The packet belongs to a tracked connection, in either direction */
+	NET_CONNTRACK_ESTABLISHED,
+};
+
+/**
+ * @brief Addresses and ports of one direction of a connection
+ *
+ * For ICMP echo the identifier is used as the source port of the request
+ * and as the destination port of the reply, the other port is zero.
+ */
+struct net_conntrack_tuple {
+	/** Source address */
+	struct in_addr src;
+	/** Destination address */
+	struct in_addr dst;
+	/** Source port in network byte order */
+	uint16_t src_port;
+	/** Destination port in network byte order */
+	uint16_t dst_port;
+	/** IP protocol, IPPROTO_TCP, IPPROTO_UDP or IPPROTO_ICMP */
+	uint8_t proto;
+};
+
+/**
+ * @typedef net_conntrack_cb_t
+ * @brief Callback used while iterating over the tracked connections
+ *
+ * @param orig Tuple of the packets sent by the connection initiator
+ * @param reply Tuple of the packets that are expected in return. If the
+ *        connection is translated, the reply destination is the translated
+ *        address and port.
+ * @param user_data A valid pointer to user data or NULL
+ */
+typedef void (*net_conntrack_cb_t)(const struct net_conntrack_tuple *orig,
+				   const struct net_conntrack_tuple *reply,
+				   void *user_data);
+
+#if defined(CONFIG_NET_CONNTRACK) || defined(__DOXYGEN__)
+
+/**
+ * @brief Go through all the tracked connections and call callback
+ * for each of them.
+ *
+ * @note The callback is called with the connection table locked, so it
+ * must not call any connection tracking function.
+ *
+ * @param cb User supplied callback function to call
+ * @param user_data User specified data
+ *
+ * @return Number of tracked connections
+ */
+int net_conntrack_foreach(net_conntrack_cb_t cb, void *user_data);
+
+/**
+ * @brief Remove all the tracked connections
+ */
+void net_conntrack_flush(void);
+
+/**
+ * @brief Get the connection tracking state of a received IPv4 packet
+ *
+ * The connection table is only consulted, the packet does not refresh
+ * nor create a connection.
+ *
+ * @param pkt Network packet that starts with the IPv4 header, like the
+ *        packets seen by the IPv4 receive packet filter hook.
+ *
+ * @return State of the connection the packet belongs to
+ */
+enum net_conntrack_state net_conntrack_get_state(struct net_pkt *pkt);
+
+#else
+
+static inline int net_conntrack_foreach(net_conntrack_cb_t cb, void *user_data)
+{
+	ARG_UNUSED(cb);
+	ARG_UNUSED(user_data);
+
+	return 0;
+}
+
+static inline void net_conntrack_flush(void)
+{
+}
+
+static inline enum net_conntrack_state net_conntrack_get_state(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return NET_CONNTRACK_NEW;
+}
+
+#endif /* CONFIG_NET_CONNTRACK */
+
+#if defined(CONFIG_NET_NAPT) || defined(__DOXYGEN__)
+
+/**
+ * @brief Translate the connections that are forwarded out through a
+ * network interface
+ *
+ * The source address of the forwarded packets is replaced with the
+ * address of the interface, and the source port with a free port if
+ * the original one is already taken. The replies are translated back
+ * and forwarded to the original source.
+ *
+ * @param iface Network interface facing the external network
+ *
+ * @return 0 if ok, -ENOMEM if too many interfaces are already translated
+ */
+int net_napt_enable(struct net_if *iface);
+
+/**
+ * @brief Stop translating the connections forwarded out through a
+ * network interface
+ *
+ * The translated connections of the interface are removed.
+ *
+ * @param iface Network interface
+ *
+ * @return 0 if ok, -ENOENT if translation was not enabled on the interface
+ */
+int net_napt_disable(struct net_if *iface);
+
+#else
+
+static inline int net_napt_enable(struct net_if *iface)
+{
+	ARG_UNUSED(iface);
+
+	return -ENOTSUP;
+}
+
+static inline int net_napt_disable(struct net_if *iface)
+{
+	ARG_UNUSED(iface);
+
+	return -ENOTSUP;
+}
+
+#endif /* CONFIG_NET_NAPT */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_INCLUDE_NET_CONNTRACK_H_ */
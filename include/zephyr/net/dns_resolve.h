@@ -148,7 +148,8 @@ enum dns_resolve_status {
  *                     this case
  *  DNS_EAI_CANCELED   if the query was canceled manually or timeout happened
  *  DNS_EAI_FAIL       if the name cannot be resolved by the server
- *  DNS_EAI_NODATA     if there is no such name
+ *  DNS_EAI_NONAME     if there is no such name
+ *  DNS_EAI_NODATA     if the name has no address of the queried type
  *  other values means that an error happened.
  * @param info Query results are stored here.
  * @param user_data The user data given in dns_resolve_name() call.
@@ -157,6 +158,22 @@ typedef void (*dns_resolve_cb_t)(enum dns_resolve_status status,
 				 struct dns_addrinfo *info,
 				 void *user_data);
 
+/**
+ * DNS resolver cache statistics.
+ */
+struct dns_resolve_cache_stats {
+	/** Lookups answered from entries which are still valid */
+	uint32_t hits;
+	/** Lookups answered from expired entries while they were refreshed */
+	uint32_t stale_hits;
+	/** Lookups answered from a cached name error or empty answer */
+	uint32_t negative_hits;
+	/** Lookups which had to be sent to the DNS servers */
+	uint32_t misses;
+	/** Queries sent in the background to refresh cached entries */
+	uint32_t refreshes;
+};
+
 enum dns_resolve_context_state {
 	DNS_RESOLVE_CONTEXT_ACTIVE,
 	DNS_RESOLVE_CONTEXT_DEACTIVATING,
@@ -398,6 +415,15 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
  */
 struct dns_resolve_context *dns_resolve_get_default(void);
 
+/**
+ * @brief Get the statistics of the DNS resolver cache.
+ *
+ * @param stats Statistics are stored here.
+ *
+ * @return 0 if ok, <0 if error, -ENOTSUP if CONFIG_DNS_RESOLVER_CACHE is disabled.
+ */
+int dns_resolve_get_cache_stats(struct dns_resolve_cache_stats *stats);
+
 /**
  * @brief Get IP address info from DNS.
  *
@@ -31,10 +31,22 @@ extern "C" {
 
 /** @cond INTERNAL_HIDDEN */
 
+struct eth_bridge_fdb_entry {
+	sys_snode_t node;
+	struct net_if *iface;
+	uint32_t seen;
+	uint8_t addr[6];
+};
+
 struct eth_bridge {
 	struct k_mutex lock;
 	sys_slist_t interfaces;
 	sys_slist_t listeners;
+#if defined(CONFIG_NET_ETHERNET_BRIDGE_FDB)
+	sys_slist_t fdb_free;
+	sys_slist_t fdb_buckets[CONFIG_NET_ETHERNET_BRIDGE_FDB_SIZE];
+	struct eth_bridge_fdb_entry fdb_entries[CONFIG_NET_ETHERNET_BRIDGE_FDB_SIZE];
+#endif
 	bool initialized;
 };
 
@@ -83,6 +95,12 @@ struct eth_bridge_listener {
  * diverted to the bridge. However, packets sent out with net_if_queue_tx()
  * via this interface are not subjected to the bridge.
  *
+ * If CONFIG_NET_ETHERNET_BRIDGE_FDB is enabled, the source MAC addresses
+ * of the packets received by this interface are learned, and the packets
+ * sent to one of these addresses are then transmitted via this interface
+ * only. Packets sent to a broadcast, multicast or unknown address are
+ * transmitted via all the other interfaces of the bridge.
+ *
  * @param br A pointer to an initialized bridge object
  * @param iface Interface to add
  *
@@ -93,6 +111,8 @@ int eth_bridge_iface_add(struct eth_bridge *br, struct net_if *iface);
 /**
  * @brief Remove an Ethernet network interface from a bridge
  *
+ * The MAC addresses learned on this interface are forgotten.
+ *
  * @param br A pointer to an initialized bridge object
  * @param iface Interface to remove
  *
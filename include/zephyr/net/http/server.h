@@ -0,0 +1,229 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief HTTP/1.1 server API
+ */
+
+#ifndef ZEPHYR_INCLUDE_NET_HTTP_SERVER_H_
+#define ZEPHYR_INCLUDE_NET_HTTP_SERVER_H_
+
+/**
+ * @brief HTTP server API
+ * @defgroup http_server HTTP server API
+ * @ingroup networking
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/http/method.h>
+#include <zephyr/net/http/parser.h>
+#include <zephyr/net/http/service.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @cond INTERNAL_HIDDEN */
+
+#if defined(CONFIG_HTTP_SERVER)
+#define HTTP_SERVER_CLIENT_BUFFER_SIZE CONFIG_HTTP_SERVER_CLIENT_BUFFER_SIZE
+#define HTTP_SERVER_RESPONSE_BUFFER_SIZE CONFIG_HTTP_SERVER_RESPONSE_BUFFER_SIZE
+#define HTTP_SERVER_MAX_URL_LENGTH CONFIG_HTTP_SERVER_MAX_URL_LENGTH
+#else
+#define HTTP_SERVER_CLIENT_BUFFER_SIZE 0
+#define HTTP_SERVER_RESPONSE_BUFFER_SIZE 0
+#define HTTP_SERVER_MAX_URL_LENGTH 0
+#endif
+
+/* Room for the status line and the headers of a response */
+#define HTTP_SERVER_HEADER_BUFFER_SIZE 192
+
+/** @endcond */
+
+/** Type of an HTTP resource. */
+enum http_resource_type {
+	/** Resource with fixed content, typically stored in flash. */
+	HTTP_RESOURCE_TYPE_STATIC,
+	/** Resource whose content is generated by a callback. */
+	HTTP_RESOURCE_TYPE_DYNAMIC,
+};
+
+/**
+ * @brief Common part of the resource detail.
+ *
+ * The @c detail pointer of an @ref http_resource_desc points to one of the
+ * resource specific detail structures, which all start with this one.
+ */
+struct http_resource_detail {
+	/** Bitmask of the supported methods, BIT(HTTP_GET) etc. */
+	uint32_t bitmask_of_supported_http_methods;
+
+	/** Type of the resource. */
+	enum http_resource_type type;
+
+	/** Value of the Content-Type header, or NULL to leave it out. */
+	const char *content_type;
+
+	/** Value of the Content-Encoding header, or NULL to leave it out. */
+	const char *content_encoding;
+};
+
+/**
+ * @brief Detail of a static resource.
+ *
+ * The content is sent straight from @c static_data, it is never copied to
+ * an intermediate buffer, so it can live in flash.
+ */
+struct http_resource_detail_static {
+	/** Common resource detail. */
+	struct http_resource_detail common;
+
+	/** Content of the resource. */
+	const void *static_data;
+
+	/** Length of the content. */
+	size_t static_data_len;
+};
+
+/** Reason of a dynamic resource callback. */
+enum http_data_status {
+	/** Part of the request body is passed to the callback. */
+	HTTP_SERVER_DATA_MORE,
+	/** The whole request has been received. */
+	HTTP_SERVER_DATA_FINAL,
+	/** The callback should write the next part of the response. */
+	HTTP_SERVER_DATA_RESPONSE,
+};
+
+struct http_client_ctx;
+
+/**
+ * @brief Callback of a dynamic resource.
+ *
+ * The callback is first called with @ref HTTP_SERVER_DATA_MORE for each
+ * piece of the request body, with @p buffer pointing to the data, then once
+ * with @ref HTTP_SERVER_DATA_FINAL when the request is complete. After that
+ * it is called with @ref HTTP_SERVER_DATA_RESPONSE and an empty @p buffer of
+ * @p len bytes until it returns 0; each returned length is sent to the
+ * client as one chunk of the response.
+ *
+ * The callback is called from the socket service thread and must not block.
+ *
+ * @param client Client that made the request.
+ * @param status Reason of the call.
+ * @param buffer Request data, or the buffer for the response.
+ * @param len Length of the request data, or size of the response buffer.
+ * @param user_data User data of the resource.
+ *
+ * @return Length of the response data written to @p buffer, 0 when the
+ *         response is complete, <0 to abort the connection. The return value
+ *         of the request data calls is only checked for errors.
+ */
+typedef int (*http_resource_dynamic_cb_t)(struct http_client_ctx *client,
+					  enum http_data_status status,
+					  uint8_t *buffer, size_t len,
+					  void *user_data);
+
+/** @brief Detail of a dynamic resource. */
+struct http_resource_detail_dynamic {
+	/** Common resource detail. */
+	struct http_resource_detail common;
+
+	/** Callback that handles the requests. */
+	http_resource_dynamic_cb_t cb;
+
+	/** User data passed to the callback. */
+	void *user_data;
+};
+
+/**
+ * @brief State of one client connection.
+ *
+ * Only @c fd, @c service, @c method and @c url are meant to be read by the
+ * dynamic resource callbacks, the rest is private to the server.
+ */
+struct http_client_ctx {
+	/** Socket of the connection, -1 if the slot is free. */
+	int fd;
+
+	/** Service the client connected to. */
+	const struct http_service_desc *service;
+
+	/** Method of the current request. */
+	enum http_method method;
+
+	/** Path of the current request. */
+	char url[HTTP_SERVER_MAX_URL_LENGTH + 1];
+
+	/** @cond INTERNAL_HIDDEN */
+	struct http_parser parser;
+	const struct http_resource_detail *resource;
+	struct k_work_delayable inactivity_timer;
+	atomic_t expired;
+	size_t url_len;
+	size_t data_len;
+	size_t header_len;
+	int status;
+	short events;
+	bool url_too_long;
+	bool request_done;
+	bool keep_alive;
+	bool chunked;
+	bool generating;
+	bool close_after_send;
+
+	/* Unsent part of the response */
+	struct iovec out[3];
+	int out_idx;
+	int out_cnt;
+
+	uint8_t buffer[HTTP_SERVER_CLIENT_BUFFER_SIZE];
+	char header[HTTP_SERVER_HEADER_BUFFER_SIZE];
+	uint8_t response[HTTP_SERVER_RESPONSE_BUFFER_SIZE];
+	/** @endcond */
+};
+
+/**
+ * @brief Start the HTTP server.
+ *
+ * Opens a listening socket for every service defined with
+ * @ref HTTP_SERVICE_DEFINE and starts serving them from the socket service
+ * thread. A service whose host is not an IP address listens on the
+ * unspecified address. If the port of a service is 0, the assigned
+ * ephemeral port is written back to it.
+ *
+ * The @c detail of a service, if not NULL, points to an
+ * @ref http_resource_detail that is used for the requests that match none
+ * of its resources.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int http_server_start(void);
+
+/**
+ * @brief Stop the HTTP server.
+ *
+ * Closes all the client connections and listening sockets.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int http_server_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_INCLUDE_NET_HTTP_SERVER_H_ */
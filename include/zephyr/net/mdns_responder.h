@@ -26,6 +26,8 @@
  * @param records A pointer to an array of mDNS records. It is stored internally
  *                without copying the content so it must be kept valid. It can
  *                be set to NULL, e.g. before freeing the memory block.
+ *                Answers still waiting to be sent for the previous records
+ *                are dropped, so those can be released once this returns.
  * @param count The number of elements
  * @return 0 for OK; -EINVAL for invalid parameters.
  */
@@ -766,12 +766,16 @@ int mqtt_live(struct mqtt_client *client);
 int mqtt_keepalive_time_left(const struct mqtt_client *client);
 
 /**
- * @brief Receive an incoming MQTT packet. The registered callback will be
- *        called with the packet content.
+ * @brief Receive incoming MQTT packets. The registered callback will be
+ *        called with the content of each packet.
+ *
+ * Up to CONFIG_MQTT_INPUT_MAX_PACKETS packets already available on the
+ * transport are handled by one call.
  *
  * @note In case of PUBLISH message, the payload has to be read separately with
  *       @ref mqtt_read_publish_payload function. The size of the payload to
- *       read is provided in the publish event structure.
+ *       read is provided in the publish event structure. No further packet is
+ *       handled by the call until the payload has been read.
  *
  * @note This is a non-blocking call.
  *
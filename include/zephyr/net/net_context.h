@@ -1187,6 +1187,39 @@ int net_context_sendmsg(struct net_context *context,
 			k_timeout_t timeout,
 			void *user_data);
 
+/**
+ * @brief Send data from caller supplied network buffers.
+ *
+ * @details The data is sent without copying it to freshly allocated
+ * buffers. The stack takes over the fragments that it sends, and
+ * releases them when it no longer needs them: for UDP after the packet
+ * has been transmitted, for TCP after the data has been acknowledged by
+ * the peer. The caller can get notified about that by allocating the
+ * fragments from a pool that has a destroy callback. Only UDP and TCP
+ * contexts of the native network stack are supported. For TCP, no more
+ * than the TX window permits is queued, so only some of the data might
+ * be sent.
+ *
+ * @param context The network context to use.
+ * @param data Fragment chain to send, set to the fragments that were not
+ *        sent. The caller is responsible for the fragments left there,
+ *        which is the whole chain if an error is returned.
+ * @param dst_addr Destination address, NULL for a connected context.
+ * @param addrlen Length of the address.
+ * @param cb Caller-supplied callback function.
+ * @param timeout Currently this value is not used.
+ * @param user_data Caller-supplied user data.
+ *
+ * @return numbers of bytes sent on success, a negative errno otherwise
+ */
+int net_context_sendto_buf(struct net_context *context,
+			   struct net_buf **data,
+			   const struct sockaddr *dst_addr,
+			   socklen_t addrlen,
+			   net_context_send_cb_t cb,
+			   k_timeout_t timeout,
+			   void *user_data);
+
 /**
  * @brief Receive network data from a peer specified by context.
  *
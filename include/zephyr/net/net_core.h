@@ -120,6 +120,26 @@ enum net_verdict {
  */
 int net_recv_data(struct net_if *iface, struct net_pkt *pkt);
 
+/**
+ * @brief Called by network device driver when several network packets have
+ * been received. The packets are pushed up in the network stack like with
+ * net_recv_data(), but the packets that go to the same RX queue are added to
+ * it in one operation, so the RX thread is woken up once per batch instead
+ * of once per packet.
+ *
+ * @note The packets are processed in the order they are in the array. The
+ * content of the array is modified by the function.
+ *
+ * @param iface Network interface where the packets were received.
+ * @param pkts Array of received network packets.
+ * @param count Number of packets in the array.
+ *
+ * @return 0 if ok, in which case the stack owns all the packets, <0 if error,
+ *         in which case none of the packets has been consumed.
+ */
+int net_recv_data_batch(struct net_if *iface, struct net_pkt **pkts,
+			size_t count);
+
 /**
  * @brief Send data to network.
  *
@@ -199,6 +199,12 @@ struct net_pkt {
 				  */
 #if defined(CONFIG_NET_IP_FRAGMENT)
 	uint8_t ip_reassembled : 1; /* Packet is a reassembled IP packet. */
+#endif
+#if defined(CONFIG_NET_GRO)
+	uint8_t rx_chksum_verified : 1; /* Set by GRO to 1 if the checksums of
+					 * the received segments have been
+					 * verified already
+					 */
 #endif
 	/* bitfield byte alignment boundary */
 
@@ -881,6 +887,33 @@ static inline void net_pkt_set_ip_reassembled(struct net_pkt *pkt,
 }
 #endif /* CONFIG_NET_IP_FRAGMENT */
 
+#if defined(CONFIG_NET_GRO)
+static inline bool net_pkt_is_rx_chksum_verified(struct net_pkt *pkt)
+{
+	return !!(pkt->rx_chksum_verified);
+}
+
+static inline void net_pkt_set_rx_chksum_verified(struct net_pkt *pkt,
+						  bool verified)
+{
+	pkt->rx_chksum_verified = verified;
+}
+#else /* CONFIG_NET_GRO */
+static inline bool net_pkt_is_rx_chksum_verified(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return false;
+}
+
+static inline void net_pkt_set_rx_chksum_verified(struct net_pkt *pkt,
+						  bool verified)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(verified);
+}
+#endif /* CONFIG_NET_GRO */
+
 static inline uint8_t net_pkt_priority(struct net_pkt *pkt)
 {
 	return pkt->priority;
@@ -19,6 +19,7 @@
 #include <zephyr/sys/slist.h>
 #include <zephyr/net/net_core.h>
 #include <zephyr/net/ethernet.h>
+#include <zephyr/net/conntrack.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -57,10 +58,17 @@ extern struct npf_rule npf_default_ok;
 /** @brief Default rule list termination for rejecting a packet */
 extern struct npf_rule npf_default_drop;
 
+/** @cond INTERNAL_HIDDEN */
+struct npf_prog;
+/** @endcond */
+
 /** @brief rule set for a given test location */
 struct npf_rule_list {
 	sys_slist_t rule_head;
 	struct k_spinlock lock;
+#if defined(CONFIG_NET_PKT_FILTER_COMPILE)
+	struct npf_prog *prog;	/**< rule list compiled for evaluation */
+#endif
 };
 
 /** @brief  rule list applied to outgoing packets */
@@ -377,6 +385,58 @@ extern npf_test_fn_t npf_ip_src_addr_unmatch;
 		.test.fn = npf_ip_src_addr_unmatch, \
 	}
 
+#if defined(CONFIG_NET_CONNTRACK) || defined(__DOXYGEN__)
+
+/** @cond INTERNAL_HIDDEN */
+
+struct npf_test_ct_state {
+	struct npf_test test;
+	enum net_conntrack_state state;
+};
+
+extern npf_test_fn_t npf_ct_state_match;
+extern npf_test_fn_t npf_ct_state_unmatch;
+
+/** @endcond */
+
+/**
+ * @brief Statically define a "connection tracking state match" packet
+ * filter condition
+ *
+ * This tests if the packet has the given connection tracking state. Only
+ * the IPv4 packets that are forwarded are tracked, so this is meant for
+ * the IPv4 receive hook, e.g. to drop the new connections that arrive
+ * through the interface facing an external network.
+ *
+ * @param _name Name of the condition
+ * @param _state Connection tracking state, <tt>NET_CONNTRACK_NEW</tt> or
+ *               <tt>NET_CONNTRACK_ESTABLISHED</tt>
+ */
+#define NPF_CT_STATE_MATCH(_name, _state) \
+	struct npf_test_ct_state _name = { \
+		.state = (_state), \
+		.test.fn = npf_ct_state_match, \
+	}
+
+/**
+ * @brief Statically define a "connection tracking state unmatch" packet
+ * filter condition
+ *
+ * This tests if the packet does not have the given connection tracking
+ * state.
+ *
+ * @param _name Name of the condition
+ * @param _state Connection tracking state, <tt>NET_CONNTRACK_NEW</tt> or
+ *               <tt>NET_CONNTRACK_ESTABLISHED</tt>
+ */
+#define NPF_CT_STATE_UNMATCH(_name, _state) \
+	struct npf_test_ct_state _name = { \
+		.state = (_state), \
+		.test.fn = npf_ct_state_unmatch, \
+	}
+
+#endif /* CONFIG_NET_CONNTRACK */
+
 /** @} */
 
 /**
@@ -165,6 +165,17 @@ struct net_stats_tcp {
 	net_stats_t connrst;
 };
 
+/**
+ * @brief Generic receive offload (GRO) statistics
+ */
+struct net_stats_gro {
+	/** Number of TCP segments coalesced into a preceding segment. */
+	net_stats_t merged;
+
+	/** Number of coalesced packets passed to the IP stack. */
+	net_stats_t flushed;
+};
+
 /**
  * @brief UDP statistics
  */
@@ -322,6 +333,11 @@ struct net_stats {
 	struct net_stats_tcp tcp;
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_GRO)
+	/** GRO statistics */
+	struct net_stats_gro gro;
+#endif
+
 #if defined(CONFIG_NET_STATISTICS_UDP)
 	/** UDP statistics */
 	struct net_stats_udp udp;
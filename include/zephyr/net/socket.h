@@ -82,6 +82,8 @@ struct zsock_pollfd {
 #define ZSOCK_MSG_DONTWAIT 0x40
 /** zsock_recv: block until the full amount of data can be returned */
 #define ZSOCK_MSG_WAITALL 0x100
+/** zsock_recvmmsg: block only until the first message has been received */
+#define ZSOCK_MSG_WAITFORONE 0x10000
 /** @} */
 
 /**
@@ -192,9 +194,13 @@ struct zsock_pollfd {
 /** Socket option to control TLS session caching on a socket. Accepted values:
  *  - 0 - Disabled.
  *  - 1 - Enabled.
+ *
+ *  On a server socket, enabling the option also makes the socket issue
+ *  session tickets if CONFIG_NET_SOCKETS_TLS_SERVER_SESSION_TICKETS is set.
  */
 #define TLS_SESSION_CACHE 12
 /** Write-only socket option to purge session cache immediately.
+ *  The session tickets issued so far are invalidated as well.
  *  This option accepts any value.
  */
 #define TLS_SESSION_CACHE_PURGE 13
@@ -208,6 +214,12 @@ struct zsock_pollfd {
  *  - 2 - DTLS CID will be enabled, and the most recent value set with
  *        TLS_DTLS_CID_VALUE will be sent to the peer. Otherwise, a random value
  *        will be used.
+ *
+ *  Once a CID is in use on the downlink, an authenticated record carrying it
+ *  is accepted from any address, and the peer address of the socket is
+ *  updated to the source of that record. This lets a session survive a
+ *  change of the peer address, for example a NAT rebinding, without a new
+ *  handshake.
  */
 #define TLS_DTLS_CID 14
 /** Read-only socket option to get DTLS CID status.
@@ -529,6 +541,121 @@ __syscall ssize_t zsock_recvfrom(int sock, void *buf, size_t max_len,
  */
 __syscall ssize_t zsock_recvmsg(int sock, struct msghdr *msg, int flags);
 
+/**
+ * @brief Send multiple messages to arbitrary network addresses
+ *
+ * @details
+ * Send the messages in @p msgvec like zsock_sendmsg() would do, but
+ * with a single socket lookup and lock acquisition for all of them.
+ * The number of bytes sent for each message is stored in its
+ * @c msg_len field. Sending stops at the first message that cannot be
+ * sent, an error is returned only if no message could be sent at all.
+ * This function is also exposed as ``sendmmsg()``
+ * if :kconfig:option:`CONFIG_POSIX_API` is defined.
+ *
+ * @param sock Socket to send the messages to
+ * @param msgvec Array of messages
+ * @param vlen Number of messages in @p msgvec
+ * @param flags Same flags as for zsock_sendmsg()
+ *
+ * @return Number of messages sent, or -1 with errno set on error.
+ */
+__syscall int zsock_sendmmsg(int sock, struct mmsghdr *msgvec,
+			     unsigned int vlen, int flags);
+
+/**
+ * @brief Receive multiple messages from arbitrary network addresses
+ *
+ * @details
+ * Receive up to @p vlen messages like zsock_recvmsg() would do, but
+ * with a single socket lookup and lock acquisition for all of them.
+ * The number of bytes received for each message is stored in its
+ * @c msg_len field. If @ref ZSOCK_MSG_WAITFORONE is given, only the
+ * first message is waited for and the rest are taken if they are
+ * already queued. The timeout parameter of the Linux API is not
+ * supported, the receive timeout of the socket applies instead.
+ * This function is also exposed as ``recvmmsg()``
+ * if :kconfig:option:`CONFIG_POSIX_API` is defined.
+ *
+ * @param sock Socket to receive the messages from
+ * @param msgvec Array of messages
+ * @param vlen Number of messages in @p msgvec
+ * @param flags Same flags as for zsock_recvmsg(), and
+ *        @ref ZSOCK_MSG_WAITFORONE
+ *
+ * @return Number of messages received, or -1 with errno set on error.
+ */
+__syscall int zsock_recvmmsg(int sock, struct mmsghdr *msgvec,
+			     unsigned int vlen, int flags);
+
+#if defined(CONFIG_NET_SOCKETS_ZEROCOPY) || defined(__DOXYGEN__)
+struct net_buf;
+
+/**
+ * @brief Receive data without copying it
+ *
+ * @details
+ * Instead of copying the received data to a caller supplied buffer,
+ * the network buffers holding the data are detached from the socket
+ * and returned to the caller. For a datagram socket one call returns
+ * one datagram, for a stream socket the data of one received segment.
+ * The data starts at the beginning of the first returned fragment, so
+ * it can be parsed in place. The fragments must be released with
+ * zsock_recv_zc_release() when they are no longer needed.
+ * Only native UDP and TCP sockets are supported and the function
+ * can be called only from supervisor threads.
+ *
+ * @param sock Socket to receive the data from
+ * @param data Set to the returned fragment chain, or NULL if there is
+ *        no data (end of stream)
+ * @param flags Only @ref ZSOCK_MSG_DONTWAIT is supported
+ * @param src_addr Optional source address of the data
+ * @param addrlen Optional length of @p src_addr, value-result argument
+ *
+ * @return Number of bytes in @p data, 0 on end of stream, or -1 with
+ *         errno set on error.
+ */
+ssize_t zsock_recv_zc(int sock, struct net_buf **data, int flags,
+		      struct sockaddr *src_addr, socklen_t *addrlen);
+
+/**
+ * @brief Release data returned by zsock_recv_zc()
+ *
+ * @param data Fragment chain returned by zsock_recv_zc(), may be NULL
+ */
+void zsock_recv_zc_release(struct net_buf *data);
+
+/**
+ * @brief Send data without copying it
+ *
+ * @details
+ * The data is sent from the caller supplied fragments instead of being
+ * copied to buffers allocated by the network stack. The stack takes over
+ * the fragments that it sends, and releases them when it no longer needs
+ * them: for UDP after the datagram has been transmitted, for TCP after
+ * the data has been acknowledged by the peer. To get notified about that,
+ * allocate the fragments from a pool with a destroy callback, for
+ * instance with net_buf_alloc_with_data() to refer to application memory.
+ * For TCP no more than the TX window permits is queued, and if the call
+ * returns before all of the data could be queued, @p data is set to the
+ * fragments that were not sent. The caller still owns them and can send
+ * them again later. On error nothing is sent and the caller still owns
+ * the whole chain. Only native UDP and TCP sockets are supported and the
+ * function can be called only from supervisor threads.
+ *
+ * @param sock Socket to send the data to
+ * @param data Fragment chain to send, set to the fragments that were not
+ *        sent, NULL if all of the data was sent
+ * @param flags Only @ref ZSOCK_MSG_DONTWAIT is supported
+ * @param dest_addr Destination address, NULL for a connected socket
+ * @param addrlen Length of @p dest_addr
+ *
+ * @return Number of bytes sent, or -1 with errno set on error.
+ */
+ssize_t zsock_send_zc(int sock, struct net_buf **data, int flags,
+		      const struct sockaddr *dest_addr, socklen_t addrlen);
+#endif /* CONFIG_NET_SOCKETS_ZEROCOPY */
+
 /**
  * @brief Receive data from a connected peer
  *
@@ -949,6 +1076,20 @@ static inline ssize_t recvmsg(int sock, struct msghdr *msg, int flags)
 	return zsock_recvmsg(sock, msg, flags);
 }
 
+/** POSIX wrapper for @ref zsock_sendmmsg */
+static inline int sendmmsg(int sock, struct mmsghdr *msgvec,
+			   unsigned int vlen, int flags)
+{
+	return zsock_sendmmsg(sock, msgvec, vlen, flags);
+}
+
+/** POSIX wrapper for @ref zsock_recvmmsg */
+static inline int recvmmsg(int sock, struct mmsghdr *msgvec,
+			   unsigned int vlen, int flags)
+{
+	return zsock_recvmmsg(sock, msgvec, vlen, flags);
+}
+
 /** POSIX wrapper for @ref zsock_poll */
 static inline int poll(struct zsock_pollfd *fds, int nfds, int timeout)
 {
@@ -1055,6 +1196,8 @@ static inline char *inet_ntop(sa_family_t family, const void *src, char *dst,
 #define MSG_DONTWAIT ZSOCK_MSG_DONTWAIT
 /** POSIX wrapper for @ref ZSOCK_MSG_WAITALL */
 #define MSG_WAITALL ZSOCK_MSG_WAITALL
+/** POSIX wrapper for @ref ZSOCK_MSG_WAITFORONE */
+#define MSG_WAITFORONE ZSOCK_MSG_WAITFORONE
 
 /** POSIX wrapper for @ref ZSOCK_SHUT_RD */
 #define SHUT_RD ZSOCK_SHUT_RD
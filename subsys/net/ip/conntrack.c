@@ -0,0 +1,789 @@
+/** @file
+ * @brief Connection tracking and network address and port translation
+ *
+ * Keep track of the IPv4 connections that are forwarded between network
+ * interfaces. Each connection is hashed by the tuple of both directions,
+ * so that the packets of either direction find the connection with one
+ * lookup. The connections of the interfaces that have NAPT enabled get
+ * a reply tuple that has the address of the interface as the destination,
+ * and the packets are rewritten with incremental checksum updates.
+ */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_conntrack, CONFIG_NET_CONNTRACK_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/net_timeout.h>
+#include <zephyr/net/icmp.h>
+#include <zephyr/net/conntrack.h>
+
+#include "net_private.h"
+#include "ipv4.h"
+#include "conntrack.h"
+#include "tcp_internal.h"
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_NET_CONNTRACK_HASH_SIZE),
+	     "Hash table size must be a power of two");
+
+enum ct_dir {
+	CT_DIR_ORIG = 0,
+	CT_DIR_REPLY,
+	CT_DIR_COUNT,
+};
+
+/* The connection has seen packets in the reply direction */
+#define CT_SEEN_REPLY BIT(0)
+/* A TCP FIN or RST has been seen */
+#define CT_CLOSING    BIT(1)
+
+struct ct_tuple_hash {
+	sys_snode_t node;
+	struct net_conntrack_tuple tuple;
+	uint8_t dir;
+};
+
+struct ct_entry {
+	struct ct_tuple_hash hash[CT_DIR_COUNT];
+	/* The timeout node links the entry to the active or the free list */
+	struct net_timeout timeout;
+	/* Interface whose address the connection is translated to */
+	struct net_if *nat_iface;
+	uint8_t flags;
+};
+
+#define CT_NO_PORT -1
+
+/* Copy of the layer 4 header and the offsets of the fields that identify
+ * the connection and of the checksum.
+ */
+struct ct_l4 {
+	uint8_t hdr[sizeof(struct net_tcp_hdr)];
+	uint8_t len;
+	uint8_t proto;
+	uint8_t tcp_flags;
+	int8_t src_port;
+	int8_t dst_port;
+	uint8_t chksum;
+};
+
+struct ct_icmp_echo {
+	struct net_icmp_hdr hdr;
+	uint16_t identifier;
+	uint16_t sequence;
+} __packed;
+
+static struct ct_entry ct_entries[CONFIG_NET_CONNTRACK_MAX];
+static sys_slist_t ct_hash_table[CONFIG_NET_CONNTRACK_HASH_SIZE];
+static sys_slist_t ct_active;
+static sys_slist_t ct_free;
+static struct k_spinlock ct_lock;
+
+/* Timer that removes the idle connections */
+static struct k_work_delayable ct_timer;
+
+#if defined(CONFIG_NET_NAPT)
+static struct net_if *napt_ifaces[CONFIG_NET_IF_MAX_IPV4_COUNT];
+static uint16_t napt_next_port = CONFIG_NET_NAPT_PORT_MIN;
+#endif
+
+static inline struct ct_entry *ct_entry_get(struct ct_tuple_hash *th)
+{
+	return CONTAINER_OF(th - th->dir, struct ct_entry, hash[0]);
+}
+
+static uint32_t ct_hash(const struct net_conntrack_tuple *tuple)
+{
+	uint32_t h;
+
+	h = UNALIGNED_GET(&tuple->src.s_addr) * 0x9e3779b1U;
+	h = (h ^ UNALIGNED_GET(&tuple->dst.s_addr)) * 0x9e3779b1U;
+	h = (h ^ ((uint32_t)tuple->src_port << 16 | tuple->dst_port)) * 0x9e3779b1U;
+	h ^= tuple->proto;
+
+	return (h ^ (h >> 16)) & (CONFIG_NET_CONNTRACK_HASH_SIZE - 1);
+}
+
+static bool ct_tuple_cmp(const struct net_conntrack_tuple *a,
+			 const struct net_conntrack_tuple *b)
+{
+	return net_ipv4_addr_cmp(&a->src, &b->src) &&
+	       net_ipv4_addr_cmp(&a->dst, &b->dst) &&
+	       a->src_port == b->src_port &&
+	       a->dst_port == b->dst_port &&
+	       a->proto == b->proto;
+}
+
+static void ct_tuple_invert(struct net_conntrack_tuple *inv,
+			    const struct net_conntrack_tuple *tuple)
+{
+	net_ipaddr_copy(&inv->src, &tuple->dst);
+	net_ipaddr_copy(&inv->dst, &tuple->src);
+	inv->src_port = tuple->dst_port;
+	inv->dst_port = tuple->src_port;
+	inv->proto = tuple->proto;
+}
+
+static struct ct_tuple_hash *ct_find(const struct net_conntrack_tuple *tuple)
+{
+	struct ct_tuple_hash *th;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&ct_hash_table[ct_hash(tuple)], th, node) {
+		if (ct_tuple_cmp(&th->tuple, tuple)) {
+			return th;
+		}
+	}
+
+	return NULL;
+}
+
+static uint32_t ct_lifetime(struct ct_entry *entry)
+{
+	if (entry->hash[CT_DIR_ORIG].tuple.proto == IPPROTO_TCP &&
+	    !(entry->flags & CT_CLOSING)) {
+		return CONFIG_NET_CONNTRACK_TCP_TIMEOUT;
+	}
+
+	return CONFIG_NET_CONNTRACK_UDP_TIMEOUT;
+}
+
+static void ct_remove(struct ct_entry *entry, sys_snode_t *prev)
+{
+	for (int dir = 0; dir < CT_DIR_COUNT; dir++) {
+		struct ct_tuple_hash *th = &entry->hash[dir];
+
+		sys_slist_find_and_remove(&ct_hash_table[ct_hash(&th->tuple)],
+					  &th->node);
+	}
+
+	sys_slist_remove(&ct_active, prev, &entry->timeout.node);
+	sys_slist_prepend(&ct_free, &entry->timeout.node);
+}
+
+static void ct_timeout(struct k_work *work)
+{
+	uint32_t next_update = UINT32_MAX;
+	uint32_t current_time = k_uptime_get_32();
+	struct ct_entry *current, *next;
+	sys_snode_t *prev = NULL;
+	k_spinlock_key_t key;
+
+	ARG_UNUSED(work);
+
+	key = k_spin_lock(&ct_lock);
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&ct_active, current, next,
+					  timeout.node) {
+		uint32_t this_update = net_timeout_evaluate(&current->timeout,
+							    current_time);
+
+		if (this_update == 0U) {
+			NET_DBG("Connection %p expired", current);
+			ct_remove(current, prev);
+			continue;
+		}
+
+		if (this_update < next_update) {
+			next_update = this_update;
+		}
+
+		prev = &current->timeout.node;
+	}
+
+	k_spin_unlock(&ct_lock, key);
+
+	if (next_update != UINT32_MAX) {
+		k_work_reschedule(&ct_timer, K_MSEC(next_update));
+	}
+}
+
+static void ct_timer_start(uint32_t lifetime)
+{
+	k_timeout_t delay = K_SECONDS(lifetime);
+
+	/* The timer is only moved closer, an entry that is refreshed is
+	 * checked again when the timer expires.
+	 */
+	if (!k_work_delayable_is_pending(&ct_timer) ||
+	    k_work_delayable_remaining_get(&ct_timer) > delay.ticks) {
+		k_work_reschedule(&ct_timer, delay);
+	}
+}
+
+static inline uint16_t *ct_l4_field(struct ct_l4 *l4, int offset)
+{
+	return (uint16_t *)&l4->hdr[offset];
+}
+
+/* Parse the tuple of the packet, the layer 4 header is copied to l4. The
+ * caller restores the cursor.
+ */
+static int ct_pkt_tuple(struct net_pkt *pkt, struct net_ipv4_hdr *hdr,
+			struct net_conntrack_tuple *tuple, struct ct_l4 *l4)
+{
+	/* Only the first fragment has the ports */
+	if ((ntohs(UNALIGNED_GET((uint16_t *)hdr->offset)) &
+	     (NET_IPV4_FRAGH_OFFSET_MASK | NET_IPV4_MORE_FRAG_MASK)) != 0) {
+		return -EINVAL;
+	}
+
+	switch (hdr->proto) {
+	case IPPROTO_TCP:
+		l4->len = sizeof(struct net_tcp_hdr);
+		l4->src_port = offsetof(struct net_tcp_hdr, src_port);
+		l4->dst_port = offsetof(struct net_tcp_hdr, dst_port);
+		l4->chksum = offsetof(struct net_tcp_hdr, chksum);
+		break;
+	case IPPROTO_UDP:
+		l4->len = sizeof(struct net_udp_hdr);
+		l4->src_port = offsetof(struct net_udp_hdr, src_port);
+		l4->dst_port = offsetof(struct net_udp_hdr, dst_port);
+		l4->chksum = offsetof(struct net_udp_hdr, chksum);
+		break;
+	case IPPROTO_ICMP:
+		l4->len = sizeof(struct ct_icmp_echo);
+		l4->chksum = offsetof(struct ct_icmp_echo, hdr.chksum);
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	net_pkt_cursor_init(pkt);
+	net_pkt_set_overwrite(pkt, true);
+
+	if (net_pkt_skip(pkt, (hdr->vhl & NET_IPV4_IHL_MASK) * 4U) ||
+	    net_pkt_read(pkt, l4->hdr, l4->len)) {
+		return -EINVAL;
+	}
+
+	l4->proto = hdr->proto;
+	l4->tcp_flags = 0U;
+
+	if (hdr->proto == IPPROTO_TCP) {
+		l4->tcp_flags = ((struct net_tcp_hdr *)l4->hdr)->flags;
+	} else if (hdr->proto == IPPROTO_ICMP) {
+		uint8_t type = ((struct net_icmp_hdr *)l4->hdr)->type;
+		int8_t id = offsetof(struct ct_icmp_echo, identifier);
+
+		if (type == NET_ICMPV4_ECHO_REQUEST) {
+			l4->src_port = id;
+			l4->dst_port = CT_NO_PORT;
+		} else if (type == NET_ICMPV4_ECHO_REPLY) {
+			l4->src_port = CT_NO_PORT;
+			l4->dst_port = id;
+		} else {
+			return -EPROTONOSUPPORT;
+		}
+	}
+
+	net_ipv4_addr_copy_raw((uint8_t *)&tuple->src, hdr->src);
+	net_ipv4_addr_copy_raw((uint8_t *)&tuple->dst, hdr->dst);
+	tuple->proto = hdr->proto;
+	tuple->src_port = l4->src_port == CT_NO_PORT ? 0U :
+			  UNALIGNED_GET(ct_l4_field(l4, l4->src_port));
+	tuple->dst_port = l4->dst_port == CT_NO_PORT ? 0U :
+			  UNALIGNED_GET(ct_l4_field(l4, l4->dst_port));
+
+	return 0;
+}
+
+/* Write the modified layer 4 header back to the packet */
+static int ct_pkt_write_l4(struct net_pkt *pkt, struct net_ipv4_hdr *hdr,
+			   struct ct_l4 *l4)
+{
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_skip(pkt, (hdr->vhl & NET_IPV4_IHL_MASK) * 4U)) {
+		return -EINVAL;
+	}
+
+	return net_pkt_write(pkt, l4->hdr, l4->len);
+}
+
+/* Replace the source or the destination address and port of the packet */
+static void ct_rewrite(struct net_ipv4_hdr *hdr, struct ct_l4 *l4, bool src,
+		       const struct in_addr *addr, uint16_t port)
+{
+	uint8_t *hdr_addr = src ? hdr->src : hdr->dst;
+	int port_offset = src ? l4->src_port : l4->dst_port;
+	uint32_t old_addr = UNALIGNED_GET((uint32_t *)hdr_addr);
+	uint32_t new_addr = UNALIGNED_GET(&addr->s_addr);
+	uint16_t chksum = UNALIGNED_GET(ct_l4_field(l4, l4->chksum));
+	uint16_t old_port = port;
+
+	hdr->chksum = net_chksum_update_u32(hdr->chksum, old_addr, new_addr);
+	UNALIGNED_PUT(new_addr, (uint32_t *)hdr_addr);
+
+	/* The ICMP echo reply has no source port, the request no destination
+	 * port.
+	 */
+	if (port_offset != CT_NO_PORT) {
+		old_port = UNALIGNED_GET(ct_l4_field(l4, port_offset));
+		UNALIGNED_PUT(port, ct_l4_field(l4, port_offset));
+	}
+
+	/* The ICMP checksum does not cover the IP header. A zero UDP
+	 * checksum means that there is no checksum.
+	 */
+	if (l4->proto == IPPROTO_ICMP) {
+		chksum = net_chksum_update_u16(chksum, old_port, port);
+	} else if (l4->proto == IPPROTO_TCP || chksum != 0U) {
+		chksum = net_chksum_update_u32(chksum, old_addr, new_addr);
+		chksum = net_chksum_update_u16(chksum, old_port, port);
+
+		if (l4->proto == IPPROTO_UDP && chksum == 0U) {
+			chksum = 0xffff;
+		}
+	}
+
+	UNALIGNED_PUT(chksum, ct_l4_field(l4, l4->chksum));
+}
+
+/* Restart the idle timeout of the connection. Returns the new lifetime if
+ * it became shorter, 0 otherwise.
+ */
+static uint32_t ct_refresh(struct ct_entry *entry, struct ct_l4 *l4, int dir)
+{
+	uint32_t lifetime;
+	bool closing = false;
+
+	if (dir == CT_DIR_REPLY) {
+		entry->flags |= CT_SEEN_REPLY;
+	}
+
+	if ((l4->tcp_flags & (FIN | RST)) && !(entry->flags & CT_CLOSING)) {
+		entry->flags |= CT_CLOSING;
+		closing = true;
+	}
+
+	lifetime = ct_lifetime(entry);
+	net_timeout_set(&entry->timeout, lifetime, k_uptime_get_32());
+
+	return closing ? lifetime : 0U;
+}
+
+#if defined(CONFIG_NET_NAPT)
+static bool napt_iface_enabled(struct net_if *iface)
+{
+	ARRAY_FOR_EACH(napt_ifaces, i) {
+		if (napt_ifaces[i] == iface) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Select the port of the reply tuple so that the tuple is unique. The
+ * original port is kept if possible.
+ */
+static int napt_select_port(struct net_conntrack_tuple *reply)
+{
+	if (ct_find(reply) == NULL) {
+		return 0;
+	}
+
+	/* At most CONFIG_NET_CONNTRACK_MAX ports can be taken */
+	for (int i = 0; i <= CONFIG_NET_CONNTRACK_MAX; i++) {
+		uint16_t port = napt_next_port;
+
+		napt_next_port = port == UINT16_MAX ? CONFIG_NET_NAPT_PORT_MIN :
+						      port + 1U;
+
+		reply->dst_port = htons(port);
+
+		if (ct_find(reply) == NULL) {
+			return 0;
+		}
+	}
+
+	return -EADDRINUSE;
+}
+#else
+static inline bool napt_iface_enabled(struct net_if *iface)
+{
+	ARG_UNUSED(iface);
+
+	return false;
+}
+
+static inline int napt_select_port(struct net_conntrack_tuple *reply)
+{
+	ARG_UNUSED(reply);
+
+	return -ENOTSUP;
+}
+#endif /* CONFIG_NET_NAPT */
+
+/* Must be called with ct_lock held. The nat_addr is the address that the
+ * source is translated to if nat_iface is set.
+ */
+static struct ct_entry *ct_add(const struct net_conntrack_tuple *tuple,
+			       struct net_if *nat_iface,
+			       const struct in_addr *nat_addr)
+{
+	struct net_conntrack_tuple reply;
+	struct ct_entry *entry;
+	sys_snode_t *node;
+
+	ct_tuple_invert(&reply, tuple);
+
+	if (nat_iface != NULL) {
+		net_ipaddr_copy(&reply.dst, nat_addr);
+
+		if (napt_select_port(&reply) < 0) {
+			NET_DBG("No free port");
+			return NULL;
+		}
+	} else if (ct_find(&reply) != NULL) {
+		/* The reply tuple belongs to a translated connection */
+		return NULL;
+	}
+
+	node = sys_slist_get(&ct_free);
+	if (node == NULL) {
+		NET_DBG("Connection table full");
+		return NULL;
+	}
+
+	entry = CONTAINER_OF(node, struct ct_entry, timeout.node);
+	entry->nat_iface = nat_iface;
+	entry->flags = 0U;
+
+	entry->hash[CT_DIR_ORIG].tuple = *tuple;
+	entry->hash[CT_DIR_ORIG].dir = CT_DIR_ORIG;
+	entry->hash[CT_DIR_REPLY].tuple = reply;
+	entry->hash[CT_DIR_REPLY].dir = CT_DIR_REPLY;
+
+	for (int dir = 0; dir < CT_DIR_COUNT; dir++) {
+		struct ct_tuple_hash *th = &entry->hash[dir];
+
+		sys_slist_prepend(&ct_hash_table[ct_hash(&th->tuple)],
+				  &th->node);
+	}
+
+	sys_slist_prepend(&ct_active, &entry->timeout.node);
+
+	return entry;
+}
+
+int net_conntrack_ipv4_forward(struct net_pkt *pkt, struct net_ipv4_hdr *hdr,
+			       struct net_if *iface)
+{
+	bool napt = napt_iface_enabled(iface);
+	struct net_conntrack_tuple tuple;
+	struct net_pkt_cursor backup;
+	struct ct_tuple_hash *th;
+	struct ct_entry *entry;
+	struct in_addr nat_addr;
+	uint32_t lifetime = 0U;
+	uint16_t nat_port = 0U;
+	k_spinlock_key_t key;
+	bool overwrite;
+	struct ct_l4 l4;
+	int ret;
+
+	net_pkt_cursor_backup(pkt, &backup);
+	overwrite = net_pkt_is_being_overwritten(pkt);
+
+	ret = ct_pkt_tuple(pkt, hdr, &tuple, &l4);
+	if (ret < 0) {
+		/* Untracked packets cannot be translated */
+		ret = napt ? ret : 0;
+		goto out;
+	}
+
+	key = k_spin_lock(&ct_lock);
+
+	th = ct_find(&tuple);
+	if (th == NULL && napt && l4.src_port != CT_NO_PORT) {
+		const struct in_addr *addr;
+
+		/* Selecting the address takes the interface lock, which
+		 * cannot be done while holding ct_lock. The connection might
+		 * be added meanwhile, so it is looked up again.
+		 */
+		k_spin_unlock(&ct_lock, key);
+
+		addr = net_if_ipv4_select_src_addr(iface, &tuple.dst);
+		if (addr == NULL || net_ipv4_is_addr_unspecified(addr)) {
+			NET_DBG("No address to translate to");
+			ret = -EADDRNOTAVAIL;
+			goto out;
+		}
+
+		net_ipaddr_copy(&nat_addr, addr);
+
+		key = k_spin_lock(&ct_lock);
+
+		th = ct_find(&tuple);
+	}
+
+	if (th == NULL) {
+		/* Only an echo request starts an ICMP connection */
+		entry = l4.src_port != CT_NO_PORT ?
+			ct_add(&tuple, napt ? iface : NULL, &nat_addr) : NULL;
+		if (entry == NULL) {
+			k_spin_unlock(&ct_lock, key);
+			ret = napt ? -ENOMEM : 0;
+			goto out;
+		}
+
+		th = &entry->hash[CT_DIR_ORIG];
+		lifetime = ct_lifetime(entry);
+	} else {
+		entry = ct_entry_get(th);
+	}
+
+	lifetime = MAX(lifetime, ct_refresh(entry, &l4, th->dir));
+
+	if (entry->nat_iface != NULL && th->dir == CT_DIR_ORIG) {
+		const struct net_conntrack_tuple *reply =
+			&entry->hash[CT_DIR_REPLY].tuple;
+
+		net_ipaddr_copy(&nat_addr, &reply->dst);
+		nat_port = reply->dst_port;
+		napt = true;
+	} else {
+		napt = false;
+	}
+
+	k_spin_unlock(&ct_lock, key);
+
+	if (lifetime > 0U) {
+		ct_timer_start(lifetime);
+	}
+
+	if (napt) {
+		ct_rewrite(hdr, &l4, true, &nat_addr, nat_port);
+
+		ret = ct_pkt_write_l4(pkt, hdr, &l4);
+	}
+
+out:
+	net_pkt_set_overwrite(pkt, overwrite);
+	net_pkt_cursor_restore(pkt, &backup);
+
+	return ret;
+}
+
+#if defined(CONFIG_NET_NAPT)
+bool net_napt_ipv4_input(struct net_pkt *pkt, struct net_ipv4_hdr *hdr)
+{
+	const struct net_conntrack_tuple *orig;
+	struct net_conntrack_tuple tuple;
+	struct net_pkt_cursor backup;
+	struct ct_tuple_hash *th;
+	struct ct_entry *entry;
+	struct in_addr addr;
+	k_spinlock_key_t key;
+	bool translated = false;
+	uint32_t lifetime;
+	bool overwrite;
+	struct ct_l4 l4;
+	uint16_t port;
+
+	if (!napt_iface_enabled(net_pkt_iface(pkt))) {
+		return false;
+	}
+
+	net_pkt_cursor_backup(pkt, &backup);
+	overwrite = net_pkt_is_being_overwritten(pkt);
+
+	if (ct_pkt_tuple(pkt, hdr, &tuple, &l4) < 0) {
+		goto out;
+	}
+
+	key = k_spin_lock(&ct_lock);
+
+	th = ct_find(&tuple);
+	if (th == NULL || th->dir != CT_DIR_REPLY) {
+		k_spin_unlock(&ct_lock, key);
+		goto out;
+	}
+
+	entry = ct_entry_get(th);
+	if (entry->nat_iface == NULL) {
+		k_spin_unlock(&ct_lock, key);
+		goto out;
+	}
+
+	lifetime = ct_refresh(entry, &l4, CT_DIR_REPLY);
+
+	orig = &entry->hash[CT_DIR_ORIG].tuple;
+	net_ipaddr_copy(&addr, &orig->src);
+	port = orig->src_port;
+
+	k_spin_unlock(&ct_lock, key);
+
+	if (lifetime > 0U) {
+		ct_timer_start(lifetime);
+	}
+
+	ct_rewrite(hdr, &l4, false, &addr, port);
+
+	translated = ct_pkt_write_l4(pkt, hdr, &l4) == 0;
+
+out:
+	net_pkt_set_overwrite(pkt, overwrite);
+	net_pkt_cursor_restore(pkt, &backup);
+
+	return translated;
+}
+
+int net_napt_enable(struct net_if *iface)
+{
+	k_spinlock_key_t key;
+	int ret = -ENOMEM;
+
+	if (iface == NULL) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&ct_lock);
+
+	if (napt_iface_enabled(iface)) {
+		ret = 0;
+		goto out;
+	}
+
+	ARRAY_FOR_EACH(napt_ifaces, i) {
+		if (napt_ifaces[i] == NULL) {
+			napt_ifaces[i] = iface;
+			ret = 0;
+			break;
+		}
+	}
+
+out:
+	k_spin_unlock(&ct_lock, key);
+
+	return ret;
+}
+
+int net_napt_disable(struct net_if *iface)
+{
+	struct ct_entry *current, *next;
+	sys_snode_t *prev = NULL;
+	k_spinlock_key_t key;
+	int ret = -ENOENT;
+
+	key = k_spin_lock(&ct_lock);
+
+	ARRAY_FOR_EACH(napt_ifaces, i) {
+		if (iface != NULL && napt_ifaces[i] == iface) {
+			napt_ifaces[i] = NULL;
+			ret = 0;
+			break;
+		}
+	}
+
+	if (ret < 0) {
+		goto out;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&ct_active, current, next,
+					  timeout.node) {
+		if (current->nat_iface == iface) {
+			ct_remove(current, prev);
+			continue;
+		}
+
+		prev = &current->timeout.node;
+	}
+
+out:
+	k_spin_unlock(&ct_lock, key);
+
+	return ret;
+}
+#endif /* CONFIG_NET_NAPT */
+
+enum net_conntrack_state net_conntrack_get_state(struct net_pkt *pkt)
+{
+	enum net_conntrack_state state = NET_CONNTRACK_NEW;
+	struct net_conntrack_tuple tuple;
+	struct net_pkt_cursor backup;
+	k_spinlock_key_t key;
+	bool overwrite;
+	struct ct_l4 l4;
+
+	if (net_pkt_family(pkt) != AF_INET) {
+		return NET_CONNTRACK_NEW;
+	}
+
+	net_pkt_cursor_backup(pkt, &backup);
+	overwrite = net_pkt_is_being_overwritten(pkt);
+
+	if (ct_pkt_tuple(pkt, NET_IPV4_HDR(pkt), &tuple, &l4) == 0) {
+		key = k_spin_lock(&ct_lock);
+
+		if (ct_find(&tuple) != NULL) {
+			state = NET_CONNTRACK_ESTABLISHED;
+		}
+
+		k_spin_unlock(&ct_lock, key);
+	}
+
+	net_pkt_set_overwrite(pkt, overwrite);
+	net_pkt_cursor_restore(pkt, &backup);
+
+	return state;
+}
+
+int net_conntrack_foreach(net_conntrack_cb_t cb, void *user_data)
+{
+	struct ct_entry *entry;
+	k_spinlock_key_t key;
+	int count = 0;
+
+	key = k_spin_lock(&ct_lock);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&ct_active, entry, timeout.node) {
+		cb(&entry->hash[CT_DIR_ORIG].tuple,
+		   &entry->hash[CT_DIR_REPLY].tuple, user_data);
+		count++;
+	}
+
+	k_spin_unlock(&ct_lock, key);
+
+	return count;
+}
+
+void net_conntrack_flush(void)
+{
+	k_spinlock_key_t key;
+	sys_snode_t *node;
+
+	key = k_spin_lock(&ct_lock);
+
+	while ((node = sys_slist_peek_head(&ct_active)) != NULL) {
+		ct_remove(CONTAINER_OF(node, struct ct_entry, timeout.node),
+			  NULL);
+	}
+
+	k_spin_unlock(&ct_lock, key);
+
+	k_work_cancel_delayable(&ct_timer);
+}
+
+void net_conntrack_init(void)
+{
+	ARRAY_FOR_EACH(ct_entries, i) {
+		sys_slist_append(&ct_free, &ct_entries[i].timeout.node);
+	}
+
+	k_work_init_delayable(&ct_timer, ct_timeout);
+
+	NET_DBG("Allocated %d connection tracking entries (%zu bytes)",
+		CONFIG_NET_CONNTRACK_MAX, sizeof(ct_entries));
+}
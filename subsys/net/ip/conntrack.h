@@ -0,0 +1,85 @@
+/** @file
+ * @brief Connection tracking internal API
+ *
+ * This is not to be included by the application.
+ */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __CONNTRACK_H
+#define __CONNTRACK_H
+
+#include <zephyr/types.h>
+
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/conntrack.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CONFIG_NET_CONNTRACK)
+/**
+ * @brief Track an IPv4 packet that is forwarded, and translate it if
+ * the connection is translated.
+ *
+ * @param pkt Network packet, the IPv4 header checksum has been verified
+ * @param hdr IPv4 header of the packet
+ * @param iface Network interface the packet is forwarded to
+ *
+ * @return 0 if the packet can be forwarded, <0 if it must be dropped
+ */
+int net_conntrack_ipv4_forward(struct net_pkt *pkt, struct net_ipv4_hdr *hdr,
+			       struct net_if *iface);
+#else
+static inline int net_conntrack_ipv4_forward(struct net_pkt *pkt,
+					     struct net_ipv4_hdr *hdr,
+					     struct net_if *iface)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(hdr);
+	ARG_UNUSED(iface);
+
+	return 0;
+}
+#endif /* CONFIG_NET_CONNTRACK */
+
+#if defined(CONFIG_NET_NAPT)
+/**
+ * @brief Translate back the destination of a received IPv4 packet if it is
+ * a reply of a translated connection.
+ *
+ * @param pkt Network packet, the IPv4 header checksum has been verified
+ * @param hdr IPv4 header of the packet
+ *
+ * @return true if the packet was translated and must be forwarded,
+ *         false if the packet is not a reply of a translated connection
+ */
+bool net_napt_ipv4_input(struct net_pkt *pkt, struct net_ipv4_hdr *hdr);
+#else
+static inline bool net_napt_ipv4_input(struct net_pkt *pkt,
+				       struct net_ipv4_hdr *hdr)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(hdr);
+
+	return false;
+}
+#endif /* CONFIG_NET_NAPT */
+
+#if defined(CONFIG_NET_CONNTRACK)
+void net_conntrack_init(void);
+#else
+#define net_conntrack_init(...)
+#endif /* CONFIG_NET_CONNTRACK */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONNTRACK_H */
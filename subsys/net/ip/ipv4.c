@@ -17,6 +17,7 @@ LOG_MODULE_REGISTER(net_ipv4, CONFIG_NET_IPV4_LOG_LEVEL);
 #include <zephyr/net/net_stats.h>
 #include <zephyr/net/net_context.h>
 #include <zephyr/net/virtual.h>
+#include <zephyr/sys/iterable_sections.h>
 #include "net_private.h"
 #include "connection.h"
 #include "net_stats.h"
@@ -25,6 +26,8 @@ LOG_MODULE_REGISTER(net_ipv4, CONFIG_NET_IPV4_LOG_LEVEL);
 #include "tcp_internal.h"
 #include "dhcpv4/dhcpv4_internal.h"
 #include "ipv4.h"
+#include "route.h"
+#include "conntrack.h"
 
 BUILD_ASSERT(sizeof(struct in_addr) == NET_IPV4_ADDR_SIZE);
 
@@ -232,6 +235,105 @@ int net_ipv4_parse_hdr_options(struct net_pkt *pkt,
 }
 #endif
 
+#if defined(CONFIG_NET_ROUTE_IPV4) && defined(CONFIG_NET_ROUTING)
+static struct net_if *ipv4_onlink_iface(const struct in_addr *dst)
+{
+	STRUCT_SECTION_FOREACH(net_if, iface) {
+		if (net_if_ipv4_addr_mask_cmp(iface, dst)) {
+			return iface;
+		}
+	}
+
+	return NULL;
+}
+
+static enum net_verdict ipv4_route_packet(struct net_pkt *pkt,
+					  struct net_ipv4_hdr *hdr,
+					  bool tracked)
+{
+	struct in_addr *dst = (struct in_addr *)hdr->dst;
+	struct in_addr *src = (struct in_addr *)hdr->src;
+	uint16_t ttl_proto, new_ttl_proto;
+	struct net_if *iface;
+	int ret;
+
+	/* Only unicast is forwarded, and never link-local traffic,
+	 * RFC 3927 ch 2.7.
+	 */
+	if (net_ipv4_is_addr_mcast(dst) ||
+	    net_ipv4_is_addr_bcast(net_pkt_iface(pkt), dst) ||
+	    net_ipv4_addr_cmp(dst, net_ipv4_broadcast_address()) ||
+	    net_ipv4_is_addr_unspecified(src) ||
+	    net_ipv4_is_ll_addr(src) || net_ipv4_is_ll_addr(dst)) {
+		NET_DBG("DROP: Packet %p not for me", pkt);
+		return NET_DROP;
+	}
+
+	if (hdr->ttl <= 1U) {
+		NET_DBG("DROP: Packet %p ttl expired", pkt);
+		return NET_DROP;
+	}
+
+	/* Directly connected networks do not need a route */
+	iface = ipv4_onlink_iface(dst);
+	if (iface == NULL) {
+		iface = net_route_ipv4_get_nexthop(NULL, dst, NULL);
+	}
+
+	if (iface == NULL) {
+		NET_DBG("No route to %s pkt %p dropped",
+			net_sprint_ipv4_addr(dst), pkt);
+		return NET_DROP;
+	}
+
+	if (!tracked && net_conntrack_ipv4_forward(pkt, hdr, iface) < 0) {
+		NET_DBG("DROP: Packet %p not tracked", pkt);
+		return NET_DROP;
+	}
+
+	/* TTL and protocol share a 16-bit word of the header checksum */
+	ttl_proto = UNALIGNED_GET((uint16_t *)&hdr->ttl);
+	hdr->ttl--;
+	new_ttl_proto = UNALIGNED_GET((uint16_t *)&hdr->ttl);
+	hdr->chksum = net_chksum_update_u16(hdr->chksum, ttl_proto,
+					    new_ttl_proto);
+
+	net_pkt_set_orig_iface(pkt, net_pkt_iface(pkt));
+	net_pkt_set_iface(pkt, iface);
+	net_pkt_set_forwarding(pkt, true);
+
+	net_pkt_lladdr_src(pkt)->addr = net_pkt_lladdr_if(pkt)->addr;
+	net_pkt_lladdr_src(pkt)->type = net_pkt_lladdr_if(pkt)->type;
+	net_pkt_lladdr_src(pkt)->len = net_pkt_lladdr_if(pkt)->len;
+
+	NET_DBG("Route pkt %p to %s from iface %d to %d", pkt,
+		net_sprint_ipv4_addr(dst),
+		net_if_get_by_iface(net_pkt_orig_iface(pkt)),
+		net_if_get_by_iface(iface));
+
+	ret = net_send_data(pkt);
+	if (ret < 0) {
+		NET_DBG("Cannot re-route pkt %p at iface %d (%d)", pkt,
+			net_if_get_by_iface(iface), ret);
+		return NET_DROP;
+	}
+
+	return NET_OK;
+}
+#else
+static inline enum net_verdict ipv4_route_packet(struct net_pkt *pkt,
+						 struct net_ipv4_hdr *hdr,
+						 bool tracked)
+{
+	ARG_UNUSED(hdr);
+	ARG_UNUSED(tracked);
+
+	NET_DBG("DROP: Packet %p not for me", pkt);
+
+	return NET_DROP;
+}
+#endif /* CONFIG_NET_ROUTE_IPV4 && CONFIG_NET_ROUTING */
+
 enum net_verdict net_ipv4_input(struct net_pkt *pkt, bool is_loopback)
 {
 	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
@@ -338,6 +440,19 @@ enum net_verdict net_ipv4_input(struct net_pkt *pkt, bool is_loopback)
 		return NET_DROP;
 	}
 
+	/* A reply of a translated connection is addressed to us, but it is
+	 * forwarded to the host that opened the connection.
+	 */
+	if (IS_ENABLED(CONFIG_NET_NAPT) && !is_loopback &&
+	    net_napt_ipv4_input(pkt, hdr)) {
+		verdict = ipv4_route_packet(pkt, hdr, true);
+		if (verdict != NET_DROP) {
+			return verdict;
+		}
+
+		goto drop;
+	}
+
 	if ((!net_ipv4_is_my_addr((struct in_addr *)hdr->dst) &&
 	     !net_ipv4_is_addr_mcast((struct in_addr *)hdr->dst) &&
 	     !(hdr->proto == IPPROTO_UDP &&
@@ -349,7 +464,15 @@ enum net_verdict net_ipv4_input(struct net_pkt *pkt, bool is_loopback)
 		net_dhcpv4_accept_unicast(pkt)))) ||
 	    (hdr->proto == IPPROTO_TCP &&
 	     net_ipv4_is_addr_bcast(net_pkt_iface(pkt), (struct in_addr *)hdr->dst))) {
-		NET_DBG("DROP: not for me");
+		if (!is_loopback && !net_ipv4_is_my_addr((struct in_addr *)hdr->dst)) {
+			verdict = ipv4_route_packet(pkt, hdr, false);
+			if (verdict != NET_DROP) {
+				return verdict;
+			}
+		} else {
+			NET_DBG("DROP: not for me");
+		}
+
 		goto drop;
 	}
 
@@ -317,24 +317,39 @@ static inline void net_ipv4_set_ecn(uint8_t *tos, uint8_t ecn)
 #if defined(CONFIG_NET_IPV4_FRAGMENT)
 /** Store pending IPv4 fragment information that is needed for reassembly. */
 struct net_ipv4_reassembly {
+	/** Node in the reassembly hash table or in the free list */
+	sys_snode_t node;
+
 	/** IPv4 source address of the fragment */
 	struct in_addr src;
 
 	/** IPv4 destination address of the fragment */
 	struct in_addr dst;
 
+	/** Timeout for cancelling the reassembly */
+	struct k_work_delayable timer;
+
 	/**
-	 * Timeout for cancelling the reassembly. The timer is used
-	 * also to detect if this reassembly slot is used or not.
+	 * Pending fragments sorted by offset, linked through the fifo
+	 * field of the packets. The fragments never overlap.
 	 */
-	struct k_work_delayable timer;
+	sys_slist_t frags;
 
-	/** Pointers to pending fragments */
-	struct net_pkt *pkt[CONFIG_NET_IPV4_FRAGMENT_MAX_PKT];
+	/** Number of payload bytes received */
+	uint32_t received;
+
+	/** Payload length of the packet, valid once the last fragment is received */
+	uint32_t total_len;
+
+	/** Number of pending fragments */
+	uint16_t count;
 
 	/** IPv4 fragment identification */
 	uint16_t id;
 	uint8_t protocol;
+
+	/** The last fragment has been received */
+	bool last;
 };
 #else
 struct net_ipv4_reassembly;
@@ -314,6 +314,25 @@ static enum net_verdict ipv6_route_packet(struct net_pkt *pkt,
 	struct in6_addr *nexthop;
 	bool found;
 
+#if defined(CONFIG_NET_IPV6_DST_CACHE)
+	if (!IS_ENABLED(CONFIG_NET_ROUTING) ||
+	    (!net_ipv6_is_ll_addr((struct in6_addr *)hdr->src) &&
+	     !net_ipv6_is_ll_addr((struct in6_addr *)hdr->dst))) {
+		int ret;
+
+		ret = net_route_packet_cached(pkt, (struct in6_addr *)hdr->dst);
+		if (ret == 0) {
+			return NET_OK;
+		}
+
+		if (ret != -ENOENT) {
+			NET_DBG("Cannot re-route pkt %p at iface %p (%d)",
+				pkt, net_pkt_iface(pkt), ret);
+			goto drop;
+		}
+	}
+#endif
+
 	/* Check if the packet can be routed */
 	if (IS_ENABLED(CONFIG_NET_ROUTING)) {
 		found = net_route_get_info(NULL, (struct in6_addr *)hdr->dst,
@@ -784,6 +803,10 @@ void net_ipv6_init(void)
 {
 	net_ipv6_nbr_init();
 
+	if (IS_ENABLED(CONFIG_NET_IPV6_FRAGMENT)) {
+		net_ipv6_setup_fragment_buffers();
+	}
+
 #if defined(CONFIG_NET_IPV6_MLD)
 	net_ipv6_mld_init();
 #endif
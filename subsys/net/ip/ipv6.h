@@ -270,6 +270,62 @@ static inline enum net_verdict net_ipv6_prepare_for_send(struct net_pkt *pkt)
 }
 #endif
 
+#if defined(CONFIG_NET_IPV6_DST_CACHE) && defined(CONFIG_NET_NATIVE_IPV6)
+/**
+ * @brief Find the neighbor that the packets to a destination were last
+ * sent to. The IPv6 neighbor table mutex must be held by the caller.
+ *
+ * @param iface Network interface the packet was at before the route
+ * lookup.
+ * @param dst Destination IPv6 address.
+ *
+ * @return Reachable neighbor having a link layer address, NULL if the
+ * destination is not in the cache.
+ */
+struct net_nbr *net_ipv6_dst_cache_lookup(struct net_if *iface,
+					  const struct in6_addr *dst);
+
+/**
+ * @brief Remember the neighbor that the packets to a destination are sent
+ * to. Nothing is stored if the neighbor is not reachable. The IPv6
+ * neighbor table mutex must be held by the caller.
+ *
+ * @param iface Network interface the packet was at before the route
+ * lookup.
+ * @param dst Destination IPv6 address.
+ * @param nbr Neighbor the packet was sent to.
+ */
+void net_ipv6_dst_cache_add(struct net_if *iface, const struct in6_addr *dst,
+			    struct net_nbr *nbr);
+
+/**
+ * @brief Drop all the entries of the destination cache.
+ */
+void net_ipv6_dst_cache_flush(void);
+#else
+static inline struct net_nbr *net_ipv6_dst_cache_lookup(struct net_if *iface,
+							const struct in6_addr *dst)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(dst);
+
+	return NULL;
+}
+
+static inline void net_ipv6_dst_cache_add(struct net_if *iface,
+					  const struct in6_addr *dst,
+					  struct net_nbr *nbr)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(dst);
+	ARG_UNUSED(nbr);
+}
+
+static inline void net_ipv6_dst_cache_flush(void)
+{
+}
+#endif
+
 /**
  * @brief Lock IPv6 Neighbor table mutex
  *
@@ -443,23 +499,38 @@ static inline void net_ipv6_nbr_set_reachable_timer(struct net_if *iface,
 #if defined(CONFIG_NET_IPV6_FRAGMENT)
 /** Store pending IPv6 fragment information that is needed for reassembly. */
 struct net_ipv6_reassembly {
+	/** Node in the reassembly hash table or in the free list */
+	sys_snode_t node;
+
 	/** IPv6 source address of the fragment */
 	struct in6_addr src;
 
 	/** IPv6 destination address of the fragment */
 	struct in6_addr dst;
 
+	/** Timeout for cancelling the reassembly */
+	struct k_work_delayable timer;
+
 	/**
-	 * Timeout for cancelling the reassembly. The timer is used
-	 * also to detect if this reassembly slot is used or not.
+	 * Pending fragments sorted by offset, linked through the fifo
+	 * field of the packets. The fragments never overlap.
 	 */
-	struct k_work_delayable timer;
+	sys_slist_t frags;
+
+	/** Number of payload bytes received */
+	uint32_t received;
 
-	/** Pointers to pending fragments */
-	struct net_pkt *pkt[CONFIG_NET_IPV6_FRAGMENT_MAX_PKT];
+	/** Payload length of the packet, valid once the last fragment is received */
+	uint32_t total_len;
 
 	/** IPv6 fragment identification */
 	uint32_t id;
+
+	/** Number of pending fragments */
+	uint16_t count;
+
+	/** The last fragment has been received */
+	bool last;
 };
 #else
 struct net_ipv6_reassembly;
@@ -524,6 +595,18 @@ enum net_verdict net_ipv6_handle_fragment_hdr(struct net_pkt *pkt,
 }
 #endif /* CONFIG_NET_IPV6_FRAGMENT */
 
+/**
+ * @brief Sets up fragment buffers for usage, should only be called when
+ * IPv6 is initialized.
+ */
+#if defined(CONFIG_NET_IPV6_FRAGMENT) && defined(CONFIG_NET_NATIVE_IPV6)
+void net_ipv6_setup_fragment_buffers(void);
+#else
+static inline void net_ipv6_setup_fragment_buffers(void)
+{
+}
+#endif /* CONFIG_NET_IPV6_FRAGMENT */
+
 #if defined(CONFIG_NET_NATIVE_IPV6)
 void net_ipv6_init(void);
 void net_ipv6_nbr_init(void);
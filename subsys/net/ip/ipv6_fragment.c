@@ -40,12 +40,23 @@ LOG_MODULE_DECLARE(net_ipv6, CONFIG_NET_IPV6_LOG_LEVEL);
 
 #define FRAG_BUF_WAIT K_MSEC(10) /* how long to max wait for a buffer */
 
-static void reassembly_timeout(struct k_work *work);
-static bool reassembly_init_done;
+/* The fragments of a reassembly are linked through the fifo field of the
+ * packets, which is not used while the packets wait here.
+ */
+#define FRAG_NODE(pkt) ((sys_snode_t *)&(pkt)->fifo)
+#define FRAG_PKT(node) CONTAINER_OF((intptr_t *)(node), struct net_pkt, fifo)
 
 static struct net_ipv6_reassembly
 reassembly[CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT];
 
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_NET_IPV6_FRAGMENT_HASH_SIZE),
+	     "Hash table size must be a power of two");
+
+/* Pending reassemblies hashed by id and addresses, and the unused ones */
+static sys_slist_t reassembly_table[CONFIG_NET_IPV6_FRAGMENT_HASH_SIZE];
+static sys_slist_t reassembly_free;
+static K_MUTEX_DEFINE(reassembly_lock);
+
 int net_ipv6_find_last_ext_hdr(struct net_pkt *pkt, uint16_t *next_hdr_off,
 			       uint16_t *last_hdr_off)
 {
@@ -120,86 +131,99 @@ fail:
 	return -EINVAL;
 }
 
+static inline uint32_t fragment_len(struct net_pkt *pkt)
+{
+	return net_pkt_get_len(pkt) - net_pkt_ipv6_fragment_start(pkt) -
+	       sizeof(struct net_ipv6_frag_hdr);
+}
+
+static sys_slist_t *reassembly_bucket(uint32_t id,
+				      const struct in6_addr *src,
+				      const struct in6_addr *dst)
+{
+	uint32_t hash = id * 0x9e3779b1U;
+
+	for (int i = 0; i < 4; i++) {
+		hash = (hash ^ UNALIGNED_GET(&src->s6_addr32[i])) * 0x9e3779b1U;
+		hash = (hash ^ UNALIGNED_GET(&dst->s6_addr32[i])) * 0x9e3779b1U;
+	}
+
+	return &reassembly_table[(hash >> 16) &
+				 (CONFIG_NET_IPV6_FRAGMENT_HASH_SIZE - 1)];
+}
+
 static struct net_ipv6_reassembly *reassembly_get(uint32_t id,
 						  struct in6_addr *src,
 						  struct in6_addr *dst)
 {
-	int i, avail = -1;
-
-	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
-		if (k_work_delayable_remaining_get(&reassembly[i].timer) &&
-		    reassembly[i].id == id &&
-		    net_ipv6_addr_cmp(src, &reassembly[i].src) &&
-		    net_ipv6_addr_cmp(dst, &reassembly[i].dst)) {
-			return &reassembly[i];
-		}
-
-		if (k_work_delayable_remaining_get(&reassembly[i].timer)) {
-			continue;
-		}
-
-		if (avail < 0) {
-			avail = i;
+	sys_slist_t *bucket = reassembly_bucket(id, src, dst);
+	struct net_ipv6_reassembly *reass;
+	sys_snode_t *node;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(bucket, reass, node) {
+		if (reass->id == id &&
+		    net_ipv6_addr_cmp(src, &reass->src) &&
+		    net_ipv6_addr_cmp(dst, &reass->dst)) {
+			return reass;
 		}
 	}
 
-	if (avail < 0) {
+	node = sys_slist_get(&reassembly_free);
+	if (!node) {
 		return NULL;
 	}
 
-	k_work_reschedule(&reassembly[avail].timer, IPV6_REASSEMBLY_TIMEOUT);
+	reass = CONTAINER_OF(node, struct net_ipv6_reassembly, node);
 
-	net_ipaddr_copy(&reassembly[avail].src, src);
-	net_ipaddr_copy(&reassembly[avail].dst, dst);
+	k_work_reschedule(&reass->timer, IPV6_REASSEMBLY_TIMEOUT);
 
-	reassembly[avail].id = id;
+	net_ipaddr_copy(&reass->src, src);
+	net_ipaddr_copy(&reass->dst, dst);
 
-	return &reassembly[avail];
-}
+	reass->id = id;
+	reass->received = 0U;
+	reass->total_len = 0U;
+	reass->count = 0U;
+	reass->last = false;
 
-static bool reassembly_cancel(uint32_t id,
-			      struct in6_addr *src,
-			      struct in6_addr *dst)
-{
-	int i, j;
+	sys_slist_prepend(bucket, &reass->node);
 
-	NET_DBG("Cancel 0x%x", id);
+	return reass;
+}
 
-	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
-		int32_t remaining;
+/* Remove the reassembly from the table and hand its fragments to the
+ * caller. Must be called with the reassembly lock held.
+ */
+static void reassembly_release(struct net_ipv6_reassembly *reass,
+			       sys_slist_t *frags)
+{
+	NET_DBG("Release 0x%x", reass->id);
 
-		if (reassembly[i].id != id ||
-		    !net_ipv6_addr_cmp(src, &reassembly[i].src) ||
-		    !net_ipv6_addr_cmp(dst, &reassembly[i].dst)) {
-			continue;
-		}
+	k_work_cancel_delayable(&reass->timer);
 
-		remaining = k_ticks_to_ms_ceil32(
-			k_work_delayable_remaining_get(&reassembly[i].timer));
-		k_work_cancel_delayable(&reassembly[i].timer);
+	(void)sys_slist_find_and_remove(reassembly_bucket(reass->id,
+							  &reass->src,
+							  &reass->dst),
+					&reass->node);
 
-		NET_DBG("IPv6 reassembly id 0x%x remaining %d ms",
-			reassembly[i].id, remaining);
+	*frags = reass->frags;
+	sys_slist_init(&reass->frags);
 
-		reassembly[i].id = 0U;
+	sys_slist_prepend(&reassembly_free, &reass->node);
+}
 
-		for (j = 0; j < CONFIG_NET_IPV6_FRAGMENT_MAX_PKT; j++) {
-			if (!reassembly[i].pkt[j]) {
-				continue;
-			}
+static void fragments_unref(sys_slist_t *frags)
+{
+	sys_snode_t *node;
 
-			NET_DBG("[%d] IPv6 reassembly pkt %p %zd bytes data",
-				j, reassembly[i].pkt[j],
-				net_pkt_get_len(reassembly[i].pkt[j]));
+	while ((node = sys_slist_get(frags)) != NULL) {
+		struct net_pkt *pkt = FRAG_PKT(node);
 
-			net_pkt_unref(reassembly[i].pkt[j]);
-			reassembly[i].pkt[j] = NULL;
-		}
+		NET_DBG("IPv6 reassembly pkt %p %zd bytes data",
+			pkt, net_pkt_get_len(pkt));
 
-		return true;
+		net_pkt_unref(pkt);
 	}
-
-	return false;
 }
 
 static void reassembly_info(char *str, struct net_ipv6_reassembly *reass)
@@ -216,18 +240,35 @@ static void reassembly_timeout(struct k_work *work)
 	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
 	struct net_ipv6_reassembly *reass =
 		CONTAINER_OF(dwork, struct net_ipv6_reassembly, timer);
+	struct net_pkt *first;
+	sys_slist_t frags;
+
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
+
+	/* The reassembly might have been completed, or even started again
+	 * for another packet, while we were waiting for the lock.
+	 */
+	if (sys_slist_is_empty(&reass->frags) ||
+	    k_work_delayable_remaining_get(dwork) > 0) {
+		k_mutex_unlock(&reassembly_lock);
+		return;
+	}
 
 	reassembly_info("Reassembly cancelled", reass);
+	reassembly_release(reass, &frags);
+
+	k_mutex_unlock(&reassembly_lock);
 
 	/* Send a ICMPv6 Time Exceeded only if we received the first fragment (RFC 2460 Sec. 5) */
-	if (reass->pkt[0] && net_pkt_ipv6_fragment_offset(reass->pkt[0]) == 0) {
-		net_icmpv6_send_error(reass->pkt[0], NET_ICMPV6_TIME_EXCEEDED, 1, 0);
+	first = FRAG_PKT(sys_slist_peek_head(&frags));
+	if (net_pkt_ipv6_fragment_offset(first) == 0) {
+		net_icmpv6_send_error(first, NET_ICMPV6_TIME_EXCEEDED, 1, 0);
 	}
 
-	reassembly_cancel(reass->id, &reass->src, &reass->dst);
+	fragments_unref(&frags);
 }
 
-static void reassemble_packet(struct net_ipv6_reassembly *reass)
+static void reassemble_packet(sys_slist_t *frags)
 {
 	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv6_access, struct net_ipv6_hdr);
 	NET_PKT_DATA_ACCESS_DEFINE(frag_access, struct net_ipv6_frag_hdr);
@@ -236,27 +277,23 @@ static void reassemble_packet(struct net_ipv6_reassembly *reass)
 		struct net_ipv6_frag_hdr *frag_hdr;
 	} ipv6;
 
+	struct net_pkt *first;
 	struct net_pkt *pkt;
 	struct net_buf *last;
+	sys_snode_t *node;
 	uint8_t next_hdr;
-	int i, len;
-
-	k_work_cancel_delayable(&reass->timer);
+	int len;
 
-	NET_ASSERT(reass->pkt[0]);
-
-	last = net_buf_frag_last(reass->pkt[0]->buffer);
+	first = FRAG_PKT(sys_slist_get(frags));
+	last = net_buf_frag_last(first->buffer);
 
 	/* We start from 2nd packet which is then appended to
 	 * the first one.
 	 */
-	for (i = 1; i < CONFIG_NET_IPV6_FRAGMENT_MAX_PKT; i++) {
+	while ((node = sys_slist_get(frags)) != NULL) {
 		int removed_len;
 
-		pkt = reass->pkt[i];
-		if (!pkt) {
-			break;
-		}
+		pkt = FRAG_PKT(node);
 
 		net_pkt_cursor_init(pkt);
 
@@ -271,8 +308,9 @@ static void reassemble_packet(struct net_ipv6_reassembly *reass)
 
 		if (net_pkt_pull(pkt, removed_len)) {
 			NET_ERR("Failed to pull headers");
-			reassembly_cancel(reass->id, &reass->src, &reass->dst);
-			return;
+			net_pkt_unref(pkt);
+			fragments_unref(frags);
+			goto error;
 		}
 
 		/* Attach the data to previous pkt */
@@ -280,13 +318,11 @@ static void reassemble_packet(struct net_ipv6_reassembly *reass)
 		last = net_buf_frag_last(pkt->buffer);
 
 		pkt->buffer = NULL;
-		reass->pkt[i] = NULL;
 
 		net_pkt_unref(pkt);
 	}
 
-	pkt = reass->pkt[0];
-	reass->pkt[0] = NULL;
+	pkt = first;
 
 	/* Next we need to strip away the fragment header from the first packet
 	 * and set the various pointers and values in packet.
@@ -353,133 +389,125 @@ static void reassemble_packet(struct net_ipv6_reassembly *reass)
 		return;
 	}
 error:
-	net_pkt_unref(pkt);
+	net_pkt_unref(first);
 }
 
 void net_ipv6_frag_foreach(net_ipv6_frag_cb_t cb, void *user_data)
 {
-	int i;
+	struct net_ipv6_reassembly *reass;
 
-	for (i = 0; reassembly_init_done &&
-		     i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
-		if (!k_work_delayable_remaining_get(&reassembly[i].timer)) {
-			continue;
-		}
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
 
-		cb(&reassembly[i], user_data);
+	ARRAY_FOR_EACH(reassembly_table, i) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&reassembly_table[i], reass, node) {
+			cb(reass, user_data);
+		}
 	}
+
+	k_mutex_unlock(&reassembly_lock);
 }
 
-/* Verify that we have all the fragments received and in correct order.
+/* Insert a fragment into the list of the reassembly, which is kept sorted
+ * by offset. Fragments mostly arrive in order so the tail of the list is
+ * checked first. According to RFC 8200 overlapping fragments discard the
+ * whole packet, exact duplicates that can be produced by the network are
+ * ignored instead (RFC 5722).
  * Return:
- * - a negative value if the fragments are erroneous and must be dropped
- * - zero if we are expecting more fragments
- * - a positive value if we can proceed with the reassembly
+ * - zero if the fragment was inserted
+ * - -EALREADY if the fragment is a duplicate of an already received one
+ * - other negative value if the fragments are erroneous and must be dropped
  */
-static int fragments_are_ready(struct net_ipv6_reassembly *reass)
+static int fragment_insert(struct net_ipv6_reassembly *reass,
+			   struct net_pkt *pkt, uint32_t offset, uint32_t len)
 {
-	unsigned int expected_offset = 0;
-	bool more = true;
-	int i;
-
-	/* Fragments can arrive in any order, for example in reverse order:
-	 *   1 -> Fragment3(M=0, offset=x2)
-	 *   2 -> Fragment2(M=1, offset=x1)
-	 *   3 -> Fragment1(M=1, offset=0)
-	 * We have to test several requirements before proceeding with the reassembly:
-	 * - We received the first fragment (Fragment Offset is 0)
-	 * - All intermediate fragments are contiguous
-	 * - The More bit of the last fragment is 0
-	 */
-	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_PKT; i++) {
-		struct net_pkt *pkt = reass->pkt[i];
-		unsigned int offset;
-		int payload_len;
+	bool more = net_pkt_ipv6_fragment_more(pkt);
+	uint32_t end = offset + len;
+	sys_snode_t *prev = NULL;
+	sys_snode_t *next;
+
+	if (reass->last && (end > reass->total_len ||
+			    (!more && end != reass->total_len))) {
+		return -EBADMSG;
+	}
+
+	next = sys_slist_peek_tail(&reass->frags);
+	if (next && net_pkt_ipv6_fragment_offset(FRAG_PKT(next)) <= offset) {
+		prev = next;
+	} else {
+		SYS_SLIST_FOR_EACH_NODE(&reass->frags, next) {
+			if (net_pkt_ipv6_fragment_offset(FRAG_PKT(next)) > offset) {
+				break;
+			}
 
-		if (!pkt) {
-			break;
+			prev = next;
 		}
+	}
 
-		offset = net_pkt_ipv6_fragment_offset(pkt);
+	if (prev) {
+		struct net_pkt *prev_pkt = FRAG_PKT(prev);
+		uint32_t prev_offset = net_pkt_ipv6_fragment_offset(prev_pkt);
+		uint32_t prev_end = prev_offset + fragment_len(prev_pkt);
 
-		if (offset < expected_offset) {
-			/* Overlapping or duplicated
-			 * According to RFC8200 we can drop it
-			 */
-			return -EBADMSG;
-		} else if (offset != expected_offset) {
-			/* Not contiguous, let's wait for fragments */
-			return 0;
+		if (prev_offset == offset && prev_end == end) {
+			return -EALREADY;
 		}
 
-		payload_len = net_pkt_get_len(pkt) - net_pkt_ipv6_fragment_start(pkt);
-		payload_len -= sizeof(struct net_ipv6_frag_hdr);
-		if (payload_len < 0) {
+		if (prev_end > offset) {
 			return -EBADMSG;
 		}
-
-		expected_offset += payload_len;
-		more = net_pkt_ipv6_fragment_more(pkt);
 	}
 
-	if (more) {
-		return 0;
+	next = prev ? sys_slist_peek_next(prev) :
+		      sys_slist_peek_head(&reass->frags);
+	if (next && (end > net_pkt_ipv6_fragment_offset(FRAG_PKT(next)) ||
+		     !more)) {
+		/* Overlapping, or data after the last fragment */
+		return -EBADMSG;
 	}
 
-	return 1;
-}
-
-static int shift_packets(struct net_ipv6_reassembly *reass, int pos)
-{
-	int i;
+	if (reass->count >= CONFIG_NET_IPV6_FRAGMENT_MAX_PKT) {
+		return -ENOMEM;
+	}
 
-	for (i = pos + 1; i < CONFIG_NET_IPV6_FRAGMENT_MAX_PKT; i++) {
-		if (!reass->pkt[i]) {
-			NET_DBG("Moving [%d] %p (offset 0x%x) to [%d]",
-				pos, reass->pkt[pos],
-				net_pkt_ipv6_fragment_offset(reass->pkt[pos]),
-				pos + 1);
+	NET_DBG("Storing pkt %p offset %d", pkt, offset);
 
-			/* pkt[i] is free, so shift everything between
-			 * [pos] and [i - 1] by one element
-			 */
-			memmove(&reass->pkt[pos + 1], &reass->pkt[pos],
-				sizeof(void *) * (i - pos));
+	if (prev) {
+		sys_slist_insert(&reass->frags, prev, FRAG_NODE(pkt));
+	} else {
+		sys_slist_prepend(&reass->frags, FRAG_NODE(pkt));
+	}
 
-			/* pkt[pos] is now free */
-			reass->pkt[pos] = NULL;
+	reass->count++;
+	reass->received += len;
 
-			return 0;
-		}
+	if (!more) {
+		reass->total_len = end;
+		reass->last = true;
 	}
 
-	/* We do not have free space left in the array */
-	return -ENOMEM;
+	return 0;
+}
+
+/* The fragments do not overlap, so once the last fragment is received the
+ * packet is complete when the sum of the fragment lengths is the packet
+ * length.
+ */
+static inline bool fragments_are_ready(struct net_ipv6_reassembly *reass)
+{
+	return reass->last && reass->received == reass->total_len;
 }
 
 enum net_verdict net_ipv6_handle_fragment_hdr(struct net_pkt *pkt,
 					      struct net_ipv6_hdr *hdr,
 					      uint8_t nexthdr)
 {
-	struct net_ipv6_reassembly *reass = NULL;
+	struct net_ipv6_reassembly *reass;
+	sys_slist_t frags;
+	uint32_t offset;
+	uint32_t len;
 	uint16_t flag;
-	bool found;
-	uint8_t more;
 	uint32_t id;
 	int ret;
-	int i;
-
-	if (!reassembly_init_done) {
-		/* Static initializing does not work here because of the array
-		 * so we must do it at runtime.
-		 */
-		for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
-			k_work_init_delayable(&reassembly[i].timer,
-					      reassembly_timeout);
-		}
-
-		reassembly_init_done = true;
-	}
 
 	/* Each fragment has a fragment header, however since we already
 	 * read the nexthdr part of it, we are not going to use
@@ -489,99 +517,91 @@ enum net_verdict net_ipv6_handle_fragment_hdr(struct net_pkt *pkt,
 	if (net_pkt_skip(pkt, 1) || /* reserved */
 	    net_pkt_read_be16(pkt, &flag) ||
 	    net_pkt_read_be32(pkt, &id)) {
-		goto drop;
-	}
-
-	reass = reassembly_get(id, (struct in6_addr *)hdr->src,
-			       (struct in6_addr *)hdr->dst);
-	if (!reass) {
-		NET_DBG("Cannot get reassembly slot, dropping pkt %p", pkt);
-		goto drop;
+		return NET_DROP;
 	}
 
-	more = flag & 0x01;
 	net_pkt_set_ipv6_fragment_flags(pkt, flag);
 
-	if (more && net_pkt_get_len(pkt) % 8) {
+	if (net_pkt_ipv6_fragment_more(pkt) && net_pkt_get_len(pkt) % 8) {
 		/* Fragment length is not multiple of 8, discard
 		 * the packet and send parameter problem error with the
 		 * offset of the "Payload Length" field in the IPv6 header.
 		 */
 		net_icmpv6_send_error(pkt, NET_ICMPV6_PARAM_PROBLEM,
 				      NET_ICMPV6_PARAM_PROB_HEADER, NET_IPV6H_LENGTH_OFFSET);
-		goto drop;
+		return NET_DROP;
 	}
 
-	/* The fragments might come in wrong order so place them
-	 * in reassembly chain in correct order.
-	 */
-	for (i = 0, found = false; i < CONFIG_NET_IPV6_FRAGMENT_MAX_PKT; i++) {
-		if (reass->pkt[i]) {
-			if (net_pkt_ipv6_fragment_offset(reass->pkt[i]) <
-			    net_pkt_ipv6_fragment_offset(pkt)) {
-				continue;
-			}
-
-			/* Make room for this fragment. If there is no room,
-			 * then it will discard the whole reassembly.
-			 */
-			if (shift_packets(reass, i)) {
-				break;
-			}
-		}
+	if (net_pkt_get_len(pkt) < net_pkt_ipv6_fragment_start(pkt) +
+				   sizeof(struct net_ipv6_frag_hdr)) {
+		return NET_DROP;
+	}
 
-		NET_DBG("Storing pkt %p to slot %d offset %d",
-			pkt, i, net_pkt_ipv6_fragment_offset(pkt));
-		reass->pkt[i] = pkt;
-		found = true;
+	offset = net_pkt_ipv6_fragment_offset(pkt);
+	len = fragment_len(pkt);
 
-		break;
+	/* The reassembled payload must fit the IPv6 payload length field */
+	if (net_pkt_ipv6_fragment_start(pkt) - NET_IPV6H_LEN + offset + len >
+	    UINT16_MAX) {
+		NET_DBG("Fragment past the maximum IPv6 length, dropping pkt %p",
+			pkt);
+		return NET_DROP;
 	}
 
-	if (!found) {
-		/* We could not add this fragment into our saved fragment
-		 * list. We must discard the whole packet at this point.
-		 */
-		NET_DBG("No slots available for 0x%x", reass->id);
-		net_pkt_unref(pkt);
-		goto drop;
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
+
+	reass = reassembly_get(id, (struct in6_addr *)hdr->src,
+			       (struct in6_addr *)hdr->dst);
+	if (!reass) {
+		k_mutex_unlock(&reassembly_lock);
+		NET_DBG("Cannot get reassembly slot, dropping pkt %p", pkt);
+		return NET_DROP;
 	}
 
-	ret = fragments_are_ready(reass);
-	if (ret < 0) {
-		NET_DBG("Reassembled IPv6 verify failed, dropping id %u",
-			reass->id);
+	ret = fragment_insert(reass, pkt, offset, len);
+	if (ret == -EALREADY) {
+		k_mutex_unlock(&reassembly_lock);
+		NET_DBG("Duplicate fragment offset %d for 0x%x", offset, id);
+		return NET_DROP;
+	} else if (ret < 0) {
+		/* We must discard the whole packet at this point */
+		NET_DBG("Reassembled IPv6 verify failed (%d), dropping id %u",
+			ret, id);
+		reassembly_release(reass, &frags);
+		k_mutex_unlock(&reassembly_lock);
 
-		/* Let the caller release the already inserted pkt */
-		if (i < CONFIG_NET_IPV6_FRAGMENT_MAX_PKT) {
-			reass->pkt[i] = NULL;
-		}
+		fragments_unref(&frags);
+		return NET_DROP;
+	}
 
-		net_pkt_unref(pkt);
-		goto drop;
-	} else if (ret == 0) {
+	if (!fragments_are_ready(reass)) {
 		reassembly_info("Reassembly nth pkt", reass);
+		k_mutex_unlock(&reassembly_lock);
 
 		NET_DBG("More fragments to be received");
-		goto accept;
+		return NET_OK;
 	}
 
 	reassembly_info("Reassembly last pkt", reass);
+	reassembly_release(reass, &frags);
+
+	k_mutex_unlock(&reassembly_lock);
 
 	/* The last fragment received, reassemble the packet */
-	reassemble_packet(reass);
+	reassemble_packet(&frags);
 
-accept:
 	return NET_OK;
+}
 
-drop:
-	if (reass) {
-		if (reassembly_cancel(reass->id, &reass->src, &reass->dst)) {
-			return NET_OK;
-		}
+void net_ipv6_setup_fragment_buffers(void)
+{
+	/* Static initializing does not work here because of the array
+	 * so we must do it at runtime.
+	 */
+	for (int i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
+		k_work_init_delayable(&reassembly[i].timer, reassembly_timeout);
+		sys_slist_append(&reassembly_free, &reassembly[i].node);
 	}
-
-	return NET_DROP;
 }
 
 #define BUF_ALLOC_TIMEOUT K_MSEC(100)
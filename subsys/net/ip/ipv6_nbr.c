@@ -735,6 +735,152 @@ static inline bool dad_failed(struct net_if *iface, struct in6_addr *addr)
 #endif /* CONFIG_NET_IPV6_DAD */
 
 #if defined(CONFIG_NET_IPV6_NBR_CACHE)
+#if defined(CONFIG_NET_IPV6_DST_CACHE)
+/* Destination cache entry, valid only while the generation matches. The
+ * neighbor address and interface are stored so that a neighbor entry
+ * that got reused for another address is not taken for the old one
+ * before the change notification has been processed.
+ */
+struct ipv6_dst_entry {
+	struct in6_addr dst;
+	struct in6_addr nexthop;
+	struct net_if *iface;
+	struct net_if *nbr_iface;
+	struct net_nbr *nbr;
+	atomic_val_t gen;
+};
+
+static struct ipv6_dst_entry dst_cache[CONFIG_NET_IPV6_DST_CACHE_SIZE];
+
+/* Generation 0 is never used, so the unused entries are invalid */
+static atomic_t dst_cache_gen = ATOMIC_INIT(1);
+
+static struct net_mgmt_event_callback dst_cache_ipv6_cb;
+static struct net_mgmt_event_callback dst_cache_if_cb;
+
+/* The interface is part of the key, so that a forwarded packet does not
+ * evict the entry created when it is sent out from the other interface.
+ */
+static inline struct ipv6_dst_entry *dst_cache_entry(struct net_if *iface,
+						     const struct in6_addr *dst)
+{
+	uint32_t hash = UNALIGNED_GET(&dst->s6_addr32[0]) ^
+			UNALIGNED_GET(&dst->s6_addr32[1]) ^
+			UNALIGNED_GET(&dst->s6_addr32[2]) ^
+			UNALIGNED_GET(&dst->s6_addr32[3]) ^
+			(uint32_t)POINTER_TO_UINT(iface);
+
+	/* Multiplicative hashing mixes all the bits to the top ones */
+	hash *= 2654435761U;
+
+	return &dst_cache[(hash >> 16) % ARRAY_SIZE(dst_cache)];
+}
+
+static bool dst_cache_nbr_usable(struct net_nbr *nbr)
+{
+	if (nbr->ref == 0 || nbr->idx == NET_NBR_LLADDR_UNKNOWN) {
+		return false;
+	}
+
+	/* Sending to a neighbor in other states than these changes its
+	 * state, see RFC 4861 ch 7.3.3, so those go through the normal path.
+	 */
+	if (IS_ENABLED(CONFIG_NET_IPV6_ND) &&
+	    net_ipv6_nbr_data(nbr)->state != NET_IPV6_NBR_STATE_REACHABLE &&
+	    net_ipv6_nbr_data(nbr)->state != NET_IPV6_NBR_STATE_STATIC) {
+		return false;
+	}
+
+	return true;
+}
+
+struct net_nbr *net_ipv6_dst_cache_lookup(struct net_if *iface,
+					  const struct in6_addr *dst)
+{
+	struct ipv6_dst_entry *entry = dst_cache_entry(iface, dst);
+	struct net_nbr *nbr = entry->nbr;
+
+	if (entry->gen != atomic_get(&dst_cache_gen) ||
+	    entry->iface != iface || !net_ipv6_addr_cmp(&entry->dst, dst)) {
+		return NULL;
+	}
+
+	if (!dst_cache_nbr_usable(nbr) || nbr->iface != entry->nbr_iface ||
+	    !net_ipv6_addr_cmp(&net_ipv6_nbr_data(nbr)->addr, &entry->nexthop)) {
+		entry->gen = 0;
+		return NULL;
+	}
+
+	return nbr;
+}
+
+void net_ipv6_dst_cache_add(struct net_if *iface, const struct in6_addr *dst,
+			    struct net_nbr *nbr)
+{
+	struct ipv6_dst_entry *entry;
+
+	if (!dst_cache_nbr_usable(nbr)) {
+		return;
+	}
+
+	entry = dst_cache_entry(iface, dst);
+
+	net_ipv6_addr_copy_raw((uint8_t *)&entry->dst, (const uint8_t *)dst);
+	net_ipv6_addr_copy_raw((uint8_t *)&entry->nexthop,
+			       (uint8_t *)&net_ipv6_nbr_data(nbr)->addr);
+	entry->iface = iface;
+	entry->nbr_iface = nbr->iface;
+	entry->nbr = nbr;
+	entry->gen = atomic_get(&dst_cache_gen);
+}
+
+void net_ipv6_dst_cache_flush(void)
+{
+	if (atomic_inc(&dst_cache_gen) == -1) {
+		/* Skip the generation of the unused entries */
+		atomic_inc(&dst_cache_gen);
+	}
+}
+
+static void dst_cache_event_handler(struct net_mgmt_event_callback *cb,
+				    uint32_t mgmt_event, struct net_if *iface)
+{
+	ARG_UNUSED(cb);
+	ARG_UNUSED(iface);
+
+	NET_DBG("Flush destination cache, event 0x%08x", mgmt_event);
+
+	net_ipv6_dst_cache_flush();
+}
+
+static void dst_cache_init(void)
+{
+	/* The command codes are not bit masks, so ORing them together
+	 * subscribes to other IPv6 events too. Those are rare and an extra
+	 * flush is harmless.
+	 */
+	net_mgmt_init_event_callback(&dst_cache_ipv6_cb,
+				     dst_cache_event_handler,
+				     NET_EVENT_IPV6_ADDR_ADD |
+				     NET_EVENT_IPV6_ADDR_DEL |
+				     NET_EVENT_IPV6_PREFIX_ADD |
+				     NET_EVENT_IPV6_PREFIX_DEL |
+				     NET_EVENT_IPV6_ROUTER_ADD |
+				     NET_EVENT_IPV6_ROUTER_DEL |
+				     NET_EVENT_IPV6_ROUTE_ADD |
+				     NET_EVENT_IPV6_ROUTE_DEL |
+				     NET_EVENT_IPV6_NBR_ADD |
+				     NET_EVENT_IPV6_NBR_DEL);
+	net_mgmt_add_event_callback(&dst_cache_ipv6_cb);
+
+	net_mgmt_init_event_callback(&dst_cache_if_cb, dst_cache_event_handler,
+				     NET_EVENT_IF_DOWN);
+	net_mgmt_add_event_callback(&dst_cache_if_cb);
+}
+#else
+#define dst_cache_init(...)
+#endif /* CONFIG_NET_IPV6_DST_CACHE */
+
 static struct in6_addr *check_route(struct net_if *iface,
 				    struct in6_addr *dst,
 				    bool *try_route)
@@ -791,6 +937,7 @@ static struct in6_addr *check_route(struct net_if *iface,
 enum net_verdict net_ipv6_prepare_for_send(struct net_pkt *pkt)
 {
 	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv6_access, struct net_ipv6_hdr);
+	struct net_if *cache_iface = net_pkt_iface(pkt);
 	struct in6_addr *nexthop = NULL;
 	struct net_if *iface = NULL;
 	struct net_ipv6_hdr *ip_hdr;
@@ -863,6 +1010,28 @@ ignore_frag_error:
 		return NET_OK;
 	}
 
+	if (IS_ENABLED(CONFIG_NET_IPV6_DST_CACHE)) {
+		net_ipv6_nbr_lock();
+
+		nbr = net_ipv6_dst_cache_lookup(cache_iface,
+						(struct in6_addr *)ip_hdr->dst);
+		if (nbr) {
+			struct net_linkaddr_storage *lladdr;
+
+			lladdr = net_nbr_get_lladdr(nbr->idx);
+
+			net_pkt_lladdr_dst(pkt)->addr = lladdr->addr;
+			net_pkt_lladdr_dst(pkt)->len = lladdr->len;
+
+			net_pkt_set_iface(pkt, nbr->iface);
+
+			net_ipv6_nbr_unlock();
+			return NET_OK;
+		}
+
+		net_ipv6_nbr_unlock();
+	}
+
 	if (net_if_ipv6_addr_onlink(&iface, (struct in6_addr *)ip_hdr->dst)) {
 		nexthop = (struct in6_addr *)ip_hdr->dst;
 		net_pkt_set_iface(pkt, iface);
@@ -943,6 +1112,12 @@ try_send:
 							DELAY_FIRST_PROBE_TIME);
 		}
 #endif
+		if (nbr->iface == net_pkt_iface(pkt)) {
+			net_ipv6_dst_cache_add(cache_iface,
+					       (struct in6_addr *)ip_hdr->dst,
+					       nbr);
+		}
+
 		net_ipv6_nbr_unlock();
 		return NET_OK;
 	}
@@ -2731,6 +2906,8 @@ void net_ipv6_nbr_init(void)
 	}
 
 	k_work_init_delayable(&ipv6_ns_reply_timer, ipv6_ns_reply_timeout);
+
+	dst_cache_init();
 #endif
 #if defined(CONFIG_NET_IPV6_ND)
 	ret = net_icmp_init_ctx(&ra_ctx, NET_ICMPV6_RA, 0, handle_ra_input);
@@ -1867,9 +1867,14 @@ static void set_pkt_txtime(struct net_pkt *pkt, const struct msghdr *msghdr)
 	}
 }
 
+/* If frags is not NULL, then the data is sent from the given fragments
+ * without copying it. The fragments that were sent are removed from the
+ * chain, on failure the chain is left as it was.
+ */
 static int context_sendto(struct net_context *context,
 			  const void *buf,
 			  size_t len,
+			  struct net_buf **frags,
 			  const struct sockaddr *dst_addr,
 			  socklen_t addrlen,
 			  net_context_send_cb_t cb,
@@ -1899,6 +1904,16 @@ static int context_sendto(struct net_context *context,
 		return -EDESTADDRREQ;
 	}
 
+	if (frags != NULL) {
+		if ((net_context_get_proto(context) != IPPROTO_UDP &&
+		     net_context_get_proto(context) != IPPROTO_TCP) ||
+		    net_if_is_ip_offloaded(net_context_get_iface(context))) {
+			return -EOPNOTSUPP;
+		}
+
+		len = net_buf_frags_len(*frags);
+	}
+
 	/* Are we trying to send IPv4 packet to mapped V6 address, in that case
 	 * we need to set the family to AF_INET so that various checks below
 	 * are done to the packet correctly and we actually send an IPv4 pkt.
@@ -2119,15 +2134,31 @@ static int context_sendto(struct net_context *context,
 		goto skip_alloc;
 	}
 
-	pkt = context_alloc_pkt(context, family, len, PKT_WAIT_TIME);
+	/* Only the headers are allocated if the caller supplies the data */
+	pkt = context_alloc_pkt(context, family, frags ? 0 : len, PKT_WAIT_TIME);
 	if (!pkt) {
 		NET_ERR("Failed to allocate net_pkt");
 		return -ENOBUFS;
 	}
 
-	tmp_len = net_pkt_available_payload_buffer(
+	if (frags != NULL) {
+		bool can_fragment =
+			(family == AF_INET && IS_ENABLED(CONFIG_NET_IPV4_FRAGMENT)) ||
+			(family == AF_INET6 && IS_ENABLED(CONFIG_NET_IPV6_FRAGMENT));
+
+		tmp_len = net_if_get_mtu(net_context_get_iface(context)) -
+			  (family == AF_INET6 ? NET_IPV6UDPH_LEN : NET_IPV4UDPH_LEN);
+		if (!can_fragment && tmp_len < len) {
+			NET_ERR("Datagram (%zu) does not fit MTU", len);
+			ret = -EMSGSIZE;
+			goto fail;
+		}
+	} else {
+		tmp_len = net_pkt_available_payload_buffer(
 				pkt, net_context_get_proto(context));
-	if (tmp_len < len) {
+	}
+
+	if (frags == NULL && tmp_len < len) {
 		if (net_context_get_type(context) == SOCK_DGRAM) {
 			NET_ERR("Available payload buffer (%zu) is not enough for requested DGRAM (%zu)",
 				tmp_len, len);
@@ -2178,19 +2209,36 @@ skip_alloc:
 		}
 	} else if (IS_ENABLED(CONFIG_NET_UDP) &&
 	    net_context_get_proto(context) == IPPROTO_UDP) {
-		ret = context_setup_udp_packet(context, family, pkt, buf, len, msghdr,
+		ret = context_setup_udp_packet(context, family, pkt, buf,
+					       frags ? 0 : len, msghdr,
 					       dst_addr, addrlen);
 		if (ret < 0) {
 			goto fail;
 		}
 
+		/* The extra reference keeps the fragments for the caller if
+		 * the packet cannot be sent.
+		 */
+		if (frags != NULL) {
+			net_pkt_append_buffer(pkt, net_buf_ref(*frags));
+		}
+
 		context_finalize_packet(context, family, pkt);
 
 		ret = net_send_data(pkt);
+		if (frags != NULL && ret >= 0) {
+			net_buf_unref(*frags);
+			*frags = NULL;
+		}
 	} else if (IS_ENABLED(CONFIG_NET_TCP) &&
 		   net_context_get_proto(context) == IPPROTO_TCP) {
 
-		ret = net_tcp_queue(context, buf, len, msghdr);
+		if (frags != NULL) {
+			ret = net_tcp_queue_buf(context, frags);
+		} else {
+			ret = net_tcp_queue(context, buf, len, msghdr);
+		}
+
 		if (ret < 0) {
 			goto fail;
 		}
@@ -2291,7 +2339,7 @@ int net_context_send(struct net_context *context,
 		addrlen = 0;
 	}
 
-	ret = context_sendto(context, buf, len, &context->remote,
+	ret = context_sendto(context, buf, len, NULL, &context->remote,
 			     addrlen, cb, timeout, user_data, false);
 unlock:
 	k_mutex_unlock(&context->lock);
@@ -2310,7 +2358,7 @@ int net_context_sendmsg(struct net_context *context,
 
 	k_mutex_lock(&context->lock, K_FOREVER);
 
-	ret = context_sendto(context, msghdr, 0, NULL, 0,
+	ret = context_sendto(context, msghdr, 0, NULL, NULL, 0,
 			     cb, timeout, user_data, true);
 
 	k_mutex_unlock(&context->lock);
@@ -2331,7 +2379,7 @@ int net_context_sendto(struct net_context *context,
 
 	k_mutex_lock(&context->lock, K_FOREVER);
 
-	ret = context_sendto(context, buf, len, dst_addr, addrlen,
+	ret = context_sendto(context, buf, len, NULL, dst_addr, addrlen,
 			     cb, timeout, user_data, true);
 
 	k_mutex_unlock(&context->lock);
@@ -2339,6 +2387,41 @@ int net_context_sendto(struct net_context *context,
 	return ret;
 }
 
+int net_context_sendto_buf(struct net_context *context,
+			   struct net_buf **data,
+			   const struct sockaddr *dst_addr,
+			   socklen_t addrlen,
+			   net_context_send_cb_t cb,
+			   k_timeout_t timeout,
+			   void *user_data)
+{
+	int ret;
+
+	if (data == NULL || *data == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&context->lock, K_FOREVER);
+
+	if (dst_addr == NULL) {
+		if (!(context->flags & NET_CONTEXT_REMOTE_ADDR_SET)) {
+			ret = -EDESTADDRREQ;
+			goto unlock;
+		}
+
+		dst_addr = &context->remote;
+		addrlen = (net_context_get_family(context) == AF_INET6) ?
+			  sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+	}
+
+	ret = context_sendto(context, NULL, 0, data, dst_addr, addrlen,
+			     cb, timeout, user_data, true);
+unlock:
+	k_mutex_unlock(&context->lock);
+
+	return ret;
+}
+
 enum net_verdict net_context_packet_received(struct net_conn *conn,
 					     struct net_pkt *pkt,
 					     union net_ip_header *ip_hdr,
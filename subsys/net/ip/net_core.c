@@ -48,6 +48,7 @@ LOG_MODULE_REGISTER(net_core, CONFIG_NET_CORE_LOG_LEVEL);
 #include "dhcpv6/dhcpv6_internal.h"
 
 #include "route.h"
+#include "conntrack.h"
 
 #include "packet_socket.h"
 #include "canbus_socket.h"
@@ -463,7 +464,7 @@ void net_process_rx_packet(struct net_pkt *pkt)
 	net_rx(net_pkt_iface(pkt), pkt);
 }
 
-static void net_queue_rx(struct net_if *iface, struct net_pkt *pkt)
+static uint8_t net_rx_classify(struct net_if *iface, struct net_pkt *pkt)
 {
 	uint8_t prio = net_pkt_priority(pkt);
 	uint8_t tc = net_rx_priority2tc(prio);
@@ -472,12 +473,21 @@ static void net_queue_rx(struct net_if *iface, struct net_pkt *pkt)
 	net_stats_update_tc_recv_pkt(iface, tc);
 	net_stats_update_tc_recv_bytes(iface, tc, net_pkt_get_len(pkt));
 	net_stats_update_tc_recv_priority(iface, tc, prio);
+#else
+	ARG_UNUSED(iface);
 #endif
 
 #if NET_TC_RX_COUNT > 1
 	NET_DBG("TC %d with prio %d pkt %p", tc, prio, pkt);
 #endif
 
+	return tc;
+}
+
+static void net_queue_rx(struct net_if *iface, struct net_pkt *pkt)
+{
+	uint8_t tc = net_rx_classify(iface, pkt);
+
 	if (NET_TC_RX_COUNT == 0) {
 		net_process_rx_packet(pkt);
 	} else {
@@ -485,6 +495,32 @@ static void net_queue_rx(struct net_if *iface, struct net_pkt *pkt)
 	}
 }
 
+/* Prepare a received packet for the RX path, returns false if the packet
+ * was filtered out and dropped.
+ */
+static bool net_recv_prepare(struct net_if *iface, struct net_pkt *pkt)
+{
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_cursor_init(pkt);
+
+	NET_DBG("prio %d iface %p pkt %p len %zu", net_pkt_priority(pkt),
+		iface, pkt, net_pkt_get_len(pkt));
+
+	if (IS_ENABLED(CONFIG_NET_ROUTING)) {
+		net_pkt_set_orig_iface(pkt, iface);
+	}
+
+	net_pkt_set_iface(pkt, iface);
+
+	if (!net_pkt_filter_recv_ok(pkt)) {
+		/* silently drop the packet */
+		net_pkt_unref(pkt);
+		return false;
+	}
+
+	return true;
+}
+
 /* Called by driver when a packet has been received */
 int net_recv_data(struct net_if *iface, struct net_pkt *pkt)
 {
@@ -500,23 +536,51 @@ int net_recv_data(struct net_if *iface, struct net_pkt *pkt)
 		return -ENETDOWN;
 	}
 
-	net_pkt_set_overwrite(pkt, true);
-	net_pkt_cursor_init(pkt);
+	if (net_recv_prepare(iface, pkt)) {
+		net_queue_rx(iface, pkt);
+	}
 
-	NET_DBG("prio %d iface %p pkt %p len %zu", net_pkt_priority(pkt),
-		iface, pkt, net_pkt_get_len(pkt));
+	return 0;
+}
 
-	if (IS_ENABLED(CONFIG_NET_ROUTING)) {
-		net_pkt_set_orig_iface(pkt, iface);
+/* Called by driver when several packets have been received */
+int net_recv_data_batch(struct net_if *iface, struct net_pkt **pkts,
+			size_t count)
+{
+	size_t queued = 0;
+	size_t i;
+
+	if (!pkts || !iface) {
+		return -EINVAL;
 	}
 
-	net_pkt_set_iface(pkt, iface);
+	if (!net_if_flag_is_set(iface, NET_IF_UP)) {
+		return -ENETDOWN;
+	}
 
-	if (!net_pkt_filter_recv_ok(pkt)) {
-		/* silently drop the packet */
-		net_pkt_unref(pkt);
-	} else {
-		net_queue_rx(iface, pkt);
+	for (i = 0; i < count; i++) {
+		struct net_pkt *pkt = pkts[i];
+
+		if (net_pkt_is_empty(pkt)) {
+			net_pkt_unref(pkt);
+			continue;
+		}
+
+		if (!net_recv_prepare(iface, pkt)) {
+			continue;
+		}
+
+		(void)net_rx_classify(iface, pkt);
+
+		if (NET_TC_RX_COUNT == 0) {
+			net_process_rx_packet(pkt);
+		} else {
+			pkts[queued++] = pkt;
+		}
+	}
+
+	if (queued > 0) {
+		net_tc_submit_batch_to_rx_queue(pkts, queued);
 	}
 
 	return 0;
@@ -542,6 +606,8 @@ static inline void l3_init(void)
 
 	net_route_init();
 
+	net_conntrack_init();
+
 	NET_DBG("Network L3 init done");
 }
 
@@ -0,0 +1,369 @@
+/** @file
+ * @brief Generic receive offload (GRO)
+ *
+ * Coalesce consecutive in-order TCP segments of the same flow, found in
+ * one batch of packets taken from the RX queue, into a single network
+ * packet before the packet is passed to the IP stack.
+ */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_gro, CONFIG_NET_GRO_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/ethernet.h>
+
+#include "net_private.h"
+#include "net_stats.h"
+#include "tcp_internal.h"
+
+/* Flow that is currently collecting segments. All the header pointers
+ * point to the first fragment of the head packet.
+ */
+struct gro_flow {
+	struct net_pkt *pkt;
+	uint8_t *l3;
+	struct net_tcp_hdr *tcp;
+	uint32_t seq;
+	uint16_t l3_len;
+	uint16_t hdr_len;
+	uint16_t payload_len;
+	uint8_t family;
+	uint8_t segs;
+};
+
+static bool gro_iface_ok(struct net_if *iface)
+{
+	if (net_if_l2(iface) != &NET_L2_GET_NAME(ETHERNET)) {
+		return false;
+	}
+
+#if defined(CONFIG_NET_ETHERNET_BRIDGE)
+	/* Bridged frames are forwarded as is, so do not touch them. */
+	if (((struct ethernet_context *)net_if_l2_data(iface))->bridge.instance) {
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+static bool gro_parse_ipv4(struct gro_flow *flow, size_t pkt_len)
+{
+	struct net_ipv4_hdr *hdr = (struct net_ipv4_hdr *)flow->l3;
+
+	if (hdr->vhl != 0x45 || hdr->proto != IPPROTO_TCP) {
+		return false;
+	}
+
+	if ((ntohs(*((uint16_t *)&hdr->offset[0])) &
+	     (NET_IPV4_FRAGH_OFFSET_MASK | NET_IPV4_MORE_FRAG_MASK)) != 0) {
+		return false;
+	}
+
+	/* Ethernet padding or truncated frame */
+	if (ntohs(hdr->len) != pkt_len) {
+		return false;
+	}
+
+	/* Coalesced segments are going to be passed to our own TCP only,
+	 * a forwarded packet must keep its original size and checksum.
+	 */
+	if (IS_ENABLED(CONFIG_NET_ROUTING) &&
+	    !net_ipv4_is_my_addr((struct in_addr *)hdr->dst)) {
+		return false;
+	}
+
+	flow->family = AF_INET;
+	flow->l3_len = sizeof(struct net_ipv4_hdr);
+
+	return true;
+}
+
+static bool gro_parse_ipv6(struct gro_flow *flow, size_t pkt_len)
+{
+	struct net_ipv6_hdr *hdr = (struct net_ipv6_hdr *)flow->l3;
+
+	if ((hdr->vtc & 0xf0) != 0x60 || hdr->nexthdr != IPPROTO_TCP) {
+		return false;
+	}
+
+	if (ntohs(hdr->len) + sizeof(struct net_ipv6_hdr) != pkt_len) {
+		return false;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_ROUTING) &&
+	    !net_ipv6_is_my_addr((struct in6_addr *)hdr->dst)) {
+		return false;
+	}
+
+	flow->family = AF_INET6;
+	flow->l3_len = sizeof(struct net_ipv6_hdr);
+
+	return true;
+}
+
+/* Check whether the packet is a TCP data segment that can take part in
+ * coalescing, and if so, fill the flow information for it.
+ */
+static bool gro_parse(struct net_pkt *pkt, struct gro_flow *flow)
+{
+	struct net_buf *buf = pkt->buffer;
+	struct net_eth_hdr *eth;
+	size_t pkt_len;
+	uint16_t tcp_len;
+	bool ret = false;
+
+	if (buf == NULL || buf->len < sizeof(struct net_eth_hdr) +
+				      sizeof(struct net_ipv6_hdr)) {
+		return false;
+	}
+
+	eth = (struct net_eth_hdr *)buf->data;
+	flow->l3 = buf->data + sizeof(struct net_eth_hdr);
+	pkt_len = net_pkt_get_len(pkt) - sizeof(struct net_eth_hdr);
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && eth->type == htons(NET_ETH_PTYPE_IP)) {
+		ret = gro_parse_ipv4(flow, pkt_len);
+	} else if (IS_ENABLED(CONFIG_NET_IPV6) &&
+		   eth->type == htons(NET_ETH_PTYPE_IPV6)) {
+		ret = gro_parse_ipv6(flow, pkt_len);
+	}
+
+	if (!ret) {
+		return false;
+	}
+
+	if (buf->len < sizeof(struct net_eth_hdr) + flow->l3_len +
+		       sizeof(struct net_tcp_hdr)) {
+		return false;
+	}
+
+	flow->tcp = (struct net_tcp_hdr *)(flow->l3 + flow->l3_len);
+
+	/* Only plain ACK segments, PSH is allowed as it just ends the
+	 * coalescing for the flow.
+	 */
+	if ((flow->tcp->flags & ~PSH) != ACK) {
+		return false;
+	}
+
+	tcp_len = (flow->tcp->offset >> 4) * 4U;
+	flow->hdr_len = sizeof(struct net_eth_hdr) + flow->l3_len + tcp_len;
+
+	if (tcp_len < sizeof(struct net_tcp_hdr) || buf->len < flow->hdr_len ||
+	    pkt_len <= flow->l3_len + tcp_len) {
+		return false;
+	}
+
+	flow->pkt = pkt;
+	flow->seq = sys_get_be32(flow->tcp->seq);
+	flow->payload_len = pkt_len - flow->l3_len - tcp_len;
+	flow->segs = 1U;
+
+	return true;
+}
+
+static bool gro_same_flow(struct gro_flow *flow, struct gro_flow *seg)
+{
+	if (seg->family != flow->family || seg->hdr_len != flow->hdr_len ||
+	    net_pkt_iface(seg->pkt) != net_pkt_iface(flow->pkt)) {
+		return false;
+	}
+
+	/* Ethernet header */
+	if (memcmp(flow->pkt->buffer->data, seg->pkt->buffer->data,
+		   sizeof(struct net_eth_hdr)) != 0) {
+		return false;
+	}
+
+	if (flow->family == AF_INET) {
+		struct net_ipv4_hdr *a = (struct net_ipv4_hdr *)flow->l3;
+		struct net_ipv4_hdr *b = (struct net_ipv4_hdr *)seg->l3;
+
+		if (a->tos != b->tos || a->ttl != b->ttl ||
+		    memcmp(a->src, b->src, sizeof(a->src) + sizeof(a->dst)) != 0) {
+			return false;
+		}
+	} else {
+		struct net_ipv6_hdr *a = (struct net_ipv6_hdr *)flow->l3;
+		struct net_ipv6_hdr *b = (struct net_ipv6_hdr *)seg->l3;
+
+		/* Version, traffic class and flow label */
+		if (memcmp(a, b, sizeof(uint32_t)) != 0 ||
+		    a->hop_limit != b->hop_limit ||
+		    memcmp(a->src, b->src, sizeof(a->src) + sizeof(a->dst)) != 0) {
+			return false;
+		}
+	}
+
+	/* Ports, ack number, window and all the options must match.
+	 * Sequence number, flags and checksum are checked separately.
+	 */
+	if (flow->tcp->src_port != seg->tcp->src_port ||
+	    flow->tcp->dst_port != seg->tcp->dst_port ||
+	    memcmp(flow->tcp->ack, seg->tcp->ack, sizeof(flow->tcp->ack)) != 0 ||
+	    memcmp(flow->tcp->wnd, seg->tcp->wnd, sizeof(flow->tcp->wnd)) != 0 ||
+	    memcmp(flow->tcp->optdata, seg->tcp->optdata,
+		   flow->hdr_len - sizeof(struct net_eth_hdr) - flow->l3_len -
+		   sizeof(struct net_tcp_hdr)) != 0) {
+		return false;
+	}
+
+	return true;
+}
+
+/* The checksums of the segments are verified here, as after coalescing
+ * only the IPv4 header checksum of the resulting packet is valid.
+ */
+static bool gro_chksum_ok(struct gro_flow *flow)
+{
+	struct net_pkt *pkt = flow->pkt;
+	bool ok;
+
+	if (!net_if_need_calc_rx_checksum(net_pkt_iface(pkt))) {
+		return true;
+	}
+
+	if (flow->family == AF_INET &&
+	    calc_chksum(0, flow->l3, flow->l3_len) != 0xffff) {
+		return false;
+	}
+
+	if (!IS_ENABLED(CONFIG_NET_TCP_CHECKSUM)) {
+		return true;
+	}
+
+	net_buf_pull(pkt->buffer, sizeof(struct net_eth_hdr));
+
+	net_pkt_set_family(pkt, flow->family);
+	net_pkt_set_ip_hdr_len(pkt, flow->l3_len);
+
+	ok = net_calc_chksum(pkt, IPPROTO_TCP) == 0U;
+
+	net_buf_push(pkt->buffer, sizeof(struct net_eth_hdr));
+
+	return ok;
+}
+
+static bool gro_merge(struct gro_flow *flow, struct net_pkt *pkt)
+{
+	size_t max_len = (flow->family == AF_INET) ? UINT16_MAX :
+			 UINT16_MAX + sizeof(struct net_ipv6_hdr);
+	struct gro_flow seg;
+	struct net_buf *buf;
+
+	if (!gro_parse(pkt, &seg) || !gro_same_flow(flow, &seg)) {
+		return false;
+	}
+
+	if (seg.seq != flow->seq + flow->payload_len ||
+	    flow->hdr_len - sizeof(struct net_eth_hdr) + flow->payload_len +
+	    seg.payload_len > max_len) {
+		return false;
+	}
+
+	/* Head segment is verified only when there is something to merge */
+	if ((flow->segs == 1U && !gro_chksum_ok(flow)) || !gro_chksum_ok(&seg)) {
+		return false;
+	}
+
+	buf = pkt->buffer;
+	net_buf_pull(buf, seg.hdr_len);
+
+	if (buf->len == 0U) {
+		pkt->buffer = buf->frags;
+		buf->frags = NULL;
+		net_buf_unref(buf);
+	}
+
+	net_pkt_append_buffer(flow->pkt, pkt->buffer);
+	pkt->buffer = NULL;
+
+	flow->tcp->flags |= seg.tcp->flags & PSH;
+	flow->payload_len += seg.payload_len;
+	flow->segs++;
+
+	if (flow->family == AF_INET) {
+		struct net_ipv4_hdr *hdr = (struct net_ipv4_hdr *)flow->l3;
+		uint16_t len = htons(ntohs(hdr->len) + seg.payload_len);
+
+		hdr->chksum = net_chksum_update_u16(hdr->chksum, hdr->len, len);
+		hdr->len = len;
+	} else {
+		struct net_ipv6_hdr *hdr = (struct net_ipv6_hdr *)flow->l3;
+
+		hdr->len = htons(ntohs(hdr->len) + seg.payload_len);
+	}
+
+	net_stats_update_gro_merged(net_pkt_iface(flow->pkt));
+
+	net_pkt_unref(pkt);
+
+	return true;
+}
+
+static void gro_flush(struct gro_flow *flow)
+{
+	if (flow->pkt == NULL) {
+		return;
+	}
+
+	if (flow->segs > 1U) {
+		NET_DBG("pkt %p: %u segments, %u bytes", flow->pkt,
+			flow->segs, flow->payload_len);
+
+		/* All the segments were verified already */
+		net_pkt_set_rx_chksum_verified(flow->pkt, true);
+
+		net_stats_update_gro_flushed(net_pkt_iface(flow->pkt));
+	}
+
+	net_process_rx_packet(flow->pkt);
+	flow->pkt = NULL;
+}
+
+static bool gro_flow_full(struct gro_flow *flow)
+{
+	return flow->segs >= CONFIG_NET_GRO_MAX_SEGS ||
+		(flow->tcp->flags & PSH);
+}
+
+void net_gro_process(struct net_pkt **pkts, int count)
+{
+	struct gro_flow flow = { 0 };
+
+	for (int i = 0; i < count; i++) {
+		struct net_pkt *pkt = pkts[i];
+
+		if (flow.pkt != NULL && gro_merge(&flow, pkt)) {
+			if (gro_flow_full(&flow)) {
+				gro_flush(&flow);
+			}
+
+			continue;
+		}
+
+		gro_flush(&flow);
+
+		if (i < count - 1 && gro_iface_ok(net_pkt_iface(pkt)) &&
+		    gro_parse(pkt, &flow) && !gro_flow_full(&flow)) {
+			continue;
+		}
+
+		flow.pkt = NULL;
+		net_process_rx_packet(pkt);
+	}
+
+	gro_flush(&flow);
+}
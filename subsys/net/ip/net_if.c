@@ -30,6 +30,7 @@ LOG_MODULE_REGISTER(net_if, CONFIG_NET_IF_LOG_LEVEL);
 #include "ipv4.h"
 #include "ipv6.h"
 #include "ipv4_autoconf_internal.h"
+#include "route.h"
 
 #include "net_stats.h"
 
@@ -3482,6 +3483,10 @@ struct net_if *net_if_ipv4_select_src_iface(const struct in_addr *dst)
 		}
 	}
 
+	if (selected == NULL) {
+		selected = net_route_ipv4_get_nexthop(NULL, dst, NULL);
+	}
+
 	if (selected == NULL) {
 		selected = net_if_get_default();
 	}
@@ -132,6 +132,11 @@ static inline enum net_verdict net_ipv6_input(struct net_pkt *pkt,
 #endif
 extern bool net_tc_submit_to_tx_queue(uint8_t tc, struct net_pkt *pkt);
 extern void net_tc_submit_to_rx_queue(uint8_t tc, struct net_pkt *pkt);
+extern void net_tc_submit_batch_to_rx_queue(struct net_pkt **pkts,
+					    size_t count);
+#if defined(CONFIG_NET_GRO)
+extern void net_gro_process(struct net_pkt **pkts, int count);
+#endif
 extern enum net_verdict net_promisc_mode_input(struct net_pkt *pkt);
 
 char *net_sprint_addr(sa_family_t af, const void *addr);
@@ -210,6 +215,65 @@ extern char *net_sprint_ll_addr_buf(const uint8_t *ll, uint8_t ll_len,
 extern uint16_t calc_chksum(uint16_t sum_in, const uint8_t *data, size_t len);
 extern uint16_t net_calc_chksum(struct net_pkt *pkt, uint8_t proto);
 
+/**
+ * @brief Update a checksum after rewriting part of the checksummed data
+ *
+ * Incremental update as described in RFC 1624. The checksum and the data
+ * are used in the byte order they are stored in the packet, so no byte
+ * swapping is needed by the caller. The rewritten data must start at an
+ * even offset from the start of the checksummed area.
+ *
+ * @param chksum Checksum field value before the rewrite
+ * @param old_data Data before the rewrite
+ * @param new_data Data after the rewrite
+ * @param len Length of the rewritten data
+ *
+ * @return Checksum field value after the rewrite
+ */
+extern uint16_t net_chksum_update(uint16_t chksum, const uint8_t *old_data,
+				  const uint8_t *new_data, size_t len);
+
+/**
+ * @brief Update a checksum after rewriting a 16-bit field
+ *
+ * @param chksum Checksum field value before the rewrite
+ * @param old_val Old field value, as stored in the packet
+ * @param new_val New field value, as stored in the packet
+ *
+ * @return Checksum field value after the rewrite
+ */
+static inline uint16_t net_chksum_update_u16(uint16_t chksum, uint16_t old_val,
+					     uint16_t new_val)
+{
+	/* RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m') */
+	uint32_t sum = (uint16_t)~chksum + (uint16_t)~old_val + new_val;
+
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+
+	return (uint16_t)~sum;
+}
+
+/**
+ * @brief Update a checksum after rewriting a 32-bit field, like an IPv4
+ *        address or a TCP sequence number
+ *
+ * @param chksum Checksum field value before the rewrite
+ * @param old_val Old field value, as stored in the packet
+ * @param new_val New field value, as stored in the packet
+ *
+ * @return Checksum field value after the rewrite
+ */
+static inline uint16_t net_chksum_update_u32(uint16_t chksum, uint32_t old_val,
+					     uint32_t new_val)
+{
+	chksum = net_chksum_update_u16(chksum, (uint16_t)old_val,
+				       (uint16_t)new_val);
+
+	return net_chksum_update_u16(chksum, (uint16_t)(old_val >> 16),
+				     (uint16_t)(new_val >> 16));
+}
+
 /**
  * @brief Deliver the incoming packet through the recv_cb of the net_context
  *        to the upper layers
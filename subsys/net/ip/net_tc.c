@@ -13,10 +13,12 @@ LOG_MODULE_REGISTER(net_tc, CONFIG_NET_TC_LOG_LEVEL);
 #include <zephyr/net/net_core.h>
 #include <zephyr/net/net_pkt.h>
 #include <zephyr/net/net_stats.h>
+#include <zephyr/net/ethernet.h>
 
 #include "net_private.h"
 #include "net_stats.h"
 #include "net_tc_mapping.h"
+#include "ipv4.h"
 
 /* Template for thread name. The "xx" is either "TX" denoting transmit thread,
  * or "RX" denoting receive thread. The "q[y]" denotes the traffic class queue
@@ -40,6 +42,30 @@ static struct net_traffic_class tx_classes[NET_TC_TX_COUNT];
 static struct net_traffic_class rx_classes[NET_TC_RX_COUNT];
 #endif
 
+#if defined(CONFIG_NET_RX_RSS)
+/* The first RSS queue is the queue of the traffic class itself, these are
+ * the additional ones.
+ */
+#define RSS_EXTRA_QUEUES (CONFIG_NET_RX_RSS_QUEUES - 1)
+
+#if RSS_EXTRA_QUEUES > 0
+K_KERNEL_STACK_ARRAY_DEFINE(rss_stack, RSS_EXTRA_QUEUES,
+			    CONFIG_NET_RX_STACK_SIZE);
+
+static struct net_traffic_class rss_classes[RSS_EXTRA_QUEUES];
+#endif
+
+/* Traffic class whose packets are spread over the RSS queues */
+static uint8_t rss_tc;
+#else
+#define RSS_EXTRA_QUEUES 0
+#endif
+
+/* The RX queues are numbered by traffic class, followed by the additional
+ * RSS queues.
+ */
+#define RX_QUEUE_COUNT (NET_TC_RX_COUNT + RSS_EXTRA_QUEUES)
+
 #if NET_TC_RX_COUNT > 0 || NET_TC_TX_COUNT > 0
 static void submit_to_queue(struct k_fifo *queue, struct net_pkt *pkt)
 {
@@ -60,18 +86,213 @@ bool net_tc_submit_to_tx_queue(uint8_t tc, struct net_pkt *pkt)
 	return true;
 }
 
+#if RSS_EXTRA_QUEUES > 0
+static inline uint32_t rss_hash_add(uint32_t hash, uint32_t value)
+{
+	return (hash ^ value) * 0x9e3779b1U;
+}
+
+static uint32_t rss_hash_ipv4(struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+	uint32_t hash;
+	uint32_t ports;
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	if (hdr == NULL) {
+		return 0;
+	}
+
+	hash = rss_hash_add(hdr->proto, UNALIGNED_GET((uint32_t *)hdr->src));
+	hash = rss_hash_add(hash, UNALIGNED_GET((uint32_t *)hdr->dst));
+
+	/* All the fragments of a datagram must end up in the same queue,
+	 * so the ports are used only for unfragmented packets.
+	 */
+	if ((hdr->proto != IPPROTO_TCP && hdr->proto != IPPROTO_UDP) ||
+	    (ntohs(UNALIGNED_GET((uint16_t *)hdr->offset)) &
+	     (NET_IPV4_FRAGH_OFFSET_MASK | NET_IPV4_MORE_FRAG_MASK)) != 0) {
+		return hash;
+	}
+
+	if (net_pkt_skip(pkt, (hdr->vhl & NET_IPV4_IHL_MASK) * 4U) ||
+	    net_pkt_read_be32(pkt, &ports)) {
+		return hash;
+	}
+
+	return rss_hash_add(hash, ports);
+}
+
+static uint32_t rss_hash_ipv6(struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(ipv6_access, struct net_ipv6_hdr);
+	struct net_ipv6_hdr *hdr;
+	uint32_t hash;
+	uint32_t ports;
+	int i;
+
+	hdr = (struct net_ipv6_hdr *)net_pkt_get_data(pkt, &ipv6_access);
+	if (hdr == NULL) {
+		return 0;
+	}
+
+	hash = hdr->nexthdr;
+
+	for (i = 0; i < sizeof(struct in6_addr); i += sizeof(uint32_t)) {
+		hash = rss_hash_add(hash, UNALIGNED_GET((uint32_t *)&hdr->src[i]));
+		hash = rss_hash_add(hash, UNALIGNED_GET((uint32_t *)&hdr->dst[i]));
+	}
+
+	/* Extension headers are not followed, packets that have them are
+	 * hashed by the addresses only.
+	 */
+	if (hdr->nexthdr != IPPROTO_TCP && hdr->nexthdr != IPPROTO_UDP) {
+		return hash;
+	}
+
+	if (net_pkt_skip(pkt, sizeof(struct net_ipv6_hdr)) ||
+	    net_pkt_read_be32(pkt, &ports)) {
+		return hash;
+	}
+
+	return rss_hash_add(hash, ports);
+}
+
+/* Hash the flow of a received packet. The packet still has its link
+ * layer header, only Ethernet framing is skipped, other link layers
+ * must deliver the IP header at the start of the packet. Anything that
+ * cannot be parsed gets hash 0, which keeps it in order too.
+ */
+static uint32_t rss_hash(struct net_pkt *pkt)
+{
+	struct net_pkt_cursor backup;
+	struct net_pkt_cursor l3;
+	uint32_t hash = 0;
+	uint8_t vhl;
+
+	net_pkt_cursor_backup(pkt, &backup);
+	net_pkt_cursor_init(pkt);
+
+#if defined(CONFIG_NET_L2_ETHERNET)
+	if (net_if_l2(net_pkt_iface(pkt)) == &NET_L2_GET_NAME(ETHERNET)) {
+		uint16_t type;
+
+		if (net_pkt_skip(pkt, 2 * sizeof(struct net_eth_addr)) ||
+		    net_pkt_read_be16(pkt, &type)) {
+			goto out;
+		}
+
+		if (type == NET_ETH_PTYPE_VLAN &&
+		    (net_pkt_skip(pkt, sizeof(uint16_t)) ||
+		     net_pkt_read_be16(pkt, &type))) {
+			goto out;
+		}
+
+		if (type != NET_ETH_PTYPE_IP && type != NET_ETH_PTYPE_IPV6) {
+			goto out;
+		}
+	}
+#endif
+
+	net_pkt_cursor_backup(pkt, &l3);
+
+	if (net_pkt_read_u8(pkt, &vhl)) {
+		goto out;
+	}
+
+	net_pkt_cursor_restore(pkt, &l3);
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && (vhl & 0xf0) == 0x40) {
+		hash = rss_hash_ipv4(pkt);
+	} else if (IS_ENABLED(CONFIG_NET_IPV6) && (vhl & 0xf0) == 0x60) {
+		hash = rss_hash_ipv6(pkt);
+	}
+
+out:
+	net_pkt_cursor_restore(pkt, &backup);
+
+	return hash;
+}
+#endif /* RSS_EXTRA_QUEUES > 0 */
+
+#if NET_TC_RX_COUNT > 0
+static int rx_queue_index(uint8_t tc, struct net_pkt *pkt)
+{
+#if RSS_EXTRA_QUEUES > 0
+	if (tc == rss_tc) {
+		uint32_t queue = (rss_hash(pkt) >> 16) %
+				 CONFIG_NET_RX_RSS_QUEUES;
+
+		if (queue > 0) {
+			return NET_TC_RX_COUNT + queue - 1;
+		}
+	}
+#else
+	ARG_UNUSED(pkt);
+#endif
+
+	return tc;
+}
+
+static struct k_fifo *rx_queue_fifo(int index)
+{
+#if RSS_EXTRA_QUEUES > 0
+	if (index >= NET_TC_RX_COUNT) {
+		return &rss_classes[index - NET_TC_RX_COUNT].fifo;
+	}
+#endif
+
+	return &rx_classes[index].fifo;
+}
+#endif
+
 void net_tc_submit_to_rx_queue(uint8_t tc, struct net_pkt *pkt)
 {
 #if NET_TC_RX_COUNT > 0
 	net_pkt_set_rx_stats_tick(pkt, k_cycle_get_32());
 
-	submit_to_queue(&rx_classes[tc].fifo, pkt);
+	submit_to_queue(rx_queue_fifo(rx_queue_index(tc, pkt)), pkt);
 #else
 	ARG_UNUSED(tc);
 	ARG_UNUSED(pkt);
 #endif
 }
 
+void net_tc_submit_batch_to_rx_queue(struct net_pkt **pkts, size_t count)
+{
+#if NET_TC_RX_COUNT > 0
+	sys_slist_t queues[RX_QUEUE_COUNT];
+	size_t i;
+	int q;
+
+	for (q = 0; q < RX_QUEUE_COUNT; q++) {
+		sys_slist_init(&queues[q]);
+	}
+
+	for (i = 0; i < count; i++) {
+		uint8_t tc = net_rx_priority2tc(net_pkt_priority(pkts[i]));
+
+		net_pkt_set_rx_stats_tick(pkts[i], k_cycle_get_32());
+
+		sys_slist_append(&queues[rx_queue_index(tc, pkts[i])],
+				 (sys_snode_t *)&pkts[i]->fifo);
+	}
+
+	/* Each queue gets its packets in one operation, so its thread is
+	 * woken up only once for the whole batch.
+	 */
+	for (q = 0; q < RX_QUEUE_COUNT; q++) {
+		if (!sys_slist_is_empty(&queues[q])) {
+			k_fifo_put_slist(rx_queue_fifo(q), &queues[q]);
+		}
+	}
+#else
+	ARG_UNUSED(pkts);
+	ARG_UNUSED(count);
+#endif
+}
+
 int net_tx_priority2tc(enum net_priority prio)
 {
 #if NET_TC_TX_COUNT > 0
@@ -247,6 +468,10 @@ static void tc_rx_handler(void *p1, void *p2, void *p3)
 
 	struct k_fifo *fifo = p1;
 	struct net_pkt *pkt;
+#if defined(CONFIG_NET_GRO)
+	struct net_pkt *batch[CONFIG_NET_GRO_BATCH_SIZE];
+	int count;
+#endif
 
 	while (1) {
 		pkt = k_fifo_get(fifo, K_FOREVER);
@@ -254,7 +479,21 @@ static void tc_rx_handler(void *p1, void *p2, void *p3)
 			continue;
 		}
 
+#if defined(CONFIG_NET_GRO)
+		/* Take whatever is already queued so that the segments of
+		 * one flow can be coalesced, but do not wait for more.
+		 */
+		count = 0;
+
+		do {
+			batch[count++] = pkt;
+		} while (count < ARRAY_SIZE(batch) &&
+			 (pkt = k_fifo_get(fifo, K_NO_WAIT)) != NULL);
+
+		net_gro_process(batch, count);
+#else
 		net_process_rx_packet(pkt);
+#endif
 	}
 }
 #endif
@@ -340,6 +579,68 @@ void net_tc_tx_init(void)
 #endif
 }
 
+#if defined(CONFIG_NET_RX_RSS)
+static void rss_cpu_pin(k_tid_t tid, int queue)
+{
+#if defined(CONFIG_NET_RX_RSS_CPU_PIN)
+	int cpu = queue % arch_num_cpus();
+	int ret;
+
+	ret = k_thread_cpu_pin(tid, cpu);
+	if (ret < 0) {
+		NET_ERR("Cannot pin RSS queue %d to CPU %d (%d)", queue, cpu,
+			ret);
+	}
+#else
+	ARG_UNUSED(tid);
+	ARG_UNUSED(queue);
+#endif
+}
+
+/* Start the threads of the additional RSS queues, they run at the priority
+ * of the traffic class thread they share the traffic with.
+ */
+static void rss_rx_init(int priority)
+{
+#if RSS_EXTRA_QUEUES > 0
+	int i;
+
+	for (i = 0; i < RSS_EXTRA_QUEUES; i++) {
+		k_tid_t tid;
+
+		NET_DBG("[%d] Starting RSS handler %p stack size %zd "
+			"prio %d", i + 1, &rss_classes[i].handler,
+			K_KERNEL_STACK_SIZEOF(rss_stack[i]), priority);
+
+		k_fifo_init(&rss_classes[i].fifo);
+
+		tid = k_thread_create(&rss_classes[i].handler, rss_stack[i],
+				      K_KERNEL_STACK_SIZEOF(rss_stack[i]),
+				      tc_rx_handler,
+				      &rss_classes[i].fifo, NULL, NULL,
+				      priority, 0, K_FOREVER);
+		if (!tid) {
+			NET_ERR("Cannot create RSS handler thread %d", i + 1);
+			continue;
+		}
+
+		if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+			char name[sizeof("rx_rss[yy]")];
+
+			snprintk(name, sizeof(name), "rx_rss[%d]", i + 1);
+			k_thread_name_set(tid, name);
+		}
+
+		rss_cpu_pin(tid, i + 1);
+
+		k_thread_start(tid);
+	}
+#else
+	ARG_UNUSED(priority);
+#endif
+}
+#endif /* CONFIG_NET_RX_RSS */
+
 void net_tc_rx_init(void)
 {
 #if NET_TC_RX_COUNT == 0
@@ -354,6 +655,10 @@ void net_tc_rx_init(void)
 	net_if_foreach(net_tc_rx_stats_priority_setup, NULL);
 #endif
 
+#if defined(CONFIG_NET_RX_RSS)
+	rss_tc = net_rx_priority2tc(NET_PRIORITY_BE);
+#endif
+
 	for (i = 0; i < NET_TC_RX_COUNT; i++) {
 		uint8_t thread_priority;
 		int priority;
@@ -393,6 +698,13 @@ void net_tc_rx_init(void)
 			k_thread_name_set(tid, name);
 		}
 
+#if defined(CONFIG_NET_RX_RSS)
+		if (i == rss_tc) {
+			rss_cpu_pin(tid, 0);
+			rss_rx_init(priority);
+		}
+#endif
+
 		k_thread_start(tid);
 	}
 #endif
@@ -28,6 +28,7 @@ LOG_MODULE_REGISTER(net_route, CONFIG_NET_ROUTE_LOG_LEVEL);
 #include "icmpv6.h"
 #include "nbr.h"
 #include "route.h"
+#include "route_lpm.h"
 
 /* We keep track of the routes in a separate list so that we can remove
  * the oldest routes (at tail) if needed.
@@ -115,6 +116,9 @@ NET_NBR_POOL_INIT(net_route_entries_pool,
 NET_NBR_TABLE_INIT(NET_NBR_LOCAL, nbr_routes, net_route_entries_pool,
 		   net_route_entries_table_clear);
 
+/* Index of the routing table entries for longest prefix match lookups */
+NET_ROUTE_LPM_DEFINE(route_lpm, CONFIG_NET_MAX_ROUTES, 128);
+
 static inline struct net_nbr *get_nbr(int idx)
 {
 	return &net_route_entries_pool[idx].nbr;
@@ -267,38 +271,27 @@ static inline void update_route_access(struct net_route_entry *route)
 	sys_slist_prepend(&routes, &route->node);
 }
 
+static bool route_iface_match(sys_snode_t *entry, void *user_data)
+{
+	struct net_route_entry *route =
+		CONTAINER_OF(entry, struct net_route_entry, lpm_node);
+
+	return route->iface == user_data;
+}
+
 struct net_route_entry *net_route_lookup(struct net_if *iface,
 					 struct in6_addr *dst)
 {
-	struct net_route_entry *route, *found = NULL;
-	uint8_t longest_match = 0U;
-	int i;
+	struct net_route_entry *found = NULL;
+	sys_snode_t *entry;
 
 	net_ipv6_nbr_lock();
 
-	for (i = 0; i < CONFIG_NET_MAX_ROUTES && longest_match < 128; i++) {
-		struct net_nbr *nbr = get_nbr(i);
-
-		if (!nbr->ref) {
-			continue;
-		}
+	entry = net_route_lpm_lookup(&route_lpm, dst->s6_addr,
+				     iface ? route_iface_match : NULL, iface);
+	if (entry) {
+		found = CONTAINER_OF(entry, struct net_route_entry, lpm_node);
 
-		if (iface && nbr->iface != iface) {
-			continue;
-		}
-
-		route = net_route_data(nbr);
-
-		if (route->prefix_len >= longest_match &&
-		    net_ipv6_is_prefix(dst->s6_addr,
-				       route->addr.s6_addr,
-				       route->prefix_len)) {
-			found = route;
-			longest_match = route->prefix_len;
-		}
-	}
-
-	if (found) {
 		net_route_info("Found", found, dst);
 
 		update_route_access(found);
@@ -332,6 +325,7 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	struct net_nbr *nbr, *nbr_nexthop, *tmp;
 	struct net_route_nexthop *nexthop_route;
 	struct net_route_entry *route = NULL;
+	sys_snode_t *entry;
 #if defined(CONFIG_NET_MGMT_EVENT_INFO)
        struct net_event_ipv6_route info;
 #endif
@@ -361,11 +355,17 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 			net_sprint_ll_addr(nexthop_lladdr->addr, nexthop_lladdr->len));
 	}
 
-	route = net_route_lookup(iface, addr);
-	if (route) {
+	/* A route to a longer or shorter prefix is a different route,
+	 * only the one with the very same prefix is updated.
+	 */
+	entry = net_route_lpm_find(&route_lpm, addr->s6_addr, prefix_len,
+				   route_iface_match, iface);
+	if (entry) {
 		/* Update nexthop if not the same */
 		struct in6_addr *nexthop_addr;
 
+		route = CONTAINER_OF(entry, struct net_route_entry, lpm_node);
+
 		nexthop_addr = net_route_get_nexthop(route);
 		if (nexthop_addr && net_ipv6_addr_cmp(nexthop, nexthop_addr)) {
 			NET_DBG("No changes, return old route %p", route);
@@ -442,6 +442,16 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	route->iface = iface;
 	route->preference = preference;
 
+	if (net_route_lpm_insert(&route_lpm, addr->s6_addr, prefix_len,
+				 &route->lpm_node) < 0) {
+		NET_ERR("Cannot index route to %s/%d",
+			net_sprint_ipv6_addr(addr), prefix_len);
+		release_nexthop_route(nexthop_route);
+		nbr_free(nbr);
+		route = NULL;
+		goto exit;
+	}
+
 	net_route_update_lifetime(route, lifetime);
 
 	sys_slist_prepend(&routes, &route->node);
@@ -596,6 +606,9 @@ int net_route_del(struct net_route_entry *route)
 
 	net_route_info("Deleted", route, &route->addr);
 
+	(void)net_route_lpm_remove(&route_lpm, route->addr.s6_addr,
+				   route->prefix_len, &route->lpm_node);
+
 	SYS_SLIST_FOR_EACH_CONTAINER(&route->nexthop, nexthop_route, node) {
 		if (!nexthop_route->nbr) {
 			continue;
@@ -920,28 +933,18 @@ exit:
 	return ret;
 }
 
-int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop)
+/* Set the link layer addresses and the interface of a forwarded packet
+ * according to the neighbor. The neighbor table mutex must be held.
+ */
+static int route_packet_nbr(struct net_pkt *pkt, struct net_nbr *nbr)
 {
 	struct net_linkaddr_storage *lladdr;
-	struct net_nbr *nbr;
-	int err;
-
-	net_ipv6_nbr_lock();
-
-	nbr = net_ipv6_nbr_lookup(NULL, nexthop);
-	if (!nbr) {
-		NET_DBG("Cannot find %s neighbor",
-			net_sprint_ipv6_addr(nexthop));
-		err = -ENOENT;
-		goto error;
-	}
 
 	lladdr = net_nbr_get_lladdr(nbr->idx);
 	if (!lladdr) {
 		NET_DBG("Cannot find %s neighbor link layer address.",
-			net_sprint_ipv6_addr(nexthop));
-		err = -ESRCH;
-		goto error;
+			net_sprint_ipv6_addr(&net_ipv6_nbr_data(nbr)->addr));
+		return -ESRCH;
 	}
 
 #if defined(CONFIG_NET_L2_DUMMY)
@@ -957,8 +960,7 @@ int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop)
 #endif
 			if (!net_pkt_lladdr_src(pkt)->addr) {
 				NET_DBG("Link layer source address not set");
-				err = -EINVAL;
-				goto error;
+				return -EINVAL;
 			}
 
 			/* Sanitycheck: If src and dst ll addresses are going
@@ -968,8 +970,7 @@ int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop)
 			if (!memcmp(net_pkt_lladdr_src(pkt)->addr, lladdr->addr,
 				    lladdr->len)) {
 				NET_ERR("Src ll and Dst ll are same");
-				err = -EINVAL;
-				goto error;
+				return -EINVAL;
 			}
 #if defined(CONFIG_NET_L2_PPP)
 		}
@@ -993,6 +994,67 @@ int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop)
 
 	net_pkt_set_iface(pkt, nbr->iface);
 
+	return 0;
+}
+
+int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop)
+{
+	struct net_nbr *nbr;
+	int err;
+
+	net_ipv6_nbr_lock();
+
+	nbr = net_ipv6_nbr_lookup(NULL, nexthop);
+	if (!nbr) {
+		NET_DBG("Cannot find %s neighbor",
+			net_sprint_ipv6_addr(nexthop));
+		err = -ENOENT;
+		goto error;
+	}
+
+	err = route_packet_nbr(pkt, nbr);
+	if (err < 0) {
+		goto error;
+	}
+
+	net_ipv6_dst_cache_add(net_pkt_orig_iface(pkt),
+			       (struct in6_addr *)NET_IPV6_HDR(pkt)->dst, nbr);
+
+	net_ipv6_nbr_unlock();
+	return net_send_data(pkt);
+
+error:
+	net_ipv6_nbr_unlock();
+	return err;
+}
+
+#if defined(CONFIG_NET_IPV6_DST_CACHE)
+int net_route_packet_cached(struct net_pkt *pkt, struct in6_addr *dst)
+{
+	struct net_nbr *nbr;
+	int err;
+
+	net_ipv6_nbr_lock();
+
+	nbr = net_ipv6_dst_cache_lookup(net_pkt_iface(pkt), dst);
+
+	/* Without routing, the packet can only leave from the interface it
+	 * was received from, but the entry may come from locally sent
+	 * traffic that went through another interface.
+	 */
+	if (!nbr || (!IS_ENABLED(CONFIG_NET_ROUTING) &&
+		     nbr->iface != net_pkt_iface(pkt))) {
+		err = -ENOENT;
+		goto error;
+	}
+
+	net_pkt_set_orig_iface(pkt, net_pkt_iface(pkt));
+
+	err = route_packet_nbr(pkt, nbr);
+	if (err < 0) {
+		goto error;
+	}
+
 	net_ipv6_nbr_unlock();
 	return net_send_data(pkt);
 
@@ -1000,6 +1062,7 @@ error:
 	net_ipv6_nbr_unlock();
 	return err;
 }
+#endif /* CONFIG_NET_IPV6_DST_CACHE */
 
 int net_route_packet_if(struct net_pkt *pkt, struct net_if *iface)
 {
@@ -49,6 +49,9 @@ struct net_route_entry {
 	 */
 	sys_snode_t node;
 
+	/** Node in the longest prefix match index. */
+	sys_snode_t lpm_node;
+
 	/** List of neighbors that the routes go through. */
 	sys_slist_t nexthop;
 
@@ -293,6 +296,18 @@ bool net_route_get_info(struct net_if *iface,
  */
 int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop);
 
+/**
+ * @brief Send the network packet to network via the neighbor found in
+ * the destination cache for the destination address.
+ *
+ * @param pkt Network packet to send.
+ * @param dst Destination IPv6 address of the packet.
+ *
+ * @return 0 if there was no error, -ENOENT if the destination is not in
+ * the cache, other <0 value if the packet could not be sent.
+ */
+int net_route_packet_cached(struct net_pkt *pkt, struct in6_addr *dst);
+
 /**
  * @brief Send the network packet to network via the given interface.
  *
@@ -303,6 +318,110 @@ int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop);
  */
 int net_route_packet_if(struct net_pkt *pkt, struct net_if *iface);
 
+/**
+ * @brief IPv4 route entry.
+ */
+struct net_route_entry_ipv4 {
+	/** Node in the longest prefix match index. */
+	sys_snode_t lpm_node;
+
+	/** Network interface for the route. */
+	struct net_if *iface;
+
+	/** IPv4 network address of the route. */
+	struct in_addr addr;
+
+	/** Gateway address, unspecified if the network is on-link. */
+	struct in_addr gw;
+
+	/** IPv4 network prefix length. */
+	uint8_t prefix_len;
+
+	/** Is this entry in use or not */
+	bool is_used;
+};
+
+typedef void (*net_route_ipv4_cb_t)(struct net_route_entry_ipv4 *entry,
+				    void *user_data);
+
+/**
+ * @brief Add an IPv4 route to routing table.
+ *
+ * If there is already a route to the same network via the same
+ * interface, its gateway is updated.
+ *
+ * @param iface Network interface that this route is tied to.
+ * @param addr IPv4 network address.
+ * @param prefix_len Length of the IPv4 network prefix.
+ * @param gw IPv4 address of the gateway, NULL or unspecified if the
+ *        network is reachable directly via the interface.
+ *
+ * @return Return created route entry, NULL if could not be created.
+ */
+struct net_route_entry_ipv4 *net_route_ipv4_add(struct net_if *iface,
+						struct in_addr *addr,
+						uint8_t prefix_len,
+						struct in_addr *gw);
+
+/**
+ * @brief Delete an IPv4 route from routing table.
+ *
+ * @param route Existing route entry.
+ *
+ * @return 0 if ok, <0 if error
+ */
+int net_route_ipv4_del(struct net_route_entry_ipv4 *route);
+
+/**
+ * @brief Lookup IPv4 route to a given destination.
+ *
+ * @param iface Network interface. If NULL, then check against all interfaces.
+ * @param dst Destination IPv4 address.
+ *
+ * @return Route with the longest prefix matching the destination, NULL
+ * if not found.
+ */
+struct net_route_entry_ipv4 *net_route_ipv4_lookup(struct net_if *iface,
+						   const struct in_addr *dst);
+
+/**
+ * @brief Get the next hop towards an IPv4 destination.
+ *
+ * @param iface Network interface. If NULL, then check against all interfaces.
+ * @param dst Destination IPv4 address.
+ * @param nexthop The gateway of the route, or the destination itself if
+ *        the route is on-link, is returned here. Can be NULL.
+ *
+ * @return Network interface of the route, NULL if there is no route.
+ */
+#if defined(CONFIG_NET_ROUTE_IPV4)
+struct net_if *net_route_ipv4_get_nexthop(struct net_if *iface,
+					  const struct in_addr *dst,
+					  struct in_addr *nexthop);
+#else
+static inline struct net_if *net_route_ipv4_get_nexthop(struct net_if *iface,
+							const struct in_addr *dst,
+							struct in_addr *nexthop)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(dst);
+	ARG_UNUSED(nexthop);
+
+	return NULL;
+}
+#endif
+
+/**
+ * @brief Go through all the IPv4 routing entries and call callback
+ * for each entry that is in use.
+ *
+ * @param cb User supplied callback function to call.
+ * @param user_data User specified data.
+ *
+ * @return Total number of IPv4 routing entries found.
+ */
+int net_route_ipv4_foreach(net_route_ipv4_cb_t cb, void *user_data);
+
 #if defined(CONFIG_NET_ROUTE) && defined(CONFIG_NET_NATIVE)
 void net_route_init(void);
 #else
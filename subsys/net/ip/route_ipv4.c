@@ -0,0 +1,223 @@
+/** @file
+ * @brief IPv4 route handling.
+ */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_route_ipv4, CONFIG_NET_ROUTE_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_ip.h>
+
+#include "net_private.h"
+#include "route.h"
+#include "route_lpm.h"
+
+static struct net_route_entry_ipv4 routes[CONFIG_NET_MAX_IPV4_ROUTES];
+
+NET_ROUTE_LPM_DEFINE(route_lpm, CONFIG_NET_MAX_IPV4_ROUTES, 32);
+
+static K_MUTEX_DEFINE(lock);
+
+static inline uint32_t prefix_mask(uint8_t prefix_len)
+{
+	return prefix_len ? htonl(UINT32_MAX << (32U - prefix_len)) : 0U;
+}
+
+static bool route_iface_match(sys_snode_t *entry, void *user_data)
+{
+	struct net_route_entry_ipv4 *route =
+		CONTAINER_OF(entry, struct net_route_entry_ipv4, lpm_node);
+
+	return route->iface == user_data;
+}
+
+static struct net_route_entry_ipv4 *route_lookup(struct net_if *iface,
+						 const struct in_addr *dst)
+{
+	sys_snode_t *entry;
+
+	entry = net_route_lpm_lookup(&route_lpm, dst->s4_addr,
+				     iface ? route_iface_match : NULL, iface);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	return CONTAINER_OF(entry, struct net_route_entry_ipv4, lpm_node);
+}
+
+struct net_route_entry_ipv4 *net_route_ipv4_add(struct net_if *iface,
+						struct in_addr *addr,
+						uint8_t prefix_len,
+						struct in_addr *gw)
+{
+	struct net_route_entry_ipv4 *route = NULL;
+	struct in_addr net;
+	sys_snode_t *entry;
+	int i;
+
+	NET_ASSERT(iface);
+	NET_ASSERT(addr);
+
+	if (prefix_len > 32U) {
+		return NULL;
+	}
+
+	net.s_addr = addr->s_addr & prefix_mask(prefix_len);
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	entry = net_route_lpm_find(&route_lpm, net.s4_addr, prefix_len,
+				   route_iface_match, iface);
+	if (entry != NULL) {
+		route = CONTAINER_OF(entry, struct net_route_entry_ipv4, lpm_node);
+
+		NET_DBG("Update route to %s/%d",
+			net_sprint_ipv4_addr(&net), prefix_len);
+		goto set_gw;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		if (!routes[i].is_used) {
+			route = &routes[i];
+			break;
+		}
+	}
+
+	if (route == NULL) {
+		NET_DBG("No free IPv4 route entries");
+		goto out;
+	}
+
+	route->iface = iface;
+	route->addr = net;
+	route->prefix_len = prefix_len;
+
+	if (net_route_lpm_insert(&route_lpm, route->addr.s4_addr, prefix_len,
+				 &route->lpm_node) < 0) {
+		NET_ERR("Cannot index route to %s/%d",
+			net_sprint_ipv4_addr(&net), prefix_len);
+		route = NULL;
+		goto out;
+	}
+
+	route->is_used = true;
+
+	NET_DBG("Added route to %s/%d iface %d",
+		net_sprint_ipv4_addr(&route->addr), prefix_len,
+		net_if_get_by_iface(iface));
+
+set_gw:
+	if (gw != NULL) {
+		net_ipaddr_copy(&route->gw, gw);
+	} else {
+		route->gw.s_addr = INADDR_ANY;
+	}
+
+out:
+	k_mutex_unlock(&lock);
+
+	return route;
+}
+
+int net_route_ipv4_del(struct net_route_entry_ipv4 *route)
+{
+	int ret = 0;
+
+	if (route < &routes[0] || route > &routes[ARRAY_SIZE(routes) - 1]) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	if (!route->is_used) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	(void)net_route_lpm_remove(&route_lpm, route->addr.s4_addr,
+				   route->prefix_len, &route->lpm_node);
+
+	route->is_used = false;
+
+	NET_DBG("Deleted route to %s/%d",
+		net_sprint_ipv4_addr(&route->addr), route->prefix_len);
+
+out:
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
+
+struct net_route_entry_ipv4 *net_route_ipv4_lookup(struct net_if *iface,
+						   const struct in_addr *dst)
+{
+	struct net_route_entry_ipv4 *route;
+
+	k_mutex_lock(&lock, K_FOREVER);
+	route = route_lookup(iface, dst);
+	k_mutex_unlock(&lock);
+
+	return route;
+}
+
+struct net_if *net_route_ipv4_get_nexthop(struct net_if *iface,
+					  const struct in_addr *dst,
+					  struct in_addr *nexthop)
+{
+	struct net_route_entry_ipv4 *route;
+	struct net_if *ret = NULL;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	route = route_lookup(iface, dst);
+	if (route == NULL) {
+		goto out;
+	}
+
+	ret = route->iface;
+
+	if (nexthop == NULL) {
+		goto out;
+	}
+
+	if (net_ipv4_is_addr_unspecified(&route->gw)) {
+		net_ipaddr_copy(nexthop, dst);
+	} else {
+		net_ipaddr_copy(nexthop, &route->gw);
+	}
+
+out:
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
+
+int net_route_ipv4_foreach(net_route_ipv4_cb_t cb, void *user_data)
+{
+	int i, ret = 0;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		if (!routes[i].is_used) {
+			continue;
+		}
+
+		cb(&routes[i], user_data);
+
+		ret++;
+	}
+
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
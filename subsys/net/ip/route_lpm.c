@@ -0,0 +1,268 @@
+/** @file
+ * @brief Longest prefix match index for the routing tables.
+ *
+ * The routes are kept in a path compressed binary trie, so a lookup
+ * visits at most one node per distinct prefix length on the path to the
+ * address instead of comparing the address against every route.
+ */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/sys/util.h>
+#include <zephyr/arch/common/ffs.h>
+
+#include "route_lpm.h"
+
+static inline uint8_t key_bit(const uint8_t *key, uint8_t pos)
+{
+	return (key[pos / 8U] >> (7U - (pos % 8U))) & 1U;
+}
+
+/* Number of leading bits, up to max, that are the same in both keys */
+static uint8_t common_len(const uint8_t *a, const uint8_t *b, uint8_t max)
+{
+	uint8_t len = 0U;
+
+	for (int i = 0; len < max; i++) {
+		uint8_t diff = a[i] ^ b[i];
+
+		if (diff != 0U) {
+			len += 8U - find_msb_set(diff);
+			break;
+		}
+
+		len += 8U;
+	}
+
+	return MIN(len, max);
+}
+
+static bool prefix_match(const uint8_t *prefix, const uint8_t *addr,
+			 uint8_t len)
+{
+	uint8_t bytes = len / 8U;
+	uint8_t bits = len % 8U;
+
+	if (memcmp(prefix, addr, bytes) != 0) {
+		return false;
+	}
+
+	if (bits == 0U) {
+		return true;
+	}
+
+	return ((prefix[bytes] ^ addr[bytes]) & (uint8_t)(0xff << (8U - bits))) == 0U;
+}
+
+static struct net_route_lpm_node *node_alloc(struct net_route_lpm *lpm,
+					     const uint8_t *key,
+					     uint8_t prefix_len)
+{
+	struct net_route_lpm_node *node;
+	uint8_t bytes = DIV_ROUND_UP(prefix_len, 8U);
+
+	if (lpm->free != NULL) {
+		node = lpm->free;
+		lpm->free = node->child[0];
+	} else if (lpm->node_used < lpm->node_count) {
+		node = &lpm->nodes[lpm->node_used++];
+	} else {
+		return NULL;
+	}
+
+	(void)memset(node, 0, sizeof(*node));
+
+	memcpy(node->key, key, bytes);
+	if (prefix_len % 8U) {
+		node->key[bytes - 1] &= (uint8_t)(0xff << (8U - prefix_len % 8U));
+	}
+
+	node->prefix_len = prefix_len;
+	sys_slist_init(&node->entries);
+
+	return node;
+}
+
+static void node_free(struct net_route_lpm *lpm, struct net_route_lpm_node *node)
+{
+	node->child[0] = lpm->free;
+	lpm->free = node;
+}
+
+static inline struct net_route_lpm_node *
+only_child(struct net_route_lpm_node *node)
+{
+	return node->child[0] != NULL ? node->child[0] : node->child[1];
+}
+
+int net_route_lpm_insert(struct net_route_lpm *lpm, const uint8_t *key,
+			 uint8_t prefix_len, sys_snode_t *entry)
+{
+	struct net_route_lpm_node **link = &lpm->root;
+	struct net_route_lpm_node *node, *leaf, *branch;
+	uint8_t len = 0U;
+
+	if (prefix_len > lpm->key_bits) {
+		return -EINVAL;
+	}
+
+	while ((node = *link) != NULL) {
+		len = common_len(node->key, key, MIN(node->prefix_len, prefix_len));
+		if (len < node->prefix_len) {
+			break;
+		}
+
+		if (node->prefix_len == prefix_len) {
+			sys_slist_append(&node->entries, entry);
+			return 0;
+		}
+
+		link = &node->child[key_bit(key, node->prefix_len)];
+	}
+
+	leaf = node_alloc(lpm, key, prefix_len);
+	if (leaf == NULL) {
+		return -ENOMEM;
+	}
+
+	sys_slist_append(&leaf->entries, entry);
+
+	if (node == NULL) {
+		*link = leaf;
+		return 0;
+	}
+
+	/* The new prefix covers the node, so it goes above it */
+	if (len == prefix_len) {
+		leaf->child[key_bit(node->key, len)] = node;
+		*link = leaf;
+		return 0;
+	}
+
+	/* Prefixes diverge after len bits, both hang from a new branch */
+	branch = node_alloc(lpm, key, len);
+	if (branch == NULL) {
+		node_free(lpm, leaf);
+		return -ENOMEM;
+	}
+
+	branch->child[key_bit(node->key, len)] = node;
+	branch->child[key_bit(key, len)] = leaf;
+	*link = branch;
+
+	return 0;
+}
+
+int net_route_lpm_remove(struct net_route_lpm *lpm, const uint8_t *key,
+			 uint8_t prefix_len, sys_snode_t *entry)
+{
+	struct net_route_lpm_node **link = &lpm->root;
+	struct net_route_lpm_node **parent_link = NULL;
+	struct net_route_lpm_node *node, *parent, *child;
+
+	while ((node = *link) != NULL) {
+		if (node->prefix_len > prefix_len ||
+		    !prefix_match(node->key, key, node->prefix_len)) {
+			return -ENOENT;
+		}
+
+		if (node->prefix_len == prefix_len) {
+			break;
+		}
+
+		parent_link = link;
+		link = &node->child[key_bit(key, node->prefix_len)];
+	}
+
+	if (node == NULL || !sys_slist_find_and_remove(&node->entries, entry)) {
+		return -ENOENT;
+	}
+
+	/* Node is still needed for other routes or as a branching node */
+	if (!sys_slist_is_empty(&node->entries) ||
+	    (node->child[0] != NULL && node->child[1] != NULL)) {
+		return 0;
+	}
+
+	child = only_child(node);
+	*link = child;
+	node_free(lpm, node);
+
+	if (child != NULL || parent_link == NULL) {
+		return 0;
+	}
+
+	/* Parent lost a child, a branching node with one child is dropped */
+	parent = *parent_link;
+	if (sys_slist_is_empty(&parent->entries)) {
+		*parent_link = only_child(parent);
+		node_free(lpm, parent);
+	}
+
+	return 0;
+}
+
+static sys_snode_t *first_entry(struct net_route_lpm_node *node,
+				net_route_lpm_filter_t filter,
+				void *user_data)
+{
+	sys_snode_t *entry;
+
+	SYS_SLIST_FOR_EACH_NODE(&node->entries, entry) {
+		if (filter == NULL || filter(entry, user_data)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+sys_snode_t *net_route_lpm_find(struct net_route_lpm *lpm, const uint8_t *key,
+				uint8_t prefix_len, net_route_lpm_filter_t filter,
+				void *user_data)
+{
+	struct net_route_lpm_node *node = lpm->root;
+
+	while (node != NULL && node->prefix_len <= prefix_len &&
+	       prefix_match(node->key, key, node->prefix_len)) {
+		if (node->prefix_len == prefix_len) {
+			return first_entry(node, filter, user_data);
+		}
+
+		node = node->child[key_bit(key, node->prefix_len)];
+	}
+
+	return NULL;
+}
+
+sys_snode_t *net_route_lpm_lookup(struct net_route_lpm *lpm,
+				  const uint8_t *addr,
+				  net_route_lpm_filter_t filter,
+				  void *user_data)
+{
+	struct net_route_lpm_node *node = lpm->root;
+	sys_snode_t *found = NULL;
+	sys_snode_t *entry;
+
+	while (node != NULL && prefix_match(node->key, addr, node->prefix_len)) {
+		entry = first_entry(node, filter, user_data);
+		if (entry != NULL) {
+			found = entry;
+		}
+
+		if (node->prefix_len == lpm->key_bits) {
+			break;
+		}
+
+		node = node->child[key_bit(addr, node->prefix_len)];
+	}
+
+	return found;
+}
@@ -0,0 +1,162 @@
+/** @file
+ * @brief Longest prefix match index for the routing tables.
+ *
+ * This is not to be included by the application.
+ */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __ROUTE_LPM_H
+#define __ROUTE_LPM_H
+
+#include <zephyr/types.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/sys/util.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Longest key (IPv6 address) that can be stored in the index, in bytes */
+#define NET_ROUTE_LPM_KEY_LEN 16
+
+/**
+ * @brief Node of the path compressed binary trie.
+ *
+ * A node either holds one or more routes with the same prefix, or it is
+ * a branching node without routes that always has two children.
+ */
+struct net_route_lpm_node {
+	/** Children, selected by the bit that follows the prefix */
+	struct net_route_lpm_node *child[2];
+
+	/** Routes having this prefix, empty for a branching node */
+	sys_slist_t entries;
+
+	/** Prefix, the bits after prefix_len are zero */
+	uint8_t key[NET_ROUTE_LPM_KEY_LEN];
+
+	/** Prefix length in bits */
+	uint8_t prefix_len;
+};
+
+/**
+ * @brief Longest prefix match index.
+ */
+struct net_route_lpm {
+	/** Root of the trie */
+	struct net_route_lpm_node *root;
+
+	/** Released nodes, linked through child[0] */
+	struct net_route_lpm_node *free;
+
+	/** Node storage */
+	struct net_route_lpm_node *nodes;
+
+	/** Number of nodes in storage */
+	uint16_t node_count;
+
+	/** Number of nodes in storage that have been used at least once */
+	uint16_t node_used;
+
+	/** Key length in bits, 32 for IPv4 and 128 for IPv6 */
+	uint8_t key_bits;
+};
+
+/**
+ * @brief Define a longest prefix match index.
+ *
+ * A trie holding N different prefixes has at most N - 1 branching
+ * nodes, so twice the number of routes is always enough.
+ *
+ * @param _name Name of the index.
+ * @param _routes Max number of routes stored in the index.
+ * @param _key_bits Key length in bits.
+ */
+#define NET_ROUTE_LPM_DEFINE(_name, _routes, _key_bits)			\
+	static struct net_route_lpm_node _name##_nodes[2 * (_routes)];	\
+	static struct net_route_lpm _name = {				\
+		.nodes = _name##_nodes,					\
+		.node_count = ARRAY_SIZE(_name##_nodes),		\
+		.key_bits = _key_bits,					\
+	}
+
+/**
+ * @brief Filter callback used when looking up a route.
+ *
+ * @param entry Route node that was given to net_route_lpm_insert().
+ * @param user_data User data given to net_route_lpm_lookup().
+ *
+ * @return True if the route can be used.
+ */
+typedef bool (*net_route_lpm_filter_t)(sys_snode_t *entry, void *user_data);
+
+/**
+ * @brief Add a route to the index.
+ *
+ * @param lpm Index to use.
+ * @param key Route prefix, in network byte order.
+ * @param prefix_len Length of the prefix in bits.
+ * @param entry Node of the route, it is linked to the prefix.
+ *
+ * @return 0 if ok, -EINVAL if the prefix is too long, -ENOMEM if there
+ * are no free nodes.
+ */
+int net_route_lpm_insert(struct net_route_lpm *lpm, const uint8_t *key,
+			 uint8_t prefix_len, sys_snode_t *entry);
+
+/**
+ * @brief Remove a route from the index.
+ *
+ * @param lpm Index to use.
+ * @param key Route prefix given to net_route_lpm_insert().
+ * @param prefix_len Prefix length given to net_route_lpm_insert().
+ * @param entry Node of the route.
+ *
+ * @return 0 if ok, -ENOENT if the route was not found.
+ */
+int net_route_lpm_remove(struct net_route_lpm *lpm, const uint8_t *key,
+			 uint8_t prefix_len, sys_snode_t *entry);
+
+/**
+ * @brief Find a route having exactly the given prefix.
+ *
+ * @param lpm Index to use.
+ * @param key Route prefix, in network byte order.
+ * @param prefix_len Length of the prefix in bits.
+ * @param filter Filter for the routes, NULL accepts all the routes.
+ * @param user_data User data passed to the filter.
+ *
+ * @return Node of the first route accepted by the filter, NULL if none.
+ */
+sys_snode_t *net_route_lpm_find(struct net_route_lpm *lpm, const uint8_t *key,
+				uint8_t prefix_len, net_route_lpm_filter_t filter,
+				void *user_data);
+
+/**
+ * @brief Find the route with the longest prefix matching an address.
+ *
+ * When several routes have the same prefix, the first one accepted by
+ * the filter is returned.
+ *
+ * @param lpm Index to use.
+ * @param addr Address to match, in network byte order.
+ * @param filter Filter for the routes, NULL accepts all the routes.
+ * @param user_data User data passed to the filter.
+ *
+ * @return Node of the route, NULL if there is no matching route.
+ */
+sys_snode_t *net_route_lpm_lookup(struct net_route_lpm *lpm,
+				  const uint8_t *addr,
+				  net_route_lpm_filter_t filter,
+				  void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ROUTE_LPM_H */
@@ -1556,9 +1556,28 @@ static int tcp_pkt_pull(struct net_pkt *pkt, size_t len)
 		goto out;
 	}
 
+	/* Same as net_pkt_pull() but caller supplied data, which is queued
+	 * without copying, is never moved. For such buffers only the data
+	 * pointer is advanced.
+	 */
+	while (len > 0 && pkt->buffer != NULL) {
+		struct net_buf *buf = pkt->buffer;
+		size_t rem = MIN(len, buf->len);
+
+		if (rem == buf->len) {
+			pkt->buffer = net_buf_frag_del(NULL, buf);
+		} else if (buf->flags & NET_BUF_EXTERNAL_DATA) {
+			net_buf_pull(buf, rem);
+		} else {
+			memmove(buf->data, buf->data + rem, buf->len - rem);
+			buf->len -= rem;
+		}
+
+		len -= rem;
+	}
+
 	net_pkt_cursor_init(pkt);
 	net_pkt_set_overwrite(pkt, true);
-	net_pkt_pull(pkt, len);
 	net_pkt_trim_buffer(pkt);
  out:
 	return ret;
@@ -1581,12 +1600,22 @@ static int tcp_pkt_peek(struct net_pkt *to, struct net_pkt *from, size_t pos,
 static int tcp_pkt_append(struct net_pkt *pkt, const uint8_t *data, size_t len)
 {
 	size_t alloc_len = len;
+	struct net_buf *last = NULL;
 	struct net_buf *buf = NULL;
 	int ret = 0;
 
 	if (pkt->buffer) {
-		buf = net_buf_frag_last(pkt->buffer);
+		last = net_buf_frag_last(pkt->buffer);
 
+		/* Caller supplied data queued without copying is not
+		 * written to.
+		 */
+		if (!(last->flags & NET_BUF_EXTERNAL_DATA)) {
+			buf = last;
+		}
+	}
+
+	if (buf != NULL) {
 		if (len > net_buf_tailroom(buf)) {
 			alloc_len -= net_buf_tailroom(buf);
 		} else {
@@ -1603,7 +1632,7 @@ static int tcp_pkt_append(struct net_pkt *pkt, const uint8_t *data, size_t len)
 	}
 
 	if (buf == NULL) {
-		buf = pkt->buffer;
+		buf = (last != NULL) ? last->frags : pkt->buffer;
 	}
 
 	while (buf != NULL && len > 0) {
@@ -3708,6 +3737,78 @@ out:
 	return ret;
 }
 
+int net_tcp_queue_buf(struct net_context *context, struct net_buf **data)
+{
+	struct tcp *conn = context->tcp;
+	struct net_buf *head = *data;
+	struct net_buf *last = NULL;
+	struct net_buf *frag;
+	size_t queued_len = 0;
+	size_t len;
+	int ret = 0;
+
+	if (!conn || conn->state != TCP_ESTABLISHED) {
+		return -ENOTCONN;
+	}
+
+	k_mutex_lock(&conn->lock, K_FOREVER);
+
+	if (tcp_window_full(conn)) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	/* Queue no more than TX window permits, see net_tcp_queue().
+	 * Fragments that fit are queued as a whole, and the part of the
+	 * next one that still fits is copied to the send queue.
+	 */
+	len = conn->send_win - conn->send_data_total;
+
+	for (frag = head; frag != NULL && frag->len <= len - queued_len;
+	     frag = frag->frags) {
+		queued_len += frag->len;
+		last = frag;
+	}
+
+	if (last != NULL) {
+		last->frags = NULL;
+		net_pkt_append_buffer(conn->send_data, head);
+	}
+
+	if (frag != NULL && queued_len < len) {
+		len -= queued_len;
+
+		ret = tcp_pkt_append(conn->send_data, frag->data, len);
+		if (ret == 0) {
+			net_buf_pull(frag, len);
+			queued_len += len;
+		} else if (last == NULL) {
+			goto out;
+		}
+	}
+
+	*data = frag;
+	conn->send_data_total += queued_len;
+
+	/* The fragments belong to the send queue now, so a transmit failure
+	 * is reported by the next call instead.
+	 */
+	ret = tcp_send_queued_data(conn);
+	if (ret < 0 && ret != -ENOBUFS) {
+		tcp_conn_close(conn, ret);
+	}
+
+	if (tcp_window_full(conn)) {
+		(void)k_sem_take(&conn->tx_sem, K_NO_WAIT);
+	}
+
+	ret = queued_len;
+out:
+	k_mutex_unlock(&conn->lock);
+
+	return ret;
+}
+
 /* net context is about to send out queued data - inform caller only */
 int net_tcp_send_data(struct net_context *context, net_context_send_cb_t cb,
 		      void *user_data)
@@ -3995,6 +4096,7 @@ struct net_tcp_hdr *net_tcp_input(struct net_pkt *pkt,
 	if (IS_ENABLED(CONFIG_NET_TCP_CHECKSUM) &&
 	    (net_if_need_calc_rx_checksum(net_pkt_iface(pkt)) ||
 	     net_pkt_is_ip_reassembled(pkt)) &&
+	    !net_pkt_is_rx_chksum_verified(pkt) &&
 	    net_calc_chksum_tcp(pkt) != 0U) {
 		NET_DBG("DROP: checksum mismatch");
 		goto drop;
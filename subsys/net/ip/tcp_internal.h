@@ -312,6 +312,33 @@ static inline int net_tcp_queue(struct net_context *context, const void *data,
 }
 #endif
 
+/**
+ * @brief Enqueue caller supplied buffers for transmission
+ *
+ * Whole fragments that fit in the TX window are moved to the send queue
+ * without copying the data, and the part of the next fragment that still
+ * fits is copied. The fragments are released after the data in them has
+ * been acknowledged. On error the chain is left untouched.
+ *
+ * @param context	Network context
+ * @param data		Fragment chain, set to the fragments that were not
+ *			queued
+ *
+ * @return Number of bytes queued, < 0 if error
+ */
+#if defined(CONFIG_NET_NATIVE_TCP)
+int net_tcp_queue_buf(struct net_context *context, struct net_buf **data);
+#else
+static inline int net_tcp_queue_buf(struct net_context *context,
+				    struct net_buf **data)
+{
+	ARG_UNUSED(context);
+	ARG_UNUSED(data);
+
+	return -EPROTONOSUPPORT;
+}
+#endif
+
 /**
  * @brief Update TCP receive window
  *
@@ -520,18 +520,136 @@ static uint16_t offset_based_swap8(const uint8_t *data)
 	}
 }
 
+#if defined(CONFIG_NET_IP_CHKSUM_SSE2)
+#include <emmintrin.h>
+
+#if !defined(__SSE2__)
+#error "SSE2 checksum selected but the compiler does not enable SSE2"
+#endif
+
+/* Widen the 32-bit words to 64-bit lanes so that no carries are lost, two
+ * 16 byte vectors are handled per round.
+ */
+static uint64_t chksum_bulk(uint64_t sum, const uint32_t **data, size_t *pending)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const uint8_t *p = (const uint8_t *)*data;
+	__m128i acc_a = zero;
+	__m128i acc_b = zero;
+	uint64_t lanes[2];
+
+	while (*pending >= 2 * sizeof(__m128i)) {
+		__m128i a = _mm_loadu_si128((const __m128i *)p);
+		__m128i b = _mm_loadu_si128((const __m128i *)(p + sizeof(__m128i)));
+
+		acc_a = _mm_add_epi64(acc_a, _mm_unpacklo_epi32(a, zero));
+		acc_b = _mm_add_epi64(acc_b, _mm_unpackhi_epi32(a, zero));
+		acc_a = _mm_add_epi64(acc_a, _mm_unpacklo_epi32(b, zero));
+		acc_b = _mm_add_epi64(acc_b, _mm_unpackhi_epi32(b, zero));
+
+		p += 2 * sizeof(__m128i);
+		*pending -= 2 * sizeof(__m128i);
+	}
+
+	_mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(acc_a, acc_b));
+
+	*data = (const uint32_t *)p;
+
+	return sum + (lanes[0] & 0xffffffff) + (lanes[0] >> 32) +
+		(lanes[1] & 0xffffffff) + (lanes[1] >> 32);
+}
+#elif defined(CONFIG_NET_IP_CHKSUM_NEON)
+#include <arm_neon.h>
+
+/* Pairwise add the 32-bit words into 64-bit lanes, two 16 byte vectors
+ * are handled per round.
+ */
+static uint64_t chksum_bulk(uint64_t sum, const uint32_t **data, size_t *pending)
+{
+	const uint32_t *p = *data;
+	uint64x2_t acc_a = vdupq_n_u64(0);
+	uint64x2_t acc_b = vdupq_n_u64(0);
+
+	while (*pending >= 2 * sizeof(uint32x4_t)) {
+		acc_a = vpadalq_u32(acc_a, vld1q_u32(p));
+		acc_b = vpadalq_u32(acc_b, vld1q_u32(p + 4));
+
+		p += 8;
+		*pending -= 2 * sizeof(uint32x4_t);
+	}
+
+	acc_a = vaddq_u64(acc_a, acc_b);
+
+	*data = p;
+
+	return sum + (vgetq_lane_u64(acc_a, 0) & 0xffffffff) +
+		(vgetq_lane_u64(acc_a, 0) >> 32) +
+		(vgetq_lane_u64(acc_a, 1) & 0xffffffff) +
+		(vgetq_lane_u64(acc_a, 1) >> 32);
+}
+#elif defined(CONFIG_NET_IP_CHKSUM_ARM_ADC)
+/* The ones' complement sum is carry bound, so use the add-with-carry chain
+ * of Thumb-2 instead of widening to 64-bit sums.
+ */
+static uint64_t chksum_bulk(uint64_t sum, const uint32_t **data, size_t *pending)
+{
+	const uint32_t *p = *data;
+	uint32_t acc = 0;
+
+	while (*pending >= sizeof(uint32_t) * 4) {
+		__asm__ ("adds %0, %0, %1\n\t"
+			 "adcs %0, %0, %2\n\t"
+			 "adcs %0, %0, %3\n\t"
+			 "adcs %0, %0, %4\n\t"
+			 "adc %0, %0, #0\n\t"
+			 : "+r" (acc)
+			 : "r" (p[0]), "r" (p[1]), "r" (p[2]), "r" (p[3])
+			 : "cc");
+
+		p += 4;
+		*pending -= sizeof(uint32_t) * 4;
+	}
+
+	*data = p;
+
+	return sum + acc;
+}
+#else
+static uint64_t chksum_bulk(uint64_t sum, const uint32_t **data, size_t *pending)
+{
+	const uint32_t *p = *data;
+
+	/* Do loop unrolling for the very large data sets */
+	while (*pending >= sizeof(uint32_t) * 4) {
+		uint64_t sum_a = p[0];
+		uint64_t sum_b = p[1];
+
+		*pending -= sizeof(uint32_t) * 4;
+		sum_a += p[2];
+		sum_b += p[3];
+		p += 4;
+		sum += sum_a + sum_b;
+	}
+
+	*data = p;
+
+	return sum;
+}
+#endif /* CONFIG_NET_IP_CHKSUM_SSE2 */
+
 /* Word based checksum calculation based on:
  * https://blogs.igalia.com/dpino/2018/06/14/fast-checksum-computation/
  * It’s not necessary to add octets as 16-bit words. Due to the associative property of addition,
  * it is possible to do parallel addition using larger word sizes such as 32-bit or 64-bit words.
  * In those cases the variable that stores the accumulative sum has to be bigger too.
  * Once the sum is computed a final step folds the sum to a 16-bit word (adding carry if any).
+ * The bulk of the data is summed by chksum_bulk(), which is selected at build time by
+ * CONFIG_NET_IP_CHKSUM_IMPL.
  */
 uint16_t calc_chksum(uint16_t sum_in, const uint8_t *data, size_t len)
 {
 	uint64_t sum;
-	uint32_t *p;
-	size_t i = 0;
+	const uint32_t *p;
 	size_t pending = len;
 	int odd_start = ((uintptr_t)data & 0x01);
 
@@ -555,24 +673,15 @@ uint16_t calc_chksum(uint16_t sum_in, const uint8_t *data, size_t len)
 		sum = sum + *((uint16_t *)data);
 		data += sizeof(uint16_t);
 	}
-	p = (uint32_t *)data;
+	p = (const uint32_t *)data;
+
+	sum = chksum_bulk(sum, &p, &pending);
 
-	/* Do loop unrolling for the very large data sets */
-	while (pending >= sizeof(uint32_t) * 4) {
-		uint64_t sum_a = p[i];
-		uint64_t sum_b = p[i + 1];
-
-		pending -= sizeof(uint32_t) * 4;
-		sum_a += p[i + 2];
-		sum_b += p[i + 3];
-		i += 4;
-		sum += sum_a + sum_b;
-	}
 	while (pending >= sizeof(uint32_t)) {
 		pending -= sizeof(uint32_t);
-		sum = sum + p[i++];
+		sum = sum + *p++;
 	}
-	data = (uint8_t *)(p + i);
+	data = (const uint8_t *)p;
 	if (pending >= 2) {
 		pending -= sizeof(uint16_t);
 		sum = sum + *((uint16_t *)data);
@@ -597,6 +706,35 @@ uint16_t calc_chksum(uint16_t sum_in, const uint8_t *data, size_t len)
 	}
 }
 
+uint16_t net_chksum_update(uint16_t chksum, const uint8_t *old_data,
+			   const uint8_t *new_data, size_t len)
+{
+	uint32_t sum = (uint16_t)~chksum;
+	size_t i;
+
+	/* RFC 1624, eqn. 3 applied one 16-bit word at a time. The words are
+	 * read in memory order, just like the checksum field itself.
+	 */
+	for (i = 0; i + 1 < len; i += 2) {
+		sum += (uint16_t)~UNALIGNED_GET((const uint16_t *)&old_data[i]);
+		sum += UNALIGNED_GET((const uint16_t *)&new_data[i]);
+	}
+
+	if (len & 1) {
+		uint8_t old_word[2] = { old_data[len - 1], 0 };
+		uint8_t new_word[2] = { new_data[len - 1], 0 };
+
+		sum += (uint16_t)~UNALIGNED_GET((const uint16_t *)old_word);
+		sum += UNALIGNED_GET((const uint16_t *)new_word);
+	}
+
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return (uint16_t)~sum;
+}
+
 static inline uint16_t pkt_calc_chksum(struct net_pkt *pkt, uint16_t sum)
 {
 	struct net_pkt_cursor *cur = &pkt->cursor;
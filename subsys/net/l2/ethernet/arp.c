@@ -16,9 +16,12 @@ LOG_MODULE_REGISTER(net_arp, CONFIG_NET_ARP_LOG_LEVEL);
 #include <zephyr/net/net_pkt.h>
 #include <zephyr/net/net_if.h>
 #include <zephyr/net/net_stats.h>
+#include <zephyr/sys/barrier.h>
+#include <zephyr/sys/byteorder.h>
 
 #include "arp.h"
 #include "net_private.h"
+#include "route.h"
 
 #define NET_BUF_TIMEOUT K_MSEC(100)
 #define ARP_REQUEST_TIMEOUT (2 * MSEC_PER_SEC)
@@ -26,28 +29,88 @@ LOG_MODULE_REGISTER(net_arp, CONFIG_NET_ARP_LOG_LEVEL);
 static bool arp_cache_initialized;
 static struct arp_entry arp_entries[CONFIG_NET_ARP_TABLE_SIZE];
 
+BUILD_ASSERT((CONFIG_NET_ARP_HASH_SIZE & (CONFIG_NET_ARP_HASH_SIZE - 1)) == 0,
+	     "CONFIG_NET_ARP_HASH_SIZE must be a power of two");
+
 static sys_slist_t arp_free_entries;
 static sys_slist_t arp_pending_entries;
 static sys_slist_t arp_table;
 
+/* Resolved entries, hashed by IPv4 address. The buckets are modified with
+ * arp_mutex held and arp_table_seq odd, so that they can be read without
+ * taking arp_mutex, see arp_entry_lookup().
+ */
+static sys_slist_t arp_hash_table[CONFIG_NET_ARP_HASH_SIZE];
+static atomic_t arp_table_seq;
+
 static struct k_work_delayable arp_request_timer;
 
 static struct k_mutex arp_mutex;
 
+/* Packets waiting for a resolution are linked through their first word,
+ * which is reserved for queueing the packet like with a k_fifo.
+ */
+#define PENDING_NODE(pkt) ((sys_snode_t *)&(pkt)->fifo)
+#define PENDING_PKT(node) CONTAINER_OF((intptr_t *)(node), struct net_pkt, fifo)
+
+static void arp_pending_release(sys_slist_t *pending)
+{
+	sys_snode_t *node;
+
+	while ((node = sys_slist_get(pending)) != NULL) {
+		struct net_pkt *pkt = PENDING_PKT(node);
+
+		NET_DBG("Releasing pending pkt %p (ref %ld)",
+			pkt,
+			atomic_get(&pkt->atomic_ref) - 1);
+		net_pkt_unref(pkt);
+	}
+}
+
+static inline void arp_table_update_begin(void)
+{
+	atomic_inc(&arp_table_seq);
+}
+
+static inline void arp_table_update_end(void)
+{
+	atomic_inc(&arp_table_seq);
+}
+
+static inline sys_slist_t *arp_hash_bucket(const struct in_addr *addr)
+{
+	/* Host order so that the host part ends in the kept bits */
+	uint32_t hash = ntohl(UNALIGNED_GET(&addr->s_addr)) * 0x9e3779b1U;
+
+	return &arp_hash_table[(hash >> 16) & (CONFIG_NET_ARP_HASH_SIZE - 1)];
+}
+
+static void arp_table_insert(struct arp_entry *entry)
+{
+	entry->last_used = k_uptime_get_32();
+
+	arp_table_update_begin();
+	sys_slist_prepend(arp_hash_bucket(&entry->ip), &entry->hash_node);
+	arp_table_update_end();
+
+	sys_slist_prepend(&arp_table, &entry->node);
+}
+
+static void arp_table_remove(struct arp_entry *entry, sys_snode_t *prev)
+{
+	arp_table_update_begin();
+	sys_slist_find_and_remove(arp_hash_bucket(&entry->ip), &entry->hash_node);
+	arp_table_update_end();
+
+	sys_slist_remove(&arp_table, prev, &entry->node);
+}
+
 static void arp_entry_cleanup(struct arp_entry *entry, bool pending)
 {
 	NET_DBG("entry %p", entry);
 
 	if (pending) {
-		struct net_pkt *pkt;
-
-		while (!k_fifo_is_empty(&entry->pending_queue)) {
-			pkt = k_fifo_get(&entry->pending_queue, K_FOREVER);
-			NET_DBG("Releasing pending pkt %p (ref %ld)",
-				pkt,
-				atomic_get(&pkt->atomic_ref) - 1);
-			net_pkt_unref(pkt);
-		}
+		arp_pending_release(&entry->pending_queue);
 	}
 
 	entry->iface = NULL;
@@ -81,28 +144,65 @@ static struct arp_entry *arp_entry_find(sys_slist_t *list,
 	return NULL;
 }
 
-static inline struct arp_entry *arp_entry_find_move_first(struct net_if *iface,
-							  struct in_addr *dst)
+/* Must be called with arp_mutex held */
+static struct arp_entry *arp_entry_find_resolved(struct net_if *iface,
+						 struct in_addr *dst)
 {
-	sys_snode_t *prev = NULL;
 	struct arp_entry *entry;
 
-	NET_DBG("dst %s", net_sprint_ipv4_addr(dst));
+	SYS_SLIST_FOR_EACH_CONTAINER(arp_hash_bucket(dst), entry, hash_node) {
+		if (entry->iface == iface &&
+		    net_ipv4_addr_cmp(&entry->ip, dst)) {
+			return entry;
+		}
+	}
 
-	entry = arp_entry_find(&arp_table, iface, dst, &prev);
-	if (entry) {
-		/* Let's assume the target is going to be accessed
-		 * more than once here in a short time frame. So we
-		 * place the entry first in position into the table
-		 * in order to reduce subsequent find.
-		 */
-		if (&entry->node != sys_slist_peek_head(&arp_table)) {
-			sys_slist_remove(&arp_table, prev, &entry->node);
-			sys_slist_prepend(&arp_table, &entry->node);
+	return NULL;
+}
+
+/* Find a resolved entry without taking arp_mutex. The lookup is only
+ * trusted if no update of the table started or ended meanwhile, and the
+ * walk is bounded as an entry can move to another bucket under it.
+ * Returns false if the caller must look the entry up with arp_mutex held.
+ */
+static bool arp_entry_lookup(struct net_if *iface, struct in_addr *dst,
+			     struct arp_entry **found)
+{
+	sys_slist_t *bucket = arp_hash_bucket(dst);
+	int budget = CONFIG_NET_ARP_TABLE_SIZE;
+	struct arp_entry *entry;
+	atomic_val_t seq;
+
+	seq = atomic_get(&arp_table_seq);
+	if (seq & 1) {
+		return false;
+	}
+
+	*found = NULL;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(bucket, entry, hash_node) {
+		if (budget-- == 0) {
+			return false;
+		}
+
+		if (entry->iface == iface &&
+		    net_ipv4_addr_cmp(&entry->ip, dst)) {
+			*found = entry;
+			break;
 		}
 	}
 
-	return entry;
+	barrier_dmem_fence_full();
+
+	if (atomic_get(&arp_table_seq) != seq) {
+		return false;
+	}
+
+	if (*found != NULL) {
+		(*found)->last_used = k_uptime_get_32();
+	}
+
+	return true;
 }
 
 static inline
@@ -152,20 +252,30 @@ static struct arp_entry *arp_entry_get_free(void)
 
 static struct arp_entry *arp_entry_get_last_from_table(void)
 {
-	sys_snode_t *node;
+	struct arp_entry *entry, *oldest = NULL;
+	sys_snode_t *prev = NULL, *oldest_prev = NULL;
+	uint32_t now = k_uptime_get_32();
 
-	/* We assume last entry is the oldest one,
-	 * so is the preferred one to be taken out.
+	/* The least recently used entry is the preferred one to be
+	 * taken out.
 	 */
+	SYS_SLIST_FOR_EACH_CONTAINER(&arp_table, entry, node) {
+		if (oldest == NULL ||
+		    (now - entry->last_used) > (now - oldest->last_used)) {
+			oldest = entry;
+			oldest_prev = prev;
+		}
 
-	node = sys_slist_peek_tail(&arp_table);
-	if (!node) {
+		prev = &entry->node;
+	}
+
+	if (oldest == NULL) {
 		return NULL;
 	}
 
-	sys_slist_find_and_remove(&arp_table, node);
+	arp_table_remove(oldest, oldest_prev);
 
-	return CONTAINER_OF(node, struct arp_entry, node);
+	return oldest;
 }
 
 
@@ -284,7 +394,8 @@ static inline struct net_pkt *arp_prepare(struct net_if *iface,
 	 */
 	if (entry) {
 		if (!net_pkt_ipv4_auto(pkt)) {
-			k_fifo_put(&entry->pending_queue, net_pkt_ref(pending));
+			sys_slist_append(&entry->pending_queue,
+					 PENDING_NODE(net_pkt_ref(pending)));
 		}
 
 		entry->iface = net_pkt_iface(pkt);
@@ -320,8 +431,11 @@ static inline struct net_pkt *arp_prepare(struct net_if *iface,
 
 	if (net_pkt_ipv4_auto(pkt)) {
 		my_addr = current_ip;
-	} else if (!entry) {
+	} else if (!entry && !net_pkt_forwarding(pending)) {
 		my_addr = (struct in_addr *)NET_IPV4_HDR(pending)->src;
+	} else if (!entry) {
+		/* Source of a forwarded packet is not our address */
+		my_addr = if_get_addr(iface, current_ip);
 	} else {
 		my_addr = if_get_addr(entry->iface, current_ip);
 	}
@@ -341,6 +455,7 @@ struct net_pkt *net_arp_prepare(struct net_pkt *pkt,
 {
 	bool is_ipv4_ll_used = false;
 	struct arp_entry *entry;
+	struct in_addr nexthop;
 	struct in_addr *addr;
 
 	if (!pkt || !pkt->buffer) {
@@ -355,13 +470,16 @@ struct net_pkt *net_arp_prepare(struct net_pkt *pkt,
 	}
 
 	/* Is the destination in the local network, if not route via
-	 * the gateway address.
+	 * the gateway of the route to it, or via the default gateway.
 	 */
 	if (!current_ip && !is_ipv4_ll_used &&
 	    !net_if_ipv4_addr_mask_cmp(net_pkt_iface(pkt), request_ip)) {
 		struct net_if_ipv4 *ipv4 = net_pkt_iface(pkt)->config.ip.ipv4;
 
-		if (ipv4) {
+		if (net_route_ipv4_get_nexthop(net_pkt_iface(pkt), request_ip,
+					       &nexthop) != NULL) {
+			addr = &nexthop;
+		} else if (ipv4) {
 			addr = &ipv4->gw;
 			if (net_ipv4_is_addr_unspecified(addr)) {
 				NET_ERR("Gateway not set for iface %p",
@@ -376,12 +494,16 @@ struct net_pkt *net_arp_prepare(struct net_pkt *pkt,
 		addr = request_ip;
 	}
 
-	k_mutex_lock(&arp_mutex, K_FOREVER);
-
 	/* If the destination address is already known, we do not need
 	 * to send any ARP packet.
 	 */
-	entry = arp_entry_find_move_first(net_pkt_iface(pkt), addr);
+	if (arp_entry_lookup(net_pkt_iface(pkt), addr, &entry) && entry) {
+		goto resolved;
+	}
+
+	k_mutex_lock(&arp_mutex, K_FOREVER);
+
+	entry = arp_entry_find_resolved(net_pkt_iface(pkt), addr);
 	if (!entry) {
 		struct net_pkt *req;
 
@@ -398,11 +520,16 @@ struct net_pkt *net_arp_prepare(struct net_pkt *pkt,
 			 * in the pending list and if so, resend the request, otherwise just
 			 * append the packet to the request fifo list.
 			 */
-			if (!net_pkt_ipv4_auto(pkt) &&
-			    k_queue_unique_append(&entry->pending_queue._queue,
-						  net_pkt_ref(pkt))) {
-				k_mutex_unlock(&arp_mutex);
-				return NULL;
+			if (!net_pkt_ipv4_auto(pkt)) {
+				net_pkt_ref(pkt);
+
+				if (!sys_slist_find(&entry->pending_queue,
+						    PENDING_NODE(pkt), NULL)) {
+					sys_slist_append(&entry->pending_queue,
+							 PENDING_NODE(pkt));
+					k_mutex_unlock(&arp_mutex);
+					return NULL;
+				}
 			}
 
 			entry = NULL;
@@ -432,6 +559,7 @@ struct net_pkt *net_arp_prepare(struct net_pkt *pkt,
 
 	k_mutex_unlock(&arp_mutex);
 
+resolved:
 	net_pkt_lladdr_src(pkt)->addr =
 		(uint8_t *)net_if_get_link_addr(entry->iface)->addr;
 	net_pkt_lladdr_src(pkt)->len = sizeof(struct net_eth_addr);
@@ -451,10 +579,9 @@ static void arp_gratuitous(struct net_if *iface,
 			   struct in_addr *src,
 			   struct net_eth_addr *hwaddr)
 {
-	sys_snode_t *prev = NULL;
 	struct arp_entry *entry;
 
-	entry = arp_entry_find(&arp_table, iface, src, &prev);
+	entry = arp_entry_find_resolved(iface, src);
 	if (entry) {
 		NET_DBG("Gratuitous ARP hwaddr %s -> %s",
 			net_sprint_ll_addr((const uint8_t *)&entry->eth,
@@ -462,7 +589,9 @@ static void arp_gratuitous(struct net_if *iface,
 			net_sprint_ll_addr((const uint8_t *)hwaddr,
 					   sizeof(struct net_eth_addr)));
 
+		arp_table_update_begin();
 		memcpy(&entry->eth, hwaddr, sizeof(struct net_eth_addr));
+		arp_table_update_end();
 	}
 }
 
@@ -473,7 +602,8 @@ void net_arp_update(struct net_if *iface,
 		    bool force)
 {
 	struct arp_entry *entry;
-	struct net_pkt *pkt;
+	sys_slist_t pending;
+	sys_snode_t *node;
 
 	NET_DBG("iface %d (%p) src %s", net_if_get_by_iface(iface), iface,
 		net_sprint_ipv4_addr(src));
@@ -487,13 +617,14 @@ void net_arp_update(struct net_if *iface,
 		}
 
 		if (force) {
-			sys_snode_t *prev = NULL;
 			struct arp_entry *arp_ent;
 
-			arp_ent = arp_entry_find(&arp_table, iface, src, &prev);
+			arp_ent = arp_entry_find_resolved(iface, src);
 			if (arp_ent) {
+				arp_table_update_begin();
 				memcpy(&arp_ent->eth, hwaddr,
 				       sizeof(struct net_eth_addr));
+				arp_table_update_end();
 			} else {
 				/* Add new entry as it was not found and force
 				 * was set.
@@ -509,7 +640,7 @@ void net_arp_update(struct net_if *iface,
 					arp_ent->iface = iface;
 					net_ipaddr_copy(&arp_ent->ip, src);
 					memcpy(&arp_ent->eth, hwaddr, sizeof(arp_ent->eth));
-					sys_slist_prepend(&arp_table, &arp_ent->node);
+					arp_table_insert(arp_ent);
 				}
 			}
 		}
@@ -522,12 +653,20 @@ void net_arp_update(struct net_if *iface,
 	memcpy(&entry->eth, hwaddr, sizeof(struct net_eth_addr));
 
 	/* Inserting entry into the table */
-	sys_slist_prepend(&arp_table, &entry->node);
+	arp_table_insert(entry);
 
-	while (!k_fifo_is_empty(&entry->pending_queue)) {
-		int ret;
+	/* Take all the pending packets at once, new packets to this
+	 * destination do not wait anymore and the entry can be reused
+	 * as soon as arp_mutex is released.
+	 */
+	pending = entry->pending_queue;
+	sys_slist_init(&entry->pending_queue);
 
-		pkt = k_fifo_get(&entry->pending_queue, K_FOREVER);
+	k_mutex_unlock(&arp_mutex);
+
+	while ((node = sys_slist_get(&pending)) != NULL) {
+		struct net_pkt *pkt = PENDING_PKT(node);
+		int ret;
 
 		/* Set the dst in the pending packet */
 		net_pkt_lladdr_dst(pkt)->len = sizeof(struct net_eth_addr);
@@ -536,7 +675,7 @@ void net_arp_update(struct net_if *iface,
 
 		NET_DBG("iface %d (%p) dst %s pending %p frag %p",
 			net_if_get_by_iface(iface), iface,
-			net_sprint_ipv4_addr(&entry->ip),
+			net_sprint_ipv4_addr(src),
 			pkt, pkt->frags);
 
 		/* We directly send the packet without first queueing it.
@@ -552,7 +691,6 @@ void net_arp_update(struct net_if *iface,
 		}
 	}
 
-	k_mutex_unlock(&arp_mutex);
 	net_if_tx_unlock(iface);
 }
 
@@ -754,9 +892,9 @@ void net_arp_clear_cache(struct net_if *iface)
 			continue;
 		}
 
+		arp_table_remove(entry, prev);
 		arp_entry_cleanup(entry, false);
 
-		sys_slist_remove(&arp_table, prev, &entry->node);
 		sys_slist_prepend(&arp_free_entries, &entry->node);
 	}
 
@@ -786,14 +924,20 @@ void net_arp_clear_cache(struct net_if *iface)
 
 int net_arp_clear_pending(struct net_if *iface, struct in_addr *dst)
 {
-	struct arp_entry *entry = arp_entry_find_pending(iface, dst);
+	struct arp_entry *entry;
+
+	k_mutex_lock(&arp_mutex, K_FOREVER);
 
+	entry = arp_entry_find_pending(iface, dst);
 	if (!entry) {
+		k_mutex_unlock(&arp_mutex);
 		return -ENOENT;
 	}
 
 	arp_entry_cleanup(entry, true);
 
+	k_mutex_unlock(&arp_mutex);
+
 	return 0;
 }
 
@@ -826,9 +970,13 @@ void net_arp_init(void)
 	sys_slist_init(&arp_pending_entries);
 	sys_slist_init(&arp_table);
 
+	for (i = 0; i < CONFIG_NET_ARP_HASH_SIZE; i++) {
+		sys_slist_init(&arp_hash_table[i]);
+	}
+
 	for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
 		/* Inserting entry as free with initialised packet queue */
-		k_fifo_init(&arp_entries[i].pending_queue);
+		sys_slist_init(&arp_entries[i].pending_queue);
 		sys_slist_prepend(&arp_free_entries, &arp_entries[i].node);
 	}
 
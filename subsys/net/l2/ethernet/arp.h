@@ -54,11 +54,13 @@ int net_arp_clear_pending(struct net_if *iface,
 
 struct arp_entry {
 	sys_snode_t node;
+	sys_snode_t hash_node;
 	uint32_t req_start;
+	uint32_t last_used;
 	struct net_if *iface;
 	struct in_addr ip;
 	struct net_eth_addr eth;
-	struct k_fifo pending_queue;
+	sys_slist_t pending_queue;
 };
 
 typedef void (*net_arp_cb_t)(struct arp_entry *entry,
@@ -14,12 +14,156 @@ LOG_MODULE_REGISTER(net_eth_bridge, CONFIG_NET_ETHERNET_BRIDGE_LOG_LEVEL);
 #include <zephyr/net/ethernet_bridge.h>
 #include <zephyr/sys/iterable_sections.h>
 #include <zephyr/sys/slist.h>
+#include <zephyr/sys/byteorder.h>
 
+#include "net_private.h"
 #include "bridge.h"
 
 extern struct eth_bridge _eth_bridge_list_start[];
 extern struct eth_bridge _eth_bridge_list_end[];
 
+#if defined(CONFIG_NET_ETHERNET_BRIDGE_FDB)
+BUILD_ASSERT((CONFIG_NET_ETHERNET_BRIDGE_FDB_SIZE &
+	      (CONFIG_NET_ETHERNET_BRIDGE_FDB_SIZE - 1)) == 0,
+	     "CONFIG_NET_ETHERNET_BRIDGE_FDB_SIZE must be a power of two");
+
+#define FDB_AGEING_TIME_MS \
+	((uint32_t)CONFIG_NET_ETHERNET_BRIDGE_FDB_AGEING_TIME * MSEC_PER_SEC)
+
+static void fdb_init(struct eth_bridge *br)
+{
+	sys_slist_init(&br->fdb_free);
+
+	for (int i = 0; i < CONFIG_NET_ETHERNET_BRIDGE_FDB_SIZE; i++) {
+		sys_slist_init(&br->fdb_buckets[i]);
+		sys_slist_prepend(&br->fdb_free, &br->fdb_entries[i].node);
+	}
+}
+
+static sys_slist_t *fdb_bucket(struct eth_bridge *br, const uint8_t *addr)
+{
+	uint32_t hash;
+
+	/* The last bytes vary the most, the first ones are mostly the OUI */
+	hash = sys_get_be32(&addr[2]) ^ sys_get_be16(&addr[0]);
+	hash *= 0x9e3779b1U;
+	hash ^= hash >> 16;
+
+	return &br->fdb_buckets[hash & (CONFIG_NET_ETHERNET_BRIDGE_FDB_SIZE - 1)];
+}
+
+static inline bool fdb_entry_expired(struct eth_bridge_fdb_entry *entry,
+				     uint32_t now)
+{
+	return (now - entry->seen) >= FDB_AGEING_TIME_MS;
+}
+
+static struct eth_bridge_fdb_entry *fdb_lookup(struct eth_bridge *br,
+					       const uint8_t *addr,
+					       uint32_t now)
+{
+	sys_slist_t *bucket = fdb_bucket(br, addr);
+	struct eth_bridge_fdb_entry *entry;
+	sys_snode_t *prev = NULL;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(bucket, entry, node) {
+		if (memcmp(entry->addr, addr, sizeof(entry->addr)) != 0) {
+			prev = &entry->node;
+			continue;
+		}
+
+		/* Entries are aged lazily, when they are looked up */
+		if (fdb_entry_expired(entry, now)) {
+			NET_DBG("bridge %p forgets %s", br,
+				net_sprint_ll_addr(addr, sizeof(entry->addr)));
+			sys_slist_remove(bucket, prev, &entry->node);
+			sys_slist_prepend(&br->fdb_free, &entry->node);
+			return NULL;
+		}
+
+		return entry;
+	}
+
+	return NULL;
+}
+
+static struct eth_bridge_fdb_entry *fdb_alloc(struct eth_bridge *br,
+					      uint32_t now)
+{
+	struct eth_bridge_fdb_entry *oldest = NULL;
+	sys_snode_t *node;
+
+	node = sys_slist_get(&br->fdb_free);
+	if (node != NULL) {
+		return CONTAINER_OF(node, struct eth_bridge_fdb_entry, node);
+	}
+
+	/* The database is full, replace the least recently seen address */
+	for (int i = 0; i < CONFIG_NET_ETHERNET_BRIDGE_FDB_SIZE; i++) {
+		struct eth_bridge_fdb_entry *entry = &br->fdb_entries[i];
+
+		if (oldest == NULL ||
+		    (now - entry->seen) > (now - oldest->seen)) {
+			oldest = entry;
+		}
+	}
+
+	sys_slist_find_and_remove(fdb_bucket(br, oldest->addr), &oldest->node);
+
+	return oldest;
+}
+
+static void fdb_learn(struct eth_bridge *br, const uint8_t *addr,
+		      struct net_if *iface, uint32_t now)
+{
+	struct eth_bridge_fdb_entry *entry;
+
+	/* Multicast source addresses are invalid, never learn them */
+	if (addr[0] & 0x01) {
+		return;
+	}
+
+	entry = fdb_lookup(br, addr, now);
+	if (entry == NULL) {
+		entry = fdb_alloc(br, now);
+		memcpy(entry->addr, addr, sizeof(entry->addr));
+		sys_slist_prepend(fdb_bucket(br, addr), &entry->node);
+
+		NET_DBG("bridge %p learns %s on iface %p", br,
+			net_sprint_ll_addr(addr, sizeof(entry->addr)), iface);
+	} else if (entry->iface != iface) {
+		NET_DBG("bridge %p moves %s from iface %p to %p", br,
+			net_sprint_ll_addr(addr, sizeof(entry->addr)),
+			entry->iface, iface);
+	}
+
+	entry->iface = iface;
+	entry->seen = now;
+}
+
+static void fdb_flush_iface(struct eth_bridge *br, struct net_if *iface)
+{
+	for (int i = 0; i < CONFIG_NET_ETHERNET_BRIDGE_FDB_SIZE; i++) {
+		struct eth_bridge_fdb_entry *entry, *next;
+		sys_snode_t *prev = NULL;
+
+		SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&br->fdb_buckets[i], entry,
+						  next, node) {
+			if (entry->iface != iface) {
+				prev = &entry->node;
+				continue;
+			}
+
+			sys_slist_remove(&br->fdb_buckets[i], prev, &entry->node);
+			sys_slist_prepend(&br->fdb_free, &entry->node);
+		}
+	}
+}
+#else
+#define fdb_init(...)
+#define fdb_flush_iface(...)
+#endif /* CONFIG_NET_ETHERNET_BRIDGE_FDB */
+
 static void lock_bridge(struct eth_bridge *br)
 {
 	/* Lazy-evaluate initialization.  The ETH_BRIDGE_INITIALIZER()
@@ -29,6 +173,7 @@ static void lock_bridge(struct eth_bridge *br)
 	 */
 	if (!br->initialized) {
 		k_mutex_init(&br->lock);
+		fdb_init(br);
 		br->initialized = true;
 	}
 	k_mutex_lock(&br->lock, K_FOREVER);
@@ -115,6 +260,7 @@ int eth_bridge_iface_remove(struct eth_bridge *br, struct net_if *iface)
 
 	sys_slist_find_and_remove(&br->interfaces, &ctx->bridge.node);
 	ctx->bridge.instance = NULL;
+	fdb_flush_iface(br, iface);
 
 	k_mutex_unlock(&br->lock);
 
@@ -165,79 +311,129 @@ static inline bool is_link_local_addr(struct net_eth_addr *addr)
 	return false;
 }
 
+static bool bridge_port_can_tx(struct eth_bridge *br,
+			       struct ethernet_context *out_ctx)
+{
+	/* Skip it if not allowed to transmit or not up */
+	return out_ctx->bridge.instance == br && out_ctx->bridge.allow_tx &&
+	       net_if_flag_is_set(out_ctx->iface, NET_IF_UP);
+}
+
+static void bridge_xmit(struct net_pkt *pkt, struct net_pkt *out_pkt,
+			struct ethernet_context *out_ctx)
+{
+	NET_DBG("sending pkt %p as %p on iface %p", pkt, out_pkt, out_ctx->iface);
+
+	/*
+	 * Use AF_UNSPEC to avoid interference, set the output
+	 * interface and send the packet.
+	 */
+	net_pkt_set_family(out_pkt, AF_UNSPEC);
+	net_pkt_set_orig_iface(out_pkt, net_pkt_iface(pkt));
+	net_pkt_set_iface(out_pkt, out_ctx->iface);
+	net_if_queue_tx(out_ctx->iface, out_pkt);
+}
+
 enum net_verdict net_eth_bridge_input(struct ethernet_context *ctx,
 				      struct net_pkt *pkt)
 {
 	struct eth_bridge *br = ctx->bridge.instance;
+	uint8_t *dst = net_pkt_lladdr_dst(pkt)->addr;
+	struct ethernet_context *prev_ctx = NULL;
 	sys_snode_t *node;
 
 	NET_DBG("new pkt %p", pkt);
 
 	/* Drop all link-local packets for now. */
-	if (is_link_local_addr((struct net_eth_addr *)net_pkt_lladdr_dst(pkt))) {
+	if (is_link_local_addr((struct net_eth_addr *)dst)) {
 		return NET_DROP;
 	}
 
 	lock_bridge(br);
 
 	/*
-	 * Send packet to all registered interfaces for now.
-	 * Eventually we could get smarter with a MAC address cache.
+	 * Listeners get their own clone first, as the packet itself may be
+	 * handed over to the egress interface below.
 	 */
-	SYS_SLIST_FOR_EACH_NODE(&br->interfaces, node) {
-		struct ethernet_context *out_ctx;
+	SYS_SLIST_FOR_EACH_NODE(&br->listeners, node) {
+		struct eth_bridge_listener *l;
 		struct net_pkt *out_pkt;
 
-		out_ctx = CONTAINER_OF(node, struct ethernet_context, bridge.node);
+		l = CONTAINER_OF(node, struct eth_bridge_listener, node);
 
-		/* Don't xmit on the same interface as the incoming packet's */
-		if (ctx == out_ctx) {
+		out_pkt = net_pkt_shallow_clone(pkt, K_NO_WAIT);
+		if (out_pkt == NULL) {
 			continue;
 		}
 
-		/* Skip it if not allowed to transmit */
-		if (!out_ctx->bridge.allow_tx) {
-			continue;
-		}
+		k_fifo_put(&l->pkt_queue, out_pkt);
+	}
 
-		/* Skip it if not up */
-		if (!net_if_flag_is_set(out_ctx->iface, NET_IF_UP)) {
-			continue;
-		}
+#if defined(CONFIG_NET_ETHERNET_BRIDGE_FDB)
+	uint32_t now = k_uptime_get_32();
 
-		out_pkt = net_pkt_shallow_clone(pkt, K_NO_WAIT);
-		if (out_pkt == NULL) {
-			continue;
-		}
+	fdb_learn(br, net_pkt_lladdr_src(pkt)->addr, ctx->iface, now);
+
+	if (!(dst[0] & 0x01)) {
+		struct eth_bridge_fdb_entry *entry;
+
+		entry = fdb_lookup(br, dst, now);
+		if (entry != NULL) {
+			struct ethernet_context *out_ctx = net_if_l2_data(entry->iface);
 
-		NET_DBG("sending pkt %p as %p on iface %p", pkt, out_pkt, out_ctx->iface);
+			/*
+			 * Known unicast destination, the packet goes to the
+			 * learned interface only, and is dropped if that is
+			 * the one it came from.
+			 */
+			if (out_ctx != ctx && bridge_port_can_tx(br, out_ctx)) {
+				bridge_xmit(pkt, pkt, out_ctx);
+			} else {
+				net_pkt_unref(pkt);
+			}
 
-		/*
-		 * Use AF_UNSPEC to avoid interference, set the output
-		 * interface and send the packet.
-		 */
-		net_pkt_set_family(out_pkt, AF_UNSPEC);
-		net_pkt_set_orig_iface(out_pkt, net_pkt_iface(pkt));
-		net_pkt_set_iface(out_pkt, out_ctx->iface);
-		net_if_queue_tx(out_ctx->iface, out_pkt);
+			k_mutex_unlock(&br->lock);
+			return NET_OK;
+		}
 	}
+#endif /* CONFIG_NET_ETHERNET_BRIDGE_FDB */
 
-	SYS_SLIST_FOR_EACH_NODE(&br->listeners, node) {
-		struct eth_bridge_listener *l;
+	/*
+	 * Flood the packet to all the other interfaces. Each interface but
+	 * the last one gets a clone, the last one gets the packet itself.
+	 */
+	SYS_SLIST_FOR_EACH_NODE(&br->interfaces, node) {
+		struct ethernet_context *out_ctx;
 		struct net_pkt *out_pkt;
 
-		l = CONTAINER_OF(node, struct eth_bridge_listener, node);
+		out_ctx = CONTAINER_OF(node, struct ethernet_context, bridge.node);
 
-		out_pkt = net_pkt_shallow_clone(pkt, K_NO_WAIT);
-		if (out_pkt == NULL) {
+		/* Don't xmit on the same interface as the incoming packet's */
+		if (ctx == out_ctx) {
 			continue;
 		}
 
-		k_fifo_put(&l->pkt_queue, out_pkt);
+		if (!bridge_port_can_tx(br, out_ctx)) {
+			continue;
+		}
+
+		if (prev_ctx != NULL) {
+			out_pkt = net_pkt_shallow_clone(pkt, K_NO_WAIT);
+			if (out_pkt != NULL) {
+				bridge_xmit(pkt, out_pkt, prev_ctx);
+			}
+		}
+
+		prev_ctx = out_ctx;
+	}
+
+	if (prev_ctx != NULL) {
+		bridge_xmit(pkt, pkt, prev_ctx);
+	} else {
+		net_pkt_unref(pkt);
 	}
 
 	k_mutex_unlock(&br->lock);
 
-	net_pkt_unref(pkt);
 	return NET_OK;
 }
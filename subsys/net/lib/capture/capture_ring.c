@@ -0,0 +1,323 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_capture_ring, CONFIG_NET_CAPTURE_RING_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_l2.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/capture.h>
+
+#if defined(CONFIG_FILE_SYSTEM)
+#include <zephyr/fs/fs.h>
+#endif
+
+#define PCAP_MAGIC         0xa1b2c3d4
+#define PCAP_VERSION_MAJOR 2
+#define PCAP_VERSION_MINOR 4
+
+/* Link types of the pcap file format */
+#define PCAP_LINKTYPE_ETHERNET 1
+#define PCAP_LINKTYPE_RAW      101
+
+RING_BUF_DECLARE(capture_ring, CONFIG_NET_CAPTURE_RING_SIZE);
+
+/* Writers are serialized by the spinlock, the reader by the mutex. The ring
+ * buffer supports one writer and one reader working concurrently.
+ */
+static struct k_spinlock write_lock;
+static K_MUTEX_DEFINE(read_lock);
+
+static struct net_capture_ring_stats stats;
+static struct net_if *ring_iface;
+static uint32_t ring_linktype;
+static bool ring_enabled;
+
+static uint32_t iface_linktype(struct net_if *iface)
+{
+#if defined(CONFIG_NET_L2_ETHERNET)
+	if (iface != NULL && net_if_l2(iface) == &NET_L2_GET_NAME(ETHERNET)) {
+		return PCAP_LINKTYPE_ETHERNET;
+	}
+#endif
+
+	return PCAP_LINKTYPE_RAW;
+}
+
+int net_capture_ring_enable(struct net_if *iface)
+{
+	k_spinlock_key_t key;
+
+	k_mutex_lock(&read_lock, K_FOREVER);
+	key = k_spin_lock(&write_lock);
+
+	if (ring_enabled) {
+		k_spin_unlock(&write_lock, key);
+		k_mutex_unlock(&read_lock);
+		return -EALREADY;
+	}
+
+	/* A new capture starts, the link type might not be the same */
+	ring_buf_reset(&capture_ring);
+	memset(&stats, 0, sizeof(stats));
+
+	ring_iface = iface;
+	ring_linktype = iface_linktype(iface != NULL ? iface : net_if_get_default());
+	ring_enabled = true;
+
+	k_spin_unlock(&write_lock, key);
+	k_mutex_unlock(&read_lock);
+
+	NET_DBG("Capturing iface %d into ring", net_if_get_by_iface(iface));
+
+	return 0;
+}
+
+int net_capture_ring_disable(void)
+{
+	k_spinlock_key_t key;
+	int ret = 0;
+
+	key = k_spin_lock(&write_lock);
+
+	if (!ring_enabled) {
+		ret = -EALREADY;
+	}
+
+	ring_enabled = false;
+	ring_iface = NULL;
+
+	k_spin_unlock(&write_lock, key);
+
+	return ret;
+}
+
+bool net_capture_ring_is_enabled(void)
+{
+	return ring_enabled;
+}
+
+void net_capture_ring_stats_get(struct net_capture_ring_stats *out)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&write_lock);
+	*out = stats;
+	k_spin_unlock(&write_lock, key);
+}
+
+void net_capture_ring_pcap_header(struct net_capture_pcap_hdr *hdr)
+{
+	hdr->magic = PCAP_MAGIC;
+	hdr->version_major = PCAP_VERSION_MAJOR;
+	hdr->version_minor = PCAP_VERSION_MINOR;
+	hdr->thiszone = 0;
+	hdr->sigfigs = 0;
+	hdr->snaplen = CONFIG_NET_CAPTURE_RING_SNAPLEN;
+	hdr->linktype = ring_linktype;
+}
+
+/* Copy data into the claimed but not yet committed part of the ring */
+static void ring_claim_copy(const uint8_t *data, uint32_t len)
+{
+	while (len > 0) {
+		uint8_t *dst;
+		uint32_t claimed;
+
+		claimed = ring_buf_put_claim(&capture_ring, &dst, len);
+		memcpy(dst, data, claimed);
+
+		data += claimed;
+		len -= claimed;
+	}
+}
+
+void net_capture_ring_pkt(struct net_if *iface, struct net_pkt *pkt)
+{
+	struct net_capture_pcap_rec_hdr rec;
+	struct net_buf *buf;
+	k_spinlock_key_t key;
+	uint32_t left;
+	size_t len;
+	int64_t us;
+
+	if (!ring_enabled) {
+		return;
+	}
+
+	len = net_pkt_get_len(pkt);
+	us = k_ticks_to_us_floor64(k_uptime_ticks());
+
+	rec.ts_sec = (uint32_t)(us / USEC_PER_SEC);
+	rec.ts_usec = (uint32_t)(us % USEC_PER_SEC);
+	rec.incl_len = MIN(len, CONFIG_NET_CAPTURE_RING_SNAPLEN);
+	rec.orig_len = len;
+
+	key = k_spin_lock(&write_lock);
+
+	if (!ring_enabled || (ring_iface != NULL && ring_iface != iface)) {
+		goto out;
+	}
+
+	if (ring_buf_space_get(&capture_ring) < sizeof(rec) + rec.incl_len) {
+		stats.dropped++;
+		goto out;
+	}
+
+	ring_claim_copy((const uint8_t *)&rec, sizeof(rec));
+
+	left = rec.incl_len;
+
+	for (buf = pkt->buffer; buf != NULL && left > 0; buf = buf->frags) {
+		uint32_t chunk = MIN(buf->len, left);
+
+		ring_claim_copy(buf->data, chunk);
+		left -= chunk;
+	}
+
+	/* The record becomes visible to the reader as a whole */
+	ring_buf_put_finish(&capture_ring, sizeof(rec) + rec.incl_len);
+
+	stats.captured++;
+
+	if (rec.incl_len < len) {
+		stats.truncated++;
+	}
+
+out:
+	k_spin_unlock(&write_lock, key);
+}
+
+int net_capture_ring_read(uint8_t *buf, size_t len)
+{
+	struct net_capture_pcap_rec_hdr rec;
+	size_t copied = 0;
+
+	k_mutex_lock(&read_lock, K_FOREVER);
+
+	while (ring_buf_peek(&capture_ring, (uint8_t *)&rec,
+			     sizeof(rec)) == sizeof(rec)) {
+		size_t rec_len = sizeof(rec) + rec.incl_len;
+
+		if (rec_len > len - copied) {
+			break;
+		}
+
+		(void)ring_buf_get(&capture_ring, buf + copied, rec_len);
+		copied += rec_len;
+	}
+
+	if (copied == 0 && !ring_buf_is_empty(&capture_ring)) {
+		k_mutex_unlock(&read_lock);
+		return -EMSGSIZE;
+	}
+
+	k_mutex_unlock(&read_lock);
+
+	return copied;
+}
+
+int net_capture_ring_consume(net_capture_ring_cb_t cb, void *user_data)
+{
+	uint32_t left;
+	int total = 0;
+	int ret = 0;
+
+	k_mutex_lock(&read_lock, K_FOREVER);
+
+	/* Only whole records are committed, so the stream handed to the
+	 * callback always ends on a record boundary. Records added while
+	 * consuming are left for the next call.
+	 */
+	left = ring_buf_size_get(&capture_ring);
+
+	while (left > 0) {
+		uint8_t *data;
+		uint32_t len;
+
+		len = ring_buf_get_claim(&capture_ring, &data, left);
+		left -= len;
+
+		ret = cb(data, len, user_data);
+
+		(void)ring_buf_get_finish(&capture_ring, ret < 0 ? 0 : len);
+
+		if (ret < 0) {
+			break;
+		}
+
+		total += len;
+	}
+
+	k_mutex_unlock(&read_lock);
+
+	return ret < 0 ? ret : total;
+}
+
+#if defined(CONFIG_FILE_SYSTEM)
+static int save_cb(const uint8_t *data, size_t len, void *user_data)
+{
+	ssize_t ret;
+
+	ret = fs_write(user_data, data, len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return ret == len ? 0 : -ENOSPC;
+}
+
+int net_capture_ring_save(const char *path)
+{
+	struct net_capture_pcap_hdr hdr;
+	struct fs_file_t file;
+	ssize_t written;
+	int ret;
+
+	fs_file_t_init(&file);
+
+	ret = fs_open(&file, path, FS_O_CREATE | FS_O_WRITE);
+	if (ret < 0) {
+		NET_DBG("Cannot open %s (%d)", path, ret);
+		return ret;
+	}
+
+	ret = fs_truncate(&file, 0);
+	if (ret < 0) {
+		goto out;
+	}
+
+	net_capture_ring_pcap_header(&hdr);
+
+	written = fs_write(&file, &hdr, sizeof(hdr));
+	if (written != sizeof(hdr)) {
+		ret = written < 0 ? written : -ENOSPC;
+		goto out;
+	}
+
+	ret = net_capture_ring_consume(save_cb, &file);
+
+out:
+	(void)fs_close(&file);
+
+	return ret < 0 ? ret : 0;
+}
+#endif /* CONFIG_FILE_SYSTEM */
+
+#if !defined(CONFIG_NET_CAPTURE)
+void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt)
+{
+	if (net_pkt_is_captured(pkt)) {
+		return;
+	}
+
+	net_capture_ring_pkt(iface, pkt);
+}
+#endif
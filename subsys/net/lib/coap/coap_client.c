@@ -60,6 +60,11 @@ static void reset_internal_request(struct coap_client_internal_request *request)
 	request->offset = 0;
 	request->last_id = 0;
 	reset_block_contexts(request);
+#if CONFIG_COAP_CLIENT_BLOCK2_WINDOW > 1
+	memset(request->block2_slots, 0, sizeof(request->block2_slots));
+	request->block2_next = 0;
+	request->block2_window = false;
+#endif
 }
 
 static int coap_client_schedule_poll(struct coap_client *client, int sock,
@@ -133,6 +138,37 @@ static enum coap_block_size coap_client_default_block_size(void)
 	return COAP_BLOCK_256;
 }
 
+/* Fetch the block at the current offset of a streamed payload */
+static int get_streamed_block(struct coap_client_request *req,
+			      struct coap_client_internal_request *internal_req,
+			      const uint8_t **payload, size_t *len)
+{
+	struct coap_block_context *ctx = &internal_req->send_blk_ctx;
+	size_t block_in_bytes = coap_block_size_to_bytes(ctx->block_size);
+	bool last_block = false;
+	int ret;
+
+	*payload = NULL;
+	*len = block_in_bytes;
+
+	ret = req->payload_cb(ctx->current, payload, len, &last_block, req->user_data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (*len > block_in_bytes || (*len > 0 && *payload == NULL) ||
+	    (!last_block && *len < block_in_bytes)) {
+		return -EINVAL;
+	}
+
+	/* The size is not known in advance, make the block1 option tell whether more
+	 * blocks follow and let the next block start after this one.
+	 */
+	ctx->total_size = ctx->current + *len + (last_block ? 0 : 1);
+
+	return 0;
+}
+
 static int coap_client_init_request(struct coap_client *client,
 				    struct coap_client_request *req,
 				    struct coap_client_internal_request *internal_req,
@@ -169,7 +205,7 @@ static int coap_client_init_request(struct coap_client *client,
 	}
 
 	/* Add content format option only if there is a payload */
-	if (req->payload) {
+	if (req->payload || req->payload_cb) {
 		ret = coap_append_option_int(&internal_req->request,
 					     COAP_OPTION_CONTENT_FORMAT, req->fmt);
 
@@ -201,12 +237,14 @@ static int coap_client_init_request(struct coap_client *client,
 		}
 	}
 
-	if (req->payload) {
+	if (req->payload || req->payload_cb) {
+		const uint8_t *payload = req->payload;
+		size_t streamed_len = 0;
 		uint16_t payload_len;
 		uint16_t offset;
 
 		/* Blockwise send ongoing, add block1 */
-		if (internal_req->send_blk_ctx.total_size > 0 ||
+		if (internal_req->send_blk_ctx.total_size > 0 || req->payload_cb ||
 		   (req->len > CONFIG_COAP_CLIENT_MESSAGE_SIZE)) {
 
 			if (internal_req->send_blk_ctx.total_size == 0) {
@@ -218,6 +256,16 @@ static int coap_client_init_request(struct coap_client *client,
 
 				memcpy(internal_req->request_tag, tag, COAP_TOKEN_MAX_LEN);
 			}
+
+			if (req->payload_cb) {
+				ret = get_streamed_block(req, internal_req, &payload, &streamed_len);
+				if (ret < 0) {
+					LOG_ERR("Failed to get payload at %zu (%d)",
+						internal_req->send_blk_ctx.current, ret);
+					goto out;
+				}
+			}
+
 			ret = coap_append_block1_option(&internal_req->request,
 							&internal_req->send_blk_ctx);
 
@@ -243,7 +291,10 @@ static int coap_client_init_request(struct coap_client *client,
 			goto out;
 		}
 
-		if (internal_req->send_blk_ctx.total_size > 0) {
+		if (req->payload_cb) {
+			payload_len = streamed_len;
+			offset = 0;
+		} else if (internal_req->send_blk_ctx.total_size > 0) {
 			uint16_t block_in_bytes =
 				coap_block_size_to_bytes(internal_req->send_blk_ctx.block_size);
 
@@ -258,7 +309,7 @@ static int coap_client_init_request(struct coap_client *client,
 			offset = 0;
 		}
 
-		ret = coap_packet_append_payload(&internal_req->request, req->payload + offset,
+		ret = coap_packet_append_payload(&internal_req->request, payload + offset,
 						 payload_len);
 
 		if (ret < 0) {
@@ -289,6 +340,10 @@ int coap_client_req(struct coap_client *client, int sock, const struct sockaddr
 		return -EINVAL;
 	}
 
+	if (req->payload != NULL && req->payload_cb != NULL) {
+		return -EINVAL;
+	}
+
 	/* Don't allow changing to a different socket if there is already request ongoing. */
 	if (client->fd != sock && has_ongoing_request(client)) {
 		return -EALREADY;
@@ -433,6 +488,243 @@ static int resend_request(struct coap_client *client,
 	return ret;
 }
 
+#if CONFIG_COAP_CLIENT_BLOCK2_WINDOW > 1
+
+/* Send the request for the block of a window slot, with a message ID of its own */
+static int block2_send(struct coap_client *client,
+		       struct coap_client_internal_request *internal_req,
+		       struct coap_client_block2_slot *slot, bool resend)
+{
+	struct coap_block_context ctx = internal_req->recv_blk_ctx;
+	uint32_t last_id = internal_req->last_id;
+	int ret;
+
+	k_mutex_lock(&client->send_mutex, K_FOREVER);
+
+	internal_req->recv_blk_ctx.current = slot->block * coap_block_size_to_bytes(ctx.block_size);
+	internal_req->last_id = resend ? slot->pending.id : coap_next_id();
+
+	ret = coap_client_init_request(client, &internal_req->coap_request, internal_req, true);
+
+	internal_req->recv_blk_ctx = ctx;
+	internal_req->last_id = last_id;
+
+	if (ret < 0) {
+		LOG_ERR("Error creating a CoAP request");
+		goto out;
+	}
+
+	if (!resend && coap_header_get_type(&internal_req->request) == COAP_TYPE_CON) {
+		struct coap_transmission_parameters params = internal_req->pending.params;
+
+		ret = coap_pending_init(&slot->pending, &internal_req->request,
+					&client->address, &params);
+		if (ret < 0) {
+			LOG_ERR("Error creating pending");
+			goto out;
+		}
+
+		coap_pending_cycle(&slot->pending);
+	}
+
+	ret = send_request(client->fd, internal_req->request.data, internal_req->request.offset, 0,
+			   &client->address, client->socklen);
+	if (ret < 0) {
+		LOG_ERR("Error sending a CoAP request");
+	} else {
+		ret = 0;
+	}
+
+out:
+	k_mutex_unlock(&client->send_mutex);
+
+	return ret;
+}
+
+/* Slot of the first block dropped because it came ahead of the next one in order */
+static struct coap_client_block2_slot *
+block2_window_dropped(struct coap_client_internal_request *internal_req)
+{
+	struct coap_client_block2_slot *first = NULL;
+
+	ARRAY_FOR_EACH_PTR(internal_req->block2_slots, slot) {
+		if (slot->used && slot->dropped && (first == NULL || slot->block < first->block)) {
+			first = slot;
+		}
+	}
+
+	return first;
+}
+
+/* Keep requests in flight for the blocks following the last received one */
+static int block2_window_fill(struct coap_client *client,
+			      struct coap_client_internal_request *internal_req)
+{
+	struct coap_block_context *ctx = &internal_req->recv_blk_ctx;
+	size_t block_in_bytes = coap_block_size_to_bytes(ctx->block_size);
+	struct coap_client_block2_slot *dropped;
+	int ret;
+
+	if (!internal_req->block2_window) {
+		internal_req->block2_window = true;
+		internal_req->block2_next = ctx->current / block_in_bytes;
+	}
+
+	/* Ask again for the dropped blocks, in order, before any new block. Requesting
+	 * new blocks first would get their responses ahead of the dropped ones again.
+	 */
+	dropped = block2_window_dropped(internal_req);
+	if (dropped != NULL) {
+		do {
+			dropped->dropped = false;
+
+			ret = block2_send(client, internal_req, dropped, false);
+			if (ret < 0) {
+				return ret;
+			}
+
+			dropped = block2_window_dropped(internal_req);
+		} while (dropped != NULL);
+
+		return 0;
+	}
+
+	ARRAY_FOR_EACH_PTR(internal_req->block2_slots, slot) {
+		if (slot->used) {
+			continue;
+		}
+
+		/* Don't go past the size announced by the server */
+		if (ctx->total_size > 0 &&
+		    (size_t)internal_req->block2_next * block_in_bytes >= ctx->total_size) {
+			break;
+		}
+
+		slot->block = internal_req->block2_next++;
+		slot->used = true;
+
+		ret = block2_send(client, internal_req, slot, false);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/* Release the slot of a received block, only the next block in order is accepted */
+static bool block2_window_accept(struct coap_client_internal_request *internal_req,
+				 uint32_t block_num)
+{
+	size_t block_in_bytes = coap_block_size_to_bytes(internal_req->recv_blk_ctx.block_size);
+
+	if ((size_t)block_num * block_in_bytes != internal_req->recv_blk_ctx.current) {
+		return false;
+	}
+
+	ARRAY_FOR_EACH_PTR(internal_req->block2_slots, slot) {
+		if (slot->used && slot->block == block_num) {
+			coap_pending_clear(&slot->pending);
+			slot->used = false;
+			slot->dropped = false;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* A block came ahead of the next one in order. Drop it until the missing block is
+ * received, and ask for the missing block again right away: a non-confirmable
+ * request is never retransmitted, and the missing block may have been lost.
+ */
+static int block2_window_gap(struct coap_client *client,
+			     struct coap_client_internal_request *internal_req,
+			     uint32_t block_num)
+{
+	size_t block_in_bytes = coap_block_size_to_bytes(internal_req->recv_blk_ctx.block_size);
+	uint32_t next = internal_req->recv_blk_ctx.current / block_in_bytes;
+	struct coap_client_block2_slot *missing = NULL;
+	bool ahead = false;
+
+	if (block_num <= next) {
+		/* Received again after a retransmission */
+		return 0;
+	}
+
+	ARRAY_FOR_EACH_PTR(internal_req->block2_slots, slot) {
+		if (!slot->used) {
+			continue;
+		}
+
+		if (slot->block == block_num) {
+			coap_pending_clear(&slot->pending);
+			slot->dropped = true;
+			ahead = true;
+		} else if (slot->block == next) {
+			missing = slot;
+		}
+	}
+
+	if (!ahead || missing == NULL) {
+		return 0;
+	}
+
+	/* A confirmable request is retransmitted with its message ID, a non-confirmable
+	 * one gets a new one so that it is not taken for a duplicate.
+	 */
+	return block2_send(client, internal_req, missing,
+			   internal_req->coap_request.confirmable);
+}
+
+static struct coap_pending *block2_window_pending(struct coap_client_internal_request *internal_req,
+						 uint16_t id)
+{
+	if (internal_req->block2_window) {
+		ARRAY_FOR_EACH_PTR(internal_req->block2_slots, slot) {
+			if (slot->used && slot->pending.id == id) {
+				return &slot->pending;
+			}
+		}
+	}
+
+	return &internal_req->pending;
+}
+
+static int block2_window_resend(struct coap_client *client,
+				struct coap_client_internal_request *internal_req)
+{
+	int64_t now = k_uptime_get();
+	int ret = 0;
+
+	if (!internal_req->request_ongoing || !internal_req->block2_window) {
+		return 0;
+	}
+
+	ARRAY_FOR_EACH_PTR(internal_req->block2_slots, slot) {
+		if (!slot->used || slot->pending.timeout == 0 ||
+		    slot->pending.timeout > (now - slot->pending.t0)) {
+			continue;
+		}
+
+		if (!coap_pending_cycle(&slot->pending)) {
+			LOG_ERR("Timeout for block %u, no more retries left", slot->block);
+			report_callback_error(internal_req, -ETIMEDOUT);
+			internal_req->request_ongoing = false;
+			return -ETIMEDOUT;
+		}
+
+		ret = block2_send(client, internal_req, slot, true);
+		if (ret < 0) {
+			LOG_ERR("Failed to resend request for block %u, %d", slot->block, ret);
+		}
+	}
+
+	return ret;
+}
+
+#endif /* CONFIG_COAP_CLIENT_BLOCK2_WINDOW > 1 */
+
 static int coap_client_resend_handler(void)
 {
 	int ret = 0;
@@ -442,6 +734,11 @@ static int coap_client_resend_handler(void)
 			if (timeout_expired(&clients[i]->requests[j])) {
 				ret = resend_request(clients[i], &clients[i]->requests[j]);
 			}
+#if CONFIG_COAP_CLIENT_BLOCK2_WINDOW > 1
+			if (block2_window_resend(clients[i], &clients[i]->requests[j]) < 0) {
+				ret = -ETIMEDOUT;
+			}
+#endif
 		}
 	}
 
@@ -648,9 +945,14 @@ static int handle_response(struct coap_client *client, const struct coap_packet
 	/* Separate response coming */
 	if (payload_len == 0 && response_type == COAP_TYPE_ACK &&
 	    response_code == COAP_CODE_EMPTY) {
-		internal_req->pending.t0 = k_uptime_get();
-		internal_req->pending.timeout = internal_req->pending.t0 + COAP_SEPARATE_TIMEOUT;
-		internal_req->pending.retries = 0;
+		struct coap_pending *pending = &internal_req->pending;
+
+#if CONFIG_COAP_CLIENT_BLOCK2_WINDOW > 1
+		pending = block2_window_pending(internal_req, coap_header_get_id(response));
+#endif
+		pending->t0 = k_uptime_get();
+		pending->timeout = pending->t0 + COAP_SEPARATE_TIMEOUT;
+		pending->retries = 0;
 		return 1;
 	}
 
@@ -735,6 +1037,21 @@ static int handle_response(struct coap_client *client, const struct coap_packet
 		last_block = !GET_MORE(block_option);
 		block_num = GET_BLOCK_NUM(block_option);
 
+#if CONFIG_COAP_CLIENT_BLOCK2_WINDOW > 1
+		if (internal_req->block2_window &&
+		    !block2_window_accept(internal_req, block_num)) {
+			/* Not the next block, it is requested again later */
+			LOG_DBG("Ignoring block %d", block_num);
+
+			ret = block2_window_gap(client, internal_req, block_num);
+			if (ret < 0) {
+				goto fail;
+			}
+
+			return 1;
+		}
+#endif
+
 		if (block_num == 0) {
 			coap_block_transfer_init(&internal_req->recv_blk_ctx,
 						 coap_client_default_block_size(),
@@ -777,6 +1094,19 @@ static int handle_response(struct coap_client *client, const struct coap_packet
 
 	/* If this wasn't last block, send the next request */
 	if (blockwise_transfer && !last_block) {
+#if CONFIG_COAP_CLIENT_BLOCK2_WINDOW > 1
+		/* Downloads can have several blocks requested at once */
+		if (block_option > 0 && internal_req->send_blk_ctx.total_size == 0 &&
+		    internal_req->coap_request.payload == NULL &&
+		    internal_req->coap_request.payload_cb == NULL) {
+			ret = block2_window_fill(client, internal_req);
+			if (ret < 0) {
+				goto fail;
+			}
+
+			return 1;
+		}
+#endif
 		k_mutex_lock(&client->send_mutex, K_FOREVER);
 		ret = coap_client_init_request(client, &internal_req->coap_request, internal_req,
 					       false);
@@ -812,6 +1142,14 @@ static int handle_response(struct coap_client *client, const struct coap_packet
 fail:
 	client->response_ready = false;
 	internal_req->request_ongoing = false;
+#if CONFIG_COAP_CLIENT_BLOCK2_WINDOW > 1
+	ARRAY_FOR_EACH_PTR(internal_req->block2_slots, slot) {
+		coap_pending_clear(&slot->pending);
+		slot->used = false;
+		slot->dropped = false;
+	}
+	internal_req->block2_window = false;
+#endif
 	return ret;
 }
 
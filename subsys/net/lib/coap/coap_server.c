@@ -81,6 +81,376 @@ static inline void coap_server_free(void *ptr)
 #endif
 }
 
+#if defined(CONFIG_COAP_SERVER_RESOURCE_TRIE)
+
+/* Trie node indexes are 1-based, 0 is the end of a list */
+#define TRIE_NONE 0U
+/* No resource ends at or below a node */
+#define RES_NONE  UINT16_MAX
+
+/*
+ * The resource paths of each service are indexed by a trie of path segments.
+ * Every node remembers the first resource, in the order of the resource section,
+ * which ends at the node and which goes through it, so that a lookup returns the
+ * same resource as matching the resources one after the other.
+ */
+struct coap_trie_node {
+	const char *segment;
+	uint16_t len;
+	uint16_t child;
+	uint16_t sibling;
+	uint16_t resource;
+	uint16_t subtree;
+};
+
+struct coap_trie_match {
+	const struct coap_option *segments[MAX_OPTIONS];
+	uint8_t count;
+	uint16_t resource;
+};
+
+static struct coap_trie_node trie_nodes[CONFIG_COAP_SERVER_RESOURCE_TRIE_NODES];
+static uint16_t trie_node_count;
+
+static inline struct coap_trie_node *coap_trie_node(uint16_t idx)
+{
+	return &trie_nodes[idx - 1];
+}
+
+static uint16_t coap_trie_node_alloc(const char *segment)
+{
+	struct coap_trie_node *node;
+
+	if (trie_node_count >= ARRAY_SIZE(trie_nodes)) {
+		return TRIE_NONE;
+	}
+
+	node = &trie_nodes[trie_node_count++];
+	node->segment = segment;
+	node->len = segment != NULL ? strlen(segment) : 0U;
+	node->child = TRIE_NONE;
+	node->sibling = TRIE_NONE;
+	node->resource = RES_NONE;
+	node->subtree = RES_NONE;
+
+	return trie_node_count;
+}
+
+static uint16_t coap_trie_child(uint16_t parent, const char *segment)
+{
+	size_t len = strlen(segment);
+	uint16_t idx;
+
+	for (idx = coap_trie_node(parent)->child; idx != TRIE_NONE;
+	     idx = coap_trie_node(idx)->sibling) {
+		if (coap_trie_node(idx)->len == len &&
+		    memcmp(coap_trie_node(idx)->segment, segment, len) == 0) {
+			return idx;
+		}
+	}
+
+	idx = coap_trie_node_alloc(segment);
+	if (idx == TRIE_NONE) {
+		return TRIE_NONE;
+	}
+
+	coap_trie_node(idx)->sibling = coap_trie_node(parent)->child;
+	coap_trie_node(parent)->child = idx;
+
+	return idx;
+}
+
+static void coap_service_trie_build(const struct coap_service *service)
+{
+	uint16_t first = trie_node_count;
+	uint16_t res_idx = 0U;
+	uint16_t root;
+	uint16_t node;
+
+	root = coap_trie_node_alloc(NULL);
+	if (root == TRIE_NONE) {
+		goto nomem;
+	}
+
+	COAP_SERVICE_FOREACH_RESOURCE(service, resource) {
+		if (res_idx == RES_NONE) {
+			goto nomem;
+		}
+
+		node = root;
+
+		for (const char * const *path = resource->path; ; path++) {
+			if (coap_trie_node(node)->subtree == RES_NONE) {
+				coap_trie_node(node)->subtree = res_idx;
+			}
+
+			if (*path == NULL) {
+				break;
+			}
+
+			node = coap_trie_child(node, *path);
+			if (node == TRIE_NONE) {
+				goto nomem;
+			}
+		}
+
+		if (coap_trie_node(node)->resource == RES_NONE) {
+			coap_trie_node(node)->resource = res_idx;
+		}
+
+		res_idx++;
+	}
+
+	service->data->trie_root = root;
+
+	return;
+
+nomem:
+	LOG_WRN("Not enough trie nodes for %s, increase "
+		"CONFIG_COAP_SERVER_RESOURCE_TRIE_NODES", service->name);
+
+	trie_node_count = first;
+	service->data->trie_root = TRIE_NONE;
+}
+
+static void coap_trie_match(struct coap_trie_match *match, uint16_t idx, uint8_t depth)
+{
+	const struct coap_option *segment;
+	const struct coap_trie_node *child;
+
+	if (depth == match->count) {
+		match->resource = MIN(match->resource, coap_trie_node(idx)->resource);
+		return;
+	}
+
+	segment = match->segments[depth];
+
+	for (idx = coap_trie_node(idx)->child; idx != TRIE_NONE; idx = child->sibling) {
+		child = coap_trie_node(idx);
+
+		if (IS_ENABLED(CONFIG_COAP_URI_WILDCARD) && child->len == 1U) {
+			if (child->segment[0] == '+') {
+				/* Single-level wildcard */
+				coap_trie_match(match, idx, depth + 1);
+				continue;
+			} else if (child->segment[0] == '#') {
+				/* Multi-level wildcard, whatever follows in the path */
+				match->resource = MIN(match->resource, child->subtree);
+				continue;
+			}
+		}
+
+		if (child->len == segment->len &&
+		    memcmp(child->segment, segment->value, segment->len) == 0) {
+			coap_trie_match(match, idx, depth + 1);
+		}
+	}
+}
+
+static struct coap_resource *coap_service_trie_lookup(const struct coap_service *service,
+						      struct coap_option *options,
+						      uint8_t opt_num)
+{
+	struct coap_trie_match match = {
+		.resource = RES_NONE,
+	};
+
+	for (uint8_t i = 0U; i < opt_num; i++) {
+		if (options[i].delta == COAP_OPTION_URI_PATH) {
+			match.segments[match.count++] = &options[i];
+		}
+	}
+
+	coap_trie_match(&match, service->data->trie_root, 0U);
+
+	if (match.resource == RES_NONE) {
+		return NULL;
+	}
+
+	return &service->res_begin[match.resource];
+}
+
+#endif /* CONFIG_COAP_SERVER_RESOURCE_TRIE */
+
+static int coap_server_handle_request(const struct coap_service *service,
+				      struct coap_packet *request,
+				      struct coap_option *options, uint8_t opt_num,
+				      struct sockaddr *addr, socklen_t addr_len)
+{
+#if defined(CONFIG_COAP_SERVER_RESOURCE_TRIE)
+	if (service->data->trie_root != TRIE_NONE) {
+		struct coap_resource *resource;
+
+		if (!coap_packet_is_request(request)) {
+			return 0;
+		}
+
+		resource = coap_service_trie_lookup(service, options, opt_num);
+		if (resource == NULL) {
+			return -ENOENT;
+		}
+
+		/* Let the generic handler check the method of the matching resource */
+		return coap_handle_request_len(request, resource, 1, options, opt_num,
+					       addr, addr_len);
+	}
+#endif
+
+	return coap_handle_request_len(request, service->res_begin,
+				       COAP_SERVICE_RESOURCE_COUNT(service),
+				       options, opt_num, addr, addr_len);
+}
+
+#if defined(CONFIG_COAP_SERVER_DEDUP_CACHE)
+
+/* A recent request of a client and the response it got, RFC 7252 section 4.5 */
+struct coap_dedup_entry {
+	const struct coap_service *service;
+	struct sockaddr addr;
+	int64_t expiry;
+	uint16_t id;
+	uint16_t len;
+	uint8_t data[CONFIG_COAP_SERVER_DEDUP_RESPONSE_SIZE];
+};
+
+BUILD_ASSERT(CONFIG_COAP_SERVER_DEDUP_RESPONSE_SIZE <= UINT16_MAX,
+	     "CONFIG_COAP_SERVER_DEDUP_RESPONSE_SIZE doesn't fit the response length");
+
+static struct coap_dedup_entry dedup_cache[CONFIG_COAP_SERVER_DEDUP_ENTRIES];
+
+/* Entry of the request being handled, the response sent to it is kept there */
+static struct coap_dedup_entry *dedup_current;
+
+static bool coap_server_addr_equal(const struct sockaddr *a, const struct sockaddr *b)
+{
+	if (a->sa_family != b->sa_family) {
+		return false;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && a->sa_family == AF_INET) {
+		return net_sin(a)->sin_port == net_sin(b)->sin_port &&
+		       net_ipv4_addr_cmp(&net_sin(a)->sin_addr, &net_sin(b)->sin_addr);
+	}
+
+	if (IS_ENABLED(CONFIG_NET_IPV6) && a->sa_family == AF_INET6) {
+		return net_sin6(a)->sin6_port == net_sin6(b)->sin6_port &&
+		       net_ipv6_addr_cmp(&net_sin6(a)->sin6_addr, &net_sin6(b)->sin6_addr);
+	}
+
+	return false;
+}
+
+static struct coap_dedup_entry *coap_server_dedup_find(const struct coap_service *service,
+						       uint16_t id, const struct sockaddr *addr,
+						       int64_t now)
+{
+	ARRAY_FOR_EACH_PTR(dedup_cache, entry) {
+		if (entry->service == service && entry->id == id && entry->expiry > now &&
+		    coap_server_addr_equal(&entry->addr, addr)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static struct coap_dedup_entry *coap_server_dedup_add(const struct coap_service *service,
+						      uint16_t id, const struct sockaddr *addr,
+						      int64_t now)
+{
+	struct coap_dedup_entry *oldest = &dedup_cache[0];
+
+	/* Expired entries have the oldest expiry too */
+	ARRAY_FOR_EACH_PTR(dedup_cache, entry) {
+		if (entry->service == NULL) {
+			oldest = entry;
+			break;
+		}
+
+		if (entry->expiry < oldest->expiry) {
+			oldest = entry;
+		}
+	}
+
+	oldest->service = service;
+	oldest->addr = *addr;
+	oldest->expiry = now + CONFIG_COAP_SERVER_DEDUP_LIFETIME * MSEC_PER_SEC;
+	oldest->id = id;
+	oldest->len = 0U;
+
+	return oldest;
+}
+
+static void coap_server_dedup_store(const struct coap_service *service,
+				    const struct coap_packet *cpkt, const struct sockaddr *addr)
+{
+	struct coap_dedup_entry *entry = dedup_current;
+
+	if (entry == NULL || entry->service != service ||
+	    coap_header_get_type(cpkt) != COAP_TYPE_ACK ||
+	    coap_header_get_id(cpkt) != entry->id ||
+	    !coap_server_addr_equal(&entry->addr, addr)) {
+		return;
+	}
+
+	/* A larger response is not kept, a retransmission is handled again */
+	if (cpkt->offset > sizeof(entry->data)) {
+		entry->len = 0U;
+		return;
+	}
+
+	memcpy(entry->data, cpkt->data, cpkt->offset);
+	entry->len = cpkt->offset;
+}
+
+static void coap_server_dedup_clear(const struct coap_service *service)
+{
+	ARRAY_FOR_EACH_PTR(dedup_cache, entry) {
+		if (entry->service == service) {
+			memset(entry, 0, sizeof(*entry));
+		}
+	}
+}
+
+/* Returns true if the request is a duplicate which has been dealt with */
+static bool coap_server_dedup_check(const struct coap_service *service,
+				    const struct coap_packet *request,
+				    const struct sockaddr *addr, socklen_t addr_len)
+{
+	uint16_t id = coap_header_get_id(request);
+	int64_t now = k_uptime_get();
+	struct coap_dedup_entry *entry;
+	int ret;
+
+	entry = coap_server_dedup_find(service, id, addr, now);
+	if (entry == NULL) {
+		dedup_current = coap_server_dedup_add(service, id, addr, now);
+		return false;
+	}
+
+	if (entry->len > 0U) {
+		ret = zsock_sendto(service->data->sock_fd, entry->data, entry->len, 0,
+				   addr, addr_len);
+		if (ret < 0) {
+			LOG_ERR("Failed to resend response for %s (%d)", service->name, -errno);
+		}
+
+		return true;
+	}
+
+	if (coap_header_get_type(request) == COAP_TYPE_NON_CON) {
+		LOG_DBG("Dropping duplicate request %u for %s", id, service->name);
+		return true;
+	}
+
+	/* Nothing was kept for this confirmable request, handle it again */
+	dedup_current = entry;
+
+	return false;
+}
+
+#endif /* CONFIG_COAP_SERVER_DEDUP_CACHE */
+
 static int coap_service_remove_observer(const struct coap_service *service,
 					struct coap_resource *resource,
 					const struct sockaddr *addr,
@@ -197,6 +567,14 @@ static int coap_server_process(int sock_fd)
 		goto unlock;
 	}
 
+#if defined(CONFIG_COAP_SERVER_DEDUP_CACHE)
+	if (coap_packet_is_request(&request) &&
+	    coap_server_dedup_check(service, &request, &client_addr, client_addr_len)) {
+		ret = 0;
+		goto unlock;
+	}
+#endif
+
 	if (IS_ENABLED(CONFIG_COAP_SERVER_WELL_KNOWN_CORE) &&
 	    coap_header_get_code(&request) == COAP_METHOD_GET &&
 	    coap_uri_path_match(COAP_WELL_KNOWN_CORE_PATH, options, opt_num)) {
@@ -214,9 +592,8 @@ static int coap_server_process(int sock_fd)
 
 		ret = coap_service_send(service, &response, &client_addr, client_addr_len, NULL);
 	} else {
-		ret = coap_handle_request_len(&request, service->res_begin,
-					      COAP_SERVICE_RESOURCE_COUNT(service),
-					      options, opt_num, &client_addr, client_addr_len);
+		ret = coap_server_handle_request(service, &request, options, opt_num,
+						 &client_addr, client_addr_len);
 
 		/* Translate errors to response codes */
 		switch (ret) {
@@ -248,6 +625,9 @@ static int coap_server_process(int sock_fd)
 	}
 
 unlock:
+#if defined(CONFIG_COAP_SERVER_DEDUP_CACHE)
+	dedup_current = NULL;
+#endif
 	(void)k_mutex_unlock(&lock);
 
 	return ret;
@@ -494,6 +874,10 @@ int coap_service_stop(const struct coap_service *service)
 	ret = zsock_close(service->data->sock_fd);
 	service->data->sock_fd = -1;
 
+#if defined(CONFIG_COAP_SERVER_DEDUP_CACHE)
+	coap_server_dedup_clear(service);
+#endif
+
 	k_mutex_unlock(&lock);
 
 	coap_service_raise_event(service, NET_EVENT_COAP_SERVICE_STOPPED);
@@ -537,6 +921,10 @@ int coap_service_send(const struct coap_service *service, const struct coap_pack
 		return -EBADF;
 	}
 
+#if defined(CONFIG_COAP_SERVER_DEDUP_CACHE)
+	coap_server_dedup_store(service, cpkt, addr);
+#endif
+
 	/*
 	 * Check if we should start with retransmits, if creating a pending message fails we still
 	 * try to send.
@@ -714,6 +1102,206 @@ int coap_resource_remove_observer_by_token(struct coap_resource *resource,
 	return coap_resource_remove_observer(resource, NULL, token, token_len);
 }
 
+/* Block size of the block-wise responses, as the SZX value and in bytes */
+#define COAP_SERVER_BLOCK_SZX ((enum coap_block_size)(LOG2(CONFIG_COAP_SERVER_BLOCK_SIZE) - 4))
+#define COAP_SERVER_BLOCK_BYTES BIT(COAP_SERVER_BLOCK_SZX + 4)
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_COAP_SERVER_BLOCK_SIZE),
+	     "CONFIG_COAP_SERVER_BLOCK_SIZE must be a power of two");
+
+/* Piggybacked response to a confirmable request, a non-confirmable one otherwise */
+static int coap_server_response_init(struct coap_packet *response,
+				     const struct coap_packet *request,
+				     uint8_t *buf, size_t len, uint8_t code)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl;
+
+	if (coap_header_get_type(request) == COAP_TYPE_CON) {
+		return coap_ack_init(response, request, buf, len, code);
+	}
+
+	tkl = coap_header_get_token(request, token);
+
+	return coap_packet_init(response, buf, len, COAP_VERSION_1, COAP_TYPE_NON_CON,
+				tkl, token, code, coap_next_id());
+}
+
+static int coap_server_block_response(const struct coap_resource *resource,
+				      const struct coap_packet *request,
+				      const struct sockaddr *addr, socklen_t addr_len,
+				      uint8_t code, uint16_t option, uint32_t block_value)
+{
+	uint8_t buf[COAP_TOKEN_MAX_LEN + 16U];
+	struct coap_packet response;
+	int ret;
+
+	ret = coap_server_response_init(&response, request, buf, sizeof(buf), code);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (option != 0) {
+		ret = coap_append_option_int(&response, option, block_value);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return coap_resource_send(resource, &response, addr, addr_len, NULL);
+}
+
+int coap_resource_send_block2(const struct coap_resource *resource,
+			      const struct coap_packet *request,
+			      const struct sockaddr *addr, socklen_t addr_len,
+			      enum coap_content_format fmt, size_t total_size,
+			      coap_resource_read_cb_t cb, void *user_data)
+{
+	static uint8_t block_buf[COAP_SERVER_BLOCK_BYTES];
+	static uint8_t buf[COAP_SERVER_BLOCK_BYTES + COAP_TOKEN_MAX_LEN + 32U];
+
+	enum coap_block_size block_size = COAP_SERVER_BLOCK_SZX;
+	struct coap_packet response;
+	bool last_block = false;
+	size_t block_in_bytes;
+	size_t offset = 0;
+	uint32_t num = 0;
+	bool more;
+	int len;
+	int ret;
+
+	if (resource == NULL || request == NULL || addr == NULL || cb == NULL) {
+		return -EINVAL;
+	}
+
+	ret = coap_get_option_int(request, COAP_OPTION_BLOCK2);
+	if (ret > 0) {
+		/* Serve smaller blocks than requested if needed, at the same offset */
+		block_size = MIN(block_size, (enum coap_block_size)GET_BLOCK_SIZE(ret));
+		offset = (size_t)GET_BLOCK_NUM(ret) *
+			 coap_block_size_to_bytes((enum coap_block_size)GET_BLOCK_SIZE(ret));
+	}
+
+	block_in_bytes = coap_block_size_to_bytes(block_size);
+	num = offset / block_in_bytes;
+
+	if (total_size > 0 && offset >= total_size) {
+		return coap_server_block_response(resource, request, addr, addr_len,
+						  COAP_RESPONSE_CODE_BAD_OPTION, 0, 0);
+	}
+
+	(void)k_mutex_lock(&lock, K_FOREVER);
+
+	len = cb(offset, block_buf, block_in_bytes, &last_block, user_data);
+	if (len < 0 || len > block_in_bytes) {
+		LOG_ERR("Failed to read block at %zu (%d)", offset, len);
+		ret = coap_server_block_response(resource, request, addr, addr_len,
+						 COAP_RESPONSE_CODE_INTERNAL_ERROR, 0, 0);
+		goto unlock;
+	}
+
+	more = !last_block && len == block_in_bytes &&
+	       (total_size == 0 || offset + len < total_size);
+
+	ret = coap_server_response_init(&response, request, buf, sizeof(buf),
+					COAP_RESPONSE_CODE_CONTENT);
+	if (ret < 0) {
+		goto unlock;
+	}
+
+	ret = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT, fmt);
+	if (ret < 0) {
+		goto unlock;
+	}
+
+	ret = coap_append_option_int(&response, COAP_OPTION_BLOCK2,
+				     (num << 4) | (more ? 0x08 : 0x00) | block_size);
+	if (ret < 0) {
+		goto unlock;
+	}
+
+	if (total_size > 0) {
+		ret = coap_append_option_int(&response, COAP_OPTION_SIZE2, total_size);
+		if (ret < 0) {
+			goto unlock;
+		}
+	}
+
+	if (len > 0) {
+		ret = coap_packet_append_payload_marker(&response);
+		if (ret < 0) {
+			goto unlock;
+		}
+
+		ret = coap_packet_append_payload(&response, block_buf, len);
+		if (ret < 0) {
+			goto unlock;
+		}
+	}
+
+	ret = coap_resource_send(resource, &response, addr, addr_len, NULL);
+
+unlock:
+	(void)k_mutex_unlock(&lock);
+
+	return ret;
+}
+
+int coap_resource_recv_block1(const struct coap_resource *resource,
+			      const struct coap_packet *request,
+			      const struct sockaddr *addr, socklen_t addr_len,
+			      coap_resource_write_cb_t cb, void *user_data)
+{
+	enum coap_block_size block_size = COAP_SERVER_BLOCK_SZX;
+	const uint8_t *payload;
+	uint16_t payload_len;
+	size_t offset = 0;
+	uint32_t num = 0;
+	bool more = false;
+	uint8_t code;
+	int block;
+	int ret;
+
+	if (resource == NULL || request == NULL || addr == NULL || cb == NULL) {
+		return -EINVAL;
+	}
+
+	block = coap_get_option_int(request, COAP_OPTION_BLOCK1);
+	if (block > 0) {
+		if (GET_BLOCK_SIZE(block) > block_size) {
+			/* Ask the client to restart with blocks we can take */
+			return coap_server_block_response(resource, request, addr, addr_len,
+							  COAP_RESPONSE_CODE_REQUEST_TOO_LARGE,
+							  COAP_OPTION_BLOCK1, block_size);
+		}
+
+		block_size = GET_BLOCK_SIZE(block);
+		num = GET_BLOCK_NUM(block);
+		more = GET_MORE(block);
+		offset = (size_t)num * coap_block_size_to_bytes(block_size);
+	}
+
+	payload = coap_packet_get_payload(request, &payload_len);
+
+	ret = cb(offset, payload, payload_len, !more, user_data);
+	if (ret == -EINVAL) {
+		code = COAP_RESPONSE_CODE_INCOMPLETE;
+	} else if (ret < 0) {
+		code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
+	} else {
+		code = more ? COAP_RESPONSE_CODE_CONTINUE : COAP_RESPONSE_CODE_CHANGED;
+	}
+
+	if (block <= 0 || (code != COAP_RESPONSE_CODE_CONTINUE &&
+			   code != COAP_RESPONSE_CODE_CHANGED)) {
+		return coap_server_block_response(resource, request, addr, addr_len, code, 0, 0);
+	}
+
+	return coap_server_block_response(resource, request, addr, addr_len, code,
+					  COAP_OPTION_BLOCK1,
+					  (num << 4) | (more ? 0x08 : 0x00) | block_size);
+}
+
 static void coap_server_thread(void *p1, void *p2, void *p3)
 {
 	struct zsock_pollfd sock_fds[MAX_POLL_FD];
@@ -743,6 +1331,12 @@ static void coap_server_thread(void *p1, void *p2, void *p3)
 		}
 	}
 
+#if defined(CONFIG_COAP_SERVER_RESOURCE_TRIE)
+	COAP_SERVICE_FOREACH(svc) {
+		coap_service_trie_build(svc);
+	}
+#endif
+
 	COAP_SERVICE_FOREACH(svc) {
 		if (svc->flags & COAP_SERVICE_AUTOSTART) {
 			ret = coap_service_start(svc);
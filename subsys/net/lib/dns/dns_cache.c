@@ -9,8 +9,65 @@
 
 LOG_MODULE_REGISTER(net_dns_cache, CONFIG_DNS_RESOLVER_LOG_LEVEL);
 
+#define STALE_TIME CONFIG_DNS_RESOLVER_CACHE_STALE_TIME
+#define PREFETCH_HITS CONFIG_DNS_RESOLVER_CACHE_PREFETCH_HITS
+
 static void dns_cache_clean(struct dns_cache const *cache);
 
+static inline bool entry_matches(struct dns_cache_entry const *entry, const char *query,
+				 enum dns_query_type type)
+{
+	return entry->in_use && entry->query_type == type && strcmp(entry->query, query) == 0;
+}
+
+/* Needs to be called when lock is already acquired */
+static struct dns_cache_entry *dns_cache_alloc(struct dns_cache *cache)
+{
+	k_timepoint_t closest_to_expiry = sys_timepoint_calc(K_FOREVER);
+	size_t index_to_replace = 0;
+
+	for (size_t i = 0; i < cache->size; i++) {
+		if (!cache->entries[i].in_use) {
+			return &cache->entries[i];
+		} else if (sys_timepoint_cmp(closest_to_expiry, cache->entries[i].expiry) > 0) {
+			index_to_replace = i;
+			closest_to_expiry = cache->entries[i].expiry;
+		}
+	}
+
+	NET_DBG("Overwrite \"%s\"", cache->entries[index_to_replace].query);
+
+	return &cache->entries[index_to_replace];
+}
+
+static void dns_cache_set(struct dns_cache_entry *entry, char const *query,
+			  enum dns_query_type type, int status, uint32_t ttl)
+{
+	strncpy(entry->query, query, CONFIG_DNS_RESOLVER_MAX_QUERY_LEN - 1);
+	entry->expiry = sys_timepoint_calc(K_SECONDS(ttl));
+	/* Negative entries are never served stale */
+	entry->stale_expiry = status == 0 ? sys_timepoint_calc(K_SECONDS(ttl + STALE_TIME)) :
+					    entry->expiry;
+	entry->ttl = ttl;
+	entry->status = status;
+	entry->query_type = type;
+	entry->hits = 0;
+	entry->refreshing = false;
+	entry->in_use = true;
+}
+
+/* Popular entries are refreshed in the last tenth of their TTL, before expiring */
+static bool prefetch_due(struct dns_cache_entry const *entry)
+{
+	k_timeout_t remaining = sys_timepoint_timeout(entry->expiry);
+
+	if (PREFETCH_HITS == 0 || entry->hits < PREFETCH_HITS) {
+		return false;
+	}
+
+	return k_ticks_to_ms_floor64(remaining.ticks) < (uint64_t)entry->ttl * MSEC_PER_SEC / 10;
+}
+
 int dns_cache_flush(struct dns_cache *cache)
 {
 	k_mutex_lock(cache->lock, K_FOREVER);
@@ -25,9 +82,8 @@ int dns_cache_flush(struct dns_cache *cache)
 int dns_cache_add(struct dns_cache *cache, char const *query, struct dns_addrinfo const *addrinfo,
 		  uint32_t ttl)
 {
-	k_timepoint_t closest_to_expiry = sys_timepoint_calc(K_FOREVER);
-	size_t index_to_replace = 0;
-	bool found_empty = false;
+	enum dns_query_type type;
+	struct dns_cache_entry *entry;
 
 	if (cache == NULL || query == NULL || addrinfo == NULL || ttl == 0) {
 		return -EINVAL;
@@ -46,26 +102,57 @@ int dns_cache_add(struct dns_cache *cache, char const *query, struct dns_addrinf
 
 	dns_cache_clean(cache);
 
+	type = addrinfo->ai_family == AF_INET6 ? DNS_QUERY_TYPE_AAAA : DNS_QUERY_TYPE_A;
+
+	/* The answer replaces the entries being refreshed and negative ones */
 	for (size_t i = 0; i < cache->size; i++) {
-		if (!cache->entries[i].in_use) {
-			index_to_replace = i;
-			found_empty = true;
-			break;
-		} else if (sys_timepoint_cmp(closest_to_expiry, cache->entries[i].expiry) > 0) {
-			index_to_replace = i;
-			closest_to_expiry = cache->entries[i].expiry;
+		if (entry_matches(&cache->entries[i], query, type) &&
+		    (cache->entries[i].refreshing || cache->entries[i].status != 0)) {
+			cache->entries[i].in_use = false;
 		}
 	}
 
-	if (!found_empty) {
-		NET_DBG("Overwrite \"%s\"", cache->entries[index_to_replace].query);
+	entry = dns_cache_alloc(cache);
+	dns_cache_set(entry, query, type, 0, ttl);
+	entry->data = *addrinfo;
+
+	k_mutex_unlock(cache->lock);
+
+	return 0;
+}
+
+int dns_cache_add_negative(struct dns_cache *cache, char const *query,
+			   enum dns_query_type type, int status, uint32_t ttl)
+{
+	struct dns_cache_entry *entry;
+
+	if (cache == NULL || query == NULL || ttl == 0 ||
+	    (status != DNS_EAI_NONAME && status != DNS_EAI_NODATA)) {
+		return -EINVAL;
+	}
+
+	if (strlen(query) >= CONFIG_DNS_RESOLVER_MAX_QUERY_LEN) {
+		NET_WARN("Query string to big to be processed %u >= "
+			 "CONFIG_DNS_RESOLVER_MAX_QUERY_LEN",
+			 strlen(query));
+		return -EINVAL;
+	}
+
+	k_mutex_lock(cache->lock, K_FOREVER);
+
+	NET_DBG("Add negative \"%s\" (%d) with TTL %" PRIu32, query, status, ttl);
+
+	dns_cache_clean(cache);
+
+	for (size_t i = 0; i < cache->size; i++) {
+		if (entry_matches(&cache->entries[i], query, type)) {
+			cache->entries[i].in_use = false;
+		}
 	}
 
-	strncpy(cache->entries[index_to_replace].query, query,
-		CONFIG_DNS_RESOLVER_MAX_QUERY_LEN - 1);
-	cache->entries[index_to_replace].data = *addrinfo;
-	cache->entries[index_to_replace].expiry = sys_timepoint_calc(K_SECONDS(ttl));
-	cache->entries[index_to_replace].in_use = true;
+	entry = dns_cache_alloc(cache);
+	dns_cache_set(entry, query, type, status, ttl);
+	memset(&entry->data, 0, sizeof(entry->data));
 
 	k_mutex_unlock(cache->lock);
 
@@ -118,7 +205,10 @@ int dns_cache_find(struct dns_cache const *cache, const char *query, struct dns_
 	dns_cache_clean(cache);
 
 	for (size_t i = 0; i < cache->size; i++) {
-		if (!cache->entries[i].in_use) {
+		if (!cache->entries[i].in_use || cache->entries[i].status != 0) {
+			continue;
+		}
+		if (sys_timepoint_expired(cache->entries[i].expiry)) {
 			continue;
 		}
 		if (strcmp(cache->entries[i].query, query) != 0) {
@@ -146,6 +236,125 @@ int dns_cache_find(struct dns_cache const *cache, const char *query, struct dns_
 	return found;
 }
 
+int dns_cache_lookup(struct dns_cache *cache, const char *query, enum dns_query_type type,
+		     struct dns_addrinfo *addrinfo, size_t addrinfo_array_len, bool *refresh)
+{
+	bool refreshing = false;
+	bool prefetch = false;
+	bool stale = false;
+	size_t found = 0;
+	int status = 0;
+	int ret;
+
+	if (cache == NULL || query == NULL || addrinfo == NULL || addrinfo_array_len <= 0 ||
+	    refresh == NULL) {
+		return -EINVAL;
+	}
+
+	*refresh = false;
+
+	if (strlen(query) >= CONFIG_DNS_RESOLVER_MAX_QUERY_LEN) {
+		NET_WARN("Query string to big to be processed %u >= "
+			 "CONFIG_DNS_RESOLVER_MAX_QUERY_LEN",
+			 strlen(query));
+		return -EINVAL;
+	}
+
+	k_mutex_lock(cache->lock, K_FOREVER);
+
+	dns_cache_clean(cache);
+
+	for (size_t i = 0; i < cache->size; i++) {
+		struct dns_cache_entry *entry = &cache->entries[i];
+
+		if (!entry_matches(entry, query, type)) {
+			continue;
+		}
+
+		if (entry->hits < UINT16_MAX) {
+			entry->hits++;
+		}
+
+		refreshing |= entry->refreshing;
+
+		if (entry->status != 0) {
+			status = entry->status;
+			continue;
+		}
+
+		if (sys_timepoint_expired(entry->expiry)) {
+			stale = true;
+		} else if (prefetch_due(entry)) {
+			prefetch = true;
+		}
+
+		if (found < addrinfo_array_len) {
+			addrinfo[found++] = entry->data;
+		}
+	}
+
+	if (found > 0) {
+		if (stale) {
+			cache->stats.stale_hits++;
+		} else {
+			cache->stats.hits++;
+		}
+
+		if ((stale || prefetch) && !refreshing) {
+			for (size_t i = 0; i < cache->size; i++) {
+				if (entry_matches(&cache->entries[i], query, type)) {
+					cache->entries[i].refreshing = true;
+				}
+			}
+
+			cache->stats.refreshes++;
+			*refresh = true;
+		}
+
+		ret = found;
+	} else if (status != 0) {
+		cache->stats.negative_hits++;
+		ret = status;
+	} else {
+		cache->stats.misses++;
+		ret = 0;
+	}
+
+	k_mutex_unlock(cache->lock);
+
+	NET_DBG("Lookup \"%s\": %d%s%s", query, ret, stale ? " stale" : "",
+		*refresh ? " refresh" : "");
+
+	return ret;
+}
+
+void dns_cache_refresh_failed(struct dns_cache *cache, const char *query,
+			      enum dns_query_type type)
+{
+	k_mutex_lock(cache->lock, K_FOREVER);
+
+	for (size_t i = 0; i < cache->size; i++) {
+		if (entry_matches(&cache->entries[i], query, type)) {
+			cache->entries[i].refreshing = false;
+		}
+	}
+
+	k_mutex_unlock(cache->lock);
+}
+
+int dns_cache_get_stats(struct dns_cache *cache, struct dns_resolve_cache_stats *stats)
+{
+	if (cache == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(cache->lock, K_FOREVER);
+	*stats = cache->stats;
+	k_mutex_unlock(cache->lock);
+
+	return 0;
+}
+
 /* Needs to be called when lock is already acquired */
 static void dns_cache_clean(struct dns_cache const *cache)
 {
@@ -154,7 +363,7 @@ static void dns_cache_clean(struct dns_cache const *cache)
 			continue;
 		}
 
-		if (sys_timepoint_expired(cache->entries[i].expiry)) {
+		if (sys_timepoint_expired(cache->entries[i].stale_expiry)) {
 			NET_DBG("Remove \"%s\"", cache->entries[i].query);
 			cache->entries[i].in_use = false;
 		}
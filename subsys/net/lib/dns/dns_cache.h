@@ -22,6 +22,14 @@ struct dns_cache_entry {
 	char query[CONFIG_DNS_RESOLVER_MAX_QUERY_LEN];
 	struct dns_addrinfo data;
 	k_timepoint_t expiry;
+	/* End of the time the entry can be served while being refreshed */
+	k_timepoint_t stale_expiry;
+	uint32_t ttl;
+	/* 0, or DNS_EAI_NONAME / DNS_EAI_NODATA for a negative entry */
+	int status;
+	enum dns_query_type query_type;
+	uint16_t hits;
+	bool refreshing;
 	bool in_use;
 };
 
@@ -29,6 +37,7 @@ struct dns_cache {
 	size_t size;
 	struct dns_cache_entry *entries;
 	struct k_mutex *lock;
+	struct dns_resolve_cache_stats stats;
 };
 
 /**
@@ -71,6 +80,22 @@ int dns_cache_flush(struct dns_cache *cache);
 int dns_cache_add(struct dns_cache *cache, char const *query, struct dns_addrinfo const *addrinfo,
 		  uint32_t ttl);
 
+/**
+ * @brief Adds a negative entry to the dns cache, replacing the entries of the
+ * same query and type.
+ *
+ * @param cache Cache where the entry should be added.
+ * @param query Query which should be persisted in the cache.
+ * @param type Type of the query.
+ * @param status DNS_EAI_NONAME if the name does not exist, DNS_EAI_NODATA if it
+ * has no record of the given type.
+ * @param ttl Time to live for the entry in seconds, see RFC 2308.
+ * @retval 0 on success
+ * @retval On error, a negative value is returned.
+ */
+int dns_cache_add_negative(struct dns_cache *cache, char const *query,
+			   enum dns_query_type type, int status, uint32_t ttl);
+
 /**
  * @brief Removes all entries with the given query
  *
@@ -97,4 +122,47 @@ int dns_cache_remove(struct dns_cache *cache, char const *query);
 int dns_cache_find(struct dns_cache const *cache, const char *query, struct dns_addrinfo *addrinfo,
 		   size_t addrinfo_array_len);
 
+/**
+ * @brief Looks up the entries of a query of the given type.
+ *
+ * Unlike dns_cache_find(), expired entries are returned as long as they can be
+ * served stale, see CONFIG_DNS_RESOLVER_CACHE_STALE_TIME, and the lookup is
+ * counted in the cache statistics.
+ *
+ * @param cache Cache where the entry should be searched.
+ * @param query Query which should be searched for.
+ * @param type Type of the query.
+ * @param addrinfo dns_addrinfo array which will be written if the query was found.
+ * @param addrinfo_array_len Array size of the dns_addrinfo array
+ * @param refresh Set to true if the caller should query the entries again, because
+ * they are expired or about to expire. Following lookups do not ask for it until
+ * the entries are replaced or dns_cache_refresh_failed() is called.
+ * @retval on success the amount of dns_addrinfo written into the addrinfo array will be returned.
+ * A cache miss will therefore return a 0.
+ * @retval DNS_EAI_NONAME or DNS_EAI_NODATA if a negative entry was found.
+ * @retval On error another negative value is returned.
+ */
+int dns_cache_lookup(struct dns_cache *cache, const char *query, enum dns_query_type type,
+		     struct dns_addrinfo *addrinfo, size_t addrinfo_array_len, bool *refresh);
+
+/**
+ * @brief Allows the entries of a query to be refreshed again after a failed refresh.
+ *
+ * @param cache Cache of the entries.
+ * @param query Query of the entries.
+ * @param type Type of the query.
+ */
+void dns_cache_refresh_failed(struct dns_cache *cache, const char *query,
+			      enum dns_query_type type);
+
+/**
+ * @brief Gets the statistics of the cache.
+ *
+ * @param cache Cache to get the statistics from.
+ * @param stats Statistics written by this function.
+ * @retval 0 on success
+ * @retval On error, a negative value is returned.
+ */
+int dns_cache_get_stats(struct dns_cache *cache, struct dns_resolve_cache_stats *stats);
+
 #endif /* ZEPHYR_INCLUDE_NET_DNS_CACHE_H_ */
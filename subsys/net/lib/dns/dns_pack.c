@@ -6,6 +6,7 @@
 
 #include <string.h>
 #include <zephyr/net/buf.h>
+#include <zephyr/sys/byteorder.h>
 
 #include "dns_pack.h"
 
@@ -177,6 +178,49 @@ int dns_unpack_answer(struct dns_msg_t *dns_msg, int dname_ptr, uint32_t *ttl,
 	return 0;
 }
 
+int dns_unpack_soa_ttl(struct dns_msg_t *dns_msg, uint32_t *ttl)
+{
+	uint16_t offset = dns_msg->answer_offset;
+	int count = dns_header_nscount(dns_msg->msg);
+
+	for (int i = 0; i < count; i++) {
+		uint8_t *rr = dns_msg->msg + offset;
+		int rem_size = dns_msg->msg_size - offset;
+		int dname_len;
+		int rdlength;
+
+		dname_len = skip_fqdn(rr, rem_size);
+		if (dname_len < 0) {
+			return dname_len;
+		}
+
+		/* type + class + ttl + rdlength */
+		if (rem_size < dname_len + 2 + 2 + 4 + 2) {
+			return -EINVAL;
+		}
+
+		rdlength = dns_answer_rdlength(dname_len, rr);
+		if (rem_size < dname_len + 2 + 2 + 4 + 2 + rdlength) {
+			return -EINVAL;
+		}
+
+		if (dns_answer_type(dname_len, rr) == DNS_RR_TYPE_SOA) {
+			/* MINIMUM is the last of the five 32 bit fields ending the SOA data */
+			if (rdlength < 5 * 4) {
+				return -EINVAL;
+			}
+
+			*ttl = MIN((uint32_t)dns_answer_ttl(dname_len, rr),
+				   sys_get_be32(rr + dname_len + 2 + 2 + 4 + 2 + rdlength - 4));
+			return 0;
+		}
+
+		offset += dname_len + 2 + 2 + 4 + 2 + rdlength;
+	}
+
+	return -ENOENT;
+}
+
 int dns_unpack_response_header(struct dns_msg_t *msg, int src_id)
 {
 	uint8_t *dns_header;
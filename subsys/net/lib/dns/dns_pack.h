@@ -89,6 +89,7 @@ enum dns_rr_type {
 	DNS_RR_TYPE_INVALID = 0,
 	DNS_RR_TYPE_A	= 1,		/* IPv4  */
 	DNS_RR_TYPE_CNAME = 5,		/* CNAME */
+	DNS_RR_TYPE_SOA = 6,		/* SOA   */
 	DNS_RR_TYPE_PTR = 12,		/* PTR   */
 	DNS_RR_TYPE_TXT = 16,		/* TXT   */
 	DNS_RR_TYPE_AAAA = 28,		/* IPv6  */
@@ -347,6 +348,19 @@ int dns_msg_pack_qname(uint16_t *len, uint8_t *buf, uint16_t size,
 int dns_unpack_answer(struct dns_msg_t *dns_msg, int dname_ptr, uint32_t *ttl,
 		      enum dns_rr_type *type);
 
+/**
+ * @brief Gets the TTL of a negative answer from the SOA record of its
+ *        authority section, see RFC 2308 section 5.
+ *
+ * @param dns_msg Structure containing the message, the answer_offset
+ *        field must point to the authority section.
+ * @param ttl Minimum of the SOA TTL and of its MINIMUM field.
+ * @retval 0 on success
+ * @retval -ENOENT if there is no SOA record
+ * @retval -EINVAL if the message is malformed
+ */
+int dns_unpack_soa_ttl(struct dns_msg_t *dns_msg, uint32_t *ttl);
+
 /**
  * @brief Unpacks the header's response.
  *
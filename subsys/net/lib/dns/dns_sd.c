@@ -88,6 +88,22 @@ size_t service_proto_size(const struct dns_sd_rec *ref)
 	;
 }
 
+/**
+ * Calculate the size of a DNS-SD PTR record
+ *
+ * The service name is written uncompressed, e.g. "._foo._tcp.local.",
+ * followed by the resource record and the instance name, which is
+ * compressed, e.g. ".My Foo" followed by (DNS_SD_PTR_MASK | 0x0abc).
+ *
+ * @param ref the DNS-SD record
+ * @return the size of the PTR record written by add_ptr_record()
+ */
+static size_t ptr_record_size(const struct dns_sd_rec *ref)
+{
+	return service_proto_size(ref) + sizeof(struct dns_rr)
+	       + DNS_LABEL_LEN_SIZE + strlen(ref->instance) + DNS_POINTER_SIZE;
+}
+
 /**
  * Check Label Validity according to RFC 1035, Section 3.5
  *
@@ -388,12 +404,7 @@ int add_ptr_record(const struct dns_sd_rec *inst, uint32_t ttl,
 	 * For more information on DNS Message Compression, see
 	 * RFC 1035, Section 4.1.4.
 	 */
-	name_size =
-		/* uncompressed. e.g. "._foo._tcp.local." */
-		sp_size +
-		sizeof(*rr)
-		/* compressed e.g. .My Foo" followed by (DNS_SD_PTR_MASK | 0x0abc) */
-		+ 1 + strlen(inst->instance) + 2;
+	name_size = ptr_record_size(inst);
 
 	if (offset > buf_size || name_size >= buf_size - offset) {
 		NET_DBG("Buffer too small. required: %u available: %d",
@@ -707,8 +718,55 @@ static inline bool port_in_use(uint16_t proto, uint16_t port, const struct in_ad
 #endif /* CONFIG_NET_TEST */
 
 
+static int check_advertised(const struct dns_sd_rec *inst, const struct in_addr *addr4,
+			    const struct in6_addr *addr6)
+{
+	uint16_t proto;
+
+	if (!rec_is_valid(inst)) {
+		return -EINVAL;
+	}
+
+	if (*(inst->port) == 0) {
+		NET_DBG("Ephemeral port %u for %s.%s.%s.%s not initialized",
+			ntohs(*(inst->port)), inst->instance, inst->service, inst->proto,
+			inst->domain);
+		return -EHOSTDOWN;
+	}
+
+	if (strncmp("_tcp", inst->proto, DNS_SD_PROTO_SIZE) == 0) {
+		proto = IPPROTO_TCP;
+	} else if (strncmp("_udp", inst->proto, DNS_SD_PROTO_SIZE) == 0) {
+		proto = IPPROTO_UDP;
+	} else {
+		NET_DBG("invalid protocol %s", inst->proto);
+		return -EINVAL;
+	}
+
+	if (!port_in_use(proto, ntohs(*(inst->port)), addr4, addr6)) {
+		/* Service is not yet bound, so do not advertise */
+		NET_DBG("service not bound");
+		return -EHOSTDOWN;
+	}
+
+	return 0;
+}
+
+bool dns_sd_rec_is_advertised(const struct dns_sd_rec *inst, const struct in_addr *addr4,
+			      const struct in6_addr *addr6)
+{
+	return check_advertised(inst, addr4, addr6) == 0;
+}
+
 int dns_sd_handle_ptr_query(const struct dns_sd_rec *inst, const struct in_addr *addr4,
 			    const struct in6_addr *addr6, uint8_t *buf, uint16_t buf_size)
+{
+	return dns_sd_handle_ptr_queries(&inst, 1, addr4, addr6, buf, buf_size);
+}
+
+int dns_sd_handle_ptr_queries(const struct dns_sd_rec *const *inst, size_t count,
+			      const struct in_addr *addr4, const struct in6_addr *addr6,
+			      uint8_t *buf, uint16_t buf_size)
 {
 	/*
 	 * RFC 6763 Section 12.1
@@ -728,90 +786,96 @@ int dns_sd_handle_ptr_query(const struct dns_sd_rec *inst, const struct in_addr
 	uint16_t service_offset;
 	uint16_t domain_offset;
 	uint16_t host_offset;
-	uint16_t proto;
-	uint16_t offset = sizeof(struct dns_header);
+	uint16_t answer_offset = sizeof(struct dns_header);
+	uint16_t offset;
+	size_t answers_size = 0;
 	struct dns_header *rsp = (struct dns_header *)buf;
 	uint32_t tmp;
+	size_t i;
 	int r;
 
 	memset(rsp, 0, sizeof(*rsp));
 
-	if (!rec_is_valid(inst)) {
+	if (count == 0) {
 		return -EINVAL;
 	}
 
-	if (*(inst->port) == 0) {
-		NET_DBG("Ephemeral port %u for %s.%s.%s.%s not initialized",
-			ntohs(*(inst->port)), inst->instance, inst->service, inst->proto,
-			inst->domain);
-		return -EHOSTDOWN;
-	}
-
-	if (strncmp("_tcp", inst->proto, DNS_SD_PROTO_SIZE) == 0) {
-		proto = IPPROTO_TCP;
-	} else if (strncmp("_udp", inst->proto, DNS_SD_PROTO_SIZE) == 0) {
-		proto = IPPROTO_UDP;
-	} else {
-		NET_DBG("invalid protocol %s", inst->proto);
-		return -EINVAL;
-	}
-
-	if (!port_in_use(proto, ntohs(*(inst->port)), addr4, addr6)) {
-		/* Service is not yet bound, so do not advertise */
-		return -EHOSTDOWN;
-	}
+	for (i = 0; i < count; i++) {
+		r = check_advertised(inst[i], addr4, addr6);
+		if (r < 0) {
+			return r;
+		}
 
-	/* first add the answer record */
-	r = add_ptr_record(inst, DNS_SD_PTR_TTL, buf, offset, buf_size - offset, &service_offset,
-			   &instance_offset, &domain_offset);
-	if (r < 0) {
-		return r; /* LCOV_EXCL_LINE */
+		answers_size += ptr_record_size(inst[i]);
 	}
 
-	rsp->ancount++;
-	offset += r;
-
-	/* then add the additional records */
-	r = add_txt_record(inst, DNS_SD_TXT_TTL, instance_offset, buf, offset, buf_size - offset);
-	if (r < 0) {
-		return r; /* LCOV_EXCL_LINE */
+	if (buf_size < sizeof(struct dns_header) ||
+	    answers_size >= buf_size - sizeof(struct dns_header)) {
+		NET_DBG("Buffer too small. required: %zu available: %d",
+			answers_size, (int)buf_size - (int)sizeof(struct dns_header));
+		return -ENOSPC;
 	}
 
-	rsp->arcount++;
-	offset += r;
+	/* The answers come first, the additional records of each answer
+	 * are placed after all of them.
+	 */
+	offset = answer_offset + answers_size;
 
-	r = add_srv_record(inst, DNS_SD_SRV_TTL, instance_offset, domain_offset, buf, offset,
-			   buf_size - offset, &host_offset);
-	if (r < 0) {
-		return r; /* LCOV_EXCL_LINE */
-	}
+	for (i = 0; i < count; i++) {
+		r = add_ptr_record(inst[i], DNS_SD_PTR_TTL, buf, answer_offset,
+				   buf_size - answer_offset, &service_offset,
+				   &instance_offset, &domain_offset);
+		if (r < 0) {
+			return r; /* LCOV_EXCL_LINE */
+		}
 
-	rsp->arcount++;
-	offset += r;
+		rsp->ancount++;
+		answer_offset += r;
 
-	if (addr6 != NULL) {
-		r = add_aaaa_record(inst, DNS_SD_AAAA_TTL, host_offset, addr6->s6_addr, buf, offset,
-				    buf_size - offset); /* LCOV_EXCL_LINE */
+		r = add_txt_record(inst[i], DNS_SD_TXT_TTL, instance_offset, buf, offset,
+				   buf_size - offset);
 		if (r < 0) {
 			return r; /* LCOV_EXCL_LINE */
 		}
 
 		rsp->arcount++;
 		offset += r;
-	}
 
-	if (addr4 != NULL) {
-		tmp = htonl(*(addr4->s4_addr32));
-		r = add_a_record(inst, DNS_SD_A_TTL, host_offset, tmp, buf, offset,
-				 buf_size - offset);
+		r = add_srv_record(inst[i], DNS_SD_SRV_TTL, instance_offset, domain_offset, buf,
+				   offset, buf_size - offset, &host_offset);
 		if (r < 0) {
 			return r; /* LCOV_EXCL_LINE */
 		}
 
 		rsp->arcount++;
 		offset += r;
+
+		if (addr6 != NULL) {
+			r = add_aaaa_record(inst[i], DNS_SD_AAAA_TTL, host_offset, addr6->s6_addr,
+					    buf, offset, buf_size - offset); /* LCOV_EXCL_LINE */
+			if (r < 0) {
+				return r; /* LCOV_EXCL_LINE */
+			}
+
+			rsp->arcount++;
+			offset += r;
+		}
+
+		if (addr4 != NULL) {
+			tmp = htonl(*(addr4->s4_addr32));
+			r = add_a_record(inst[i], DNS_SD_A_TTL, host_offset, tmp, buf, offset,
+					 buf_size - offset);
+			if (r < 0) {
+				return r; /* LCOV_EXCL_LINE */
+			}
+
+			rsp->arcount++;
+			offset += r;
+		}
 	}
 
+	__ASSERT_NO_MSG(answer_offset == sizeof(struct dns_header) + answers_size);
+
 	/* Set the Response and AA bits */
 	rsp->flags = htons(BIT(15) | BIT(10));
 	rsp->ancount = htons(rsp->ancount);
@@ -823,54 +887,47 @@ int dns_sd_handle_ptr_query(const struct dns_sd_rec *inst, const struct in_addr
 int dns_sd_handle_service_type_enum(const struct dns_sd_rec *inst,
 				    const struct in_addr *addr4, const struct in6_addr *addr6,
 				    uint8_t *buf, uint16_t buf_size)
+{
+	return dns_sd_handle_service_type_enums(&inst, 1, addr4, addr6, buf, buf_size);
+}
+
+int dns_sd_handle_service_type_enums(const struct dns_sd_rec *const *inst, size_t count,
+				     const struct in_addr *addr4, const struct in6_addr *addr6,
+				     uint8_t *buf, uint16_t buf_size)
 {
 	static const char query[] = { "\x09_services\x07_dns-sd\x04_udp\x05local" };
 	/* offset of '.local' in the above */
-	uint16_t domain_offset = DNS_SD_PTR_MASK | 35;
-	uint16_t proto;
-	int name_size;
+	uint16_t domain_offset = htons(DNS_SD_PTR_MASK | 35);
+	/* the answers after the first one point to the above */
+	uint16_t query_offset = htons(DNS_SD_PTR_MASK | sizeof(struct dns_header));
+	int name_size = 0;
 	uint16_t service_size;
 	uint16_t offset = sizeof(struct dns_header);
 	struct dns_rr *rr;
 	struct dns_header *const rsp = (struct dns_header *)buf;
+	size_t i;
+	int r;
 
-	if (!rec_is_valid(inst)) {
+	if (count == 0) {
 		return -EINVAL;
 	}
 
-	if (*(inst->port) == 0) {
-		NET_DBG("Ephemeral port %u for %s.%s.%s.%s "
-			"not initialized",
-			ntohs(*(inst->port)), inst->instance, inst->service, inst->proto,
-			inst->domain);
-		return -EHOSTDOWN;
-	}
-
-	if (strncmp("_tcp", inst->proto, DNS_SD_PROTO_SIZE) == 0) {
-		proto = IPPROTO_TCP;
-	} else if (strncmp("_udp", inst->proto, DNS_SD_PROTO_SIZE) == 0) {
-		proto = IPPROTO_UDP;
-	} else {
-		NET_DBG("invalid protocol %s", inst->proto);
-		return -EINVAL;
-	}
+	for (i = 0; i < count; i++) {
+		r = check_advertised(inst[i], addr4, addr6);
+		if (r < 0) {
+			return r;
+		}
 
-	if (!port_in_use(proto, ntohs(*(inst->port)), addr4, addr6)) {
-		/* Service is not yet bound, so do not advertise */
-		NET_DBG("service not bound");
-		return -EHOSTDOWN;
+		name_size +=
+			/* uncompressed. e.g. "._foo._tcp.local." */
+			(i == 0 ? sizeof(query) : DNS_POINTER_SIZE)
+			+ sizeof(*rr)
+			/* compressed e.g. ._googlecast._tcp" followed by (DNS_SD_PTR_MASK | 0x0abc) */
+			+ DNS_LABEL_LEN_SIZE + strlen(inst[i]->service)
+			+ DNS_LABEL_LEN_SIZE + DNS_SD_PROTO_SIZE
+			+ DNS_POINTER_SIZE;
 	}
 
-	service_size = strlen(inst->service);
-	name_size =
-		/* uncompressed. e.g. "._foo._tcp.local." */
-		sizeof(query)
-		+ sizeof(*rr)
-		/* compressed e.g. ._googlecast._tcp" followed by (DNS_SD_PTR_MASK | 0x0abc) */
-		+ DNS_LABEL_LEN_SIZE + service_size
-		+ DNS_LABEL_LEN_SIZE + DNS_SD_PROTO_SIZE
-		+ DNS_POINTER_SIZE;
-
 	if (offset > buf_size || name_size >= buf_size - offset) {
 		NET_DBG("Buffer too small. required: %u available: %d", name_size,
 			(int)buf_size - (int)offset);
@@ -881,29 +938,37 @@ int dns_sd_handle_service_type_enum(const struct dns_sd_rec *inst,
 	memcpy(&buf[offset], query, sizeof(query));
 	offset += sizeof(query);
 
-	rr = (struct dns_rr *)&buf[offset];
-	rr->type = htons(DNS_RR_TYPE_PTR);
-	rr->class_ = htons(DNS_CLASS_IN);
-	rr->ttl = htonl(DNS_SD_PTR_TTL);
-	rr->rdlength = htons(0
-		+ DNS_LABEL_LEN_SIZE + service_size
-		+ DNS_LABEL_LEN_SIZE + DNS_SD_PROTO_SIZE
-		+ DNS_POINTER_SIZE);
-	offset += sizeof(*rr);
+	for (i = 0; i < count; i++) {
+		if (i > 0) {
+			memcpy(&buf[offset], &query_offset, sizeof(query_offset));
+			offset += sizeof(query_offset);
+		}
 
-	buf[offset++] = service_size;
-	memcpy(&buf[offset], inst->service, service_size);
-	offset += service_size;
-	buf[offset++] = DNS_SD_PROTO_SIZE;
-	memcpy(&buf[offset], inst->proto, DNS_SD_PROTO_SIZE);
-	offset += DNS_SD_PROTO_SIZE;
-	domain_offset = htons(domain_offset);
-	memcpy(&buf[offset], &domain_offset, sizeof(domain_offset));
-	offset += sizeof(domain_offset);
+		service_size = strlen(inst[i]->service);
+
+		rr = (struct dns_rr *)&buf[offset];
+		rr->type = htons(DNS_RR_TYPE_PTR);
+		rr->class_ = htons(DNS_CLASS_IN);
+		rr->ttl = htonl(DNS_SD_PTR_TTL);
+		rr->rdlength = htons(0
+			+ DNS_LABEL_LEN_SIZE + service_size
+			+ DNS_LABEL_LEN_SIZE + DNS_SD_PROTO_SIZE
+			+ DNS_POINTER_SIZE);
+		offset += sizeof(*rr);
+
+		buf[offset++] = service_size;
+		memcpy(&buf[offset], inst[i]->service, service_size);
+		offset += service_size;
+		buf[offset++] = DNS_SD_PROTO_SIZE;
+		memcpy(&buf[offset], inst[i]->proto, DNS_SD_PROTO_SIZE);
+		offset += DNS_SD_PROTO_SIZE;
+		memcpy(&buf[offset], &domain_offset, sizeof(domain_offset));
+		offset += sizeof(domain_offset);
+	}
 
 	/* Set the Response and AA bits */
 	rsp->flags = htons(BIT(15) | BIT(10));
-	rsp->ancount = htons(1);
+	rsp->ancount = htons(count);
 
 	return offset;
 }
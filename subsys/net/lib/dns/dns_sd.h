@@ -171,6 +171,29 @@ int dns_sd_handle_ptr_query(const struct dns_sd_rec *inst,
 	const struct in_addr *addr4, const struct in6_addr *addr6,
 	uint8_t *buf, uint16_t buf_size);
 
+/**
+ * @brief Handle a DNS PTR Query matching several DNS-SD records
+ *
+ * This function works like @ref dns_sd_handle_ptr_query but puts the
+ * answers for all of the records into a single response. The PTR
+ * records come first and are followed by the additional records of
+ * each of them.
+ *
+ * @param inst array of DNS-SD records to advertise
+ * @param count number of records in @p inst
+ * @param addr4 pointer to the IPv4 address
+ * @param addr6 pointer to the IPv6 address
+ * @param buf output buffer
+ * @param buf_size size of the output buffer
+ *
+ * @return on success, number of bytes written to @p buf
+ * @return -ENOSPC if the answers do not fit into @p buf
+ * @return on other failures, a negative errno value
+ */
+int dns_sd_handle_ptr_queries(const struct dns_sd_rec *const *inst, size_t count,
+			      const struct in_addr *addr4, const struct in6_addr *addr6,
+			      uint8_t *buf, uint16_t buf_size);
+
 /**
  * @brief Handle a Service Type Enumeration with DNS Service Discovery
  *
@@ -189,6 +212,43 @@ int dns_sd_handle_service_type_enum(const struct dns_sd_rec *service,
 	const struct in_addr *addr4, const struct in6_addr *addr6,
 	uint8_t *buf, uint16_t buf_size);
 
+/**
+ * @brief Handle a Service Type Enumeration for several service types
+ *
+ * This function works like @ref dns_sd_handle_service_type_enum but
+ * puts one answer for each of the records into a single response. The
+ * caller should pass only one record of each service type.
+ *
+ * @param service array of DNS-SD services to advertise
+ * @param count number of services in @p service
+ * @param addr4 pointer to the IPv4 address
+ * @param addr6 pointer to the IPv6 address
+ * @param buf output buffer
+ * @param buf_size size of the output buffer
+ *
+ * @return on success, number of bytes written to @p buf
+ * @return -ENOSPC if the answers do not fit into @p buf
+ * @return on other failures, a negative errno value
+ */
+int dns_sd_handle_service_type_enums(const struct dns_sd_rec *const *service, size_t count,
+				     const struct in_addr *addr4, const struct in6_addr *addr6,
+				     uint8_t *buf, uint16_t buf_size);
+
+/**
+ * @brief Check if a DNS-SD record can be advertised
+ *
+ * The record must be valid and its port must be bound on one of the
+ * given addresses.
+ *
+ * @param inst the DNS-SD record
+ * @param addr4 pointer to the IPv4 address
+ * @param addr6 pointer to the IPv6 address
+ *
+ * @return true if @p inst can be advertised, false otherwise
+ */
+bool dns_sd_rec_is_advertised(const struct dns_sd_rec *inst, const struct in_addr *addr4,
+			      const struct in6_addr *addr6);
+
 #ifdef __cplusplus
 };
 #endif
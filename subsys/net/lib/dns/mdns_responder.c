@@ -16,6 +16,7 @@ LOG_MODULE_REGISTER(net_mdns_responder, CONFIG_MDNS_RESPONDER_LOG_LEVEL);
 
 #include <zephyr/kernel.h>
 #include <zephyr/init.h>
+#include <ctype.h>
 #include <string.h>
 #include <strings.h>
 #include <errno.h>
@@ -26,6 +27,8 @@ LOG_MODULE_REGISTER(net_mdns_responder, CONFIG_MDNS_RESPONDER_LOG_LEVEL);
 #include <zephyr/net/net_pkt.h>
 #include <zephyr/net/dns_resolve.h>
 #include <zephyr/net/igmp.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/byteorder.h>
 
 #include "dns_sd.h"
 #include "dns_pack.h"
@@ -51,6 +54,45 @@ static struct net_context *ipv6[MAX_IPV6_IFACE_COUNT];
 #define MAX_IPV6_IFACE_COUNT 0
 #endif
 
+/* RFC 6762 ch 6, answers with shared records are delayed by 20-120 ms */
+#define SD_ANSWER_DELAY_MIN_MS 20
+#define SD_ANSWER_DELAY_MAX_MS 120
+
+/* One listening context, with the DNS-SD answers waiting to be sent */
+struct mdns_listener {
+	struct net_context *ctx;
+	struct net_if *iface;
+	sa_family_t family;
+#if defined(CONFIG_MDNS_RESPONDER_DNS_SD)
+	struct k_work_delayable work;
+	struct k_mutex lock;
+	/* Address of the first querier, used to select our address */
+	union {
+		struct in_addr in;
+		struct in6_addr in6;
+	} src;
+	const struct dns_sd_rec *ptr[CONFIG_MDNS_RESPONDER_DNS_SD_MAX_ANSWERS];
+	const struct dns_sd_rec *types[CONFIG_MDNS_RESPONDER_DNS_SD_MAX_ANSWERS];
+	uint8_t ptr_count;
+	uint8_t types_count;
+#endif /* CONFIG_MDNS_RESPONDER_DNS_SD */
+};
+
+static struct mdns_listener listeners[MAX_IPV6_IFACE_COUNT + MAX_IPV4_IFACE_COUNT];
+
+/* A resource record that we would send, to compare with known answers */
+struct mdns_answer {
+	enum dns_rr_type type;
+	uint32_t ttl;
+	const char *name[DNS_SD_MAX_LABELS];
+	size_t name_count;
+	/* PTR records point to a name, address records hold the address */
+	const char *target[DNS_SD_MAX_LABELS];
+	size_t target_count;
+	const void *addr;
+	uint16_t addr_len;
+};
+
 static struct net_mgmt_event_callback mgmt_cb;
 static const struct dns_sd_rec *external_records;
 static size_t external_records_count;
@@ -59,7 +101,8 @@ static size_t external_records_count;
 
 /* This value is recommended by RFC 1035 */
 #define DNS_RESOLVER_MAX_BUF_SIZE	512
-#define DNS_RESOLVER_MIN_BUF		2
+/* Query and its decoded name, plus the delayed DNS-SD response */
+#define DNS_RESOLVER_MIN_BUF		3
 #define DNS_RESOLVER_BUF_CTR	(DNS_RESOLVER_MIN_BUF + \
 				 CONFIG_MDNS_RESOLVER_ADDITIONAL_BUF_CTR)
 
@@ -187,73 +230,178 @@ static void setup_dns_hdr(uint8_t *buf, uint16_t answers)
 	UNALIGNED_PUT(0, (uint16_t *)(buf + offset));
 }
 
-static void add_answer(struct net_buf *query, enum dns_rr_type qtype,
-		       uint32_t ttl, uint16_t addr_len, uint8_t *addr)
+/* Returns the offset after the name at @p pos, or a negative value */
+static int skip_name(const struct dns_msg_t *dns_msg, int pos)
 {
-	char *dot = query->data + DNS_MSG_HEADER_SIZE;
-	char *prev = NULL;
-	uint16_t offset;
+	while (pos < dns_msg->msg_size) {
+		uint8_t len = dns_msg->msg[pos];
+
+		if ((len & NS_CMPRSFLGS) == NS_CMPRSFLGS) {
+			return pos + DNS_POINTER_SIZE;
+		}
+
+		if (len == 0) {
+			return pos + DNS_LABEL_LEN_SIZE;
+		}
+
+		pos += DNS_LABEL_LEN_SIZE + len;
+	}
+
+	return -EINVAL;
+}
+
+static bool name_equals(const struct dns_msg_t *dns_msg, int pos,
+			const char *const *labels, size_t count)
+{
+	size_t i = 0;
+
+	while (pos < dns_msg->msg_size) {
+		uint8_t len = dns_msg->msg[pos];
+		int next;
+
+		if ((len & NS_CMPRSFLGS) == NS_CMPRSFLGS) {
+			if (pos + 1 >= dns_msg->msg_size) {
+				return false;
+			}
 
-	while ((dot = strchr(dot, '.'))) {
-		if (!prev) {
-			prev = dot++;
+			next = ((len & ~NS_CMPRSFLGS) << 8) | dns_msg->msg[pos + 1];
+
+			/* Only follow pointers backwards, so that there are no loops */
+			if (next >= pos) {
+				return false;
+			}
+
+			pos = next;
 			continue;
 		}
 
-		*prev = dot - prev - 1;
-		prev = dot++;
+		if (len == 0) {
+			return i == count;
+		}
+
+		if (i == count ||
+		    pos + DNS_LABEL_LEN_SIZE + len > dns_msg->msg_size ||
+		    strlen(labels[i]) != len ||
+		    strncasecmp((const char *)&dns_msg->msg[pos + DNS_LABEL_LEN_SIZE],
+				labels[i], len) != 0) {
+			return false;
+		}
+
+		pos += DNS_LABEL_LEN_SIZE + len;
+		i++;
+	}
+
+	return false;
+}
+
+/* Known answers follow the questions, see RFC 6762 ch 7.1 */
+static void known_answers_init(struct dns_msg_t *dns_msg, int queries)
+{
+	int pos = DNS_MSG_HEADER_SIZE;
+
+	dns_msg->answer_offset = 0;
+
+	while (queries-- > 0) {
+		pos = skip_name(dns_msg, pos);
+		if (pos < 0) {
+			return;
+		}
+
+		pos += DNS_QTYPE_LEN + DNS_QCLASS_LEN;
+	}
+
+	if (pos <= dns_msg->msg_size) {
+		dns_msg->answer_offset = pos;
 	}
+}
 
-	if (prev) {
-		*prev = strlen(prev) - 1;
+/* The querier already has the answer if it is listed with at least half of
+ * our TTL, in which case it must not be sent.
+ */
+static bool is_known_answer(const struct dns_msg_t *dns_msg,
+			    const struct mdns_answer *answer)
+{
+	int count = dns_header_ancount(dns_msg->msg);
+	int pos = dns_msg->answer_offset;
+
+	if (pos == 0) {
+		return false;
 	}
 
-	/* terminator byte (0x00) */
-	query->len += 1;
+	while (count-- > 0) {
+		int name = pos;
+		uint16_t rdlength;
+		uint16_t type;
+		uint32_t ttl;
 
-	offset = DNS_MSG_HEADER_SIZE + query->len;
-	UNALIGNED_PUT(htons(qtype), (uint16_t *)(query->data+offset));
+		pos = skip_name(dns_msg, pos);
+		if (pos < 0 || pos + sizeof(struct dns_rr) > dns_msg->msg_size) {
+			return false;
+		}
 
-	/* Bit 15 tells to flush the cache */
-	offset += DNS_QTYPE_LEN;
-	UNALIGNED_PUT(htons(DNS_CLASS_IN | BIT(15)),
-		      (uint16_t *)(query->data+offset));
+		type = sys_get_be16(&dns_msg->msg[pos]);
+		ttl = sys_get_be32(&dns_msg->msg[pos + DNS_QTYPE_LEN + DNS_QCLASS_LEN]);
+		rdlength = sys_get_be16(&dns_msg->msg[pos + sizeof(struct dns_rr) -
+						      DNS_RDLENGTH_LEN]);
+		pos += sizeof(struct dns_rr);
 
+		if (pos + rdlength > dns_msg->msg_size) {
+			return false;
+		}
 
-	offset += DNS_QCLASS_LEN;
-	UNALIGNED_PUT(htonl(ttl), query->data + offset);
+		if (type == answer->type && ttl >= answer->ttl / 2 &&
+		    name_equals(dns_msg, name, answer->name, answer->name_count)) {
+			if (answer->addr != NULL) {
+				if (rdlength == answer->addr_len &&
+				    memcmp(&dns_msg->msg[pos], answer->addr, rdlength) == 0) {
+					return true;
+				}
+			} else if (name_equals(dns_msg, pos, answer->target,
+					       answer->target_count)) {
+				return true;
+			}
+		}
 
-	offset += DNS_TTL_LEN;
-	UNALIGNED_PUT(htons(addr_len), query->data + offset);
+		pos += rdlength;
+	}
 
-	offset += DNS_RDLENGTH_LEN;
-	memcpy(query->data + offset, addr, addr_len);
+	return false;
 }
 
-static int create_answer(struct net_context *ctx,
-			 struct net_buf *query,
-			 enum dns_rr_type qtype,
-			 uint16_t addr_len, uint8_t *addr)
+static int add_answer(struct net_buf *buf, const struct mdns_answer *answer)
 {
-	/* Prepare the response into the query buffer: move the name
-	 * query buffer has to get enough free space: dns_hdr + answer
-	 */
-	if ((query->size - query->len) < (DNS_MSG_HEADER_SIZE +
-					  DNS_QTYPE_LEN + DNS_QCLASS_LEN +
-					  DNS_TTL_LEN + DNS_RDLENGTH_LEN +
-					  addr_len)) {
+	size_t name_len = DNS_LABEL_LEN_SIZE;
+	bool first = buf->len == DNS_MSG_HEADER_SIZE;
+	size_t i;
+
+	for (i = 0; i < answer->name_count; i++) {
+		name_len += DNS_LABEL_LEN_SIZE + strlen(answer->name[i]);
+	}
+
+	/* The answers after the first one point to its name */
+	if (net_buf_tailroom(buf) < (first ? name_len : DNS_POINTER_SIZE) +
+				    sizeof(struct dns_rr) + answer->addr_len) {
 		return -ENOBUFS;
 	}
 
-	memmove(query->data + DNS_MSG_HEADER_SIZE, query->data, query->len);
+	if (first) {
+		for (i = 0; i < answer->name_count; i++) {
+			net_buf_add_u8(buf, strlen(answer->name[i]));
+			net_buf_add_mem(buf, answer->name[i], strlen(answer->name[i]));
+		}
 
-	setup_dns_hdr(query->data, 1);
+		net_buf_add_u8(buf, 0);
+	} else {
+		net_buf_add_be16(buf, (NS_CMPRSFLGS << 8) | DNS_MSG_HEADER_SIZE);
+	}
 
-	add_answer(query, qtype, MDNS_TTL, addr_len, addr);
+	net_buf_add_be16(buf, answer->type);
 
-	query->len += DNS_MSG_HEADER_SIZE +
-		DNS_QTYPE_LEN + DNS_QCLASS_LEN +
-		DNS_TTL_LEN + DNS_RDLENGTH_LEN + addr_len;
+	/* Bit 15 tells to flush the cache */
+	net_buf_add_be16(buf, DNS_CLASS_IN | BIT(15));
+	net_buf_add_be32(buf, answer->ttl);
+	net_buf_add_be16(buf, answer->addr_len);
+	net_buf_add_mem(buf, answer->addr, answer->addr_len);
 
 	return 0;
 }
@@ -262,9 +410,16 @@ static int send_response(struct net_context *ctx,
 			 struct net_if *iface,
 			 sa_family_t family,
 			 const void *src_addr,
-			 struct net_buf *query,
-			 enum dns_rr_type qtype)
+			 const struct dns_msg_t *dns_msg,
+			 struct net_buf *buf,
+			 bool answer_a, bool answer_aaaa)
 {
+	struct mdns_answer answer = {
+		.ttl = MDNS_TTL,
+		.name = { net_hostname_get(), "local" },
+		.name_count = 2,
+	};
+	uint16_t answers = 0;
 	struct sockaddr dst;
 	socklen_t dst_len;
 	int ret;
@@ -275,7 +430,10 @@ static int send_response(struct net_context *ctx,
 		return ret;
 	}
 
-	if (IS_ENABLED(CONFIG_NET_IPV4) && qtype == DNS_RR_TYPE_A) {
+	net_buf_reset(buf);
+	net_buf_add(buf, DNS_MSG_HEADER_SIZE);
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && answer_a) {
 		const struct in_addr *addr;
 
 		if (family == AF_INET) {
@@ -287,11 +445,21 @@ static int send_response(struct net_context *ctx,
 			addr = net_if_ipv4_select_src_addr(iface, &tmp_addr.sin_addr);
 		}
 
-		ret = create_answer(ctx, query, qtype, sizeof(struct in_addr), (uint8_t *)addr);
-		if (ret != 0) {
-			return ret;
+		answer.type = DNS_RR_TYPE_A;
+		answer.addr = addr;
+		answer.addr_len = sizeof(struct in_addr);
+
+		if (addr != NULL && !is_known_answer(dns_msg, &answer)) {
+			ret = add_answer(buf, &answer);
+			if (ret < 0) {
+				return ret;
+			}
+
+			answers++;
 		}
-	} else if (IS_ENABLED(CONFIG_NET_IPV6) && qtype == DNS_RR_TYPE_AAAA) {
+	}
+
+	if (IS_ENABLED(CONFIG_NET_IPV6) && answer_aaaa) {
 		const struct in6_addr *addr;
 
 		if (family == AF_INET6) {
@@ -303,16 +471,27 @@ static int send_response(struct net_context *ctx,
 			addr = net_if_ipv6_select_src_addr(iface, &tmp_addr.sin6_addr);
 		}
 
-		ret = create_answer(ctx, query, qtype, sizeof(struct in6_addr), (uint8_t *)addr);
-		if (ret != 0) {
-			return -ENOMEM;
+		answer.type = DNS_RR_TYPE_AAAA;
+		answer.addr = addr;
+		answer.addr_len = sizeof(struct in6_addr);
+
+		if (addr != NULL && !is_known_answer(dns_msg, &answer)) {
+			ret = add_answer(buf, &answer);
+			if (ret < 0) {
+				return ret;
+			}
+
+			answers++;
 		}
-	} else {
-		/* TODO: support also service PTRs */
-		return -EINVAL;
 	}
 
-	ret = net_context_sendto(ctx, query->data, query->len, &dst,
+	if (answers == 0) {
+		return 0;
+	}
+
+	setup_dns_hdr(buf->data, answers);
+
+	ret = net_context_sendto(ctx, buf->data, buf->len, &dst,
 				 dst_len, NULL, K_NO_WAIT, NULL);
 	if (ret < 0) {
 		NET_DBG("Cannot send mDNS reply (%d)", ret);
@@ -334,85 +513,391 @@ static const char *qtype_to_string(int qtype)
 	}
 }
 
-static void send_sd_response(struct net_context *ctx,
-			     struct net_if *iface,
-			     sa_family_t family,
-			     const void *src_addr,
-			     struct dns_msg_t *dns_msg,
-			     struct net_buf *result)
+#if defined(CONFIG_MDNS_RESPONDER_DNS_SD)
+/*
+ * The records registered at build time are sorted by the hash of their
+ * service type, so that a PTR query only looks at the records of the
+ * queried type.
+ */
+struct sd_index_entry {
+	uint32_t hash;
+	const struct dns_sd_rec *record;
+};
+
+static struct sd_index_entry sd_index[CONFIG_MDNS_RESPONDER_DNS_SD_INDEX_SIZE];
+static size_t sd_index_count;
+static bool sd_index_complete;
+
+typedef int (*sd_handler_t)(const struct dns_sd_rec *const *inst, size_t count,
+			    const struct in_addr *addr4, const struct in6_addr *addr6,
+			    uint8_t *buf, uint16_t buf_size);
+
+/* FNV-1a hash of the service type in lower case, e.g. "_http._tcp.local" */
+static uint32_t service_type_hash(const struct dns_sd_rec *rec)
+{
+	const char *labels[] = { rec->service, rec->proto, rec->domain };
+	uint32_t hash = 2166136261U;
+
+	ARRAY_FOR_EACH(labels, i) {
+		for (const char *c = labels[i]; *c != '\0'; c++) {
+			hash = (hash ^ (uint8_t)tolower((unsigned char)*c)) * 16777619U;
+		}
+
+		hash = (hash ^ '.') * 16777619U;
+	}
+
+	return hash;
+}
+
+static void sd_index_init(void)
+{
+	struct dns_sd_rec filter;
+	uint32_t hash;
+	size_t i;
+
+	dns_sd_create_wildcard_filter(&filter);
+
+	sd_index_count = 0;
+	sd_index_complete = true;
+
+	DNS_SD_FOREACH(record) {
+		/* Invalid records never match a query */
+		if (!dns_sd_rec_match(record, &filter)) {
+			continue;
+		}
+
+		if (sd_index_count == ARRAY_SIZE(sd_index)) {
+			NET_DBG("Too many DNS-SD records to index");
+			sd_index_complete = false;
+			break;
+		}
+
+		hash = service_type_hash(record);
+
+		/* Records of the same type stay in their registration order */
+		for (i = 0; i < sd_index_count && sd_index[i].hash <= hash; i++) {
+		}
+
+		memmove(&sd_index[i + 1], &sd_index[i],
+			(sd_index_count - i) * sizeof(sd_index[0]));
+
+		sd_index[i].hash = hash;
+		sd_index[i].record = record;
+		sd_index_count++;
+	}
+}
+
+/* Must be invoked with the listener lock held */
+static void send_sd_records(struct mdns_listener *listener,
+			    const struct sockaddr *dst, socklen_t dst_len,
+			    struct net_buf *buf, const struct dns_sd_rec **records,
+			    size_t count, const struct in_addr *addr4,
+			    const struct in6_addr *addr6, sd_handler_t handler)
 {
+	size_t i, n;
 	int ret;
-	const struct dns_sd_rec *record;
-	/* filter must be zero-initialized for "wildcard" port */
-	struct dns_sd_rec filter = {0};
-	struct sockaddr dst;
-	socklen_t dst_len;
-	bool service_type_enum = false;
-	const struct in6_addr *addr6 = NULL;
-	const struct in_addr *addr4 = NULL;
-	char instance_buf[DNS_SD_SERVICE_MAX_SIZE + 1];
-	char service_buf[DNS_SD_SERVICE_MAX_SIZE + 1];
-	char proto_buf[DNS_SD_PROTO_SIZE + 1];
-	char domain_buf[DNS_SD_DOMAIN_MAX_SIZE + 1];
-	char *label[4];
-	size_t size[] = {
-		ARRAY_SIZE(instance_buf),
-		ARRAY_SIZE(service_buf),
-		ARRAY_SIZE(proto_buf),
-		ARRAY_SIZE(domain_buf),
-	};
-	size_t n = ARRAY_SIZE(label);
-	size_t rec_num;
-	size_t ext_rec_num = external_records_count;
 
-	BUILD_ASSERT(ARRAY_SIZE(label) == ARRAY_SIZE(size), "");
+	/* Drop the records that cannot be advertised, e.g. not bound yet */
+	for (i = 0, n = 0; i < count; i++) {
+		if (dns_sd_rec_is_advertised(records[i], addr4, addr6)) {
+			records[n++] = records[i];
+		}
+	}
 
-	/*
-	 * work around for bug in compliance scripts which say that the array
-	 * should be static const (incorrect)
-	 */
-	label[0] = instance_buf;
-	label[1] = service_buf;
-	label[2] = proto_buf;
-	label[3] = domain_buf;
+	count = n;
 
-	ret = setup_dst_addr(ctx, family, &dst, &dst_len);
+	while (count > 0) {
+		/* Put as many answers as fit into each packet */
+		for (n = count; n > 0; n--) {
+			ret = handler(records, n, addr4, addr6, buf->data, buf->size);
+			if (ret != -ENOSPC && ret != -E2BIG) {
+				break;
+			}
+		}
+
+		if (n == 0) {
+			NET_DBG("DNS-SD answer does not fit into a packet");
+			n = 1;
+		} else if (ret < 0) {
+			NET_DBG("Cannot create DNS-SD answer (%d)", ret);
+		} else {
+			ret = net_context_sendto(listener->ctx, buf->data, ret, dst, dst_len,
+						 NULL, K_NO_WAIT, NULL);
+			if (ret < 0) {
+				NET_DBG("Cannot send mDNS reply (%d)", ret);
+			}
+		}
+
+		records += n;
+		count -= n;
+	}
+}
+
+/* Must be invoked with the listener lock held */
+static void send_sd_answers(struct mdns_listener *listener)
+{
+	const struct in6_addr *addr6 = NULL;
+	const struct in_addr *addr4 = NULL;
+	struct net_buf *buf;
+	struct sockaddr dst;
+	socklen_t dst_len;
+	int ret;
+
+	ret = setup_dst_addr(listener->ctx, listener->family, &dst, &dst_len);
 	if (ret < 0) {
 		NET_DBG("unable to set up the response address");
-		return;
+		goto out;
+	}
+
+	buf = net_buf_alloc(&mdns_msg_pool, BUF_ALLOC_TIMEOUT);
+	if (!buf) {
+		NET_DBG("Cannot allocate DNS-SD response");
+		goto out;
 	}
 
 	if (IS_ENABLED(CONFIG_NET_IPV4)) {
 		/* Look up the local IPv4 address */
-		if (family == AF_INET) {
-			addr4 = net_if_ipv4_select_src_addr(iface, (struct in_addr *)src_addr);
+		if (listener->family == AF_INET) {
+			addr4 = net_if_ipv4_select_src_addr(listener->iface,
+							    &listener->src.in);
 		} else {
 			struct sockaddr_in tmp_addr;
 
 			create_ipv4_addr(&tmp_addr);
-			addr4 = net_if_ipv4_select_src_addr(iface, &tmp_addr.sin_addr);
+			addr4 = net_if_ipv4_select_src_addr(listener->iface,
+							    &tmp_addr.sin_addr);
 		}
 	}
 
 	if (IS_ENABLED(CONFIG_NET_IPV6)) {
 		/* Look up the local IPv6 address */
-		if (family == AF_INET6) {
-			addr6 = net_if_ipv6_select_src_addr(iface, (struct in6_addr *)src_addr);
+		if (listener->family == AF_INET6) {
+			addr6 = net_if_ipv6_select_src_addr(listener->iface,
+							    &listener->src.in6);
 		} else {
 			struct sockaddr_in6 tmp_addr;
 
 			create_ipv6_addr(&tmp_addr);
-			addr6 = net_if_ipv6_select_src_addr(iface, &tmp_addr.sin6_addr);
+			addr6 = net_if_ipv6_select_src_addr(listener->iface,
+							    &tmp_addr.sin6_addr);
 		}
 	}
 
-	ret = dns_sd_query_extract(dns_msg->msg,
-		dns_msg->msg_size, &filter, label, size, &n);
+	send_sd_records(listener, &dst, dst_len, buf, listener->ptr, listener->ptr_count,
+			addr4, addr6, dns_sd_handle_ptr_queries);
+	send_sd_records(listener, &dst, dst_len, buf, listener->types, listener->types_count,
+			addr4, addr6, dns_sd_handle_service_type_enums);
+
+	net_buf_unref(buf);
+
+out:
+	listener->ptr_count = 0;
+	listener->types_count = 0;
+}
+
+static void sd_answers_timeout(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct mdns_listener *listener = CONTAINER_OF(dwork, struct mdns_listener, work);
+
+	k_mutex_lock(&listener->lock, K_FOREVER);
+	send_sd_answers(listener);
+	k_mutex_unlock(&listener->lock);
+}
+
+static bool same_service_type(const struct dns_sd_rec *a, const struct dns_sd_rec *b)
+{
+	return strcasecmp(a->service, b->service) == 0 &&
+	       strcasecmp(a->proto, b->proto) == 0;
+}
+
+/* Must be invoked with the listener lock held */
+static void sd_queue_answer(struct mdns_listener *listener, const void *src_addr,
+			    const struct dns_sd_rec *record, bool service_type)
+{
+	const struct dns_sd_rec **answers = service_type ? listener->types : listener->ptr;
+	uint8_t *count = service_type ? &listener->types_count : &listener->ptr_count;
+	size_t i;
+
+	for (i = 0; i < *count; i++) {
+		if (answers[i] == record ||
+		    (service_type && same_service_type(answers[i], record))) {
+			return;
+		}
+	}
+
+	if (*count == CONFIG_MDNS_RESPONDER_DNS_SD_MAX_ANSWERS) {
+		/* No room to wait for more answers */
+		send_sd_answers(listener);
+	}
+
+	if (listener->ptr_count == 0 && listener->types_count == 0) {
+		if (listener->family == AF_INET) {
+			net_ipv4_addr_copy_raw((uint8_t *)&listener->src.in, src_addr);
+		} else {
+			net_ipv6_addr_copy_raw((uint8_t *)&listener->src.in6, src_addr);
+		}
+	}
+
+	answers[(*count)++] = record;
+}
+
+/* Must be invoked with the listener lock held */
+static void sd_queue_record(struct mdns_listener *listener, const void *src_addr,
+			    const struct dns_msg_t *dns_msg, const struct dns_sd_rec *record,
+			    const struct dns_sd_rec *filter, bool service_type)
+{
+	struct mdns_answer answer = {
+		.type = DNS_RR_TYPE_PTR,
+		.ttl = DNS_SD_PTR_TTL,
+	};
+
+	/* Checks validity and then compare */
+	if (!dns_sd_rec_match(record, filter)) {
+		return;
+	}
+
+	NET_DBG("matched query: %s.%s.%s.%s port: %u",
+		record->instance, record->service,
+		record->proto, record->domain,
+		ntohs(*(record->port)));
+
+	if (service_type) {
+		answer.name[0] = "_services";
+		answer.name[1] = "_dns-sd";
+		answer.name[2] = "_udp";
+		answer.name[3] = "local";
+		answer.name_count = 4;
+		answer.target[0] = record->service;
+		answer.target[1] = record->proto;
+		answer.target[2] = "local";
+		answer.target_count = 3;
+	} else {
+		answer.name[0] = record->service;
+		answer.name[1] = record->proto;
+		answer.name[2] = record->domain;
+		answer.name_count = 3;
+		answer.target[0] = record->instance;
+		answer.target[1] = record->service;
+		answer.target[2] = record->proto;
+		answer.target[3] = record->domain;
+		answer.target_count = 4;
+	}
+
+	if (is_known_answer(dns_msg, &answer)) {
+		NET_DBG("Known answer, not sent");
+		return;
+	}
+
+	sd_queue_answer(listener, src_addr, record, service_type);
+}
+
+/* Must be invoked with the listener lock held */
+static void sd_queue_instances(struct mdns_listener *listener, const void *src_addr,
+			       const struct dns_msg_t *dns_msg,
+			       const struct dns_sd_rec *filter)
+{
+	size_t i;
+
+	if (sd_index_complete) {
+		uint32_t hash = service_type_hash(filter);
+		size_t lo = 0;
+		size_t hi = sd_index_count;
+
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+
+			if (sd_index[mid].hash < hash) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+
+		for (i = lo; i < sd_index_count && sd_index[i].hash == hash; i++) {
+			sd_queue_record(listener, src_addr, dns_msg, sd_index[i].record,
+					filter, false);
+		}
+	} else {
+		DNS_SD_FOREACH(record) {
+			sd_queue_record(listener, src_addr, dns_msg, record, filter, false);
+		}
+	}
+
+	/* External records can be changed at any time, so they are not
+	 * indexed. They are iterated backwards as before.
+	 */
+	for (i = external_records_count; i > 0; i--) {
+		sd_queue_record(listener, src_addr, dns_msg, &external_records[i - 1],
+				filter, false);
+	}
+}
+
+/* Must be invoked with the listener lock held */
+static void sd_queue_service_types(struct mdns_listener *listener, const void *src_addr,
+				   const struct dns_msg_t *dns_msg)
+{
+	struct dns_sd_rec filter;
+	size_t i;
+
+	dns_sd_create_wildcard_filter(&filter);
+
+	DNS_SD_FOREACH(record) {
+		sd_queue_record(listener, src_addr, dns_msg, record, &filter, true);
+	}
+
+	for (i = external_records_count; i > 0; i--) {
+		sd_queue_record(listener, src_addr, dns_msg, &external_records[i - 1],
+				&filter, true);
+	}
+}
+
+/* Split a decoded name, e.g. ".My Foo._foo._tcp.local", into @p filter */
+static int sd_query_filter(char *name, struct dns_sd_rec *filter)
+{
+	char *label[DNS_SD_MIN_LABELS];
+	size_t n = 0;
+	char *dot;
+
+	dns_sd_create_wildcard_filter(filter);
+	/* valid record must have non-NULL port */
+	filter->port = &dns_sd_port_zero;
+
+	/* Take the service type from the end, the instance may contain dots */
+	while (n < ARRAY_SIZE(label) && (dot = strrchr(name, '.')) != NULL) {
+		*dot = '\0';
+		label[n++] = dot + 1;
+	}
+
+	if (n < ARRAY_SIZE(label)) {
+		return -EINVAL;
+	}
+
+	filter->domain = label[0];
+	filter->proto = label[1];
+	filter->service = label[2];
+
+	if (name[0] == '.' && name[1] != '\0') {
+		filter->instance = name + 1;
+	}
+
+	return 0;
+}
+
+static void sd_query(struct mdns_listener *listener, const void *src_addr,
+		     const struct dns_msg_t *dns_msg, struct net_buf *result)
+{
+	struct dns_sd_rec filter;
+	int ret;
+
+	ret = sd_query_filter(result->data, &filter);
 	if (ret < 0) {
 		NET_DBG("unable to extract query (%d)", ret);
 		return;
 	}
 
+	k_mutex_lock(&listener->lock, K_FOREVER);
+
 	if (IS_ENABLED(CONFIG_MDNS_RESPONDER_DNS_SD_SERVICE_TYPE_ENUMERATION)
 		&& dns_sd_is_service_type_enumeration(&filter)) {
 
@@ -424,65 +909,128 @@ static void send_sd_response(struct net_context *ctx,
 		 * where the rdata of each PTR record is the two-label <Service> name,
 		 * plus the same domain, e.g., "_http._tcp.<Domain>".
 		 */
-		dns_sd_create_wildcard_filter(&filter);
-		service_type_enum = true;
+		sd_queue_service_types(listener, src_addr, dns_msg);
+	} else {
+		sd_queue_instances(listener, src_addr, dns_msg, &filter);
 	}
 
-	DNS_SD_COUNT(&rec_num);
+	k_mutex_unlock(&listener->lock);
+}
 
-	while (rec_num > 0 || ext_rec_num > 0) {
-		/*
-		 * The loop will always iterate over all entries, it can be done
-		 * backwards for simplicity
-		 */
-		if (rec_num > 0) {
-			DNS_SD_GET(rec_num - 1, &record);
-			rec_num--;
+static void sd_answers_schedule(struct mdns_listener *listener)
+{
+	k_mutex_lock(&listener->lock, K_FOREVER);
+
+	if (listener->ptr_count > 0 || listener->types_count > 0) {
+		if (IS_ENABLED(CONFIG_MDNS_RESPONDER_DNS_SD_AGGREGATE)) {
+			/* Answers to queries received until then are sent along */
+			k_work_schedule(&listener->work,
+					K_MSEC(SD_ANSWER_DELAY_MIN_MS +
+					       sys_rand32_get() % (SD_ANSWER_DELAY_MAX_MS -
+								   SD_ANSWER_DELAY_MIN_MS + 1)));
 		} else {
-			record = &external_records[ext_rec_num - 1];
-			ext_rec_num--;
-		}
-
-		/* Checks validity and then compare */
-		if (dns_sd_rec_match(record, &filter)) {
-			NET_DBG("matched query: %s.%s.%s.%s port: %u",
-				record->instance, record->service,
-				record->proto, record->domain,
-				ntohs(*(record->port)));
-
-			/* Construct the response */
-			if (service_type_enum) {
-				ret = dns_sd_handle_service_type_enum(record, addr4, addr6,
-					result->data, result->size);
-				if (ret < 0) {
-					NET_DBG("dns_sd_handle_service_type_enum() failed (%d)",
-						ret);
-					continue;
-				}
-			} else {
-				ret = dns_sd_handle_ptr_query(record, addr4, addr6,
-					result->data, result->size);
-				if (ret < 0) {
-					NET_DBG("dns_sd_handle_ptr_query() failed (%d)", ret);
-					continue;
-				}
-			}
+			send_sd_answers(listener);
+		}
+	}
 
-			result->len = ret;
+	k_mutex_unlock(&listener->lock);
+}
 
-			/* Send the response */
-			ret = net_context_sendto(ctx, result->data,
-				result->len, &dst, dst_len, NULL,
-				K_NO_WAIT, NULL);
-			if (ret < 0) {
-				NET_DBG("Cannot send mDNS reply (%d)", ret);
-				continue;
-			}
+static void sd_listener_init(struct mdns_listener *listener)
+{
+	k_mutex_init(&listener->lock);
+	k_work_init_delayable(&listener->work, sd_answers_timeout);
+	listener->ptr_count = 0;
+	listener->types_count = 0;
+}
+
+static bool sd_is_ext_record(const struct dns_sd_rec *record)
+{
+	uintptr_t first = (uintptr_t)external_records;
+	uintptr_t last = (uintptr_t)(external_records + external_records_count);
+
+	return (uintptr_t)record >= first && (uintptr_t)record < last;
+}
+
+/* Must be invoked with the listener lock held */
+static void sd_drop_ext_answers(const struct dns_sd_rec **answers, uint8_t *count)
+{
+	uint8_t i, n;
+
+	for (i = 0, n = 0; i < *count; i++) {
+		if (!sd_is_ext_record(answers[i])) {
+			answers[n++] = answers[i];
 		}
 	}
+
+	*count = n;
 }
 
-static int dns_read(struct net_context *ctx,
+static void sd_set_ext_records(const struct dns_sd_rec *records, size_t count)
+{
+	size_t i;
+
+	/* The queued answers may point into the old records, which the
+	 * application is free to release once we return. Hold every listener
+	 * so that no query walks the records while they are replaced.
+	 */
+	for (i = 0; i < ARRAY_SIZE(listeners); i++) {
+		if (listeners[i].ctx != NULL) {
+			k_mutex_lock(&listeners[i].lock, K_FOREVER);
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(listeners); i++) {
+		struct mdns_listener *listener = &listeners[i];
+
+		if (listener->ctx == NULL) {
+			continue;
+		}
+
+		sd_drop_ext_answers(listener->ptr, &listener->ptr_count);
+		sd_drop_ext_answers(listener->types, &listener->types_count);
+
+		if (listener->ptr_count == 0 && listener->types_count == 0) {
+			/* A handler already running finds nothing left to send */
+			(void)k_work_cancel_delayable(&listener->work);
+		}
+	}
+
+	external_records = records;
+	external_records_count = count;
+
+	for (i = ARRAY_SIZE(listeners); i > 0; i--) {
+		if (listeners[i - 1].ctx != NULL) {
+			k_mutex_unlock(&listeners[i - 1].lock);
+		}
+	}
+}
+#else
+static inline void sd_index_init(void)
+{
+}
+
+static inline void sd_query(struct mdns_listener *listener, const void *src_addr,
+			    const struct dns_msg_t *dns_msg, struct net_buf *result)
+{
+}
+
+static inline void sd_answers_schedule(struct mdns_listener *listener)
+{
+}
+
+static inline void sd_listener_init(struct mdns_listener *listener)
+{
+}
+
+static inline void sd_set_ext_records(const struct dns_sd_rec *records, size_t count)
+{
+	external_records = records;
+	external_records_count = count;
+}
+#endif /* CONFIG_MDNS_RESPONDER_DNS_SD */
+
+static int dns_read(struct mdns_listener *listener,
 		    struct net_pkt *pkt,
 		    struct net_buf *dns_data,
 		    struct dns_addrinfo *info)
@@ -493,6 +1041,8 @@ static int dns_read(struct net_context *ctx,
 	struct net_buf *result;
 	struct dns_msg_t dns_msg;
 	const void *src_addr;
+	bool answer_a = false;
+	bool answer_aaaa = false;
 	int data_len;
 	int queries;
 	int ret;
@@ -533,6 +1083,9 @@ static int dns_read(struct net_context *ctx,
 		queries > 1 ? "queries" : "query",
 		net_sprint_addr(net_pkt_family(pkt), src_addr));
 
+	known_answers_init(&dns_msg, queries);
+
+	/* All questions are answered together, see RFC 6762 ch 6 */
 	do {
 		enum dns_rr_type qtype;
 		enum dns_class qclass;
@@ -543,7 +1096,7 @@ static int dns_read(struct net_context *ctx,
 
 		ret = dns_unpack_query(&dns_msg, result, &qtype, &qclass);
 		if (ret < 0) {
-			goto quit;
+			break;
 		}
 
 		/* Handle only .local queries */
@@ -565,17 +1118,26 @@ static int dns_read(struct net_context *ctx,
 		    &(result->data + 1)[hostname_len] == lquery) {
 			NET_DBG("mDNS query to our hostname %s.local",
 				hostname);
-			send_response(ctx, net_pkt_iface(pkt), net_pkt_family(pkt), src_addr,
-				      result, qtype);
+			answer_a |= qtype == DNS_RR_TYPE_A;
+			answer_aaaa |= qtype == DNS_RR_TYPE_AAAA;
 		} else if (IS_ENABLED(CONFIG_MDNS_RESPONDER_DNS_SD)
 			&& qtype == DNS_RR_TYPE_PTR) {
-			send_sd_response(ctx, net_pkt_iface(pkt), net_pkt_family(pkt), src_addr,
-					 &dns_msg, result);
+			sd_query(listener, src_addr, &dns_msg, result);
 		}
 
 	} while (--queries);
 
-	ret = 0;
+	/* Our address records are unique, so they are not delayed */
+	if (answer_a || answer_aaaa) {
+		send_response(listener->ctx, net_pkt_iface(pkt), net_pkt_family(pkt), src_addr,
+			      &dns_msg, result, answer_a, answer_aaaa);
+	}
+
+	sd_answers_schedule(listener);
+
+	if (ret > 0) {
+		ret = 0;
+	}
 
 quit:
 	if (result) {
@@ -592,7 +1154,7 @@ static void recv_cb(struct net_context *net_ctx,
 		    int status,
 		    void *user_data)
 {
-	struct net_context *ctx = user_data;
+	struct mdns_listener *listener = user_data;
 	struct net_buf *dns_data = NULL;
 	struct dns_addrinfo info = { 0 };
 	int ret;
@@ -600,7 +1162,7 @@ static void recv_cb(struct net_context *net_ctx,
 	ARG_UNUSED(net_ctx);
 	ARG_UNUSED(ip_hdr);
 	ARG_UNUSED(proto_hdr);
-	NET_ASSERT(ctx == net_ctx);
+	NET_ASSERT(listener->ctx == net_ctx);
 
 	if (!pkt) {
 		return;
@@ -615,7 +1177,7 @@ static void recv_cb(struct net_context *net_ctx,
 		goto quit;
 	}
 
-	ret = dns_read(ctx, pkt, dns_data, &info);
+	ret = dns_read(listener, pkt, dns_data, &info);
 	if (ret < 0 && ret != -EINVAL) {
 		NET_DBG("mDNS read failed (%d)", ret);
 	}
@@ -671,6 +1233,7 @@ static void setup_ipv4_addr(struct sockaddr_in *local_addr)
 static int init_listener(void)
 {
 	int ret, ok = 0, i;
+	struct mdns_listener *listener;
 	struct net_if *iface;
 	int iface_count;
 
@@ -715,9 +1278,16 @@ static int init_listener(void)
 			goto ipv6_out;
 		}
 
-		ret = net_context_recv(v6, recv_cb, K_NO_WAIT, v6);
+		listener = &listeners[i];
+		listener->ctx = v6;
+		listener->iface = iface;
+		listener->family = AF_INET6;
+		sd_listener_init(listener);
+
+		ret = net_context_recv(v6, recv_cb, K_NO_WAIT, listener);
 		if (ret < 0) {
 			NET_WARN("Cannot receive %s mDNS data (%d)", "IPv6", ret);
+			listener->ctx = NULL;
 			net_context_put(v6);
 		} else {
 			ipv6[i] = v6;
@@ -758,9 +1328,16 @@ ipv6_out:
 			goto ipv4_out;
 		}
 
-		ret = net_context_recv(v4, recv_cb, K_NO_WAIT, v4);
+		listener = &listeners[MAX_IPV6_IFACE_COUNT + i];
+		listener->ctx = v4;
+		listener->iface = iface;
+		listener->family = AF_INET;
+		sd_listener_init(listener);
+
+		ret = net_context_recv(v4, recv_cb, K_NO_WAIT, listener);
 		if (ret < 0) {
 			NET_WARN("Cannot receive %s mDNS data (%d)", "IPv4", ret);
+			listener->ctx = NULL;
 			net_context_put(v4);
 		} else {
 			ipv4[i] = v4;
@@ -782,6 +1359,8 @@ static int mdns_responder_init(void)
 	external_records = NULL;
 	external_records_count = 0;
 
+	sd_index_init();
+
 	net_mgmt_init_event_callback(&mgmt_cb, mdns_iface_event_handler,
 				     NET_EVENT_IF_UP);
 
@@ -796,8 +1375,7 @@ int mdns_responder_set_ext_records(const struct dns_sd_rec *records, size_t coun
 		return -EINVAL;
 	}
 
-	external_records = records;
-	external_records_count = count;
+	sd_set_ext_records(records, count);
 
 	return 0;
 }
@@ -70,6 +70,16 @@ NET_BUF_POOL_DEFINE(dns_qname_pool, DNS_RESOLVER_BUF_CTR, CONFIG_DNS_RESOLVER_MA
 
 #ifdef CONFIG_DNS_RESOLVER_CACHE
 DNS_CACHE_DEFINE(dns_cache, CONFIG_DNS_RESOLVER_CACHE_MAX_ENTRIES);
+
+/* Query of a cached name being refreshed in the background */
+struct dns_cache_refresh {
+	char query[CONFIG_DNS_RESOLVER_MAX_QUERY_LEN];
+	enum dns_query_type type;
+	bool in_use;
+};
+
+/* Each refresh takes a query slot, so there cannot be more of them */
+static struct dns_cache_refresh cache_refreshes[CONFIG_DNS_NUM_CONCUR_QUERIES];
 #endif /* CONFIG_DNS_RESOLVER_CACHE */
 
 static struct dns_resolve_context dns_default_ctx;
@@ -458,6 +468,40 @@ static inline int get_slot_by_id(struct dns_resolve_context *ctx,
 	return -ENOENT;
 }
 
+/* A NOERROR response without answer tells that the name has no record of
+ * the queried type (NODATA), see RFC 2308 ch. 2.2. As the answer section
+ * is empty, the response must match the id and the question of one of our
+ * pending queries.
+ * Must be invoked with context lock held.
+ */
+static bool is_nodata_response(struct dns_resolve_context *ctx,
+			       struct dns_msg_t *dns_msg,
+			       uint16_t dns_id)
+{
+	uint8_t *header = dns_msg->msg;
+	const char *query_name;
+	uint16_t query_hash;
+
+	if (dns_header_qr(header) != DNS_RESPONSE ||
+	    dns_header_rcode(header) != DNS_HEADER_NOERROR ||
+	    dns_header_opcode(header) != DNS_QUERY ||
+	    dns_header_z(header) != 0 ||
+	    dns_unpack_header_id(header) != dns_id ||
+	    dns_unpack_header_qdcount(header) != 1 ||
+	    dns_unpack_header_ancount(header) != 0) {
+		return false;
+	}
+
+	if (dns_unpack_response_query(dns_msg) < 0) {
+		return false;
+	}
+
+	query_name = dns_msg->msg + dns_msg->query_offset;
+	query_hash = crc16_ansi(query_name, strlen(query_name) + 1 + 2);
+
+	return get_slot_by_id(ctx, dns_id, query_hash) >= 0;
+}
+
 /* Unit test needs to be able to call this function */
 #if !defined(CONFIG_NET_TEST)
 static
@@ -508,7 +552,7 @@ int dns_validate_msg(struct dns_resolve_context *ctx,
 	}
 
 	ret = dns_unpack_response_header(dns_msg, *dns_id);
-	if (ret < 0) {
+	if (ret < 0 && !(ret == -EINVAL && is_nodata_response(ctx, dns_msg, *dns_id))) {
 		ret = DNS_EAI_FAIL;
 		goto quit;
 	}
@@ -703,7 +747,26 @@ query_known:
 	}
 
 	if (items == 0) {
-		ret = DNS_EAI_NODATA;
+		switch (dns_header_rcode(dns_msg->msg)) {
+		case DNS_HEADER_NOERROR:
+			ret = DNS_EAI_NODATA;
+			break;
+		case DNS_HEADER_NAMEERROR:
+			ret = DNS_EAI_NONAME;
+			break;
+		default:
+			ret = DNS_EAI_FAIL;
+			goto quit;
+		}
+
+#ifdef CONFIG_DNS_RESOLVER_CACHE
+		if (CONFIG_DNS_RESOLVER_CACHE_NEGATIVE_TTL > 0 &&
+		    dns_unpack_soa_ttl(dns_msg, &ttl) == 0 && ttl > 0) {
+			dns_cache_add_negative(&dns_cache, ctx->queries[*query_idx].query,
+					       ctx->queries[*query_idx].query_type, ret,
+					       MIN(ttl, CONFIG_DNS_RESOLVER_CACHE_NEGATIVE_TTL));
+		}
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
 	} else {
 		ret = DNS_EAI_ALLDONE;
 	}
@@ -1109,6 +1172,79 @@ static void query_timeout(struct k_work *work)
 	k_mutex_unlock(&pending_query->ctx->lock);
 }
 
+static int dns_resolve_name_internal(struct dns_resolve_context *ctx,
+				     const char *query,
+				     enum dns_query_type type,
+				     uint16_t *dns_id,
+				     dns_resolve_cb_t cb,
+				     void *user_data,
+				     int32_t timeout,
+				     bool use_cache);
+
+#ifdef CONFIG_DNS_RESOLVER_CACHE
+static void cache_refresh_cb(enum dns_resolve_status status,
+			     struct dns_addrinfo *info,
+			     void *user_data)
+{
+	struct dns_cache_refresh *refresh = user_data;
+
+	/* The answers are added to the cache by dns_validate_msg() */
+	if (info != NULL) {
+		return;
+	}
+
+	if (status != DNS_EAI_ALLDONE) {
+		NET_DBG("Cannot refresh %s (%d)", refresh->query, status);
+
+		/* The entries are served until they are removed, the next
+		 * lookup tries again.
+		 */
+		dns_cache_refresh_failed(&dns_cache, refresh->query, refresh->type);
+	}
+
+	refresh->in_use = false;
+}
+
+static void cache_refresh_start(struct dns_resolve_context *ctx,
+				const char *query,
+				enum dns_query_type type,
+				int32_t timeout)
+{
+	struct dns_cache_refresh *refresh = NULL;
+	int ret;
+
+	k_mutex_lock(&ctx->lock, K_FOREVER);
+
+	ARRAY_FOR_EACH_PTR(cache_refreshes, entry) {
+		if (!entry->in_use) {
+			entry->in_use = true;
+			refresh = entry;
+			break;
+		}
+	}
+
+	k_mutex_unlock(&ctx->lock);
+
+	if (refresh == NULL) {
+		dns_cache_refresh_failed(&dns_cache, query, type);
+		return;
+	}
+
+	/* The length was checked by the cache lookup */
+	strncpy(refresh->query, query, sizeof(refresh->query) - 1);
+	refresh->query[sizeof(refresh->query) - 1] = '\0';
+	refresh->type = type;
+
+	ret = dns_resolve_name_internal(ctx, refresh->query, type, NULL, cache_refresh_cb,
+					refresh, timeout, false);
+	if (ret < 0) {
+		NET_DBG("Cannot refresh %s (%d)", query, ret);
+		dns_cache_refresh_failed(&dns_cache, query, type);
+		refresh->in_use = false;
+	}
+}
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+
 int dns_resolve_name(struct dns_resolve_context *ctx,
 		     const char *query,
 		     enum dns_query_type type,
@@ -1116,6 +1252,18 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 		     dns_resolve_cb_t cb,
 		     void *user_data,
 		     int32_t timeout)
+{
+	return dns_resolve_name_internal(ctx, query, type, dns_id, cb, user_data, timeout, true);
+}
+
+static int dns_resolve_name_internal(struct dns_resolve_context *ctx,
+				     const char *query,
+				     enum dns_query_type type,
+				     uint16_t *dns_id,
+				     dns_resolve_cb_t cb,
+				     void *user_data,
+				     int32_t timeout,
+				     bool use_cache)
 {
 	k_timeout_t tout;
 	struct net_buf *dns_data = NULL;
@@ -1190,17 +1338,27 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 
 try_resolve:
 #ifdef CONFIG_DNS_RESOLVER_CACHE
-	ret = dns_cache_find(&dns_cache, query, cached_info, sizeof(cached_info));
-	if (ret > 0) {
-		/* The query was cached, no
-		 * need to continue further.
-		 */
-		for (size_t cache_index = 0; cache_index < ret; cache_index++) {
-			cb(DNS_EAI_INPROGRESS, &cached_info[cache_index], user_data);
-		}
-		cb(DNS_EAI_ALLDONE, NULL, user_data);
+	if (use_cache) {
+		bool refresh;
+
+		ret = dns_cache_lookup(&dns_cache, query, type, cached_info,
+				       ARRAY_SIZE(cached_info), &refresh);
+		if (ret > 0 || ret == DNS_EAI_NONAME || ret == DNS_EAI_NODATA) {
+			/* The query was cached, no
+			 * need to continue further.
+			 */
+			for (size_t cache_index = 0; cache_index < MAX(ret, 0); cache_index++) {
+				cb(DNS_EAI_INPROGRESS, &cached_info[cache_index], user_data);
+			}
+			cb(ret > 0 ? DNS_EAI_ALLDONE : ret, NULL, user_data);
 
-		return 0;
+			/* Refresh the entries after answering, the caller does not wait for it */
+			if (refresh) {
+				cache_refresh_start(ctx, query, type, timeout);
+			}
+
+			return 0;
+		}
 	}
 #endif /* CONFIG_DNS_RESOLVER_CACHE */
 
@@ -1501,6 +1659,17 @@ unlock:
 	return err;
 }
 
+int dns_resolve_get_cache_stats(struct dns_resolve_cache_stats *stats)
+{
+#ifdef CONFIG_DNS_RESOLVER_CACHE
+	return dns_cache_get_stats(&dns_cache, stats);
+#else
+	ARG_UNUSED(stats);
+
+	return -ENOTSUP;
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+}
+
 struct dns_resolve_context *dns_resolve_get_default(void)
 {
 	return &dns_default_ctx;
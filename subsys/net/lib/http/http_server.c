@@ -0,0 +1,922 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_http_server, CONFIG_NET_HTTP_SERVER_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/socket_service.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/net/http/status.h>
+#include <zephyr/posix/fcntl.h>
+#include <zephyr/posix/sys/eventfd.h>
+#include <zephyr/sys/util.h>
+
+/* Shortened defines */
+#define MAX_SERVICES CONFIG_HTTP_SERVER_NUM_SERVICES
+#define MAX_CLIENTS  CONFIG_HTTP_SERVER_MAX_CLIENTS
+
+/* Layout of the poll array: the control eventfd, one socket per client and
+ * one listening socket per service. Unused entries have fd -1. The clients
+ * come first so that the connections closed by the peers free their slots
+ * before the new ones are accepted.
+ */
+#define CTRL_FD_IDX   0
+#define CLIENT_FD_IDX 1
+#define LISTEN_FD_IDX (CLIENT_FD_IDX + MAX_CLIENTS)
+#define POLL_FD_COUNT (LISTEN_FD_IDX + MAX_SERVICES)
+
+/* The socket service uses one more entry for its own eventfd */
+BUILD_ASSERT(CONFIG_NET_SOCKETS_POLL_MAX >= POLL_FD_COUNT + 1,
+	     "CONFIG_NET_SOCKETS_POLL_MAX too small for the HTTP server");
+
+#define STOP_TIMEOUT K_SECONDS(2)
+
+static const char crlf[] = "\r\n";
+static const char last_chunk[] = "0\r\n\r\n";
+
+static void http_server_cb(struct k_work *work);
+
+NET_SOCKET_SERVICE_SYNC_DEFINE_STATIC(http_svc, NULL, http_server_cb, POLL_FD_COUNT);
+
+static struct {
+	struct zsock_pollfd fds[POLL_FD_COUNT];
+	const struct http_service_desc *services[MAX_SERVICES];
+	struct http_client_ctx clients[MAX_CLIENTS];
+	struct k_sem stopped;
+	atomic_t stop;
+	bool running;
+	bool dirty;
+} server;
+
+static K_MUTEX_DEFINE(lock);
+
+static const char *status_reason(int status)
+{
+	switch (status) {
+	case HTTP_200_OK:
+		return "OK";
+	case HTTP_400_BAD_REQUEST:
+		return "Bad Request";
+	case HTTP_404_NOT_FOUND:
+		return "Not Found";
+	case HTTP_405_METHOD_NOT_ALLOWED:
+		return "Method Not Allowed";
+	case HTTP_414_URI_TOO_LONG:
+		return "URI Too Long";
+	default:
+		return "Internal Server Error";
+	}
+}
+
+static inline struct zsock_pollfd *client_pollfd(struct http_client_ctx *client)
+{
+	return &server.fds[CLIENT_FD_IDX + (client - server.clients)];
+}
+
+static void client_set_events(struct http_client_ctx *client, short events)
+{
+	if (client->events == events) {
+		return;
+	}
+
+	client->events = events;
+	client_pollfd(client)->events = events;
+	server.dirty = true;
+}
+
+static void client_timer_restart(struct http_client_ctx *client)
+{
+	if (CONFIG_HTTP_SERVER_CLIENT_INACTIVITY_TIMEOUT > 0) {
+		k_work_reschedule(&client->inactivity_timer,
+				  K_SECONDS(CONFIG_HTTP_SERVER_CLIENT_INACTIVITY_TIMEOUT));
+	}
+}
+
+static void client_timeout(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct http_client_ctx *client =
+		CONTAINER_OF(dwork, struct http_client_ctx, inactivity_timer);
+
+	/* The connection is closed from the service thread */
+	atomic_set(&client->expired, 1);
+	eventfd_write(server.fds[CTRL_FD_IDX].fd, 1);
+}
+
+static void client_close(struct http_client_ctx *client)
+{
+	struct k_work_sync sync;
+
+	NET_DBG("Closing client %d", client->fd);
+
+	(void)k_work_cancel_delayable_sync(&client->inactivity_timer, &sync);
+
+	zsock_close(client->fd);
+
+	client->fd = -1;
+	client->service = NULL;
+	client_pollfd(client)->fd = -1;
+	server.dirty = true;
+}
+
+static void client_reset_request(struct http_client_ctx *client)
+{
+	client->resource = NULL;
+	client->status = 0;
+	client->url_len = 0;
+	client->url[0] = '\0';
+	client->url_too_long = false;
+	client->request_done = false;
+}
+
+static struct http_client_ctx *client_alloc(const struct http_service_desc *svc, int fd)
+{
+	struct http_client_ctx *free_slot = NULL;
+	size_t count = 0;
+
+	ARRAY_FOR_EACH_PTR(server.clients, client) {
+		if (client->fd < 0) {
+			if (free_slot == NULL) {
+				free_slot = client;
+			}
+		} else if (client->service == svc) {
+			count++;
+		}
+	}
+
+	if (free_slot == NULL || (svc->concurrent > 0 && count >= svc->concurrent)) {
+		return NULL;
+	}
+
+	free_slot->fd = fd;
+	free_slot->service = svc;
+	free_slot->data_len = 0;
+	free_slot->out_idx = 0;
+	free_slot->out_cnt = 0;
+	free_slot->header_len = 0;
+	free_slot->generating = false;
+	free_slot->close_after_send = false;
+	atomic_clear(&free_slot->expired);
+	client_reset_request(free_slot);
+	http_parser_init(&free_slot->parser, HTTP_REQUEST);
+
+	free_slot->events = ZSOCK_POLLIN;
+	client_pollfd(free_slot)->fd = fd;
+	client_pollfd(free_slot)->events = ZSOCK_POLLIN;
+	server.dirty = true;
+
+	client_timer_restart(free_slot);
+
+	return free_slot;
+}
+
+static const struct http_resource_detail *find_resource(const struct http_service_desc *svc,
+							 const char *url)
+{
+	size_t path_len = strcspn(url, "?#");
+
+	HTTP_SERVICE_FOREACH_RESOURCE(svc, res) {
+		if (strncmp(res->resource, url, path_len) == 0 &&
+		    res->resource[path_len] == '\0') {
+			return res->detail;
+		}
+	}
+
+	return svc->detail;
+}
+
+static int on_message_begin(struct http_parser *parser)
+{
+	struct http_client_ctx *client = CONTAINER_OF(parser, struct http_client_ctx, parser);
+
+	client_reset_request(client);
+
+	return 0;
+}
+
+static int on_url(struct http_parser *parser, const char *at, size_t length)
+{
+	struct http_client_ctx *client = CONTAINER_OF(parser, struct http_client_ctx, parser);
+
+	/* The URL can come in several pieces if it is split between reads */
+	if (length > sizeof(client->url) - 1 - client->url_len) {
+		client->url_too_long = true;
+		return 0;
+	}
+
+	memcpy(client->url + client->url_len, at, length);
+	client->url_len += length;
+	client->url[client->url_len] = '\0';
+
+	return 0;
+}
+
+static int on_headers_complete(struct http_parser *parser)
+{
+	struct http_client_ctx *client = CONTAINER_OF(parser, struct http_client_ctx, parser);
+	const struct http_resource_detail *detail;
+
+	client->method = parser->method;
+	client->keep_alive = http_should_keep_alive(parser);
+
+	if (client->url_too_long) {
+		client->status = HTTP_414_URI_TOO_LONG;
+		return 0;
+	}
+
+	detail = find_resource(client->service, client->url);
+	if (detail == NULL) {
+		client->status = HTTP_404_NOT_FOUND;
+		return 0;
+	}
+
+	if (!(detail->bitmask_of_supported_http_methods & BIT(client->method))) {
+		client->status = HTTP_405_METHOD_NOT_ALLOWED;
+		return 0;
+	}
+
+	client->resource = detail;
+
+	return 0;
+}
+
+static int on_body(struct http_parser *parser, const char *at, size_t length)
+{
+	struct http_client_ctx *client = CONTAINER_OF(parser, struct http_client_ctx, parser);
+	const struct http_resource_detail_dynamic *dynamic;
+	int ret;
+
+	/* The body of the requests to static resources is ignored */
+	if (client->resource == NULL || client->status != 0 ||
+	    client->resource->type != HTTP_RESOURCE_TYPE_DYNAMIC) {
+		return 0;
+	}
+
+	dynamic = CONTAINER_OF(client->resource, struct http_resource_detail_dynamic, common);
+
+	ret = dynamic->cb(client, HTTP_SERVER_DATA_MORE, (uint8_t *)at, length,
+			  dynamic->user_data);
+	if (ret < 0) {
+		client->status = HTTP_500_INTERNAL_SERVER_ERROR;
+	}
+
+	return 0;
+}
+
+static int on_message_complete(struct http_parser *parser)
+{
+	struct http_client_ctx *client = CONTAINER_OF(parser, struct http_client_ctx, parser);
+
+	/* Stop at the end of the request, the pipelined requests that follow
+	 * it are parsed once the response has been sent.
+	 */
+	client->request_done = true;
+	http_parser_pause(parser, 1);
+
+	return 0;
+}
+
+static const struct http_parser_settings parser_settings = {
+	.on_message_begin = on_message_begin,
+	.on_url = on_url,
+	.on_headers_complete = on_headers_complete,
+	.on_body = on_body,
+	.on_message_complete = on_message_complete,
+};
+
+static void client_set_output(struct http_client_ctx *client,
+			      const void *header, size_t header_len,
+			      const void *body, size_t body_len,
+			      const void *trailer, size_t trailer_len)
+{
+	const void *bufs[] = { header, body, trailer };
+	size_t lens[] = { header_len, body_len, trailer_len };
+
+	client->out_idx = 0;
+	client->out_cnt = 0;
+
+	for (int i = 0; i < ARRAY_SIZE(bufs); i++) {
+		if (lens[i] == 0) {
+			continue;
+		}
+
+		client->out[client->out_cnt].iov_base = (void *)bufs[i];
+		client->out[client->out_cnt].iov_len = lens[i];
+		client->out_cnt++;
+	}
+}
+
+static int header_append(struct http_client_ctx *client, size_t *pos, const char *fmt, ...)
+{
+	size_t space = sizeof(client->header) - *pos;
+	va_list ap;
+	int ret;
+
+	va_start(ap, fmt);
+	ret = vsnprintk(client->header + *pos, space, fmt, ap);
+	va_end(ap);
+
+	if (ret < 0 || ret >= space) {
+		return -ENOMEM;
+	}
+
+	*pos += ret;
+
+	return 0;
+}
+
+/* Write the status line and the headers of the response to the header
+ * buffer. A negative content_len means that the length is not known.
+ */
+static int build_header(struct http_client_ctx *client, int status,
+			const struct http_resource_detail *detail, ssize_t content_len)
+{
+	size_t pos = 0;
+	int ret;
+
+	ret = header_append(client, &pos, "HTTP/1.1 %d %s\r\n", status, status_reason(status));
+
+	if (ret == 0 && content_len >= 0) {
+		ret = header_append(client, &pos, "Content-Length: %zd\r\n", content_len);
+	} else if (ret == 0 && client->chunked) {
+		ret = header_append(client, &pos, "Transfer-Encoding: chunked\r\n");
+	}
+
+	if (ret == 0 && detail != NULL && detail->content_type != NULL) {
+		ret = header_append(client, &pos, "Content-Type: %s\r\n", detail->content_type);
+	}
+
+	if (ret == 0 && detail != NULL && detail->content_encoding != NULL) {
+		ret = header_append(client, &pos, "Content-Encoding: %s\r\n",
+				    detail->content_encoding);
+	}
+
+	if (ret == 0 && !client->keep_alive) {
+		ret = header_append(client, &pos, "Connection: close\r\n");
+	}
+
+	if (ret == 0) {
+		ret = header_append(client, &pos, "\r\n");
+	}
+
+	return ret < 0 ? ret : pos;
+}
+
+static void respond_error(struct http_client_ctx *client, int status)
+{
+	int len;
+
+	len = build_header(client, status, NULL, 0);
+	if (len < 0) {
+		client->keep_alive = false;
+		client->close_after_send = true;
+		return;
+	}
+
+	client_set_output(client, client->header, len, NULL, 0, NULL, 0);
+}
+
+static void respond_static(struct http_client_ctx *client,
+			   const struct http_resource_detail_static *detail)
+{
+	int len;
+
+	len = build_header(client, HTTP_200_OK, &detail->common, detail->static_data_len);
+	if (len < 0) {
+		respond_error(client, HTTP_500_INTERNAL_SERVER_ERROR);
+		return;
+	}
+
+	/* The content is sent directly from where it is stored */
+	client_set_output(client, client->header, len,
+			  client->method == HTTP_HEAD ? NULL : detail->static_data,
+			  client->method == HTTP_HEAD ? 0 : detail->static_data_len,
+			  NULL, 0);
+}
+
+static void respond_dynamic(struct http_client_ctx *client,
+			    const struct http_resource_detail_dynamic *detail)
+{
+	int len;
+	int ret;
+
+	ret = detail->cb(client, HTTP_SERVER_DATA_FINAL, NULL, 0, detail->user_data);
+	if (ret < 0) {
+		respond_error(client, HTTP_500_INTERNAL_SERVER_ERROR);
+		return;
+	}
+
+	/* HTTP/1.0 has no chunked encoding, the end of the response is then
+	 * marked by closing the connection.
+	 */
+	client->chunked = client->parser.http_major > 1 ||
+			  (client->parser.http_major == 1 && client->parser.http_minor >= 1);
+	if (!client->chunked) {
+		client->keep_alive = false;
+	}
+
+	len = build_header(client, HTTP_200_OK, &detail->common, -1);
+	if (len < 0) {
+		respond_error(client, HTTP_500_INTERNAL_SERVER_ERROR);
+		return;
+	}
+
+	if (client->method == HTTP_HEAD) {
+		client_set_output(client, client->header, len, NULL, 0, NULL, 0);
+		return;
+	}
+
+	/* The headers are sent together with the first chunk */
+	client->header_len = len;
+	client->generating = true;
+}
+
+static void client_respond(struct http_client_ctx *client)
+{
+	/* The parser skips the CR/LF between requests without starting a new
+	 * message, do not answer the same request twice.
+	 */
+	client->request_done = false;
+
+	if (client->status != 0) {
+		respond_error(client, client->status);
+	} else if (client->resource->type == HTTP_RESOURCE_TYPE_STATIC) {
+		respond_static(client, CONTAINER_OF(client->resource,
+						    struct http_resource_detail_static, common));
+	} else {
+		respond_dynamic(client, CONTAINER_OF(client->resource,
+						     struct http_resource_detail_dynamic, common));
+	}
+
+	if (!client->keep_alive) {
+		client->close_after_send = true;
+	}
+}
+
+/* Get the next part of a dynamic response, after the headers if they have
+ * not been sent yet.
+ */
+static int client_generate(struct http_client_ctx *client)
+{
+	const struct http_resource_detail_dynamic *detail =
+		CONTAINER_OF(client->resource, struct http_resource_detail_dynamic, common);
+	size_t header_len = client->header_len;
+	size_t pos = header_len;
+	int ret;
+
+	client->header_len = 0;
+
+	ret = detail->cb(client, HTTP_SERVER_DATA_RESPONSE, client->response,
+			 sizeof(client->response), detail->user_data);
+	if (ret < 0 || ret > sizeof(client->response)) {
+		NET_DBG("Dynamic resource failed (%d)", ret);
+		return ret < 0 ? ret : -EINVAL;
+	}
+
+	if (ret == 0) {
+		client->generating = false;
+
+		if (client->chunked) {
+			client_set_output(client, client->header, header_len,
+					  last_chunk, sizeof(last_chunk) - 1, NULL, 0);
+		}
+
+		return 0;
+	}
+
+	if (!client->chunked) {
+		client_set_output(client, client->header, header_len,
+				  client->response, ret, NULL, 0);
+		return 0;
+	}
+
+	if (header_append(client, &pos, "%x\r\n", ret) < 0) {
+		return -ENOMEM;
+	}
+
+	client_set_output(client, client->header, pos, client->response, ret,
+			  crlf, sizeof(crlf) - 1);
+
+	return 0;
+}
+
+static int client_flush(struct http_client_ctx *client)
+{
+	struct msghdr msg = { 0 };
+	ssize_t sent;
+
+	while (client->out_idx < client->out_cnt) {
+		msg.msg_iov = &client->out[client->out_idx];
+		msg.msg_iovlen = client->out_cnt - client->out_idx;
+
+		sent = zsock_sendmsg(client->fd, &msg, ZSOCK_MSG_DONTWAIT);
+		if (sent < 0) {
+			return -errno;
+		}
+
+		while (sent > 0) {
+			struct iovec *iov = &client->out[client->out_idx];
+
+			if (sent < iov->iov_len) {
+				iov->iov_base = (uint8_t *)iov->iov_base + sent;
+				iov->iov_len -= sent;
+				break;
+			}
+
+			sent -= iov->iov_len;
+			client->out_idx++;
+		}
+	}
+
+	client->out_idx = 0;
+	client->out_cnt = 0;
+
+	return 0;
+}
+
+static int client_parse(struct http_client_ctx *client)
+{
+	enum http_errno err;
+	size_t parsed;
+
+	parsed = http_parser_execute(&client->parser, &parser_settings,
+				     (const char *)client->buffer, client->data_len);
+
+	err = HTTP_PARSER_ERRNO(&client->parser);
+	if (err == HPE_PAUSED) {
+		http_parser_pause(&client->parser, 0);
+	} else if (err != HPE_OK) {
+		NET_DBG("Parse error %s", http_errno_name(err));
+		return -EBADMSG;
+	}
+
+	/* Keep the pipelined requests that were not parsed yet */
+	client->data_len -= parsed;
+	memmove(client->buffer, client->buffer + parsed, client->data_len);
+
+	return 0;
+}
+
+/* Send what is pending and serve the buffered requests one after the other,
+ * until the socket would block or more data is needed.
+ */
+static void client_process(struct http_client_ctx *client)
+{
+	int ret;
+
+	while (true) {
+		ret = client_flush(client);
+		if (ret == -EAGAIN) {
+			client_set_events(client, ZSOCK_POLLOUT);
+			return;
+		}
+
+		if (ret < 0) {
+			NET_DBG("Send failed (%d)", ret);
+			client_close(client);
+			return;
+		}
+
+		if (client->generating) {
+			if (client_generate(client) < 0) {
+				client_close(client);
+				return;
+			}
+
+			continue;
+		}
+
+		if (client->close_after_send) {
+			client_close(client);
+			return;
+		}
+
+		if (client->data_len == 0) {
+			client_set_events(client, ZSOCK_POLLIN);
+			return;
+		}
+
+		if (client_parse(client) < 0) {
+			client->keep_alive = false;
+			client->close_after_send = true;
+			respond_error(client, HTTP_400_BAD_REQUEST);
+			continue;
+		}
+
+		if (client->request_done) {
+			client_respond(client);
+		}
+	}
+}
+
+static void client_recv(struct http_client_ctx *client)
+{
+	ssize_t len;
+
+	if (client->data_len == sizeof(client->buffer)) {
+		client_process(client);
+		return;
+	}
+
+	len = zsock_recv(client->fd, client->buffer + client->data_len,
+			 sizeof(client->buffer) - client->data_len, ZSOCK_MSG_DONTWAIT);
+	if (len < 0 && errno == EAGAIN) {
+		return;
+	}
+
+	if (len <= 0) {
+		NET_DBG("Connection %s (%d)", len == 0 ? "closed" : "failed", -errno);
+		client_close(client);
+		return;
+	}
+
+	client->data_len += len;
+	client_timer_restart(client);
+
+	client_process(client);
+}
+
+static void server_accept(const struct http_service_desc *svc, int listen_fd)
+{
+	struct sockaddr_storage addr;
+	socklen_t addrlen;
+	int fd;
+
+	while (true) {
+		addrlen = sizeof(addr);
+
+		fd = zsock_accept(listen_fd, (struct sockaddr *)&addr, &addrlen);
+		if (fd < 0) {
+			if (errno != EAGAIN) {
+				NET_ERR("accept failed (%d)", -errno);
+			}
+
+			return;
+		}
+
+		if (client_alloc(svc, fd) == NULL) {
+			NET_DBG("No room for a new client of %s", svc->host);
+			zsock_close(fd);
+		}
+	}
+}
+
+static void server_close_all(void)
+{
+	ARRAY_FOR_EACH_PTR(server.clients, client) {
+		if (client->fd >= 0) {
+			client_close(client);
+		}
+	}
+
+	for (int i = LISTEN_FD_IDX; i < POLL_FD_COUNT; i++) {
+		if (server.fds[i].fd >= 0) {
+			zsock_close(server.fds[i].fd);
+			server.fds[i].fd = -1;
+		}
+	}
+
+	if (server.fds[CTRL_FD_IDX].fd >= 0) {
+		zsock_close(server.fds[CTRL_FD_IDX].fd);
+		server.fds[CTRL_FD_IDX].fd = -1;
+	}
+}
+
+static void server_control(void)
+{
+	eventfd_t value;
+
+	(void)eventfd_read(server.fds[CTRL_FD_IDX].fd, &value);
+
+	if (atomic_get(&server.stop)) {
+		(void)net_socket_service_unregister(&http_svc);
+		server_close_all();
+		server.dirty = false;
+		k_sem_give(&server.stopped);
+		return;
+	}
+
+	ARRAY_FOR_EACH_PTR(server.clients, client) {
+		if (client->fd >= 0 && atomic_cas(&client->expired, 1, 0)) {
+			NET_DBG("Client %d inactive", client->fd);
+			client_close(client);
+		}
+	}
+}
+
+static void http_server_cb(struct k_work *work)
+{
+	struct net_socket_service_event *pev =
+		CONTAINER_OF(work, struct net_socket_service_event, work);
+	int fd = pev->event.fd;
+	short revents = pev->event.revents;
+
+	if (fd == server.fds[CTRL_FD_IDX].fd) {
+		server_control();
+		goto out;
+	}
+
+	for (int i = 0; i < MAX_SERVICES; i++) {
+		if (fd == server.fds[LISTEN_FD_IDX + i].fd) {
+			server_accept(server.services[i], fd);
+			goto out;
+		}
+	}
+
+	ARRAY_FOR_EACH_PTR(server.clients, client) {
+		if (client->fd != fd) {
+			continue;
+		}
+
+		if (revents & (ZSOCK_POLLERR | ZSOCK_POLLNVAL)) {
+			client_close(client);
+		} else if (revents & ZSOCK_POLLOUT) {
+			client_timer_restart(client);
+			client_process(client);
+		} else if (revents & (ZSOCK_POLLIN | ZSOCK_POLLHUP)) {
+			client_recv(client);
+		}
+
+		break;
+	}
+
+out:
+	if (server.dirty) {
+		server.dirty = false;
+		(void)net_socket_service_register(&http_svc, server.fds,
+						  ARRAY_SIZE(server.fds), NULL);
+	}
+}
+
+static int server_listen(const struct http_service_desc *svc)
+{
+	struct sockaddr_in6 addr_storage = { 0 };
+	struct sockaddr *addr = (struct sockaddr *)&addr_storage;
+	socklen_t addrlen;
+	int optval = 1;
+	int ret;
+	int fd;
+
+	/* A service with a host name listens on all the addresses */
+	if (IS_ENABLED(CONFIG_NET_IPV6) && svc->host != NULL &&
+	    zsock_inet_pton(AF_INET6, svc->host, &net_sin6(addr)->sin6_addr) == 1) {
+		addr->sa_family = AF_INET6;
+	} else if (IS_ENABLED(CONFIG_NET_IPV4) && svc->host != NULL &&
+		   zsock_inet_pton(AF_INET, svc->host, &net_sin(addr)->sin_addr) == 1) {
+		addr->sa_family = AF_INET;
+	} else {
+		addr->sa_family = IS_ENABLED(CONFIG_NET_IPV6) ? AF_INET6 : AF_INET;
+	}
+
+	if (addr->sa_family == AF_INET6) {
+		net_sin6(addr)->sin6_port = htons(*svc->port);
+		addrlen = sizeof(struct sockaddr_in6);
+	} else {
+		net_sin(addr)->sin_port = htons(*svc->port);
+		addrlen = sizeof(struct sockaddr_in);
+	}
+
+	fd = zsock_socket(addr->sa_family, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0) {
+		NET_ERR("socket failed (%d)", -errno);
+		return -errno;
+	}
+
+	(void)zsock_setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+
+	if (zsock_bind(fd, addr, addrlen) < 0 ||
+	    zsock_listen(fd, MAX(svc->backlog, 1)) < 0 ||
+	    zsock_fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+		ret = -errno;
+		NET_ERR("Cannot listen for %s (%d)", svc->host, ret);
+		zsock_close(fd);
+		return ret;
+	}
+
+	if (*svc->port == 0) {
+		addrlen = sizeof(addr_storage);
+
+		if (zsock_getsockname(fd, addr, &addrlen) < 0) {
+			ret = -errno;
+			zsock_close(fd);
+			return ret;
+		}
+
+		*svc->port = ntohs(addr->sa_family == AF_INET6 ?
+				   net_sin6(addr)->sin6_port : net_sin(addr)->sin_port);
+	}
+
+	NET_DBG("Listening for %s on port %d", svc->host, *svc->port);
+
+	return fd;
+}
+
+int http_server_start(void)
+{
+	int count;
+	int ret;
+	int i;
+
+	HTTP_SERVICE_COUNT(&count);
+	if (count > MAX_SERVICES) {
+		NET_ERR("%d services defined, increase %s", count,
+			"CONFIG_HTTP_SERVER_NUM_SERVICES");
+		return -ENOMEM;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	if (server.running) {
+		ret = -EALREADY;
+		goto out;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(server.fds); i++) {
+		server.fds[i].fd = -1;
+		server.fds[i].events = ZSOCK_POLLIN;
+	}
+
+	ARRAY_FOR_EACH_PTR(server.clients, client) {
+		client->fd = -1;
+		k_work_init_delayable(&client->inactivity_timer, client_timeout);
+	}
+
+	k_sem_init(&server.stopped, 0, 1);
+	atomic_clear(&server.stop);
+
+	server.fds[CTRL_FD_IDX].fd = eventfd(0, 0);
+	if (server.fds[CTRL_FD_IDX].fd < 0) {
+		ret = -errno;
+		NET_ERR("eventfd failed (%d)", ret);
+		goto out;
+	}
+
+	i = 0;
+
+	HTTP_SERVICE_FOREACH(svc) {
+		ret = server_listen(svc);
+		if (ret < 0) {
+			goto fail;
+		}
+
+		server.services[i] = svc;
+		server.fds[LISTEN_FD_IDX + i].fd = ret;
+		i++;
+	}
+
+	ret = net_socket_service_register(&http_svc, server.fds, ARRAY_SIZE(server.fds), NULL);
+	if (ret < 0) {
+		NET_ERR("Cannot register socket service (%d)", ret);
+		goto fail;
+	}
+
+	server.running = true;
+	goto out;
+
+fail:
+	server_close_all();
+out:
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
+
+int http_server_stop(void)
+{
+	int ret = 0;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	if (!server.running) {
+		ret = -EALREADY;
+		goto out;
+	}
+
+	/* The sockets are closed by the service thread, so that they are not
+	 * closed while it polls them.
+	 */
+	atomic_set(&server.stop, 1);
+	eventfd_write(server.fds[CTRL_FD_IDX].fd, 1);
+
+	if (k_sem_take(&server.stopped, STOP_TIMEOUT) < 0) {
+		NET_ERR("Server did not stop");
+		ret = -ETIMEDOUT;
+		goto out;
+	}
+
+	server.running = false;
+
+out:
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
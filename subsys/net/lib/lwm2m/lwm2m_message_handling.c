@@ -33,6 +33,7 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 #include <zephyr/net/socket.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/types.h>
+#include <zephyr/sys/crc.h>
 #include <zephyr/sys/hash_function.h>
 
 #if defined(CONFIG_LWM2M_DTLS_SUPPORT)
@@ -277,21 +278,185 @@ static inline void release_body_encode_buffer(uint8_t **buffer)
 	}
 }
 
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+void engine_put_window_update(struct lwm2m_output_context *out)
+{
+	struct lwm2m_output_window *win = out->window;
+	uint32_t win_end = win->start + win->len;
+	uint16_t kept = CLAMP(win->total, win->start, win_end) - win->start;
+	uint8_t *data = out->out_cpkt->data + win->payload_offset + kept;
+	uint16_t len = out->out_cpkt->offset - win->payload_offset - kept;
+	uint32_t from = MAX(win->total, win->start);
+	uint32_t to = MIN(win->total + len, win_end);
+
+	win->crc = crc32_ieee_update(win->crc, data, len);
+
+	/* Move the new bytes falling into the window right after the kept ones */
+	if (to > from) {
+		memmove(data, data + (from - win->total), to - from);
+		kept += to - from;
+	}
+
+	win->total += len;
+	out->out_cpkt->offset = win->payload_offset + kept;
+}
+
+/* Run the operation of the body source again, keeping in cpkt the payload
+ * of the block starting at the given payload offset.
+ */
+static int body_source_pass(struct lwm2m_message *msg, struct coap_packet *cpkt, uint32_t start)
+{
+	struct lwm2m_body_source *src = &msg->body_source;
+	struct lwm2m_obj_path_list path_list_buf[CONFIG_LWM2M_COMPOSITE_PATH_LIST_SIZE];
+	struct coap_packet *out_cpkt = msg->out.out_cpkt;
+	sys_slist_t path_list;
+	int ret;
+
+	sys_slist_init(&path_list);
+	for (int i = 0; i < src->path_count; i++) {
+		path_list_buf[i].path = src->paths[i];
+		sys_slist_append(&path_list, &path_list_buf[i].node);
+	}
+
+	/* Drop the options and the payload of the previous pass */
+	cpkt->offset = src->offset;
+	cpkt->opt_len = src->opt_len;
+	cpkt->delta = src->delta;
+	msg->path = src->path;
+
+	src->window.start = start;
+	src->window.len = coap_block_size_to_bytes(lwm2m_default_block_size());
+	msg->out.out_cpkt = cpkt;
+	msg->out.window = &src->window;
+
+	ret = src->op(msg, src->format, &path_list);
+
+	msg->out.window = NULL;
+	msg->out.out_cpkt = out_cpkt;
+
+	return ret;
+}
+
+static int body_source_init(struct lwm2m_message *msg, uint16_t content_format,
+			    sys_slist_t *path_list, struct lwm2m_obj_path *path,
+			    int (*op)(struct lwm2m_message *msg, uint16_t content_format,
+				      sys_slist_t *path_list))
+{
+	struct lwm2m_body_source *src = &msg->body_source;
+	struct lwm2m_obj_path_list *entry;
+	uint16_t records;
+	int ret;
+
+	switch (content_format) {
+	case LWM2M_FORMAT_OMA_JSON:
+	case LWM2M_FORMAT_OMA_OLD_JSON:
+	case LWM2M_FORMAT_APP_SEML_JSON:
+	case LWM2M_FORMAT_APP_SENML_CBOR:
+		break;
+	default:
+		/* Other formats write back into the payload or hold a single value */
+		return -ENOMEM;
+	}
+
+#if defined(CONFIG_LWM2M_RESOURCE_DATA_CACHE_SUPPORT)
+	/* Cached time series are consumed when read, they cannot be read again */
+	if (msg->cache_info && msg->cache_info->entry_size) {
+		return -ENOMEM;
+	}
+#endif
+
+	src->op = op;
+	src->format = content_format;
+	src->path = *path;
+	src->path_count = 0;
+	src->window.records = 0;
+
+	if (path_list) {
+		SYS_SLIST_FOR_EACH_CONTAINER(path_list, entry, node) {
+			if (src->path_count == ARRAY_SIZE(src->paths)) {
+				src->op = NULL;
+				return -ENOMEM;
+			}
+
+			src->paths[src->path_count++] = entry->path;
+		}
+	}
+
+	/* Formats announcing the number of records before the records take it
+	 * from the previous pass, run another one when the first pass found it.
+	 */
+	for (int i = 0; i < 2; i++) {
+		records = src->window.records;
+
+		ret = body_source_pass(msg, msg->out.out_cpkt, 0);
+		if (ret < 0 || records == src->window.records) {
+			break;
+		}
+
+		ret = -EAGAIN;
+	}
+
+	if (ret < 0) {
+		src->op = NULL;
+		return ret;
+	}
+
+	src->len = src->window.total;
+	src->crc = src->window.crc;
+
+	LOG_DBG("Payload of %u bytes produced block by block", src->len);
+
+	return 0;
+}
+
+/* Produce the payload of the block again into the encode buffer */
+static int build_body_block(struct lwm2m_message *msg, uint32_t start)
+{
+	struct lwm2m_body_source *src = &msg->body_source;
+	uint16_t records = src->window.records;
+	int ret;
+
+	lwm2m_registry_lock();
+	ret = body_source_pass(msg, &msg->body_encode_buffer, start);
+	lwm2m_registry_unlock();
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (src->window.total != src->len || src->window.crc != src->crc ||
+	    src->window.records != records) {
+		LOG_WRN("Payload changed during block-wise transfer");
+		return -EAGAIN;
+	}
+
+	return 0;
+}
+#endif
+
 STATIC int build_msg_block_for_send(struct lwm2m_message *msg, uint16_t block_num)
 {
 	int ret;
 	uint16_t payload_size;
 	const uint16_t block_size_bytes = coap_block_size_to_bytes(lwm2m_default_block_size());
-	uint16_t complete_payload_len;
+	uint32_t block_offset = block_num * block_size_bytes;
+	uint16_t payload_len;
 	const uint8_t *complete_payload =
-		coap_packet_get_payload(&msg->body_encode_buffer, &complete_payload_len);
+		coap_packet_get_payload(&msg->body_encode_buffer, &payload_len);
+	uint32_t complete_payload_len = payload_len;
 	uint8_t token[COAP_TOKEN_MAX_LEN];
 	uint8_t tkl;
 
 	NET_ASSERT(msg->msg_data == msg->cpkt.data,
 		   "big data buffer should not be in use for writing message");
 
-	if (block_num * block_size_bytes >= complete_payload_len) {
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	if (msg->body_source.op) {
+		complete_payload_len = msg->body_source.len;
+	}
+#endif
+
+	if (block_offset >= complete_payload_len) {
 		return -EINVAL;
 	}
 
@@ -333,6 +498,21 @@ STATIC int build_msg_block_for_send(struct lwm2m_message *msg, uint16_t block_nu
 		}
 	}
 
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	if (msg->body_source.op) {
+		/* The encode buffer only holds the payload of one block */
+		if (msg->body_source.window.start != block_offset) {
+			ret = build_body_block(msg, block_offset);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+
+		complete_payload = coap_packet_get_payload(&msg->body_encode_buffer, &payload_len);
+		block_offset = 0;
+	}
+#endif
+
 	/* copy the options */
 	ret = buf_append(CPKT_BUF_WRITE(&msg->cpkt),
 			 msg->body_encode_buffer.data + msg->body_encode_buffer.hdr_len,
@@ -344,6 +524,18 @@ STATIC int build_msg_block_for_send(struct lwm2m_message *msg, uint16_t block_nu
 
 	msg->cpkt.delta = msg->body_encode_buffer.delta;
 
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	if (msg->body_source.op) {
+		/* The complete payload is never in memory, use its CRC as ETag */
+		ret = coap_packet_append_option(&msg->cpkt, COAP_OPTION_ETAG,
+						(const uint8_t *)&msg->body_source.crc,
+						sizeof(msg->body_source.crc));
+		if (ret < 0) {
+			return ret;
+		}
+	}
+#endif
+
 	if (block_num == 0) {
 		ret = request_output_block_ctx(&msg->out.block_ctx);
 		if (ret < 0) {
@@ -375,8 +567,7 @@ STATIC int build_msg_block_for_send(struct lwm2m_message *msg, uint16_t block_nu
 	}
 
 	payload_size = MIN(complete_payload_len - block_num * block_size_bytes, block_size_bytes);
-	ret = buf_append(CPKT_BUF_WRITE(&msg->cpkt),
-			 complete_payload + (block_num * block_size_bytes), payload_size);
+	ret = buf_append(CPKT_BUF_WRITE(&msg->cpkt), complete_payload + block_offset, payload_size);
 	if (ret < 0) {
 		return ret;
 	}
@@ -399,6 +590,14 @@ STATIC int prepare_msg_for_send(struct lwm2m_message *msg)
 	msg->cpkt.max_len = MAX_PACKET_SIZE;
 
 	payload = coap_packet_get_payload(&msg->body_encode_buffer, &len);
+
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	if (msg->body_source.op) {
+		/* The payload of the first block was produced with the body */
+		return build_msg_block_for_send(msg, 0);
+	}
+#endif
+
 	if (len <= CONFIG_LWM2M_COAP_MAX_MSG_SIZE) {
 
 		/* copy the packet */
@@ -1647,6 +1846,41 @@ static int do_composite_read_op(struct lwm2m_message *msg, uint16_t content_form
 	}
 }
 
+/* Run an operation producing a message body. When the body does not fit into
+ * the encode buffer, it can be produced again for each block instead.
+ */
+static int do_body_op(struct lwm2m_message *msg, uint16_t content_format,
+		      sys_slist_t *path_list,
+		      int (*op)(struct lwm2m_message *msg, uint16_t content_format,
+				sys_slist_t *path_list))
+{
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	struct coap_packet *cpkt = msg->out.out_cpkt;
+	struct lwm2m_obj_path path = msg->path;
+	int ret;
+
+	msg->body_source.offset = cpkt->offset;
+	msg->body_source.opt_len = cpkt->opt_len;
+	msg->body_source.delta = cpkt->delta;
+
+	ret = op(msg, content_format, path_list);
+	if (ret != -ENOMEM || cpkt->data != msg->body_encode_buffer.data) {
+		return ret;
+	}
+
+	return body_source_init(msg, content_format, path_list, &path, op);
+#else
+	return op(msg, content_format, path_list);
+#endif
+}
+
+static int read_body(struct lwm2m_message *msg, uint16_t content_format, sys_slist_t *path_list)
+{
+	ARG_UNUSED(path_list);
+
+	return do_read_op(msg, content_format);
+}
+
 static int lwm2m_perform_read_object_instance(struct lwm2m_message *msg,
 					      struct lwm2m_engine_obj_inst *obj_inst,
 					      uint8_t *num_read)
@@ -2484,7 +2718,7 @@ static int handle_request(struct coap_packet *request, struct lwm2m_message *msg
 					goto error;
 				}
 
-				r = do_read_op(msg, accept);
+				r = do_body_op(msg, accept, NULL, read_body);
 			} else {
 				/* Composite Observation request & cancel handler */
 				r = lwm2m_engine_observation_handler(msg, observe, accept,
@@ -2495,7 +2729,7 @@ static int handle_request(struct coap_packet *request, struct lwm2m_message *msg
 			}
 		} else {
 			if ((code & COAP_REQUEST_MASK) == COAP_METHOD_GET) {
-				r = do_read_op(msg, accept);
+				r = do_body_op(msg, accept, NULL, read_body);
 			} else {
 				r = do_composite_read_op(msg, accept);
 			}
@@ -3176,7 +3410,10 @@ int lwm2m_perform_composite_read_op(struct lwm2m_message *msg, uint16_t content_
 	}
 
 	/* Add object start mark */
-	engine_put_begin(&msg->out, &msg->path);
+	ret = engine_put_begin(&msg->out, &msg->path);
+	if (ret < 0) {
+		return ret;
+	}
 
 	/* Read resource from path */
 	SYS_SLIST_FOR_EACH_CONTAINER(lwm2m_path_list, entry, node) {
@@ -3340,19 +3577,9 @@ cleanup:
 	return ret;
 }
 
-int do_composite_read_op_for_parsed_list(struct lwm2m_message *msg, uint16_t content_format,
-					 sys_slist_t *path_list)
+static int composite_read_body(struct lwm2m_message *msg, uint16_t content_format,
+			       sys_slist_t *path_list)
 {
-	struct lwm2m_obj_path_list *entry;
-
-	/* Check access rights */
-	SYS_SLIST_FOR_EACH_CONTAINER(path_list, entry, node) {
-		if (entry->path.level > LWM2M_PATH_LEVEL_NONE &&
-		    entry->path.obj_id == LWM2M_OBJECT_SECURITY_ID && !msg->ctx->bootstrap_mode) {
-			return -EACCES;
-		}
-	}
-
 	switch (content_format) {
 
 #if defined(CONFIG_LWM2M_RW_SENML_JSON_SUPPORT)
@@ -3371,6 +3598,22 @@ int do_composite_read_op_for_parsed_list(struct lwm2m_message *msg, uint16_t con
 	}
 }
 
+int do_composite_read_op_for_parsed_list(struct lwm2m_message *msg, uint16_t content_format,
+					 sys_slist_t *path_list)
+{
+	struct lwm2m_obj_path_list *entry;
+
+	/* Check access rights */
+	SYS_SLIST_FOR_EACH_CONTAINER(path_list, entry, node) {
+		if (entry->path.level > LWM2M_PATH_LEVEL_NONE &&
+		    entry->path.obj_id == LWM2M_OBJECT_SECURITY_ID && !msg->ctx->bootstrap_mode) {
+			return -EACCES;
+		}
+	}
+
+	return do_body_op(msg, content_format, path_list, composite_read_body);
+}
+
 #if defined(CONFIG_LWM2M_SERVER_OBJECT_VERSION_1_1)
 static int do_send_reply_cb(const struct coap_packet *response, struct coap_reply *reply,
 			    const struct sockaddr *from)
@@ -3548,7 +3791,7 @@ msg_init:
 	}
 
 	/* Write requested path data */
-	ret = do_send_op(msg, content_format, &lwm2m_path_list);
+	ret = do_body_op(msg, content_format, &lwm2m_path_list, do_send_op);
 	if (ret < 0) {
 		if (lwm2m_timeseries_data_rebuild(msg, ret)) {
 			/* Message Build fail by ENOMEM and data include timeseries data.
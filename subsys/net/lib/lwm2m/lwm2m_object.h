@@ -412,6 +412,11 @@ struct lwm2m_engine_obj_inst {
 	/* instance list */
 	sys_snode_t node;
 
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+	/* path index bucket */
+	sys_snode_t index_node;
+#endif
+
 	struct lwm2m_engine_obj *obj;
 	struct lwm2m_engine_res *resources;
 
@@ -446,6 +451,45 @@ struct lwm2m_block_context {
 	struct lwm2m_obj_path path;
 };
 
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+/* Part of a payload kept in the packet while the payload is produced again
+ * for each block. The bytes outside of the window are only counted.
+ */
+struct lwm2m_output_window {
+	/* Packet offset of the first payload byte */
+	uint16_t payload_offset;
+	/* Payload bytes to keep in the packet */
+	uint32_t start;
+	uint16_t len;
+	/* Payload bytes produced so far and their CRC */
+	uint32_t total;
+	uint32_t crc;
+	/* Number of records, for formats that announce it before the records.
+	 * Read by the writer from the previous pass, updated at the end.
+	 */
+	uint16_t records;
+};
+
+/* What is needed to produce a message body again for one of its blocks */
+struct lwm2m_body_source {
+	/* Operation producing the body, NULL if the body is kept at once */
+	int (*op)(struct lwm2m_message *msg, uint16_t format, sys_slist_t *path_list);
+	uint16_t format;
+	/* Message path and path list given to the operation */
+	struct lwm2m_obj_path path;
+	struct lwm2m_obj_path paths[CONFIG_LWM2M_COMPOSITE_PATH_LIST_SIZE];
+	uint8_t path_count;
+	/* Packet state before the operation appended its options and payload */
+	uint16_t offset;
+	uint16_t opt_len;
+	uint16_t delta;
+	/* Length and CRC of the complete payload */
+	uint32_t len;
+	uint32_t crc;
+	struct lwm2m_output_window window;
+};
+#endif
+
 struct lwm2m_output_context {
 	const struct lwm2m_writer *writer;
 	struct coap_packet *out_cpkt;
@@ -455,6 +499,11 @@ struct lwm2m_output_context {
 	struct coap_block_context *block_ctx;
 #endif
 
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	/* Payload window. NULL if the whole payload is kept. */
+	struct lwm2m_output_window *window;
+#endif
+
 	/* private output data */
 	void *user_data;
 };
@@ -501,6 +550,11 @@ struct lwm2m_message {
 	struct coap_packet body_encode_buffer;
 #endif
 
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	/** Body produced again for each block */
+	struct lwm2m_body_source body_source;
+#endif
+
 	/** Message transmission handling for TYPE_CON */
 	struct coap_pending *pending;
 	struct coap_reply *reply;
@@ -628,11 +682,36 @@ engine_clear_in_user_data(struct lwm2m_input_context *in)
 
 /* inline multi-format write / read functions */
 
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+void engine_put_window_update(struct lwm2m_output_context *out);
+#endif
+
+/* Keep only the part of the writer output that falls into the payload window */
+static inline int engine_put_done(struct lwm2m_output_context *out, int ret)
+{
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	if (ret >= 0 && out->window) {
+		engine_put_window_update(out);
+	}
+#endif
+
+	return ret;
+}
+
 static inline int engine_put_begin(struct lwm2m_output_context *out,
 				   struct lwm2m_obj_path *path)
 {
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	if (out->window) {
+		/* The payload starts here, a new pass begins */
+		out->window->payload_offset = out->out_cpkt->offset;
+		out->window->total = 0;
+		out->window->crc = 0;
+	}
+#endif
+
 	if (out->writer->put_begin) {
-		return out->writer->put_begin(out, path);
+		return engine_put_done(out, out->writer->put_begin(out, path));
 	}
 
 	return 0;
@@ -642,7 +721,7 @@ static inline int engine_put_end(struct lwm2m_output_context *out,
 				 struct lwm2m_obj_path *path)
 {
 	if (out->writer->put_end) {
-		return out->writer->put_end(out, path);
+		return engine_put_done(out, out->writer->put_end(out, path));
 	}
 
 	return 0;
@@ -652,7 +731,7 @@ static inline int engine_put_begin_oi(struct lwm2m_output_context *out,
 				      struct lwm2m_obj_path *path)
 {
 	if (out->writer->put_begin_oi) {
-		return out->writer->put_begin_oi(out, path);
+		return engine_put_done(out, out->writer->put_begin_oi(out, path));
 	}
 
 	return 0;
@@ -662,7 +741,7 @@ static inline int engine_put_end_oi(struct lwm2m_output_context *out,
 				    struct lwm2m_obj_path *path)
 {
 	if (out->writer->put_end_oi) {
-		return out->writer->put_end_oi(out, path);
+		return engine_put_done(out, out->writer->put_end_oi(out, path));
 	}
 
 	return 0;
@@ -672,7 +751,7 @@ static inline int engine_put_begin_r(struct lwm2m_output_context *out,
 				     struct lwm2m_obj_path *path)
 {
 	if (out->writer->put_begin_r) {
-		return out->writer->put_begin_r(out, path);
+		return engine_put_done(out, out->writer->put_begin_r(out, path));
 	}
 
 	return 0;
@@ -682,7 +761,7 @@ static inline int engine_put_end_r(struct lwm2m_output_context *out,
 				   struct lwm2m_obj_path *path)
 {
 	if (out->writer->put_end_r) {
-		return out->writer->put_end_r(out, path);
+		return engine_put_done(out, out->writer->put_end_r(out, path));
 	}
 
 	return 0;
@@ -692,7 +771,7 @@ static inline int engine_put_begin_ri(struct lwm2m_output_context *out,
 				      struct lwm2m_obj_path *path)
 {
 	if (out->writer->put_begin_ri) {
-		return out->writer->put_begin_ri(out, path);
+		return engine_put_done(out, out->writer->put_begin_ri(out, path));
 	}
 
 	return 0;
@@ -702,7 +781,7 @@ static inline int engine_put_end_ri(struct lwm2m_output_context *out,
 				    struct lwm2m_obj_path *path)
 {
 	if (out->writer->put_end_ri) {
-		return out->writer->put_end_ri(out, path);
+		return engine_put_done(out, out->writer->put_end_ri(out, path));
 	}
 
 	return 0;
@@ -712,7 +791,7 @@ static inline int engine_put_s8(struct lwm2m_output_context *out, struct lwm2m_o
 				int8_t value)
 {
 	if (out->writer->put_s8) {
-		return out->writer->put_s8(out, path, value);
+		return engine_put_done(out, out->writer->put_s8(out, path, value));
 	}
 	return -ENOTSUP;
 }
@@ -721,7 +800,7 @@ static inline int engine_put_s16(struct lwm2m_output_context *out, struct lwm2m_
 				 int16_t value)
 {
 	if (out->writer->put_s16) {
-		return out->writer->put_s16(out, path, value);
+		return engine_put_done(out, out->writer->put_s16(out, path, value));
 	}
 	return -ENOTSUP;
 }
@@ -730,7 +809,7 @@ static inline int engine_put_s32(struct lwm2m_output_context *out, struct lwm2m_
 				 int32_t value)
 {
 	if (out->writer->put_s32) {
-		return out->writer->put_s32(out, path, value);
+		return engine_put_done(out, out->writer->put_s32(out, path, value));
 	}
 	return -ENOTSUP;
 }
@@ -739,7 +818,7 @@ static inline int engine_put_s64(struct lwm2m_output_context *out, struct lwm2m_
 				 int64_t value)
 {
 	if (out->writer->put_s64) {
-		return out->writer->put_s64(out, path, value);
+		return engine_put_done(out, out->writer->put_s64(out, path, value));
 	}
 	return -ENOTSUP;
 }
@@ -748,7 +827,7 @@ static inline int engine_put_string(struct lwm2m_output_context *out, struct lwm
 				    char *buf, size_t buflen)
 {
 	if (out->writer->put_string) {
-		return out->writer->put_string(out, path, buf, buflen);
+		return engine_put_done(out, out->writer->put_string(out, path, buf, buflen));
 	}
 	return -ENOTSUP;
 }
@@ -757,7 +836,7 @@ static inline int engine_put_float(struct lwm2m_output_context *out, struct lwm2
 				   double *value)
 {
 	if (out->writer->put_float) {
-		return out->writer->put_float(out, path, value);
+		return engine_put_done(out, out->writer->put_float(out, path, value));
 	}
 	return -ENOTSUP;
 }
@@ -766,7 +845,7 @@ static inline int engine_put_time(struct lwm2m_output_context *out, struct lwm2m
 				  time_t value)
 {
 	if (out->writer->put_time) {
-		return out->writer->put_time(out, path, value);
+		return engine_put_done(out, out->writer->put_time(out, path, value));
 	}
 	return -ENOTSUP;
 }
@@ -775,7 +854,7 @@ static inline int engine_put_bool(struct lwm2m_output_context *out, struct lwm2m
 				  bool value)
 {
 	if (out->writer->put_bool) {
-		return out->writer->put_bool(out, path, value);
+		return engine_put_done(out, out->writer->put_bool(out, path, value));
 	}
 	return -ENOTSUP;
 }
@@ -784,7 +863,7 @@ static inline int engine_put_opaque(struct lwm2m_output_context *out, struct lwm
 				    char *buf, size_t buflen)
 {
 	if (out->writer->put_opaque) {
-		return out->writer->put_opaque(out, path, buf, buflen);
+		return engine_put_done(out, out->writer->put_opaque(out, path, buf, buflen));
 	}
 
 	return -ENOTSUP;
@@ -794,7 +873,7 @@ static inline int engine_put_objlnk(struct lwm2m_output_context *out, struct lwm
 				    struct lwm2m_objlnk *value)
 {
 	if (out->writer->put_objlnk) {
-		return out->writer->put_objlnk(out, path, value);
+		return engine_put_done(out, out->writer->put_objlnk(out, path, value));
 	}
 	return -ENOTSUP;
 }
@@ -803,7 +882,7 @@ static inline int engine_put_corelink(struct lwm2m_output_context *out,
 				      const struct lwm2m_obj_path *path)
 {
 	if (out->writer->put_corelink) {
-		return out->writer->put_corelink(out, path);
+		return engine_put_done(out, out->writer->put_corelink(out, path));
 	}
 
 	return -ENOTSUP;
@@ -812,7 +891,7 @@ static inline int engine_put_corelink(struct lwm2m_output_context *out,
 static inline int engine_put_timestamp(struct lwm2m_output_context *out, time_t timestamp)
 {
 	if (out->writer->put_data_timestamp) {
-		return out->writer->put_data_timestamp(out, timestamp);
+		return engine_put_done(out, out->writer->put_data_timestamp(out, timestamp));
 	}
 
 	return -ENOTSUP;
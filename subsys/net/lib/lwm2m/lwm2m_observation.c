@@ -65,6 +65,19 @@ static sys_slist_t obs_obj_path_list;
 
 static struct observe_node observe_node_data[CONFIG_LWM2M_ENGINE_MAX_OBSERVER];
 
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+/* Hashed set of the observed object IDs, checked before the observer lists
+ * are scanned. Any change to the observers bumps the stale counter, the next
+ * lookup rebuilds it from the observer pool. The counter is only cleared once
+ * a rebuild that started after the last change has been published.
+ */
+#define OBSERVED_OBJ_FILTER_BITS 64
+
+static ATOMIC_DEFINE(observed_obj_filter, OBSERVED_OBJ_FILTER_BITS);
+static atomic_t observed_obj_filter_stale;
+static K_MUTEX_DEFINE(observed_obj_filter_lock);
+#endif
+
 /* External resources */
 struct lwm2m_ctx **lwm2m_sock_ctx(void);
 
@@ -173,6 +186,64 @@ static bool lwm2m_observer_path_compare(const struct lwm2m_obj_path *o_p,
 	return true;
 }
 
+static void observed_obj_filter_invalidate(void)
+{
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+	atomic_inc(&observed_obj_filter_stale);
+#endif
+}
+
+/* Returns false only if no observer can match an object ID */
+static bool observed_obj_filter_match(uint16_t obj_id)
+{
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+	ATOMIC_DEFINE(filter, OBSERVED_OBJ_FILTER_BITS) = {0};
+	struct lwm2m_obj_path_list *o_p;
+	atomic_val_t stale;
+	int i;
+
+	if (atomic_get(&observed_obj_filter_stale) != 0) {
+		/* Serialize the rebuilds so an older one is never published last */
+		k_mutex_lock(&observed_obj_filter_lock, K_FOREVER);
+
+		while ((stale = atomic_get(&observed_obj_filter_stale)) != 0) {
+			for (i = 0; i < ARRAY_SIZE(filter); i++) {
+				atomic_clear(&filter[i]);
+			}
+
+			for (i = 0; i < CONFIG_LWM2M_ENGINE_MAX_OBSERVER; i++) {
+				if (!observe_node_data[i].tkl) {
+					continue;
+				}
+
+				SYS_SLIST_FOR_EACH_CONTAINER(&observe_node_data[i].path_list, o_p,
+							     node) {
+					atomic_set_bit(filter,
+						       o_p->path.obj_id % OBSERVED_OBJ_FILTER_BITS);
+				}
+			}
+
+			for (i = 0; i < ARRAY_SIZE(filter); i++) {
+				atomic_set(&observed_obj_filter[i], atomic_get(&filter[i]));
+			}
+
+			/* Changed again while rebuilding, the filter may miss it */
+			if (atomic_cas(&observed_obj_filter_stale, stale, 0)) {
+				break;
+			}
+		}
+
+		k_mutex_unlock(&observed_obj_filter_lock);
+	}
+
+	return atomic_test_bit(observed_obj_filter, obj_id % OBSERVED_OBJ_FILTER_BITS);
+#else
+	ARG_UNUSED(obj_id);
+
+	return true;
+#endif
+}
+
 static bool lwm2m_notify_observer_list(sys_slist_t *path_list, const struct lwm2m_obj_path *path)
 {
 	struct lwm2m_obj_path_list *o_p;
@@ -343,7 +414,7 @@ int lwm2m_notify_observer_path(const struct lwm2m_obj_path *path)
 	int i;
 	struct lwm2m_ctx **sock_ctx = lwm2m_sock_ctx();
 
-	if (path->level < LWM2M_PATH_LEVEL_OBJECT) {
+	if (path->level < LWM2M_PATH_LEVEL_OBJECT || !observed_obj_filter_match(path->obj_id)) {
 		return 0;
 	}
 
@@ -443,6 +514,7 @@ static void engine_observe_node_init(struct observe_node *obs, const uint8_t *to
 	obs->format = format;
 	obs->counter = OBSERVE_COUNTER_START;
 	sys_slist_append(&ctx->observer, &obs->node);
+	observed_obj_filter_invalidate();
 
 	SYS_SLIST_FOR_EACH_CONTAINER(&obs->path_list, tmp, node) {
 		LOG_DBG("OBSERVER ADDED %u/%u/%u/%u(%u)", tmp->path.obj_id, tmp->path.obj_inst_id,
@@ -469,6 +541,7 @@ static void remove_observer_path_from_list(struct lwm2m_ctx *ctx, struct observe
 	/* Remove from the list and add to free list */
 	sys_slist_remove(&obs->path_list, prev_node, &o_p->node);
 	sys_slist_append(&obs_obj_path_list, &o_p->node);
+	observed_obj_filter_invalidate();
 }
 
 static void engine_observe_single_path_id_remove(struct lwm2m_ctx *ctx, struct observe_node *obs,
@@ -1382,6 +1455,10 @@ bool lwm2m_path_is_observed(const struct lwm2m_obj_path *path)
 	struct observe_node *obs;
 	struct lwm2m_ctx **sock_ctx = lwm2m_sock_ctx();
 
+	if (!observed_obj_filter_match(path->obj_id)) {
+		return false;
+	}
+
 	for (i = 0; i < lwm2m_sock_nfds(); ++i) {
 		SYS_SLIST_FOR_EACH_CONTAINER(&sock_ctx[i]->observer, obs, node) {
 
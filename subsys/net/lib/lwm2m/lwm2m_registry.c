@@ -94,6 +94,40 @@ sys_slist_t *lwm2m_engine_obj_list(void) { return &engine_obj_list; }
 
 sys_slist_t *lwm2m_engine_obj_inst_list(void) { return &engine_obj_inst_list; }
 
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+#define PATH_INDEX_SIZE CONFIG_LWM2M_ENGINE_PATH_INDEX_SIZE
+
+/* Object instances hashed by object and instance ID */
+static sys_slist_t obj_inst_index[PATH_INDEX_SIZE];
+
+/* Recently resolved resources. The resource arrays only come and go with
+ * their object instance, so the cache is flushed whenever an object or an
+ * object instance is added or removed.
+ */
+struct res_index_entry {
+	struct lwm2m_engine_obj_inst *obj_inst;
+	struct lwm2m_engine_obj_field *obj_field;
+	struct lwm2m_engine_res *res;
+};
+
+static struct res_index_entry res_index[PATH_INDEX_SIZE];
+
+static inline uint32_t obj_inst_index_hash(uint16_t obj_id, uint16_t obj_inst_id)
+{
+	return ((uint32_t)obj_id * 31U + obj_inst_id) % PATH_INDEX_SIZE;
+}
+
+static inline uint32_t res_index_hash(uint16_t obj_id, uint16_t obj_inst_id, uint16_t res_id)
+{
+	return (((uint32_t)obj_id * 31U + obj_inst_id) * 31U + res_id) % PATH_INDEX_SIZE;
+}
+
+static void res_index_flush(void)
+{
+	(void)memset(res_index, 0, sizeof(res_index));
+}
+#endif /* CONFIG_LWM2M_ENGINE_PATH_INDEX */
+
 #if defined(CONFIG_LWM2M_RESOURCE_DATA_CACHE_SUPPORT)
 static void lwm2m_engine_cache_write(const struct lwm2m_engine_obj_field *obj_field,
 				     const struct lwm2m_obj_path *path, const void *value,
@@ -113,6 +147,9 @@ void lwm2m_register_obj(struct lwm2m_engine_obj *obj)
 #endif /* CONFIG_LWM2M_RD_CLIENT_SUPPORT_BOOTSTRAP */
 #endif /* CONFIG_LWM2M_ACCESS_CONTROL_ENABLE */
 	sys_slist_append(&engine_obj_list, &obj->node);
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+	res_index_flush();
+#endif
 	k_mutex_unlock(&registry_lock);
 }
 
@@ -124,6 +161,9 @@ void lwm2m_unregister_obj(struct lwm2m_engine_obj *obj)
 #endif
 	engine_remove_observer_by_id(obj->obj_id, -1);
 	sys_slist_find_and_remove(&engine_obj_list, &obj->node);
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+	res_index_flush();
+#endif
 	k_mutex_unlock(&registry_lock);
 }
 
@@ -176,6 +216,12 @@ static void engine_register_obj_inst(struct lwm2m_engine_obj_inst *obj_inst)
 #endif /* CONFIG_LWM2M_RD_CLIENT_SUPPORT_BOOTSTRAP */
 #endif /* CONFIG_LWM2M_ACCESS_CONTROL_ENABLE */
 	sys_slist_append(&engine_obj_inst_list, &obj_inst->node);
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+	sys_slist_append(&obj_inst_index[obj_inst_index_hash(obj_inst->obj->obj_id,
+							     obj_inst->obj_inst_id)],
+			 &obj_inst->index_node);
+	res_index_flush();
+#endif
 }
 
 static void engine_unregister_obj_inst(struct lwm2m_engine_obj_inst *obj_inst)
@@ -185,17 +231,32 @@ static void engine_unregister_obj_inst(struct lwm2m_engine_obj_inst *obj_inst)
 #endif
 	engine_remove_observer_by_id(obj_inst->obj->obj_id, obj_inst->obj_inst_id);
 	sys_slist_find_and_remove(&engine_obj_inst_list, &obj_inst->node);
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+	sys_slist_find_and_remove(&obj_inst_index[obj_inst_index_hash(obj_inst->obj->obj_id,
+								      obj_inst->obj_inst_id)],
+				  &obj_inst->index_node);
+	res_index_flush();
+#endif
 }
 
 struct lwm2m_engine_obj_inst *get_engine_obj_inst(int obj_id, int obj_inst_id)
 {
 	struct lwm2m_engine_obj_inst *obj_inst;
 
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+	SYS_SLIST_FOR_EACH_CONTAINER(&obj_inst_index[obj_inst_index_hash(obj_id, obj_inst_id)],
+				     obj_inst, index_node) {
+		if (obj_inst->obj->obj_id == obj_id && obj_inst->obj_inst_id == obj_inst_id) {
+			return obj_inst;
+		}
+	}
+#else
 	SYS_SLIST_FOR_EACH_CONTAINER(&engine_obj_inst_list, obj_inst, node) {
 		if (obj_inst->obj->obj_id == obj_id && obj_inst->obj_inst_id == obj_inst_id) {
 			return obj_inst;
 		}
 	}
+#endif
 
 	return NULL;
 }
@@ -396,20 +457,14 @@ struct lwm2m_engine_obj_inst *lwm2m_engine_get_obj_inst(const struct lwm2m_obj_p
 	return get_engine_obj_inst(path->obj_id, path->obj_inst_id);
 }
 
-int path_to_objs(const struct lwm2m_obj_path *path, struct lwm2m_engine_obj_inst **obj_inst,
-		 struct lwm2m_engine_obj_field **obj_field, struct lwm2m_engine_res **res,
-		 struct lwm2m_engine_res_inst **res_inst)
+static int path_to_res(const struct lwm2m_obj_path *path, struct lwm2m_engine_obj_inst **obj_inst,
+		       struct lwm2m_engine_obj_field **obj_field, struct lwm2m_engine_res **res)
 {
 	struct lwm2m_engine_obj_inst *oi;
 	struct lwm2m_engine_obj_field *of;
 	struct lwm2m_engine_res *r = NULL;
-	struct lwm2m_engine_res_inst *ri = NULL;
 	int i;
 
-	if (!path) {
-		return -EINVAL;
-	}
-
 	oi = get_engine_obj_inst(path->obj_id, path->obj_inst_id);
 	if (!oi) {
 		LOG_ERR("obj instance %d/%d not found", path->obj_id, path->obj_inst_id);
@@ -444,6 +499,70 @@ int path_to_objs(const struct lwm2m_obj_path *path, struct lwm2m_engine_obj_inst
 		return -ENOENT;
 	}
 
+	*obj_inst = oi;
+	*obj_field = of;
+	*res = r;
+
+	return 0;
+}
+
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+static int path_to_res_cached(const struct lwm2m_obj_path *path,
+			      struct lwm2m_engine_obj_inst **obj_inst,
+			      struct lwm2m_engine_obj_field **obj_field,
+			      struct lwm2m_engine_res **res)
+{
+	struct res_index_entry *entry;
+	int ret = 0;
+
+	k_mutex_lock(&registry_lock, K_FOREVER);
+
+	entry = &res_index[res_index_hash(path->obj_id, path->obj_inst_id, path->res_id)];
+	if (entry->res == NULL || entry->res->res_id != path->res_id ||
+	    entry->obj_inst->obj_inst_id != path->obj_inst_id ||
+	    entry->obj_inst->obj->obj_id != path->obj_id) {
+		ret = path_to_res(path, obj_inst, obj_field, res);
+		if (ret == 0) {
+			entry->obj_inst = *obj_inst;
+			entry->obj_field = *obj_field;
+			entry->res = *res;
+		}
+	} else {
+		*obj_inst = entry->obj_inst;
+		*obj_field = entry->obj_field;
+		*res = entry->res;
+	}
+
+	k_mutex_unlock(&registry_lock);
+
+	return ret;
+}
+#endif /* CONFIG_LWM2M_ENGINE_PATH_INDEX */
+
+int path_to_objs(const struct lwm2m_obj_path *path, struct lwm2m_engine_obj_inst **obj_inst,
+		 struct lwm2m_engine_obj_field **obj_field, struct lwm2m_engine_res **res,
+		 struct lwm2m_engine_res_inst **res_inst)
+{
+	struct lwm2m_engine_obj_inst *oi;
+	struct lwm2m_engine_obj_field *of;
+	struct lwm2m_engine_res *r;
+	struct lwm2m_engine_res_inst *ri = NULL;
+	int ret;
+	int i;
+
+	if (!path) {
+		return -EINVAL;
+	}
+
+#if defined(CONFIG_LWM2M_ENGINE_PATH_INDEX)
+	ret = path_to_res_cached(path, &oi, &of, &r);
+#else
+	ret = path_to_res(path, &oi, &of, &r);
+#endif
+	if (ret < 0) {
+		return ret;
+	}
+
 	for (i = 0; i < r->res_inst_count; i++) {
 		if (r->res_instances[i].res_inst_id == path->res_inst_id) {
 			ri = &r->res_instances[i];
@@ -18,6 +18,7 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 #include <inttypes.h>
 #include <ctype.h>
 #include <time.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/util.h>
 #include <zephyr/kernel.h>
 
@@ -35,26 +36,27 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 
 #define SENML_MAX_NAME_SIZE sizeof("/65535/65535/")
 
+/* Records are encoded one by one as soon as they get their value, so only the
+ * record being built is kept, whatever the number of records in the message.
+ */
 struct cbor_out_fmt_data {
-	/* Data */
+	/* Record being built, the first one of the input */
 	struct lwm2m_senml input;
 
-	/* Storage for basenames and names ~ sizeof("/65535/65535/") */
-	struct {
-		char names[CONFIG_LWM2M_RW_SENML_CBOR_RECORDS][SENML_MAX_NAME_SIZE];
-		size_t name_sz; /* Name buff size */
-		uint8_t name_cnt;
-	};
+	/* Storage for the basename and the name of the record being built */
+	char basename[SENML_MAX_NAME_SIZE];
+	char name[SENML_MAX_NAME_SIZE];
 
 	/* Basetime for Cached data timestamp */
 	time_t basetime;
 
-	/* Storage for object links */
-	struct {
-		char objlnk[CONFIG_LWM2M_RW_SENML_CBOR_RECORDS][sizeof("65535:65535")];
-		size_t objlnk_sz; /* Object link buff size */
-		uint8_t objlnk_cnt;
-	};
+	/* Storage for the object link of the record being built */
+	char objlnk[sizeof("65535:65535")];
+
+	/* Position of the array header in the output and number of records */
+	uint16_t array_offset;
+	uint16_t record_cnt;
+	bool array_started;
 };
 
 struct cbor_in_fmt_data {
@@ -78,15 +80,10 @@ static int path_to_string(char *buf, size_t buf_size, const struct lwm2m_obj_pat
  */
 K_MUTEX_DEFINE(fd_mtx);
 
-#define GET_CBOR_FD_NAME(fd) ((fd)->names[(fd)->name_cnt])
 /* Get the current record */
-#define GET_CBOR_FD_REC(fd) \
-	&((fd)->input.lwm2m_senml_record_m[(fd)->input.lwm2m_senml_record_m_count])
+#define GET_CBOR_FD_REC(fd) (&(fd)->input.lwm2m_senml_record_m[0])
 /* Get a record */
 #define GET_IN_FD_REC_I(fd, i) &((fd)->dcd.lwm2m_senml_record_m[i])
-/* Consume the current record */
-#define CONSUME_CBOR_FD_REC(fd) \
-	&((fd)->input.lwm2m_senml_record_m[(fd)->input.lwm2m_senml_record_m_count++])
 /* Get CBOR output formatter data */
 #define LWM2M_OFD_CBOR(octx) ((struct cbor_out_fmt_data *)engine_get_out_user_data(octx))
 
@@ -98,9 +95,6 @@ static void setup_out_fmt_data(struct lwm2m_message *msg)
 
 	(void)memset(fd, 0, sizeof(*fd));
 	engine_set_out_user_data(&msg->out, fd);
-	fd->name_sz = SENML_MAX_NAME_SIZE;
-	fd->basetime = 0;
-	fd->objlnk_sz = sizeof("65535:65535");
 }
 
 static void clear_out_fmt_data(struct lwm2m_message *msg)
@@ -127,15 +121,36 @@ static void clear_in_fmt_data(struct lwm2m_message *msg)
 	k_mutex_unlock(&fd_mtx);
 }
 
-static int fmt_range_check(struct cbor_out_fmt_data *fd)
+/* Encode the current record after the output written so far */
+static int put_record(struct lwm2m_output_context *out)
 {
-	if (fd->name_cnt >= CONFIG_LWM2M_RW_SENML_CBOR_RECORDS ||
-	    fd->objlnk_cnt >= CONFIG_LWM2M_RW_SENML_CBOR_RECORDS ||
-	    fd->input.lwm2m_senml_record_m_count >= CONFIG_LWM2M_RW_SENML_CBOR_RECORDS) {
-		LOG_ERR("CONFIG_LWM2M_RW_SENML_CBOR_RECORDS too small");
+	struct cbor_out_fmt_data *fd = LWM2M_OFD_CBOR(out);
+	uint8_t *record_start = CPKT_BUF_W_PTR(out->out_cpkt);
+	uint_fast8_t ret;
+	size_t len;
+
+	if (!fd->array_started || fd->record_cnt == UINT16_MAX) {
+		return -ENOMEM;
+	}
+
+	fd->input.lwm2m_senml_record_m_count = 1;
+	ret = cbor_encode_lwm2m_senml(CPKT_BUF_W_REGION(out->out_cpkt), &fd->input, &len);
+
+	(void)memset(GET_CBOR_FD_REC(fd), 0, sizeof(struct record));
+	fd->input.lwm2m_senml_record_m_count = 0;
+
+	if (ret != ZCBOR_SUCCESS) {
+		LOG_ERR("unable to encode senml cbor record");
 		return -ENOMEM;
 	}
 
+	/* The record comes wrapped into an array of one, drop the array header.
+	 * The real header is written by put_end() once all records are known.
+	 */
+	memmove(record_start, record_start + 1, len - 1);
+	out->out_cpkt->offset += len - 1;
+	fd->record_cnt++;
+
 	return 0;
 }
 
@@ -143,16 +158,10 @@ static int put_basename(struct lwm2m_output_context *out, struct lwm2m_obj_path
 {
 	struct cbor_out_fmt_data *fd = LWM2M_OFD_CBOR(out);
 	int len;
-	int ret;
-
-	ret = fmt_range_check(fd);
-	if (ret < 0) {
-		return ret;
-	}
 
-	char *basename = GET_CBOR_FD_NAME(fd);
+	char *basename = fd->basename;
 
-	len = path_to_string(basename, fd->name_sz, path, LWM2M_PATH_LEVEL_OBJECT_INST);
+	len = path_to_string(basename, sizeof(fd->basename), path, LWM2M_PATH_LEVEL_OBJECT_INST);
 
 	if (len < 0) {
 		return len;
@@ -170,44 +179,110 @@ static int put_basename(struct lwm2m_output_context *out, struct lwm2m_obj_path
 		return -EINVAL;
 	}
 
-	fd->name_cnt++;
-
 	return 0;
 }
 
-static int put_empty_array(struct lwm2m_output_context *out)
+static size_t array_header_len(uint16_t record_cnt)
 {
-	int len = 1;
+	if (record_cnt < 24) {
+		return 1;
+	} else if (record_cnt <= UINT8_MAX) {
+		return 2;
+	}
 
-	memset(CPKT_BUF_W_PTR(out->out_cpkt), 0x80, len); /* 80 # array(0) */
-	out->out_cpkt->offset += len;
+	return 3;
+}
 
-	return len;
+static void encode_array_header(uint8_t *array, uint16_t record_cnt)
+{
+	/* Major type 4, the count in the additional info or in 1 or 2 bytes */
+	switch (array_header_len(record_cnt)) {
+	case 1:
+		array[0] = 0x80 | record_cnt;
+		break;
+	case 2:
+		array[0] = 0x98;
+		array[1] = record_cnt;
+		break;
+	default:
+		array[0] = 0x99;
+		sys_put_be16(record_cnt, &array[1]);
+		break;
+	}
+}
+
+static int put_begin(struct lwm2m_output_context *out, struct lwm2m_obj_path *path)
+{
+	struct cbor_out_fmt_data *fd = LWM2M_OFD_CBOR(out);
+
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	if (out->window) {
+		/* The header may be gone before put_end(), write the number of
+		 * records found by the previous pass right away.
+		 */
+		size_t hdr_len = array_header_len(out->window->records);
+
+		if (CPKT_BUF_W_SIZE(out->out_cpkt) < hdr_len) {
+			return -ENOMEM;
+		}
+
+		encode_array_header(CPKT_BUF_W_PTR(out->out_cpkt), out->window->records);
+		fd->array_started = true;
+		out->out_cpkt->offset += hdr_len;
+
+		return 0;
+	}
+#endif
+
+	/* Reserve the shortest array header, put_end() makes room if needed */
+	if (CPKT_BUF_W_SIZE(out->out_cpkt) < 1) {
+		return -ENOMEM;
+	}
+
+	fd->array_offset = out->out_cpkt->offset;
+	fd->array_started = true;
+	out->out_cpkt->offset++;
+
+	return 0;
 }
 
 static int put_end(struct lwm2m_output_context *out, struct lwm2m_obj_path *path)
 {
-	size_t len;
-	struct lwm2m_senml *input = &(LWM2M_OFD_CBOR(out)->input);
+	struct cbor_out_fmt_data *fd = LWM2M_OFD_CBOR(out);
+	uint8_t *array;
+	size_t hdr_len;
 
-	if (!input->lwm2m_senml_record_m_count) {
-		len = put_empty_array(out);
+	if (!fd->array_started) {
+		return -ENOMEM;
+	}
 
-		return len;
+	fd->array_started = false;
+
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+	if (out->window) {
+		/* The engine runs another pass if the count has changed */
+		out->window->records = fd->record_cnt;
+		return 0;
 	}
+#endif
 
-	uint_fast8_t ret =
-		cbor_encode_lwm2m_senml(CPKT_BUF_W_REGION(out->out_cpkt), input, &len);
+	hdr_len = array_header_len(fd->record_cnt);
 
-	if (ret != ZCBOR_SUCCESS) {
-		LOG_ERR("unable to encode senml cbor msg");
+	if (CPKT_BUF_W_SIZE(out->out_cpkt) < hdr_len - 1) {
+		return -ENOMEM;
+	}
 
-		return -E2BIG;
+	array = out->out_cpkt->data + fd->array_offset;
+
+	if (hdr_len > 1) {
+		memmove(array + hdr_len, array + 1,
+			out->out_cpkt->offset - fd->array_offset - 1);
+		out->out_cpkt->offset += hdr_len - 1;
 	}
 
-	out->out_cpkt->offset += len;
+	encode_array_header(array, fd->record_cnt);
 
-	return len;
+	return 0;
 }
 
 static int put_begin_oi(struct lwm2m_output_context *out, struct lwm2m_obj_path *path)
@@ -228,14 +303,8 @@ static int put_begin_r(struct lwm2m_output_context *out, struct lwm2m_obj_path *
 {
 	struct cbor_out_fmt_data *fd = LWM2M_OFD_CBOR(out);
 	int len;
-	int ret;
 
-	ret = fmt_range_check(fd);
-	if (ret < 0) {
-		return ret;
-	}
-
-	char *name = GET_CBOR_FD_NAME(fd);
+	char *name = fd->name;
 
 	/* Write resource name */
 	len = snprintk(name, sizeof("65535"), "%" PRIu16 "", path->res_id);
@@ -245,16 +314,6 @@ static int put_begin_r(struct lwm2m_output_context *out, struct lwm2m_obj_path *
 		return -EINVAL;
 	}
 
-	/* Check if we could use an already existing name
-	 * -> latest name slot is used as a scratchpad
-	 */
-	for (int idx = 0; idx < fd->name_cnt; idx++) {
-		if (strncmp(name, fd->names[idx], len) == 0) {
-			name = fd->names[idx];
-			break;
-		}
-	}
-
 	/* Tell CBOR encoder where to find the name */
 	struct record *record = GET_CBOR_FD_REC(fd);
 
@@ -262,13 +321,6 @@ static int put_begin_r(struct lwm2m_output_context *out, struct lwm2m_obj_path *
 	record->record_n.record_n.len = len;
 	record->record_n_present = 1;
 
-	/* Makes possible to use same slot for storing r/ri name combination.
-	 * No need to increase the name count if an existing name has been used
-	 */
-	if (path->level < LWM2M_PATH_LEVEL_RESOURCE_INST && name == GET_CBOR_FD_NAME(fd)) {
-		fd->name_cnt++;
-	}
-
 	return 0;
 }
 
@@ -276,12 +328,6 @@ static int put_data_timestamp(struct lwm2m_output_context *out, time_t value)
 {
 	struct record *out_record;
 	struct cbor_out_fmt_data *fd = LWM2M_OFD_CBOR(out);
-	int ret;
-
-	ret = fmt_range_check(fd);
-	if (ret < 0) {
-		return ret;
-	}
 
 	/* Tell CBOR encoder where to find the name */
 	out_record = GET_CBOR_FD_REC(fd);
@@ -302,14 +348,8 @@ static int put_data_timestamp(struct lwm2m_output_context *out, time_t value)
 static int put_begin_ri(struct lwm2m_output_context *out, struct lwm2m_obj_path *path)
 {
 	struct cbor_out_fmt_data *fd = LWM2M_OFD_CBOR(out);
-	char *name = GET_CBOR_FD_NAME(fd);
+	char *name = fd->name;
 	struct record *record = GET_CBOR_FD_REC(fd);
-	int ret;
-
-	ret = fmt_range_check(fd);
-	if (ret < 0) {
-		return ret;
-	}
 
 	/* Forms name from resource id and resource instance id */
 	int len = snprintk(name, SENML_MAX_NAME_SIZE,
@@ -321,26 +361,11 @@ static int put_begin_ri(struct lwm2m_output_context *out, struct lwm2m_obj_path
 		return -EINVAL;
 	}
 
-	/* Check if we could use an already existing name
-	 * -> latest name slot is used as a scratchpad
-	 */
-	for (int idx = 0; idx < fd->name_cnt; idx++) {
-		if (strncmp(name, fd->names[idx], len) == 0) {
-			name = fd->names[idx];
-			break;
-		}
-	}
-
 	/* Tell CBOR encoder where to find the name */
 	record->record_n.record_n.value = name;
 	record->record_n.record_n.len = len;
 	record->record_n_present = 1;
 
-	/* No need to increase the name count if an existing name has been used */
-	if (name == GET_CBOR_FD_NAME(fd)) {
-		fd->name_cnt++;
-	}
-
 	return 0;
 }
 
@@ -369,14 +394,14 @@ static int put_value(struct lwm2m_output_context *out, struct lwm2m_obj_path *pa
 		return ret;
 	}
 
-	struct record *record = CONSUME_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
+	struct record *record = GET_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
 
 	/* Write the value */
 	record->record_union.record_union_choice = union_vi_c;
 	record->record_union.union_vi = value;
 	record->record_union_present = 1;
 
-	return 0;
+	return put_record(out);
 }
 
 static int put_s8(struct lwm2m_output_context *out, struct lwm2m_obj_path *path, int8_t value)
@@ -407,14 +432,14 @@ static int put_time(struct lwm2m_output_context *out, struct lwm2m_obj_path *pat
 		return ret;
 	}
 
-	struct record *record = CONSUME_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
+	struct record *record = GET_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
 
 	/* Write the value */
 	record->record_union.record_union_choice = union_vi_c;
 	record->record_union.union_vi = (int64_t)value;
 	record->record_union_present = 1;
 
-	return 0;
+	return put_record(out);
 }
 
 static int put_float(struct lwm2m_output_context *out, struct lwm2m_obj_path *path, double *value)
@@ -425,14 +450,14 @@ static int put_float(struct lwm2m_output_context *out, struct lwm2m_obj_path *pa
 		return ret;
 	}
 
-	struct record *record = CONSUME_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
+	struct record *record = GET_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
 
 	/* Write the value */
 	record->record_union.record_union_choice = union_vf_c;
 	record->record_union.union_vf = *value;
 	record->record_union_present = 1;
 
-	return 0;
+	return put_record(out);
 }
 
 static int put_string(struct lwm2m_output_context *out, struct lwm2m_obj_path *path, char *buf,
@@ -444,7 +469,7 @@ static int put_string(struct lwm2m_output_context *out, struct lwm2m_obj_path *p
 		return ret;
 	}
 
-	struct record *record = CONSUME_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
+	struct record *record = GET_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
 
 	/* Write the value */
 	record->record_union.record_union_choice = union_vs_c;
@@ -452,7 +477,7 @@ static int put_string(struct lwm2m_output_context *out, struct lwm2m_obj_path *p
 	record->record_union.union_vs.len = buflen;
 	record->record_union_present = 1;
 
-	return 0;
+	return put_record(out);
 }
 
 static int put_bool(struct lwm2m_output_context *out, struct lwm2m_obj_path *path, bool value)
@@ -463,14 +488,14 @@ static int put_bool(struct lwm2m_output_context *out, struct lwm2m_obj_path *pat
 		return ret;
 	}
 
-	struct record *record = CONSUME_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
+	struct record *record = GET_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
 
 	/* Write the value */
 	record->record_union.record_union_choice = union_vb_c;
 	record->record_union.union_vb = value;
 	record->record_union_present = 1;
 
-	return 0;
+	return put_record(out);
 }
 
 static int put_opaque(struct lwm2m_output_context *out, struct lwm2m_obj_path *path, char *buf,
@@ -482,7 +507,7 @@ static int put_opaque(struct lwm2m_output_context *out, struct lwm2m_obj_path *p
 		return ret;
 	}
 
-	struct record *record = CONSUME_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
+	struct record *record = GET_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
 
 	/* Write the value */
 	record->record_union.record_union_choice = union_vd_c;
@@ -490,7 +515,7 @@ static int put_opaque(struct lwm2m_output_context *out, struct lwm2m_obj_path *p
 	record->record_union.union_vd.len = buflen;
 	record->record_union_present = 1;
 
-	return 0;
+	return put_record(out);
 }
 
 static int put_objlnk(struct lwm2m_output_context *out, struct lwm2m_obj_path *path,
@@ -499,16 +524,10 @@ static int put_objlnk(struct lwm2m_output_context *out, struct lwm2m_obj_path *p
 	int ret = 0;
 	struct cbor_out_fmt_data *fd = LWM2M_OFD_CBOR(out);
 
-	ret = fmt_range_check(fd);
-	if (ret < 0) {
-		return ret;
-	}
-
 	/* Format object link */
-	int objlnk_idx = fd->objlnk_cnt;
-	char *objlink_buf = fd->objlnk[objlnk_idx];
+	char *objlink_buf = fd->objlnk;
 	int objlnk_len =
-		snprintk(objlink_buf, fd->objlnk_sz, "%u:%u", value->obj_id, value->obj_inst);
+		snprintk(objlink_buf, sizeof(fd->objlnk), "%u:%u", value->obj_id, value->obj_inst);
 	if (objlnk_len < 0) {
 		return -EINVAL;
 	}
@@ -519,7 +538,7 @@ static int put_objlnk(struct lwm2m_output_context *out, struct lwm2m_obj_path *p
 		return ret;
 	}
 
-	struct record *record = CONSUME_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
+	struct record *record = GET_CBOR_FD_REC(LWM2M_OFD_CBOR(out));
 
 	/* Write the value */
 	record->record_union.record_union_choice = union_vlo_c;
@@ -527,9 +546,7 @@ static int put_objlnk(struct lwm2m_output_context *out, struct lwm2m_obj_path *p
 	record->record_union.union_vlo.len = objlnk_len;
 	record->record_union_present = 1;
 
-	fd->objlnk_cnt++;
-
-	return 0;
+	return put_record(out);
 }
 
 static int get_opaque(struct lwm2m_input_context *in,
@@ -778,6 +795,7 @@ static int do_write_op_item(struct lwm2m_message *msg, struct record *rec)
 }
 
 const struct lwm2m_writer senml_cbor_writer = {
+	.put_begin = put_begin,
 	.put_end = put_end,
 	.put_begin_oi = put_begin_oi,
 	.put_begin_r = put_begin_r,
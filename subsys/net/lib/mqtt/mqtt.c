@@ -117,12 +117,31 @@ static int client_read(struct mqtt_client *client)
 		return -EBUSY;
 	}
 
-	err_code = mqtt_handle_rx(client);
-	if (err_code < 0) {
-		client_disconnect(client, err_code, true);
+	/* Handle all the packets already received, so that for instance a
+	 * burst of acknowledgements only takes one call.
+	 */
+	for (int i = 0; i < CONFIG_MQTT_INPUT_MAX_PACKETS; i++) {
+		err_code = mqtt_handle_rx(client);
+		if (err_code == -EAGAIN) {
+			/* No complete packet left. */
+			return 0;
+		}
+
+		if (err_code < 0) {
+			client_disconnect(client, err_code, true);
+			return err_code;
+		}
+
+		/* Stop if the application has to read a publish payload
+		 * first, or if the connection was closed from the callback.
+		 */
+		if (client->internal.remaining_payload > 0 ||
+		    !MQTT_HAS_STATE(client, MQTT_STATE_TCP_CONNECTED)) {
+			break;
+		}
 	}
 
-	return err_code;
+	return 0;
 }
 
 static int client_write(struct mqtt_client *client, const uint8_t *data,
@@ -241,8 +260,10 @@ int mqtt_publish(struct mqtt_client *client,
 {
 	int err_code;
 	struct buf_ctx packet;
-	struct iovec io_vector[2];
+	struct iovec io_vector[4];
 	struct msghdr msg;
+	size_t id_len;
+	int iov_cnt = 0;
 
 	NULL_PARAM_CHECK(client);
 	NULL_PARAM_CHECK(param);
@@ -261,20 +282,53 @@ int mqtt_publish(struct mqtt_client *client,
 		goto error;
 	}
 
-	err_code = publish_encode(param, &packet);
-	if (err_code < 0) {
-		goto error;
+	/* TLS and WebSocket make a record or a frame of each I/O vector, so
+	 * for them the topic is copied to the TX buffer when it fits.
+	 */
+	err_code = -ENOMEM;
+	if (client->transport.type != MQTT_TRANSPORT_NON_SECURE) {
+		err_code = publish_encode(param, &packet);
+		if (err_code < 0 && err_code != -ENOMEM) {
+			goto error;
+		}
 	}
 
-	io_vector[0].iov_base = packet.cur;
-	io_vector[0].iov_len = packet.end - packet.cur;
-	io_vector[1].iov_base = param->message.payload.data;
-	io_vector[1].iov_len = param->message.payload.len;
+	if (err_code == 0) {
+		io_vector[iov_cnt].iov_base = packet.cur;
+		io_vector[iov_cnt++].iov_len = packet.end - packet.cur;
+	} else {
+		tx_buf_init(client, &packet);
+
+		err_code = publish_header_encode(param, &packet);
+		if (err_code < 0) {
+			goto error;
+		}
+
+		/* The topic is sent straight from the application memory */
+		id_len = param->message.topic.qos ? sizeof(uint16_t) : 0;
+
+		io_vector[iov_cnt].iov_base = packet.cur;
+		io_vector[iov_cnt++].iov_len = packet.end - packet.cur - id_len;
+		io_vector[iov_cnt].iov_base =
+			(uint8_t *)param->message.topic.topic.utf8;
+		io_vector[iov_cnt++].iov_len = param->message.topic.topic.size;
+
+		if (id_len > 0) {
+			io_vector[iov_cnt].iov_base = packet.end - id_len;
+			io_vector[iov_cnt++].iov_len = id_len;
+		}
+	}
+
+	/* The payload is not copied either */
+	if (param->message.payload.len > 0) {
+		io_vector[iov_cnt].iov_base = param->message.payload.data;
+		io_vector[iov_cnt++].iov_len = param->message.payload.len;
+	}
 
 	memset(&msg, 0, sizeof(msg));
 
 	msg.msg_iov = io_vector;
-	msg.msg_iovlen = ARRAY_SIZE(io_vector);
+	msg.msg_iovlen = iov_cnt;
 
 	err_code = client_write_msg(client, &msg);
 
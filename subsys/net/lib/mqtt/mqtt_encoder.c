@@ -432,6 +432,53 @@ int publish_encode(const struct mqtt_publish_param *param, struct buf_ctx *buf)
 	return 0;
 }
 
+int publish_header_encode(const struct mqtt_publish_param *param,
+			  struct buf_ctx *buf)
+{
+	const uint8_t message_type = MQTT_MESSAGES_OPTIONS(
+			MQTT_PKT_TYPE_PUBLISH, param->dup_flag,
+			param->message.topic.qos, param->retain_flag);
+	uint32_t length;
+	uint8_t *start = buf->cur;
+
+	/* Message id zero is not permitted by spec. */
+	if ((param->message.topic.qos) && (param->message_id == 0U)) {
+		return -EINVAL;
+	}
+
+	if ((buf->end - buf->cur) <
+	    (MQTT_FIXED_HEADER_MAX_SIZE + 2 * sizeof(uint16_t))) {
+		return -ENOMEM;
+	}
+
+	length = GET_UT8STR_BUFFER_SIZE(&param->message.topic.topic) +
+		 param->message.payload.len;
+	if (param->message.topic.qos) {
+		length += sizeof(uint16_t);
+	}
+
+	if (length > MQTT_MAX_PAYLOAD_SIZE) {
+		return -EMSGSIZE;
+	}
+
+	(void)pack_uint8(message_type, buf);
+	(void)packet_length_encode(length, buf);
+
+	/* The topic itself is not copied, only its length. The message id
+	 * follows directly, the caller sends the topic in between.
+	 */
+	(void)pack_uint16(param->message.topic.topic.size, buf);
+
+	if (param->message.topic.qos) {
+		(void)pack_uint16(param->message_id, buf);
+	}
+
+	buf->end = buf->cur;
+	buf->cur = start;
+
+	return 0;
+}
+
 int publish_ack_encode(const struct mqtt_puback_param *param,
 		       struct buf_ctx *buf)
 {
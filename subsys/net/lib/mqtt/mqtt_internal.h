@@ -158,7 +158,8 @@ void event_notify(struct mqtt_client *client, const struct mqtt_evt *evt);
  *
  * @param[in] client Identifies the client for which the data was received.
 
- * @return 0 if the procedure is successful, an error code otherwise.
+ * @return 0 if a packet was handled, -EAGAIN if no complete packet was
+ *         available, another error code otherwise.
  */
 int mqtt_handle_rx(struct mqtt_client *client);
 
@@ -191,6 +192,24 @@ int connect_request_encode(const struct mqtt_client *client,
  */
 int publish_encode(const struct mqtt_publish_param *param, struct buf_ctx *buf);
 
+/**@brief Constructs/encodes the header of a Publish packet, for sending it
+ *        without copying the topic and the payload.
+ *
+ * The encoded data is the fixed header and the topic length, followed by the
+ * message id if the QoS is above 0. The topic must be sent between the topic
+ * length and the message id, then the payload.
+ *
+ * @param[in] param Publish message parameters.
+ * @param[inout] buf_ctx Pointer to the buffer context structure,
+ *                       containing buffer for the encoded header.
+ *                       As output points to the beginning and end of
+ *                       the header.
+ *
+ * @return 0 if the procedure is successful, an error code otherwise.
+ */
+int publish_header_encode(const struct mqtt_publish_param *param,
+			  struct buf_ctx *buf);
+
 /**@brief Constructs/encodes Publish Ack packet.
  *
  * @param[in] param Publish Ack message parameters.
@@ -266,7 +266,7 @@ int mqtt_handle_rx(struct mqtt_client *client)
 	err_code = mqtt_read_and_parse_fixed_header(client, &type_and_flags,
 						    &var_length, &buf);
 	if (err_code < 0) {
-		return (err_code == -EAGAIN) ? 0 : err_code;
+		return err_code;
 	}
 
 	if ((type_and_flags & 0xF0) == MQTT_PKT_TYPE_PUBLISH) {
@@ -277,7 +277,7 @@ int mqtt_handle_rx(struct mqtt_client *client)
 	}
 
 	if (err_code < 0) {
-		return (err_code == -EAGAIN) ? 0 : err_code;
+		return err_code;
 	}
 
 	/* At this point, packet is ready to be passed to the application. */
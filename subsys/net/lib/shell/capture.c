@@ -244,6 +244,126 @@ static int cmd_net_capture_disable(const struct shell *sh, size_t argc, char *ar
 	return 0;
 }
 
+#if defined(CONFIG_NET_CAPTURE_RING)
+static int cmd_net_capture_ring(const struct shell *sh, size_t argc, char *argv[])
+{
+	struct net_capture_ring_stats stats;
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	net_capture_ring_stats_get(&stats);
+
+	PR_INFO("Network packet capture ring %s\n",
+		net_capture_ring_is_enabled() ? "enabled" : "disabled");
+	PR("Captured  %u\n", stats.captured);
+	PR("Truncated %u\n", stats.truncated);
+	PR("Dropped   %u\n", stats.dropped);
+
+	return 0;
+}
+
+static int cmd_net_capture_ring_enable(const struct shell *sh, size_t argc, char *argv[])
+{
+	struct net_if *iface = NULL;
+	int ret;
+
+	if (argc > 1) {
+		int if_index = atoi(argv[1]);
+
+		iface = net_if_get_by_index(if_index);
+		if (iface == NULL) {
+			PR_WARNING("No such interface with index %d\n", if_index);
+			return -ENOEXEC;
+		}
+	}
+
+	ret = net_capture_ring_enable(iface);
+	if (ret < 0) {
+		PR_WARNING("Capture %s failed (%d)\n", "enable", ret);
+		return -ENOEXEC;
+	}
+
+	return 0;
+}
+
+static int cmd_net_capture_ring_disable(const struct shell *sh, size_t argc, char *argv[])
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	(void)net_capture_ring_disable();
+
+	return 0;
+}
+
+static int capture_ring_dump_cb(const uint8_t *data, size_t len, void *user_data)
+{
+	const struct shell *sh = user_data;
+
+	shell_hexdump(sh, data, len);
+
+	return 0;
+}
+
+static int cmd_net_capture_ring_dump(const struct shell *sh, size_t argc, char *argv[])
+{
+	struct net_capture_pcap_hdr hdr;
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	/* The output is a pcap file, it can be converted back to binary
+	 * with "xxd -r" after removing the offsets and the ASCII columns.
+	 */
+	net_capture_ring_pcap_header(&hdr);
+	shell_hexdump(sh, (const uint8_t *)&hdr, sizeof(hdr));
+
+	(void)net_capture_ring_consume(capture_ring_dump_cb, (void *)sh);
+
+	return 0;
+}
+
+#if defined(CONFIG_FILE_SYSTEM)
+static int cmd_net_capture_ring_save(const struct shell *sh, size_t argc, char *argv[])
+{
+	int ret;
+
+	if (argc < 2) {
+		PR_WARNING("File name is missing.\n");
+		return -ENOEXEC;
+	}
+
+	ret = net_capture_ring_save(argv[1]);
+	if (ret < 0) {
+		PR_WARNING("Capture %s failed (%d)\n", "save", ret);
+		return -ENOEXEC;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_FILE_SYSTEM */
+
+SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_capture_ring,
+	SHELL_CMD_ARG(enable, NULL, "Capture packets into the ring.\n"
+		      "'net capture ring enable [<interface index>]'\n"
+		      "All the interfaces are captured if no index is given.",
+		      cmd_net_capture_ring_enable, 1, 1),
+	SHELL_CMD(disable, NULL, "Stop capturing packets into the ring.",
+		  cmd_net_capture_ring_disable),
+	SHELL_CMD(dump, NULL, "Print and remove the captured packets as a "
+		  "pcap file in hex.",
+		  cmd_net_capture_ring_dump),
+#if defined(CONFIG_FILE_SYSTEM)
+	SHELL_CMD_ARG(save, NULL, "Save and remove the captured packets into "
+		      "a pcap file.\n"
+		      "'net capture ring save <file name>'",
+		      cmd_net_capture_ring_save, 2, 0),
+#endif
+	SHELL_SUBCMD_SET_END
+);
+#endif /* CONFIG_NET_CAPTURE_RING */
+
 SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_capture,
 	SHELL_CMD(setup, NULL, "Setup network packet capture.\n"
 		  "'net capture setup <remote-ip-addr> <local-addr> <peer-addr>'\n"
@@ -261,6 +381,11 @@ SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_capture,
 		  cmd_net_capture_enable),
 	SHELL_CMD(disable, NULL, "Disable network packet capture.",
 		  cmd_net_capture_disable),
+#if defined(CONFIG_NET_CAPTURE_RING)
+	SHELL_CMD(ring, &net_cmd_capture_ring, "Capture network packets into "
+		  "a memory ring and show its statistics.",
+		  cmd_net_capture_ring),
+#endif
 	SHELL_SUBCMD_SET_END
 );
 
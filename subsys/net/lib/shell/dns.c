@@ -109,6 +109,17 @@ static void print_dns_info(const struct shell *sh,
 			   remaining);
 		}
 	}
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	struct dns_resolve_cache_stats stats;
+
+	if (dns_resolve_get_cache_stats(&stats) == 0) {
+		PR("Cache:\n");
+		PR("\thits %u stale %u negative %u misses %u refreshes %u\n",
+		   stats.hits, stats.stale_hits, stats.negative_hits, stats.misses,
+		   stats.refreshes);
+	}
+#endif
 }
 #endif
 
@@ -18,7 +18,8 @@ void ipv6_frag_cb(struct net_ipv6_reassembly *reass, void *user_data)
 	const struct shell *sh = data->sh;
 	int *count = data->user_data;
 	char src[ADDR_LEN];
-	int i;
+	sys_snode_t *node;
+	int i = 0;
 
 	if (!*count) {
 		PR("\nIPv6 reassembly Id         Remain "
@@ -31,23 +32,23 @@ void ipv6_frag_cb(struct net_ipv6_reassembly *reass, void *user_data)
 	   k_ticks_to_ms_ceil32(k_work_delayable_remaining_get(&reass->timer)),
 	   src, net_sprint_ipv6_addr(&reass->dst));
 
-	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_PKT; i++) {
-		if (reass->pkt[i]) {
-			struct net_buf *frag = reass->pkt[i]->frags;
+	SYS_SLIST_FOR_EACH_NODE(&reass->frags, node) {
+		struct net_pkt *pkt = CONTAINER_OF((intptr_t *)node,
+						   struct net_pkt, fifo);
+		struct net_buf *frag = pkt->frags;
 
-			PR("[%d] pkt %p->", i, reass->pkt[i]);
+		PR("[%d] pkt %p->", i++, pkt);
 
-			while (frag) {
-				PR("%p", frag);
+		while (frag) {
+			PR("%p", frag);
 
-				frag = frag->frags;
-				if (frag) {
-					PR("->");
-				}
+			frag = frag->frags;
+			if (frag) {
+				PR("->");
 			}
-
-			PR("\n");
 		}
+
+		PR("\n");
 	}
 
 	(*count)++;
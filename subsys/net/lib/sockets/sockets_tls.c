@@ -13,6 +13,7 @@ LOG_MODULE_REGISTER(net_sock_tls, CONFIG_NET_SOCKETS_LOG_LEVEL);
 
 #include <zephyr/init.h>
 #include <zephyr/sys/util.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/net/socket.h>
 #include <zephyr/random/random.h>
 #include <zephyr/internal/syscall_handler.h>
@@ -47,6 +48,8 @@ LOG_MODULE_REGISTER(net_sock_tls, CONFIG_NET_SOCKETS_LOG_LEVEL);
 #include <mbedtls/error.h>
 #include <mbedtls/platform.h>
 #include <mbedtls/ssl_cache.h>
+#include <mbedtls/ssl_ticket.h>
+#include <mbedtls/platform_util.h>
 #endif /* CONFIG_MBEDTLS */
 
 #include "sockets_internal.h"
@@ -221,6 +224,22 @@ __net_socket struct tls_context {
 
 	/** DTLS peer address length. */
 	socklen_t dtls_peer_addrlen;
+
+#if defined(CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID)
+	/** New peer address, seen on a record carrying our connection ID and
+	 *  adopted once the record is authenticated.
+	 */
+	struct sockaddr dtls_cid_peer_addr;
+
+	/** New peer address length, 0 if none pending. */
+	socklen_t dtls_cid_peer_addrlen;
+
+	/** Epoch and sequence number of the last received record. */
+	uint64_t dtls_rx_record_seq;
+
+	/** Highest epoch and sequence number of the authenticated records. */
+	uint64_t dtls_rx_max_seq;
+#endif
 #endif /* CONFIG_NET_SOCKETS_ENABLE_DTLS */
 
 #if defined(CONFIG_MBEDTLS)
@@ -254,6 +273,28 @@ static struct tls_session_cache client_cache[CONFIG_NET_SOCKETS_TLS_MAX_CLIENT_S
 static mbedtls_ssl_cache_context server_cache;
 #endif
 
+#if defined(CONFIG_NET_SOCKETS_TLS_SERVER_SESSION_TICKETS)
+#if defined(MBEDTLS_GCM_C)
+#define TICKET_CIPHER MBEDTLS_CIPHER_AES_128_GCM
+#define TICKET_KEY_LEN 16
+#elif defined(MBEDTLS_CCM_C)
+#define TICKET_CIPHER MBEDTLS_CIPHER_AES_128_CCM
+#define TICKET_KEY_LEN 16
+#else
+#define TICKET_CIPHER MBEDTLS_CIPHER_CHACHA20_POLY1305
+#define TICKET_KEY_LEN 32
+#endif
+
+#define TICKET_KEY_NAME_LEN 4
+#define TICKET_KEY_LIFETIME CONFIG_NET_SOCKETS_TLS_SESSION_TICKET_KEY_LIFETIME
+
+/* Keys protecting the session tickets, shared by all the server sockets. */
+static mbedtls_ssl_ticket_context ticket_ctx;
+static struct k_mutex ticket_lock;
+static int64_t ticket_key_time;
+static bool ticket_ready;
+#endif
+
 /* A mutex for protecting TLS context allocation. */
 static struct k_mutex context_lock;
 
@@ -373,6 +414,11 @@ static int tls_init(void)
 	mbedtls_ssl_cache_init(&server_cache);
 #endif
 
+#if defined(CONFIG_NET_SOCKETS_TLS_SERVER_SESSION_TICKETS)
+	mbedtls_ssl_ticket_init(&ticket_ctx);
+	k_mutex_init(&ticket_lock);
+#endif
+
 	return 0;
 }
 
@@ -721,6 +767,130 @@ exit:
 	mbedtls_ssl_session_free(&session);
 }
 
+#if defined(CONFIG_NET_SOCKETS_TLS_SERVER_SESSION_TICKETS)
+static int tls_session_ticket_key_rotate(void)
+{
+	unsigned char name[TICKET_KEY_NAME_LEN];
+	unsigned char key[TICKET_KEY_LEN];
+	int ret;
+
+	ret = tls_ctr_drbg_random(NULL, name, sizeof(name));
+	if (ret == 0) {
+		ret = tls_ctr_drbg_random(NULL, key, sizeof(key));
+	}
+
+	if (ret == 0) {
+		ret = mbedtls_ssl_ticket_rotate(&ticket_ctx, name, sizeof(name),
+						key, sizeof(key),
+						TICKET_KEY_LIFETIME);
+	}
+
+	mbedtls_platform_zeroize(key, sizeof(key));
+
+	return ret;
+}
+
+/* Set up the ticket keys on first use, and replace the active key once it
+ * has been used for TICKET_KEY_LIFETIME. mbedTLS keeps the previous key, so
+ * the tickets issued before a rotation can still be used for one period.
+ */
+static int tls_session_ticket_keys_update(void)
+{
+	int64_t now = k_uptime_get();
+	int ret = 0;
+
+	k_mutex_lock(&ticket_lock, K_FOREVER);
+
+	if (!ticket_ready) {
+		ret = mbedtls_ssl_ticket_setup(&ticket_ctx, tls_ctr_drbg_random,
+					       NULL, TICKET_CIPHER,
+					       TICKET_KEY_LIFETIME);
+		if (ret != 0) {
+			NET_ERR("Failed to set up session tickets, err: -0x%x",
+				-ret);
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		ticket_ready = true;
+		ticket_key_time = now;
+		goto out;
+	}
+
+	if (now - ticket_key_time < (int64_t)TICKET_KEY_LIFETIME * MSEC_PER_SEC) {
+		goto out;
+	}
+
+	ret = tls_session_ticket_key_rotate();
+	if (ret != 0) {
+		/* Keep using the current key and retry on next handshake. */
+		NET_WARN("Failed to rotate session ticket key, err: -0x%x",
+			 -ret);
+		ret = 0;
+		goto out;
+	}
+
+	ticket_key_time = now;
+
+out:
+	k_mutex_unlock(&ticket_lock);
+
+	return ret;
+}
+
+/* The ticket context is shared by the handshakes of all the server sockets
+ * and mbedTLS is built without threading support, so the ticket callbacks
+ * are serialized with the key updates.
+ */
+static int tls_session_ticket_write(void *p_ticket,
+				    const mbedtls_ssl_session *session,
+				    unsigned char *start,
+				    const unsigned char *end,
+				    size_t *tlen, uint32_t *lifetime)
+{
+	int ret;
+
+	k_mutex_lock(&ticket_lock, K_FOREVER);
+	ret = mbedtls_ssl_ticket_write(p_ticket, session, start, end, tlen,
+				       lifetime);
+	k_mutex_unlock(&ticket_lock);
+
+	return ret;
+}
+
+static int tls_session_ticket_parse(void *p_ticket,
+				    mbedtls_ssl_session *session,
+				    unsigned char *buf, size_t len)
+{
+	int ret;
+
+	k_mutex_lock(&ticket_lock, K_FOREVER);
+	ret = mbedtls_ssl_ticket_parse(p_ticket, session, buf, len);
+	k_mutex_unlock(&ticket_lock);
+
+	return ret;
+}
+
+static void tls_session_ticket_keys_reset(void)
+{
+	k_mutex_lock(&ticket_lock, K_FOREVER);
+
+	/* Replacing both the active and the previous key invalidates all the
+	 * tickets issued so far. The context itself is left in place, as it
+	 * may be referenced by the configuration of open sockets.
+	 */
+	if (ticket_ready &&
+	    (tls_session_ticket_key_rotate() != 0 ||
+	     tls_session_ticket_key_rotate() != 0)) {
+		NET_WARN("Failed to reset session ticket keys");
+	}
+
+	ticket_key_time = k_uptime_get();
+
+	k_mutex_unlock(&ticket_lock);
+}
+#endif /* CONFIG_NET_SOCKETS_TLS_SERVER_SESSION_TICKETS */
+
 static void tls_session_purge(void)
 {
 	tls_session_cache_reset();
@@ -729,6 +899,10 @@ static void tls_session_purge(void)
 	mbedtls_ssl_cache_free(&server_cache);
 	mbedtls_ssl_cache_init(&server_cache);
 #endif
+
+#if defined(CONFIG_NET_SOCKETS_TLS_SERVER_SESSION_TICKETS)
+	tls_session_ticket_keys_reset();
+#endif
 }
 
 static inline int time_left(uint32_t start, uint32_t timeout)
@@ -847,6 +1021,62 @@ static void dtls_peer_address_get(struct tls_context *context,
 	*addrlen = len;
 }
 
+#if defined(CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID)
+/* Type, version, epoch and sequence number precede the CID in a record. */
+#define DTLS_RECORD_SEQ_OFFSET 3
+#define DTLS_CID_RECORD_OFFSET 11
+
+static bool dtls_is_own_cid_record(struct tls_context *context,
+				   const unsigned char *buf, size_t len)
+{
+	size_t cid_len = context->options.dtls_cid.cid_len;
+
+	if (!context->options.dtls_cid.enabled || cid_len == 0 ||
+	    !is_handshake_complete(context)) {
+		return false;
+	}
+
+	if (len < DTLS_CID_RECORD_OFFSET + cid_len ||
+	    buf[0] != MBEDTLS_SSL_MSG_CID) {
+		return false;
+	}
+
+	return memcmp(buf + DTLS_CID_RECORD_OFFSET,
+		      context->options.dtls_cid.cid, cid_len) == 0;
+}
+
+/* Called once mbedTLS has authenticated a record, so that a peer whose
+ * address changed, typically behind a NAT, keeps its session (RFC 9146).
+ * Only a record newer than all the previous ones changes the address, so
+ * that a delayed or replayed datagram cannot redirect the session.
+ */
+static void dtls_cid_peer_address_update(struct tls_context *context)
+{
+	bool newer = context->dtls_rx_record_seq > context->dtls_rx_max_seq;
+
+	if (newer) {
+		context->dtls_rx_max_seq = context->dtls_rx_record_seq;
+	}
+
+	if (context->dtls_cid_peer_addrlen == 0) {
+		return;
+	}
+
+	if (!newer) {
+		NET_DBG("DTLS record on %p is not the newest, address kept",
+			context);
+		context->dtls_cid_peer_addrlen = 0;
+		return;
+	}
+
+	NET_DBG("DTLS peer address changed on %p", context);
+
+	dtls_peer_address_set(context, &context->dtls_cid_peer_addr,
+			      context->dtls_cid_peer_addrlen);
+	context->dtls_cid_peer_addrlen = 0;
+}
+#endif /* CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID */
+
 static int dtls_tx(void *ctx, const unsigned char *buf, size_t len)
 {
 	struct tls_context *tls_ctx = ctx;
@@ -884,6 +1114,12 @@ static int dtls_rx(void *ctx, unsigned char *buf, size_t len)
 		return MBEDTLS_ERR_NET_RECV_FAILED;
 	}
 
+#if defined(CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID)
+	/* Epoch and sequence number of the first record of the datagram */
+	tls_ctx->dtls_rx_record_seq = received >= DTLS_CID_RECORD_OFFSET ?
+		sys_get_be64(buf + DTLS_RECORD_SEQ_OFFSET) : 0;
+#endif
+
 	if (tls_ctx->dtls_peer_addrlen == 0) {
 		/* Only allow to store peer address for DTLS servers. */
 		if (tls_ctx->options.role == MBEDTLS_SSL_IS_SERVER) {
@@ -902,9 +1138,25 @@ static int dtls_rx(void *ctx, unsigned char *buf, size_t len)
 			return MBEDTLS_ERR_SSL_PEER_VERIFY_FAILED;
 		}
 	} else if (!dtls_is_peer_addr_valid(tls_ctx, &addr, addrlen)) {
+#if defined(CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID)
+		/* The record is passed to mbedTLS, which drops it if it
+		 * does not authenticate, the peer address is only updated
+		 * afterwards.
+		 */
+		if (dtls_is_own_cid_record(tls_ctx, buf, received)) {
+			memcpy(&tls_ctx->dtls_cid_peer_addr, &addr, addrlen);
+			tls_ctx->dtls_cid_peer_addrlen = addrlen;
+
+			return received;
+		}
+#endif
 		return MBEDTLS_ERR_SSL_WANT_READ;
 	}
 
+#if defined(CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID)
+	tls_ctx->dtls_cid_peer_addrlen = 0;
+#endif
+
 	return received;
 }
 #endif /* CONFIG_NET_SOCKETS_ENABLE_DTLS */
@@ -1178,6 +1430,11 @@ static int tls_mbedtls_reset(struct tls_context *context)
 			     sizeof(context->dtls_peer_addr));
 		context->dtls_peer_addrlen = 0;
 	}
+
+#if defined(CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID)
+	context->dtls_cid_peer_addrlen = 0;
+	context->dtls_rx_max_seq = 0;
+#endif
 #endif
 
 	return 0;
@@ -1418,6 +1675,20 @@ static int tls_mbedtls_init(struct tls_context *context, bool is_server)
 	}
 #endif
 
+#if defined(CONFIG_NET_SOCKETS_TLS_SERVER_SESSION_TICKETS)
+	if (is_server && context->options.cache_enabled) {
+		ret = tls_session_ticket_keys_update();
+		if (ret != 0) {
+			return ret;
+		}
+
+		mbedtls_ssl_conf_session_tickets_cb(&context->config,
+						    tls_session_ticket_write,
+						    tls_session_ticket_parse,
+						    &ticket_ctx);
+	}
+#endif
+
 	ret = mbedtls_ssl_setup(&context->ssl,
 				&context->config);
 	if (ret != 0) {
@@ -2710,6 +2981,10 @@ static ssize_t recvfrom_dtls_common(struct tls_context *ctx, void *buf,
 			}
 		}
 
+#if defined(CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID)
+		dtls_cid_peer_address_update(ctx);
+#endif
+
 		if (src_addr && addrlen) {
 			dtls_peer_address_get(ctx, src_addr, addrlen);
 		}
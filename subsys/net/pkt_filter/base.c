@@ -10,6 +10,8 @@ LOG_MODULE_REGISTER(npf_base, CONFIG_NET_PKT_FILTER_LOG_LEVEL);
 #include <zephyr/net/net_core.h>
 #include <zephyr/net/net_pkt_filter.h>
 #include <zephyr/spinlock.h>
+#include <zephyr/sys/atomic.h>
+#include <string.h>
 
 /*
  * Our actual rule lists for supported test points
@@ -119,10 +121,512 @@ static enum net_verdict evaluate(sys_slist_t *rule_head, struct net_pkt *pkt)
 	return NET_DROP;
 }
 
+#ifdef CONFIG_NET_PKT_FILTER_COMPILE
+
+/*
+ * Rule list compilation
+ */
+
+enum npf_field {
+	NPF_FIELD_NONE,
+	NPF_FIELD_IFACE,
+	NPF_FIELD_ORIG_IFACE,
+	NPF_FIELD_ETH_TYPE,
+	NPF_FIELD_ETH_SRC,
+	NPF_FIELD_ETH_DST,
+	NPF_FIELD_IPV4_SRC,
+	NPF_FIELD_IPV6_SRC,
+};
+
+/* One step of a compiled rule list. It is either a single rule that is
+ * evaluated by calling its tests, or a run of consecutive rules that all
+ * test the same packet field for an exact value, in which case the field
+ * value is looked up from the key table.
+ */
+struct npf_prog_step {
+	struct npf_rule *rule;
+	uint16_t cond;
+	uint16_t nb_conds;
+	uint8_t field;
+};
+
+/* Condition of a merged rule, and where its values were copied from */
+struct npf_prog_cond {
+	struct npf_test *test;
+	const uint8_t *values;
+	uint16_t len;
+	uint16_t offset;
+};
+
+/* Key table entry, the key is a value copied to the program data */
+struct npf_prog_key {
+	uint16_t offset;
+	uint8_t len;
+	uint8_t step;
+	uint8_t result;
+};
+
+/* Largest value, an IPv6 address */
+#define NPF_PROG_VALUE_SIZE sizeof(struct in6_addr)
+
+BUILD_ASSERT(sizeof(struct net_if *) <= NPF_PROG_VALUE_SIZE);
+
+struct npf_prog {
+	struct npf_prog_step steps[CONFIG_NET_PKT_FILTER_COMPILE_MAX_STEPS];
+	struct npf_prog_cond conds[CONFIG_NET_PKT_FILTER_COMPILE_MAX_KEYS];
+	struct npf_prog_key keys[2 * CONFIG_NET_PKT_FILTER_COMPILE_MAX_KEYS];
+	uint8_t data[CONFIG_NET_PKT_FILTER_COMPILE_MAX_KEYS * NPF_PROG_VALUE_SIZE];
+	uint16_t nb_steps;
+};
+
+static struct npf_prog progs[CONFIG_NET_PKT_FILTER_COMPILE_MAX_LISTS];
+static ATOMIC_DEFINE(progs_used, CONFIG_NET_PKT_FILTER_COMPILE_MAX_LISTS);
+
+static struct npf_prog *prog_alloc(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(progs); i++) {
+		if (!atomic_test_and_set_bit(progs_used, i)) {
+			return &progs[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void prog_free(struct npf_prog *prog)
+{
+	atomic_clear_bit(progs_used, prog - progs);
+}
+
+static uint32_t prog_hash(const uint8_t *key, uint8_t len, uint8_t step)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261U ^ step;
+
+	for (uint8_t i = 0; i < len; i++) {
+		hash = (hash ^ key[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+static struct npf_prog_key *prog_find_key(struct npf_prog *prog,
+					  const uint8_t *key, uint8_t len,
+					  uint8_t step)
+{
+	uint32_t i = prog_hash(key, len, step) % ARRAY_SIZE(prog->keys);
+
+	/* There are always free entries, so the probing ends */
+	while (prog->keys[i].len != 0) {
+		if (prog->keys[i].step == step && prog->keys[i].len == len &&
+		    memcmp(prog->data + prog->keys[i].offset, key, len) == 0) {
+			break;
+		}
+
+		i = (i + 1) % ARRAY_SIZE(prog->keys);
+	}
+
+	return &prog->keys[i];
+}
+
+static bool prog_add_key(struct npf_prog *prog, size_t *nb_keys,
+			 uint16_t offset, uint8_t len, struct npf_rule *rule)
+{
+	struct npf_prog_key *entry;
+
+	entry = prog_find_key(prog, prog->data + offset, len, prog->nb_steps - 1);
+	if (entry->len != 0) {
+		/* An earlier rule has the same value, it wins */
+		return true;
+	}
+
+	if (*nb_keys == CONFIG_NET_PKT_FILTER_COMPILE_MAX_KEYS) {
+		return false;
+	}
+
+	entry->offset = offset;
+	entry->len = len;
+	entry->step = prog->nb_steps - 1;
+	entry->result = rule->result;
+	(*nb_keys)++;
+
+	return true;
+}
+
+#ifdef CONFIG_NET_L2_ETHERNET
+static bool eth_mask_is_exact(struct npf_test_eth_addr *test_eth_addr)
+{
+	for (int i = 0; i < sizeof(test_eth_addr->mask.addr); i++) {
+		if (test_eth_addr->mask.addr[i] != 0xff) {
+			return false;
+		}
+	}
+
+	return true;
+}
+#endif /* CONFIG_NET_L2_ETHERNET */
+
+/* Field that a single condition rule tests for an exact value */
+static enum npf_field rule_field(struct npf_rule *rule)
+{
+	struct npf_test *test;
+
+	if (rule->nb_tests != 1) {
+		return NPF_FIELD_NONE;
+	}
+
+	test = rule->tests[0];
+
+	if (test->fn == npf_iface_match) {
+		return NPF_FIELD_IFACE;
+	}
+
+	if (test->fn == npf_orig_iface_match) {
+		return NPF_FIELD_ORIG_IFACE;
+	}
+
+	if (test->fn == npf_ip_src_addr_match) {
+		struct npf_test_ip *test_ip =
+				CONTAINER_OF(test, struct npf_test_ip, test);
+
+		if (IS_ENABLED(CONFIG_NET_IPV4) && test_ip->addr_family == AF_INET) {
+			return NPF_FIELD_IPV4_SRC;
+		}
+
+		if (IS_ENABLED(CONFIG_NET_IPV6) && test_ip->addr_family == AF_INET6) {
+			return NPF_FIELD_IPV6_SRC;
+		}
+
+		return NPF_FIELD_NONE;
+	}
+
+#ifdef CONFIG_NET_L2_ETHERNET
+	if (test->fn == npf_eth_type_match) {
+		return NPF_FIELD_ETH_TYPE;
+	}
+
+	if (test->fn == npf_eth_src_addr_match || test->fn == npf_eth_dst_addr_match) {
+		/* Masked addresses cannot be looked up */
+		if (!eth_mask_is_exact(CONTAINER_OF(test, struct npf_test_eth_addr, test))) {
+			return NPF_FIELD_NONE;
+		}
+
+		return test->fn == npf_eth_src_addr_match ?
+			NPF_FIELD_ETH_SRC : NPF_FIELD_ETH_DST;
+	}
+#endif /* CONFIG_NET_L2_ETHERNET */
+
+	return NPF_FIELD_NONE;
+}
+
+static uint8_t field_len(enum npf_field field)
+{
+	switch (field) {
+	case NPF_FIELD_IFACE:
+	case NPF_FIELD_ORIG_IFACE:
+		return sizeof(struct net_if *);
+	case NPF_FIELD_IPV4_SRC:
+		return sizeof(struct in_addr);
+	case NPF_FIELD_IPV6_SRC:
+		return sizeof(struct in6_addr);
+#ifdef CONFIG_NET_L2_ETHERNET
+	case NPF_FIELD_ETH_TYPE:
+		return sizeof(uint16_t);
+	case NPF_FIELD_ETH_SRC:
+	case NPF_FIELD_ETH_DST:
+		return sizeof(struct net_eth_addr);
+#endif /* CONFIG_NET_L2_ETHERNET */
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Values that the condition of a merged rule looks for, false if the
+ * condition is no longer an exact match on the field.
+ */
+static bool cond_values(enum npf_field field, struct npf_test *test,
+			const uint8_t **values, size_t *len)
+{
+	switch (field) {
+	case NPF_FIELD_IFACE:
+	case NPF_FIELD_ORIG_IFACE: {
+		struct npf_test_iface *test_iface =
+				CONTAINER_OF(test, struct npf_test_iface, test);
+
+		*values = (uint8_t *)&test_iface->iface;
+		*len = sizeof(test_iface->iface);
+		return true;
+	}
+	case NPF_FIELD_IPV4_SRC:
+	case NPF_FIELD_IPV6_SRC: {
+		struct npf_test_ip *test_ip =
+				CONTAINER_OF(test, struct npf_test_ip, test);
+
+		if (test_ip->addr_family !=
+		    (field == NPF_FIELD_IPV4_SRC ? AF_INET : AF_INET6)) {
+			return false;
+		}
+
+		*values = test_ip->ipaddr;
+		*len = test_ip->ipaddr_num * field_len(field);
+		return true;
+	}
+#ifdef CONFIG_NET_L2_ETHERNET
+	case NPF_FIELD_ETH_TYPE: {
+		struct npf_test_eth_type *test_eth_type =
+				CONTAINER_OF(test, struct npf_test_eth_type, test);
+
+		*values = (uint8_t *)&test_eth_type->type;
+		*len = sizeof(test_eth_type->type);
+		return true;
+	}
+	case NPF_FIELD_ETH_SRC:
+	case NPF_FIELD_ETH_DST: {
+		struct npf_test_eth_addr *test_eth_addr =
+				CONTAINER_OF(test, struct npf_test_eth_addr, test);
+
+		if (!eth_mask_is_exact(test_eth_addr)) {
+			return false;
+		}
+
+		*values = (uint8_t *)test_eth_addr->addresses;
+		*len = test_eth_addr->nb_addresses * sizeof(struct net_eth_addr);
+		return true;
+	}
+#endif /* CONFIG_NET_L2_ETHERNET */
+	default:
+		return false;
+	}
+}
+
+/* Copy the values of a merged rule to the program and add them as keys */
+static bool prog_add_rule(struct npf_prog *prog, size_t *nb_conds,
+			  size_t *data_len, size_t *nb_keys,
+			  enum npf_field field, struct npf_rule *rule)
+{
+	struct npf_prog_cond *cond;
+	const uint8_t *values;
+	size_t len;
+
+	if (*nb_conds == ARRAY_SIZE(prog->conds) ||
+	    !cond_values(field, rule->tests[0], &values, &len) ||
+	    len > sizeof(prog->data) - *data_len) {
+		return false;
+	}
+
+	cond = &prog->conds[(*nb_conds)++];
+	cond->test = rule->tests[0];
+	cond->values = values;
+	cond->len = len;
+	cond->offset = *data_len;
+
+	memcpy(prog->data + cond->offset, values, len);
+	*data_len += len;
+
+	for (size_t pos = 0; pos < len; pos += field_len(field)) {
+		if (!prog_add_key(prog, nb_keys, cond->offset + pos,
+				  field_len(field), rule)) {
+			return false;
+		}
+	}
+
+	prog->steps[prog->nb_steps - 1].nb_conds++;
+
+	return true;
+}
+
+/* The values of a lookup step are still the ones that were compiled */
+static bool prog_step_is_current(struct npf_prog *prog, struct npf_prog_step *step)
+{
+	for (uint16_t i = step->cond; i < step->cond + step->nb_conds; i++) {
+		struct npf_prog_cond *cond = &prog->conds[i];
+		const uint8_t *values;
+		size_t len;
+
+		if (!cond_values(step->field, cond->test, &values, &len) ||
+		    values != cond->values || len != cond->len ||
+		    memcmp(values, prog->data + cond->offset, len) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Called with the rule list locked whenever the list changes, or when the
+ * conditions of the rules were modified. Lookup steps return the result of
+ * the first rule of the run having the packet field value, which is what
+ * evaluating the rules one by one would give, as a packet has only one
+ * value for the field.
+ */
+static void compile(struct npf_rule_list *rules)
+{
+	struct npf_prog *prog = rules->prog;
+	struct npf_rule *rule;
+	size_t nb_conds = 0;
+	size_t data_len = 0;
+	size_t nb_keys = 0;
+
+	if (sys_slist_is_empty(&rules->rule_head)) {
+		goto release;
+	}
+
+	if (prog == NULL) {
+		prog = prog_alloc();
+		if (prog == NULL) {
+			NET_DBG("no program for rules %p, evaluating them one by one",
+				rules);
+			return;
+		}
+	}
+
+	memset(prog, 0, sizeof(*prog));
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&rules->rule_head, rule, node) {
+		enum npf_field field = rule_field(rule);
+
+		if (field == NPF_FIELD_NONE || prog->nb_steps == 0 ||
+		    prog->steps[prog->nb_steps - 1].field != field) {
+			if (prog->nb_steps == ARRAY_SIZE(prog->steps)) {
+				goto fail;
+			}
+
+			prog->steps[prog->nb_steps].rule = rule;
+			prog->steps[prog->nb_steps].cond = nb_conds;
+			prog->steps[prog->nb_steps].field = field;
+			prog->nb_steps++;
+		}
+
+		if (field != NPF_FIELD_NONE &&
+		    !prog_add_rule(prog, &nb_conds, &data_len, &nb_keys, field, rule)) {
+			goto fail;
+		}
+	}
+
+	NET_DBG("rules %p: %u steps, %zu keys", rules, prog->nb_steps, nb_keys);
+
+	rules->prog = prog;
+	return;
+
+fail:
+	NET_DBG("rules %p do not fit, evaluating them one by one", rules);
+
+release:
+	if (prog != NULL) {
+		prog_free(prog);
+	}
+
+	rules->prog = NULL;
+}
+
+/* Packet field value, NULL if the packet does not have the field */
+static const uint8_t *pkt_field(struct net_pkt *pkt, enum npf_field field,
+				struct net_if **iface)
+{
+	switch (field) {
+	case NPF_FIELD_IFACE:
+	case NPF_FIELD_ORIG_IFACE:
+		*iface = field == NPF_FIELD_IFACE ? net_pkt_iface(pkt) :
+			 net_pkt_orig_iface(pkt);
+		return (uint8_t *)iface;
+	case NPF_FIELD_IPV4_SRC:
+		if (net_pkt_family(pkt) != AF_INET) {
+			return NULL;
+		}
+
+		return NET_IPV4_HDR(pkt)->src;
+	case NPF_FIELD_IPV6_SRC:
+		if (net_pkt_family(pkt) != AF_INET6) {
+			return NULL;
+		}
+
+		return NET_IPV6_HDR(pkt)->src;
+#ifdef CONFIG_NET_L2_ETHERNET
+	case NPF_FIELD_ETH_TYPE:
+		return (uint8_t *)&NET_ETH_HDR(pkt)->type;
+	case NPF_FIELD_ETH_SRC:
+		return NET_ETH_HDR(pkt)->src.addr;
+	case NPF_FIELD_ETH_DST:
+		return NET_ETH_HDR(pkt)->dst.addr;
+#endif /* CONFIG_NET_L2_ETHERNET */
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Returns false, without a verdict, if the conditions of a lookup step were
+ * modified since the rule list was compiled.
+ */
+static bool run(struct npf_prog *prog, struct net_pkt *pkt, enum net_verdict *result)
+{
+	for (uint16_t i = 0; i < prog->nb_steps; i++) {
+		struct npf_prog_step *step = &prog->steps[i];
+		struct npf_prog_key *entry;
+		const uint8_t *value;
+		struct net_if *iface;
+
+		if (step->field == NPF_FIELD_NONE) {
+			if (apply_tests(step->rule, pkt)) {
+				*result = step->rule->result;
+				return true;
+			}
+
+			continue;
+		}
+
+		if (!prog_step_is_current(prog, step)) {
+			NET_DBG("step %u of prog %p modified", i, prog);
+			return false;
+		}
+
+		value = pkt_field(pkt, step->field, &iface);
+		if (value == NULL) {
+			continue;
+		}
+
+		entry = prog_find_key(prog, value, field_len(step->field), i);
+		if (entry->len != 0) {
+			NET_DBG("step %u matched", i);
+			*result = entry->result;
+			return true;
+		}
+	}
+
+	NET_DBG("no matching rules in prog %p", prog);
+	*result = NET_DROP;
+	return true;
+}
+
+#else
+#define compile(...)
+#endif /* CONFIG_NET_PKT_FILTER_COMPILE */
+
 static enum net_verdict lock_evaluate(struct npf_rule_list *rules, struct net_pkt *pkt)
 {
 	k_spinlock_key_t key = k_spin_lock(&rules->lock);
-	enum net_verdict result = evaluate(&rules->rule_head, pkt);
+	enum net_verdict result;
+
+#ifdef CONFIG_NET_PKT_FILTER_COMPILE
+	if (rules->prog != NULL) {
+		bool done = run(rules->prog, pkt, &result);
+
+		if (!done) {
+			/* The rule conditions were modified, compile them again */
+			compile(rules);
+			done = rules->prog != NULL && run(rules->prog, pkt, &result);
+		}
+
+		if (done) {
+			k_spin_unlock(&rules->lock, key);
+			return result;
+		}
+	}
+#endif
+
+	result = evaluate(&rules->rule_head, pkt);
 
 	k_spin_unlock(&rules->lock, key);
 	return result;
@@ -177,6 +681,7 @@ void npf_insert_rule(struct npf_rule_list *rules, struct npf_rule *rule)
 
 	NET_DBG("inserting rule %p into %p", rule, rules);
 	sys_slist_prepend(&rules->rule_head, &rule->node);
+	compile(rules);
 
 	k_spin_unlock(&rules->lock, key);
 }
@@ -190,6 +695,7 @@ void npf_append_rule(struct npf_rule_list *rules, struct npf_rule *rule)
 
 	NET_DBG("appending rule %p into %p", rule, rules);
 	sys_slist_append(&rules->rule_head, &rule->node);
+	compile(rules);
 
 	k_spin_unlock(&rules->lock, key);
 }
@@ -199,6 +705,10 @@ bool npf_remove_rule(struct npf_rule_list *rules, struct npf_rule *rule)
 	k_spinlock_key_t key = k_spin_lock(&rules->lock);
 	bool result = sys_slist_find_and_remove(&rules->rule_head, &rule->node);
 
+	if (result) {
+		compile(rules);
+	}
+
 	k_spin_unlock(&rules->lock, key);
 	NET_DBG("removing rule %p from %p: %d", rule, rules, result);
 	return result;
@@ -211,6 +721,7 @@ bool npf_remove_all_rules(struct npf_rule_list *rules)
 
 	if (result) {
 		sys_slist_init(&rules->rule_head);
+		compile(rules);
 		NET_DBG("removing all rules from %p", rules);
 	}
 
@@ -297,3 +808,18 @@ bool npf_ip_src_addr_unmatch(struct npf_test *test, struct net_pkt *pkt)
 {
 	return !npf_ip_src_addr_match(test, pkt);
 }
+
+#ifdef CONFIG_NET_CONNTRACK
+bool npf_ct_state_match(struct npf_test *test, struct net_pkt *pkt)
+{
+	struct npf_test_ct_state *test_ct =
+			CONTAINER_OF(test, struct npf_test_ct_state, test);
+
+	return net_conntrack_get_state(pkt) == test_ct->state;
+}
+
+bool npf_ct_state_unmatch(struct npf_test *test, struct net_pkt *pkt)
+{
+	return !npf_ct_state_match(test, pkt);
+}
+#endif /* CONFIG_NET_CONNTRACK */
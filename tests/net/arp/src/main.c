@@ -26,6 +26,7 @@ LOG_MODULE_REGISTER(net_test, CONFIG_NET_ARP_LOG_LEVEL);
 #include <zephyr/net/dummy.h>
 #include <zephyr/ztest.h>
 #include <zephyr/random/random.h>
+#include <zephyr/timing/timing.h>
 
 #include "arp.h"
 
@@ -45,6 +46,8 @@ static struct net_eth_addr eth_hwaddr = { { 0x42, 0x11, 0x69, 0xde, 0xfa, 0xec }
 
 static int send_status = -EINVAL;
 
+static int ip_sent_count;
+
 struct net_arp_context {
 	uint8_t mac_addr[sizeof(struct net_eth_addr)];
 	struct net_linkaddr ll_addr;
@@ -142,6 +145,8 @@ static int tester_send(const struct device *dev, struct net_pkt *pkt)
 				return send_status;
 			}
 		}
+	} else if (ntohs(hdr->type) == NET_ETH_PTYPE_IP) {
+		ip_sent_count++;
 	}
 
 	send_status = 0;
@@ -648,4 +653,168 @@ ZTEST(arp_fn_tests, test_arp)
 	}
 }
 
+static struct net_if *arp_test_iface_setup(void)
+{
+	struct in_addr src = { { { 192, 168, 0, 1 } } };
+	struct in_addr netmask = { { { 255, 255, 255, 0 } } };
+	struct net_if_addr *ifaddr;
+	struct net_if *iface;
+
+	net_arp_init();
+
+	iface = net_if_lookup_by_dev(DEVICE_GET(net_arp_test));
+
+	if (!net_if_ipv4_addr_lookup(&src, NULL)) {
+		ifaddr = net_if_ipv4_addr_add(iface, &src, NET_ADDR_MANUAL, 0);
+		zassert_not_null(ifaddr, "Cannot add address");
+		ifaddr->addr_state = NET_ADDR_PREFERRED;
+
+		net_if_ipv4_set_netmask_by_addr(iface, &src, &netmask);
+	}
+
+	net_arp_clear_cache(iface);
+
+	return iface;
+}
+
+static struct net_pkt *arp_test_ipv4_pkt(struct net_if *iface,
+					 struct in_addr *dst)
+{
+	struct in_addr src = { { { 192, 168, 0, 1 } } };
+	struct net_ipv4_hdr *ipv4;
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_alloc_with_buffer(iface, sizeof(struct net_ipv4_hdr),
+					AF_INET, 0, K_SECONDS(1));
+	zassert_not_null(pkt, "out of mem");
+
+	ipv4 = (struct net_ipv4_hdr *)net_buf_add(pkt->buffer,
+						  sizeof(struct net_ipv4_hdr));
+	(void)memset(ipv4, 0, sizeof(*ipv4));
+	net_ipv4_addr_copy_raw(ipv4->src, (uint8_t *)&src);
+	net_ipv4_addr_copy_raw(ipv4->dst, (uint8_t *)dst);
+
+	return pkt;
+}
+
+#define ARP_PENDING_PKTS 6
+
+ZTEST(arp_fn_tests, test_arp_pending_batch)
+{
+	struct in_addr dst = { { { 192, 168, 0, 60 } } };
+	struct net_pkt *pkts[ARP_PENDING_PKTS];
+	struct net_pkt *req;
+	struct net_if *iface;
+
+	iface = arp_test_iface_setup();
+	req_test = true;
+
+	for (int i = 0; i < ARRAY_SIZE(pkts); i++) {
+		pkts[i] = arp_test_ipv4_pkt(iface, &dst);
+
+		req = net_arp_prepare(pkts[i], &dst, NULL);
+		if (i == 0) {
+			/* The first packet triggers the request */
+			zassert_not_null(req, "No ARP request");
+			zassert_not_equal(req, pkts[i], "Destination already known");
+			net_pkt_unref(req);
+		} else {
+			/* The others wait for the same resolution */
+			zassert_is_null(req, "Unexpected ARP request");
+		}
+
+		zassert_equal(atomic_get(&pkts[i]->atomic_ref), 2,
+			      "ARP cache should own the packet");
+	}
+
+	ip_sent_count = 0;
+
+	/* A single reply releases all the waiting packets */
+	net_arp_update(iface, &dst, &eth_hwaddr, false, false);
+
+	zassert_equal(ip_sent_count, ARRAY_SIZE(pkts),
+		      "Pending packets were not all sent");
+
+	for (int i = 0; i < ARRAY_SIZE(pkts); i++) {
+		zassert_equal(atomic_get(&pkts[i]->atomic_ref), 1,
+			      "ARP cache should no longer own the packet");
+		net_pkt_unref(pkts[i]);
+	}
+
+	/* Following packets are sent right away */
+	pkts[0] = arp_test_ipv4_pkt(iface, &dst);
+	zassert_equal_ptr(net_arp_prepare(pkts[0], &dst, NULL), pkts[0],
+			  "Destination not resolved");
+	zassert_mem_equal(net_pkt_lladdr_dst(pkts[0])->addr, &eth_hwaddr,
+			  sizeof(eth_hwaddr), "Wrong destination");
+	net_pkt_unref(pkts[0]);
+
+	net_arp_clear_cache(iface);
+}
+
+#define ARP_LOOKUPS 1000
+
+static void arp_measure_lookup(struct net_if *iface, int neighbours)
+{
+	struct in_addr dst[CONFIG_NET_ARP_TABLE_SIZE];
+	struct net_eth_addr hwaddr = eth_hwaddr;
+	timing_t start, end;
+	struct net_pkt *pkt;
+	uint64_t ns;
+
+	net_arp_clear_cache(iface);
+
+	for (int i = 0; i < neighbours; i++) {
+		dst[i].s4_addr[0] = 192;
+		dst[i].s4_addr[1] = 168;
+		dst[i].s4_addr[2] = 0;
+		dst[i].s4_addr[3] = 100 + i;
+
+		hwaddr.addr[5] = i;
+		net_arp_update(iface, &dst[i], &hwaddr, false, true);
+	}
+
+	pkt = arp_test_ipv4_pkt(iface, &dst[0]);
+
+	for (int i = 0; i < neighbours; i++) {
+		zassert_equal_ptr(net_arp_prepare(pkt, &dst[i], NULL), pkt,
+				  "Neighbour %d not found", i);
+		zassert_equal(net_pkt_lladdr_dst(pkt)->addr[5], i,
+			      "Wrong neighbour %d", i);
+	}
+
+	start = timing_counter_get();
+
+	for (int i = 0; i < ARP_LOOKUPS; i++) {
+		(void)net_arp_prepare(pkt, &dst[i % neighbours], NULL);
+	}
+
+	end = timing_counter_get();
+
+	ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+
+	TC_PRINT("%2d neighbours: %llu ns per lookup\n", neighbours,
+		 ns / ARP_LOOKUPS);
+
+	net_pkt_unref(pkt);
+}
+
+ZTEST(arp_fn_tests, test_arp_tx_overhead)
+{
+	struct net_if *iface;
+
+	iface = arp_test_iface_setup();
+
+	timing_init();
+	timing_start();
+
+	for (int n = 1; n <= CONFIG_NET_ARP_TABLE_SIZE; n *= 2) {
+		arp_measure_lookup(iface, n);
+	}
+
+	timing_stop();
+
+	net_arp_clear_cache(iface);
+}
+
 ZTEST_SUITE(arp_fn_tests, NULL, NULL, NULL, NULL, NULL);
@@ -17,6 +17,7 @@ LOG_MODULE_REGISTER(net_test, NET_LOG_LEVEL);
 #include <zephyr/sys/printk.h>
 
 #include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
 
 #include <zephyr/net/net_if.h>
 #include <zephyr/net/ethernet.h>
@@ -31,10 +32,15 @@ LOG_MODULE_REGISTER(net_test, NET_LOG_LEVEL);
 struct eth_fake_context {
 	struct net_if *iface;
 	struct net_pkt *sent_pkt;
+	struct net_pkt *last_pkt;
+	int sent_count;
 	uint8_t mac_address[6];
 	bool promisc_mode;
 };
 
+/* Only count the sent packets, used when measuring the throughput */
+static bool count_only;
+
 static void eth_fake_iface_init(struct net_if *iface)
 {
 	const struct device *dev = net_if_get_device(iface);
@@ -71,6 +77,13 @@ static int eth_fake_send(const struct device *dev,
 		return 0;
 	}
 
+	ctx->last_pkt = pkt;
+	ctx->sent_count++;
+
+	if (count_only) {
+		return 0;
+	}
+
 	if (ctx->sent_pkt != NULL) {
 		DBG("Fake send found pkt %p while sending %p\n",
 		    ctx->sent_pkt, pkt);
@@ -99,10 +112,10 @@ static int eth_fake_set_config(const struct device *dev,
 
 	switch (type) {
 	case ETHERNET_CONFIG_TYPE_PROMISC_MODE:
-		if (config->promisc_mode == ctx->promisc_mode) {
-			return -EALREADY;
-		}
-
+		/*
+		 * Interfaces are added to the bridge again by later tests,
+		 * and removing them does not leave promiscuous mode.
+		 */
 		ctx->promisc_mode = config->promisc_mode;
 
 		break;
@@ -220,17 +233,34 @@ static void test_iface_setup(void)
 /*
  * Simulate a packet reception from the outside world
  */
-static void _recv_data(struct net_if *iface)
+static struct net_pkt *recv_frame(struct net_if *iface,
+				  const struct net_eth_hdr *eth_hdr)
 {
-	struct net_pkt *pkt;
-	struct net_eth_hdr eth_hdr;
 	static uint8_t data[] = { 't', 'e', 's', 't', '\0' };
+	struct net_pkt *pkt;
 	int ret;
 
-	pkt = net_pkt_rx_alloc_with_buffer(iface, sizeof(eth_hdr) + sizeof(data),
+	pkt = net_pkt_rx_alloc_with_buffer(iface, sizeof(*eth_hdr) + sizeof(data),
 					   AF_UNSPEC, 0, K_FOREVER);
 	zassert_not_null(pkt, "");
 
+	ret = net_pkt_write(pkt, eth_hdr, sizeof(*eth_hdr));
+	zassert_equal(ret, 0, "");
+
+	ret = net_pkt_write(pkt, data, sizeof(data));
+	zassert_equal(ret, 0, "");
+
+	DBG("Fake recv pkt %p\n", pkt);
+	ret = net_recv_data(iface, pkt);
+	zassert_equal(ret, 0, "");
+
+	return pkt;
+}
+
+static void _recv_data(struct net_if *iface)
+{
+	struct net_eth_hdr eth_hdr;
+
 	/*
 	 * The source and destination MAC addresses are completely arbitrary
 	 * except for the U/L and I/G bits. However, the index of the faked
@@ -254,15 +284,7 @@ static void _recv_data(struct net_if *iface)
 
 	eth_hdr.type = htons(NET_ETH_PTYPE_ALL);
 
-	ret = net_pkt_write(pkt, &eth_hdr, sizeof(eth_hdr));
-	zassert_equal(ret, 0, "");
-
-	ret = net_pkt_write(pkt, data, sizeof(data));
-	zassert_equal(ret, 0, "");
-
-	DBG("Fake recv pkt %p\n", pkt);
-	ret = net_recv_data(iface, pkt);
-	zassert_equal(ret, 0, "");
+	(void)recv_frame(iface, &eth_hdr);
 }
 
 static void test_recv_before_bridging(void)
@@ -370,11 +392,230 @@ static void test_recv_after_bridging(void)
 
 ZTEST(net_eth_bridge, test_net_eth_bridge)
 {
-	test_iface_setup();
 	test_recv_before_bridging();
 	test_setup_bridge();
 	test_recv_with_bridge();
 	test_recv_after_bridging();
 }
 
-ZTEST_SUITE(net_eth_bridge, NULL, NULL, NULL, NULL, NULL);
+#define STATION_BROADCAST 0xff
+
+/* Stations are identified by the last byte of their MAC address */
+static void set_eth_hdr(struct net_eth_hdr *hdr, uint8_t src, uint8_t dst)
+{
+	static const uint8_t base[] = { 0x02, 0x00, 0x5e, 0x10, 0x00 };
+
+	memcpy(hdr->src.addr, base, sizeof(base));
+	hdr->src.addr[5] = src;
+
+	if (dst == STATION_BROADCAST) {
+		memset(hdr->dst.addr, 0xff, sizeof(hdr->dst.addr));
+	} else {
+		memcpy(hdr->dst.addr, base, sizeof(base));
+		hdr->dst.addr[5] = dst;
+	}
+
+	hdr->type = htons(NET_ETH_PTYPE_ALL);
+}
+
+static struct net_pkt *send_frame(int from, uint8_t src, uint8_t dst)
+{
+	struct net_eth_hdr eth_hdr;
+	struct net_pkt *pkt;
+
+	set_eth_hdr(&eth_hdr, src, dst);
+	pkt = recv_frame(fake_iface[from], &eth_hdr);
+
+	/* give time to the processing threads to run */
+	k_sleep(K_MSEC(100));
+
+	return pkt;
+}
+
+static void check_sent(bool on0, bool on1, bool on2)
+{
+	bool expected[] = { on0, on1, on2 };
+
+	for (int i = 0; i < ARRAY_SIZE(expected); i++) {
+		struct net_pkt *pkt = eth_fake_data[i].sent_pkt;
+
+		if (!expected[i]) {
+			zassert_is_null(pkt, "Unexpected pkt sent on iface %d", i);
+			continue;
+		}
+
+		zassert_not_null(pkt, "No pkt sent on iface %d", i);
+		eth_fake_data[i].sent_pkt = NULL;
+		net_pkt_unref(pkt);
+	}
+}
+
+static void bridge_add_all(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(fake_iface); i++) {
+		zassert_equal(eth_bridge_iface_add(&test_bridge, fake_iface[i]), 0, "");
+		zassert_equal(eth_bridge_iface_allow_tx(fake_iface[i], true), 0, "");
+	}
+}
+
+static void bridge_remove_all(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(fake_iface); i++) {
+		(void)eth_bridge_iface_remove(&test_bridge, fake_iface[i]);
+	}
+}
+
+#if defined(CONFIG_NET_ETHERNET_BRIDGE_FDB)
+ZTEST(net_eth_bridge, test_net_eth_bridge_fdb)
+{
+	struct eth_bridge_listener listener;
+	struct net_pkt *pkt;
+
+	bridge_add_all();
+
+	/* Station 2 is not known yet, flood */
+	send_frame(0, 1, 2);
+	check_sent(false, true, true);
+
+	/* Station 1 was learned on iface 0, station 2 on iface 1 */
+	pkt = send_frame(1, 2, 1);
+	check_sent(true, false, false);
+	zassert_equal_ptr(eth_fake_data[0].last_pkt, pkt,
+			  "Unicast pkt was cloned");
+
+	send_frame(2, 3, 1);
+	check_sent(true, false, false);
+
+	send_frame(0, 1, 2);
+	check_sent(false, true, false);
+
+	/* Broadcast is always flooded */
+	send_frame(0, 1, STATION_BROADCAST);
+	check_sent(false, true, true);
+
+	/* Station 1 is on the same segment as iface 0, filter */
+	send_frame(0, 4, 1);
+	check_sent(false, false, false);
+
+	/* Listeners still get a copy of the unicast frames */
+	k_fifo_init(&listener.pkt_queue);
+	eth_bridge_listener_add(&test_bridge, &listener);
+
+	send_frame(1, 2, 3);
+	check_sent(false, false, true);
+
+	pkt = k_fifo_get(&listener.pkt_queue, K_NO_WAIT);
+	zassert_not_null(pkt, "Listener did not get the pkt");
+	net_pkt_unref(pkt);
+
+	eth_bridge_listener_remove(&test_bridge, &listener);
+
+	/* Station 1 moves to iface 2 */
+	send_frame(2, 1, 2);
+	check_sent(false, true, false);
+
+	send_frame(1, 2, 1);
+	check_sent(false, false, true);
+
+	/* Addresses learned on a removed interface are forgotten */
+	zassert_equal(eth_bridge_iface_remove(&test_bridge, fake_iface[2]), 0, "");
+
+	send_frame(1, 2, 1);
+	check_sent(true, false, false);
+
+	/* Addresses are forgotten after the ageing time */
+	zassert_equal(eth_bridge_iface_add(&test_bridge, fake_iface[2]), 0, "");
+	zassert_equal(eth_bridge_iface_allow_tx(fake_iface[2], true), 0, "");
+
+	send_frame(2, 3, 2);
+	check_sent(false, true, false);
+
+	k_sleep(K_SECONDS(CONFIG_NET_ETHERNET_BRIDGE_FDB_AGEING_TIME));
+
+	send_frame(0, 1, 3);
+	check_sent(false, true, true);
+
+	bridge_remove_all();
+
+	check_free_packet_count();
+}
+#endif /* CONFIG_NET_ETHERNET_BRIDGE_FDB */
+
+#define THROUGHPUT_FRAMES 1000
+
+static void measure_throughput(const char *name, uint8_t dst, int egress)
+{
+	struct net_eth_hdr eth_hdr;
+	timing_t start, end;
+	uint64_t ns;
+	int base[ARRAY_SIZE(eth_fake_data)];
+	int sent = 0;
+
+	for (int i = 0; i < ARRAY_SIZE(eth_fake_data); i++) {
+		base[i] = eth_fake_data[i].sent_count;
+	}
+
+	set_eth_hdr(&eth_hdr, 1, dst);
+
+	start = timing_counter_get();
+
+	for (int i = 0; i < THROUGHPUT_FRAMES; i++) {
+		/* Allocation blocks until the pool has been refilled */
+		(void)recv_frame(fake_iface[0], &eth_hdr);
+	}
+
+	while (sent < THROUGHPUT_FRAMES * egress) {
+		k_sleep(K_TICKS(1));
+
+		sent = 0;
+		for (int i = 0; i < ARRAY_SIZE(eth_fake_data); i++) {
+			sent += eth_fake_data[i].sent_count - base[i];
+		}
+	}
+
+	end = timing_counter_get();
+
+	zassert_equal(sent, THROUGHPUT_FRAMES * egress, "Unexpected sent count");
+
+	ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+
+	TC_PRINT("%s: %d frames in %llu ns (%llu frames/s)\n", name,
+		 THROUGHPUT_FRAMES, ns,
+		 ns > 0 ? (uint64_t)THROUGHPUT_FRAMES * NSEC_PER_SEC / ns : 0);
+}
+
+ZTEST(net_eth_bridge, test_net_eth_bridge_throughput)
+{
+	bridge_add_all();
+
+	count_only = true;
+
+	timing_init();
+	timing_start();
+
+	measure_throughput("flood", 2, 2);
+
+	if (IS_ENABLED(CONFIG_NET_ETHERNET_BRIDGE_FDB)) {
+		/* Learn station 2 on iface 1 */
+		send_frame(1, 2, 1);
+
+		measure_throughput("unicast", 2, 1);
+	}
+
+	timing_stop();
+
+	count_only = false;
+
+	bridge_remove_all();
+
+	check_free_packet_count();
+}
+
+static void *bridge_setup(void)
+{
+	test_iface_setup();
+
+	return NULL;
+}
+
+ZTEST_SUITE(net_eth_bridge, NULL, bridge_setup, NULL, NULL, NULL);
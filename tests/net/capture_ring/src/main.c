@@ -0,0 +1,281 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_CAPTURE_RING_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <zephyr/ztest.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/capture.h>
+
+#define REC_HDR_LEN sizeof(struct net_capture_pcap_rec_hdr)
+#define SNAPLEN CONFIG_NET_CAPTURE_RING_SNAPLEN
+
+static struct net_if *iface1;
+static struct net_if *iface2;
+
+static uint8_t read_buf[CONFIG_NET_CAPTURE_RING_SIZE];
+static size_t consumed;
+
+struct capture_ring_test {
+	uint8_t mac_addr[6];
+};
+
+static int capture_ring_dev_init(const struct device *dev)
+{
+	return 0;
+}
+
+static void capture_ring_iface_init(struct net_if *iface)
+{
+	struct capture_ring_test *data = net_if_get_device(iface)->data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[0] = 0x00;
+	data->mac_addr[1] = 0x00;
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[3] = 0x00;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = net_if_get_by_iface(iface);
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_DUMMY);
+}
+
+static int tester_send(const struct device *dev, struct net_pkt *pkt)
+{
+	return 0;
+}
+
+static struct capture_ring_test capture_ring_data1;
+static struct capture_ring_test capture_ring_data2;
+
+static struct dummy_api capture_ring_if_api = {
+	.iface_api.init = capture_ring_iface_init,
+	.send = tester_send,
+};
+
+NET_DEVICE_INIT_INSTANCE(capture_ring_test1, "capture_ring_test1", iface1,
+			 capture_ring_dev_init, NULL,
+			 &capture_ring_data1, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &capture_ring_if_api, DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+NET_DEVICE_INIT_INSTANCE(capture_ring_test2, "capture_ring_test2", iface2,
+			 capture_ring_dev_init, NULL,
+			 &capture_ring_data2, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &capture_ring_if_api, DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+static void *setup(void)
+{
+	iface1 = net_if_get_by_index(1);
+	iface2 = net_if_get_by_index(2);
+
+	zassert_not_null(iface1, "Interface 1 missing");
+	zassert_not_null(iface2, "Interface 2 missing");
+
+	return NULL;
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	(void)net_capture_ring_disable();
+	zassert_ok(net_capture_ring_enable(NULL), "Cannot enable ring");
+}
+
+static void after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	(void)net_capture_ring_disable();
+}
+
+/* Capture a packet whose byte at offset i is (seed + i) */
+static void capture(struct net_if *iface, size_t len, uint8_t seed)
+{
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_alloc_with_buffer(iface, len, AF_UNSPEC, 0, K_NO_WAIT);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	for (size_t i = 0; i < len; i++) {
+		uint8_t byte = seed + i;
+
+		zassert_ok(net_pkt_write_u8(pkt, byte), "Cannot write pkt");
+	}
+
+	net_capture_pkt(iface, pkt);
+
+	net_pkt_unref(pkt);
+}
+
+static void check_record(const uint8_t *rec_buf, size_t orig_len, uint8_t seed)
+{
+	struct net_capture_pcap_rec_hdr rec;
+
+	memcpy(&rec, rec_buf, sizeof(rec));
+
+	zassert_equal(rec.orig_len, orig_len, "Wrong original length %u",
+		      rec.orig_len);
+	zassert_equal(rec.incl_len, MIN(orig_len, SNAPLEN),
+		      "Wrong included length %u", rec.incl_len);
+	zassert_true(rec.ts_usec < USEC_PER_SEC, "Invalid timestamp");
+
+	for (size_t i = 0; i < rec.incl_len; i++) {
+		zassert_equal(rec_buf[REC_HDR_LEN + i], (uint8_t)(seed + i),
+			      "Wrong data at offset %zu", i);
+	}
+}
+
+ZTEST(net_capture_ring, test_capture_ring_header)
+{
+	struct net_capture_pcap_hdr hdr;
+
+	net_capture_ring_pcap_header(&hdr);
+
+	zassert_equal(hdr.magic, 0xa1b2c3d4, "Wrong magic");
+	zassert_equal(hdr.version_major, 2, "Wrong major version");
+	zassert_equal(hdr.version_minor, 4, "Wrong minor version");
+	zassert_equal(hdr.snaplen, SNAPLEN, "Wrong snaplen");
+	zassert_equal(hdr.linktype, 101, "Wrong link type %u", hdr.linktype);
+
+	zassert_equal(net_capture_ring_enable(NULL), -EALREADY,
+		      "Ring enabled twice");
+}
+
+ZTEST(net_capture_ring, test_capture_ring_read)
+{
+	struct net_capture_ring_stats stats;
+	int ret;
+
+	capture(iface1, 20, 0x10);
+	capture(iface2, SNAPLEN + 30, 0x80);
+
+	net_capture_ring_stats_get(&stats);
+	zassert_equal(stats.captured, 2, "Wrong captured count");
+	zassert_equal(stats.truncated, 1, "Wrong truncated count");
+	zassert_equal(stats.dropped, 0, "Wrong dropped count");
+
+	/* The first record does not fit */
+	ret = net_capture_ring_read(read_buf, REC_HDR_LEN + 19);
+	zassert_equal(ret, -EMSGSIZE, "Record read partially (%d)", ret);
+
+	/* Only the first record fits */
+	ret = net_capture_ring_read(read_buf, REC_HDR_LEN + 20 + REC_HDR_LEN);
+	zassert_equal(ret, REC_HDR_LEN + 20, "Wrong read length %d", ret);
+	check_record(read_buf, 20, 0x10);
+
+	ret = net_capture_ring_read(read_buf, sizeof(read_buf));
+	zassert_equal(ret, REC_HDR_LEN + SNAPLEN, "Wrong read length %d", ret);
+	check_record(read_buf, SNAPLEN + 30, 0x80);
+
+	ret = net_capture_ring_read(read_buf, sizeof(read_buf));
+	zassert_equal(ret, 0, "Ring not empty (%d)", ret);
+}
+
+ZTEST(net_capture_ring, test_capture_ring_iface)
+{
+	int ret;
+
+	(void)net_capture_ring_disable();
+	zassert_ok(net_capture_ring_enable(iface2), "Cannot enable ring");
+
+	capture(iface1, 10, 0x01);
+	capture(iface2, 12, 0x02);
+
+	ret = net_capture_ring_read(read_buf, sizeof(read_buf));
+	zassert_equal(ret, REC_HDR_LEN + 12, "Wrong read length %d", ret);
+	check_record(read_buf, 12, 0x02);
+
+	(void)net_capture_ring_disable();
+
+	capture(iface2, 12, 0x03);
+
+	ret = net_capture_ring_read(read_buf, sizeof(read_buf));
+	zassert_equal(ret, 0, "Packet captured while disabled (%d)", ret);
+}
+
+ZTEST(net_capture_ring, test_capture_ring_full)
+{
+	struct net_capture_ring_stats stats;
+	size_t rec_len = REC_HDR_LEN + SNAPLEN;
+	size_t fit = CONFIG_NET_CAPTURE_RING_SIZE / rec_len;
+	int ret;
+
+	for (size_t i = 0; i < fit + 2; i++) {
+		capture(iface1, SNAPLEN, i);
+	}
+
+	net_capture_ring_stats_get(&stats);
+	zassert_equal(stats.captured, fit, "Wrong captured count");
+	zassert_equal(stats.dropped, 2, "Wrong dropped count");
+
+	ret = net_capture_ring_read(read_buf, sizeof(read_buf));
+	zassert_equal(ret, fit * rec_len, "Wrong read length %d", ret);
+
+	for (size_t i = 0; i < fit; i++) {
+		check_record(read_buf + i * rec_len, SNAPLEN, i);
+	}
+
+	/* Space is available again once the records are read */
+	capture(iface1, 8, 0x42);
+
+	net_capture_ring_stats_get(&stats);
+	zassert_equal(stats.captured, fit + 1, "Wrong captured count");
+}
+
+static int consume_cb(const uint8_t *data, size_t len, void *user_data)
+{
+	uint8_t *buf = user_data;
+
+	zassert_true(consumed + len <= sizeof(read_buf), "Too much data");
+
+	memcpy(buf + consumed, data, len);
+	consumed += len;
+
+	return 0;
+}
+
+ZTEST(net_capture_ring, test_capture_ring_consume)
+{
+	size_t rec_len = REC_HDR_LEN + 40;
+	int ret;
+
+	/* Wrap the ring around so that the data is given in two parts */
+	for (int round = 0; round < 3; round++) {
+		consumed = 0;
+
+		capture(iface1, 40, 0x20 + round);
+		capture(iface2, 40, 0x40 + round);
+		capture(iface1, 40, 0x60 + round);
+
+		ret = net_capture_ring_consume(consume_cb, read_buf);
+		zassert_equal(ret, 3 * rec_len, "Wrong consumed length %d", ret);
+		zassert_equal(consumed, 3 * rec_len, "Wrong consumed length");
+
+		check_record(read_buf, 40, 0x20 + round);
+		check_record(read_buf + rec_len, 40, 0x40 + round);
+		check_record(read_buf + 2 * rec_len, 40, 0x60 + round);
+	}
+
+	ret = net_capture_ring_consume(consume_cb, read_buf);
+	zassert_equal(ret, 0, "Ring not empty (%d)", ret);
+}
+
+ZTEST_SUITE(net_capture_ring, NULL, setup, before, after, NULL);
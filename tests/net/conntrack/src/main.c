@@ -0,0 +1,557 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_CONNTRACK_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zephyr/tc_util.h>
+
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/icmp.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/net_pkt_filter.h>
+#include <zephyr/net/conntrack.h>
+
+#include "net_private.h"
+#include "route.h"
+#include "conntrack.h"
+
+#define WAIT_TIME K_MSEC(250)
+
+#define IP_HDR_LEN sizeof(struct net_ipv4_hdr)
+#define MAX_HDR_LEN (IP_HDR_LEN + sizeof(struct net_tcp_hdr))
+#define PAYLOAD_LEN 4
+
+#define BENCH_FLOWS 64
+#define BENCH_PKTS 10000
+
+static struct in_addr addr1 = { { { 192, 0, 2, 1 } } };
+static struct in_addr addr2 = { { { 198, 51, 100, 1 } } };
+static struct in_addr netmask = { { { 255, 255, 255, 0 } } };
+static struct in_addr gw2 = { { { 198, 51, 100, 254 } } };
+static struct in_addr host1 = { { { 192, 0, 2, 10 } } };
+static struct in_addr host2 = { { { 192, 0, 2, 11 } } };
+static struct in_addr remote = { { { 203, 0, 113, 5 } } };
+
+static struct net_if *iface1;
+static struct net_if *iface2;
+
+static K_SEM_DEFINE(wait_data, 0, UINT_MAX);
+static uint8_t sent_data[MAX_HDR_LEN];
+static struct net_if *sent_iface;
+static bool sent_chksum_ok;
+
+struct conntrack_test {
+	uint8_t mac_addr[6];
+};
+
+static int conntrack_dev_init(const struct device *dev)
+{
+	return 0;
+}
+
+static void conntrack_iface_init(struct net_if *iface)
+{
+	struct conntrack_test *data = net_if_get_device(iface)->data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[0] = 0x00;
+	data->mac_addr[1] = 0x00;
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[3] = 0x00;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = net_if_get_by_iface(iface);
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_DUMMY);
+}
+
+static bool l4_chksum_ok(struct net_pkt *pkt, uint8_t proto)
+{
+	switch (proto) {
+	case IPPROTO_TCP:
+		return net_calc_chksum_tcp(pkt) == 0U;
+	case IPPROTO_UDP:
+		return net_calc_verify_chksum_udp(pkt) == 0U;
+	case IPPROTO_ICMP:
+		return net_calc_chksum_icmpv4(pkt) == 0U;
+	}
+
+	return false;
+}
+
+static int tester_send(const struct device *dev, struct net_pkt *pkt)
+{
+	size_t len = MIN(net_pkt_get_len(pkt), sizeof(sent_data));
+
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_read(pkt, sent_data, len) < 0) {
+		return -EINVAL;
+	}
+
+	sent_iface = net_pkt_iface(pkt);
+	sent_chksum_ok = net_calc_chksum_ipv4(pkt) == 0U &&
+			 l4_chksum_ok(pkt, NET_IPV4_HDR(pkt)->proto);
+
+	k_sem_give(&wait_data);
+
+	return 0;
+}
+
+static struct conntrack_test conntrack_data1;
+static struct conntrack_test conntrack_data2;
+
+static struct dummy_api conntrack_if_api = {
+	.iface_api.init = conntrack_iface_init,
+	.send = tester_send,
+};
+
+NET_DEVICE_INIT_INSTANCE(conntrack_test1, "conntrack_test1", iface1,
+			 conntrack_dev_init, NULL,
+			 &conntrack_data1, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &conntrack_if_api, DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+NET_DEVICE_INIT_INSTANCE(conntrack_test2, "conntrack_test2", iface2,
+			 conntrack_dev_init, NULL,
+			 &conntrack_data2, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &conntrack_if_api, DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+static void *setup(void)
+{
+	struct in_addr any = { 0 };
+
+	STRUCT_SECTION_FOREACH(net_if, iface) {
+		if (net_if_get_device(iface)->data == &conntrack_data1) {
+			iface1 = iface;
+		} else if (net_if_get_device(iface)->data == &conntrack_data2) {
+			iface2 = iface;
+		}
+	}
+
+	zassert_not_null(iface1, "No first interface");
+	zassert_not_null(iface2, "No second interface");
+
+	zassert_not_null(net_if_ipv4_addr_add(iface1, &addr1, NET_ADDR_MANUAL, 0),
+			 "Cannot add address");
+	zassert_not_null(net_if_ipv4_addr_add(iface2, &addr2, NET_ADDR_MANUAL, 0),
+			 "Cannot add address");
+	zassert_true(net_if_ipv4_set_netmask_by_addr(iface1, &addr1, &netmask),
+		     "Cannot set netmask");
+	zassert_true(net_if_ipv4_set_netmask_by_addr(iface2, &addr2, &netmask),
+		     "Cannot set netmask");
+
+	zassert_not_null(net_route_ipv4_add(iface2, &any, 0, &gw2),
+			 "Cannot add default route");
+
+	return NULL;
+}
+
+static void after(void *arg)
+{
+	ARG_UNUSED(arg);
+
+	(void)net_napt_disable(iface2);
+	(void)npf_remove_all_ipv4_recv_rules();
+	net_conntrack_flush();
+	k_sem_reset(&wait_data);
+}
+
+/* Write the IPv4 and layer 4 headers of a packet to buf. For ICMP a
+ * non-zero source port is the identifier of an echo request, otherwise
+ * the destination port is the identifier of an echo reply.
+ */
+static size_t build_hdrs(uint8_t *buf, uint8_t proto,
+			 const struct in_addr *src, uint16_t src_port,
+			 const struct in_addr *dst, uint16_t dst_port)
+{
+	struct net_ipv4_hdr *hdr = (struct net_ipv4_hdr *)buf;
+	uint8_t *l4 = buf + IP_HDR_LEN;
+	size_t l4_len;
+
+	memset(buf, 0, MAX_HDR_LEN);
+
+	if (proto == IPPROTO_TCP) {
+		struct net_tcp_hdr *tcp = (struct net_tcp_hdr *)l4;
+
+		tcp->src_port = htons(src_port);
+		tcp->dst_port = htons(dst_port);
+		tcp->offset = (sizeof(*tcp) / 4) << 4;
+		tcp->flags = 0x10;
+		l4_len = sizeof(*tcp);
+	} else if (proto == IPPROTO_UDP) {
+		struct net_udp_hdr *udp = (struct net_udp_hdr *)l4;
+
+		udp->src_port = htons(src_port);
+		udp->dst_port = htons(dst_port);
+		udp->len = htons(sizeof(*udp) + PAYLOAD_LEN);
+		l4_len = sizeof(*udp);
+	} else {
+		struct net_icmp_hdr *icmp = (struct net_icmp_hdr *)l4;
+		uint16_t id = src_port ? src_port : dst_port;
+
+		icmp->type = src_port ? NET_ICMPV4_ECHO_REQUEST :
+					NET_ICMPV4_ECHO_REPLY;
+		UNALIGNED_PUT(htons(id), (uint16_t *)(icmp + 1));
+		l4_len = sizeof(*icmp) + 4;
+	}
+
+	hdr->vhl = 0x45;
+	hdr->len = htons(IP_HDR_LEN + l4_len + PAYLOAD_LEN);
+	hdr->ttl = 64;
+	hdr->proto = proto;
+	net_ipv4_addr_copy_raw(hdr->src, (const uint8_t *)src);
+	net_ipv4_addr_copy_raw(hdr->dst, (const uint8_t *)dst);
+
+	return IP_HDR_LEN + l4_len;
+}
+
+static void set_chksums(struct net_pkt *pkt, uint8_t proto)
+{
+	uint8_t *l4 = pkt->buffer->data + IP_HDR_LEN;
+
+	net_pkt_set_ip_hdr_len(pkt, IP_HDR_LEN);
+	NET_IPV4_HDR(pkt)->chksum = net_calc_chksum_ipv4(pkt);
+
+	if (proto == IPPROTO_TCP) {
+		((struct net_tcp_hdr *)l4)->chksum = net_calc_chksum_tcp(pkt);
+	} else if (proto == IPPROTO_UDP) {
+		((struct net_udp_hdr *)l4)->chksum = net_calc_chksum_udp(pkt);
+	} else {
+		((struct net_icmp_hdr *)l4)->chksum = net_calc_chksum_icmpv4(pkt);
+	}
+}
+
+static struct net_pkt *prepare_pkt(struct net_if *iface, uint8_t proto,
+				   const struct in_addr *src, uint16_t src_port,
+				   const struct in_addr *dst, uint16_t dst_port)
+{
+	static const uint8_t payload[PAYLOAD_LEN] = { 'd', 'a', 't', 'a' };
+	uint8_t buf[MAX_HDR_LEN];
+	struct net_pkt *pkt;
+	size_t len;
+
+	len = build_hdrs(buf, proto, src, src_port, dst, dst_port);
+
+	pkt = net_pkt_alloc_with_buffer(iface, len + sizeof(payload), AF_INET,
+					proto, K_NO_WAIT);
+	zassert_not_null(pkt, "Cannot allocate packet");
+
+	zassert_ok(net_pkt_write(pkt, buf, len), "");
+	zassert_ok(net_pkt_write(pkt, payload, sizeof(payload)), "");
+
+	set_chksums(pkt, proto);
+
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+static void inject(struct net_if *iface, uint8_t proto,
+		   const struct in_addr *src, uint16_t src_port,
+		   const struct in_addr *dst, uint16_t dst_port)
+{
+	struct net_pkt *pkt = prepare_pkt(iface, proto, src, src_port,
+					  dst, dst_port);
+
+	if (net_recv_data(iface, pkt) < 0) {
+		net_pkt_unref(pkt);
+		zassert_unreachable("Data receive failed");
+	}
+}
+
+static struct net_ipv4_hdr *sent_ip(void)
+{
+	return (struct net_ipv4_hdr *)sent_data;
+}
+
+/* Source or destination port, or the ICMP echo identifier */
+static uint16_t sent_port(bool src)
+{
+	uint8_t *l4 = sent_data + IP_HDR_LEN;
+
+	if (sent_ip()->proto == IPPROTO_ICMP) {
+		return ntohs(UNALIGNED_GET((uint16_t *)(l4 + 4)));
+	}
+
+	return ntohs(UNALIGNED_GET((uint16_t *)(l4 + (src ? 0 : 2))));
+}
+
+static void expect_sent(struct net_if *iface, const struct in_addr *src,
+			uint16_t src_port, const struct in_addr *dst,
+			uint16_t dst_port)
+{
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not forwarded");
+	zassert_equal_ptr(sent_iface, iface, "Sent via wrong interface");
+	zassert_true(sent_chksum_ok, "Invalid checksum");
+
+	if (src != NULL) {
+		zassert_mem_equal(sent_ip()->src, src, sizeof(*src),
+				  "Wrong source address");
+	}
+
+	if (src_port != 0U) {
+		zassert_equal(sent_port(true), src_port, "Wrong source port");
+	}
+
+	if (dst != NULL) {
+		zassert_mem_equal(sent_ip()->dst, dst, sizeof(*dst),
+				  "Wrong destination address");
+	}
+
+	if (dst_port != 0U) {
+		zassert_equal(sent_port(false), dst_port,
+			      "Wrong destination port");
+	}
+}
+
+static void expect_not_sent(const char *msg)
+{
+	zassert_equal(k_sem_take(&wait_data, WAIT_TIME), -EAGAIN, "%s", msg);
+}
+
+struct conn_info {
+	struct net_conntrack_tuple orig;
+	struct net_conntrack_tuple reply;
+};
+
+static void get_conn(const struct net_conntrack_tuple *orig,
+		     const struct net_conntrack_tuple *reply,
+		     void *user_data)
+{
+	struct conn_info *info = user_data;
+
+	info->orig = *orig;
+	info->reply = *reply;
+}
+
+ZTEST(net_conntrack, test_track)
+{
+	struct conn_info info;
+
+	inject(iface1, IPPROTO_UDP, &host1, 1000, &remote, 53);
+	expect_sent(iface2, &host1, 1000, &remote, 53);
+
+	zassert_equal(net_conntrack_foreach(get_conn, &info), 1,
+		      "Connection not tracked");
+	zassert_true(net_ipv4_addr_cmp(&info.orig.src, &host1), "");
+	zassert_true(net_ipv4_addr_cmp(&info.orig.dst, &remote), "");
+	zassert_equal(info.orig.src_port, htons(1000), "");
+	zassert_equal(info.orig.dst_port, htons(53), "");
+	zassert_true(net_ipv4_addr_cmp(&info.reply.src, &remote), "");
+	zassert_true(net_ipv4_addr_cmp(&info.reply.dst, &host1), "");
+	zassert_equal(info.reply.src_port, htons(53), "");
+	zassert_equal(info.reply.dst_port, htons(1000), "");
+
+	/* The reply belongs to the same connection */
+	inject(iface2, IPPROTO_UDP, &remote, 53, &host1, 1000);
+	expect_sent(iface1, &remote, 53, &host1, 1000);
+
+	zassert_equal(net_conntrack_foreach(get_conn, &info), 1,
+		      "Reply created a connection");
+}
+
+ZTEST(net_conntrack, test_napt_udp)
+{
+	struct conn_info info;
+	struct net_pkt *pkt;
+	uint16_t port2;
+
+	zassert_ok(net_napt_enable(iface2), "Cannot enable NAPT");
+
+	/* The source port is kept when possible */
+	inject(iface1, IPPROTO_UDP, &host1, 1000, &remote, 53);
+	expect_sent(iface2, &addr2, 1000, &remote, 53);
+
+	/* Same port to the same destination from another host */
+	inject(iface1, IPPROTO_UDP, &host2, 1000, &remote, 53);
+	expect_sent(iface2, &addr2, 0, &remote, 53);
+
+	port2 = sent_port(true);
+	zassert_not_equal(port2, 1000, "Port not translated");
+	zassert_true(port2 >= CONFIG_NET_NAPT_PORT_MIN, "Port out of range");
+
+	inject(iface2, IPPROTO_UDP, &remote, 53, &addr2, 1000);
+	expect_sent(iface1, &remote, 53, &host1, 1000);
+
+	inject(iface2, IPPROTO_UDP, &remote, 53, &addr2, port2);
+	expect_sent(iface1, &remote, 53, &host2, 1000);
+
+	/* Not a reply to any connection, this is for us. There is no socket
+	 * so the stack answers with port unreachable.
+	 */
+	inject(iface2, IPPROTO_UDP, &remote, 53, &addr2, port2 + 1);
+	expect_sent(iface2, &addr2, 0, &remote, 0);
+	zassert_equal(sent_ip()->proto, IPPROTO_ICMP, "Unknown packet forwarded");
+
+	/* Fragments are not reassembled, so they cannot be translated */
+	pkt = prepare_pkt(iface1, IPPROTO_UDP, &host1, 1000, &remote, 53);
+	NET_IPV4_HDR(pkt)->offset[0] = NET_IPV4_MORE_FRAG_MASK >> 8;
+	NET_IPV4_HDR(pkt)->chksum = 0U;
+	NET_IPV4_HDR(pkt)->chksum = net_calc_chksum_ipv4(pkt);
+
+	if (net_recv_data(iface1, pkt) < 0) {
+		net_pkt_unref(pkt);
+		zassert_unreachable("Data receive failed");
+	}
+
+	expect_not_sent("Fragment forwarded");
+
+	zassert_equal(net_conntrack_foreach(get_conn, &info), 2,
+		      "Wrong number of connections");
+}
+
+ZTEST(net_conntrack, test_napt_tcp_icmp)
+{
+	struct conn_info info;
+
+	zassert_ok(net_napt_enable(iface2), "Cannot enable NAPT");
+
+	inject(iface1, IPPROTO_TCP, &host1, 2000, &remote, 80);
+	expect_sent(iface2, &addr2, 2000, &remote, 80);
+
+	inject(iface2, IPPROTO_TCP, &remote, 80, &addr2, 2000);
+	expect_sent(iface1, &remote, 80, &host1, 2000);
+
+	/* Echo request and reply */
+	inject(iface1, IPPROTO_ICMP, &host1, 0x1234, &remote, 0);
+	expect_sent(iface2, &addr2, 0x1234, &remote, 0);
+
+	inject(iface2, IPPROTO_ICMP, &remote, 0, &addr2, 0x1234);
+	expect_sent(iface1, &remote, 0, &host1, 0x1234);
+
+	/* Same identifier from another host */
+	inject(iface1, IPPROTO_ICMP, &host2, 0x1234, &remote, 0);
+	expect_sent(iface2, &addr2, 0, &remote, 0);
+	zassert_not_equal(sent_port(true), 0x1234, "Identifier not translated");
+
+	zassert_ok(net_napt_disable(iface2), "Cannot disable NAPT");
+	zassert_equal(net_conntrack_foreach(get_conn, &info), 0,
+		      "Translated connections not removed");
+	zassert_equal(net_napt_disable(iface2), -ENOENT, "");
+}
+
+ZTEST(net_conntrack, test_timeout)
+{
+	struct conn_info info;
+
+	inject(iface1, IPPROTO_UDP, &host1, 1000, &remote, 53);
+	expect_sent(iface2, &host1, 1000, &remote, 53);
+
+	zassert_equal(net_conntrack_foreach(get_conn, &info), 1,
+		      "Connection not tracked");
+
+	k_sleep(K_SECONDS(CONFIG_NET_CONNTRACK_UDP_TIMEOUT + 1));
+
+	zassert_equal(net_conntrack_foreach(get_conn, &info), 0,
+		      "Idle connection not removed");
+}
+
+static NPF_IFACE_MATCH(wan_iface, NULL);
+static NPF_CT_STATE_MATCH(ct_new, NET_CONNTRACK_NEW);
+static NPF_RULE(drop_new_from_wan, NET_DROP, wan_iface, ct_new);
+
+ZTEST(net_conntrack, test_pkt_filter)
+{
+	wan_iface.iface = iface2;
+	npf_append_ipv4_recv_rule(&drop_new_from_wan);
+	npf_append_ipv4_recv_rule(&npf_default_ok);
+
+	inject(iface2, IPPROTO_UDP, &remote, 53, &host1, 3000);
+	expect_not_sent("New connection from WAN forwarded");
+
+	inject(iface1, IPPROTO_UDP, &host1, 3000, &remote, 53);
+	expect_sent(iface2, &host1, 3000, &remote, 53);
+
+	inject(iface2, IPPROTO_UDP, &remote, 53, &host1, 3000);
+	expect_sent(iface1, &remote, 53, &host1, 3000);
+}
+
+ZTEST(net_conntrack, test_translation_throughput)
+{
+	static const int counts[] = { 1, 16, BENCH_FLOWS };
+	static uint8_t hdrs[BENCH_FLOWS][MAX_HDR_LEN];
+	uint64_t cycles, cycles_ref;
+	struct net_ipv4_hdr *hdr;
+	struct conn_info info;
+	timing_t start, end;
+	struct net_pkt *pkt;
+	size_t len = 0;
+
+	zassert_ok(net_napt_enable(iface2), "Cannot enable NAPT");
+
+	pkt = prepare_pkt(iface1, IPPROTO_UDP, &host1, 1000, &remote, 53);
+	hdr = NET_IPV4_HDR(pkt);
+
+	/* Header templates of the flows, with valid checksums */
+	for (int i = 0; i < BENCH_FLOWS; i++) {
+		len = build_hdrs(pkt->buffer->data, IPPROTO_UDP, &host1,
+				 10000 + i, &remote, 53);
+		set_chksums(pkt, IPPROTO_UDP);
+		memcpy(hdrs[i], pkt->buffer->data, len);
+
+		zassert_ok(net_conntrack_ipv4_forward(pkt, hdr, iface2),
+			   "Cannot track flow");
+	}
+
+	timing_init();
+	timing_start();
+
+	for (int c = 0; c < ARRAY_SIZE(counts); c++) {
+		int flows = counts[c];
+
+		/* Restoring the headers alone, to be subtracted */
+		start = timing_counter_get();
+		for (int i = 0; i < BENCH_PKTS; i++) {
+			memcpy(pkt->buffer->data, hdrs[i % flows], len);
+			compiler_barrier();
+		}
+		end = timing_counter_get();
+		cycles_ref = timing_cycles_get(&start, &end);
+
+		start = timing_counter_get();
+		for (int i = 0; i < BENCH_PKTS; i++) {
+			memcpy(pkt->buffer->data, hdrs[i % flows], len);
+			(void)net_conntrack_ipv4_forward(pkt, hdr, iface2);
+		}
+		end = timing_counter_get();
+		cycles = timing_cycles_get(&start, &end);
+		cycles = cycles > cycles_ref ? cycles - cycles_ref : 0;
+
+		TC_PRINT("%d flows, %d packets: %llu ns, %llu packets per second\n",
+			 flows, BENCH_PKTS, timing_cycles_to_ns(cycles),
+			 timing_cycles_to_ns(cycles) == 0 ? 0ULL :
+			 (uint64_t)BENCH_PKTS * NSEC_PER_SEC /
+			 timing_cycles_to_ns(cycles));
+	}
+
+	timing_stop();
+
+	/* The last packet was translated correctly */
+	zassert_mem_equal(hdr->src, &addr2, sizeof(addr2), "Not translated");
+	zassert_equal(net_calc_chksum_ipv4(pkt), 0U, "Invalid checksum");
+	zassert_equal(net_calc_verify_chksum_udp(pkt), 0U, "Invalid checksum");
+	zassert_equal(net_conntrack_foreach(get_conn, &info), BENCH_FLOWS,
+		      "Packets created connections");
+
+	net_pkt_unref(pkt);
+}
+
+ZTEST_SUITE(net_conntrack, NULL, setup, NULL, after, NULL);
@@ -0,0 +1,503 @@
+/* main.c - Generic receive offload tests */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_GRO_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/timing/timing.h>
+
+#include <zephyr/ztest.h>
+
+#include <zephyr/net/ethernet.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+
+#include "connection.h"
+#include "net_private.h"
+
+#define TEST_PORT 4242
+#define PEER_PORT 5353
+#define PEER_PORT2 5454
+
+#define SEG_LEN 256
+#define MAX_RECV 32
+
+#define TCP_PSH 0x08
+#define TCP_ACK 0x10
+
+#define BENCH_ROUNDS 64
+#define BENCH_BATCH CONFIG_NET_GRO_BATCH_SIZE
+
+static struct in_addr my_addr4 = { { { 192, 0, 2, 1 } } };
+static uint8_t peer_addr4[] = { 192, 0, 2, 2 };
+
+static struct in6_addr my_addr6 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static uint8_t peer_addr6[] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				0, 0, 0, 0, 0, 0, 0, 0x2 };
+
+static uint8_t peer_mac[] = { 0x00, 0x00, 0x5E, 0x00, 0x53, 0x02 };
+
+struct eth_context {
+	uint8_t mac_addr[6];
+};
+
+static struct eth_context eth_ctx;
+static struct net_if *test_iface;
+
+static struct net_conn_handle *conn4;
+static struct net_conn_handle *conn6;
+
+struct recv_info {
+	uint32_t seq;
+	size_t len;
+	bool data_ok;
+	bool chksum_verified;
+	bool clone_chksum_verified;
+};
+
+static struct recv_info received[MAX_RECV];
+static int recv_count;
+
+static uint8_t frame[NET_ETH_MTU + sizeof(struct net_eth_hdr)];
+
+static void eth_iface_init(struct net_if *iface)
+{
+	const struct device *dev = net_if_get_device(iface);
+	struct eth_context *context = dev->data;
+
+	net_if_set_link_addr(iface, context->mac_addr,
+			     sizeof(context->mac_addr),
+			     NET_LINK_ETHERNET);
+
+	ethernet_init(iface);
+}
+
+static int eth_send(const struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static enum ethernet_hw_caps eth_caps(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+static struct ethernet_api api_funcs = {
+	.iface_api.init = eth_iface_init,
+
+	.get_capabilities = eth_caps,
+	.send = eth_send,
+};
+
+static int eth_init(const struct device *dev)
+{
+	struct eth_context *context = dev->data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	context->mac_addr[0] = 0x00;
+	context->mac_addr[1] = 0x00;
+	context->mac_addr[2] = 0x5E;
+	context->mac_addr[3] = 0x00;
+	context->mac_addr[4] = 0x53;
+	context->mac_addr[5] = 0x01;
+
+	return 0;
+}
+
+ETH_NET_DEVICE_INIT(eth_gro_test, "eth_gro_test",
+		    eth_init, NULL, &eth_ctx, NULL,
+		    CONFIG_ETH_INIT_PRIORITY, &api_funcs, NET_ETH_MTU);
+
+static uint32_t chksum_add(uint32_t sum, const uint8_t *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		sum += (data[i] << 8) | data[i + 1];
+	}
+
+	if (len & 1) {
+		sum += data[len - 1] << 8;
+	}
+
+	return sum;
+}
+
+static void chksum_set(uint8_t *field, uint32_t sum)
+{
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	sum = ~sum & 0xffff;
+
+	field[0] = sum >> 8;
+	field[1] = sum & 0xff;
+}
+
+static struct net_pkt *prepare_segment(sa_family_t family, uint16_t port,
+				       uint32_t seq, uint8_t flags,
+				       bool bad_chksum)
+{
+	size_t ip_len = (family == AF_INET) ? sizeof(struct net_ipv4_hdr) :
+					      sizeof(struct net_ipv6_hdr);
+	size_t tcp_len = sizeof(struct net_tcp_hdr) + SEG_LEN;
+	struct net_eth_hdr *eth = (struct net_eth_hdr *)frame;
+	uint8_t *ip = frame + sizeof(struct net_eth_hdr);
+	uint8_t *tcp = ip + ip_len;
+	size_t total = sizeof(struct net_eth_hdr) + ip_len + tcp_len;
+	struct net_pkt *pkt;
+	uint32_t sum;
+	size_t i;
+
+	memset(frame, 0, total);
+
+	memcpy(eth->dst.addr, eth_ctx.mac_addr, sizeof(eth->dst.addr));
+	memcpy(eth->src.addr, peer_mac, sizeof(eth->src.addr));
+
+	if (family == AF_INET) {
+		eth->type = htons(NET_ETH_PTYPE_IP);
+
+		ip[0] = 0x45;
+		sys_put_be16(ip_len + tcp_len, &ip[2]);
+		sys_put_be16(seq & 0xffff, &ip[4]);
+		ip[6] = 0x40; /* DF */
+		ip[8] = 64;
+		ip[9] = IPPROTO_TCP;
+		memcpy(&ip[12], peer_addr4, sizeof(peer_addr4));
+		memcpy(&ip[16], &my_addr4, sizeof(my_addr4));
+		chksum_set(&ip[10], chksum_add(0, ip, ip_len));
+
+		sum = chksum_add(0, &ip[12], 2 * sizeof(struct in_addr));
+	} else {
+		eth->type = htons(NET_ETH_PTYPE_IPV6);
+
+		ip[0] = 0x60;
+		sys_put_be16(tcp_len, &ip[4]);
+		ip[6] = IPPROTO_TCP;
+		ip[7] = 64;
+		memcpy(&ip[8], peer_addr6, sizeof(peer_addr6));
+		memcpy(&ip[24], &my_addr6, sizeof(my_addr6));
+
+		sum = chksum_add(0, &ip[8], 2 * sizeof(struct in6_addr));
+	}
+
+	sys_put_be16(port, &tcp[0]);
+	sys_put_be16(TEST_PORT, &tcp[2]);
+	sys_put_be32(seq, &tcp[4]);
+	sys_put_be32(1, &tcp[8]);
+	tcp[12] = 0x50;
+	tcp[13] = flags;
+	sys_put_be16(8192, &tcp[14]);
+
+	for (i = 0; i < SEG_LEN; i++) {
+		tcp[sizeof(struct net_tcp_hdr) + i] = (uint8_t)(seq + i);
+	}
+
+	sum += IPPROTO_TCP + tcp_len;
+	sum = chksum_add(sum, tcp, tcp_len);
+	chksum_set(&tcp[16], sum);
+
+	if (bad_chksum) {
+		tcp[16] ^= 0x5a;
+	}
+
+	pkt = net_pkt_rx_alloc_with_buffer(test_iface, total, AF_UNSPEC, 0,
+					   K_NO_WAIT);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	zassert_ok(net_pkt_write(pkt, frame, total), "Cannot write pkt");
+
+	/* Same as what net_recv_data() does before queueing the pkt */
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+static enum net_verdict tcp_received(struct net_conn *conn,
+				     struct net_pkt *pkt,
+				     union net_ip_header *ip_hdr,
+				     union net_proto_header *proto_hdr,
+				     void *user_data)
+{
+	size_t hdr_len = net_pkt_ip_hdr_len(pkt) +
+			 (proto_hdr->tcp->offset >> 4) * 4U;
+	struct recv_info *info;
+	struct net_pkt *clone;
+	uint8_t byte;
+
+	ARG_UNUSED(conn);
+	ARG_UNUSED(ip_hdr);
+	ARG_UNUSED(user_data);
+
+	zassert_true(recv_count < MAX_RECV, "Too many packets");
+
+	info = &received[recv_count++];
+	info->seq = sys_get_be32(proto_hdr->tcp->seq);
+	info->len = net_pkt_get_len(pkt) - hdr_len;
+	info->data_ok = true;
+	info->chksum_verified = net_pkt_is_rx_chksum_verified(pkt);
+
+	/* A copy of the packet is verified again when it is received */
+	clone = net_pkt_clone(pkt, K_NO_WAIT);
+	if (clone != NULL) {
+		info->clone_chksum_verified = net_pkt_is_rx_chksum_verified(clone);
+		net_pkt_unref(clone);
+	}
+
+	net_pkt_cursor_init(pkt);
+	net_pkt_skip(pkt, hdr_len);
+
+	for (size_t i = 0; i < info->len; i++) {
+		if (net_pkt_read_u8(pkt, &byte) < 0 ||
+		    byte != (uint8_t)(info->seq + i)) {
+			info->data_ok = false;
+			break;
+		}
+	}
+
+	net_pkt_unref(pkt);
+
+	return NET_OK;
+}
+
+static void *test_setup(void)
+{
+	struct net_if_addr *ifaddr;
+	int ret;
+
+	test_iface = net_if_lookup_by_dev(DEVICE_GET(eth_gro_test));
+	zassert_not_null(test_iface, "No test interface");
+
+	ifaddr = net_if_ipv4_addr_add(test_iface, &my_addr4, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add IPv4 address");
+
+	ifaddr = net_if_ipv6_addr_add(test_iface, &my_addr6, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add IPv6 address");
+
+	net_if_up(test_iface);
+
+	ret = net_conn_register(IPPROTO_TCP, AF_INET, NULL, NULL, 0, TEST_PORT,
+				NULL, tcp_received, NULL, &conn4);
+	zassert_ok(ret, "Cannot register IPv4 TCP handler (%d)", ret);
+
+	ret = net_conn_register(IPPROTO_TCP, AF_INET6, NULL, NULL, 0, TEST_PORT,
+				NULL, tcp_received, NULL, &conn6);
+	zassert_ok(ret, "Cannot register IPv6 TCP handler (%d)", ret);
+
+	return NULL;
+}
+
+static void test_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	memset(received, 0, sizeof(received));
+	recv_count = 0;
+}
+
+static void check_received(int idx, uint32_t seq, size_t len)
+{
+	zassert_true(idx < recv_count, "Packet %d not received", idx);
+	zassert_equal(received[idx].seq, seq, "Invalid seq %u (expected %u)",
+		      received[idx].seq, seq);
+	zassert_equal(received[idx].len, len, "Invalid len %zu (expected %zu)",
+		      received[idx].len, len);
+	zassert_true(received[idx].data_ok, "Data mismatch in packet %d", idx);
+}
+
+static void test_coalesce(sa_family_t family)
+{
+	struct net_pkt *pkts[4];
+	uint32_t merged = test_iface->stats.gro.merged;
+	uint32_t flushed = test_iface->stats.gro.flushed;
+
+	for (int i = 0; i < ARRAY_SIZE(pkts); i++) {
+		pkts[i] = prepare_segment(family, PEER_PORT, 1000 + i * SEG_LEN,
+					  TCP_ACK | (i == 3 ? TCP_PSH : 0),
+					  false);
+	}
+
+	net_gro_process(pkts, ARRAY_SIZE(pkts));
+
+	zassert_equal(recv_count, 1, "Segments not coalesced (%d)", recv_count);
+	check_received(0, 1000, 4 * SEG_LEN);
+
+	zassert_true(received[0].chksum_verified, "Checksum not marked verified");
+	zassert_false(received[0].clone_chksum_verified,
+		      "Clone marked verified");
+
+	zassert_equal(test_iface->stats.gro.merged - merged, 3,
+		      "Invalid merged count");
+	zassert_equal(test_iface->stats.gro.flushed - flushed, 1,
+		      "Invalid flushed count");
+}
+
+ZTEST(net_gro, test_gro_ipv4_coalesce)
+{
+	test_coalesce(AF_INET);
+}
+
+ZTEST(net_gro, test_gro_ipv6_coalesce)
+{
+	test_coalesce(AF_INET6);
+}
+
+ZTEST(net_gro, test_gro_out_of_order)
+{
+	struct net_pkt *pkts[3];
+
+	pkts[0] = prepare_segment(AF_INET, PEER_PORT, 0, TCP_ACK, false);
+	pkts[1] = prepare_segment(AF_INET, PEER_PORT, 2 * SEG_LEN, TCP_ACK,
+				  false);
+	pkts[2] = prepare_segment(AF_INET, PEER_PORT, 3 * SEG_LEN, TCP_ACK,
+				  false);
+
+	net_gro_process(pkts, ARRAY_SIZE(pkts));
+
+	zassert_equal(recv_count, 2, "Invalid packet count (%d)", recv_count);
+	check_received(0, 0, SEG_LEN);
+	check_received(1, 2 * SEG_LEN, 2 * SEG_LEN);
+}
+
+ZTEST(net_gro, test_gro_different_flows)
+{
+	struct net_pkt *pkts[3];
+
+	pkts[0] = prepare_segment(AF_INET, PEER_PORT, 0, TCP_ACK, false);
+	pkts[1] = prepare_segment(AF_INET, PEER_PORT2, SEG_LEN, TCP_ACK, false);
+	pkts[2] = prepare_segment(AF_INET, PEER_PORT, SEG_LEN, TCP_ACK, false);
+
+	net_gro_process(pkts, ARRAY_SIZE(pkts));
+
+	zassert_equal(recv_count, 3, "Invalid packet count (%d)", recv_count);
+	check_received(0, 0, SEG_LEN);
+	check_received(1, SEG_LEN, SEG_LEN);
+	check_received(2, SEG_LEN, SEG_LEN);
+}
+
+ZTEST(net_gro, test_gro_push_flushes)
+{
+	struct net_pkt *pkts[4];
+
+	for (int i = 0; i < ARRAY_SIZE(pkts); i++) {
+		pkts[i] = prepare_segment(AF_INET6, PEER_PORT, i * SEG_LEN,
+					  TCP_ACK | (i == 1 ? TCP_PSH : 0),
+					  false);
+	}
+
+	net_gro_process(pkts, ARRAY_SIZE(pkts));
+
+	zassert_equal(recv_count, 2, "Invalid packet count (%d)", recv_count);
+	check_received(0, 0, 2 * SEG_LEN);
+	check_received(1, 2 * SEG_LEN, 2 * SEG_LEN);
+}
+
+ZTEST(net_gro, test_gro_bad_chksum)
+{
+	uint32_t chkerr = test_iface->stats.tcp.chkerr;
+	struct net_pkt *pkts[3];
+
+	pkts[0] = prepare_segment(AF_INET, PEER_PORT, 0, TCP_ACK, false);
+	pkts[1] = prepare_segment(AF_INET, PEER_PORT, SEG_LEN, TCP_ACK, true);
+	pkts[2] = prepare_segment(AF_INET, PEER_PORT, 2 * SEG_LEN, TCP_ACK,
+				  false);
+
+	net_gro_process(pkts, ARRAY_SIZE(pkts));
+
+	/* The corrupted segment must be dropped by TCP, not hidden inside
+	 * a coalesced packet.
+	 */
+	zassert_equal(recv_count, 2, "Invalid packet count (%d)", recv_count);
+	check_received(0, 0, SEG_LEN);
+	check_received(1, 2 * SEG_LEN, SEG_LEN);
+
+	zassert_equal(test_iface->stats.tcp.chkerr - chkerr, 1,
+		      "Checksum error not detected");
+}
+
+ZTEST(net_gro, test_gro_max_segs)
+{
+	struct net_pkt *pkts[CONFIG_NET_GRO_MAX_SEGS + 2];
+
+	for (int i = 0; i < ARRAY_SIZE(pkts); i++) {
+		pkts[i] = prepare_segment(AF_INET, PEER_PORT, i * SEG_LEN,
+					  TCP_ACK, false);
+	}
+
+	net_gro_process(pkts, ARRAY_SIZE(pkts));
+
+	zassert_equal(recv_count, 2, "Invalid packet count (%d)", recv_count);
+	check_received(0, 0, CONFIG_NET_GRO_MAX_SEGS * SEG_LEN);
+	check_received(1, CONFIG_NET_GRO_MAX_SEGS * SEG_LEN, 2 * SEG_LEN);
+}
+
+static uint64_t run_batch(bool gro)
+{
+	struct net_pkt *pkts[BENCH_BATCH];
+	timing_t start, end;
+
+	for (int i = 0; i < ARRAY_SIZE(pkts); i++) {
+		pkts[i] = prepare_segment(AF_INET, PEER_PORT, i * SEG_LEN,
+					  TCP_ACK, false);
+	}
+
+	recv_count = 0;
+
+	start = timing_counter_get();
+
+	if (gro) {
+		net_gro_process(pkts, ARRAY_SIZE(pkts));
+	} else {
+		for (int i = 0; i < ARRAY_SIZE(pkts); i++) {
+			net_process_rx_packet(pkts[i]);
+		}
+	}
+
+	end = timing_counter_get();
+
+	return timing_cycles_to_ns(timing_cycles_get(&start, &end));
+}
+
+ZTEST(net_gro, test_gro_throughput)
+{
+	uint64_t ns_gro = 0, ns_plain = 0;
+	uint64_t bytes = (uint64_t)BENCH_ROUNDS * BENCH_BATCH * SEG_LEN;
+
+	timing_init();
+	timing_start();
+
+	for (int i = 0; i < BENCH_ROUNDS; i++) {
+		ns_plain += run_batch(false);
+		ns_gro += run_batch(true);
+	}
+
+	timing_stop();
+
+	TC_PRINT("%llu bytes in %d segment batches\n", bytes, BENCH_BATCH);
+	TC_PRINT("without GRO: %llu ns (%llu kB/s)\n", ns_plain,
+		 ns_plain ? bytes * 1000000ULL / ns_plain : 0);
+	TC_PRINT("with GRO:    %llu ns (%llu kB/s)\n", ns_gro,
+		 ns_gro ? bytes * 1000000ULL / ns_gro : 0);
+}
+
+ZTEST_SUITE(net_gro, NULL, test_setup, test_before, NULL, NULL);
@@ -15,6 +15,7 @@ LOG_MODULE_REGISTER(net_ipv4_test, CONFIG_NET_IPV4_LOG_LEVEL);
 #include <zephyr/linker/sections.h>
 #include <zephyr/random/random.h>
 #include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
 #include <zephyr/net/ethernet.h>
 #include <zephyr/net/dummy.h>
 #include <zephyr/net/buf.h>
@@ -30,6 +31,12 @@ LOG_MODULE_REGISTER(net_ipv4_test, CONFIG_NET_IPV4_LOG_LEVEL);
 /* Packet size for tests, excluding headers */
 #define IPV4_TEST_PACKET_SIZE 2048
 
+/* Received fragments tests: number of datagrams and fragments per datagram */
+#define FUZZ_ROUNDS 32
+#define FUZZ_MAX_FRAGS CONFIG_NET_IPV4_FRAGMENT_MAX_PKT
+#define BENCH_ROUNDS 100
+#define BENCH_FRAG_LEN 256
+
 /* Wait times for semaphores and buffers */
 #define WAIT_TIME K_SECONDS(2)
 #define ALLOC_TIMEOUT K_MSEC(500)
@@ -148,6 +155,14 @@ static uint16_t lower_layer_total_size;
 static uint16_t upper_layer_total_size;
 
 static uint8_t test_tmp_buf[256];
+
+/* UDP datagram that is fragmented for the received fragments tests */
+static uint8_t dgram[NET_IPV4H_LEN + NET_UDPH_LEN + IPV4_TEST_PACKET_SIZE];
+
+struct frag_desc {
+	uint16_t offset;
+	uint16_t len;
+};
 static uint8_t net_iface_dummy_data;
 
 static void net_iface_init(struct net_if *iface);
@@ -873,6 +888,232 @@ ZTEST(net_ipv4_fragment, test_do_not_fragment)
 	zassert_equal(pkt_recv_size, pkt_recv_expected_size, "Packet size mismatch");
 }
 
+/* Build the UDP datagram that would be received after reassembly */
+static void build_datagram(uint16_t id)
+{
+	uint8_t hdr[sizeof(ipv4_udp)];
+	struct net_pkt *pkt;
+	uint16_t i;
+	int ret;
+
+	/* The packets are received from the peer, swap addresses and ports */
+	memcpy(hdr, ipv4_udp, sizeof(hdr));
+	memcpy(&hdr[offsetof(struct net_ipv4_hdr, src)],
+	       &ipv4_udp[offsetof(struct net_ipv4_hdr, dst)], NET_IPV4_ADDR_SIZE);
+	memcpy(&hdr[offsetof(struct net_ipv4_hdr, dst)],
+	       &ipv4_udp[offsetof(struct net_ipv4_hdr, src)], NET_IPV4_ADDR_SIZE);
+	memcpy(&hdr[NET_IPV4H_LEN], &ipv4_udp[NET_IPV4H_LEN + 2], 2);
+	memcpy(&hdr[NET_IPV4H_LEN + 2], &ipv4_udp[NET_IPV4H_LEN], 2);
+
+	pkt = net_pkt_alloc_with_buffer(iface1, sizeof(dgram), AF_INET, IPPROTO_UDP,
+					ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Packet creation failed");
+
+	ret = net_pkt_write(pkt, hdr, sizeof(hdr));
+	zassert_equal(ret, 0, "IPv4 header append failed");
+
+	for (i = 0; i < IPV4_TEST_PACKET_SIZE; i += sizeof(test_tmp_buf)) {
+		ret = net_pkt_write(pkt, test_tmp_buf, sizeof(test_tmp_buf));
+		zassert_equal(ret, 0, "IPv4 data append failed");
+	}
+
+	net_pkt_set_family(pkt, AF_INET);
+	net_pkt_set_ip_hdr_len(pkt, sizeof(struct net_ipv4_hdr));
+
+	NET_IPV4_HDR(pkt)->len = htons(net_pkt_get_len(pkt));
+	UNALIGNED_PUT(id, (uint16_t *)NET_IPV4_HDR(pkt)->id);
+
+	net_pkt_cursor_init(pkt);
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_skip(pkt, net_pkt_ip_hdr_len(pkt));
+	net_udp_finalize(pkt, false);
+
+	net_pkt_cursor_init(pkt);
+	ret = net_pkt_read(pkt, dgram, sizeof(dgram));
+	zassert_equal(ret, 0, "Cannot read datagram");
+
+	net_pkt_unref(pkt);
+
+	pkt_id = id;
+}
+
+/* Feed one fragment of the datagram to the interface */
+static void recv_fragment(const struct frag_desc *frag, bool more)
+{
+	struct net_pkt *pkt;
+	uint16_t flags;
+	int ret;
+
+	pkt = net_pkt_alloc_with_buffer(iface1, NET_IPV4H_LEN + frag->len, AF_INET,
+					IPPROTO_UDP, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Packet creation failed");
+
+	net_pkt_set_family(pkt, AF_INET);
+	net_pkt_set_ip_hdr_len(pkt, sizeof(struct net_ipv4_hdr));
+
+	ret = net_pkt_write(pkt, dgram, NET_IPV4H_LEN);
+	zassert_equal(ret, 0, "IPv4 header append failed");
+
+	ret = net_pkt_write(pkt, &dgram[NET_IPV4H_LEN + frag->offset], frag->len);
+	zassert_equal(ret, 0, "IPv4 data append failed");
+
+	/* Like the drivers do, so that no empty buffer ends the packet */
+	net_pkt_trim_buffer(pkt);
+
+	flags = frag->offset / 8;
+	if (more) {
+		flags |= NET_IPV4_MORE_FRAG_MASK;
+	}
+
+	net_pkt_cursor_init(pkt);
+	NET_IPV4_HDR(pkt)->len = htons(NET_IPV4H_LEN + frag->len);
+	sys_put_be16(flags, NET_IPV4_HDR(pkt)->offset);
+	NET_IPV4_HDR(pkt)->chksum = 0;
+	NET_IPV4_HDR(pkt)->chksum = net_calc_chksum_ipv4(pkt);
+
+	ret = net_recv_data(iface1, pkt);
+	zassert_equal(ret, 0, "Cannot receive data (%d)", ret);
+}
+
+/* Split the datagram payload in count fragments of random length */
+static void split_datagram(struct frag_desc *frags, int count)
+{
+	uint16_t total = sizeof(dgram) - NET_IPV4H_LEN;
+	uint16_t offset = 0;
+	int i;
+
+	for (i = 0; i < count - 1; i++) {
+		/* Leave at least 8 bytes for each of the following fragments */
+		uint16_t max_units = (total - offset - 1 - 8 * (count - 2 - i)) / 8;
+
+		frags[i].offset = offset;
+		frags[i].len = 8 * (1 + sys_rand32_get() % max_units);
+		offset += frags[i].len;
+	}
+
+	frags[i].offset = offset;
+	frags[i].len = total - offset;
+}
+
+static uint8_t pending_reassemblies(void)
+{
+	uint8_t packets = 0;
+
+	net_ipv4_frag_foreach(reassembly_foreach_cb, &packets);
+
+	return packets;
+}
+
+/* Received fragments come out of order and duplicated */
+ZTEST(net_ipv4_fragment, test_recv_shuffled)
+{
+	struct frag_desc frags[FUZZ_MAX_FRAGS];
+	int order[FUZZ_MAX_FRAGS];
+	int round;
+
+	for (round = 0; round < FUZZ_ROUNDS; round++) {
+		int count = 2 + sys_rand32_get() % (FUZZ_MAX_FRAGS - 1);
+		int dup;
+		int i;
+
+		build_datagram(1 + sys_rand32_get() % UINT16_MAX);
+		split_datagram(frags, count);
+
+		for (i = 0; i < count; i++) {
+			order[i] = i;
+		}
+
+		for (i = count - 1; i > 0; i--) {
+			int j = sys_rand32_get() % (i + 1);
+			int tmp = order[i];
+
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+
+		/* The duplicate is sent before the datagram is complete, so that
+		 * it does not start a new reassembly.
+		 */
+		dup = order[sys_rand32_get() % (count - 1)];
+
+		for (i = 0; i < count - 1; i++) {
+			recv_fragment(&frags[order[i]], order[i] != count - 1);
+		}
+
+		recv_fragment(&frags[dup], dup != count - 1);
+		recv_fragment(&frags[order[i]], order[i] != count - 1);
+
+		zassert_equal(k_sem_take(&wait_received_data, WAIT_TIME), 0,
+			      "Datagram not reassembled, round %d %d fragments", round,
+			      count);
+		zassert_equal(pending_reassemblies(), 0, "Reassembly left pending");
+	}
+
+	zassert_equal(upper_layer_packet_count, FUZZ_ROUNDS,
+		      "Expected %d packets at upper layers", FUZZ_ROUNDS);
+}
+
+/* Overlapping fragments discard the whole datagram */
+ZTEST(net_ipv4_fragment, test_recv_overlapping)
+{
+	struct frag_desc first = { .offset = 0, .len = 512 };
+	struct frag_desc overlap = { .offset = 256, .len = 512 };
+
+	build_datagram(0x4321);
+
+	recv_fragment(&first, true);
+	k_sleep(K_MSEC(10));
+	zassert_equal(pending_reassemblies(), 1, "Expected a pending reassembly");
+
+	recv_fragment(&overlap, true);
+	k_sleep(K_MSEC(10));
+	zassert_equal(pending_reassemblies(), 0, "Reassembly not discarded");
+
+	zassert_equal(upper_layer_packet_count, 0, "Expected no packets at upper layers");
+}
+
+ZTEST(net_ipv4_fragment, test_recv_throughput)
+{
+	struct frag_desc frags[DIV_ROUND_UP(sizeof(dgram) - NET_IPV4H_LEN, BENCH_FRAG_LEN)];
+	timing_t start, end;
+	uint64_t ns;
+	int round;
+	int i;
+
+	zassert_true(ARRAY_SIZE(frags) <= CONFIG_NET_IPV4_FRAGMENT_MAX_PKT,
+		     "Too many fragments");
+
+	build_datagram(0x1234);
+
+	for (i = 0; i < ARRAY_SIZE(frags); i++) {
+		frags[i].offset = i * BENCH_FRAG_LEN;
+		frags[i].len = MIN(BENCH_FRAG_LEN,
+				   sizeof(dgram) - NET_IPV4H_LEN - frags[i].offset);
+	}
+
+	timing_init();
+	timing_start();
+
+	start = timing_counter_get();
+
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		for (i = 0; i < ARRAY_SIZE(frags); i++) {
+			recv_fragment(&frags[i], i != ARRAY_SIZE(frags) - 1);
+		}
+
+		zassert_equal(k_sem_take(&wait_received_data, WAIT_TIME), 0,
+			      "Datagram not reassembled");
+	}
+
+	end = timing_counter_get();
+	ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+
+	timing_stop();
+
+	TC_PRINT("Reassembled %d datagrams of %zu bytes from %zu fragments in %llu us\n",
+		 BENCH_ROUNDS, sizeof(dgram), ARRAY_SIZE(frags), ns / NSEC_PER_USEC);
+}
+
 static void test_pre(void *ptr)
 {
 	k_sem_reset(&wait_data);
@@ -0,0 +1,415 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_IPV6_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zephyr/tc_util.h>
+
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+
+#include "net_private.h"
+#include "ipv6.h"
+#include "nbr.h"
+#include "route.h"
+#include "udp_internal.h"
+
+#define WAIT_TIME K_MSEC(250)
+
+/* Time given to the network management thread to deliver the events */
+#define EVENT_WAIT_TIME K_MSEC(50)
+
+#define BENCH_ROUTES 12
+#define BENCH_ROUNDS 10000
+
+static struct in6_addr addr1 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 1, 0, 0,
+				     0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr addr2 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 2, 0, 0,
+				     0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr peer1 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 1, 0, 0,
+				     0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+static struct in6_addr peer2 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 2, 0, 0,
+				     0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+static struct in6_addr remote = { { { 0x20, 0x01, 0x0d, 0xb8, 1, 0, 0, 0,
+				      0, 0, 0, 0, 0, 0, 0, 0x5 } } };
+static struct in6_addr remote_net = { { { 0x20, 0x01, 0x0d, 0xb8, 1, 0, 0, 0,
+					  0, 0, 0, 0, 0, 0, 0, 0 } } };
+
+static uint8_t peer1_lladdr[] = { 0x00, 0x00, 0x5E, 0x00, 0x53, 0x11 };
+static uint8_t peer2_lladdr[] = { 0x00, 0x00, 0x5E, 0x00, 0x53, 0x22 };
+
+static struct net_if *iface1;
+static struct net_if *iface2;
+
+static K_SEM_DEFINE(wait_data, 0, UINT_MAX);
+static uint8_t sent_lladdr[sizeof(peer1_lladdr)];
+static struct net_if *sent_iface;
+
+struct dst_cache_test {
+	uint8_t mac_addr[6];
+};
+
+static int dst_cache_dev_init(const struct device *dev)
+{
+	return 0;
+}
+
+static void dst_cache_iface_init(struct net_if *iface)
+{
+	struct dst_cache_test *data = net_if_get_device(iface)->data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[0] = 0x00;
+	data->mac_addr[1] = 0x00;
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[3] = 0x00;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = net_if_get_by_iface(iface);
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_DUMMY);
+}
+
+static int tester_send(const struct device *dev, struct net_pkt *pkt)
+{
+	if (net_pkt_lladdr_dst(pkt)->addr != NULL &&
+	    net_pkt_lladdr_dst(pkt)->len == sizeof(sent_lladdr)) {
+		memcpy(sent_lladdr, net_pkt_lladdr_dst(pkt)->addr,
+		       sizeof(sent_lladdr));
+	} else {
+		memset(sent_lladdr, 0, sizeof(sent_lladdr));
+	}
+
+	sent_iface = net_pkt_iface(pkt);
+
+	k_sem_give(&wait_data);
+
+	return 0;
+}
+
+static struct dst_cache_test dst_cache_data1;
+static struct dst_cache_test dst_cache_data2;
+
+static struct dummy_api dst_cache_if_api = {
+	.iface_api.init = dst_cache_iface_init,
+	.send = tester_send,
+};
+
+NET_DEVICE_INIT_INSTANCE(dst_cache_test1, "dst_cache_test1", iface1,
+			 dst_cache_dev_init, NULL,
+			 &dst_cache_data1, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &dst_cache_if_api, DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+NET_DEVICE_INIT_INSTANCE(dst_cache_test2, "dst_cache_test2", iface2,
+			 dst_cache_dev_init, NULL,
+			 &dst_cache_data2, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &dst_cache_if_api, DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+static struct net_nbr *add_nbr(struct net_if *iface, struct in6_addr *addr,
+			       uint8_t *lladdr)
+{
+	struct net_linkaddr ll = {
+		.addr = lladdr,
+		.len = sizeof(peer1_lladdr),
+		.type = NET_LINK_DUMMY,
+	};
+
+	return net_ipv6_nbr_add(iface, addr, &ll, false,
+				NET_IPV6_NBR_STATE_REACHABLE);
+}
+
+static void *setup(void)
+{
+	STRUCT_SECTION_FOREACH(net_if, iface) {
+		if (net_if_get_device(iface)->data == &dst_cache_data1) {
+			iface1 = iface;
+		} else if (net_if_get_device(iface)->data == &dst_cache_data2) {
+			iface2 = iface;
+		}
+	}
+
+	zassert_not_null(iface1, "No first interface");
+	zassert_not_null(iface2, "No second interface");
+
+	zassert_not_null(net_if_ipv6_addr_add(iface1, &addr1, NET_ADDR_MANUAL, 0),
+			 "Cannot add address");
+	zassert_not_null(net_if_ipv6_addr_add(iface2, &addr2, NET_ADDR_MANUAL, 0),
+			 "Cannot add address");
+	zassert_not_null(net_if_ipv6_prefix_add(iface1, &addr1, 64, UINT32_MAX),
+			 "Cannot add prefix");
+	zassert_not_null(net_if_ipv6_prefix_add(iface2, &addr2, 64, UINT32_MAX),
+			 "Cannot add prefix");
+
+	return NULL;
+}
+
+static void before(void *arg)
+{
+	ARG_UNUSED(arg);
+
+	zassert_not_null(add_nbr(iface1, &peer1, peer1_lladdr),
+			 "Cannot add neighbor");
+	zassert_not_null(add_nbr(iface2, &peer2, peer2_lladdr),
+			 "Cannot add neighbor");
+	zassert_not_null(net_route_add(iface1, &remote_net, 48, &peer1,
+				       NET_IPV6_ND_INFINITE_LIFETIME,
+				       NET_ROUTE_PREFERENCE_MEDIUM),
+			 "Cannot add route");
+
+	k_sleep(EVENT_WAIT_TIME);
+	k_sem_reset(&wait_data);
+}
+
+static void after(void *arg)
+{
+	ARG_UNUSED(arg);
+
+	(void)net_route_del_by_nexthop(iface1, &peer1);
+	(void)net_route_del_by_nexthop(iface2, &peer2);
+	(void)net_ipv6_nbr_rm(iface1, &peer1);
+	(void)net_ipv6_nbr_rm(iface2, &peer2);
+
+	k_sleep(EVENT_WAIT_TIME);
+}
+
+static struct net_pkt *prepare_pkt(struct net_if *iface, struct in6_addr *src,
+				   struct in6_addr *dst)
+{
+	static const uint8_t payload[] = { 'd', 'a', 't', 'a' };
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_alloc_with_buffer(iface, sizeof(payload), AF_INET6,
+					IPPROTO_UDP, K_NO_WAIT);
+	zassert_not_null(pkt, "Cannot allocate packet");
+
+	zassert_ok(net_ipv6_create(pkt, src, dst), "");
+	zassert_ok(net_udp_create(pkt, htons(4242), htons(4242)), "");
+	zassert_ok(net_pkt_write(pkt, payload, sizeof(payload)), "");
+
+	net_pkt_cursor_init(pkt);
+	zassert_ok(net_ipv6_finalize(pkt, IPPROTO_UDP), "");
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+static void send_pkt(struct net_if *iface, struct in6_addr *dst)
+{
+	struct net_pkt *pkt = prepare_pkt(iface, &addr1, dst);
+
+	if (net_send_data(pkt) < 0) {
+		net_pkt_unref(pkt);
+		zassert_unreachable("Data send failed");
+	}
+}
+
+static void inject_pkt(struct net_if *iface, struct in6_addr *src,
+		       struct in6_addr *dst)
+{
+	struct net_pkt *pkt = prepare_pkt(iface, src, dst);
+
+	if (net_recv_data(iface, pkt) < 0) {
+		net_pkt_unref(pkt);
+		zassert_unreachable("Data receive failed");
+	}
+}
+
+static struct net_nbr *cache_lookup(struct net_if *iface, struct in6_addr *dst)
+{
+	struct net_nbr *nbr;
+
+	net_ipv6_nbr_lock();
+	nbr = net_ipv6_dst_cache_lookup(iface, dst);
+	net_ipv6_nbr_unlock();
+
+	return nbr;
+}
+
+ZTEST(net_ipv6_dst_cache, test_send)
+{
+	struct net_nbr *nbr;
+
+	zassert_is_null(cache_lookup(iface1, &remote), "Cache not empty");
+
+	send_pkt(iface1, &remote);
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not sent");
+	zassert_mem_equal(sent_lladdr, peer1_lladdr, sizeof(peer1_lladdr),
+			  "Wrong link address");
+
+	nbr = cache_lookup(iface1, &remote);
+	zassert_not_null(nbr, "Destination not cached");
+	zassert_true(net_ipv6_addr_cmp(&net_ipv6_nbr_data(nbr)->addr, &peer1),
+		     "Wrong neighbor cached");
+
+	/* Cached destination gives the same result */
+	send_pkt(iface1, &remote);
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not sent");
+	zassert_mem_equal(sent_lladdr, peer1_lladdr, sizeof(peer1_lladdr),
+			  "Wrong link address");
+	zassert_equal_ptr(sent_iface, iface1, "Sent via wrong interface");
+
+	/* Other source interface is a different entry */
+	zassert_is_null(cache_lookup(iface2, &remote), "Wrong entry found");
+}
+
+ZTEST(net_ipv6_dst_cache, test_route_change)
+{
+	send_pkt(iface1, &remote);
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not sent");
+	zassert_not_null(cache_lookup(iface1, &remote), "Destination not cached");
+
+	zassert_equal(net_route_del_by_nexthop(iface1, &peer1), 1,
+		      "Cannot delete route");
+	zassert_not_null(net_route_add(iface2, &remote_net, 48, &peer2,
+				       NET_IPV6_ND_INFINITE_LIFETIME,
+				       NET_ROUTE_PREFERENCE_MEDIUM),
+			 "Cannot add route");
+
+	k_sleep(EVENT_WAIT_TIME);
+
+	zassert_is_null(cache_lookup(iface1, &remote), "Cache not flushed");
+
+	send_pkt(iface1, &remote);
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not sent");
+	zassert_mem_equal(sent_lladdr, peer2_lladdr, sizeof(peer2_lladdr),
+			  "Old route used");
+	zassert_equal_ptr(sent_iface, iface2, "Sent via wrong interface");
+}
+
+ZTEST(net_ipv6_dst_cache, test_nbr_removed)
+{
+	send_pkt(iface1, &remote);
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not sent");
+	zassert_not_null(cache_lookup(iface1, &remote), "Destination not cached");
+
+	/* The entry must not be used even before the removal event has
+	 * been delivered.
+	 */
+	k_sched_lock();
+	zassert_true(net_ipv6_nbr_rm(iface1, &peer1), "Cannot remove neighbor");
+	zassert_is_null(cache_lookup(iface1, &remote), "Removed neighbor used");
+	k_sched_unlock();
+}
+
+ZTEST(net_ipv6_dst_cache, test_forward)
+{
+	Z_TEST_SKIP_IFNDEF(CONFIG_NET_ROUTING);
+
+	inject_pkt(iface2, &peer2, &remote);
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not forwarded");
+	zassert_mem_equal(sent_lladdr, peer1_lladdr, sizeof(peer1_lladdr),
+			  "Wrong link address");
+	zassert_equal_ptr(sent_iface, iface1, "Sent via wrong interface");
+
+	/* The route back to the source, added when forwarding the first
+	 * packet, flushes the cache.
+	 */
+	k_sleep(EVENT_WAIT_TIME);
+
+	inject_pkt(iface2, &peer2, &remote);
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not forwarded");
+
+	zassert_not_null(cache_lookup(iface2, &remote), "Destination not cached");
+
+	inject_pkt(iface2, &peer2, &remote);
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not forwarded");
+	zassert_mem_equal(sent_lladdr, peer1_lladdr, sizeof(peer1_lladdr),
+			  "Wrong link address");
+	zassert_equal_ptr(sent_iface, iface1, "Sent via wrong interface");
+}
+
+ZTEST(net_ipv6_dst_cache, test_no_routing)
+{
+	Z_TEST_SKIP_IFDEF(CONFIG_NET_ROUTING);
+
+	/* Locally sent traffic goes to the route on the other interface */
+	send_pkt(iface2, &remote);
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not sent");
+	zassert_equal_ptr(sent_iface, iface1, "Sent via wrong interface");
+	zassert_not_null(cache_lookup(iface2, &remote), "Destination not cached");
+
+	/* Received packets must not be forwarded between interfaces */
+	inject_pkt(iface2, &peer2, &remote);
+	zassert_equal(k_sem_take(&wait_data, WAIT_TIME), -EAGAIN,
+		      "Packet forwarded");
+}
+
+static uint64_t bench_prepare(struct net_pkt *pkt, bool flush)
+{
+	timing_t start, end;
+
+	start = timing_counter_get();
+
+	for (int i = 0; i < BENCH_ROUNDS; i++) {
+		if (flush) {
+			net_ipv6_dst_cache_flush();
+		}
+
+		net_pkt_lladdr_dst(pkt)->addr = NULL;
+		net_pkt_set_iface(pkt, iface1);
+
+		zassert_equal(net_ipv6_prepare_for_send(pkt), NET_OK,
+			      "Cannot prepare packet");
+	}
+
+	end = timing_counter_get();
+
+	return timing_cycles_to_ns(timing_cycles_get(&start, &end)) /
+		BENCH_ROUNDS;
+}
+
+ZTEST(net_ipv6_dst_cache, test_prepare_throughput)
+{
+	struct in6_addr net = remote_net;
+	struct net_pkt *pkt;
+
+	/* Routes that the destination does not match, so that the lookup
+	 * has some work to do.
+	 */
+	for (int i = 0; i < BENCH_ROUTES; i++) {
+		net.s6_addr[5] = i + 1;
+
+		zassert_not_null(net_route_add(iface1, &net, 48, &peer1,
+					       NET_IPV6_ND_INFINITE_LIFETIME,
+					       NET_ROUTE_PREFERENCE_MEDIUM),
+				 "Cannot add route %d", i);
+	}
+
+	k_sleep(EVENT_WAIT_TIME);
+
+	pkt = prepare_pkt(iface1, &addr1, &remote);
+
+	timing_init();
+	timing_start();
+
+	TC_PRINT("%d routes: lookup %llu ns, cached %llu ns per packet\n",
+		 BENCH_ROUTES + 1, bench_prepare(pkt, true),
+		 bench_prepare(pkt, false));
+
+	timing_stop();
+
+	zassert_mem_equal(net_pkt_lladdr_dst(pkt)->addr, peer1_lladdr,
+			  sizeof(peer1_lladdr), "Wrong link address");
+
+	net_pkt_unref(pkt);
+}
+
+ZTEST_SUITE(net_ipv6_dst_cache, NULL, setup, before, after, NULL);
@@ -2394,4 +2394,124 @@ ZTEST(net_ipv6_fragment, test_recv_ipv6_fragment)
 	net_icmp_cleanup_ctx(&ctx);
 }
 
+static void recv_ipv6_reass_frag(const uint8_t *frag, size_t frag_len,
+				 uint16_t payload_len, uint8_t data,
+				 enum net_verdict expected)
+{
+	struct net_ipv6_hdr ipv6_hdr;
+	struct net_pkt_cursor backup;
+	struct net_pkt *pkt;
+	int ret;
+
+	pkt = net_pkt_alloc_with_buffer(iface1, frag_len + payload_len,
+					AF_UNSPEC, 0, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "packet");
+
+	net_pkt_set_family(pkt, AF_INET6);
+	net_pkt_set_ip_hdr_len(pkt, sizeof(struct net_ipv6_hdr));
+	net_pkt_cursor_init(pkt);
+
+	memcpy(&ipv6_hdr, frag, sizeof(struct net_ipv6_hdr));
+
+	ret = net_pkt_write(pkt, frag, sizeof(struct net_ipv6_hdr) + 1);
+	zassert_true(ret == 0, "IPv6 header append failed");
+
+	net_pkt_cursor_backup(pkt, &backup);
+
+	ret = net_pkt_write(pkt, frag + sizeof(struct net_ipv6_hdr) + 1,
+			    frag_len - sizeof(struct net_ipv6_hdr) - 1);
+	zassert_true(ret == 0, "IPv6 fragment header append failed");
+
+	while (payload_len--) {
+		ret = net_pkt_write_u8(pkt, data++);
+		zassert_true(ret == 0, "IPv6 header append failed");
+	}
+
+	net_pkt_set_ipv6_hdr_prev(pkt, offsetof(struct net_ipv6_hdr, nexthdr));
+	net_pkt_set_ipv6_fragment_start(pkt, sizeof(struct net_ipv6_hdr));
+	net_pkt_set_overwrite(pkt, true);
+
+	net_pkt_cursor_restore(pkt, &backup);
+
+	ret = net_ipv6_handle_fragment_hdr(pkt, &ipv6_hdr,
+					   NET_IPV6_NEXTHDR_FRAG);
+	zassert_equal(ret, expected, "IPv6 fragment verdict %d", ret);
+
+	if (ret == NET_DROP) {
+		net_pkt_unref(pkt);
+	}
+}
+
+static void reassembly_count_cb(struct net_ipv6_reassembly *reass,
+				void *user_data)
+{
+	int *count = user_data;
+
+	(*count)++;
+}
+
+static int pending_reassemblies(void)
+{
+	int count = 0;
+
+	net_ipv6_frag_foreach(reassembly_count_cb, &count);
+
+	return count;
+}
+
+/* The last fragment comes first, and the first one twice */
+ZTEST(net_ipv6_fragment, test_recv_ipv6_fragment_reverse)
+{
+	uint16_t payload1_len = NET_IPV6_MTU - sizeof(ipv6_reass_frag1);
+	uint16_t payload2_len = test_recv_payload_len - payload1_len;
+	struct net_icmp_ctx ctx;
+	int ret;
+
+	ret = net_icmp_init_ctx(&ctx, NET_ICMPV6_ECHO_REPLY,
+				0, handle_ipv6_echo_reply);
+	zassert_equal(ret, 0, "Cannot register %s handler (%d)",
+		      STRINGIFY(NET_ICMPV6_ECHO_REPLY), ret);
+
+	recv_ipv6_reass_frag(ipv6_reass_frag2, sizeof(ipv6_reass_frag2),
+			     payload2_len, payload1_len, NET_OK);
+	recv_ipv6_reass_frag(ipv6_reass_frag2, sizeof(ipv6_reass_frag2),
+			     payload2_len, payload1_len, NET_DROP);
+	zassert_equal(pending_reassemblies(), 1, "Expected a pending reassembly");
+
+	recv_ipv6_reass_frag(ipv6_reass_frag1, sizeof(ipv6_reass_frag1),
+			     payload1_len, 0, NET_OK);
+
+	if (k_sem_take(&wait_data, WAIT_TIME)) {
+		NET_DBG("Timeout while waiting interface data");
+		zassert_true(false, "Timeout");
+	}
+
+	zassert_equal(pending_reassemblies(), 0, "Reassembly left pending");
+
+	net_icmp_cleanup_ctx(&ctx);
+}
+
+/* Overlapping fragments discard the whole packet (RFC 5722) */
+ZTEST(net_ipv6_fragment, test_recv_ipv6_fragment_overlap)
+{
+	uint16_t payload1_len = NET_IPV6_MTU - sizeof(ipv6_reass_frag1);
+	uint16_t payload2_len = test_recv_payload_len - payload1_len;
+	uint8_t frag2[sizeof(ipv6_reass_frag2)];
+
+	/* Second fragment starting 8 bytes before the end of the first one */
+	memcpy(frag2, ipv6_reass_frag2, sizeof(frag2));
+	frag2[NET_IPV6H_LEN + 3] -= 8;
+
+	recv_ipv6_reass_frag(ipv6_reass_frag1, sizeof(ipv6_reass_frag1),
+			     payload1_len, 0, NET_OK);
+	zassert_equal(pending_reassemblies(), 1, "Expected a pending reassembly");
+
+	recv_ipv6_reass_frag(frag2, sizeof(frag2), payload2_len + 8,
+			     payload1_len - 8, NET_DROP);
+	zassert_equal(pending_reassemblies(), 0, "Reassembly not discarded");
+
+	zassert_equal(k_sem_take(&wait_data, K_MSEC(100)), -EAGAIN,
+		      "Packet should not be reassembled");
+}
+
 ZTEST_SUITE(net_ipv6_fragment, NULL, test_setup, NULL, NULL, NULL);
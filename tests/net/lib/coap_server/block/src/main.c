@@ -0,0 +1,377 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/ztest.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/coap_client.h>
+#include <zephyr/net/coap_service.h>
+#include <zephyr/timing/timing.h>
+
+#define SERVER_ADDR "127.0.0.1"
+#define SERVER_PORT 5683
+
+#define LARGE_SIZE (1024 * 1024)
+#define SMALL_SIZE 2500
+#define REORDER_SIZE (16 * 1024)
+#define REORDER_BLOCK 2
+
+static const uint16_t service_port = SERVER_PORT;
+COAP_SERVICE_DEFINE(test_service, SERVER_ADDR, &service_port, COAP_SERVICE_AUTOSTART);
+
+static inline uint8_t pattern(size_t offset)
+{
+	return (uint8_t)(offset % 251);
+}
+
+static int read_pattern(size_t offset, uint8_t *buf, size_t len, bool *last_block,
+			void *user_data)
+{
+	size_t size = POINTER_TO_UINT(user_data);
+
+	len = MIN(len, size - MIN(offset, size));
+
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = pattern(offset + i);
+	}
+
+	*last_block = offset + len >= size;
+
+	return len;
+}
+
+static int get_large(struct coap_resource *resource, struct coap_packet *request,
+		     struct sockaddr *addr, socklen_t addr_len)
+{
+	return coap_resource_send_block2(resource, request, addr, addr_len,
+					 COAP_CONTENT_FORMAT_APP_OCTET_STREAM, LARGE_SIZE,
+					 read_pattern, UINT_TO_POINTER(LARGE_SIZE));
+}
+
+/* The size is not announced, the client finds the end with the last block */
+static int get_small(struct coap_resource *resource, struct coap_packet *request,
+		     struct sockaddr *addr, socklen_t addr_len)
+{
+	return coap_resource_send_block2(resource, request, addr, addr_len,
+					 COAP_CONTENT_FORMAT_APP_OCTET_STREAM, 0,
+					 read_pattern, UINT_TO_POINTER(SMALL_SIZE));
+}
+
+/* The request for REORDER_BLOCK is answered after the request following it */
+static uint8_t reorder_buf[128];
+static uint16_t reorder_len;
+static struct sockaddr reorder_addr;
+static socklen_t reorder_addr_len;
+static bool reorder_held;
+static bool reorder_done;
+
+static int get_reorder(struct coap_resource *resource, struct coap_packet *request,
+		       struct sockaddr *addr, socklen_t addr_len)
+{
+	int block = coap_get_option_int(request, COAP_OPTION_BLOCK2);
+	struct coap_packet held;
+	int ret;
+
+	if (!reorder_done && block > 0 && GET_BLOCK_NUM(block) == REORDER_BLOCK &&
+	    request->offset <= sizeof(reorder_buf)) {
+		memcpy(reorder_buf, request->data, request->offset);
+		reorder_len = request->offset;
+		memcpy(&reorder_addr, addr, addr_len);
+		reorder_addr_len = addr_len;
+		reorder_held = true;
+		reorder_done = true;
+		return 0;
+	}
+
+	ret = coap_resource_send_block2(resource, request, addr, addr_len,
+					COAP_CONTENT_FORMAT_APP_OCTET_STREAM, REORDER_SIZE,
+					read_pattern, UINT_TO_POINTER(REORDER_SIZE));
+	if (ret < 0 || !reorder_held) {
+		return ret;
+	}
+
+	reorder_held = false;
+
+	ret = coap_packet_parse(&held, reorder_buf, reorder_len, NULL, 0);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return coap_resource_send_block2(resource, &held, &reorder_addr, reorder_addr_len,
+					 COAP_CONTENT_FORMAT_APP_OCTET_STREAM, REORDER_SIZE,
+					 read_pattern, UINT_TO_POINTER(REORDER_SIZE));
+}
+
+static size_t upload_received;
+static bool upload_done;
+
+static int write_pattern(size_t offset, const uint8_t *buf, size_t len, bool last_block,
+			 void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	if (offset != upload_received) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		if (buf[i] != pattern(offset + i)) {
+			return -EIO;
+		}
+	}
+
+	upload_received += len;
+	upload_done = last_block;
+
+	return 0;
+}
+
+static int put_upload(struct coap_resource *resource, struct coap_packet *request,
+		      struct sockaddr *addr, socklen_t addr_len)
+{
+	return coap_resource_recv_block1(resource, request, addr, addr_len, write_pattern, NULL);
+}
+
+static const char * const res_large_path[] = { "large", NULL };
+COAP_RESOURCE_DEFINE(res_large, test_service, {
+	.path = res_large_path,
+	.get = get_large,
+});
+
+static const char * const res_small_path[] = { "small", NULL };
+COAP_RESOURCE_DEFINE(res_small, test_service, {
+	.path = res_small_path,
+	.get = get_small,
+});
+
+static const char * const res_reorder_path[] = { "reorder", NULL };
+COAP_RESOURCE_DEFINE(res_reorder, test_service, {
+	.path = res_reorder_path,
+	.get = get_reorder,
+});
+
+static const char * const res_upload_path[] = { "upload", NULL };
+COAP_RESOURCE_DEFINE(res_upload, test_service, {
+	.path = res_upload_path,
+	.put = put_upload,
+});
+
+static struct coap_client client;
+static int client_fd = -1;
+static struct sockaddr_in server_addr = {
+	.sin_family = AF_INET,
+	.sin_port = htons(SERVER_PORT),
+};
+
+static K_SEM_DEFINE(response_sem, 0, 1);
+static int16_t response_code;
+static size_t response_received;
+static bool response_valid;
+
+static void response_cb(int16_t result_code, size_t offset, const uint8_t *payload,
+			size_t len, bool last_block, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	response_code = result_code;
+
+	if (result_code < 0) {
+		k_sem_give(&response_sem);
+		return;
+	}
+
+	if (offset != response_received) {
+		response_valid = false;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		if (payload[i] != pattern(offset + i)) {
+			response_valid = false;
+			break;
+		}
+	}
+
+	response_received += len;
+
+	if (last_block) {
+		k_sem_give(&response_sem);
+	}
+}
+
+static int payload_cb(size_t offset, const uint8_t **payload, size_t *len, bool *last_block,
+		      void *user_data)
+{
+	static uint8_t block[CONFIG_COAP_CLIENT_BLOCK_SIZE];
+	size_t size = POINTER_TO_UINT(user_data);
+
+	*len = MIN(*len, size - MIN(offset, size));
+
+	for (size_t i = 0; i < *len; i++) {
+		block[i] = pattern(offset + i);
+	}
+
+	*payload = block;
+	*last_block = offset + *len >= size;
+
+	return 0;
+}
+
+static uint64_t client_request(struct coap_client_request *req)
+{
+	timing_t start_time, end_time;
+	int ret;
+
+	response_code = 0;
+	response_received = 0;
+	response_valid = true;
+	k_sem_reset(&response_sem);
+
+	timing_init();
+	timing_start();
+
+	start_time = timing_counter_get();
+
+	ret = coap_client_req(&client, client_fd, (struct sockaddr *)&server_addr, req, NULL);
+	zassert_equal(ret, 0, "Cannot send request (%d)", ret);
+
+	ret = k_sem_take(&response_sem, K_SECONDS(60));
+	zassert_equal(ret, 0, "No response");
+
+	end_time = timing_counter_get();
+
+	timing_stop();
+
+	return timing_cycles_to_ns(timing_cycles_get(&start_time, &end_time));
+}
+
+static void print_rate(const char *name, size_t size, uint64_t ns)
+{
+	if (ns == 0) {
+		TC_PRINT("%s of %zu bytes, too fast to measure\n", name, size);
+		return;
+	}
+
+	TC_PRINT("%s of %zu bytes in %llu us, %llu kB/s (window %d)\n", name, size,
+		 ns / NSEC_PER_USEC, (uint64_t)size * NSEC_PER_SEC / ns / 1024,
+		 CONFIG_COAP_CLIENT_BLOCK2_WINDOW);
+}
+
+static void *coap_block_setup(void)
+{
+	int ret;
+
+	zsock_inet_pton(AF_INET, SERVER_ADDR, &server_addr.sin_addr);
+
+	client_fd = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(client_fd >= 0, "Cannot create socket (%d)", -errno);
+
+	ret = coap_client_init(&client, NULL);
+	zassert_equal(ret, 0, "Cannot init client (%d)", ret);
+
+	/* The server thread starts the service once the network is up */
+	for (int i = 0; i < 100 && coap_service_is_running(&test_service) != 1; i++) {
+		k_msleep(10);
+	}
+
+	zassert_equal(coap_service_is_running(&test_service), 1, "Service not started");
+
+	return NULL;
+}
+
+static void coap_block_teardown(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	zsock_close(client_fd);
+}
+
+ZTEST(coap_block, test_download)
+{
+	struct coap_client_request req = {
+		.method = COAP_METHOD_GET,
+		.confirmable = true,
+		.path = "large",
+		.cb = response_cb,
+	};
+	uint64_t ns;
+
+	ns = client_request(&req);
+
+	zassert_equal(response_code, COAP_RESPONSE_CODE_CONTENT);
+	zassert_equal(response_received, LARGE_SIZE);
+	zassert_true(response_valid, "Invalid payload");
+
+	print_rate("Download", LARGE_SIZE, ns);
+}
+
+ZTEST(coap_block, test_download_unknown_size)
+{
+	struct coap_client_request req = {
+		.method = COAP_METHOD_GET,
+		.confirmable = true,
+		.path = "small",
+		.cb = response_cb,
+	};
+
+	client_request(&req);
+
+	zassert_equal(response_code, COAP_RESPONSE_CODE_CONTENT);
+	zassert_equal(response_received, SMALL_SIZE);
+	zassert_true(response_valid, "Invalid payload");
+}
+
+ZTEST(coap_block, test_download_reordered)
+{
+	struct coap_client_request req = {
+		.method = COAP_METHOD_GET,
+		.confirmable = false,
+		.path = "reorder",
+		.cb = response_cb,
+	};
+
+	/* Only a window has the next block requested before a block is received */
+	if (CONFIG_COAP_CLIENT_BLOCK2_WINDOW == 1) {
+		ztest_test_skip();
+	}
+
+	reorder_held = false;
+	reorder_done = false;
+
+	client_request(&req);
+
+	zassert_true(reorder_done, "No block held back");
+	zassert_equal(response_code, COAP_RESPONSE_CODE_CONTENT);
+	zassert_equal(response_received, REORDER_SIZE);
+	zassert_true(response_valid, "Invalid payload");
+}
+
+ZTEST(coap_block, test_upload)
+{
+	struct coap_client_request req = {
+		.method = COAP_METHOD_PUT,
+		.confirmable = true,
+		.path = "upload",
+		.fmt = COAP_CONTENT_FORMAT_APP_OCTET_STREAM,
+		.payload_cb = payload_cb,
+		.cb = response_cb,
+		.user_data = UINT_TO_POINTER(LARGE_SIZE),
+	};
+	uint64_t ns;
+
+	upload_received = 0;
+	upload_done = false;
+
+	ns = client_request(&req);
+
+	zassert_equal(response_code, COAP_RESPONSE_CODE_CHANGED);
+	zassert_equal(upload_received, LARGE_SIZE);
+	zassert_true(upload_done);
+
+	print_rate("Upload", LARGE_SIZE, ns);
+}
+
+ZTEST_SUITE(coap_block, NULL, coap_block_setup, NULL, NULL, coap_block_teardown);
@@ -0,0 +1,377 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/ztest.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/coap_service.h>
+#include <zephyr/timing/timing.h>
+
+#define SERVER_ADDR "127.0.0.1"
+#define SERVER_PORT 5683
+
+#define BENCH_RESOURCES 32
+#define BENCH_REQUESTS 256
+
+static const uint16_t service_port = SERVER_PORT;
+COAP_SERVICE_DEFINE(test_service, SERVER_ADDR, &service_port, COAP_SERVICE_AUTOSTART);
+
+static struct coap_resource *matched;
+static uint8_t count_calls;
+
+static int get_match(struct coap_resource *resource, struct coap_packet *request,
+		     struct sockaddr *addr, socklen_t addr_len)
+{
+	ARG_UNUSED(request);
+	ARG_UNUSED(addr);
+	ARG_UNUSED(addr_len);
+
+	matched = resource;
+
+	return COAP_RESPONSE_CODE_CONTENT;
+}
+
+static int put_nothing(struct coap_resource *resource, struct coap_packet *request,
+		       struct sockaddr *addr, socklen_t addr_len)
+{
+	ARG_UNUSED(resource);
+	ARG_UNUSED(request);
+	ARG_UNUSED(addr);
+	ARG_UNUSED(addr_len);
+
+	return COAP_RESPONSE_CODE_CHANGED;
+}
+
+/* Reply with the number of times the handler ran */
+static int get_count(struct coap_resource *resource, struct coap_packet *request,
+		     struct sockaddr *addr, socklen_t addr_len)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	struct coap_packet response;
+	uint8_t data[32];
+	uint8_t tkl;
+	int ret;
+
+	count_calls++;
+
+	if (coap_header_get_type(request) == COAP_TYPE_CON) {
+		ret = coap_ack_init(&response, request, data, sizeof(data),
+				    COAP_RESPONSE_CODE_CONTENT);
+	} else {
+		tkl = coap_header_get_token(request, token);
+		ret = coap_packet_init(&response, data, sizeof(data), COAP_VERSION_1,
+				       COAP_TYPE_NON_CON, tkl, token, COAP_RESPONSE_CODE_CONTENT,
+				       coap_next_id());
+	}
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = coap_packet_append_payload_marker(&response);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = coap_packet_append_payload(&response, &count_calls, sizeof(count_calls));
+	if (ret < 0) {
+		return ret;
+	}
+
+	return coap_resource_send(resource, &response, addr, addr_len, NULL);
+}
+
+static const char * const res_a_b_path[] = { "a", "b", NULL };
+COAP_RESOURCE_DEFINE(res_a_b, test_service, {
+	.path = res_a_b_path,
+	.get = get_match,
+});
+
+static const char * const res_count_path[] = { "count", NULL };
+COAP_RESOURCE_DEFINE(res_count, test_service, {
+	.path = res_count_path,
+	.get = get_count,
+});
+
+static const char * const res_multi_path[] = { "m", "#", NULL };
+COAP_RESOURCE_DEFINE(res_multi, test_service, {
+	.path = res_multi_path,
+	.get = get_match,
+});
+
+/* Resources are sorted by name, the wildcard comes first */
+static const char * const res_order_0_path[] = { "o", "+", NULL };
+COAP_RESOURCE_DEFINE(res_order_0, test_service, {
+	.path = res_order_0_path,
+	.get = get_match,
+});
+
+static const char * const res_order_1_path[] = { "o", "lit", NULL };
+COAP_RESOURCE_DEFINE(res_order_1, test_service, {
+	.path = res_order_1_path,
+	.get = get_match,
+});
+
+static const char * const res_put_path[] = { "put", NULL };
+COAP_RESOURCE_DEFINE(res_put, test_service, {
+	.path = res_put_path,
+	.put = put_nothing,
+});
+
+static const char * const res_single_path[] = { "w", "+", "x", NULL };
+COAP_RESOURCE_DEFINE(res_single, test_service, {
+	.path = res_single_path,
+	.get = get_match,
+});
+
+#define BENCH_RESOURCE_DEFINE(n, _)							\
+	static const char * const res_z_bench_##n##_path[] = { "bench", #n, NULL };	\
+	COAP_RESOURCE_DEFINE(res_z_bench_##n, test_service, {				\
+		.path = res_z_bench_##n##_path,						\
+		.get = get_match,							\
+	})
+
+LISTIFY(BENCH_RESOURCES, BENCH_RESOURCE_DEFINE, (;));
+
+static int client_fd = -1;
+static uint16_t message_id = 1;
+
+static void client_send(uint8_t type, uint8_t method, uint16_t id, const char *path)
+{
+	uint8_t token = (uint8_t)id;
+	struct coap_packet request;
+	uint8_t data[64];
+	int ret;
+
+	ret = coap_packet_init(&request, data, sizeof(data), COAP_VERSION_1, type,
+			       sizeof(token), &token, method, id);
+	zassert_equal(ret, 0, "Cannot init request (%d)", ret);
+
+	ret = coap_packet_set_path(&request, path);
+	zassert_equal(ret, 0, "Cannot set path %s (%d)", path, ret);
+
+	ret = zsock_send(client_fd, request.data, request.offset, 0);
+	zassert_equal(ret, request.offset, "Cannot send request (%d)", -errno);
+}
+
+static int client_recv(uint8_t *data, size_t len, struct coap_packet *response)
+{
+	int ret;
+
+	ret = zsock_recv(client_fd, data, len, 0);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	zassert_equal(coap_packet_parse(response, data, ret, NULL, 0), 0,
+		      "Invalid response");
+
+	return ret;
+}
+
+static uint8_t client_get(const char *path)
+{
+	struct coap_packet response;
+	uint8_t data[64];
+	uint16_t id = message_id++;
+	int ret;
+
+	client_send(COAP_TYPE_CON, COAP_METHOD_GET, id, path);
+
+	ret = client_recv(data, sizeof(data), &response);
+	zassert_true(ret > 0, "No response for %s (%d)", path, ret);
+	zassert_equal(coap_header_get_type(&response), COAP_TYPE_ACK);
+	zassert_equal(coap_header_get_id(&response), id);
+
+	return coap_header_get_code(&response);
+}
+
+/* Send a request to count and return the count from the response */
+static uint8_t count_get(uint8_t type, uint16_t id, uint8_t *data, size_t len, int *rx_len)
+{
+	struct coap_packet response;
+	const uint8_t *payload;
+	uint16_t payload_len;
+
+	client_send(type, COAP_METHOD_GET, id, "count");
+
+	*rx_len = client_recv(data, len, &response);
+	zassert_true(*rx_len > 0, "No count response (%d)", *rx_len);
+	zassert_equal(coap_header_get_type(&response),
+		      type == COAP_TYPE_CON ? COAP_TYPE_ACK : COAP_TYPE_NON_CON);
+
+	payload = coap_packet_get_payload(&response, &payload_len);
+	zassert_equal(payload_len, 1);
+
+	return payload[0];
+}
+
+static void *coap_requests_setup(void)
+{
+	struct timeval tv = { .tv_sec = 0, .tv_usec = 200 * USEC_PER_MSEC };
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(SERVER_PORT),
+	};
+	int ret;
+
+	zsock_inet_pton(AF_INET, SERVER_ADDR, &addr.sin_addr);
+
+	client_fd = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(client_fd >= 0, "Cannot create socket (%d)", -errno);
+
+	ret = zsock_setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	zassert_equal(ret, 0, "Cannot set receive timeout (%d)", -errno);
+
+	ret = zsock_connect(client_fd, (struct sockaddr *)&addr, sizeof(addr));
+	zassert_equal(ret, 0, "Cannot connect (%d)", -errno);
+
+	/* The server thread starts the service once the network is up */
+	for (int i = 0; i < 100 && coap_service_is_running(&test_service) != 1; i++) {
+		k_msleep(10);
+	}
+
+	zassert_equal(coap_service_is_running(&test_service), 1, "Service not started");
+
+	return NULL;
+}
+
+static void coap_requests_teardown(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	zsock_close(client_fd);
+}
+
+ZTEST(coap_requests, test_path_match)
+{
+	static const struct {
+		const char *path;
+		struct coap_resource *resource;
+	} tests[] = {
+		{ "a/b", &res_a_b },
+		{ "a", NULL },
+		{ "a/b/c", NULL },
+		{ "b", NULL },
+		{ "o/lit", &res_order_0 },
+		{ "o/other", &res_order_0 },
+		{ "w/zz/x", &res_single },
+		{ "w/zz", NULL },
+		{ "w/zz/y", NULL },
+		{ "m", NULL },
+		{ "m/q", &res_multi },
+		{ "m/q/r", &res_multi },
+		{ "bench/0", &res_z_bench_0 },
+		{ "bench/17", &res_z_bench_17 },
+		{ "bench/31", &res_z_bench_31 },
+		{ "bench/32", NULL },
+	};
+	uint8_t code;
+
+	ARRAY_FOR_EACH(tests, i) {
+		matched = NULL;
+
+		code = client_get(tests[i].path);
+
+		if (tests[i].resource == NULL) {
+			zassert_equal(code, COAP_RESPONSE_CODE_NOT_FOUND,
+				      "Unexpected code %u for %s", code, tests[i].path);
+		} else {
+			zassert_equal(code, COAP_RESPONSE_CODE_CONTENT,
+				      "Unexpected code %u for %s", code, tests[i].path);
+		}
+
+		zassert_equal_ptr(matched, tests[i].resource, "Wrong resource for %s",
+				  tests[i].path);
+	}
+}
+
+ZTEST(coap_requests, test_method_not_allowed)
+{
+	zassert_equal(client_get("put"), COAP_RESPONSE_CODE_NOT_ALLOWED);
+}
+
+ZTEST(coap_requests, test_duplicate_con)
+{
+	uint8_t first[64];
+	uint8_t second[64];
+	uint16_t id = message_id++;
+	int first_len;
+	int second_len;
+	uint8_t count;
+
+	Z_TEST_SKIP_IFNDEF(CONFIG_COAP_SERVER_DEDUP_CACHE);
+
+	count_calls = 0;
+
+	count = count_get(COAP_TYPE_CON, id, first, sizeof(first), &first_len);
+	zassert_equal(count, 1);
+
+	/* A retransmission gets the same response without running the handler */
+	count = count_get(COAP_TYPE_CON, id, second, sizeof(second), &second_len);
+	zassert_equal(count, 1);
+	zassert_equal(count_calls, 1);
+	zassert_equal(first_len, second_len);
+	zassert_mem_equal(first, second, first_len);
+
+	count = count_get(COAP_TYPE_CON, message_id++, first, sizeof(first), &first_len);
+	zassert_equal(count, 2);
+}
+
+ZTEST(coap_requests, test_duplicate_non)
+{
+	uint8_t data[64];
+	uint16_t id = message_id++;
+	int len;
+	uint8_t count;
+
+	Z_TEST_SKIP_IFNDEF(CONFIG_COAP_SERVER_DEDUP_CACHE);
+
+	count_calls = 0;
+
+	count = count_get(COAP_TYPE_NON_CON, id, data, sizeof(data), &len);
+	zassert_equal(count, 1);
+
+	/* The duplicate is dropped, the next response is for the next request */
+	client_send(COAP_TYPE_NON_CON, COAP_METHOD_GET, id, "count");
+
+	count = count_get(COAP_TYPE_CON, message_id++, data, sizeof(data), &len);
+	zassert_equal(count, 2);
+	zassert_equal(count_calls, 2);
+}
+
+ZTEST(coap_requests, test_request_rate)
+{
+	timing_t start_time, end_time;
+	uint64_t ns;
+
+	timing_init();
+	timing_start();
+
+	start_time = timing_counter_get();
+
+	for (int i = 0; i < BENCH_REQUESTS; i++) {
+		zassert_equal(client_get("bench/31"), COAP_RESPONSE_CODE_CONTENT);
+	}
+
+	end_time = timing_counter_get();
+	ns = timing_cycles_to_ns(timing_cycles_get(&start_time, &end_time));
+
+	timing_stop();
+
+	zassert_equal_ptr(matched, &res_z_bench_31);
+
+	if (ns == 0) {
+		TC_PRINT("%d requests, too fast to measure\n", BENCH_REQUESTS);
+		return;
+	}
+
+	TC_PRINT("%d requests in %llu us, %llu requests/s\n", BENCH_REQUESTS,
+		 ns / NSEC_PER_USEC, (uint64_t)BENCH_REQUESTS * NSEC_PER_SEC / ns);
+}
+
+ZTEST_SUITE(coap_requests, NULL, coap_requests_setup, NULL, NULL, coap_requests_teardown);
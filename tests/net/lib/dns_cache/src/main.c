@@ -133,3 +133,131 @@ ZTEST(net_dns_cache_test, test_expired_entries_removed)
 	zassert_equal(1, dns_cache_find(&test_dns_cache, query, info_read, 3));
 	zassert_equal(AF_INET, info_read[0].ai_family);
 }
+
+ZTEST(net_dns_cache_test, test_negative_entry)
+{
+	struct dns_addrinfo info_write = {.ai_family = AF_INET};
+	struct dns_addrinfo info_read = {0};
+	const char *query = "example.com";
+	bool refresh;
+
+	zassert_ok(dns_cache_add_negative(&test_dns_cache, query, DNS_QUERY_TYPE_A,
+					  DNS_EAI_NONAME, TEST_DNS_CACHE_DEFAULT_TTL));
+	zassert_equal(DNS_EAI_NONAME, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A,
+						       &info_read, 1, &refresh));
+	zassert_false(refresh);
+	/* The legacy lookup only returns addresses */
+	zassert_equal(0, dns_cache_find(&test_dns_cache, query, &info_read, 1));
+
+	/* A positive answer replaces the negative one */
+	zassert_ok(dns_cache_add(&test_dns_cache, query, &info_write, TEST_DNS_CACHE_DEFAULT_TTL));
+	zassert_equal(1, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A, &info_read, 1,
+					  &refresh));
+
+	/* Negative entries expire with their TTL and are never served stale */
+	zassert_ok(dns_cache_add_negative(&test_dns_cache, query, DNS_QUERY_TYPE_AAAA,
+					  DNS_EAI_NODATA, TEST_DNS_CACHE_DEFAULT_TTL));
+	zassert_equal(DNS_EAI_NODATA, dns_cache_lookup(&test_dns_cache, query,
+						       DNS_QUERY_TYPE_AAAA, &info_read, 1,
+						       &refresh));
+	k_sleep(K_MSEC(TEST_DNS_CACHE_DEFAULT_TTL * 1000 + 1));
+	zassert_equal(0, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_AAAA, &info_read,
+					  1, &refresh));
+
+	zassert_equal(-EINVAL, dns_cache_add_negative(&test_dns_cache, query, DNS_QUERY_TYPE_A,
+						      DNS_EAI_FAIL, TEST_DNS_CACHE_DEFAULT_TTL));
+}
+
+ZTEST(net_dns_cache_test, test_query_type)
+{
+	struct dns_addrinfo info_write = {.ai_family = AF_INET};
+	struct dns_addrinfo info_read = {0};
+	const char *query = "example.com";
+	bool refresh;
+
+	zassert_ok(dns_cache_add(&test_dns_cache, query, &info_write, TEST_DNS_CACHE_DEFAULT_TTL));
+	zassert_equal(0, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_AAAA, &info_read,
+					  1, &refresh));
+	zassert_equal(1, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A, &info_read, 1,
+					  &refresh));
+	zassert_equal(AF_INET, info_read.ai_family);
+}
+
+ZTEST(net_dns_cache_test, test_serve_stale)
+{
+	struct dns_addrinfo info_write = {.ai_family = AF_INET};
+	struct dns_addrinfo info_read = {0};
+	const char *query = "example.com";
+	bool refresh;
+
+	zassert_ok(dns_cache_add(&test_dns_cache, query, &info_write, TEST_DNS_CACHE_DEFAULT_TTL));
+	k_sleep(K_MSEC(TEST_DNS_CACHE_DEFAULT_TTL * 1000 + 1));
+
+	/* The expired entry is still returned, once with a refresh request */
+	zassert_equal(1, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A, &info_read, 1,
+					  &refresh));
+	zassert_true(refresh);
+	zassert_equal(1, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A, &info_read, 1,
+					  &refresh));
+	zassert_false(refresh);
+
+	/* A failed refresh lets the next lookup try again */
+	dns_cache_refresh_failed(&test_dns_cache, query, DNS_QUERY_TYPE_A);
+	zassert_equal(1, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A, &info_read, 1,
+					  &refresh));
+	zassert_true(refresh);
+
+	/* A refreshed answer replaces the stale entry */
+	zassert_ok(dns_cache_add(&test_dns_cache, query, &info_write, TEST_DNS_CACHE_DEFAULT_TTL));
+	zassert_equal(1, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A, &info_read, 1,
+					  &refresh));
+	zassert_false(refresh);
+}
+
+ZTEST(net_dns_cache_test, test_prefetch)
+{
+	struct dns_addrinfo info_write = {.ai_family = AF_INET};
+	struct dns_addrinfo info_read = {0};
+	const char *query = "example.com";
+	bool refresh;
+
+	zassert_ok(dns_cache_add(&test_dns_cache, query, &info_write, TEST_DNS_CACHE_DEFAULT_TTL));
+
+	for (int i = 0; i < CONFIG_DNS_RESOLVER_CACHE_PREFETCH_HITS - 1; i++) {
+		zassert_equal(1, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A,
+						  &info_read, 1, &refresh));
+		zassert_false(refresh);
+	}
+
+	/* A popular entry is refreshed before it expires */
+	k_sleep(K_MSEC(TEST_DNS_CACHE_DEFAULT_TTL * 950));
+	zassert_equal(1, dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A, &info_read, 1,
+					  &refresh));
+	zassert_true(refresh);
+}
+
+ZTEST(net_dns_cache_test, test_stats)
+{
+	struct dns_addrinfo info_write = {.ai_family = AF_INET};
+	struct dns_addrinfo info_read = {0};
+	struct dns_resolve_cache_stats before, after;
+	const char *query = "example.com";
+	bool refresh;
+
+	zassert_ok(dns_cache_get_stats(&test_dns_cache, &before));
+
+	zassert_ok(dns_cache_add(&test_dns_cache, query, &info_write, TEST_DNS_CACHE_DEFAULT_TTL));
+	zassert_ok(dns_cache_add_negative(&test_dns_cache, "example.org", DNS_QUERY_TYPE_A,
+					  DNS_EAI_NONAME, TEST_DNS_CACHE_DEFAULT_TTL));
+	dns_cache_lookup(&test_dns_cache, query, DNS_QUERY_TYPE_A, &info_read, 1, &refresh);
+	dns_cache_lookup(&test_dns_cache, "example.org", DNS_QUERY_TYPE_A, &info_read, 1,
+			 &refresh);
+	dns_cache_lookup(&test_dns_cache, "example.net", DNS_QUERY_TYPE_A, &info_read, 1,
+			 &refresh);
+
+	zassert_ok(dns_cache_get_stats(&test_dns_cache, &after));
+	zassert_equal(after.hits - before.hits, 1);
+	zassert_equal(after.negative_hits - before.negative_hits, 1);
+	zassert_equal(after.misses - before.misses, 1);
+	zassert_equal(after.stale_hits - before.stale_hits, 0);
+}
@@ -1206,6 +1206,101 @@ ZTEST(dns_packet, test_dns_malformed_and_valid_responses)
 	test_dns_valid_responses();
 }
 
+static uint8_t resp_nxdomain_ipv4[] = {
+	/* DNS msg header (12 bytes), name error */
+	0xb0, 0x42, 0x81, 0x83, 0x00, 0x01, 0x00, 0x00,
+	0x00, 0x01, 0x00, 0x00,
+
+	/* Query string (www.zephyrproject.org) */
+	0x03, 0x77, 0x77, 0x77, 0x0d, 0x7a, 0x65, 0x70,
+	0x68, 0x79, 0x72, 0x70, 0x72, 0x6f, 0x6a, 0x65,
+	0x63, 0x74, 0x03, 0x6f, 0x72, 0x67, 0x00,
+
+	/* Query type */
+	0x00, 0x01,
+
+	/* Query class */
+	0x00, 0x01,
+
+	/* SOA of zephyrproject.org, TTL 900, 28 bytes of data */
+	0xc0, 0x10, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00,
+	0x03, 0x84, 0x00, 0x1c,
+
+	/* MNAME a.zephyrproject.org, RNAME b.zephyrproject.org */
+	0x01, 0x61, 0xc0, 0x10, 0x01, 0x62, 0xc0, 0x10,
+
+	/* Serial, refresh, retry, expire, minimum 60 */
+	0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10,
+	0x00, 0x00, 0x02, 0x58, 0x00, 0x09, 0x3a, 0x80,
+	0x00, 0x00, 0x00, 0x3c,
+};
+
+static void run_dns_negative_response(const char *test_case, uint8_t *buf, size_t len,
+				      int expected_ret)
+{
+	static const uint8_t query[] = {
+		/* Labels */
+		0x03, 0x77, 0x77, 0x77, 0x0d, 0x7a, 0x65, 0x70,
+		0x68, 0x79, 0x72, 0x70, 0x72, 0x6f, 0x6a, 0x65,
+		0x63, 0x74, 0x03, 0x6f, 0x72, 0x67, 0x00,
+		/* Query type */
+		0x00, 0x01
+	};
+	struct dns_msg_t dns_msg = { 0 };
+	uint16_t dns_id = 0;
+	int query_idx = -1;
+	uint16_t query_hash = 0;
+	uint32_t ttl = 0;
+	int ret;
+
+	dns_msg.msg = buf;
+	dns_msg.msg_size = len;
+
+	dns_id = dns_unpack_header_id(dns_msg.msg);
+
+	setup_dns_context(&dns_ctx, 0, dns_id, query, sizeof(query),
+			  DNS_QUERY_TYPE_A);
+
+	ret = dns_validate_msg(&dns_ctx, &dns_msg, &dns_id, &query_idx,
+			       NULL, &query_hash);
+	zassert_equal(ret, expected_ret, "[%s] Unexpected result (%d)",
+		      test_case, ret);
+
+	/* Only negative answers carry the SOA record */
+	if (expected_ret != DNS_EAI_NONAME && expected_ret != DNS_EAI_NODATA) {
+		return;
+	}
+
+	/* The negative TTL is the SOA minimum, lower than the SOA TTL */
+	ret = dns_unpack_soa_ttl(&dns_msg, &ttl);
+	zassert_equal(ret, 0, "[%s] Cannot get SOA TTL (%d)", test_case, ret);
+	zassert_equal(ttl, 60, "[%s] Invalid SOA TTL %u", test_case, ttl);
+}
+
+ZTEST(dns_packet, test_dns_negative_responses)
+{
+	run_dns_negative_response("nxdomain", resp_nxdomain_ipv4,
+				  sizeof(resp_nxdomain_ipv4), DNS_EAI_NONAME);
+
+	/* Same response without error code, the name has no A record */
+	resp_nxdomain_ipv4[3] = 0x80;
+	run_dns_negative_response("nodata", resp_nxdomain_ipv4,
+				  sizeof(resp_nxdomain_ipv4), DNS_EAI_NODATA);
+
+	/* A NODATA response to a question that we did not ask */
+	resp_nxdomain_ipv4[36] = 0x1c;
+	run_dns_negative_response("nodata question", resp_nxdomain_ipv4,
+				  sizeof(resp_nxdomain_ipv4), DNS_EAI_FAIL);
+	resp_nxdomain_ipv4[36] = 0x01;
+
+	/* A query shaped like a NODATA response is not an answer */
+	resp_nxdomain_ipv4[2] = 0x01;
+	run_dns_negative_response("nodata query", resp_nxdomain_ipv4,
+				  sizeof(resp_nxdomain_ipv4), 0);
+	resp_nxdomain_ipv4[2] = 0x81;
+	resp_nxdomain_ipv4[3] = 0x83;
+}
+
 ZTEST(dns_packet, test_dns_id_len)
 {
 	struct dns_msg_t dns_msg = { 0 };
@@ -0,0 +1,645 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/http/server.h>
+
+#define SERVER_ADDR "127.0.0.1"
+
+#define RECV_TIMEOUT_MS 2000
+#define CONN_BUF_SIZE 20480
+#define BENCH_REQUESTS 512
+#define BENCH_PIPELINE 8
+
+#define TEXT_64 "Lorem ipsum dolor sit amet, consectetur adipiscing elit sed do.\n"
+#define TEXT_1K TEXT_64 TEXT_64 TEXT_64 TEXT_64 TEXT_64 TEXT_64 TEXT_64 TEXT_64 \
+		TEXT_64 TEXT_64 TEXT_64 TEXT_64 TEXT_64 TEXT_64 TEXT_64 TEXT_64
+
+static uint16_t test_http_service_port;
+HTTP_SERVICE_DEFINE(test_http_service, SERVER_ADDR, &test_http_service_port, 3, 3, NULL);
+
+static const char index_html[] = "<html><body>Hello</body></html>\n";
+
+static struct http_resource_detail_static index_resource_detail = {
+	.common = {
+		.bitmask_of_supported_http_methods = BIT(HTTP_GET) | BIT(HTTP_HEAD),
+		.type = HTTP_RESOURCE_TYPE_STATIC,
+		.content_type = "text/html",
+	},
+	.static_data = index_html,
+	.static_data_len = sizeof(index_html) - 1,
+};
+
+HTTP_RESOURCE_DEFINE(index_resource, test_http_service, "/", &index_resource_detail);
+
+/* Large enough not to fit in the TCP send window in one go */
+static const char big_text[] = TEXT_1K TEXT_1K TEXT_1K TEXT_1K TEXT_1K TEXT_1K TEXT_1K
+			       TEXT_1K TEXT_1K TEXT_1K TEXT_1K TEXT_1K TEXT_1K TEXT_1K
+			       TEXT_1K TEXT_1K;
+
+static struct http_resource_detail_static big_resource_detail = {
+	.common = {
+		.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		.type = HTTP_RESOURCE_TYPE_STATIC,
+		.content_type = "text/plain",
+	},
+	.static_data = big_text,
+	.static_data_len = sizeof(big_text) - 1,
+};
+
+HTTP_RESOURCE_DEFINE(big_resource, test_http_service, "/big.txt", &big_resource_detail);
+
+#define DYNAMIC_CHUNKS 5
+
+/* GET answers with a few chunks, POST echoes the request body */
+static uint8_t echo_buf[1024];
+static size_t echo_len;
+static size_t echo_pos;
+static int chunks_left;
+static int final_count;
+
+static int dynamic_cb(struct http_client_ctx *client, enum http_data_status status,
+		      uint8_t *buffer, size_t len, void *user_data)
+{
+	size_t copy;
+
+	ARG_UNUSED(user_data);
+
+	switch (status) {
+	case HTTP_SERVER_DATA_MORE:
+		if (len > sizeof(echo_buf) - echo_len) {
+			return -ENOMEM;
+		}
+
+		memcpy(echo_buf + echo_len, buffer, len);
+		echo_len += len;
+		return 0;
+
+	case HTTP_SERVER_DATA_FINAL:
+		final_count++;
+		echo_pos = 0;
+		chunks_left = client->method == HTTP_GET ? DYNAMIC_CHUNKS : 0;
+		return 0;
+
+	case HTTP_SERVER_DATA_RESPONSE:
+		if (client->method == HTTP_GET) {
+			if (chunks_left == 0) {
+				return 0;
+			}
+
+			chunks_left--;
+			return snprintk(buffer, len, "chunk %d\n",
+					DYNAMIC_CHUNKS - chunks_left - 1);
+		}
+
+		copy = MIN(len, echo_len - echo_pos);
+		memcpy(buffer, echo_buf + echo_pos, copy);
+		echo_pos += copy;
+
+		if (copy == 0) {
+			echo_len = 0;
+		}
+
+		return copy;
+	}
+
+	return -EINVAL;
+}
+
+static struct http_resource_detail_dynamic dynamic_resource_detail = {
+	.common = {
+		.bitmask_of_supported_http_methods = BIT(HTTP_GET) | BIT(HTTP_POST),
+		.type = HTTP_RESOURCE_TYPE_DYNAMIC,
+		.content_type = "text/plain",
+	},
+	.cb = dynamic_cb,
+};
+
+HTTP_RESOURCE_DEFINE(dynamic_resource, test_http_service, "/dynamic", &dynamic_resource_detail);
+
+static const char dynamic_body[] = "chunk 0\nchunk 1\nchunk 2\nchunk 3\nchunk 4\n";
+
+struct conn {
+	int fd;
+	size_t len;
+	char buf[CONN_BUF_SIZE + 1];
+};
+
+struct response {
+	int status;
+	bool chunked;
+	bool close;
+	bool has_content_type;
+	long content_length;
+	size_t body_len;
+	char body[CONN_BUF_SIZE];
+};
+
+static struct conn conn;
+static struct response resp;
+
+static void conn_open(struct conn *c)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(test_http_service_port),
+	};
+	struct timeval tv = {
+		.tv_sec = RECV_TIMEOUT_MS / MSEC_PER_SEC,
+	};
+	int ret;
+
+	zsock_inet_pton(AF_INET, SERVER_ADDR, &addr.sin_addr);
+
+	c->len = 0;
+	c->fd = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(c->fd >= 0, "socket failed (%d)", errno);
+
+	ret = zsock_setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	zassert_ok(ret, "setsockopt failed (%d)", errno);
+
+	ret = zsock_connect(c->fd, (struct sockaddr *)&addr, sizeof(addr));
+	zassert_ok(ret, "connect failed (%d)", errno);
+}
+
+static void conn_close(struct conn *c)
+{
+	if (c->fd >= 0) {
+		zsock_close(c->fd);
+		c->fd = -1;
+	}
+}
+
+static void conn_send(struct conn *c, const char *data)
+{
+	size_t len = strlen(data);
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = zsock_send(c->fd, data, len, 0);
+		zassert_true(ret > 0, "send failed (%d)", errno);
+
+		data += ret;
+		len -= ret;
+	}
+}
+
+/* Returns the number of received bytes, 0 if the server closed */
+static int conn_fill(struct conn *c)
+{
+	ssize_t ret;
+
+	zassert_true(c->len < CONN_BUF_SIZE, "Receive buffer full");
+
+	ret = zsock_recv(c->fd, c->buf + c->len, CONN_BUF_SIZE - c->len, 0);
+	zassert_true(ret >= 0, "recv failed (%d)", errno);
+
+	c->len += ret;
+	c->buf[c->len] = '\0';
+
+	return ret;
+}
+
+static void conn_consume(struct conn *c, size_t len)
+{
+	c->len -= len;
+	memmove(c->buf, c->buf + len, c->len);
+	c->buf[c->len] = '\0';
+}
+
+static void conn_need(struct conn *c, size_t len)
+{
+	while (c->len < len) {
+		zassert_true(conn_fill(c) > 0, "Connection closed");
+	}
+}
+
+static char *conn_need_line(struct conn *c, const char *end)
+{
+	char *p;
+
+	while ((p = strstr(c->buf, end)) == NULL) {
+		zassert_true(conn_fill(c) > 0, "Connection closed");
+	}
+
+	return p;
+}
+
+static void body_add(struct response *r, const char *data, size_t len)
+{
+	zassert_true(len <= sizeof(r->body) - r->body_len, "Body too long");
+
+	memcpy(r->body + r->body_len, data, len);
+	r->body_len += len;
+}
+
+static void read_chunked_body(struct conn *c, struct response *r)
+{
+	unsigned long size;
+	char *end;
+
+	while (true) {
+		end = conn_need_line(c, "\r\n");
+		size = strtoul(c->buf, NULL, 16);
+		conn_consume(c, end + 2 - c->buf);
+
+		if (size == 0) {
+			conn_need(c, 2);
+			zassert_mem_equal(c->buf, "\r\n", 2, "Bad last chunk");
+			conn_consume(c, 2);
+			return;
+		}
+
+		conn_need(c, size + 2);
+		zassert_mem_equal(c->buf + size, "\r\n", 2, "Bad chunk end");
+		body_add(r, c->buf, size);
+		conn_consume(c, size + 2);
+	}
+}
+
+static void read_response(struct conn *c, struct response *r, bool head)
+{
+	char *headers_end;
+	char *line;
+	char *next;
+
+	memset(r, 0, offsetof(struct response, body));
+	r->content_length = -1;
+
+	headers_end = conn_need_line(c, "\r\n\r\n");
+	*headers_end = '\0';
+
+	zassert_ok(strncmp(c->buf, "HTTP/1.1 ", 9), "Bad status line");
+	r->status = atoi(c->buf + 9);
+
+	for (line = strstr(c->buf, "\r\n") + 2; line < headers_end; line = next + 2) {
+		next = strstr(line, "\r\n");
+		if (next == NULL) {
+			next = headers_end;
+		}
+
+		if (strncasecmp(line, "Content-Length:", 15) == 0) {
+			r->content_length = strtol(line + 15, NULL, 10);
+		} else if (strncasecmp(line, "Transfer-Encoding: chunked", 26) == 0) {
+			r->chunked = true;
+		} else if (strncasecmp(line, "Connection: close", 17) == 0) {
+			r->close = true;
+		} else if (strncasecmp(line, "Content-Type:", 13) == 0) {
+			r->has_content_type = true;
+		}
+	}
+
+	conn_consume(c, headers_end + 4 - c->buf);
+
+	if (head) {
+		return;
+	}
+
+	if (r->chunked) {
+		read_chunked_body(c, r);
+	} else if (r->content_length >= 0) {
+		conn_need(c, r->content_length);
+		body_add(r, c->buf, r->content_length);
+		conn_consume(c, r->content_length);
+	} else {
+		/* The end of the body is marked by closing the connection */
+		while (conn_fill(c) > 0) {
+		}
+
+		body_add(r, c->buf, c->len);
+		conn_consume(c, c->len);
+	}
+}
+
+static void assert_closed(struct conn *c)
+{
+	zassert_equal(conn_fill(c), 0, "Connection not closed");
+}
+
+static void request(const char *req, bool head)
+{
+	conn_send(&conn, req);
+	read_response(&conn, &resp, head);
+}
+
+#define GET(path) "GET " path " HTTP/1.1\r\nHost: " SERVER_ADDR "\r\n\r\n"
+
+ZTEST(http_server, test_static_resource)
+{
+	conn_open(&conn);
+
+	request(GET("/"), false);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_true(resp.has_content_type, "No Content-Type");
+	zassert_false(resp.close, "Connection not kept alive");
+	zassert_equal(resp.content_length, sizeof(index_html) - 1, "Bad Content-Length");
+	zassert_mem_equal(resp.body, index_html, sizeof(index_html) - 1, "Bad body");
+}
+
+ZTEST(http_server, test_static_resource_query)
+{
+	conn_open(&conn);
+
+	request(GET("/?foo=bar"), false);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_mem_equal(resp.body, index_html, sizeof(index_html) - 1, "Bad body");
+}
+
+ZTEST(http_server, test_large_static_resource)
+{
+	conn_open(&conn);
+
+	request(GET("/big.txt"), false);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_equal(resp.body_len, sizeof(big_text) - 1, "Bad length %zu", resp.body_len);
+	zassert_mem_equal(resp.body, big_text, sizeof(big_text) - 1, "Bad body");
+}
+
+ZTEST(http_server, test_head)
+{
+	conn_open(&conn);
+
+	request("HEAD / HTTP/1.1\r\n\r\n", true);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_equal(resp.content_length, sizeof(index_html) - 1, "Bad Content-Length");
+
+	/* No body, the next response follows the headers directly */
+	request(GET("/"), false);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_mem_equal(resp.body, index_html, sizeof(index_html) - 1, "Bad body");
+}
+
+ZTEST(http_server, test_keep_alive)
+{
+	conn_open(&conn);
+
+	for (int i = 0; i < 5; i++) {
+		request(GET("/"), false);
+
+		zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+		zassert_mem_equal(resp.body, index_html, sizeof(index_html) - 1, "Bad body");
+	}
+}
+
+ZTEST(http_server, test_pipelining)
+{
+	conn_open(&conn);
+
+	/* All requests in one segment, the responses come in the same order */
+	conn_send(&conn, GET("/") GET("/dynamic") GET("/missing") GET("/big.txt"));
+
+	read_response(&conn, &resp, false);
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_mem_equal(resp.body, index_html, sizeof(index_html) - 1, "Bad body");
+
+	read_response(&conn, &resp, false);
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_true(resp.chunked, "Not chunked");
+	zassert_mem_equal(resp.body, dynamic_body, sizeof(dynamic_body) - 1, "Bad body");
+
+	read_response(&conn, &resp, false);
+	zassert_equal(resp.status, 404, "Bad status %d", resp.status);
+
+	read_response(&conn, &resp, false);
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_mem_equal(resp.body, big_text, sizeof(big_text) - 1, "Bad body");
+}
+
+ZTEST(http_server, test_chunked_response)
+{
+	conn_open(&conn);
+
+	request(GET("/dynamic"), false);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_true(resp.chunked, "Not chunked");
+	zassert_equal(resp.content_length, -1, "Content-Length in chunked response");
+	zassert_equal(resp.body_len, sizeof(dynamic_body) - 1, "Bad length %zu",
+		      resp.body_len);
+	zassert_mem_equal(resp.body, dynamic_body, sizeof(dynamic_body) - 1, "Bad body");
+}
+
+ZTEST(http_server, test_post_echo)
+{
+	static const char req[] = "POST /dynamic HTTP/1.1\r\n"
+				  "Content-Length: 192\r\n\r\n"
+				  TEXT_64 TEXT_64 TEXT_64;
+
+	conn_open(&conn);
+
+	request(req, false);
+
+	/* The body is echoed in several chunks of the response buffer size */
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_true(resp.chunked, "Not chunked");
+	zassert_equal(resp.body_len, 192, "Bad length %zu", resp.body_len);
+	zassert_mem_equal(resp.body, TEXT_64 TEXT_64 TEXT_64, 192, "Bad body");
+}
+
+ZTEST(http_server, test_post_trailing_crlf)
+{
+	static const char req[] = "POST /dynamic HTTP/1.1\r\n"
+				  "Content-Length: 64\r\n\r\n"
+				  TEXT_64 "\r\n";
+
+	conn_open(&conn);
+	final_count = 0;
+
+	/* The CR/LF after the body is skipped, it is not another request */
+	request(req, false);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_mem_equal(resp.body, TEXT_64, 64, "Bad body");
+
+	request(GET("/"), false);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_mem_equal(resp.body, index_html, sizeof(index_html) - 1, "Bad body");
+	zassert_equal(final_count, 1, "Request answered %d times", final_count);
+}
+
+ZTEST(http_server, test_http_1_0)
+{
+	conn_open(&conn);
+
+	/* No chunked encoding in HTTP/1.0, the connection is closed instead */
+	request("GET /dynamic HTTP/1.0\r\n\r\n", false);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_false(resp.chunked, "Chunked response to HTTP/1.0");
+	zassert_true(resp.close, "Connection not closed");
+	zassert_mem_equal(resp.body, dynamic_body, sizeof(dynamic_body) - 1, "Bad body");
+}
+
+ZTEST(http_server, test_connection_close)
+{
+	conn_open(&conn);
+
+	request("GET / HTTP/1.1\r\nConnection: close\r\n\r\n", false);
+
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	zassert_true(resp.close, "No Connection: close");
+	assert_closed(&conn);
+}
+
+ZTEST(http_server, test_errors)
+{
+	char req[CONFIG_HTTP_SERVER_MAX_URL_LENGTH + 32];
+
+	conn_open(&conn);
+
+	request(GET("/missing"), false);
+	zassert_equal(resp.status, 404, "Bad status %d", resp.status);
+
+	request("DELETE / HTTP/1.1\r\n\r\n", false);
+	zassert_equal(resp.status, 405, "Bad status %d", resp.status);
+
+	snprintk(req, sizeof(req), "GET /%0*d HTTP/1.1\r\n\r\n",
+		 CONFIG_HTTP_SERVER_MAX_URL_LENGTH, 0);
+	request(req, false);
+	zassert_equal(resp.status, 414, "Bad status %d", resp.status);
+
+	/* The connection is still usable after the errors */
+	request(GET("/"), false);
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+
+	request("NOT HTTP\r\n\r\n", false);
+	zassert_equal(resp.status, 400, "Bad status %d", resp.status);
+	zassert_true(resp.close, "No Connection: close");
+	assert_closed(&conn);
+}
+
+ZTEST(http_server, test_max_clients)
+{
+	/* All the slots are taken, the next client is turned away */
+	static struct conn extra[CONFIG_HTTP_SERVER_MAX_CLIENTS];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(extra); i++) {
+		conn_open(&extra[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(extra); i++) {
+		conn_send(&extra[i], GET("/"));
+		read_response(&extra[i], &resp, false);
+		zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	}
+
+	conn_open(&conn);
+	assert_closed(&conn);
+
+	for (i = 0; i < ARRAY_SIZE(extra); i++) {
+		conn_close(&extra[i]);
+	}
+}
+
+static void print_rate(const char *name, int count, uint64_t ns)
+{
+	if (ns == 0) {
+		TC_PRINT("%s: %d requests, too fast to measure\n", name, count);
+		return;
+	}
+
+	TC_PRINT("%s: %d requests in %llu us, %llu requests/s\n", name, count,
+		 ns / NSEC_PER_USEC, (uint64_t)count * NSEC_PER_SEC / ns);
+}
+
+ZTEST(http_server, test_requests_per_second)
+{
+	static const char pipelined[] = GET("/") GET("/") GET("/") GET("/")
+					GET("/") GET("/") GET("/") GET("/");
+	timing_t start_time, end_time;
+	uint64_t ns;
+	int i, j;
+
+	BUILD_ASSERT(BENCH_REQUESTS % BENCH_PIPELINE == 0);
+
+	conn_open(&conn);
+
+	timing_init();
+	timing_start();
+
+	start_time = timing_counter_get();
+
+	for (i = 0; i < BENCH_REQUESTS; i++) {
+		request(GET("/"), false);
+		zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+	}
+
+	end_time = timing_counter_get();
+	ns = timing_cycles_to_ns(timing_cycles_get(&start_time, &end_time));
+	print_rate("keep-alive", BENCH_REQUESTS, ns);
+
+	start_time = timing_counter_get();
+
+	for (i = 0; i < BENCH_REQUESTS; i += BENCH_PIPELINE) {
+		conn_send(&conn, pipelined);
+
+		for (j = 0; j < BENCH_PIPELINE; j++) {
+			read_response(&conn, &resp, false);
+			zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+		}
+	}
+
+	end_time = timing_counter_get();
+	ns = timing_cycles_to_ns(timing_cycles_get(&start_time, &end_time));
+	print_rate("pipelined", BENCH_REQUESTS, ns);
+
+	timing_stop();
+}
+
+ZTEST(http_server, test_restart)
+{
+	zassert_equal(http_server_start(), -EALREADY, "Started twice");
+	zassert_ok(http_server_stop(), "Cannot stop");
+	zassert_equal(http_server_stop(), -EALREADY, "Stopped twice");
+	zassert_ok(http_server_start(), "Cannot restart");
+
+	conn_open(&conn);
+	request(GET("/"), false);
+	zassert_equal(resp.status, 200, "Bad status %d", resp.status);
+}
+
+static void *http_server_setup(void)
+{
+	zassert_ok(http_server_start(), "Cannot start server");
+	zassert_not_equal(test_http_service_port, 0, "No ephemeral port");
+
+	conn.fd = -1;
+
+	return NULL;
+}
+
+static void http_server_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	conn_close(&conn);
+
+	/* Let the closed connections go through TIME_WAIT */
+	k_sleep(K_MSEC(2 * CONFIG_NET_TCP_TIME_WAIT_DELAY));
+}
+
+static void http_server_teardown(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	(void)http_server_stop();
+}
+
+ZTEST_SUITE(http_server, NULL, http_server_setup, NULL, http_server_after,
+	    http_server_teardown);
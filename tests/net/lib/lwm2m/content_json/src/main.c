@@ -484,6 +484,44 @@ ZTEST(net_content_json_nomem, test_put_objlnk_nomem)
 	zassert_equal(ret, -ENOMEM, "Invalid error code returned");
 }
 
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+ZTEST(net_content_json, test_put_object_instance_window)
+{
+	static uint8_t expected_payload[sizeof(test_msg.msg_data)];
+	struct lwm2m_output_window window = { .len = 16 };
+	uint16_t expected_len;
+	uint16_t len;
+	int ret;
+
+	test_msg.path.level = LWM2M_PATH_LEVEL_OBJECT_INST;
+
+	ret = do_read_op_json(&test_msg, COAP_CONTENT_FORMAT_APP_JSON);
+	zassert_true(ret >= 0, "Error reported");
+
+	expected_len = test_msg.cpkt.offset - TEST_PAYLOAD_OFFSET;
+	memcpy(expected_payload, test_msg.msg_data + TEST_PAYLOAD_OFFSET, expected_len);
+	zassert_true(expected_len > window.len, "Payload should not fit into the window");
+
+	/* Each pass keeps the next part of the same payload */
+	for (window.start = 0; window.start < expected_len; window.start += window.len) {
+		context_reset();
+		test_msg.path.level = LWM2M_PATH_LEVEL_OBJECT_INST;
+		test_msg.out.window = &window;
+
+		ret = do_read_op_json(&test_msg, COAP_CONTENT_FORMAT_APP_JSON);
+		zassert_true(ret >= 0, "Error reported");
+		zassert_equal(window.total, expected_len, "Invalid payload length");
+
+		len = test_msg.cpkt.offset - TEST_PAYLOAD_OFFSET;
+		zassert_equal(len, MIN(window.len, expected_len - window.start),
+			      "Invalid packet offset");
+		zassert_mem_equal(test_msg.msg_data + TEST_PAYLOAD_OFFSET,
+				  expected_payload + window.start, len,
+				  "Invalid payload format");
+	}
+}
+#endif
+
 ZTEST(net_content_json, test_get_s32)
 {
 	int ret;
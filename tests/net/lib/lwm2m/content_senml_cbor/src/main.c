@@ -6,11 +6,16 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/ztest.h>
+#include <zephyr/sys/byteorder.h>
 
 #include "lwm2m_util.h"
 #include "lwm2m_rw_senml_cbor.h"
 #include "lwm2m_engine.h"
 
+/* Declaration of 'private' functions */
+int prepare_msg_for_send(struct lwm2m_message *msg);
+int build_msg_block_for_send(struct lwm2m_message *msg, uint16_t block_num);
+
 #define TEST_OBJ_ID 0xFFFF
 #define TEST_OBJ_INST_ID 0
 
@@ -29,6 +34,14 @@
 
 #define TEST_MAX_PAYLOAD_BUFFER_LENGTH 40
 
+/* Object with enough resource instances to need the longer array headers */
+#define TEST_MULTI_OBJ_ID 0xFFFE
+#define TEST_MULTI_RES_0 0
+#define TEST_MULTI_RES_1 1
+#define TEST_MULTI_RES_0_COUNT 24
+#define TEST_MULTI_RES_1_COUNT 232
+#define TEST_MULTI_RES_INST_COUNT (TEST_MULTI_RES_0_COUNT + TEST_MULTI_RES_1_COUNT)
+
 static struct lwm2m_engine_obj test_obj;
 
 struct test_payload_buffer {
@@ -100,6 +113,38 @@ static struct lwm2m_engine_obj_inst *test_obj_create(uint16_t obj_inst_id)
 	return &test_inst;
 }
 
+static struct lwm2m_engine_obj test_multi_obj;
+
+static struct lwm2m_engine_obj_field test_multi_fields[] = {
+	OBJ_FIELD_DATA(TEST_MULTI_RES_0, RW, S8),
+	OBJ_FIELD_DATA(TEST_MULTI_RES_1, RW, S8),
+};
+
+static struct lwm2m_engine_obj_inst test_multi_inst;
+static struct lwm2m_engine_res test_multi_res[ARRAY_SIZE(test_multi_fields)];
+static struct lwm2m_engine_res_inst test_multi_res_inst[TEST_MULTI_RES_INST_COUNT];
+static int8_t test_multi_s8[TEST_MULTI_RES_INST_COUNT];
+
+static struct lwm2m_engine_obj_inst *test_multi_obj_create(uint16_t obj_inst_id)
+{
+	int i = 0, j = 0;
+
+	init_res_instance(test_multi_res_inst, ARRAY_SIZE(test_multi_res_inst));
+
+	INIT_OBJ_RES_MULTI_DATA(TEST_MULTI_RES_0, test_multi_res, i, test_multi_res_inst, j,
+				TEST_MULTI_RES_0_COUNT, true, &test_multi_s8[0],
+				sizeof(test_multi_s8[0]));
+	INIT_OBJ_RES_MULTI_DATA(TEST_MULTI_RES_1, test_multi_res, i, test_multi_res_inst, j,
+				TEST_MULTI_RES_1_COUNT, true,
+				&test_multi_s8[TEST_MULTI_RES_0_COUNT],
+				sizeof(test_multi_s8[0]));
+
+	test_multi_inst.resources = test_multi_res;
+	test_multi_inst.resource_count = i;
+
+	return &test_multi_inst;
+}
+
 static void *test_obj_init(void)
 {
 	struct lwm2m_engine_obj_inst *obj_inst = NULL;
@@ -116,6 +161,18 @@ static void *test_obj_init(void)
 	(void)lwm2m_register_obj(&test_obj);
 	(void)lwm2m_create_obj_inst(TEST_OBJ_ID, TEST_OBJ_INST_ID, &obj_inst);
 
+	test_multi_obj.obj_id = TEST_MULTI_OBJ_ID;
+	test_multi_obj.version_major = 1;
+	test_multi_obj.version_minor = 0;
+	test_multi_obj.is_core = false;
+	test_multi_obj.fields = test_multi_fields;
+	test_multi_obj.field_count = ARRAY_SIZE(test_multi_fields);
+	test_multi_obj.max_instance_count = 1U;
+	test_multi_obj.create_cb = test_multi_obj_create;
+
+	(void)lwm2m_register_obj(&test_multi_obj);
+	(void)lwm2m_create_obj_inst(TEST_MULTI_OBJ_ID, TEST_OBJ_INST_ID, &obj_inst);
+
 	return NULL;
 }
 
@@ -955,6 +1012,220 @@ ZTEST(net_content_senml_cbor_nomem, test_put_time_nomem)
 	zassert_equal(ret, -ENOMEM, "Invalid error code returned");
 }
 
+ZTEST(net_content_senml_cbor, test_put_object_instance)
+{
+	int ret;
+	struct test_payload_buffer expected_payload = {
+		.data = {
+			(0x04 << 5) | TEST_OBJ_RES_MAX_ID,
+			(0x05 << 5) | 3,
+			(0x01 << 5) | 1,
+			(0x03 << 5) | 9,
+			'/', '6', '5', '5', '3', '5', '/', '0', '/',
+			(0x00 << 5) | 0,
+			(0x03 << 5) | 1,
+			'0',
+			(0x00 << 5) | 2,
+			(0x00 << 5) | 0,
+			(0x05 << 5) | 2,
+			(0x00 << 5) | 0,
+			(0x03 << 5) | 1,
+			'1',
+			(0x00 << 5) | 2,
+			(0x00 << 5) | 0
+		},
+		.len = 24
+	};
+
+	/* One record per resource, more than CONFIG_LWM2M_RW_SENML_CBOR_RECORDS
+	 * in the few records configuration.
+	 */
+	test_s8 = 0;
+	test_s16 = 0;
+	test_msg.path.level = LWM2M_PATH_LEVEL_OBJECT_INST;
+
+	ret = do_read_op_senml_cbor(&test_msg);
+	zassert_true(ret >= 0, "Error reported");
+
+	zassert_mem_equal(test_msg.msg_data + TEST_PAYLOAD_OFFSET,
+			  expected_payload.data,
+			  expected_payload.len,
+			  "Invalid payload format");
+}
+
+/* Append the record of a resource instance of the multi instance object */
+static size_t test_multi_record_put(uint8_t *buf, uint16_t res_id, uint16_t res_inst_id,
+				    bool first)
+{
+	char name[sizeof("65535/65535")];
+	size_t off = 0;
+	int len;
+
+	buf[off++] = (0x05 << 5) | (first ? 3 : 2);
+
+	if (first) {
+		buf[off++] = (0x01 << 5) | 1;
+		buf[off++] = (0x03 << 5) | 9;
+		memcpy(&buf[off], "/65534/0/", 9);
+		off += 9;
+	}
+
+	len = snprintk(name, sizeof(name), "%u/%u", res_id, res_inst_id);
+	buf[off++] = (0x00 << 5) | 0;
+	buf[off++] = (0x03 << 5) | len;
+	memcpy(&buf[off], name, len);
+	off += len;
+
+	buf[off++] = (0x00 << 5) | 2;
+	buf[off++] = (0x00 << 5) | 0;
+
+	return off;
+}
+
+/* Append the records of the whole multi instance object */
+static size_t test_multi_inst_put(uint8_t *buf)
+{
+	size_t len = 0;
+	int i;
+
+	buf[len++] = (0x04 << 5) | 25;
+	sys_put_be16(TEST_MULTI_RES_INST_COUNT, &buf[len]);
+	len += 2;
+
+	for (i = 0; i < TEST_MULTI_RES_0_COUNT; i++) {
+		len += test_multi_record_put(&buf[len], TEST_MULTI_RES_0, i, i == 0);
+	}
+
+	for (i = 0; i < TEST_MULTI_RES_1_COUNT; i++) {
+		len += test_multi_record_put(&buf[len], TEST_MULTI_RES_1, i, false);
+	}
+
+	return len;
+}
+
+ZTEST(net_content_senml_cbor, test_put_many_records)
+{
+	static uint8_t expected_payload[sizeof(test_msg.msg_data)];
+	size_t len;
+	int ret;
+	int i;
+
+	/* 24 records, the count takes one extra byte */
+	len = 0;
+	expected_payload[len++] = (0x04 << 5) | 24;
+	expected_payload[len++] = TEST_MULTI_RES_0_COUNT;
+
+	for (i = 0; i < TEST_MULTI_RES_0_COUNT; i++) {
+		len += test_multi_record_put(&expected_payload[len], TEST_MULTI_RES_0, i,
+					     i == 0);
+	}
+
+	test_msg.path.obj_id = TEST_MULTI_OBJ_ID;
+	test_msg.path.res_id = TEST_MULTI_RES_0;
+
+	ret = do_read_op_senml_cbor(&test_msg);
+	zassert_true(ret >= 0, "Error reported");
+
+	zassert_equal(test_msg.cpkt.offset, TEST_PAYLOAD_OFFSET + len,
+		      "Invalid packet offset");
+	zassert_mem_equal(test_msg.msg_data + TEST_PAYLOAD_OFFSET, expected_payload, len,
+			  "Invalid payload format");
+
+	/* 256 records, the count takes two extra bytes */
+	context_reset();
+
+	len = test_multi_inst_put(expected_payload);
+
+	test_msg.path.obj_id = TEST_MULTI_OBJ_ID;
+	test_msg.path.level = LWM2M_PATH_LEVEL_OBJECT_INST;
+
+	ret = do_read_op_senml_cbor(&test_msg);
+	zassert_true(ret >= 0, "Error reported");
+
+	zassert_equal(test_msg.cpkt.offset, TEST_PAYLOAD_OFFSET + len,
+		      "Invalid packet offset");
+	zassert_mem_equal(test_msg.msg_data + TEST_PAYLOAD_OFFSET, expected_payload, len,
+			  "Invalid payload format");
+}
+
+#if defined(CONFIG_LWM2M_COAP_BLOCK_ON_DEMAND)
+ZTEST(net_content_senml_cbor, test_put_many_records_block_on_demand)
+{
+	static uint8_t expected_payload[sizeof(test_msg.msg_data)];
+	static uint8_t received_payload[sizeof(test_msg.msg_data)];
+	const uint16_t block_size = CONFIG_LWM2M_COAP_BLOCK_SIZE;
+	struct lwm2m_obj_path_list path_entry = {
+		.path = LWM2M_OBJ(TEST_MULTI_OBJ_ID, TEST_OBJ_INST_ID),
+	};
+	struct lwm2m_ctx ctx = { 0 };
+	sys_slist_t path_list;
+	const uint8_t *payload;
+	uint16_t payload_len;
+	size_t received = 0;
+	size_t len;
+	int block;
+	int ret;
+
+	len = test_multi_inst_put(expected_payload);
+	zassert_true(len > CONFIG_LWM2M_COAP_ENCODE_BUFFER_SIZE,
+		     "The payload should not fit into the encode buffer");
+
+	sys_slist_init(&path_list);
+	sys_slist_append(&path_list, &path_entry.node);
+
+	memset(&test_msg, 0, sizeof(test_msg));
+	test_msg.ctx = &ctx;
+	test_msg.type = COAP_TYPE_NON_CON;
+	test_msg.code = COAP_METHOD_POST;
+
+	ret = lwm2m_init_message(&test_msg);
+	zassert_ok(ret, "Failed to initialize lwm2m message");
+
+	test_msg.out.writer = &senml_cbor_writer;
+	test_msg.out.out_cpkt = &test_msg.cpkt;
+
+	ret = do_composite_read_op_for_parsed_list(&test_msg, LWM2M_FORMAT_APP_SENML_CBOR,
+						   &path_list);
+	zassert_ok(ret, "Error reported");
+
+	ret = prepare_msg_for_send(&test_msg);
+	zassert_ok(ret, "Could not create first block");
+
+	for (block = 0; received < len; block++) {
+		if (block > 0) {
+			ret = build_msg_block_for_send(&test_msg, block);
+			zassert_ok(ret, "Could not create block %d", block);
+		}
+
+		/* Only one block is kept in the encode buffer */
+		coap_packet_get_payload(&test_msg.body_encode_buffer, &payload_len);
+		zassert_true(payload_len <= block_size, "Encode buffer holds more than a block");
+
+		payload = coap_packet_get_payload(&test_msg.cpkt, &payload_len);
+		zassert_not_null(payload, "Payload expected");
+		zassert_equal(payload_len, MIN(block_size, len - received), "Wrong payload size");
+		zassert_true(coap_get_option_int(&test_msg.cpkt, COAP_OPTION_ETAG) >= 0,
+			     "ETag option not set");
+
+		memcpy(&received_payload[received], payload, payload_len);
+		received += payload_len;
+	}
+
+	zassert_mem_equal(received_payload, expected_payload, len, "Invalid payload format");
+
+	ret = build_msg_block_for_send(&test_msg, block);
+	zassert_equal(ret, -EINVAL, "Block after the payload should not exist");
+
+	/* A value changing between two blocks aborts the transfer */
+	test_multi_s8[0] = 1;
+	ret = build_msg_block_for_send(&test_msg, 1);
+	test_multi_s8[0] = 0;
+	zassert_equal(ret, -EAGAIN, "Changed payload not detected");
+
+	lwm2m_reset_message(&test_msg, true);
+}
+#endif
+
 ZTEST(net_content_senml_cbor, test_get_s32)
 {
 	int ret;
@@ -0,0 +1,275 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/net/coap.h>
+
+#include "lwm2m_engine.h"
+#include "lwm2m_object.h"
+
+#define TEST_OBJ_ID 32768
+#define BENCH_OBJ_ID 32769
+
+#define BENCH_MAX_INSTANCES 32
+#define BENCH_RESOURCES 8
+#define BENCH_WRITES 4096
+#define BENCH_OBSERVERS 4
+
+static struct lwm2m_engine_obj bench_obj;
+static struct lwm2m_engine_obj_field bench_fields[BENCH_RESOURCES];
+
+static struct lwm2m_engine_obj_inst bench_inst[BENCH_MAX_INSTANCES];
+static struct lwm2m_engine_res bench_res[BENCH_MAX_INSTANCES][BENCH_RESOURCES];
+static struct lwm2m_engine_res_inst bench_res_inst[BENCH_MAX_INSTANCES][BENCH_RESOURCES];
+static uint32_t bench_data[BENCH_MAX_INSTANCES][BENCH_RESOURCES];
+
+static struct lwm2m_engine_obj_inst *bench_obj_create(uint16_t obj_inst_id)
+{
+	int index, k, i = 0, j = 0;
+
+	for (index = 0; index < BENCH_MAX_INSTANCES; index++) {
+		if (bench_inst[index].obj && bench_inst[index].obj_inst_id == obj_inst_id) {
+			return NULL;
+		}
+	}
+
+	/* Reuse the first free slot, so that the storage of a deleted instance
+	 * ends up behind a different path.
+	 */
+	for (index = 0; index < BENCH_MAX_INSTANCES; index++) {
+		if (!bench_inst[index].obj) {
+			break;
+		}
+	}
+
+	if (index >= BENCH_MAX_INSTANCES) {
+		return NULL;
+	}
+
+	(void)memset(bench_res[index], 0, sizeof(bench_res[index]));
+	init_res_instance(bench_res_inst[index], ARRAY_SIZE(bench_res_inst[index]));
+
+	for (k = 0; k < BENCH_RESOURCES; k++) {
+		INIT_OBJ_RES_DATA(k, bench_res[index], i, bench_res_inst[index], j,
+				  &bench_data[index][k], sizeof(bench_data[index][k]));
+	}
+
+	bench_inst[index].resources = bench_res[index];
+	bench_inst[index].resource_count = i;
+
+	return &bench_inst[index];
+}
+
+static int bench_obj_init(void)
+{
+	int i;
+
+	for (i = 0; i < BENCH_RESOURCES; i++) {
+		bench_fields[i] = (struct lwm2m_engine_obj_field)OBJ_FIELD_DATA(i, RW, U32);
+	}
+
+	bench_obj.obj_id = BENCH_OBJ_ID;
+	bench_obj.version_major = 1;
+	bench_obj.version_minor = 0;
+	bench_obj.is_core = false;
+	bench_obj.fields = bench_fields;
+	bench_obj.field_count = ARRAY_SIZE(bench_fields);
+	bench_obj.max_instance_count = BENCH_MAX_INSTANCES;
+	bench_obj.create_cb = bench_obj_create;
+	lwm2m_register_obj(&bench_obj);
+
+	return 0;
+}
+
+SYS_INIT(bench_obj_init, APPLICATION, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+
+static void bench_create(int count)
+{
+	struct lwm2m_engine_obj_inst *obj_inst;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		zassert_equal(lwm2m_create_obj_inst(BENCH_OBJ_ID, i, &obj_inst), 0);
+	}
+}
+
+static void bench_delete(int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		zassert_equal(lwm2m_delete_obj_inst(BENCH_OBJ_ID, i), 0);
+	}
+}
+
+ZTEST(lwm2m_registry, test_path_index_reuse)
+{
+	struct lwm2m_engine_obj_inst *obj_inst;
+	uint32_t value;
+
+	zassert_equal(lwm2m_create_obj_inst(BENCH_OBJ_ID, 5, &obj_inst), 0);
+	zassert_equal(lwm2m_create_obj_inst(BENCH_OBJ_ID, 6, &obj_inst), 0);
+
+	zassert_equal(lwm2m_set_u32(&LWM2M_OBJ(BENCH_OBJ_ID, 5, 1), 55), 0);
+	zassert_equal(lwm2m_set_u32(&LWM2M_OBJ(BENCH_OBJ_ID, 6, 1), 66), 0);
+	zassert_equal(lwm2m_get_u32(&LWM2M_OBJ(BENCH_OBJ_ID, 5, 1), &value), 0);
+	zassert_equal(value, 55);
+
+	/* Instance 7 takes over the storage of the deleted instance 5 */
+	zassert_equal(lwm2m_delete_obj_inst(BENCH_OBJ_ID, 5), 0);
+	zassert_equal(lwm2m_get_u32(&LWM2M_OBJ(BENCH_OBJ_ID, 5, 1), &value), -ENOENT);
+	zassert_equal(lwm2m_create_obj_inst(BENCH_OBJ_ID, 7, &obj_inst), 0);
+	zassert_equal(lwm2m_get_u32(&LWM2M_OBJ(BENCH_OBJ_ID, 5, 1), &value), -ENOENT);
+
+	zassert_equal(lwm2m_set_u32(&LWM2M_OBJ(BENCH_OBJ_ID, 7, 1), 77), 0);
+	zassert_equal(lwm2m_get_u32(&LWM2M_OBJ(BENCH_OBJ_ID, 7, 1), &value), 0);
+	zassert_equal(value, 77);
+	zassert_equal(lwm2m_get_u32(&LWM2M_OBJ(BENCH_OBJ_ID, 6, 1), &value), 0);
+	zassert_equal(value, 66);
+
+	zassert_equal(lwm2m_delete_obj_inst(BENCH_OBJ_ID, 6), 0);
+	zassert_equal(lwm2m_delete_obj_inst(BENCH_OBJ_ID, 7), 0);
+	zassert_equal(lwm2m_get_u32(&LWM2M_OBJ(BENCH_OBJ_ID, 7, 1), &value), -ENOENT);
+}
+
+static struct lwm2m_ctx observer_ctx;
+
+static void observer_add(const struct lwm2m_obj_path *path, uint8_t token)
+{
+	struct lwm2m_message msg = { 0 };
+	struct coap_packet cpkt;
+	uint8_t buf[32];
+	int ret;
+
+	ret = coap_packet_init(&cpkt, buf, sizeof(buf), COAP_VERSION_1, COAP_TYPE_ACK,
+			       0, NULL, COAP_RESPONSE_CODE_CONTENT, 0);
+	zassert_equal(ret, 0);
+
+	msg.ctx = &observer_ctx;
+	msg.path = *path;
+	msg.token = &token;
+	msg.tkl = 1;
+	msg.out.out_cpkt = &cpkt;
+
+	ret = lwm2m_engine_observation_handler(&msg, 0, LWM2M_FORMAT_PLAIN_TEXT, false);
+	zassert_equal(ret, 0, "Cannot add observer (%d)", ret);
+}
+
+static void observers_start(void)
+{
+	observer_ctx.sock_fd = -1;
+	lwm2m_engine_context_init(&observer_ctx);
+	zassert_equal(lwm2m_socket_add(&observer_ctx), 0);
+}
+
+static void observers_stop(void)
+{
+	lwm2m_engine_context_close(&observer_ctx);
+	lwm2m_socket_del(&observer_ctx);
+}
+
+static int observers_updated(void)
+{
+	struct observe_node *obs;
+	int count = 0;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&observer_ctx.observer, obs, node) {
+		if (obs->resource_update) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+ZTEST(lwm2m_registry, test_path_index_observed)
+{
+	int i;
+
+	observers_start();
+
+	for (i = 0; i < BENCH_OBSERVERS; i++) {
+		observer_add(&LWM2M_OBJ(TEST_OBJ_ID, 0, LWM2M_RES_TYPE_U32 + i), i + 1);
+	}
+
+	zassert_true(lwm2m_path_is_observed(&LWM2M_OBJ(TEST_OBJ_ID, 0, LWM2M_RES_TYPE_U32)));
+	zassert_false(lwm2m_path_is_observed(&LWM2M_OBJ(TEST_OBJ_ID, 0, LWM2M_RES_TYPE_BOOL)));
+	zassert_false(lwm2m_path_is_observed(&LWM2M_OBJ(BENCH_OBJ_ID, 0, 0)));
+
+	observers_stop();
+
+	zassert_false(lwm2m_path_is_observed(&LWM2M_OBJ(TEST_OBJ_ID, 0, LWM2M_RES_TYPE_U32)));
+}
+
+static uint64_t run_bench(int instances)
+{
+	int observers = MIN(instances, BENCH_OBSERVERS);
+	timing_t start_time, end_time;
+	uint32_t i;
+	int ret;
+
+	bench_create(instances);
+
+	/* Observe the written resource of the first instances, so that every
+	 * write goes through the observer lookup. Deleting the instances
+	 * removes the observers again.
+	 */
+	for (i = 0; i < observers; i++) {
+		observer_add(&LWM2M_OBJ(BENCH_OBJ_ID, i, BENCH_RESOURCES - 1), i + 1);
+	}
+
+	zassert_equal(observers_updated(), 0);
+
+	start_time = timing_counter_get();
+
+	for (i = 0; i < BENCH_WRITES; i++) {
+		/* Write the last resource, each write changes the value */
+		ret = lwm2m_set_u32(&LWM2M_OBJ(BENCH_OBJ_ID, i % instances,
+					       BENCH_RESOURCES - 1), i);
+		zassert_equal(ret, 0, "Cannot write (%d)", ret);
+	}
+
+	end_time = timing_counter_get();
+
+	/* The context is not registered, so the notifications stay queued */
+	zassert_equal(observers_updated(), observers, "Notifications not queued");
+
+	bench_delete(instances);
+
+	return timing_cycles_to_ns(timing_cycles_get(&start_time, &end_time));
+}
+
+ZTEST(lwm2m_registry, test_path_index_notify_rate)
+{
+	static const int instances[] = { 1, 4, 16, BENCH_MAX_INSTANCES };
+	uint64_t ns;
+	int i;
+
+	observers_start();
+
+	timing_init();
+	timing_start();
+
+	for (i = 0; i < ARRAY_SIZE(instances); i++) {
+		ns = run_bench(instances[i]);
+
+		if (ns == 0) {
+			TC_PRINT("%d instances: %d writes, too fast to measure\n",
+				 instances[i], BENCH_WRITES);
+			continue;
+		}
+
+		TC_PRINT("%d instances: %d writes in %llu us, %llu writes/s\n",
+			 instances[i], BENCH_WRITES, ns / NSEC_PER_USEC,
+			 (uint64_t)BENCH_WRITES * NSEC_PER_SEC / ns);
+	}
+
+	timing_stop();
+
+	observers_stop();
+}
@@ -12,6 +12,7 @@ LOG_MODULE_REGISTER(mdns_resp_test);
 #include <stdint.h>
 #include <string.h>
 
+#include <dns_pack.h>
 #include <ipv6.h>
 
 #include <zephyr/net/dns_sd.h>
@@ -71,6 +72,47 @@ static const uint8_t service_enum_start[] = {
 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94
 };
 
+/* Answers after the first one point to its name */
+static const uint8_t service_enum_next[] = {
+0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94
+};
+
+/* Service type enumeration, knowing about _foo._udp.local with TTL 4500 */
+static uint8_t dns_sd_service_enumeration_known_answer_query[] = {
+0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x09,
+0x5f, 0x73, 0x65, 0x72, 0x76, 0x69, 0x63, 0x65, 0x73, 0x07, 0x5f, 0x64, 0x6e,
+0x73, 0x2d, 0x73, 0x64, 0x04, 0x5f, 0x75, 0x64, 0x70, 0x05, 0x6c, 0x6f, 0x63,
+0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01,
+0x00, 0x00, 0x11, 0x94, 0x00, 0x0c, 0x04, 0x5f, 0x66, 0x6f, 0x6f, 0x04, 0x5f,
+0x75, 0x64, 0x70, 0xc0, 0x23
+};
+
+/* Offset of the second lowest byte of the TTL of the known answer above */
+#define KNOWN_ANSWER_TTL_OFFSET 54
+
+/* Two questions, _foo._udp.local and _bar._udp.local */
+static const uint8_t dns_sd_ptr_queries[] = {
+0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04,
+0x5f, 0x66, 0x6f, 0x6f, 0x04, 0x5f, 0x75, 0x64, 0x70, 0x05, 0x6c, 0x6f, 0x63,
+0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x04, 0x5f, 0x62, 0x61, 0x72, 0x04,
+0x5f, 0x75, 0x64, 0x70, 0xc0, 0x16, 0x00, 0x0c, 0x00, 0x01
+};
+
+/* Response header with two answers, followed by the additional records count */
+static const uint8_t ptr_resp_start[] = {
+0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00
+};
+
+/* Both answers of the response, PTR _foo._udp.local and _bar._udp.local */
+static const uint8_t ptr_resp_answers[] = {
+0x04, 0x5f, 0x66, 0x6f, 0x6f, 0x04, 0x5f, 0x75, 0x64, 0x70, 0x05, 0x6c, 0x6f,
+0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00,
+0x09, 0x06, 0x7a, 0x65, 0x70, 0x68, 0x79, 0x72, 0xc0, 0x0c, 0x04, 0x5f, 0x62,
+0x61, 0x72, 0x04, 0x5f, 0x75, 0x64, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c,
+0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x06, 0x03, 0x66,
+0x6f, 0x6f, 0xc0, 0x30
+};
+
 static const uint8_t payload_bar_udp_local[] = {
 0x00, 0x0c, 0x04, 0x5f, 0x62, 0x61, 0x72, 0x04, 0x5f, 0x75, 0x64, 0x70, 0xc0,
 0x23
@@ -279,6 +321,8 @@ static void cleanup(void *d)
 		}
 	}
 
+	responses_count = 0;
+
 	/* Clear semaphore counter */
 	while (k_sem_take(&wait_data, K_NO_WAIT) == 0) {
 		/* NOP */
@@ -356,8 +400,9 @@ static struct dns_sd_rec *alloc_ext_record(const char *instance, const char *ser
 	return NULL;
 }
 
-static void check_service_type_enum_resp(struct net_pkt *pkt, const uint8_t *payload, size_t len)
+static size_t read_response(struct net_pkt *pkt, uint8_t *buf, size_t size)
 {
+	size_t len;
 	int res;
 
 	net_pkt_cursor_init(pkt);
@@ -365,25 +410,62 @@ static void check_service_type_enum_resp(struct net_pkt *pkt, const uint8_t *pay
 	net_pkt_set_overwrite(pkt, true);
 	net_pkt_skip(pkt, NET_IPV6UDPH_LEN);
 
-	res = net_buf_data_match(pkt->cursor.buf, pkt->cursor.pos - pkt->cursor.buf->data,
-				 service_enum_start, sizeof(service_enum_start));
+	len = net_pkt_remaining_data(pkt);
+	zassert_true(len <= size, "Response too big (%zu bytes)", len);
+
+	res = net_pkt_read(pkt, buf, len);
+	zassert_equal(res, 0, "Cannot read response");
+
+	return len;
+}
 
-	zassert_equal(res, sizeof(service_enum_start),
-		      "mDNS content beginning does not match");
+/* All the service types are expected in a single response */
+static void check_service_type_enum_resp(struct net_pkt *pkt, const uint8_t **payloads,
+					 const size_t *lens, size_t count)
+{
+	static uint8_t expected[NET_IPV6_MTU];
+	static uint8_t data[NET_IPV6_MTU];
+	size_t expected_len = 0;
+	size_t len;
+
+	memcpy(expected, service_enum_start, sizeof(service_enum_start));
+	expected[7] = count;
+	expected_len += sizeof(service_enum_start);
+
+	for (size_t i = 0; i < count; i++) {
+		if (i > 0) {
+			memcpy(&expected[expected_len], service_enum_next,
+			       sizeof(service_enum_next));
+			expected_len += sizeof(service_enum_next);
+		}
 
-	net_pkt_skip(pkt, sizeof(service_enum_start));
+		memcpy(&expected[expected_len], payloads[i], lens[i]);
+		expected_len += lens[i];
+	}
 
-	res = net_pkt_get_len(pkt) - net_pkt_get_current_offset(pkt);
-	zassert_equal(res, len, "Remaining packet's length does match payload's length");
+	len = read_response(pkt, data, sizeof(data));
 
-	res = net_buf_data_match(pkt->cursor.buf, pkt->cursor.pos - pkt->cursor.buf->data, payload,
-				 len);
-	zassert_equal(res, len, "Payload does not match");
+	zassert_equal(len, expected_len, "Response length %zu does not match %zu",
+		      len, expected_len);
+	zassert_mem_equal(data, expected, len, "Response does not match");
 }
 
-ZTEST(test_mdns_responder, test_external_records)
+static void wait_responses(size_t count)
 {
 	int res;
+
+	for (size_t i = 0; i < count; i++) {
+		res = k_sem_take(&wait_data, RESPONSE_TIMEOUT);
+		zassert_equal(res, 0, "Did not receive a response number %zu", i + 1);
+	}
+
+	/* The answers are aggregated, nothing else is sent */
+	res = k_sem_take(&wait_data, RESPONSE_TIMEOUT);
+	zassert_not_equal(res, 0, "Unexpected response");
+}
+
+ZTEST(test_mdns_responder, test_external_records)
+{
 	struct dns_sd_rec *records[EXT_RECORDS_NUM];
 
 	/* mDNS responder can advertise only ports that are bound - reuse its own port */
@@ -401,23 +483,19 @@ ZTEST(test_mdns_responder, test_external_records)
 	/* Request service type enumeration */
 	send_msg(dns_sd_service_enumeration_query, sizeof(dns_sd_service_enumeration_query));
 
-	/* Expect 4 packets */
-	for (int i = 0; i < 4; ++i) {
-		res = k_sem_take(&wait_data, RESPONSE_TIMEOUT);
-		zassert_equal(res, 0, "Did not receive a response number %d", i + 1);
-	}
+	/* Expect all the service types in one packet */
+	wait_responses(1);
 
-	/* Responder always starts with statically allocated services */
-	check_service_type_enum_resp(response_pkts[0], payload_foo_udp_local,
-				     sizeof(payload_foo_udp_local));
-
-	/* Responder iterates through external records backwards so check responses in LIFO seq. */
-	check_service_type_enum_resp(response_pkts[1], payload_foo_tcp_local,
-				     sizeof(payload_foo_tcp_local));
-	check_service_type_enum_resp(response_pkts[2], payload_bar_udp_local,
-				     sizeof(payload_bar_udp_local));
-	check_service_type_enum_resp(response_pkts[3], payload_custom_tcp_local,
-				     sizeof(payload_custom_tcp_local));
+	/* Responder always starts with statically allocated services and iterates
+	 * through external records backwards.
+	 */
+	check_service_type_enum_resp(response_pkts[0],
+		(const uint8_t *[]){ payload_foo_udp_local, payload_foo_tcp_local,
+				     payload_bar_udp_local, payload_custom_tcp_local },
+		(const size_t[]){ sizeof(payload_foo_udp_local), sizeof(payload_foo_tcp_local),
+				  sizeof(payload_bar_udp_local),
+				  sizeof(payload_custom_tcp_local) },
+		4);
 
 	/* Remove record from the middle */
 	free_ext_record(records[1]);
@@ -425,19 +503,98 @@ ZTEST(test_mdns_responder, test_external_records)
 	/* Repeat service type enumeration */
 	send_msg(dns_sd_service_enumeration_query, sizeof(dns_sd_service_enumeration_query));
 
-	/* Expect 3 packets */
-	for (int i = 0; i < 3; ++i) {
-		res = k_sem_take(&wait_data, RESPONSE_TIMEOUT);
-		zassert_equal(res, 0, "Did not receive a response number %d", i + 1);
-	}
+	wait_responses(1);
 
 	/* Repeat checks without the removed record */
-	check_service_type_enum_resp(response_pkts[4], payload_foo_udp_local,
-				     sizeof(payload_foo_udp_local));
-	check_service_type_enum_resp(response_pkts[5], payload_foo_tcp_local,
-				     sizeof(payload_foo_tcp_local));
-	check_service_type_enum_resp(response_pkts[6], payload_custom_tcp_local,
-				     sizeof(payload_custom_tcp_local));
+	check_service_type_enum_resp(response_pkts[1],
+		(const uint8_t *[]){ payload_foo_udp_local, payload_foo_tcp_local,
+				     payload_custom_tcp_local },
+		(const size_t[]){ sizeof(payload_foo_udp_local), sizeof(payload_foo_tcp_local),
+				  sizeof(payload_custom_tcp_local) },
+		3);
+}
+
+ZTEST(test_mdns_responder, test_known_answer_suppression)
+{
+	struct dns_sd_rec *record;
+
+	record = alloc_ext_record("test_rec", "_custom", "_tcp", "local", NULL, 0, 5353);
+	zassert_not_null(record, "Failed to alloc the record");
+
+	/* The querier knows about _foo._udp.local, only _custom._tcp.local is sent */
+	send_msg(dns_sd_service_enumeration_known_answer_query,
+		 sizeof(dns_sd_service_enumeration_known_answer_query));
+
+	wait_responses(1);
+
+	check_service_type_enum_resp(response_pkts[0],
+		(const uint8_t *[]){ payload_custom_tcp_local },
+		(const size_t[]){ sizeof(payload_custom_tcp_local) }, 1);
+
+	/* A known answer with less than half of our TTL does not count */
+	dns_sd_service_enumeration_known_answer_query[KNOWN_ANSWER_TTL_OFFSET] = 0x00;
+	send_msg(dns_sd_service_enumeration_known_answer_query,
+		 sizeof(dns_sd_service_enumeration_known_answer_query));
+	dns_sd_service_enumeration_known_answer_query[KNOWN_ANSWER_TTL_OFFSET] = 0x11;
+
+	wait_responses(1);
+
+	check_service_type_enum_resp(response_pkts[1],
+		(const uint8_t *[]){ payload_foo_udp_local, payload_custom_tcp_local },
+		(const size_t[]){ sizeof(payload_foo_udp_local),
+				  sizeof(payload_custom_tcp_local) },
+		2);
+}
+
+ZTEST(test_mdns_responder, test_ptr_queries)
+{
+	static uint8_t data[NET_IPV6_MTU];
+	struct dns_sd_rec *record;
+	size_t len;
+
+	record = alloc_ext_record("foo", "_bar", "_udp", "local", NULL, 0, 5353);
+	zassert_not_null(record, "Failed to alloc the record");
+
+	/* Instances of both services are sent in the same response */
+	send_msg(dns_sd_ptr_queries, sizeof(dns_sd_ptr_queries));
+
+	wait_responses(1);
+
+	len = read_response(response_pkts[0], data, sizeof(data));
+
+	zassert_true(len > DNS_MSG_HEADER_SIZE + sizeof(ptr_resp_answers),
+		     "Response too short (%zu bytes)", len);
+	zassert_mem_equal(data, ptr_resp_start, sizeof(ptr_resp_start),
+			  "Header does not match");
+	zassert_true(data[DNS_MSG_HEADER_SIZE - 1] > 0, "No additional records");
+
+	/* The additional records of both answers follow the answers */
+	zassert_mem_equal(&data[DNS_MSG_HEADER_SIZE], ptr_resp_answers,
+			  sizeof(ptr_resp_answers), "Answers do not match");
+}
+
+ZTEST(test_mdns_responder, test_replace_ext_records)
+{
+	static const struct dns_sd_rec unused_record;
+	struct dns_sd_rec *record;
+
+	record = alloc_ext_record("test_rec", "_custom", "_tcp", "local", NULL, 0, 5353);
+	zassert_not_null(record, "Failed to alloc the record");
+
+	send_msg(dns_sd_service_enumeration_query, sizeof(dns_sd_service_enumeration_query));
+
+	/* Let the answers be queued, then replace the records they refer to */
+	k_msleep(10);
+	mdns_responder_set_ext_records(&unused_record, 1);
+
+	wait_responses(1);
+
+	/* Only the answer of the registered service is left */
+	check_service_type_enum_resp(response_pkts[0],
+		(const uint8_t *[]){ payload_foo_udp_local },
+		(const size_t[]){ sizeof(payload_foo_udp_local) }, 1);
+
+	mdns_responder_set_ext_records(records, EXT_RECORDS_NUM);
 }
 
 ZTEST_SUITE(test_mdns_responder, NULL, test_setup, before, cleanup, NULL);
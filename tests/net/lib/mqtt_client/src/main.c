@@ -0,0 +1,604 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_MQTT_LOG_LEVEL);
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/mqtt.h>
+
+#include "mqtt_transport.h"
+
+#define BROKER_ADDR "127.0.0.1"
+#define BROKER_PORT 1883
+#define BROKER_STACK_SIZE 2048
+
+#define MQTT_CLIENTID "zephyr_test"
+
+/* Packet types handled by the broker stand-in */
+#define PKT_TYPE_CONNECT 0x10
+#define PKT_TYPE_PUBLISH 0x30
+#define PKT_TYPE_PINGREQ 0xc0
+
+#define BENCH_MSGS 512
+#define BENCH_WINDOW 8
+
+#define WAIT_TIME K_SECONDS(2)
+
+/* Minimal MQTT broker stand-in, running on the loopback interface. It
+ * accepts one connection at a time, records the PUBLISH packets it gets
+ * and acknowledges them if asked to.
+ */
+static struct {
+	int listen_sock;
+	int sock;
+	bool auto_ack;
+	uint8_t pkt[512];
+	size_t pkt_len;
+	struct k_sem publish;
+	struct k_sem closed;
+} broker;
+
+K_THREAD_STACK_DEFINE(broker_stack, BROKER_STACK_SIZE);
+static struct k_thread broker_thread;
+
+static struct mqtt_client client_ctx;
+static struct sockaddr_in broker_addr;
+static uint8_t rx_buffer[128];
+static uint8_t tx_buffer[64];
+
+static bool connected;
+static bool read_payload;
+static int acked;
+static uint16_t last_ack_id;
+static int publish_received;
+static uint8_t payload_buf[16];
+static int custom_iovlen;
+
+static const uint8_t expected_qos1[] = {
+	0x32, 0x0e, 0x00, 0x06, 's', 'e', 'n', 's', 'o', 'r',
+	0x12, 0x34, '2', '1', '.', '5',
+};
+
+static int broker_recv_all(uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t ret = zsock_recv(broker.sock, buf, len, 0);
+
+		if (ret <= 0) {
+			return -ENOTCONN;
+		}
+
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+static int broker_read_packet(uint8_t *buf, size_t size, size_t *len)
+{
+	uint32_t remaining = 0;
+	size_t hdr_len = 1;
+	int shift = 0;
+
+	if (broker_recv_all(buf, 1) < 0) {
+		return -ENOTCONN;
+	}
+
+	do {
+		if (hdr_len >= 5 || broker_recv_all(&buf[hdr_len], 1) < 0) {
+			return -EINVAL;
+		}
+
+		remaining |= (buf[hdr_len] & 0x7f) << shift;
+		shift += 7;
+	} while (buf[hdr_len++] & 0x80);
+
+	if (hdr_len + remaining > size) {
+		return -ENOMEM;
+	}
+
+	if (broker_recv_all(&buf[hdr_len], remaining) < 0) {
+		return -ENOTCONN;
+	}
+
+	*len = hdr_len + remaining;
+
+	return hdr_len;
+}
+
+static void broker_send(const uint8_t *data, size_t len)
+{
+	zassert_equal(zsock_send(broker.sock, data, len, 0), len,
+		      "Broker send failed");
+}
+
+static void broker_handle_publish(size_t hdr_len)
+{
+	uint8_t qos = (broker.pkt[0] >> 1) & 0x03;
+	size_t id_pos = hdr_len + 2 + (broker.pkt[hdr_len] << 8) +
+			broker.pkt[hdr_len + 1];
+
+	if (qos == MQTT_QOS_1_AT_LEAST_ONCE && broker.auto_ack) {
+		uint8_t puback[] = { 0x40, 0x02, broker.pkt[id_pos],
+				     broker.pkt[id_pos + 1] };
+
+		broker_send(puback, sizeof(puback));
+	}
+
+	k_sem_give(&broker.publish);
+}
+
+static void broker_run(void *p1, void *p2, void *p3)
+{
+	static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+	static const uint8_t pingresp[] = { 0xd0, 0x00 };
+	int hdr_len;
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (true) {
+		broker.sock = zsock_accept(broker.listen_sock, NULL, NULL);
+		if (broker.sock < 0) {
+			continue;
+		}
+
+		while (true) {
+			hdr_len = broker_read_packet(broker.pkt,
+						     sizeof(broker.pkt),
+						     &broker.pkt_len);
+			if (hdr_len < 0) {
+				break;
+			}
+
+			switch (broker.pkt[0] & 0xf0) {
+			case PKT_TYPE_CONNECT:
+				broker_send(connack, sizeof(connack));
+				continue;
+			case PKT_TYPE_PUBLISH:
+				broker_handle_publish(hdr_len);
+				continue;
+			case PKT_TYPE_PINGREQ:
+				broker_send(pingresp, sizeof(pingresp));
+				continue;
+			default:
+				break;
+			}
+
+			break;
+		}
+
+		(void)zsock_close(broker.sock);
+		broker.sock = -1;
+		k_sem_give(&broker.closed);
+	}
+}
+
+/* Custom transport over TCP, recording in how many I/O vectors a message
+ * is given, as TLS makes a record of each of them.
+ */
+int mqtt_client_custom_transport_connect(struct mqtt_client *client)
+{
+	int sock;
+
+	sock = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sock < 0) {
+		return -errno;
+	}
+
+	if (zsock_connect(sock, client->broker, sizeof(struct sockaddr_in)) < 0) {
+		int err = -errno;
+
+		(void)zsock_close(sock);
+		return err;
+	}
+
+	client->transport.tcp.sock = sock;
+
+	return 0;
+}
+
+int mqtt_client_custom_transport_write(struct mqtt_client *client,
+				       const uint8_t *data, uint32_t datalen)
+{
+	custom_iovlen = 1;
+
+	if (zsock_send(client->transport.tcp.sock, data, datalen, 0) != datalen) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+int mqtt_client_custom_transport_write_msg(struct mqtt_client *client,
+					   const struct msghdr *message)
+{
+	size_t total_len = 0;
+
+	custom_iovlen = message->msg_iovlen;
+
+	for (int i = 0; i < message->msg_iovlen; i++) {
+		total_len += message->msg_iov[i].iov_len;
+	}
+
+	if (zsock_sendmsg(client->transport.tcp.sock, message, 0) != total_len) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+int mqtt_client_custom_transport_read(struct mqtt_client *client,
+				      uint8_t *data, uint32_t buflen,
+				      bool shall_block)
+{
+	int ret;
+
+	ret = zsock_recv(client->transport.tcp.sock, data, buflen,
+			 shall_block ? 0 : ZSOCK_MSG_DONTWAIT);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return ret;
+}
+
+int mqtt_client_custom_transport_disconnect(struct mqtt_client *client)
+{
+	return zsock_close(client->transport.tcp.sock) < 0 ? -errno : 0;
+}
+
+static void mqtt_evt_handler(struct mqtt_client *const client,
+			     const struct mqtt_evt *evt)
+{
+	switch (evt->type) {
+	case MQTT_EVT_CONNACK:
+		connected = (evt->result == 0);
+		break;
+
+	case MQTT_EVT_DISCONNECT:
+		connected = false;
+		break;
+
+	case MQTT_EVT_PUBACK:
+		if (evt->result == 0) {
+			acked++;
+			last_ack_id = evt->param.puback.message_id;
+		}
+		break;
+
+	case MQTT_EVT_PUBLISH:
+		publish_received++;
+		if (read_payload) {
+			zassert_equal(mqtt_readall_publish_payload(
+					client, payload_buf,
+					evt->param.publish.message.payload.len),
+				      0, "Cannot read payload");
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void client_wait_input(void)
+{
+	struct zsock_pollfd fds[1] = {
+		{
+			.fd = client_ctx.transport.tcp.sock,
+			.events = ZSOCK_POLLIN,
+		},
+	};
+
+	zassert_equal(zsock_poll(fds, 1, 2000), 1, "No data from broker");
+	zassert_equal(mqtt_input(&client_ctx), 0, "mqtt_input failed");
+}
+
+static int client_publish(const char *topic, const char *payload,
+			  enum mqtt_qos qos, uint16_t message_id)
+{
+	struct mqtt_publish_param param = {
+		.message.topic.topic.utf8 = (const uint8_t *)topic,
+		.message.topic.topic.size = strlen(topic),
+		.message.topic.qos = qos,
+		.message.payload.data = (uint8_t *)payload,
+		.message.payload.len = strlen(payload),
+		.message_id = message_id,
+	};
+
+	return mqtt_publish(&client_ctx, &param);
+}
+
+ZTEST(net_mqtt_client, test_publish_encoding)
+{
+	static const uint8_t expected_qos0[] = {
+		0x30, 0x0c, 0x00, 0x06, 's', 'e', 'n', 's', 'o', 'r',
+		'2', '1', '.', '5',
+	};
+
+	zassert_equal(client_publish("sensor", "21.5",
+				     MQTT_QOS_0_AT_MOST_ONCE, 0),
+		      0, "Cannot publish");
+	zassert_equal(k_sem_take(&broker.publish, WAIT_TIME), 0,
+		      "Broker got no publish");
+	zassert_equal(broker.pkt_len, sizeof(expected_qos0), "Wrong length");
+	zassert_mem_equal(broker.pkt, expected_qos0, sizeof(expected_qos0),
+			  "Wrong QoS 0 packet");
+
+	zassert_equal(client_publish("sensor", "21.5",
+				     MQTT_QOS_1_AT_LEAST_ONCE, 0x1234),
+		      0, "Cannot publish");
+	zassert_equal(k_sem_take(&broker.publish, WAIT_TIME), 0,
+		      "Broker got no publish");
+	zassert_equal(broker.pkt_len, sizeof(expected_qos1), "Wrong length");
+	zassert_mem_equal(broker.pkt, expected_qos1, sizeof(expected_qos1),
+			  "Wrong QoS 1 packet");
+
+	client_wait_input();
+	zassert_equal(acked, 1, "Publish not acknowledged");
+	zassert_equal(last_ack_id, 0x1234, "Wrong message id");
+}
+
+ZTEST(net_mqtt_client, test_publish_topic_larger_than_tx_buf)
+{
+	char topic[sizeof(tx_buffer) * 2];
+
+	/* The topic is not copied to the TX buffer, so it can be larger */
+	memset(topic, 'a', sizeof(topic) - 1);
+	topic[sizeof(topic) - 1] = '\0';
+
+	zassert_equal(client_publish(topic, "x", MQTT_QOS_1_AT_LEAST_ONCE, 1),
+		      0, "Cannot publish");
+	zassert_equal(k_sem_take(&broker.publish, WAIT_TIME), 0,
+		      "Broker got no publish");
+	/* Two bytes of remaining length, then the topic length */
+	zassert_mem_equal(&broker.pkt[5], topic, sizeof(topic) - 1,
+			  "Wrong topic");
+
+	client_wait_input();
+	zassert_equal(acked, 1, "Publish not acknowledged");
+}
+
+ZTEST(net_mqtt_client, test_publish_copied_topic)
+{
+	char topic[sizeof(tx_buffer) * 2];
+
+	/* Reconnect over a transport that does not gather the I/O vectors */
+	zassert_equal(mqtt_disconnect(&client_ctx), 0, "Cannot disconnect");
+	zassert_equal(k_sem_take(&broker.closed, WAIT_TIME), 0,
+		      "Broker did not see the disconnection");
+
+	client_ctx.transport.type = MQTT_TRANSPORT_CUSTOM;
+	zassert_equal(mqtt_connect(&client_ctx), 0, "Cannot connect");
+	client_wait_input();
+	zassert_true(connected, "Not connected");
+
+	/* The topic is copied, the packet is sent with the payload only */
+	zassert_equal(client_publish("sensor", "21.5",
+				     MQTT_QOS_1_AT_LEAST_ONCE, 0x1234),
+		      0, "Cannot publish");
+	zassert_equal(custom_iovlen, 2, "Topic not copied");
+	zassert_equal(k_sem_take(&broker.publish, WAIT_TIME), 0,
+		      "Broker got no publish");
+	zassert_equal(broker.pkt_len, sizeof(expected_qos1), "Wrong length");
+	zassert_mem_equal(broker.pkt, expected_qos1, sizeof(expected_qos1),
+			  "Wrong QoS 1 packet");
+
+	client_wait_input();
+	zassert_equal(acked, 1, "Publish not acknowledged");
+
+	/* A topic that does not fit the TX buffer is still not copied */
+	memset(topic, 'a', sizeof(topic) - 1);
+	topic[sizeof(topic) - 1] = '\0';
+
+	zassert_equal(client_publish(topic, "x", MQTT_QOS_1_AT_LEAST_ONCE, 1),
+		      0, "Cannot publish");
+	zassert_equal(custom_iovlen, 4, "Topic copied");
+	zassert_equal(k_sem_take(&broker.publish, WAIT_TIME), 0,
+		      "Broker got no publish");
+	zassert_mem_equal(&broker.pkt[5], topic, sizeof(topic) - 1,
+			  "Wrong topic");
+
+	client_wait_input();
+	zassert_equal(acked, 2, "Publish not acknowledged");
+}
+
+ZTEST(net_mqtt_client, test_input_batch)
+{
+	static const uint8_t pubacks[] = {
+		0x40, 0x02, 0x00, 0x01,
+		0x40, 0x02, 0x00, 0x02,
+		0x40, 0x02, 0x00, 0x03,
+		0x40, 0x02, 0x00, 0x04,
+	};
+
+	broker_send(pubacks, sizeof(pubacks));
+
+	/* All the acknowledgements are handled by one call */
+	client_wait_input();
+	zassert_equal(acked, 4, "Only %d acknowledgements handled", acked);
+	zassert_equal(last_ack_id, 4, "Wrong message id");
+}
+
+ZTEST(net_mqtt_client, test_input_batch_stops_at_publish)
+{
+	static const uint8_t packets[] = {
+		0x30, 0x06, 0x00, 0x01, 't', 'a', 'b', 'c',
+		0x40, 0x02, 0x00, 0x01,
+	};
+	uint8_t payload[3];
+
+	read_payload = false;
+
+	broker_send(packets, sizeof(packets));
+
+	/* The payload must be read before the next packet is handled */
+	client_wait_input();
+	zassert_equal(publish_received, 1, "Publish not handled");
+	zassert_equal(acked, 0, "Packet after publish handled");
+
+	zassert_equal(mqtt_read_publish_payload(&client_ctx, payload,
+						sizeof(payload)),
+		      sizeof(payload), "Cannot read payload");
+	zassert_mem_equal(payload, "abc", sizeof(payload), "Wrong payload");
+
+	client_wait_input();
+	zassert_equal(acked, 1, "Acknowledgement not handled");
+}
+
+static uint64_t run_bench(enum mqtt_qos qos)
+{
+	timing_t start_time, end_time;
+	int i, j;
+
+	broker.auto_ack = true;
+	acked = 0;
+
+	start_time = timing_counter_get();
+
+	for (i = 0; i < BENCH_MSGS; i += BENCH_WINDOW) {
+		for (j = 0; j < BENCH_WINDOW; j++) {
+			zassert_equal(client_publish("bench", "0123456789",
+						     qos, i + j + 1),
+				      0, "Cannot publish");
+		}
+
+		if (qos == MQTT_QOS_0_AT_MOST_ONCE) {
+			for (j = 0; j < BENCH_WINDOW; j++) {
+				zassert_equal(k_sem_take(&broker.publish,
+							 WAIT_TIME),
+					      0, "Broker got no publish");
+			}
+
+			continue;
+		}
+
+		while (acked < i + BENCH_WINDOW) {
+			client_wait_input();
+		}
+	}
+
+	end_time = timing_counter_get();
+
+	return timing_cycles_to_ns(timing_cycles_get(&start_time, &end_time));
+}
+
+static void print_rate(const char *name, uint64_t ns)
+{
+	if (ns == 0) {
+		TC_PRINT("%s: %d messages, too fast to measure\n", name,
+			 BENCH_MSGS);
+		return;
+	}
+
+	TC_PRINT("%s: %d messages in %llu us, %llu messages/s\n", name,
+		 BENCH_MSGS, ns / NSEC_PER_USEC,
+		 (uint64_t)BENCH_MSGS * NSEC_PER_SEC / ns);
+}
+
+ZTEST(net_mqtt_client, test_publish_rate)
+{
+	uint64_t qos0_ns;
+	uint64_t qos1_ns;
+
+	timing_init();
+	timing_start();
+
+	qos0_ns = run_bench(MQTT_QOS_0_AT_MOST_ONCE);
+	qos1_ns = run_bench(MQTT_QOS_1_AT_LEAST_ONCE);
+
+	timing_stop();
+
+	print_rate("QoS 0 publish", qos0_ns);
+	print_rate("QoS 1 publish", qos1_ns);
+}
+
+static void *mqtt_client_tests_setup(void)
+{
+	int ret;
+
+	k_sem_init(&broker.publish, 0, UINT_MAX);
+	k_sem_init(&broker.closed, 0, 1);
+	broker.sock = -1;
+
+	broker_addr.sin_family = AF_INET;
+	broker_addr.sin_port = htons(BROKER_PORT);
+	zsock_inet_pton(AF_INET, BROKER_ADDR, &broker_addr.sin_addr);
+
+	broker.listen_sock = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(broker.listen_sock >= 0, "Cannot create socket");
+
+	ret = zsock_bind(broker.listen_sock, (struct sockaddr *)&broker_addr,
+			 sizeof(broker_addr));
+	zassert_equal(ret, 0, "Cannot bind (%d)", errno);
+
+	ret = zsock_listen(broker.listen_sock, 1);
+	zassert_equal(ret, 0, "Cannot listen (%d)", errno);
+
+	k_thread_create(&broker_thread, broker_stack,
+			K_THREAD_STACK_SIZEOF(broker_stack), broker_run,
+			NULL, NULL, NULL, K_PRIO_PREEMPT(8), 0, K_NO_WAIT);
+
+	return NULL;
+}
+
+static void mqtt_client_tests_before(void *fixture)
+{
+	int ret;
+
+	ARG_UNUSED(fixture);
+
+	connected = false;
+	read_payload = true;
+	acked = 0;
+	last_ack_id = 0;
+	publish_received = 0;
+	broker.auto_ack = true;
+	k_sem_reset(&broker.publish);
+	k_sem_reset(&broker.closed);
+
+	mqtt_client_init(&client_ctx);
+
+	client_ctx.broker = &broker_addr;
+	client_ctx.evt_cb = mqtt_evt_handler;
+	client_ctx.client_id.utf8 = (uint8_t *)MQTT_CLIENTID;
+	client_ctx.client_id.size = strlen(MQTT_CLIENTID);
+	client_ctx.transport.type = MQTT_TRANSPORT_NON_SECURE;
+	client_ctx.rx_buf = rx_buffer;
+	client_ctx.rx_buf_size = sizeof(rx_buffer);
+	client_ctx.tx_buf = tx_buffer;
+	client_ctx.tx_buf_size = sizeof(tx_buffer);
+
+	ret = mqtt_connect(&client_ctx);
+	zassert_equal(ret, 0, "Cannot connect (%d)", ret);
+
+	client_wait_input();
+	zassert_true(connected, "Not connected");
+}
+
+static void mqtt_client_tests_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	(void)mqtt_disconnect(&client_ctx);
+
+	zassert_equal(k_sem_take(&broker.closed, WAIT_TIME), 0,
+		      "Broker did not see the disconnection");
+
+	/* Let the connection leave the TIME_WAIT state */
+	k_sleep(K_MSEC(2 * CONFIG_NET_TCP_TIME_WAIT_DELAY));
+}
+
+ZTEST_SUITE(net_mqtt_client, NULL, mqtt_client_tests_setup,
+	    mqtt_client_tests_before, mqtt_client_tests_after, NULL);
@@ -20,6 +20,7 @@ LOG_MODULE_REGISTER(npf_test, NET_LOG_LEVEL);
 #include "ipv6.h"
 
 #include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
 
 #include <zephyr/net/net_if.h>
 #include <zephyr/net/ethernet.h>
@@ -483,4 +484,193 @@ ZTEST(net_pkt_filter_test_suite, test_npf_ipv6_address_filtering)
 	net_pkt_unref(pkt_v4);
 }
 
+/*
+ * Mixed rule list, the verdicts are compared against evaluating the rules
+ * one by one, which is what the filter does without compilation.
+ */
+
+static struct net_eth_addr mixed_src_list[] = {
+	{ { 0x00, 0x11, 0x22, 0x33, 0x44, 0x56 } },
+	ETH_SRC_ADDR,
+};
+
+static NPF_ETH_TYPE_MATCH(mixed_ipv6, NET_ETH_PTYPE_IPV6);
+static NPF_ETH_TYPE_MATCH(mixed_arp, NET_ETH_PTYPE_ARP);
+static NPF_ETH_TYPE_MATCH(mixed_ip, NET_ETH_PTYPE_IP);
+static NPF_SIZE_MAX(mixed_small, 100);
+static NPF_ETH_SRC_ADDR_MATCH(mixed_src, mixed_src_list);
+static NPF_IFACE_MATCH(mixed_iface_a, &dummy_iface_a);
+
+static NPF_RULE(mixed_drop_ipv6, NET_DROP, mixed_ipv6);
+static NPF_RULE(mixed_accept_arp, NET_OK, mixed_arp);
+static NPF_RULE(mixed_drop_small, NET_DROP, mixed_small);
+static NPF_RULE(mixed_drop_ip_from_a, NET_DROP, mixed_ip, mixed_iface_a);
+static NPF_RULE(mixed_accept_src, NET_OK, mixed_src);
+static NPF_RULE(mixed_accept_iface_a, NET_OK, mixed_iface_a);
+static NPF_RULE(mixed_drop_ip, NET_DROP, mixed_ip);
+
+static enum net_verdict reference_verdict(struct npf_rule_list *rules,
+					  struct net_pkt *pkt)
+{
+	struct npf_rule *rule;
+
+	if (sys_slist_is_empty(&rules->rule_head)) {
+		return NET_OK;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&rules->rule_head, rule, node) {
+		unsigned int i;
+
+		for (i = 0; i < rule->nb_tests; i++) {
+			if (!rule->tests[i]->fn(rule->tests[i], pkt)) {
+				break;
+			}
+		}
+
+		if (i == rule->nb_tests) {
+			return rule->result;
+		}
+	}
+
+	return NET_DROP;
+}
+
+static void check_mixed_verdicts(void)
+{
+	static const int types[] = {
+		NET_ETH_PTYPE_IP, NET_ETH_PTYPE_IPV6, NET_ETH_PTYPE_ARP, 0x1234
+	};
+	static const int sizes[] = { 50, 200 };
+	struct net_if *ifaces[] = { &dummy_iface_a, &dummy_iface_b };
+
+	for (int t = 0; t < ARRAY_SIZE(types); t++) {
+		for (int s = 0; s < ARRAY_SIZE(sizes); s++) {
+			for (int i = 0; i < ARRAY_SIZE(ifaces); i++) {
+				struct net_pkt *pkt;
+				bool expected;
+
+				pkt = build_test_pkt(types[t], sizes[s], ifaces[i]);
+
+				expected = reference_verdict(&npf_recv_rules, pkt) == NET_OK;
+				zassert_equal(net_pkt_filter_recv_ok(pkt), expected,
+					      "type 0x%04x size %d iface %d", types[t],
+					      sizes[s], i);
+
+				/* Other source address */
+				NET_ETH_HDR(pkt)->src.addr[5] ^= 0xff;
+
+				expected = reference_verdict(&npf_recv_rules, pkt) == NET_OK;
+				zassert_equal(net_pkt_filter_recv_ok(pkt), expected,
+					      "type 0x%04x size %d iface %d", types[t],
+					      sizes[s], i);
+
+				net_pkt_unref(pkt);
+			}
+		}
+	}
+}
+
+ZTEST(net_pkt_filter_test_suite, test_npf_mixed_rules)
+{
+	npf_append_recv_rule(&mixed_drop_ipv6);
+	npf_append_recv_rule(&mixed_accept_arp);
+	npf_append_recv_rule(&mixed_drop_small);
+	npf_append_recv_rule(&mixed_drop_ip_from_a);
+	npf_append_recv_rule(&mixed_accept_src);
+	npf_append_recv_rule(&mixed_accept_iface_a);
+	npf_append_recv_rule(&mixed_drop_ip);
+	npf_append_recv_rule(&npf_default_ok);
+
+	check_mixed_verdicts();
+
+	/* Changes in the middle of the list */
+	zassert_true(npf_remove_recv_rule(&mixed_drop_small), "");
+	check_mixed_verdicts();
+
+	npf_insert_recv_rule(&mixed_drop_small);
+	check_mixed_verdicts();
+
+	zassert_true(npf_remove_all_recv_rules(), "");
+}
+
+/*
+ * Verdict latency versus the number of rules. Every rule drops packets
+ * from one source address, and the tested packet matches none of them,
+ * so that all the rules need to be looked at.
+ */
+
+#define BENCH_RULES 64
+#define BENCH_ROUNDS 1000
+
+static struct in_addr bench_addrs[BENCH_RULES];
+
+#define BENCH_RULE(i, _) \
+	static NPF_IP_SRC_ADDR_ALLOWLIST(bench_src_##i, &bench_addrs[i], 1, AF_INET); \
+	static NPF_RULE(bench_rule_##i, NET_DROP, bench_src_##i)
+
+LISTIFY(BENCH_RULES, BENCH_RULE, (;));
+
+#define BENCH_RULE_PTR(i, _) &bench_rule_##i
+
+static struct npf_rule *bench_rules[] = {
+	LISTIFY(BENCH_RULES, BENCH_RULE_PTR, (,))
+};
+
+ZTEST(net_pkt_filter_test_suite, test_npf_verdict_latency)
+{
+	static const int counts[] = { 1, 8, 16, 32, 64 };
+	struct in_addr src = { { { 192, 0, 2, 1 } } };
+	struct in_addr dst = { { { 192, 0, 2, 2 } } };
+	struct net_pkt *pkt;
+	int appended = 0;
+
+	BUILD_ASSERT(BENCH_RULES == 64);
+
+	for (int i = 0; i < BENCH_RULES; i++) {
+		bench_addrs[i].s_addr = htonl(0x0a000000 + i);
+	}
+
+	pkt = build_test_ip_pkt(&src, &dst, AF_INET, &dummy_iface_a);
+
+	timing_init();
+	timing_start();
+
+	for (int c = 0; c < ARRAY_SIZE(counts); c++) {
+		timing_t start, end;
+		uint64_t ns;
+
+		zassert_true(npf_remove_ipv4_recv_rule(&npf_default_ok) || c == 0, "");
+
+		while (appended < counts[c]) {
+			npf_append_ipv4_recv_rule(bench_rules[appended++]);
+		}
+
+		npf_append_ipv4_recv_rule(&npf_default_ok);
+
+		start = timing_counter_get();
+
+		for (int n = 0; n < BENCH_ROUNDS; n++) {
+			zassert_true(net_pkt_filter_ip_recv_ok(pkt), "");
+		}
+
+		end = timing_counter_get();
+		ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+
+		TC_PRINT("%s, %d rules: %llu ns per packet\n",
+			 IS_ENABLED(CONFIG_NET_PKT_FILTER_COMPILE) ?
+			 "compiled" : "interpreted", counts[c], ns / BENCH_ROUNDS);
+	}
+
+	timing_stop();
+
+	/* Listed sources are still dropped */
+	for (int i = 0; i < BENCH_RULES; i++) {
+		memcpy(NET_IPV4_HDR(pkt)->src, &bench_addrs[i], sizeof(struct in_addr));
+		zassert_false(net_pkt_filter_ip_recv_ok(pkt), "rule %d", i);
+	}
+
+	zassert_true(npf_remove_all_ipv4_recv_rules(), "");
+	net_pkt_unref(pkt);
+}
+
 ZTEST_SUITE(net_pkt_filter_test_suite, NULL, test_npf_iface, NULL, NULL, NULL);
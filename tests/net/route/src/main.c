@@ -492,6 +492,63 @@ static void test_route_del_many(void)
 	}
 }
 
+static void test_route_longest_match(void)
+{
+	struct in6_addr net48 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0x1, 0, 0,
+				      0, 0, 0, 0, 0, 0, 0, 0 } } };
+	struct in6_addr net64 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0x1, 0, 0x2,
+				      0, 0, 0, 0, 0, 0, 0, 0 } } };
+	struct in6_addr dst = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0x1, 0, 0x2,
+				    0, 0, 0, 0, 0, 0, 0, 0x9 } } };
+	struct net_route_entry *route32, *route48, *route64;
+
+	route48 = net_route_add(my_iface, &net48, 48, &peer_addr,
+				NET_IPV6_ND_INFINITE_LIFETIME,
+				NET_ROUTE_PREFERENCE_LOW);
+	zassert_not_null(route48, "Route add failed");
+
+	/* Covering and more specific routes do not replace each other */
+	route32 = net_route_add(my_iface, &generic_addr, 32, &peer_addr,
+				NET_IPV6_ND_INFINITE_LIFETIME,
+				NET_ROUTE_PREFERENCE_LOW);
+	zassert_not_null(route32, "Route add failed");
+	zassert_not_equal(route32, route48, "Route replaced");
+
+	route64 = net_route_add(my_iface, &net64, 64, &peer_addr,
+				NET_IPV6_ND_INFINITE_LIFETIME,
+				NET_ROUTE_PREFERENCE_LOW);
+	zassert_not_null(route64, "Route add failed");
+	zassert_not_equal(route64, route48, "Route replaced");
+
+	zassert_equal_ptr(net_route_lookup(my_iface, &dst), route64,
+			  "Longest prefix not selected");
+	zassert_equal_ptr(net_route_lookup(NULL, &dst), route64,
+			  "Longest prefix not selected");
+	zassert_is_null(net_route_lookup(peer_iface, &dst),
+			"Route found via wrong interface");
+
+	dst.s6_addr[7] = 0x3;
+	zassert_equal_ptr(net_route_lookup(my_iface, &dst), route48,
+			  "Longest prefix not selected");
+
+	dst.s6_addr[5] = 0x2;
+	zassert_equal_ptr(net_route_lookup(my_iface, &dst), route32,
+			  "Longest prefix not selected");
+
+	zassert_false(net_route_del(route32), "Route del failed");
+	zassert_is_null(net_route_lookup(my_iface, &dst), "Route not deleted");
+
+	dst.s6_addr[5] = 0x1;
+	zassert_false(net_route_del(route48), "Route del failed");
+	zassert_is_null(net_route_lookup(my_iface, &dst), "Route not deleted");
+
+	dst.s6_addr[7] = 0x2;
+	zassert_equal_ptr(net_route_lookup(my_iface, &dst), route64,
+			  "Route lost");
+	zassert_false(net_route_del(route64), "Route del failed");
+	zassert_is_null(net_route_lookup(my_iface, &dst), "Route not deleted");
+}
+
 static void test_route_lifetime(void)
 {
 	route_entry = net_route_add(my_iface,
@@ -564,6 +621,7 @@ ZTEST(route_test_suite, test_route)
 	test_populate_nbr_cache();
 	test_route_add_many();
 	test_route_del_many();
+	test_route_longest_match();
 	test_route_lifetime();
 	test_route_preference();
 }
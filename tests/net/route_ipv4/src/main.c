@@ -0,0 +1,603 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_ROUTE_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zephyr/tc_util.h>
+
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+
+#include "net_private.h"
+#include "route.h"
+#include "route_lpm.h"
+
+#define WAIT_TIME K_MSEC(250)
+
+#define LPM_TEST_ROUTES 64
+#define LPM_TEST_LOOKUPS 2000
+#define BENCH_LOOKUPS 10000
+
+static struct in_addr addr1 = { { { 192, 0, 2, 1 } } };
+static struct in_addr addr2 = { { { 198, 51, 100, 1 } } };
+static struct in_addr netmask = { { { 255, 255, 255, 0 } } };
+static struct in_addr gw1 = { { { 192, 0, 2, 254 } } };
+static struct in_addr gw2 = { { { 198, 51, 100, 254 } } };
+static struct in_addr peer1 = { { { 192, 0, 2, 10 } } };
+
+static struct net_if *iface1;
+static struct net_if *iface2;
+
+static K_SEM_DEFINE(wait_data, 0, UINT_MAX);
+static struct net_ipv4_hdr sent_hdr;
+static struct net_if *sent_iface;
+static bool sent_chksum_ok;
+
+static uint32_t rand_state = 0x12345678U;
+
+static uint32_t test_rand(void)
+{
+	/* xorshift32, the sequence is the same on every run */
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state;
+}
+
+struct route_ipv4_test {
+	uint8_t mac_addr[6];
+};
+
+static int route_ipv4_dev_init(const struct device *dev)
+{
+	return 0;
+}
+
+static void route_ipv4_iface_init(struct net_if *iface)
+{
+	struct route_ipv4_test *data = net_if_get_device(iface)->data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[0] = 0x00;
+	data->mac_addr[1] = 0x00;
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[3] = 0x00;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = net_if_get_by_iface(iface);
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_DUMMY);
+}
+
+static int tester_send(const struct device *dev, struct net_pkt *pkt)
+{
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_read(pkt, &sent_hdr, sizeof(sent_hdr)) < 0) {
+		return -EINVAL;
+	}
+
+	sent_iface = net_pkt_iface(pkt);
+	sent_chksum_ok = net_calc_chksum_ipv4(pkt) == 0U;
+
+	k_sem_give(&wait_data);
+
+	return 0;
+}
+
+static struct route_ipv4_test route_ipv4_data1;
+static struct route_ipv4_test route_ipv4_data2;
+
+static struct dummy_api route_ipv4_if_api = {
+	.iface_api.init = route_ipv4_iface_init,
+	.send = tester_send,
+};
+
+NET_DEVICE_INIT_INSTANCE(route_ipv4_test1, "route_ipv4_test1", iface1,
+			 route_ipv4_dev_init, NULL,
+			 &route_ipv4_data1, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &route_ipv4_if_api, DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+NET_DEVICE_INIT_INSTANCE(route_ipv4_test2, "route_ipv4_test2", iface2,
+			 route_ipv4_dev_init, NULL,
+			 &route_ipv4_data2, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &route_ipv4_if_api, DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2), 127);
+
+static void *setup(void)
+{
+	STRUCT_SECTION_FOREACH(net_if, iface) {
+		if (net_if_get_device(iface)->data == &route_ipv4_data1) {
+			iface1 = iface;
+		} else if (net_if_get_device(iface)->data == &route_ipv4_data2) {
+			iface2 = iface;
+		}
+	}
+
+	zassert_not_null(iface1, "No first interface");
+	zassert_not_null(iface2, "No second interface");
+
+	zassert_not_null(net_if_ipv4_addr_add(iface1, &addr1, NET_ADDR_MANUAL, 0),
+			 "Cannot add address");
+	zassert_not_null(net_if_ipv4_addr_add(iface2, &addr2, NET_ADDR_MANUAL, 0),
+			 "Cannot add address");
+	zassert_true(net_if_ipv4_set_netmask_by_addr(iface1, &addr1, &netmask),
+		     "Cannot set netmask");
+	zassert_true(net_if_ipv4_set_netmask_by_addr(iface2, &addr2, &netmask),
+		     "Cannot set netmask");
+
+	return NULL;
+}
+
+static void del_route(struct net_route_entry_ipv4 *route, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	(void)net_route_ipv4_del(route);
+}
+
+static void count_route(struct net_route_entry_ipv4 *route, void *user_data)
+{
+	ARG_UNUSED(route);
+	ARG_UNUSED(user_data);
+}
+
+static void after(void *arg)
+{
+	ARG_UNUSED(arg);
+
+	(void)net_route_ipv4_foreach(del_route, NULL);
+	k_sem_reset(&wait_data);
+}
+
+static struct net_route_entry_ipv4 *add_route(struct net_if *iface,
+					      const char *net, uint8_t len,
+					      struct in_addr *gw)
+{
+	struct in_addr addr;
+
+	zassert_ok(net_addr_pton(AF_INET, net, &addr), "Invalid address");
+
+	return net_route_ipv4_add(iface, &addr, len, gw);
+}
+
+static struct net_route_entry_ipv4 *lookup(struct net_if *iface,
+					   const char *dst)
+{
+	struct in_addr addr;
+
+	zassert_ok(net_addr_pton(AF_INET, dst, &addr), "Invalid address");
+
+	return net_route_ipv4_lookup(iface, &addr);
+}
+
+ZTEST(net_route_ipv4, test_add_lookup_del)
+{
+	struct net_route_entry_ipv4 *r8, *r16, *r24, *r0, *entry;
+	struct in_addr dst, nexthop;
+
+	r8 = add_route(iface1, "10.0.0.0", 8, &gw1);
+	r16 = add_route(iface2, "10.1.0.0", 16, &gw2);
+	r24 = add_route(iface1, "10.1.2.99", 24, NULL);
+	r0 = add_route(iface2, "0.0.0.0", 0, &gw2);
+
+	zassert_not_null(r8, "Route add failed");
+	zassert_not_null(r16, "Route add failed");
+	zassert_not_null(r24, "Route add failed");
+	zassert_not_null(r0, "Route add failed");
+	zassert_equal(net_route_ipv4_foreach(count_route, NULL), 4,
+		      "Wrong number of routes");
+
+	zassert_equal(r24->addr.s_addr, htonl(0x0a010200), "Prefix not masked");
+
+	zassert_equal_ptr(lookup(NULL, "10.1.2.3"), r24, "Wrong route");
+	zassert_equal_ptr(lookup(NULL, "10.1.3.3"), r16, "Wrong route");
+	zassert_equal_ptr(lookup(NULL, "10.2.0.1"), r8, "Wrong route");
+	zassert_equal_ptr(lookup(NULL, "203.0.113.1"), r0, "Wrong route");
+
+	/* Only the routes via the given interface are considered */
+	zassert_equal_ptr(lookup(iface1, "10.1.3.3"), r8, "Wrong route");
+	zassert_is_null(lookup(iface1, "203.0.113.1"), "Wrong route");
+
+	zassert_ok(net_addr_pton(AF_INET, "10.1.3.3", &dst), "");
+	zassert_equal_ptr(net_route_ipv4_get_nexthop(NULL, &dst, &nexthop),
+			  iface2, "Wrong interface");
+	zassert_true(net_ipv4_addr_cmp(&nexthop, &gw2), "Wrong nexthop");
+
+	/* On-link route, the destination is the nexthop */
+	zassert_ok(net_addr_pton(AF_INET, "10.1.2.3", &dst), "");
+	zassert_equal_ptr(net_route_ipv4_get_nexthop(NULL, &dst, &nexthop),
+			  iface1, "Wrong interface");
+	zassert_true(net_ipv4_addr_cmp(&nexthop, &dst), "Wrong nexthop");
+
+	/* Same network via the same interface updates the route */
+	entry = add_route(iface1, "10.0.0.0", 8, &gw2);
+	zassert_equal_ptr(entry, r8, "Route not updated");
+	zassert_true(net_ipv4_addr_cmp(&r8->gw, &gw2), "Gateway not updated");
+
+	/* Same network via another interface is a separate route */
+	entry = add_route(iface2, "10.0.0.0", 8, &gw2);
+	zassert_not_null(entry, "Route add failed");
+	zassert_not_equal(entry, r8, "Route replaced");
+	zassert_equal_ptr(lookup(iface2, "10.2.0.1"), entry, "Wrong route");
+	zassert_equal_ptr(lookup(iface1, "10.2.0.1"), r8, "Wrong route");
+	zassert_ok(net_route_ipv4_del(entry), "Route del failed");
+
+	zassert_ok(net_route_ipv4_del(r16), "Route del failed");
+	zassert_equal(net_route_ipv4_del(r16), -ENOENT, "Route del again");
+	zassert_equal_ptr(lookup(NULL, "10.1.3.3"), r8, "Wrong route");
+
+	zassert_ok(net_route_ipv4_del(r0), "Route del failed");
+	zassert_is_null(lookup(NULL, "203.0.113.1"), "Route not deleted");
+
+	zassert_equal(net_route_ipv4_foreach(del_route, NULL), 2,
+		      "Wrong number of routes");
+	zassert_is_null(lookup(NULL, "10.1.2.3"), "Route not deleted");
+}
+
+ZTEST(net_route_ipv4, test_table_full)
+{
+	struct in_addr addr;
+	int i;
+
+	for (i = 0; i < CONFIG_NET_MAX_IPV4_ROUTES; i++) {
+		addr.s_addr = htonl(0x0a000000 | (i << 8));
+		zassert_not_null(net_route_ipv4_add(iface1, &addr, 24, &gw1),
+				 "Route %d add failed", i);
+	}
+
+	addr.s_addr = htonl(0x0b000000);
+	zassert_is_null(net_route_ipv4_add(iface1, &addr, 24, &gw1),
+			"Route added to full table");
+
+	for (i = 0; i < CONFIG_NET_MAX_IPV4_ROUTES; i++) {
+		addr.s_addr = htonl(0x0a000000 | (i << 8) | 1);
+		zassert_not_null(net_route_ipv4_lookup(NULL, &addr),
+				 "Route %d not found", i);
+	}
+}
+
+static struct net_pkt *prepare_pkt(struct net_if *iface, struct in_addr *src,
+				   const char *dst, uint8_t ttl)
+{
+	static const uint8_t payload[] = {
+		0x12, 0x34, 0x56, 0x78, 0x00, 0x0c, 0x00, 0x00,
+		'd', 'a', 't', 'a'
+	};
+	struct net_ipv4_hdr hdr = { 0 };
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_alloc_with_buffer(iface, sizeof(hdr) + sizeof(payload),
+					AF_INET, IPPROTO_UDP, K_NO_WAIT);
+	zassert_not_null(pkt, "Cannot allocate packet");
+
+	hdr.vhl = 0x45;
+	hdr.len = htons(sizeof(hdr) + sizeof(payload));
+	hdr.ttl = ttl;
+	hdr.proto = IPPROTO_UDP;
+	net_ipv4_addr_copy_raw(hdr.src, (uint8_t *)src);
+	zassert_ok(net_addr_pton(AF_INET, dst, (struct in_addr *)hdr.dst), "");
+
+	zassert_ok(net_pkt_write(pkt, &hdr, sizeof(hdr)), "");
+	zassert_ok(net_pkt_write(pkt, payload, sizeof(payload)), "");
+
+	net_pkt_set_ip_hdr_len(pkt, sizeof(hdr));
+	NET_IPV4_HDR(pkt)->chksum = net_calc_chksum_ipv4(pkt);
+
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+static void inject(struct net_if *iface, const char *dst, uint8_t ttl)
+{
+	struct net_pkt *pkt = prepare_pkt(iface, &peer1, dst, ttl);
+
+	if (net_recv_data(iface, pkt) < 0) {
+		net_pkt_unref(pkt);
+		zassert_unreachable("Data receive failed");
+	}
+}
+
+ZTEST(net_route_ipv4, test_forward)
+{
+	zassert_not_null(add_route(iface2, "10.1.0.0", 16, &gw2), "");
+
+	inject(iface1, "10.1.3.3", 64);
+
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not forwarded");
+	zassert_equal_ptr(sent_iface, iface2, "Sent via wrong interface");
+	zassert_equal(sent_hdr.ttl, 63, "TTL not decremented");
+	zassert_true(sent_chksum_ok, "Invalid header checksum");
+	zassert_mem_equal(sent_hdr.src, &peer1, sizeof(peer1), "Source changed");
+
+	/* Directly connected network does not need a route */
+	inject(iface2, "192.0.2.20", 64);
+
+	zassert_ok(k_sem_take(&wait_data, WAIT_TIME), "Packet not forwarded");
+	zassert_equal_ptr(sent_iface, iface1, "Sent via wrong interface");
+	zassert_true(sent_chksum_ok, "Invalid header checksum");
+
+	/* Expired TTL */
+	inject(iface1, "10.1.3.3", 1);
+	zassert_equal(k_sem_take(&wait_data, WAIT_TIME), -EAGAIN,
+		      "Packet with expired TTL forwarded");
+
+	/* No route */
+	inject(iface1, "10.2.3.3", 64);
+	zassert_equal(k_sem_take(&wait_data, WAIT_TIME), -EAGAIN,
+		      "Packet without route forwarded");
+
+	/* Link-local destination */
+	zassert_not_null(add_route(iface2, "169.254.0.0", 16, NULL), "");
+	inject(iface1, "169.254.1.1", 64);
+	zassert_equal(k_sem_take(&wait_data, WAIT_TIME), -EAGAIN,
+		      "Link-local packet forwarded");
+}
+
+/* Routes with 128-bit keys that share a few common prefixes, so that the
+ * trie gets both nested prefixes and branching nodes.
+ */
+struct lpm_test_route {
+	sys_snode_t node;
+	uint8_t key[16];
+	uint8_t len;
+	bool used;
+};
+
+NET_ROUTE_LPM_DEFINE(test_lpm, LPM_TEST_ROUTES, 128);
+
+static struct lpm_test_route lpm_routes[LPM_TEST_ROUTES];
+
+static bool key_match(const uint8_t *prefix, const uint8_t *addr, uint8_t len)
+{
+	for (int i = 0; i < len; i++) {
+		uint8_t mask = 0x80 >> (i % 8);
+
+		if ((prefix[i / 8] & mask) != (addr[i / 8] & mask)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void random_key(uint8_t *key)
+{
+	static const uint8_t bases[][4] = {
+		{ 0x20, 0x01, 0x0d, 0xb8 },
+		{ 0x20, 0x01, 0x0d, 0xb9 },
+		{ 0xfd, 0x00, 0x00, 0x00 },
+	};
+
+	for (int i = 0; i < 16; i++) {
+		key[i] = test_rand();
+	}
+
+	/* Most keys share a base, and the bytes after it vary little */
+	memcpy(key, bases[test_rand() % ARRAY_SIZE(bases)], 4);
+	key[4] &= 0x03;
+	key[5] &= 0x81;
+}
+
+static void lpm_verify(void)
+{
+	uint8_t addr[16];
+
+	for (int n = 0; n < LPM_TEST_LOOKUPS; n++) {
+		struct lpm_test_route *expected = NULL;
+		sys_snode_t *found;
+		int i;
+
+		/* Address near one of the routes */
+		i = test_rand() % LPM_TEST_ROUTES;
+		memcpy(addr, lpm_routes[i].key, sizeof(addr));
+		addr[test_rand() % 16] ^= BIT(test_rand() % 8);
+
+		for (i = 0; i < LPM_TEST_ROUTES; i++) {
+			if (lpm_routes[i].used &&
+			    key_match(lpm_routes[i].key, addr, lpm_routes[i].len) &&
+			    (expected == NULL || lpm_routes[i].len > expected->len)) {
+				expected = &lpm_routes[i];
+			}
+		}
+
+		found = net_route_lpm_lookup(&test_lpm, addr, NULL, NULL);
+		if (expected == NULL) {
+			zassert_is_null(found, "Unexpected match");
+			continue;
+		}
+
+		zassert_not_null(found, "No match");
+		zassert_equal(CONTAINER_OF(found, struct lpm_test_route, node)->len,
+			      expected->len, "Match is not the longest one");
+	}
+}
+
+ZTEST(net_route_lpm, test_random)
+{
+	int i;
+
+	for (i = 0; i < LPM_TEST_ROUTES; i++) {
+		random_key(lpm_routes[i].key);
+		lpm_routes[i].len = test_rand() % 129;
+
+		/* Some routes have the same prefix */
+		if (i > 0 && (i % 8) == 0) {
+			memcpy(lpm_routes[i].key, lpm_routes[i - 1].key, 16);
+			lpm_routes[i].len = lpm_routes[i - 1].len;
+		}
+
+		zassert_ok(net_route_lpm_insert(&test_lpm, lpm_routes[i].key,
+						lpm_routes[i].len,
+						&lpm_routes[i].node),
+			   "Insert %d failed", i);
+		lpm_routes[i].used = true;
+	}
+
+	zassert_equal(net_route_lpm_insert(&test_lpm, lpm_routes[0].key, 129,
+					   &lpm_routes[0].node),
+		      -EINVAL, "Too long prefix accepted");
+
+	lpm_verify();
+
+	for (i = 0; i < LPM_TEST_ROUTES; i++) {
+		zassert_not_null(net_route_lpm_find(&test_lpm, lpm_routes[i].key,
+						    lpm_routes[i].len, NULL, NULL),
+				 "Route %d not found", i);
+	}
+
+	/* Remove every other route, and then the rest */
+	for (i = 0; i < LPM_TEST_ROUTES; i += 2) {
+		zassert_ok(net_route_lpm_remove(&test_lpm, lpm_routes[i].key,
+						lpm_routes[i].len,
+						&lpm_routes[i].node),
+			   "Remove %d failed", i);
+		lpm_routes[i].used = false;
+	}
+
+	zassert_equal(net_route_lpm_remove(&test_lpm, lpm_routes[0].key,
+					   lpm_routes[0].len, &lpm_routes[0].node),
+		      -ENOENT, "Removed twice");
+
+	lpm_verify();
+
+	/* Freed nodes can be used again */
+	for (i = 0; i < LPM_TEST_ROUTES; i += 2) {
+		random_key(lpm_routes[i].key);
+		lpm_routes[i].len = test_rand() % 129;
+		zassert_ok(net_route_lpm_insert(&test_lpm, lpm_routes[i].key,
+						lpm_routes[i].len,
+						&lpm_routes[i].node),
+			   "Insert %d failed", i);
+		lpm_routes[i].used = true;
+	}
+
+	lpm_verify();
+
+	for (i = 0; i < LPM_TEST_ROUTES; i++) {
+		zassert_ok(net_route_lpm_remove(&test_lpm, lpm_routes[i].key,
+						lpm_routes[i].len,
+						&lpm_routes[i].node),
+			   "Remove %d failed", i);
+		lpm_routes[i].used = false;
+	}
+
+	zassert_is_null(test_lpm.root, "Trie not empty");
+}
+
+/* Linear scan over the same routes, this is how the lookup used to work */
+static const struct in_addr *bench_nets;
+static const uint8_t *bench_lens;
+
+static int linear_lookup(int count, uint32_t dst)
+{
+	int found = -1;
+	int longest = -1;
+
+	for (int i = 0; i < count; i++) {
+		uint32_t mask = bench_lens[i] ? UINT32_MAX << (32 - bench_lens[i]) : 0;
+
+		if ((dst & mask) == ntohl(bench_nets[i].s_addr) &&
+		    bench_lens[i] > longest) {
+			found = i;
+			longest = bench_lens[i];
+		}
+	}
+
+	return found;
+}
+
+ZTEST(net_route_ipv4, test_lookup_throughput)
+{
+	static const int sizes[] = { 16, 64, CONFIG_NET_MAX_IPV4_ROUTES };
+	static struct in_addr nets[CONFIG_NET_MAX_IPV4_ROUTES];
+	static uint8_t lens[CONFIG_NET_MAX_IPV4_ROUTES];
+	static struct in_addr dsts[BENCH_LOOKUPS];
+	volatile uintptr_t sink = 0;
+	uint64_t cycles, cycles_ref;
+	timing_t start, end;
+	int count = 0;
+
+	bench_nets = nets;
+	bench_lens = lens;
+
+	timing_init();
+	timing_start();
+
+	for (int s = 0; s < ARRAY_SIZE(sizes); s++) {
+		for (; count < sizes[s]; count++) {
+			lens[count] = 8 + test_rand() % 25;
+			nets[count].s_addr = htonl(test_rand() &
+						   (UINT32_MAX << (32 - lens[count])));
+
+			/* Duplicates of an existing route are fine here */
+			zassert_not_null(net_route_ipv4_add(iface1, &nets[count],
+							    lens[count], &gw1),
+					 "Route add failed");
+		}
+
+		for (int i = 0; i < BENCH_LOOKUPS; i++) {
+			int r = test_rand() % count;
+			uint32_t host = lens[r] < 32 ?
+				test_rand() & (UINT32_MAX >> lens[r]) : 0;
+
+			dsts[i].s_addr = htonl(ntohl(nets[r].s_addr) | host);
+		}
+
+		start = timing_counter_get();
+		for (int i = 0; i < BENCH_LOOKUPS; i++) {
+			sink += linear_lookup(count, ntohl(dsts[i].s_addr));
+		}
+		end = timing_counter_get();
+		cycles_ref = timing_cycles_get(&start, &end);
+
+		start = timing_counter_get();
+		for (int i = 0; i < BENCH_LOOKUPS; i++) {
+			sink += (uintptr_t)net_route_ipv4_lookup(NULL, &dsts[i]);
+		}
+		end = timing_counter_get();
+		cycles = timing_cycles_get(&start, &end);
+
+		TC_PRINT("%d routes, %d lookups: linear %llu ns, trie %llu ns\n",
+			 count, BENCH_LOOKUPS, timing_cycles_to_ns(cycles_ref),
+			 timing_cycles_to_ns(cycles));
+		TC_PRINT("%d routes: %llu lookups per second\n", count,
+			 timing_cycles_to_ns(cycles) == 0 ? 0ULL :
+			 (uint64_t)BENCH_LOOKUPS * NSEC_PER_SEC /
+			 timing_cycles_to_ns(cycles));
+
+		/* Results must agree with the linear scan */
+		for (int i = 0; i < 100; i++) {
+			struct net_route_entry_ipv4 *route;
+			int r = linear_lookup(count, ntohl(dsts[i].s_addr));
+
+			route = net_route_ipv4_lookup(NULL, &dsts[i]);
+			zassert_not_null(route, "No route");
+			zassert_equal(route->prefix_len, lens[r], "Wrong route");
+		}
+	}
+
+	timing_stop();
+}
+
+ZTEST_SUITE(net_route_ipv4, NULL, setup, NULL, after, NULL);
+ZTEST_SUITE(net_route_lpm, NULL, NULL, NULL, NULL, NULL);
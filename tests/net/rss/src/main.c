@@ -0,0 +1,366 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_rss_test, CONFIG_NET_TC_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/buf.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+#include <net_private.h>
+#include <ipv4.h>
+#include <ipv6.h>
+#include <udp_internal.h>
+
+#define NUM_FLOWS 16
+#define PKTS_PER_FLOW 8
+#define BENCH_PKTS 2000
+#define MAX_THREADS 16
+
+#define LOCAL_PORT 4242
+#define REMOTE_PORT_BASE 10000
+
+#define WAIT_TIME K_SECONDS(5)
+#define ALLOC_TIMEOUT K_MSEC(500)
+
+/* 192.0.2.1 is ours, the flows come from 192.0.2.2 */
+static struct in_addr my_addr4 = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr4 = { { { 192, 0, 2, 2 } } };
+
+/* 2001:db8::1 is ours, the flows come from 2001:db8::2 */
+static struct in6_addr my_addr6 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr peer_addr6 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					  0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+
+/* Payload of the test datagrams */
+struct flow_data {
+	uint16_t flow;
+	uint32_t seq;
+} __packed;
+
+struct flow_state {
+	k_tid_t thread;
+	uint32_t next_seq;
+	bool misordered;
+	bool moved;
+};
+
+static struct net_if *iface1;
+static struct k_sem wait_data;
+
+static struct flow_state flows[NUM_FLOWS];
+static k_tid_t threads[MAX_THREADS];
+static int thread_count;
+static struct k_spinlock threads_lock;
+static atomic_t received;
+
+static uint8_t net_iface_dummy_data;
+
+static void net_iface_init(struct net_if *iface)
+{
+	static uint8_t mac[6] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05 };
+
+	net_if_set_link_addr(iface, mac, sizeof(mac), NET_LINK_DUMMY);
+}
+
+static int sender_iface(const struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static struct dummy_api net_iface_api = {
+	.iface_api.init = net_iface_init,
+	.send = sender_iface,
+};
+
+NET_DEVICE_INIT_INSTANCE(net_iface1_test,
+			 "iface1",
+			 iface1,
+			 NULL,
+			 NULL,
+			 &net_iface_dummy_data,
+			 NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &net_iface_api,
+			 DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2),
+			 NET_IPV6_MTU);
+
+static void thread_seen(k_tid_t thread)
+{
+	k_spinlock_key_t key = k_spin_lock(&threads_lock);
+	int i;
+
+	for (i = 0; i < thread_count; i++) {
+		if (threads[i] == thread) {
+			goto out;
+		}
+	}
+
+	if (thread_count < ARRAY_SIZE(threads)) {
+		threads[thread_count++] = thread;
+	}
+
+out:
+	k_spin_unlock(&threads_lock, key);
+}
+
+static enum net_verdict udp_data_received(struct net_conn *conn, struct net_pkt *pkt,
+					  union net_ip_header *ip_hdr,
+					  union net_proto_header *proto_hdr, void *user_data)
+{
+	struct flow_data data;
+	struct flow_state *flow;
+
+	ARG_UNUSED(conn);
+	ARG_UNUSED(ip_hdr);
+	ARG_UNUSED(proto_hdr);
+	ARG_UNUSED(user_data);
+
+	net_pkt_cursor_init(pkt);
+	net_pkt_set_overwrite(pkt, true);
+
+	if (net_pkt_skip(pkt, net_pkt_ip_hdr_len(pkt) + net_pkt_ip_opts_len(pkt) +
+			      NET_UDPH_LEN) ||
+	    net_pkt_read(pkt, &data, sizeof(data)) ||
+	    data.flow >= NUM_FLOWS) {
+		goto out;
+	}
+
+	/* Each flow is handled by one thread only, so no locking needed */
+	flow = &flows[data.flow];
+
+	if (flow->thread == NULL) {
+		flow->thread = k_current_get();
+		thread_seen(flow->thread);
+	} else if (flow->thread != k_current_get()) {
+		flow->moved = true;
+	}
+
+	if (data.seq != flow->next_seq) {
+		flow->misordered = true;
+	}
+
+	flow->next_seq = data.seq + 1;
+
+out:
+	net_pkt_unref(pkt);
+
+	atomic_inc(&received);
+	k_sem_give(&wait_data);
+
+	return NET_OK;
+}
+
+static void setup_udp_handler(sa_family_t family)
+{
+	struct net_conn_handle *handle;
+	struct sockaddr local_addr = { 0 };
+	int ret;
+
+	local_addr.sa_family = family;
+
+	if (family == AF_INET) {
+		net_ipaddr_copy(&net_sin(&local_addr)->sin_addr, &my_addr4);
+	} else {
+		net_ipaddr_copy(&net_sin6(&local_addr)->sin6_addr, &my_addr6);
+	}
+
+	ret = net_udp_register(family, NULL, &local_addr, 0, LOCAL_PORT, NULL,
+			       udp_data_received, NULL, &handle);
+	zassert_equal(ret, 0, "Cannot register UDP connection (%d)", ret);
+}
+
+static void recv_datagram(sa_family_t family, uint16_t flow, uint32_t seq)
+{
+	struct flow_data data = { .flow = flow, .seq = seq };
+	uint16_t ip_len = family == AF_INET ? NET_IPV4H_LEN : NET_IPV6H_LEN;
+	uint16_t udp_len = NET_UDPH_LEN + sizeof(data);
+	struct net_udp_hdr udp = {
+		.src_port = htons(REMOTE_PORT_BASE + flow),
+		.dst_port = htons(LOCAL_PORT),
+		.len = htons(udp_len),
+	};
+	struct net_pkt *pkt;
+	int ret;
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface1, ip_len + udp_len, family,
+					   IPPROTO_UDP, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Packet creation failed");
+
+	if (family == AF_INET) {
+		struct net_ipv4_hdr hdr = {
+			.vhl = 0x45,
+			.len = htons(ip_len + udp_len),
+			.ttl = 64,
+			.proto = IPPROTO_UDP,
+		};
+
+		net_ipv4_addr_copy_raw(hdr.src, (uint8_t *)&peer_addr4);
+		net_ipv4_addr_copy_raw(hdr.dst, (uint8_t *)&my_addr4);
+
+		ret = net_pkt_write(pkt, &hdr, sizeof(hdr));
+	} else {
+		struct net_ipv6_hdr hdr = {
+			.vtc = 0x60,
+			.len = htons(udp_len),
+			.nexthdr = IPPROTO_UDP,
+			.hop_limit = 64,
+		};
+
+		net_ipv6_addr_copy_raw(hdr.src, (uint8_t *)&peer_addr6);
+		net_ipv6_addr_copy_raw(hdr.dst, (uint8_t *)&my_addr6);
+
+		ret = net_pkt_write(pkt, &hdr, sizeof(hdr));
+	}
+
+	zassert_equal(ret, 0, "IP header append failed");
+
+	ret = net_pkt_write(pkt, &udp, sizeof(udp));
+	zassert_equal(ret, 0, "UDP header append failed");
+
+	ret = net_pkt_write(pkt, &data, sizeof(data));
+	zassert_equal(ret, 0, "UDP data append failed");
+
+	net_pkt_set_ip_hdr_len(pkt, ip_len);
+
+	if (family == AF_INET) {
+		net_pkt_cursor_init(pkt);
+		NET_IPV4_HDR(pkt)->chksum = net_calc_chksum_ipv4(pkt);
+	}
+
+	ret = net_recv_data(iface1, pkt);
+	zassert_equal(ret, 0, "Cannot receive data (%d)", ret);
+}
+
+static void wait_received(int count)
+{
+	while (atomic_get(&received) < count) {
+		zassert_equal(k_sem_take(&wait_data, WAIT_TIME), 0,
+			      "Timeout, %ld of %d packets received",
+			      atomic_get(&received), count);
+	}
+}
+
+static void check_flows(sa_family_t family)
+{
+	int seq;
+	int i;
+
+	for (seq = 0; seq < PKTS_PER_FLOW; seq++) {
+		for (i = 0; i < NUM_FLOWS; i++) {
+			recv_datagram(family, i, seq);
+		}
+	}
+
+	wait_received(NUM_FLOWS * PKTS_PER_FLOW);
+
+	for (i = 0; i < NUM_FLOWS; i++) {
+		zassert_not_null(flows[i].thread, "Flow %d not received", i);
+		zassert_false(flows[i].misordered, "Flow %d out of order", i);
+		zassert_false(flows[i].moved, "Flow %d changed thread", i);
+		zassert_equal(flows[i].next_seq, PKTS_PER_FLOW,
+			      "Flow %d lost packets", i);
+	}
+
+	/* The flows are spread over the queues, with 16 flows and 4 queues
+	 * the hash would have to be really bad for them all to land in one.
+	 */
+	if (CONFIG_NET_RX_RSS_QUEUES > 1) {
+		zassert_true(thread_count > 1, "All flows in one thread");
+	}
+
+	zassert_true(thread_count <= CONFIG_NET_RX_RSS_QUEUES,
+		     "Flows handled by %d threads", thread_count);
+}
+
+ZTEST(net_rss, test_ipv4_flows)
+{
+	check_flows(AF_INET);
+}
+
+ZTEST(net_rss, test_ipv6_flows)
+{
+	check_flows(AF_INET6);
+}
+
+ZTEST(net_rss, test_multi_flow_throughput)
+{
+	timing_t start_time, end_time;
+	uint64_t ns;
+	int i;
+
+	timing_init();
+	timing_start();
+
+	start_time = timing_counter_get();
+
+	for (i = 0; i < BENCH_PKTS; i++) {
+		recv_datagram(AF_INET, i % NUM_FLOWS, i / NUM_FLOWS);
+	}
+
+	wait_received(BENCH_PKTS);
+
+	end_time = timing_counter_get();
+	ns = timing_cycles_to_ns(timing_cycles_get(&start_time, &end_time));
+
+	timing_stop();
+
+	for (i = 0; i < NUM_FLOWS; i++) {
+		zassert_false(flows[i].misordered, "Flow %d out of order", i);
+	}
+
+	TC_PRINT("%d packets in %d flows over %d threads in %llu us\n",
+		 BENCH_PKTS, NUM_FLOWS, thread_count, ns / NSEC_PER_USEC);
+}
+
+static void *test_setup(void)
+{
+	struct net_if_addr *ifaddr;
+
+	k_sem_init(&wait_data, 0, UINT_MAX);
+
+	iface1 = net_if_get_by_index(1);
+	zassert_not_null(iface1, "Network interface is null");
+
+	ifaddr = net_if_ipv4_addr_add(iface1, &my_addr4, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add IPv4 address");
+
+	ifaddr = net_if_ipv6_addr_add(iface1, &my_addr6, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add IPv6 address");
+
+	net_if_up(iface1);
+
+	setup_udp_handler(AF_INET);
+	setup_udp_handler(AF_INET6);
+
+	return NULL;
+}
+
+static void test_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	memset(flows, 0, sizeof(flows));
+	memset(threads, 0, sizeof(threads));
+	thread_count = 0;
+	atomic_set(&received, 0);
+	k_sem_reset(&wait_data);
+}
+
+ZTEST_SUITE(net_rss, NULL, test_setup, test_before, NULL, NULL);
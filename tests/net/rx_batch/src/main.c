@@ -0,0 +1,356 @@
+/*
+ * Copyright The Zephyr Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_rx_batch_test, CONFIG_NET_CORE_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/buf.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+#include <net_private.h>
+#include <ipv4.h>
+#include <udp_internal.h>
+
+#define NUM_FLOWS 4
+#define BATCH_SIZE 16
+#define BENCH_PKTS 4096
+
+#define LOCAL_PORT 4242
+#define REMOTE_PORT_BASE 10000
+
+#define WAIT_TIME K_SECONDS(5)
+#define ALLOC_TIMEOUT K_MSEC(500)
+
+/* 192.0.2.1 is ours, the packets come from 192.0.2.2 */
+static struct in_addr my_addr = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr = { { { 192, 0, 2, 2 } } };
+
+/* Payload of the test datagrams */
+struct flow_data {
+	uint16_t flow;
+	uint32_t seq;
+} __packed;
+
+static struct net_if *iface1;
+static struct k_sem wait_data;
+
+static uint32_t next_seq[NUM_FLOWS];
+static bool misordered;
+static atomic_t received;
+
+static uint8_t net_iface_dummy_data;
+
+static void net_iface_init(struct net_if *iface)
+{
+	static uint8_t mac[6] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05 };
+
+	net_if_set_link_addr(iface, mac, sizeof(mac), NET_LINK_DUMMY);
+}
+
+static int sender_iface(const struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static struct dummy_api net_iface_api = {
+	.iface_api.init = net_iface_init,
+	.send = sender_iface,
+};
+
+NET_DEVICE_INIT_INSTANCE(net_iface1_test,
+			 "iface1",
+			 iface1,
+			 NULL,
+			 NULL,
+			 &net_iface_dummy_data,
+			 NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &net_iface_api,
+			 DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2),
+			 NET_IPV4_MTU);
+
+static enum net_verdict udp_data_received(struct net_conn *conn, struct net_pkt *pkt,
+					  union net_ip_header *ip_hdr,
+					  union net_proto_header *proto_hdr, void *user_data)
+{
+	struct flow_data data;
+
+	ARG_UNUSED(conn);
+	ARG_UNUSED(ip_hdr);
+	ARG_UNUSED(proto_hdr);
+	ARG_UNUSED(user_data);
+
+	net_pkt_cursor_init(pkt);
+	net_pkt_set_overwrite(pkt, true);
+
+	if (net_pkt_skip(pkt, net_pkt_ip_hdr_len(pkt) + NET_UDPH_LEN) ||
+	    net_pkt_read(pkt, &data, sizeof(data)) ||
+	    data.flow >= NUM_FLOWS) {
+		goto out;
+	}
+
+	/* The packets of one flow are all handled by the same thread */
+	if (data.seq != next_seq[data.flow]) {
+		misordered = true;
+	}
+
+	next_seq[data.flow] = data.seq + 1;
+
+out:
+	net_pkt_unref(pkt);
+
+	atomic_inc(&received);
+	k_sem_give(&wait_data);
+
+	return NET_OK;
+}
+
+static struct net_pkt *create_datagram(uint16_t flow, uint32_t seq)
+{
+	struct flow_data data = { .flow = flow, .seq = seq };
+	uint16_t udp_len = NET_UDPH_LEN + sizeof(data);
+	struct net_ipv4_hdr hdr = {
+		.vhl = 0x45,
+		.len = htons(NET_IPV4H_LEN + udp_len),
+		.ttl = 64,
+		.proto = IPPROTO_UDP,
+	};
+	struct net_udp_hdr udp = {
+		.src_port = htons(REMOTE_PORT_BASE + flow),
+		.dst_port = htons(LOCAL_PORT),
+		.len = htons(udp_len),
+	};
+	struct net_pkt *pkt;
+	int ret;
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface1, NET_IPV4H_LEN + udp_len,
+					   AF_INET, IPPROTO_UDP, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Packet creation failed");
+
+	net_ipv4_addr_copy_raw(hdr.src, (uint8_t *)&peer_addr);
+	net_ipv4_addr_copy_raw(hdr.dst, (uint8_t *)&my_addr);
+
+	ret = net_pkt_write(pkt, &hdr, sizeof(hdr));
+	zassert_equal(ret, 0, "IPv4 header append failed");
+
+	ret = net_pkt_write(pkt, &udp, sizeof(udp));
+	zassert_equal(ret, 0, "UDP header append failed");
+
+	ret = net_pkt_write(pkt, &data, sizeof(data));
+	zassert_equal(ret, 0, "UDP data append failed");
+
+	net_pkt_set_ip_hdr_len(pkt, NET_IPV4H_LEN);
+	net_pkt_cursor_init(pkt);
+	NET_IPV4_HDR(pkt)->chksum = net_calc_chksum_ipv4(pkt);
+
+	return pkt;
+}
+
+static void wait_received(int count)
+{
+	while (atomic_get(&received) < count) {
+		zassert_equal(k_sem_take(&wait_data, WAIT_TIME), 0,
+			      "Timeout, %ld of %d packets received",
+			      atomic_get(&received), count);
+	}
+}
+
+static void recv_batch(int first, int count)
+{
+	struct net_pkt *pkts[BATCH_SIZE];
+	int ret;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		pkts[i] = create_datagram((first + i) % NUM_FLOWS,
+					  (first + i) / NUM_FLOWS);
+	}
+
+	ret = net_recv_data_batch(iface1, pkts, count);
+	zassert_equal(ret, 0, "Cannot receive batch (%d)", ret);
+}
+
+ZTEST(net_rx_batch, test_batch_in_order)
+{
+	int i;
+
+	for (i = 0; i < 4 * BATCH_SIZE; i += BATCH_SIZE) {
+		recv_batch(i, BATCH_SIZE);
+	}
+
+	wait_received(4 * BATCH_SIZE);
+
+	zassert_false(misordered, "Packets out of order");
+
+	for (i = 0; i < NUM_FLOWS; i++) {
+		zassert_equal(next_seq[i], 4 * BATCH_SIZE / NUM_FLOWS,
+			      "Flow %d lost packets", i);
+	}
+}
+
+ZTEST(net_rx_batch, test_batch_empty_packet)
+{
+	struct net_pkt *pkts[3];
+	int ret;
+
+	pkts[0] = create_datagram(0, 0);
+	pkts[1] = net_pkt_rx_alloc_with_buffer(iface1, 0, AF_INET, 0,
+					       ALLOC_TIMEOUT);
+	zassert_not_null(pkts[1], "Packet creation failed");
+	pkts[2] = create_datagram(0, 1);
+
+	ret = net_recv_data_batch(iface1, pkts, ARRAY_SIZE(pkts));
+	zassert_equal(ret, 0, "Cannot receive batch (%d)", ret);
+
+	/* The empty packet is dropped, the others are received */
+	wait_received(2);
+
+	zassert_false(misordered, "Packets out of order");
+	zassert_equal(next_seq[0], 2, "Packets lost");
+}
+
+ZTEST(net_rx_batch, test_batch_iface_down)
+{
+	struct net_pkt *pkts[2];
+	int ret;
+
+	pkts[0] = create_datagram(0, 0);
+	pkts[1] = create_datagram(0, 1);
+
+	net_if_down(iface1);
+
+	ret = net_recv_data_batch(iface1, pkts, ARRAY_SIZE(pkts));
+	zassert_equal(ret, -ENETDOWN, "Batch received on down interface");
+
+	net_if_up(iface1);
+
+	/* On error the packets still belong to the caller */
+	net_pkt_unref(pkts[0]);
+	net_pkt_unref(pkts[1]);
+
+	zassert_equal(atomic_get(&received), 0, "Packets received");
+}
+
+static uint64_t run_bench(bool batch)
+{
+	struct net_pkt *pkts[BATCH_SIZE];
+	timing_t start_time, end_time;
+	uint64_t cycles = 0;
+	int i, j;
+	int ret;
+
+	atomic_set(&received, 0);
+	memset(next_seq, 0, sizeof(next_seq));
+
+	for (i = 0; i < BENCH_PKTS; i += BATCH_SIZE) {
+		for (j = 0; j < BATCH_SIZE; j++) {
+			pkts[j] = create_datagram((i + j) % NUM_FLOWS,
+						  (i + j) / NUM_FLOWS);
+		}
+
+		start_time = timing_counter_get();
+
+		if (batch) {
+			ret = net_recv_data_batch(iface1, pkts, BATCH_SIZE);
+			zassert_equal(ret, 0, "Cannot receive batch (%d)", ret);
+		} else {
+			for (j = 0; j < BATCH_SIZE; j++) {
+				ret = net_recv_data(iface1, pkts[j]);
+				zassert_equal(ret, 0, "Cannot receive (%d)", ret);
+			}
+		}
+
+		wait_received(i + BATCH_SIZE);
+
+		end_time = timing_counter_get();
+		cycles += timing_cycles_get(&start_time, &end_time);
+	}
+
+	zassert_false(misordered, "Packets out of order");
+
+	return timing_cycles_to_ns(cycles);
+}
+
+static void print_rate(const char *name, uint64_t ns)
+{
+	if (ns == 0) {
+		TC_PRINT("%s: %d packets, too fast to measure\n", name,
+			 BENCH_PKTS);
+		return;
+	}
+
+	TC_PRINT("%s: %d packets in %llu us, %llu packets/s\n", name,
+		 BENCH_PKTS, ns / NSEC_PER_USEC,
+		 (uint64_t)BENCH_PKTS * NSEC_PER_SEC / ns);
+}
+
+ZTEST(net_rx_batch, test_batch_throughput)
+{
+	uint64_t single_ns;
+	uint64_t batch_ns;
+
+	timing_init();
+	timing_start();
+
+	single_ns = run_bench(false);
+	batch_ns = run_bench(true);
+
+	timing_stop();
+
+	print_rate("net_recv_data", single_ns);
+	print_rate("net_recv_data_batch", batch_ns);
+}
+
+static void *test_setup(void)
+{
+	struct net_conn_handle *handle;
+	struct sockaddr local_addr = { 0 };
+	struct net_if_addr *ifaddr;
+	int ret;
+
+	k_sem_init(&wait_data, 0, UINT_MAX);
+
+	iface1 = net_if_get_by_index(1);
+	zassert_not_null(iface1, "Network interface is null");
+
+	ifaddr = net_if_ipv4_addr_add(iface1, &my_addr, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add IPv4 address");
+
+	net_if_up(iface1);
+
+	local_addr.sa_family = AF_INET;
+	net_ipaddr_copy(&net_sin(&local_addr)->sin_addr, &my_addr);
+
+	ret = net_udp_register(AF_INET, NULL, &local_addr, 0, LOCAL_PORT, NULL,
+			       udp_data_received, NULL, &handle);
+	zassert_equal(ret, 0, "Cannot register UDP connection (%d)", ret);
+
+	return NULL;
+}
+
+static void test_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	memset(next_seq, 0, sizeof(next_seq));
+	misordered = false;
+	atomic_set(&received, 0);
+	k_sem_reset(&wait_data);
+}
+
+ZTEST_SUITE(net_rx_batch, NULL, test_setup, test_before, NULL, NULL);
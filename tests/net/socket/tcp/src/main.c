@@ -2486,6 +2486,234 @@ ZTEST(net_socket_tcp, test_keepalive_timeout)
 	test_context_cleanup();
 }
 
+ZTEST(net_socket_tcp, test_v4_recv_zc)
+{
+	static uint8_t tx_data[1000];
+	int c_sock;
+	int s_sock;
+	int new_sock;
+	struct sockaddr_in c_saddr;
+	struct sockaddr_in s_saddr;
+	struct sockaddr addr;
+	socklen_t addrlen = sizeof(addr);
+	struct net_buf *data, *frag;
+	size_t offset = 0;
+	ssize_t ret;
+
+	for (int i = 0; i < sizeof(tx_data); i++) {
+		tx_data[i] = (uint8_t)(i * 7);
+	}
+
+	prepare_sock_tcp_v4(MY_IPV4_ADDR, ANY_PORT, &c_sock, &c_saddr);
+	prepare_sock_tcp_v4(MY_IPV4_ADDR, SERVER_PORT, &s_sock, &s_saddr);
+
+	test_bind(s_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+	test_listen(s_sock);
+
+	test_connect(c_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+	test_send(c_sock, tx_data, sizeof(tx_data), 0);
+
+	test_accept(s_sock, &new_sock, &addr, &addrlen);
+
+	/* The data may arrive in several segments */
+	while (offset < sizeof(tx_data)) {
+		ret = zsock_recv_zc(new_sock, &data, 0, NULL, NULL);
+		zassert_true(ret > 0, "recv_zc failed (%d)", errno);
+		zassert_not_null(data, "no data");
+		zassert_equal(ret, net_buf_frags_len(data), "wrong length");
+
+		for (frag = data; frag != NULL; frag = frag->frags) {
+			zassert_true(offset + frag->len <= sizeof(tx_data),
+				     "too much data");
+			zassert_mem_equal(frag->data, &tx_data[offset], frag->len,
+					  "wrong data");
+			offset += frag->len;
+		}
+
+		zsock_recv_zc_release(data);
+	}
+
+	test_close(c_sock);
+
+	ret = zsock_recv_zc(new_sock, &data, 0, NULL, NULL);
+	zassert_equal(ret, 0, "no EOF");
+	zassert_is_null(data, "data returned at EOF");
+
+	test_close(new_sock);
+	test_close(s_sock);
+
+	test_context_cleanup();
+}
+
+static K_SEM_DEFINE(zc_tx_done, 0, 4);
+
+static void zc_tx_destroy(struct net_buf *buf)
+{
+	net_buf_destroy(buf);
+	k_sem_give(&zc_tx_done);
+}
+
+NET_BUF_POOL_DEFINE(zc_tx_pool, 4, 0, 0, zc_tx_destroy);
+
+/* Split the data to four fragments referring to it */
+static struct net_buf *alloc_zc_chain(uint8_t *data, size_t len)
+{
+	struct net_buf *chain = NULL;
+
+	for (int i = 0; i < 4; i++) {
+		struct net_buf *frag;
+
+		frag = net_buf_alloc_with_data(&zc_tx_pool, &data[i * len / 4],
+					       len / 4, K_NO_WAIT);
+		zassert_not_null(frag, "cannot allocate buffer");
+
+		if (chain == NULL) {
+			chain = frag;
+		} else {
+			net_buf_frag_add(chain, frag);
+		}
+	}
+
+	return chain;
+}
+
+ZTEST(net_socket_tcp, test_v4_send_zc)
+{
+	static uint8_t tx_data[2000];
+	static uint8_t rx_data[sizeof(tx_data)];
+	int c_sock;
+	int s_sock;
+	int new_sock;
+	struct sockaddr_in c_saddr;
+	struct sockaddr_in s_saddr;
+	struct sockaddr addr;
+	socklen_t addrlen = sizeof(addr);
+	struct net_buf *data;
+	size_t offset = 0;
+	ssize_t ret;
+
+	for (int i = 0; i < sizeof(tx_data); i++) {
+		tx_data[i] = (uint8_t)(i * 11);
+	}
+
+	prepare_sock_tcp_v4(MY_IPV4_ADDR, ANY_PORT, &c_sock, &c_saddr);
+	prepare_sock_tcp_v4(MY_IPV4_ADDR, SERVER_PORT, &s_sock, &s_saddr);
+
+	test_bind(s_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+	test_listen(s_sock);
+
+	test_connect(c_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+	test_accept(s_sock, &new_sock, &addr, &addrlen);
+
+	data = alloc_zc_chain(tx_data, sizeof(tx_data));
+
+	ret = zsock_send_zc(c_sock, &data, 0, NULL, 0);
+	zassert_equal(ret, sizeof(tx_data), "send_zc failed (%d)", errno);
+	zassert_is_null(data, "data left");
+
+	while (offset < sizeof(rx_data)) {
+		ret = zsock_recv(new_sock, &rx_data[offset],
+				 sizeof(rx_data) - offset, 0);
+		zassert_true(ret > 0, "recv failed (%d)", errno);
+		offset += ret;
+	}
+
+	zassert_mem_equal(rx_data, tx_data, sizeof(tx_data), "wrong data");
+
+	/* Fragments are released when the peer has acknowledged them */
+	for (int i = 0; i < 4; i++) {
+		zassert_ok(k_sem_take(&zc_tx_done, K_MSEC(1000)),
+			   "no completion");
+	}
+
+	test_close(c_sock);
+	test_close(new_sock);
+	test_close(s_sock);
+
+	test_context_cleanup();
+}
+
+ZTEST(net_socket_tcp, test_v4_send_zc_window)
+{
+	static uint8_t tx_data[2000];
+	int buf_optval = 700;
+	int c_sock;
+	int s_sock;
+	int new_sock;
+	struct sockaddr_in c_saddr;
+	struct sockaddr_in s_saddr;
+	struct sockaddr addr;
+	socklen_t addrlen = sizeof(addr);
+	struct net_buf *data;
+	ssize_t ret;
+
+	prepare_sock_tcp_v4(MY_IPV4_ADDR, ANY_PORT, &c_sock, &c_saddr);
+	prepare_sock_tcp_v4(MY_IPV4_ADDR, SERVER_PORT, &s_sock, &s_saddr);
+
+	/* Lower client-side TX window size. */
+	ret = zsock_setsockopt(c_sock, SOL_SOCKET, SO_SNDBUF, &buf_optval,
+			       sizeof(buf_optval));
+	zassert_equal(ret, 0, "setsockopt failed (%d)", errno);
+
+	test_bind(s_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+	test_listen(s_sock);
+
+	test_connect(c_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+	test_accept(s_sock, &new_sock, &addr, &addrlen);
+
+	/* Make sure the ACK from the server does not arrive. */
+	loopback_set_packet_drop_ratio(1.0f);
+
+	/* The first fragment fits the window, and a part of the second */
+	data = alloc_zc_chain(tx_data, sizeof(tx_data));
+
+	ret = zsock_send_zc(c_sock, &data, ZSOCK_MSG_DONTWAIT, NULL, 0);
+	zassert_equal(ret, buf_optval, "send_zc failed (%d)", errno);
+
+	/* The data that was not queued stays with the caller */
+	zassert_not_null(data, "no data left");
+	zassert_equal(net_buf_frags_len(data), sizeof(tx_data) - buf_optval,
+		      "wrong data left");
+	zassert_mem_equal(data->data, &tx_data[buf_optval], data->len,
+			  "wrong data left");
+	zassert_not_ok(k_sem_take(&zc_tx_done, K_NO_WAIT),
+		       "fragment released");
+
+	/* Dropping it releases the fragments that were not queued */
+	net_buf_unref(data);
+
+	for (int i = 0; i < 3; i++) {
+		zassert_ok(k_sem_take(&zc_tx_done, K_NO_WAIT), "no completion");
+	}
+
+	zassert_not_ok(k_sem_take(&zc_tx_done, K_NO_WAIT),
+		       "queued fragment released");
+
+	/* The window is full, the data stays with the caller */
+	data = net_buf_alloc_with_data(&zc_tx_pool, tx_data, 10, K_NO_WAIT);
+	zassert_not_null(data, "cannot allocate buffer");
+
+	ret = zsock_send_zc(c_sock, &data, ZSOCK_MSG_DONTWAIT, NULL, 0);
+	zassert_equal(ret, -1, "Unexpected return code %d", ret);
+	zassert_equal(errno, EAGAIN, "Unexpected errno value: %d", errno);
+	zassert_not_ok(k_sem_take(&zc_tx_done, K_NO_WAIT),
+		       "fragment released on error");
+
+	net_buf_unref(data);
+	zassert_ok(k_sem_take(&zc_tx_done, K_NO_WAIT), "no completion");
+
+	restore_packet_loss_ratio();
+
+	test_close(c_sock);
+	test_close(new_sock);
+	test_close(s_sock);
+
+	test_context_cleanup();
+
+	/* The queued fragment is released with the connection */
+	zassert_ok(k_sem_take(&zc_tx_done, K_MSEC(1000)), "no completion");
+}
+
 static void after(void *arg)
 {
 	ARG_UNUSED(arg);
@@ -1811,6 +1811,391 @@ ZTEST(net_socket_tls, test_poll_dtls_pollerr)
 	k_msleep(10);
 }
 
+#if defined(CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID)
+#define NAT_FRONT_PORT (SERVER_PORT + 1)
+#define NAT_BACK_PORT (SERVER_PORT + 2)
+#define NAT_PROXY_STACK_SIZE 1024
+
+/* UDP forwarder standing for a NAT between the DTLS client and server. The
+ * traffic of the client is sent from one of two sockets, so the mapping,
+ * and thus the address seen by the server, can be changed mid-session.
+ * A datagram of the client can also be held back, to deliver it late.
+ */
+static struct {
+	int front;
+	int back[2];
+	atomic_t mapping;
+	atomic_t stop;
+	atomic_t hold;
+	uint8_t held[512];
+	ssize_t held_len;
+	struct sockaddr_in client_addr;
+	struct sockaddr_in server_addr;
+} nat;
+
+K_THREAD_STACK_DEFINE(nat_proxy_stack, NAT_PROXY_STACK_SIZE);
+static struct k_thread nat_proxy_thread;
+
+static void nat_proxy_forward(int from, int to, struct sockaddr_in *dst,
+			      struct sockaddr_in *src)
+{
+	static uint8_t buf[512];
+	socklen_t addrlen = sizeof(*src);
+	struct sockaddr_in addr;
+	ssize_t len;
+
+	len = zsock_recvfrom(from, buf, sizeof(buf), ZSOCK_MSG_DONTWAIT,
+			     (struct sockaddr *)&addr, &addrlen);
+	if (len < 0) {
+		return;
+	}
+
+	if (src != NULL) {
+		*src = addr;
+	}
+
+	(void)zsock_sendto(to, buf, len, 0, (struct sockaddr *)dst,
+			   sizeof(*dst));
+}
+
+static void nat_proxy_run(void *p1, void *p2, void *p3)
+{
+	struct zsock_pollfd fds[] = {
+		{ .fd = nat.front, .events = ZSOCK_POLLIN },
+		{ .fd = nat.back[0], .events = ZSOCK_POLLIN },
+		{ .fd = nat.back[1], .events = ZSOCK_POLLIN },
+	};
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (!atomic_get(&nat.stop)) {
+		if (zsock_poll(fds, ARRAY_SIZE(fds), 10) <= 0) {
+			continue;
+		}
+
+		if ((fds[0].revents & ZSOCK_POLLIN) &&
+		    atomic_cas(&nat.hold, 1, 0)) {
+			nat.held_len = zsock_recvfrom(nat.front, nat.held,
+						      sizeof(nat.held),
+						      ZSOCK_MSG_DONTWAIT,
+						      NULL, NULL);
+		} else if (fds[0].revents & ZSOCK_POLLIN) {
+			nat_proxy_forward(nat.front,
+					  nat.back[atomic_get(&nat.mapping)],
+					  &nat.server_addr, &nat.client_addr);
+		}
+
+		for (int i = 0; i < ARRAY_SIZE(nat.back); i++) {
+			if (fds[i + 1].revents & ZSOCK_POLLIN) {
+				nat_proxy_forward(nat.back[i], nat.front,
+						  &nat.client_addr, NULL);
+			}
+		}
+	}
+}
+
+static void nat_proxy_start(struct sockaddr_in *server_addr,
+			    struct sockaddr_in *front_addr)
+{
+	struct sockaddr_in addr;
+
+	nat.server_addr = *server_addr;
+	atomic_set(&nat.mapping, 0);
+	atomic_set(&nat.stop, 0);
+	atomic_set(&nat.hold, 0);
+	nat.held_len = 0;
+
+	prepare_sock_udp_v4(MY_IPV4_ADDR, NAT_FRONT_PORT, &nat.front,
+			    front_addr);
+	test_bind(nat.front, (struct sockaddr *)front_addr, sizeof(*front_addr));
+
+	for (int i = 0; i < ARRAY_SIZE(nat.back); i++) {
+		prepare_sock_udp_v4(MY_IPV4_ADDR, NAT_BACK_PORT + i,
+				    &nat.back[i], &addr);
+		test_bind(nat.back[i], (struct sockaddr *)&addr, sizeof(addr));
+	}
+
+	k_thread_create(&nat_proxy_thread, nat_proxy_stack,
+			K_THREAD_STACK_SIZEOF(nat_proxy_stack), nat_proxy_run,
+			NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0,
+			K_NO_WAIT);
+}
+
+static void nat_proxy_stop(void)
+{
+	atomic_set(&nat.stop, 1);
+	zassert_equal(k_thread_join(&nat_proxy_thread, K_SECONDS(1)), 0,
+		      "NAT proxy did not stop");
+
+	test_close(nat.front);
+	test_close(nat.back[0]);
+	test_close(nat.back[1]);
+}
+
+static void test_dtls_recv_from(int sock, uint16_t port)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	struct zsock_pollfd fds[1] = {
+		{ .fd = sock, .events = ZSOCK_POLLIN },
+	};
+	char rx_buf[sizeof(TEST_STR_SMALL)] = { 0 };
+	int ret;
+
+	ret = zsock_poll(fds, 1, 1000);
+	zassert_equal(ret, 1, "poll() did not report data ready");
+
+	ret = zsock_recvfrom(sock, rx_buf, sizeof(rx_buf), 0,
+			     (struct sockaddr *)&addr, &addrlen);
+	zassert_equal(ret, sizeof(TEST_STR_SMALL) - 1, "recvfrom() failed");
+	zassert_mem_equal(rx_buf, TEST_STR_SMALL, ret, "invalid rx data");
+	zassert_equal(ntohs(addr.sin_port), port, "Wrong peer port");
+}
+
+ZTEST(net_socket_tls, test_v4_dtls_cid_peer_address_change)
+{
+	struct sockaddr_in c_saddr;
+	struct sockaddr_in s_saddr;
+	struct sockaddr_in front_saddr;
+	struct connect_data test_data;
+	struct zsock_pollfd fds[1];
+	int role = TLS_DTLS_ROLE_SERVER;
+	int cid = TLS_DTLS_CID_ENABLED;
+	uint8_t rx_byte;
+	socklen_t optlen = sizeof(int);
+	int status;
+
+	prepare_sock_dtls_v4(MY_IPV4_ADDR, ANY_PORT, &c_sock, &c_saddr,
+			     IPPROTO_DTLS_1_2);
+	prepare_sock_dtls_v4(MY_IPV4_ADDR, SERVER_PORT, &s_sock, &s_saddr,
+			     IPPROTO_DTLS_1_2);
+
+	test_config_psk(s_sock, c_sock);
+
+	zassert_equal(zsock_setsockopt(s_sock, SOL_TLS, TLS_DTLS_ROLE,
+				       &role, sizeof(role)),
+		      0, "setsockopt() failed");
+	zassert_equal(zsock_setsockopt(s_sock, SOL_TLS, TLS_DTLS_CID,
+				       &cid, sizeof(cid)),
+		      0, "setsockopt() failed");
+	zassert_equal(zsock_setsockopt(c_sock, SOL_TLS, TLS_DTLS_CID,
+				       &cid, sizeof(cid)),
+		      0, "setsockopt() failed");
+
+	test_bind(s_sock, (struct sockaddr *)&s_saddr, sizeof(s_saddr));
+
+	nat_proxy_start(&s_saddr, &front_saddr);
+
+	/* The client connects through the NAT and sends a first datagram */
+	test_data.sock = c_sock;
+	test_data.addr = (struct sockaddr *)&front_saddr;
+	k_work_init_delayable(&test_data.work,
+			      dtls_client_connect_send_work_handler);
+	test_work_reschedule(&test_data.work, K_NO_WAIT);
+
+	fds[0].fd = s_sock;
+	fds[0].events = ZSOCK_POLLIN;
+	zassert_equal(zsock_poll(fds, 1, 1000), 1, "Handshake did not complete");
+
+	/* Flush the dummy byte. */
+	zassert_equal(zsock_recv(s_sock, &rx_byte, sizeof(rx_byte), 0),
+		      sizeof(rx_byte), "recv() failed");
+
+	test_work_wait(&test_data.work);
+
+	zassert_equal(zsock_getsockopt(s_sock, SOL_TLS, TLS_DTLS_CID_STATUS,
+				       &status, &optlen),
+		      0, "getsockopt() failed");
+	zassert_equal(status, TLS_DTLS_CID_STATUS_BIDIRECTIONAL,
+		      "CID not negotiated");
+
+	test_send(c_sock, TEST_STR_SMALL, sizeof(TEST_STR_SMALL) - 1, 0);
+	test_dtls_recv_from(s_sock, NAT_BACK_PORT);
+
+	/* A record delayed in the network arrives from another address after
+	 * a newer one. It is authentic, but it must not move the session.
+	 */
+	atomic_set(&nat.hold, 1);
+	test_send(c_sock, TEST_STR_SMALL, sizeof(TEST_STR_SMALL) - 1, 0);
+
+	for (int i = 0; i < 100 && nat.held_len <= 0; i++) {
+		k_msleep(10);
+	}
+
+	zassert_true(nat.held_len > 0, "Record not held");
+
+	test_send(c_sock, TEST_STR_SMALL, sizeof(TEST_STR_SMALL) - 1, 0);
+	test_dtls_recv_from(s_sock, NAT_BACK_PORT);
+
+	zassert_equal(zsock_sendto(nat.back[1], nat.held, nat.held_len, 0,
+				   (struct sockaddr *)&nat.server_addr,
+				   sizeof(nat.server_addr)),
+		      nat.held_len, "sendto() failed");
+	test_dtls_recv_from(s_sock, NAT_BACK_PORT);
+
+	/* NAT rebinding, the server now sees the client on another port. The
+	 * session goes on, the client does not handshake again on its own,
+	 * so the records would be dropped if the server did not accept them.
+	 */
+	atomic_set(&nat.mapping, 1);
+
+	test_send(c_sock, TEST_STR_SMALL, sizeof(TEST_STR_SMALL) - 1, 0);
+	test_dtls_recv_from(s_sock, NAT_BACK_PORT + 1);
+
+	/* The server replies to the new address */
+	test_send(s_sock, TEST_STR_SMALL, sizeof(TEST_STR_SMALL) - 1, 0);
+	test_dtls_recv_from(c_sock, NAT_FRONT_PORT);
+
+	test_sockets_close();
+
+	/* Small delay for the final alert exchange */
+	k_msleep(10);
+
+	nat_proxy_stop();
+}
+#endif /* CONFIG_MBEDTLS_SSL_DTLS_CONNECTION_ID */
+
+#define HANDSHAKE_BENCH_COUNT 16
+
+static void test_session_cache_set(int sock, int cache)
+{
+	zassert_equal(zsock_setsockopt(sock, SOL_TLS, TLS_SESSION_CACHE,
+				       &cache, sizeof(cache)),
+		      0, "Failed to set session cache");
+}
+
+static void test_prepare_tls_server(struct sockaddr_in *s_saddr)
+{
+	prepare_sock_tls_v4(MY_IPV4_ADDR, ANY_PORT, &s_sock, s_saddr,
+			    IPPROTO_TLS_1_2);
+	test_config_psk(s_sock, -1);
+	test_session_cache_set(s_sock, TLS_SESSION_CACHE_ENABLED);
+
+	test_bind(s_sock, (struct sockaddr *)s_saddr, sizeof(*s_saddr));
+	test_listen(s_sock);
+}
+
+/* Connect a new client to the listening server socket, and return the time
+ * the handshake took. The master secret of the session is copied to @master
+ * if not NULL, it only stays the same when the session is resumed.
+ */
+static uint32_t test_tls_handshake(struct sockaddr_in *s_saddr, int cache,
+				   uint8_t *master)
+{
+	struct sockaddr_in c_saddr;
+	struct connect_data test_data;
+	mbedtls_ssl_session session;
+	uint32_t start, cycles;
+
+	prepare_sock_tls_v4(MY_IPV4_ADDR, ANY_PORT, &c_sock, &c_saddr,
+			    IPPROTO_TLS_1_2);
+	test_config_psk(-1, c_sock);
+	test_session_cache_set(c_sock, cache);
+
+	test_data.sock = c_sock;
+	test_data.addr = (struct sockaddr *)s_saddr;
+	k_work_init_delayable(&test_data.work, client_connect_work_handler);
+
+	start = k_cycle_get_32();
+
+	test_work_reschedule(&test_data.work, K_NO_WAIT);
+	test_accept(s_sock, &new_sock, NULL, NULL);
+	test_work_wait(&test_data.work);
+
+	cycles = k_cycle_get_32() - start;
+
+	if (master != NULL) {
+		mbedtls_ssl_session_init(&session);
+		zassert_equal(mbedtls_ssl_get_session(
+				ztls_get_mbedtls_ssl_context(c_sock), &session),
+			      0, "Failed to get session");
+		memcpy(master, session.MBEDTLS_PRIVATE(master),
+		       sizeof(session.MBEDTLS_PRIVATE(master)));
+		mbedtls_ssl_session_free(&session);
+	}
+
+	test_close(c_sock);
+	c_sock = -1;
+	test_close(new_sock);
+	new_sock = -1;
+
+	/* Do not run out of contexts because of the TIME_WAIT state */
+	k_sleep(K_MSEC(2 * CONFIG_NET_TCP_TIME_WAIT_DELAY));
+
+	return cycles;
+}
+
+ZTEST(net_socket_tls, test_v4_session_resumption)
+{
+	uint8_t master[3][48];
+	struct sockaddr_in s_saddr;
+	int purge = 0;
+
+	if (!IS_ENABLED(CONFIG_MBEDTLS_SSL_CACHE_C) &&
+	    !IS_ENABLED(CONFIG_NET_SOCKETS_TLS_SERVER_SESSION_TICKETS)) {
+		ztest_test_skip();
+	}
+
+	test_prepare_tls_server(&s_saddr);
+
+	(void)test_tls_handshake(&s_saddr, TLS_SESSION_CACHE_ENABLED, master[0]);
+	(void)test_tls_handshake(&s_saddr, TLS_SESSION_CACHE_ENABLED, master[1]);
+
+	zassert_mem_equal(master[0], master[1], sizeof(master[0]),
+			  "Session not resumed");
+
+	/* After a purge the server no longer knows the session */
+	zassert_equal(zsock_setsockopt(s_sock, SOL_TLS, TLS_SESSION_CACHE_PURGE,
+				       &purge, sizeof(purge)),
+		      0, "Failed to purge session cache");
+
+	(void)test_tls_handshake(&s_saddr, TLS_SESSION_CACHE_ENABLED, master[2]);
+
+	zassert_true(memcmp(master[0], master[2], sizeof(master[0])) != 0,
+		     "Purged session resumed");
+}
+
+static void print_handshake_rate(const char *name, uint64_t us)
+{
+	TC_PRINT("%s: %d handshakes in %llu us, %llu handshakes/s\n", name,
+		 HANDSHAKE_BENCH_COUNT, us,
+		 us == 0 ? 0 : (uint64_t)HANDSHAKE_BENCH_COUNT * USEC_PER_SEC / us);
+}
+
+ZTEST(net_socket_tls, test_v4_handshake_rate)
+{
+	struct sockaddr_in s_saddr;
+	uint64_t full_us = 0;
+	uint64_t resumed_us = 0;
+
+	if (!IS_ENABLED(CONFIG_MBEDTLS_SSL_CACHE_C) &&
+	    !IS_ENABLED(CONFIG_NET_SOCKETS_TLS_SERVER_SESSION_TICKETS)) {
+		ztest_test_skip();
+	}
+
+	test_prepare_tls_server(&s_saddr);
+
+	for (int i = 0; i < HANDSHAKE_BENCH_COUNT; i++) {
+		full_us += k_cyc_to_us_floor64(
+			test_tls_handshake(&s_saddr, TLS_SESSION_CACHE_DISABLED,
+					   NULL));
+	}
+
+	/* The first handshake gives the client a session to resume */
+	(void)test_tls_handshake(&s_saddr, TLS_SESSION_CACHE_ENABLED, NULL);
+
+	for (int i = 0; i < HANDSHAKE_BENCH_COUNT; i++) {
+		resumed_us += k_cyc_to_us_floor64(
+			test_tls_handshake(&s_saddr, TLS_SESSION_CACHE_ENABLED,
+					   NULL));
+	}
+
+	print_handshake_rate("Full handshake", full_us);
+	print_handshake_rate("Resumed handshake", resumed_us);
+}
+
 static void *tls_tests_setup(void)
 {
 	k_work_queue_init(&tls_test_work_queue);
@@ -11,6 +11,7 @@ LOG_MODULE_REGISTER(net_test, CONFIG_NET_SOCKETS_LOG_LEVEL);
 #include <stdio.h>
 #include <zephyr/sys/mutex.h>
 #include <zephyr/ztest_assert.h>
+#include <zephyr/timing/timing.h>
 
 #include <zephyr/net/socket.h>
 #include <zephyr/net/ethernet.h>
@@ -2408,6 +2409,409 @@ ZTEST_USER(net_socket_udp, test_35_recvmsg_msg_controllen_update)
 	zassert_equal(rv, 0, "close failed");
 }
 
+#define MMSG_COUNT 4
+
+static void comm_sendmmsg_recvmmsg(int client_sock, int server_sock,
+				  struct sockaddr *server_addr,
+				  socklen_t server_addrlen)
+{
+	static ZTEST_BMEM char bufs[MMSG_COUNT][MAX_BUF_LEN];
+	struct mmsghdr tx_msgs[MMSG_COUNT];
+	struct mmsghdr rx_msgs[MMSG_COUNT];
+	struct iovec tx_iov[MMSG_COUNT];
+	struct iovec rx_iov[MMSG_COUNT];
+	int rv;
+
+	memset(tx_msgs, 0, sizeof(tx_msgs));
+	memset(rx_msgs, 0, sizeof(rx_msgs));
+
+	for (int i = 0; i < MMSG_COUNT; i++) {
+		/* Different length for each datagram */
+		tx_iov[i].iov_base = TEST_STR_SMALL;
+		tx_iov[i].iov_len = STRLEN(TEST_STR_SMALL) - i;
+		tx_msgs[i].msg_hdr.msg_iov = &tx_iov[i];
+		tx_msgs[i].msg_hdr.msg_iovlen = 1;
+		tx_msgs[i].msg_hdr.msg_name = server_addr;
+		tx_msgs[i].msg_hdr.msg_namelen = server_addrlen;
+
+		rx_iov[i].iov_base = bufs[i];
+		rx_iov[i].iov_len = sizeof(bufs[i]);
+		rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+		rx_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	/* Only the first datagrams are sent so that the receiver has
+	 * less data queued than it asks for.
+	 */
+	rv = zsock_sendmmsg(client_sock, tx_msgs, MMSG_COUNT - 1, 0);
+	zassert_equal(rv, MMSG_COUNT - 1, "sendmmsg failed (%d)", errno);
+
+	for (int i = 0; i < MMSG_COUNT - 1; i++) {
+		zassert_equal(tx_msgs[i].msg_len, tx_iov[i].iov_len,
+			      "invalid sent length");
+	}
+
+	k_msleep(10);
+
+	rv = zsock_recvmmsg(server_sock, rx_msgs, MMSG_COUNT,
+			    ZSOCK_MSG_WAITFORONE);
+	zassert_equal(rv, MMSG_COUNT - 1, "recvmmsg failed (%d)", errno);
+
+	for (int i = 0; i < MMSG_COUNT - 1; i++) {
+		zassert_equal(rx_msgs[i].msg_len, tx_iov[i].iov_len,
+			      "invalid received length");
+		zassert_mem_equal(bufs[i], TEST_STR_SMALL, rx_msgs[i].msg_len,
+				  "wrong data");
+	}
+
+	/* Nothing queued */
+	rv = zsock_recvmmsg(server_sock, rx_msgs, MMSG_COUNT, ZSOCK_MSG_DONTWAIT);
+	zassert_equal(rv, -1, "recvmmsg succeeded");
+	zassert_equal(errno, EAGAIN, "incorrect errno value");
+}
+
+ZTEST_USER(net_socket_udp, test_36_v4_sendmmsg_recvmmsg)
+{
+	int rv;
+	int client_sock;
+	int server_sock;
+	struct sockaddr_in client_addr;
+	struct sockaddr_in server_addr;
+
+	prepare_sock_udp_v4(MY_IPV4_ADDR, ANY_PORT, &client_sock, &client_addr);
+	prepare_sock_udp_v4(MY_IPV4_ADDR, SERVER_PORT, &server_sock, &server_addr);
+
+	rv = zsock_bind(server_sock, (struct sockaddr *)&server_addr,
+			sizeof(server_addr));
+	zassert_equal(rv, 0, "server bind failed");
+
+	rv = zsock_bind(client_sock, (struct sockaddr *)&client_addr,
+			sizeof(client_addr));
+	zassert_equal(rv, 0, "client bind failed");
+
+	comm_sendmmsg_recvmmsg(client_sock, server_sock,
+			       (struct sockaddr *)&server_addr,
+			       sizeof(server_addr));
+
+	rv = zsock_close(client_sock);
+	zassert_equal(rv, 0, "close failed");
+	rv = zsock_close(server_sock);
+	zassert_equal(rv, 0, "close failed");
+}
+
+ZTEST_USER(net_socket_udp, test_37_v6_sendmmsg_recvmmsg)
+{
+	int rv;
+	int client_sock;
+	int server_sock;
+	struct sockaddr_in6 client_addr;
+	struct sockaddr_in6 server_addr;
+
+	prepare_sock_udp_v6(MY_IPV6_ADDR, ANY_PORT, &client_sock, &client_addr);
+	prepare_sock_udp_v6(MY_IPV6_ADDR, SERVER_PORT, &server_sock, &server_addr);
+
+	rv = zsock_bind(server_sock, (struct sockaddr *)&server_addr,
+			sizeof(server_addr));
+	zassert_equal(rv, 0, "server bind failed");
+
+	rv = zsock_bind(client_sock, (struct sockaddr *)&client_addr,
+			sizeof(client_addr));
+	zassert_equal(rv, 0, "client bind failed");
+
+	comm_sendmmsg_recvmmsg(client_sock, server_sock,
+			       (struct sockaddr *)&server_addr,
+			       sizeof(server_addr));
+
+	rv = zsock_close(client_sock);
+	zassert_equal(rv, 0, "close failed");
+	rv = zsock_close(server_sock);
+	zassert_equal(rv, 0, "close failed");
+}
+
+ZTEST(net_socket_udp, test_38_mmsg_invalid)
+{
+	struct mmsghdr msgs[1];
+	int rv;
+
+	rv = zsock_sendmmsg(-1, msgs, ARRAY_SIZE(msgs), 0);
+	zassert_equal(rv, -1, "sendmmsg succeeded");
+	zassert_equal(errno, EBADF, "incorrect errno value");
+
+	rv = zsock_recvmmsg(-1, msgs, ARRAY_SIZE(msgs), 0);
+	zassert_equal(rv, -1, "recvmmsg succeeded");
+	zassert_equal(errno, EBADF, "incorrect errno value");
+}
+
+#define MMSG_BENCH_ROUNDS 200
+
+static uint64_t udp_bench(int client_sock, int server_sock, bool batched)
+{
+	static char buf[MMSG_COUNT][32];
+	struct mmsghdr tx_msgs[MMSG_COUNT];
+	struct mmsghdr rx_msgs[MMSG_COUNT];
+	struct iovec tx_iov;
+	struct iovec rx_iov[MMSG_COUNT];
+	timing_t start, end;
+	int rv;
+
+	memset(tx_msgs, 0, sizeof(tx_msgs));
+	memset(rx_msgs, 0, sizeof(rx_msgs));
+
+	tx_iov.iov_base = TEST_STR_SMALL;
+	tx_iov.iov_len = STRLEN(TEST_STR_SMALL);
+
+	for (int i = 0; i < MMSG_COUNT; i++) {
+		tx_msgs[i].msg_hdr.msg_iov = &tx_iov;
+		tx_msgs[i].msg_hdr.msg_iovlen = 1;
+
+		rx_iov[i].iov_base = buf[i];
+		rx_iov[i].iov_len = sizeof(buf[i]);
+		rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+		rx_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	start = timing_counter_get();
+
+	for (int round = 0; round < MMSG_BENCH_ROUNDS; round++) {
+		int received = 0;
+
+		if (batched) {
+			rv = zsock_sendmmsg(client_sock, tx_msgs, MMSG_COUNT, 0);
+			zassert_equal(rv, MMSG_COUNT, "sendmmsg failed (%d)", errno);
+
+			while (received < MMSG_COUNT) {
+				rv = zsock_recvmmsg(server_sock, rx_msgs,
+						    MMSG_COUNT - received,
+						    ZSOCK_MSG_WAITFORONE);
+				zassert_true(rv > 0, "recvmmsg failed (%d)", errno);
+				received += rv;
+			}
+
+			continue;
+		}
+
+		for (int i = 0; i < MMSG_COUNT; i++) {
+			rv = zsock_sendmsg(client_sock, &tx_msgs[i].msg_hdr, 0);
+			zassert_equal(rv, tx_iov.iov_len, "sendmsg failed (%d)", errno);
+		}
+
+		for (int i = 0; i < MMSG_COUNT; i++) {
+			rv = zsock_recvmsg(server_sock, &rx_msgs[i].msg_hdr, 0);
+			zassert_equal(rv, tx_iov.iov_len, "recvmsg failed (%d)", errno);
+		}
+	}
+
+	end = timing_counter_get();
+
+	return timing_cycles_to_ns(timing_cycles_get(&start, &end));
+}
+
+ZTEST(net_socket_udp, test_39_mmsg_throughput)
+{
+	int rv;
+	int client_sock;
+	int server_sock;
+	struct sockaddr_in client_addr;
+	struct sockaddr_in server_addr;
+	uint64_t single_ns, batched_ns;
+
+	prepare_sock_udp_v4(MY_IPV4_ADDR, ANY_PORT, &client_sock, &client_addr);
+	prepare_sock_udp_v4(MY_IPV4_ADDR, SERVER_PORT, &server_sock, &server_addr);
+
+	rv = zsock_bind(server_sock, (struct sockaddr *)&server_addr,
+			sizeof(server_addr));
+	zassert_equal(rv, 0, "server bind failed");
+
+	rv = zsock_bind(client_sock, (struct sockaddr *)&client_addr,
+			sizeof(client_addr));
+	zassert_equal(rv, 0, "client bind failed");
+
+	rv = zsock_connect(client_sock, (struct sockaddr *)&server_addr,
+			   sizeof(server_addr));
+	zassert_equal(rv, 0, "connect failed");
+
+	timing_init();
+	timing_start();
+
+	single_ns = udp_bench(client_sock, server_sock, false);
+	batched_ns = udp_bench(client_sock, server_sock, true);
+
+	timing_stop();
+
+	TC_PRINT("%d datagrams: sendmsg/recvmsg %llu ns, sendmmsg/recvmmsg %llu ns\n",
+		 MMSG_BENCH_ROUNDS * MMSG_COUNT, single_ns, batched_ns);
+
+	if (single_ns > 0 && batched_ns > 0) {
+		TC_PRINT("Packets per second: single %llu, batched %llu\n",
+			 MMSG_BENCH_ROUNDS * MMSG_COUNT * NSEC_PER_SEC / single_ns,
+			 MMSG_BENCH_ROUNDS * MMSG_COUNT * NSEC_PER_SEC / batched_ns);
+	}
+
+	rv = zsock_close(client_sock);
+	zassert_equal(rv, 0, "close failed");
+	rv = zsock_close(server_sock);
+	zassert_equal(rv, 0, "close failed");
+}
+
+#define ZC_DATA_LEN 600
+
+ZTEST(net_socket_udp, test_40_v4_recv_zc)
+{
+	static uint8_t tx_data[ZC_DATA_LEN];
+	int rv;
+	int client_sock;
+	int server_sock;
+	struct sockaddr_in client_addr;
+	struct sockaddr_in server_addr;
+	struct sockaddr_in src_addr;
+	socklen_t addrlen = sizeof(src_addr);
+	struct net_buf *data, *frag;
+	size_t offset = 0;
+
+	for (int i = 0; i < sizeof(tx_data); i++) {
+		tx_data[i] = (uint8_t)(i * 3);
+	}
+
+	prepare_sock_udp_v4(MY_IPV4_ADDR, CLIENT_PORT, &client_sock, &client_addr);
+	prepare_sock_udp_v4(MY_IPV4_ADDR, SERVER_PORT, &server_sock, &server_addr);
+
+	rv = zsock_bind(server_sock, (struct sockaddr *)&server_addr,
+			sizeof(server_addr));
+	zassert_equal(rv, 0, "server bind failed");
+
+	rv = zsock_bind(client_sock, (struct sockaddr *)&client_addr,
+			sizeof(client_addr));
+	zassert_equal(rv, 0, "client bind failed");
+
+	rv = zsock_recv_zc(server_sock, &data, ZSOCK_MSG_DONTWAIT, NULL, NULL);
+	zassert_equal(rv, -1, "recv_zc succeeded");
+	zassert_equal(errno, EAGAIN, "incorrect errno value");
+	zassert_is_null(data, "data returned");
+
+	rv = zsock_sendto(client_sock, tx_data, sizeof(tx_data), 0,
+			  (struct sockaddr *)&server_addr, sizeof(server_addr));
+	zassert_equal(rv, sizeof(tx_data), "sendto failed");
+
+	rv = zsock_recv_zc(server_sock, &data, 0, (struct sockaddr *)&src_addr,
+			   &addrlen);
+	zassert_equal(rv, sizeof(tx_data), "recv_zc failed (%d)", errno);
+	zassert_not_null(data, "no data");
+	zassert_equal(addrlen, sizeof(struct sockaddr_in), "wrong addrlen");
+	zassert_equal(src_addr.sin_port, htons(CLIENT_PORT), "wrong source port");
+
+	/* The data may span several fragments, headers must not be there */
+	for (frag = data; frag != NULL; frag = frag->frags) {
+		zassert_true(offset + frag->len <= sizeof(tx_data), "too much data");
+		zassert_mem_equal(frag->data, &tx_data[offset], frag->len,
+				  "wrong data");
+		offset += frag->len;
+	}
+
+	zassert_equal(offset, sizeof(tx_data), "wrong data length");
+
+	zsock_recv_zc_release(data);
+
+	rv = zsock_close(client_sock);
+	zassert_equal(rv, 0, "close failed");
+	rv = zsock_close(server_sock);
+	zassert_equal(rv, 0, "close failed");
+}
+
+static K_SEM_DEFINE(zc_tx_done, 0, 2);
+
+static void zc_tx_destroy(struct net_buf *buf)
+{
+	net_buf_destroy(buf);
+	k_sem_give(&zc_tx_done);
+}
+
+NET_BUF_POOL_DEFINE(zc_tx_pool, 2, 0, 0, zc_tx_destroy);
+
+ZTEST(net_socket_udp, test_41_v4_send_zc)
+{
+	static uint8_t tx_data[ZC_DATA_LEN];
+	static uint8_t rx_data[ZC_DATA_LEN];
+	int rv;
+	int client_sock;
+	int server_sock;
+	struct sockaddr_in client_addr;
+	struct sockaddr_in server_addr;
+	struct net_buf *data, *frag;
+
+	for (int i = 0; i < sizeof(tx_data); i++) {
+		tx_data[i] = (uint8_t)(i * 5);
+	}
+
+	prepare_sock_udp_v4(MY_IPV4_ADDR, CLIENT_PORT, &client_sock, &client_addr);
+	prepare_sock_udp_v4(MY_IPV4_ADDR, SERVER_PORT, &server_sock, &server_addr);
+
+	rv = zsock_bind(server_sock, (struct sockaddr *)&server_addr,
+			sizeof(server_addr));
+	zassert_equal(rv, 0, "server bind failed");
+
+	rv = zsock_bind(client_sock, (struct sockaddr *)&client_addr,
+			sizeof(client_addr));
+	zassert_equal(rv, 0, "client bind failed");
+
+	/* The datagram is sent from two fragments pointing to tx_data */
+	data = net_buf_alloc_with_data(&zc_tx_pool, tx_data, ZC_DATA_LEN / 2,
+				       K_NO_WAIT);
+	zassert_not_null(data, "cannot allocate buffer");
+	frag = net_buf_alloc_with_data(&zc_tx_pool, &tx_data[ZC_DATA_LEN / 2],
+				       ZC_DATA_LEN / 2, K_NO_WAIT);
+	zassert_not_null(frag, "cannot allocate buffer");
+	net_buf_frag_add(data, frag);
+
+	rv = zsock_send_zc(client_sock, &data, 0, (struct sockaddr *)&server_addr,
+			   sizeof(server_addr));
+	zassert_equal(rv, sizeof(tx_data), "send_zc failed (%d)", errno);
+	zassert_is_null(data, "data left");
+
+	rv = zsock_recv(server_sock, rx_data, sizeof(rx_data), 0);
+	zassert_equal(rv, sizeof(tx_data), "recv failed");
+	zassert_mem_equal(rx_data, tx_data, sizeof(tx_data), "wrong data");
+
+	/* Both fragments are given back once the datagram is sent */
+	for (int i = 0; i < 2; i++) {
+		zassert_ok(k_sem_take(&zc_tx_done, K_MSEC(100)),
+			   "no completion");
+	}
+
+	/* Connected socket without a destination address */
+	rv = zsock_connect(client_sock, (struct sockaddr *)&server_addr,
+			   sizeof(server_addr));
+	zassert_equal(rv, 0, "connect failed");
+
+	data = net_buf_alloc_with_data(&zc_tx_pool, tx_data, 10, K_NO_WAIT);
+	zassert_not_null(data, "cannot allocate buffer");
+
+	rv = zsock_send_zc(client_sock, &data, 0, NULL, 0);
+	zassert_equal(rv, 10, "send_zc failed (%d)", errno);
+	zassert_is_null(data, "data left");
+
+	rv = zsock_recv(server_sock, rx_data, sizeof(rx_data), 0);
+	zassert_equal(rv, 10, "recv failed");
+	zassert_ok(k_sem_take(&zc_tx_done, K_MSEC(100)), "no completion");
+
+	/* On error the data stays with the caller */
+	data = net_buf_alloc_with_data(&zc_tx_pool, tx_data, 10, K_NO_WAIT);
+	zassert_not_null(data, "cannot allocate buffer");
+
+	rv = zsock_send_zc(client_sock, &data, ZSOCK_MSG_WAITALL, NULL, 0);
+	zassert_equal(rv, -1, "send_zc succeeded");
+	zassert_equal(errno, EINVAL, "Unexpected errno value: %d", errno);
+	zassert_not_ok(k_sem_take(&zc_tx_done, K_NO_WAIT),
+		       "fragment released on error");
+
+	net_buf_unref(data);
+	zassert_ok(k_sem_take(&zc_tx_done, K_NO_WAIT), "no completion");
+
+	rv = zsock_close(client_sock);
+	zassert_equal(rv, 0, "close failed");
+	rv = zsock_close(server_sock);
+	zassert_equal(rv, 0, "close failed");
+}
+
 static void after(void *arg)
 {
 	ARG_UNUSED(arg);
@@ -26,6 +26,7 @@ LOG_MODULE_REGISTER(net_test, CONFIG_NET_UTILS_LOG_LEVEL);
 
 #include <zephyr/tc_util.h>
 #include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
 
 #define NET_LOG_ENABLED 1
 #include "net_private.h"
@@ -923,4 +924,97 @@ ZTEST(test_utils_fn, test_ip_checksum)
 	}
 }
 
+static uint16_t chksum_field(const uint8_t *data, size_t len)
+{
+	return htons(~calc_chksum(0, data, len));
+}
+
+ZTEST(test_utils_fn, test_ip_checksum_update)
+{
+	uint8_t old_data[7];
+	uint16_t old_val, new_val;
+	uint32_t old_addr, new_addr;
+	uint16_t chksum;
+
+	for (int i = 0; i < 64; i++) {
+		testdata[i] = (uint8_t)(i * 37 + 5);
+	}
+
+	/* 16-bit field, like the IPv4 total length */
+	chksum = chksum_field(testdata, 64);
+	memcpy(&old_val, &testdata[2], sizeof(old_val));
+	new_val = htons(ntohs(old_val) + 1400);
+	memcpy(&testdata[2], &new_val, sizeof(new_val));
+
+	zassert_equal(net_chksum_update_u16(chksum, old_val, new_val),
+		      chksum_field(testdata, 64),
+		      "Mismatch in 16-bit incremental update");
+
+	/* 32-bit field, like an IPv4 address, at an unaligned offset */
+	chksum = chksum_field(testdata, 64);
+	memcpy(&old_addr, &testdata[14], sizeof(old_addr));
+	new_addr = htonl(0xc0a80101);
+	memcpy(&testdata[14], &new_addr, sizeof(new_addr));
+
+	zassert_equal(net_chksum_update_u32(chksum, old_addr, new_addr),
+		      chksum_field(testdata, 64),
+		      "Mismatch in 32-bit incremental update");
+
+	/* Range with odd length ending the data, starting at an even offset */
+	chksum = chksum_field(testdata, 63);
+	memcpy(old_data, &testdata[56], sizeof(old_data));
+	memset(&testdata[56], 0xa5, sizeof(old_data));
+
+	zassert_equal(net_chksum_update(chksum, old_data, &testdata[56],
+					sizeof(old_data)),
+		      chksum_field(testdata, 63),
+		      "Mismatch in incremental update of a range");
+
+	/* No change must keep the checksum */
+	chksum = chksum_field(testdata, 64);
+	memcpy(&old_val, &testdata[10], sizeof(old_val));
+
+	zassert_equal(net_chksum_update_u16(chksum, old_val, old_val), chksum,
+		      "Checksum changed without a data change");
+}
+
+#define CHECKSUM_BENCH_ROUNDS 1000
+
+ZTEST(test_utils_fn, test_ip_checksum_throughput)
+{
+	volatile uint16_t sum = 0;
+	timing_t start, end;
+	uint64_t cycles_ref, cycles;
+
+	for (int i = 0; i < CHECKSUM_TEST_LENGTH; i++) {
+		testdata[i] = (uint8_t)(i * 7);
+	}
+
+	timing_init();
+	timing_start();
+
+	start = timing_counter_get();
+	for (int i = 0; i < CHECKSUM_BENCH_ROUNDS; i++) {
+		sum += calc_chksum_ref(0, testdata, CHECKSUM_TEST_LENGTH);
+	}
+	end = timing_counter_get();
+	cycles_ref = timing_cycles_get(&start, &end);
+
+	start = timing_counter_get();
+	for (int i = 0; i < CHECKSUM_BENCH_ROUNDS; i++) {
+		sum += calc_chksum(0, testdata, CHECKSUM_TEST_LENGTH);
+	}
+	end = timing_counter_get();
+	cycles = timing_cycles_get(&start, &end);
+
+	timing_stop();
+
+	TC_PRINT("Checksum of %d bytes x %d: reference %llu ns, calc_chksum %llu ns\n",
+		 CHECKSUM_TEST_LENGTH, CHECKSUM_BENCH_ROUNDS,
+		 timing_cycles_to_ns(cycles_ref), timing_cycles_to_ns(cycles));
+	TC_PRINT("calc_chksum: %llu bytes per 1000 cycles\n",
+		 cycles == 0 ? 0ULL :
+		 (uint64_t)CHECKSUM_TEST_LENGTH * CHECKSUM_BENCH_ROUNDS * 1000ULL / cycles);
+}
+
 ZTEST_SUITE(test_utils_fn, NULL, NULL, NULL, NULL, NULL);